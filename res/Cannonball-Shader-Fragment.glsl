@@ -40,22 +40,21 @@ uniform float vignette;
 uniform float desat_inv0;       // set to 1.0 / (1.0 + desaturate)
 uniform float desat_inv1;       // set to 1.0 / (1.0 + desaturate + desaturateEdges)
 
-uniform float baseOff;          // shadow mask dim value, e.g. 0.75f
-uniform float baseOn;           // shadow mask boost value, usually 1/baseOff e.g. 1.333f
-
 /* Shadow mask
- * maskPitch is between 3 and 6. Setting invMaskPitch saves division in the mask.
- * Use 3 for 1280x1024 screens, 4+ provide wider spacing e.g. high DPI screens
- * Hence, invMaskPitch is 1/3, 1/4, 1/5, or 1/6.
- * inv2MaskPitch is 1/(2*maskPitch) - i.e., 1/6 when invMaskPitch is 1/3.
- * inv2Height is 1/2,1/4,1/6,1/8... - i.e., the pattern height. Odd values won't work correctly.
+ * One tile of the mask, baked by the CPU when the mask settings change (glb::set_shadow_mask):
+ * 2*maskPitch by 2*(maskPitch-2) output pixels, each the level / 2. maskPitch is between 3 and
+ * 6; use 3 for 1280x1024 screens, 4+ provide wider spacing e.g. high DPI screens.
+ * maskTile is 1/width, 1/height of the tile.
  */
-uniform float invMaskPitch;
-uniform float inv2MaskPitch;
-uniform float inv2Height;
+uniform sampler2D ShadowMask;
+uniform vec2 maskTile;
 
 uniform vec2 u_Time;           // set both elements to FrameCount / 60.0
 
+uniform vec2 scanline;         // level of the odd rows of the game image (1.0 = no scanlines),
+                               // and the rows of the image, for scanlines drawn here rather than
+                               // by the CPU (video.gpu_scanlines)
+
 
 // -------------------------------------------------------------------
 // CRT Texture Warp function. Creates the illusion of curved glass.
@@ -132,22 +131,9 @@ vec3 addNoise(vec3 colour, vec2 uv, float intensity) {
 
 mediump vec3 fastmask()
 {
-    mediump vec2 mpos = floor(maskpos);
-
-    // Compute both x fracts together to limit temporaries
-    mediump vec2 mx = fract(mpos.xx * vec2(invMaskPitch, inv2MaskPitch));
-    mediump float my = fract(mpos.y * inv2Height);
-
-    mediump float condA = step(0.02, mx.x);
-    mediump float condB = step(0.5,  mx.y);
-
-    // Vertical windows matching the original
-    mediump float v0    = 1.0 - step(0.02, my);                 // near 0
-    mediump float vhalf = 1.0 - step(0.02, abs(my - 0.5));      // near 0.5
-    mediump float extraMask = mix(v0, vhalf, condB);
-
-    mediump float base = mix(baseOff, baseOn, condA * (1.0 - extraMask));
-    return vec3(base);
+    // The tile isn't a power of two in size, so it's repeated here rather than by the sampler
+    mediump vec2 tpos = fract((floor(maskpos) + 0.5) * maskTile);  // texel centres
+    return vec3(texture2D(ShadowMask, tpos).r * 2.0);
 }
 
 
@@ -190,6 +176,10 @@ void main()
     // Sample texture colour and calculate luminance
     vec3 pCol = texture2D(Texture, warpedUV).rgb;
 
+    // Scanlines: dim the odd rows of the game image, less so where it's bright (as the CPU pass)
+    if (mod(floor(warpedUV.y * scanline.y), 2.0) >= 1.0)
+        pCol *= mix(scanline.x, 1.0, dot(pCol, vec3(0.30, 0.59, 0.11)));
+
     float lum = (pCol.r + pCol.g + pCol.b) * 0.33333 * 0.9;
 
     // Add noise
@@ -204,8 +194,13 @@ void main()
     // Apply brighening
     pCol *= brightboost;
 
-    // Apply overlay
+    // Apply overlay (the backend also builds this shader with NO_OVERLAY, for frames without one,
+    // and with EDGE_MASK, providing edgeMask() to work the overlay out here instead)
+#if defined(EDGE_MASK)
+    pCol *= edgeMask(v_texCoord);
+#elif !defined(NO_OVERLAY)
     pCol *= texture2D(Overlay, v_texCoord).rgb;
+#endif
     
     gl_FragColor = vec4(pCol, 1.0);
 }
@@ -0,0 +1,592 @@
+/***************************************************************************
+    CannonBall-SE Kernel Benchmarks.
+
+    Times the S16 video layer and filter kernels in isolation, against a
+    video snapshot captured from the game with:
+
+        cannonball-se -benchmark n -snapshot file
+
+    Each kernel is run repeatedly over the same layer state in lo-res and
+    hi-res, normal and widescreen, so that a change to one kernel can be
+    measured without the noise of the rest of the frame. Usage:
+
+        cannonball-bench [-n iterations] rom_path snapshot...
+
+    The CRC32 of the composed frame and of each filter output can also be
+    recorded as golden hashes, and later builds checked against them, so
+    that a rendering optimisation can be shown to leave the image
+    bit-identical:
+
+        cannonball-bench -record golden.txt rom_path snapshot...
+        cannonball-bench -check  golden.txt rom_path snapshot...
+
+    Hashes are kept per snapshot, mode and PIXEL_ACCURACY setting, so one
+    file can hold both builds. Timing is skipped unless -n is given.
+
+    The sprite and road RAM ring (hwvideo/ramring.hpp) can be checked
+    against the two halves exchanged on each swap that it replaced, over
+    n rounds of random writes, swaps, holds and releases. No ROMs are
+    needed:
+
+        cannonball-bench -ramring n
+
+    And the tile and text RAM dirty marking, for writes at the engine's
+    full addresses (no ROMs needed either):
+
+        cannonball-bench -dirty
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "globals.hpp"
+#include "roms.hpp"
+#include "video.hpp"
+#include "frontend/config.hpp"
+#include "utils.hpp"
+#include "hwvideo/hwtiles.hpp"
+#include "hwvideo/hwsprites.hpp"
+#include "hwvideo/hwroad.hpp"
+#include "hwvideo/ramring.hpp"
+#include "sdl2/renderbase.hpp"
+#include "sdl2/snes_ntsc.h"
+#include "sdl2/scanlines.hpp"
+
+// The layer code reads its settings from the global config. config.cpp (and so the XML loader
+// and everything the menus reach) isn't linked, so the few fields used are set up here.
+Config config;
+Config::Config(void)  {}
+Config::~Config(void) {}
+
+// ------------------------------------------------------------------------------------------------
+// Palette conversion, as the SDL2 renderer does it, without a display
+// ------------------------------------------------------------------------------------------------
+
+class BenchRenderer : public RenderBase
+{
+public:
+    bool init(int, int, int, int, int) { return true; }
+    void swap_buffers()                 {}
+    void disable()                      {}
+    bool start_frame()                  { return true; }
+    bool finalize_frame()               { return true; }
+    void draw_frame(uint16_t*, int, int) {}
+
+    const uint16_t* blargg_palette() const { return rgb_blargg; }
+    const uint16_t* rgb555_palette() const { return s16_rgb555; }
+};
+
+// ------------------------------------------------------------------------------------------------
+// Timing
+// ------------------------------------------------------------------------------------------------
+
+static int iterations = 200;
+
+// Run kernel iterations times, after one untimed run to fill the caches and build any lazily
+// converted data, then print the fastest, median and mean times in microseconds. With no
+// iterations, just the untimed run is made.
+template <typename Kernel>
+static void time_kernel(const char* mode, const char* name, Kernel&& kernel)
+{
+    using clock = std::chrono::steady_clock;
+    std::vector<double> us;
+    us.reserve(iterations);
+
+    kernel();
+    if (iterations <= 0)
+        return;
+    for (int i = 0; i < iterations; i++) {
+        const auto t = clock::now();
+        kernel();
+        us.push_back(std::chrono::duration<double, std::micro>(clock::now() - t).count());
+    }
+
+    std::sort(us.begin(), us.end());
+    double sum = 0.0;
+    for (double v : us) sum += v;
+    std::printf("%-11s %-18s %10.1f %10.1f %10.1f\n",
+                mode, name, us.front(), us[us.size() / 2], sum / us.size());
+}
+
+// ------------------------------------------------------------------------------------------------
+// Golden hashes
+//
+// One line per output: snapshot, PIXEL_ACCURACY, mode, output then the CRC32 in hex.
+// ------------------------------------------------------------------------------------------------
+
+static std::map<std::string, uint32_t> hashes;   // this run
+static std::string snapshot_name;                // snapshot being run, without its path
+
+static void add_hash(const char* mode, const char* output, const void* data, size_t bytes)
+{
+    const std::string key = snapshot_name + " " + std::to_string(PIXEL_ACCURACY) + " " + mode + " " + output;
+    hashes[key] = Utils::crc32(data, bytes);
+}
+
+static bool read_golden(const std::string& filename, std::map<std::string, uint32_t>& golden)
+{
+    std::ifstream in(filename);
+    if (!in)
+        return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        const size_t split = line.rfind(' ');
+        if (split == std::string::npos)
+            continue;
+        golden[line.substr(0, split)] = uint32_t(std::strtoul(line.c_str() + split + 1, nullptr, 16));
+    }
+    return true;
+}
+
+// Add this run's hashes to the file, keeping entries for other snapshots and builds
+static bool record_golden(const std::string& filename)
+{
+    std::map<std::string, uint32_t> golden;
+    read_golden(filename, golden);
+    for (const auto& [key, crc] : hashes)
+        golden[key] = crc;
+
+    std::ofstream out(filename, std::ios::trunc);
+    char crc_text[16];
+    for (const auto& [key, crc] : golden) {
+        std::snprintf(crc_text, sizeof(crc_text), "0x%08x", crc);
+        out << key << " " << crc_text << "\n";
+    }
+    if (!out) {
+        std::cerr << "Unable to write golden hashes " << filename << std::endl;
+        return false;
+    }
+    std::cout << hashes.size() << " golden hashes recorded in " << filename << std::endl;
+    return true;
+}
+
+static bool check_golden(const std::string& filename)
+{
+    std::map<std::string, uint32_t> golden;
+    if (!read_golden(filename, golden)) {
+        std::cerr << "Unable to read golden hashes " << filename << std::endl;
+        return false;
+    }
+
+    int failed = 0, missing = 0;
+    for (const auto& [key, crc] : hashes) {
+        auto it = golden.find(key);
+        if (it == golden.end()) {
+            std::printf("no golden hash: %s\n", key.c_str());
+            missing++;
+        } else if (it->second != crc) {
+            std::printf("MISMATCH:       %s (expected 0x%08x, got 0x%08x)\n", key.c_str(), it->second, crc);
+            failed++;
+        }
+    }
+    std::printf("%zu outputs checked: %zu match, %d differ, %d without a golden hash\n",
+                hashes.size(), hashes.size() - failed - missing, failed, missing);
+    return failed == 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+// RAM ring check
+//
+// The game's half and the drawn half, exchanged on each swap, as the hardware and the code before
+// RamRing did it. A hold keeps what was drawn at the time until the release.
+// ------------------------------------------------------------------------------------------------
+
+static bool check_ramring(int rounds)
+{
+    static const int WORDS = 16;
+    RamRing<uint16_t, WORDS> ring;
+    uint16_t write[WORDS] = {}, drawn[WORDS] = {}, held[WORDS] = {};
+    bool holding = false;
+
+    std::mt19937 rng(0x5E6A);
+    for (int r = 0; r < rounds; r++) {
+        const int op = int(rng() % 8);
+        if (op < 4) {
+            const int      i = int(rng() % WORDS);
+            const uint16_t v = uint16_t(rng());
+            ring.ram[i] = write[i] = v;
+        }
+        else if (op < 6) {
+            ring.swap();
+            std::swap(write, drawn);
+        }
+        else if (!holding) {
+            ring.hold();
+            std::memcpy(held, drawn, sizeof(held));
+            holding = true;
+        }
+        else {
+            ring.release();
+            holding = false;
+        }
+
+        if (std::memcmp(ring.ram, write, sizeof(write)) ||
+            std::memcmp(ring.frame(), holding ? held : drawn, sizeof(drawn)) ||
+            std::memcmp(ring.ready_ram(), drawn, sizeof(drawn))) {
+            std::printf("RamRing differs from the exchanged halves at round %d\n", r);
+            return false;
+        }
+    }
+    std::printf("RamRing: %d rounds match the exchanged halves\n", rounds);
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Dirty marking check
+//
+// The engine writes tile and text RAM at its 68000 addresses (0x10xxxx, 0x110xxx); each write
+// must mark only the entries it covers, or the cached layers are rebuilt in full.
+// ------------------------------------------------------------------------------------------------
+
+static bool expect_marked(const char* what, int marked, int expected)
+{
+    if (marked == expected)
+        return true;
+    std::printf("%s: %d entries marked dirty, expected %d\n", what, marked, expected);
+    return false;
+}
+
+static bool check_dirty()
+{
+    hwtiles* tiles = new hwtiles();
+    bool ok = true;
+
+    tiles->mark_dirty(0x10F3A5, 1);
+    ok = expect_marked("tile byte at 0x10F3A5", tiles->tile_dirty_count(), 1) && ok;
+    tiles->mark_dirty(0x10F3A5, 1);
+    ok = expect_marked("the same byte again", tiles->tile_dirty_count(), 1) && ok;
+    tiles->mark_dirty(0x10F3A6, 4);
+    ok = expect_marked("long at 0x10F3A6", tiles->tile_dirty_count(), 3) && ok;
+    tiles->mark_dirty(0x10FFFF, 1);
+    ok = expect_marked("last tile byte", tiles->tile_dirty_count(), 4) && ok;
+
+    tiles->mark_text_dirty(0x110BBC, 1);
+    ok = expect_marked("text byte at 0x110BBC", tiles->text_dirty_count(), 1) && ok;
+    tiles->mark_text_dirty(0x110BBE, 4);
+    ok = expect_marked("text long at 0x110BBE", tiles->text_dirty_count(), 3) && ok;
+    ok = expect_marked("tile entries after text writes", tiles->tile_dirty_count(), 4) && ok;
+
+    delete tiles;
+    if (ok)
+        std::printf("Dirty marking: tile and text writes mark only the entries written\n");
+    return ok;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Snapshot
+// ------------------------------------------------------------------------------------------------
+
+static bool read_snapshot(const std::string& filename, std::string& data, uint8_t* palette)
+{
+    std::ifstream in(filename, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    data = ss.str();
+
+    Video::SnapshotHeader header;
+    if (!in || data.size() < sizeof(header) + Video::SNAPSHOT_PALETTE) {
+        std::cerr << "Unable to read video snapshot " << filename << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != Video::SNAPSHOT_MAGIC || header.version != Video::SNAPSHOT_VERSION) {
+        std::cerr << filename << " is not a version " << Video::SNAPSHOT_VERSION << " video snapshot" << std::endl;
+        return false;
+    }
+    std::memcpy(palette, data.data() + sizeof(header), Video::SNAPSHOT_PALETTE);
+    std::cout << filename << ": captured in " << (header.hires ? "hi-res" : "lo-res")
+              << (header.widescreen ? " widescreen" : "") << " mode." << std::endl;
+    return true;
+}
+
+// Load the layer states, which follow the header and palette
+static bool load_layers(const std::string& data, hwtiles* tiles, hwsprites* sprites)
+{
+    std::istringstream in(data);
+    in.seekg(sizeof(Video::SnapshotHeader) + Video::SNAPSHOT_PALETTE);
+    if (!tiles->load_state(in) || !sprites->load_state(in) || !hwroad.load_state(in)) {
+        std::cerr << "Video snapshot is truncated" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Benchmarks
+// ------------------------------------------------------------------------------------------------
+
+struct BenchMode
+{
+    const char* name;
+    int hires;
+    int widescreen;
+};
+
+static const BenchMode modes[] = {
+    { "lores",      0, 0 },
+    { "lores-wide", 0, 1 },
+    { "hires",      1, 0 },
+    { "hires-wide", 1, 1 },
+};
+
+static const int ALIGNMENT_PIXELS = 64; // as Video::init
+
+// Set the S16 output size for a mode, as Video::set_video_mode does
+static void set_mode(const BenchMode& mode)
+{
+    config.video.hires      = mode.hires;
+    config.video.widescreen = mode.widescreen;
+    config.s16_width  = mode.widescreen ? S16_WIDTH_WIDE : S16_WIDTH;
+    config.s16_x_off  = mode.widescreen ? (S16_WIDTH_WIDE - S16_WIDTH) / 2 : 0;
+    config.s16_height = S16_HEIGHT;
+    if (mode.hires) {
+        config.s16_width  <<= 1;
+        config.s16_height <<= 1;
+    }
+}
+
+static bool run_mode(const BenchMode& mode, const std::string& snapshot, hwtiles* tiles, hwsprites* sprites,
+                     const BenchRenderer& renderer, const snes_ntsc_t* ntsc)
+{
+    set_mode(mode);
+    tiles->init(roms.tiles.rom, mode.hires != 0);
+    sprites->init(roms.sprites.rom);
+    hwroad.init(roms.road.rom, mode.hires != 0);
+    if (!load_layers(snapshot, tiles, sprites))
+        return false;
+    tiles->set_x_clamp(hwtiles::CENTRE);
+    sprites->set_x_clip(!mode.widescreen);
+
+    // latched for drawing, as at the start of a frame (Video::publish_frame)
+    sprites->hold_frame();
+    hwroad.hold_frame();
+    tiles->update_tile_values();
+
+    const int width  = config.s16_width;
+    const int height = config.s16_height;
+
+    // S16 image, with the slack the sprite renderer relies on either side of it
+    const size_t pixel_count = size_t(width) * (height + 2) + ALIGNMENT_PIXELS;
+    uint16_t* buffer = static_cast<uint16_t*>(::operator new(pixel_count * sizeof(uint16_t), std::align_val_t(64)));
+    std::memset(buffer, 0, pixel_count * sizeof(uint16_t));
+    uint16_t* pixels = buffer + ALIGNMENT_PIXELS;
+
+    // Layers, in the order Video::prepare_stage draws them
+    time_kernel(mode.name, "road_bg", [&] { (hwroad.*hwroad.render_background)(pixels, 0, height); });
+    time_kernel(mode.name, "tiles_bg", [&] {
+        tiles->update_tile_values();
+        tiles->render_tile_layer(pixels, 1, 0);
+    });
+    time_kernel(mode.name, "tiles_bg_full", [&] {
+        tiles->invalidate_layers();
+        tiles->update_tile_values();
+        tiles->render_tile_layer(pixels, 1, 0);
+    });
+    time_kernel(mode.name, "tiles_fg", [&] {
+        tiles->update_tile_values();
+        tiles->render_tile_layer(pixels, 0, 0);
+    });
+    time_kernel(mode.name, "road_fg", [&] { (hwroad.*hwroad.render_foreground)(pixels, 0, height); });
+    time_kernel(mode.name, "sprites", [&] { sprites->render(pixels, 8); });
+    time_kernel(mode.name, "sprites_packed", [&] {
+        config.video.sprite_list = 0;
+        sprites->render(pixels, 8);
+        config.video.sprite_list = 1;
+    });
+    time_kernel(mode.name, "text", [&] {
+        tiles->update_tile_values();
+        tiles->render_text_layer(pixels, 1);
+    });
+
+    // Redraw a complete frame, from a clear buffer, for the filter kernels to work on
+    std::memset(buffer, 0, pixel_count * sizeof(uint16_t));
+    (hwroad.*hwroad.render_background)(pixels, 0, height);
+    tiles->render_tile_layer(pixels, 1, 0);
+    tiles->render_tile_layer(pixels, 0, 0);
+    (hwroad.*hwroad.render_foreground)(pixels, 0, height);
+    sprites->render(pixels, 8);
+    tiles->render_text_layer(pixels, 1);
+    add_hash(mode.name, "frame", pixels, size_t(width) * height * sizeof(uint16_t));
+
+    // Blargg NTSC filter. The output width follows RenderSurface::init_blargg_filter.
+    int out_width;
+    if (mode.hires) {
+#if SNES_NTSC_HAVE_SIMD
+        out_width = SNES_NTSC_OUT_WIDTH_SIMD(width);
+#else
+        out_width = SNES_NTSC_OUT_WIDTH(width >> 1);
+        while (SNES_NTSC_IN_WIDTH(out_width) < unsigned(width >> 1)) out_width++;
+#endif
+    } else {
+        out_width = SNES_NTSC_OUT_WIDTH(width);
+        while (SNES_NTSC_IN_WIDTH(out_width) < unsigned(width)) out_width++;
+    }
+    const size_t out_count = size_t(out_width) * height;
+    uint32_t* rgb = static_cast<uint32_t*>(::operator new(out_count * sizeof(uint32_t), std::align_val_t(64)));
+    const long out_pitch = long(out_width) << 2;
+    const size_t out_bytes = out_count * sizeof(uint32_t);
+
+    // Each blitter writes the whole output, so it is hashed after its timed runs
+    auto blargg = [&] {
+        if (mode.hires)
+            snes_ntsc_blit_hires(ntsc, pixels, renderer.blargg_palette(), width, 0, width, height,
+                                 rgb, out_pitch, 255);
+        else
+            snes_ntsc_blit(ntsc, pixels, renderer.blargg_palette(), width, 0, width, height,
+                           rgb, out_pitch, 255);
+    };
+    time_kernel(mode.name, mode.hires ? "blargg_hires" : "blargg", blargg);
+    add_hash(mode.name, mode.hires ? "blargg_hires" : "blargg", rgb, out_bytes);
+#if SNES_NTSC_HAVE_SIMD
+    if (mode.hires) {
+        time_kernel(mode.name, "blargg_hires_fast", [&] {
+            snes_ntsc_blit_hires_fast(ntsc, pixels, renderer.blargg_palette(), width, 0, width, height,
+                                      rgb, out_pitch, 255, 0, 0);
+        });
+        add_hash(mode.name, "blargg_hires_fast", rgb, out_bytes);
+        time_kernel(mode.name, "blargg_hires_scan", [&] {
+            snes_ntsc_blit_hires_fast(ntsc, pixels, renderer.blargg_palette(), width, 0, width, height,
+                                      rgb, out_pitch, 255, 2, 0);
+        });
+        add_hash(mode.name, "blargg_hires_scan", rgb, out_bytes);
+    }
+#endif
+
+    // Scanlines over the filter output (RGBA, R in the low byte) and over the RGB555 image the
+    // unfiltered path draws, with the shifts RenderSurface::draw_frame uses. These work in
+    // place, so for the hash they are applied once more to fresh input.
+    auto scanlines_rgba = [&] { apply_scanlines(rgb, out_width, height, 2, 0, 8, 16, 24, 0, height); };
+    time_kernel(mode.name, "scanlines_rgba", scanlines_rgba);
+    blargg();
+    scanlines_rgba();
+    add_hash(mode.name, "scanlines_rgba", rgb, out_bytes);
+
+    std::vector<uint16_t> rgb555(size_t(width) * height);
+    const uint16_t* lookup = renderer.rgb555_palette();
+    auto convert_rgb555 = [&] {
+        for (size_t i = 0; i < rgb555.size(); i++)
+            rgb555[i] = lookup[pixels[i]];
+    };
+    auto scanlines_rgb555 = [&] { apply_scanlines(rgb555.data(), width, height, 2, 1, 6, 11, 0, 0, height); };
+    convert_rgb555();
+    time_kernel(mode.name, "scanlines_rgb555", scanlines_rgb555);
+    convert_rgb555();
+    scanlines_rgb555();
+    add_hash(mode.name, "scanlines_rgb555", rgb555.data(), rgb555.size() * sizeof(uint16_t));
+
+    ::operator delete(rgb, std::align_val_t(64));
+    ::operator delete(buffer, std::align_val_t(64));
+    sprites->release_frame();
+    hwroad.release_frame();
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string record_file, check_file;
+    std::vector<std::string> args;
+    bool iterations_set = false;
+    int  ramring_rounds = 0;
+    bool dirty_check    = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = std::max(std::atoi(argv[++i]), 0);
+            iterations_set = true;
+        }
+        else if (std::strcmp(argv[i], "-record") == 0 && i + 1 < argc)
+            record_file = argv[++i];
+        else if (std::strcmp(argv[i], "-check") == 0 && i + 1 < argc)
+            check_file = argv[++i];
+        else if (std::strcmp(argv[i], "-ramring") == 0 && i + 1 < argc)
+            ramring_rounds = std::max(std::atoi(argv[++i]), 1);
+        else if (std::strcmp(argv[i], "-dirty") == 0)
+            dirty_check = true;
+        else
+            args.push_back(argv[i]);
+    }
+    if (ramring_rounds || dirty_check) {
+        if (ramring_rounds && !check_ramring(ramring_rounds))
+            return 1;
+        if (dirty_check && !check_dirty())
+            return 1;
+        if (args.empty())
+            return 0;
+    }
+    if (args.size() < 2) {
+        std::cerr << "Usage: cannonball-bench [-n iterations] [-record file | -check file] rom_path snapshot...\n"
+                     "       cannonball-bench -ramring n | -dirty\n\n"
+                     "Create a snapshot with: cannonball-se -benchmark n -snapshot file (or F10 in game)" << std::endl;
+        return 1;
+    }
+    if (!iterations_set && (!record_file.empty() || !check_file.empty()))
+        iterations = 0;
+
+    config.data.rom_path = args[0];
+    config.video.sprite_list = 1;  // as the game's default
+    if (!config.data.rom_path.empty() && config.data.rom_path.back() != '/')
+        config.data.rom_path += '/';
+
+    if (!roms.load_revb_roms(false)) {
+        std::cerr << "Unable to load the OutRun ROMs from " << config.data.rom_path << std::endl;
+        return 1;
+    }
+
+    BenchRenderer* renderer = new BenchRenderer();
+    renderer->set_shadow_intensity(shadow::ORIGINAL);
+    renderer->init_palette(100, 100, 100);
+
+    // The filter table is large, so it's built once for all modes
+    snes_ntsc_t* ntsc = static_cast<snes_ntsc_t*>(std::malloc(sizeof(snes_ntsc_t)));
+    if (!ntsc) {
+        std::cerr << "Blargg filter table allocation failed.\n";
+        return 1;
+    }
+    snes_ntsc_init(ntsc, &snes_ntsc_composite);
+
+    hwtiles*   tiles   = new hwtiles();
+    hwsprites* sprites = new hwsprites();
+
+    bool ok = true;
+    for (size_t s = 1; s < args.size(); s++) {
+        std::string snapshot;
+        alignas(64) static uint8_t palette[Video::SNAPSHOT_PALETTE];
+        if (!read_snapshot(args[s], snapshot, palette)) {
+            ok = false;
+            continue;
+        }
+        snapshot_name = args[s].substr(args[s].find_last_of("/\\") + 1);
+
+        // Palette lookups, as flush_palette() builds them
+        renderer->convert_palette_range(palette, 0, S16_PALETTE_ENTRIES);
+
+        if (iterations > 0)
+            std::printf("\n%-11s %-18s %10s %10s %10s\n", "mode", "kernel", "min us", "median us", "mean us");
+        for (const BenchMode& mode : modes)
+            ok = run_mode(mode, snapshot, tiles, sprites, *renderer, ntsc) && ok;
+    }
+
+    if (ok && !record_file.empty())
+        ok = record_golden(record_file);
+    if (ok && !check_file.empty())
+        ok = check_golden(check_file);
+
+    delete sprites;
+    delete tiles;
+    delete renderer;
+    std::free(ntsc);
+    return ok ? 0 : 1;
+}
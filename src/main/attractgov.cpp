@@ -0,0 +1,123 @@
+/***************************************************************************
+    Attract Mode Governor.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include "attractgov.hpp"
+#include "frontend/config.hpp"
+
+static const char*    TEMP_FILE      = "/sys/class/thermal/thermal_zone0/temp";         // milli-degrees C
+static const char*    THROTTLE_FILE  = "/sys/devices/platform/soc/soc:firmware/get_throttled"; // Pi firmware
+static const unsigned THROTTLED_NOW  = 0xE;  // frequency capped, throttled, soft temperature limit
+static const int      HOT_HYSTERESIS = 5;    // degrees C under attract_temp before it's no longer hot
+static const int      UNKNOWN        = -1000;
+
+enum { FULL, IDLE, HOT };
+
+static std::atomic<int>      temperature{UNKNOWN};
+static std::atomic<unsigned> throttled{0};
+
+static int  level    = FULL;
+static bool fps_down = false;
+static int  saved_fps, saved_bloom, saved_hiresprites, saved_noise;
+static std::chrono::steady_clock::time_point last_input = std::chrono::steady_clock::now();
+
+void attractgov::poll()
+{
+#ifdef __linux__
+    int milli = 0;
+    std::ifstream temp(TEMP_FILE);
+    temperature.store((temp >> milli) ? milli / 1000 : UNKNOWN, std::memory_order_relaxed);
+
+    unsigned flags = 0;
+    std::ifstream throttle(THROTTLE_FILE);
+    throttled.store((throttle >> std::hex >> flags) ? flags : 0, std::memory_order_relaxed);
+#endif
+}
+
+static bool hot()
+{
+    if (throttled.load(std::memory_order_relaxed) & THROTTLED_NOW)
+        return true;
+    const int limit = config.video.attract_temp - (level == HOT ? HOT_HYSTERESIS : 0);
+    return config.video.attract_temp > 0 && temperature.load(std::memory_order_relaxed) >= limit;
+}
+
+static void effects_down()
+{
+    video_settings_t& v = config.video;
+    saved_bloom       = v.crt_bloom;
+    saved_hiresprites = v.hiresprites;
+    saved_noise       = v.noise;
+    v.crt_bloom = v.hiresprites = v.noise = 0;
+}
+
+static void effects_up()
+{
+    video_settings_t& v = config.video;
+    v.crt_bloom   = saved_bloom;
+    v.hiresprites = saved_hiresprites;
+    v.noise       = saved_noise;
+}
+
+void attractgov::tick(bool attract, bool input, bool lock_fps)
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (!attract || input || config.video.attract_idle <= 0)
+    {
+        last_input = now;
+        restore_all();
+        return;
+    }
+    if (now - last_input < std::chrono::seconds(config.video.attract_idle))
+        return;
+
+    if (level == FULL)
+    {
+        if (!lock_fps && config.fps == 60)
+        {
+            saved_fps = config.video.fps;
+            config.set_fps(0);
+            fps_down = true;
+        }
+        level = IDLE;
+        printf("\nAttract mode idle: running at %d FPS.\n", config.fps);
+    }
+
+    const bool is_hot = hot();
+    if (is_hot && level == IDLE)
+    {
+        effects_down();
+        level = HOT;
+        printf("\nAttract mode: SoC hot or throttled, turning effects down.\n");
+    }
+    else if (!is_hot && level == HOT)
+    {
+        effects_up();
+        level = IDLE;
+        printf("\nAttract mode: SoC cooled, restoring effects.\n");
+    }
+}
+
+void attractgov::restore_all()
+{
+    if (level == FULL)
+        return;
+    if (level == HOT)
+        effects_up();
+    if (fps_down)
+        config.set_fps(saved_fps);
+    fps_down = false;
+    level    = FULL;
+}
+
+bool attractgov::holding_fps() { return fps_down; }
+
+int      attractgov::soc_temperature() { return temperature.load(std::memory_order_relaxed); }
+unsigned attractgov::throttle_flags()  { return throttled.load(std::memory_order_relaxed); }
@@ -0,0 +1,45 @@
+/***************************************************************************
+    Attract Mode Governor.
+
+    A cabinet spends most of its day in attract mode, and a fanless one
+    can spend it hot enough to throttle, leaving the first player of the
+    evening a machine running slow. Once the attract mode has gone
+    video.attract_idle seconds without a control being touched, the
+    governor turns things down:
+
+      1. Idle: 30fps (unless the rate is locked on the command line)
+      2. Hot: also CRT bloom, hi-res sprites and shader noise off, while
+         the SoC is at video.attract_temp or over, or is being throttled
+
+    None of these restart the video, so a coin, start or any other control
+    puts everything back for the next frame. The temperature and throttle
+    flags are read from sysfs every few seconds, by the stats thread.
+
+    The settings chosen in the menus are always what's saved: everything
+    is put back as the attract mode ends, and before the config is written.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+namespace attractgov
+{
+    // Every few seconds, from a background thread: read the SoC temperature and throttle flags
+    void poll();
+
+    // Once a frame, on the main loop: attract is whether the engine is in its attract mode, input
+    // whether a control was pressed since the last call. lock_fps leaves the frame rate alone.
+    void tick(bool attract, bool input, bool lock_fps);
+
+    // Put everything back, at once
+    void restore_all();
+
+    // The governor has the frame rate down (auto 30/60fps waits meanwhile)
+    bool holding_fps();
+
+    // As last polled: SoC degrees C (below -273 if unknown), and the Pi firmware's throttle flags
+    int      soc_temperature();
+    unsigned throttle_flags();
+}
@@ -0,0 +1,315 @@
+/***************************************************************************
+    Batch Renderer.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include "batchrender.hpp"
+#include "globals.hpp"
+#include "jobsystem.hpp"
+#include "video.hpp"
+#include "frontend/config.hpp"
+#include "sdl2/renderbase.hpp"
+#include "sdl2/snes_ntsc.h"
+
+static const size_t PALETTE_BYTES = S16_PALETTE_ENTRIES * 2;
+
+// Palette conversion, as the SDL2 renderer does it, without a display
+class Converter : public RenderBase
+{
+public:
+    bool init(int, int, int, int, int) { return true; }
+    void swap_buffers()                 {}
+    void disable()                      {}
+    bool start_frame()                  { return true; }
+    bool finalize_frame()               { return true; }
+    void draw_frame(uint16_t*, int, int) {}
+
+    const uint8_t (*rgba8_palette() const)[4] { return s16_rgba8; }
+    const uint16_t* blargg_palette() const     { return rgb_blargg; }
+};
+
+// A frame from capture until it is written. Each has its own palette, so that any number can
+// be converted at once.
+struct Slot
+{
+    Converter             converter;
+    JobCounter            job;
+    bool                  queued = false;
+    uint32_t              frame;
+    int                   width, height, fps;
+    int                   out_width;
+    std::vector<uint16_t> pixels;
+    uint8_t               palette[PALETTE_BYTES];
+    std::vector<uint32_t> filtered;   // Blargg output, R,G,B,A bytes
+    std::vector<uint8_t>  rgb;
+};
+
+static std::vector<std::unique_ptr<Slot>> slots;
+static bool                 active = false;
+static snes_ntsc_t*         ntsc   = nullptr;   // null without the Blargg filter
+static FILE*                out    = nullptr;   // raw RGB24; null for an image sequence
+static std::string          out_path;
+static bool                 sequence = false;
+static bool                 failed   = false;
+static uint32_t             frame_no = 0, written = 0, other_size = 0;
+static int                  out_width = 0, out_height = 0;
+static std::vector<uint8_t> last;              // the last frame written
+static FILE*                frames_stdout = nullptr;
+
+static snes_ntsc_t* build_filter()
+{
+    snes_ntsc_setup_t setup;
+    switch (config.video.blargg)
+    {
+        case video_settings_t::BLARGG_SVIDEO: setup = snes_ntsc_svideo;    break;
+        case video_settings_t::BLARGG_RGB:    setup = snes_ntsc_rgb;       break;
+        default:                              setup = snes_ntsc_composite; break;
+    }
+    setup.merge_fields = 0;
+    setup.hue        = double(config.video.hue) / 100;
+    setup.saturation = double(config.video.saturation) / 100;
+    setup.contrast   = double(config.video.contrast) / 100;
+    setup.brightness = double(config.video.brightness) / 100;
+    setup.sharpness  = double(config.video.sharpness) / 100;
+    setup.gamma      = double(config.video.gamma) / 10;
+    setup.resolution = double(config.video.resolution) / 100;
+
+    snes_ntsc_t* table = (snes_ntsc_t*) malloc(sizeof(snes_ntsc_t));
+    if (table)
+        snes_ntsc_init(table, &setup);
+    return table;
+}
+
+// Width of the filter's output for a frame width, as RenderSurface works it out
+static int filtered_width(int width)
+{
+    if (config.video.hires)
+    {
+#if SNES_NTSC_HAVE_SIMD
+        return SNES_NTSC_OUT_WIDTH_SIMD(width);
+#else
+        width >>= 1;
+#endif
+    }
+    int w = SNES_NTSC_OUT_WIDTH(width);
+    while (SNES_NTSC_IN_WIDTH(w) < width)
+        w++;
+    return w;
+}
+
+// On a frame job worker
+static void convert(Slot& s)
+{
+    s.converter.convert_palette_range(s.palette, 0, S16_PALETTE_ENTRIES);
+    const size_t count = size_t(s.width) * s.height;
+
+    if (!ntsc)
+    {
+        s.out_width = s.width;
+        s.rgb.resize(count * 3);
+        const uint8_t (*rgba)[4] = s.converter.rgba8_palette();
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint8_t* c = rgba[s.pixels[i] & (S16_PALETTE_ENTRIES * 2 - 1)];
+            s.rgb[i * 3 + 0] = c[0];
+            s.rgb[i * 3 + 1] = c[1];
+            s.rgb[i * 3 + 2] = c[2];
+        }
+        return;
+    }
+
+    // The burst phase goes round once every three frames at 60 fps, twice as fast at 30
+    const int phase = int((uint64_t(s.frame) * (s.fps == 60 ? 1 : 2)) % snes_ntsc_burst_count);
+    s.out_width = filtered_width(s.width);
+    s.filtered.resize(size_t(s.out_width) * s.height + 64); // the SIMD blitter may write a little over
+    if (config.video.hires)
+    {
+#if SNES_NTSC_HAVE_SIMD
+        snes_ntsc_blit_hires_fast(ntsc, s.pixels.data(), s.converter.blargg_palette(), s.width, phase, s.width,
+                                  s.height, s.filtered.data(), long(s.out_width) * 4, 255, 0, 0);
+#else
+        snes_ntsc_blit_hires(ntsc, s.pixels.data(), s.converter.blargg_palette(), s.width, phase, s.width,
+                             s.height, s.filtered.data(), long(s.out_width) * 4, 255);
+#endif
+    }
+    else
+    {
+        snes_ntsc_blit(ntsc, s.pixels.data(), s.converter.blargg_palette(), s.width, phase, s.width,
+                       s.height, s.filtered.data(), long(s.out_width) * 4, 255);
+    }
+
+    const size_t out_count = size_t(s.out_width) * s.height;
+    s.rgb.resize(out_count * 3);
+    const uint8_t* c = reinterpret_cast<const uint8_t*>(s.filtered.data());
+    for (size_t i = 0; i < out_count; i++, c += 4)
+    {
+        s.rgb[i * 3 + 0] = c[0];
+        s.rgb[i * 3 + 1] = c[1];
+        s.rgb[i * 3 + 2] = c[2];
+    }
+}
+
+static bool write_image(const std::vector<uint8_t>& rgb, uint32_t frame)
+{
+    if (!sequence)
+        return std::fwrite(rgb.data(), 1, rgb.size(), out) == rgb.size();
+
+    char name[1024];
+    snprintf(name, sizeof(name), out_path.c_str(), unsigned(frame));
+    FILE* f = std::fopen(name, "wb");
+    if (!f)
+        return false;
+    std::fprintf(f, "P6\n%d %d\n255\n", out_width, out_height);
+    const bool ok = std::fwrite(rgb.data(), 1, rgb.size(), f) == rgb.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+// On the game thread, in frame order
+static void write_frame(Slot& s)
+{
+    jobsystem.wait(s.job);
+    s.queued = false;
+    if (failed)
+        return;
+
+    if (!out_width)
+    {
+        out_width  = s.out_width;
+        out_height = s.height;
+        std::cerr << "batchrender: writing " << out_width << "x" << out_height << " RGB24 at " << s.fps
+                  << " fps to " << out_path << std::endl;
+    }
+    // A frame of another size (after a change of video mode) is shown as the frame before
+    const bool same = s.out_width == out_width && s.height == out_height;
+    if (!same)
+        other_size++;
+    if (!same && last.empty())
+        return;
+    if (!write_image(same ? s.rgb : last, written))
+    {
+        std::cerr << "batchrender: unable to write " << out_path << std::endl;
+        failed = true;
+        return;
+    }
+    written++;
+    if (same)
+        last.swap(s.rgb);
+}
+
+FILE* batchrender::claim_stdout()
+{
+    if (frames_stdout)
+        return frames_stdout;
+#ifndef _WIN32
+    std::cout.flush();
+    std::fflush(stdout);
+    const int fd = dup(STDOUT_FILENO);
+    frames_stdout = fd >= 0 ? fdopen(fd, "wb") : nullptr;
+    if (frames_stdout)
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+#else
+    frames_stdout = stdout;
+#endif
+    return frames_stdout;
+}
+
+bool batchrender::start(const std::string& path)
+{
+    stop();
+    sequence = path.find('%') != std::string::npos;
+    if (path == "-")
+        out = claim_stdout();
+    else if (!sequence)
+        out = std::fopen(path.c_str(), "wb");
+    if (!sequence && !out)
+    {
+        std::cerr << "batchrender: unable to write " << path << std::endl;
+        return false;
+    }
+
+    ntsc = nullptr;
+    if (config.video.blargg && !(ntsc = build_filter()))
+        std::cerr << "batchrender: Blargg filter table allocation failed; writing unfiltered frames" << std::endl;
+
+    // Enough frames in hand for every worker to be converting one while the game prepares more
+    const size_t count = size_t(2 * (jobsystem.worker_count() + 1));
+    slots.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        slots.push_back(std::make_unique<Slot>());
+        slots.back()->converter.init_palette(100, 100, 100);
+        slots.back()->converter.set_shadow_intensity(config.video.shadow == 0 ? shadow::ORIGINAL : shadow::MAME);
+    }
+
+    out_path  = path == "-" ? "stdout" : path;
+    frame_no  = written = other_size = 0;
+    out_width = out_height = 0;
+    failed    = false;
+    last.clear();
+    active    = true;
+    return true;
+}
+
+void batchrender::capture(const uint16_t* pixels, int width, int height, int fps, const uint8_t* palette)
+{
+    if (!active)
+        return;
+
+    const uint32_t frame = frame_no++;
+    Slot& s = *slots[frame % slots.size()];
+    if (s.queued)
+        write_frame(s);
+
+    s.frame  = frame;
+    s.width  = width;
+    s.height = height;
+    s.fps    = fps;
+    s.pixels.resize(size_t(width) * height);
+    std::memcpy(s.pixels.data(), pixels, s.pixels.size() * sizeof(uint16_t));
+    std::memcpy(s.palette, palette, PALETTE_BYTES);
+    s.queued = true;
+    jobsystem.submit(s.job, [&s] { convert(s); });
+}
+
+bool batchrender::rendering()
+{
+    return active;
+}
+
+void batchrender::stop()
+{
+    if (!active)
+        return;
+    active = false;
+
+    const uint32_t queued = std::min<uint32_t>(frame_no, uint32_t(slots.size()));
+    for (uint32_t f = frame_no - queued; f != frame_no; f++)
+        write_frame(*slots[f % slots.size()]);
+
+    if (out && std::fflush(out) != 0 && !failed)
+        std::cerr << "batchrender: unable to write " << out_path << std::endl;
+    if (out && out != frames_stdout)
+        std::fclose(out);
+    out = nullptr;
+    // Every slot's job has been waited on, and the job system is done with a counter from then
+    slots.clear();
+    free(ntsc);
+    ntsc = nullptr;
+
+    std::cerr << "batchrender: " << written << " frames to " << out_path;
+    if (other_size)
+        std::cerr << " (" << other_size << " of another size shown as the frame before)";
+    std::cerr << std::endl;
+}
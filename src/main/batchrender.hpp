@@ -0,0 +1,53 @@
+/***************************************************************************
+    Batch Renderer.
+
+    Renders a session to video without a display ("cannonball-se -playback
+    log -render out"): the engine runs as fast as it can, each frame the
+    prepare stages finish is converted to RGB24, and the frames are
+    written in order to one of:
+
+      -                         raw RGB24 on stdout, for an encoder:
+                                ... -render - | ffmpeg -f rawvideo
+                                -pix_fmt rgb24 -s 320x224 -r 60 -i - out.mp4
+      a path with a % in it     an image sequence, one PPM a frame, the
+                                frame number put in with printf (%06d.ppm)
+      any other path            raw RGB24, as on stdout
+
+    The size and rate to give an encoder are printed on start. With
+    video.blargg on, frames go through the CPU Blargg NTSC filter (at the
+    filter's output width), with the burst phase the display would have
+    had; the GPU shaders, scanlines and CRT effects are not applied.
+
+    The game has one set of video layers, so the frames are prepared in
+    turn on the game thread. What follows is the same for any frame given
+    its pixels and palette, so the conversion and filter of each frame are
+    a job of their own, and the frame job workers take several frames at
+    once while the game runs on.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace batchrender
+{
+    // Give stdout over to the frames, from before anything is printed: what the game prints goes
+    // to stderr from then on. Returns the frames' stream (null on failure).
+    FILE* claim_stdout();
+
+    // Start writing to path (see above)
+    bool start(const std::string& path);
+
+    // From Video, as each frame is complete: queue it; waits if the writer has fallen behind
+    void capture(const uint16_t* pixels, int width, int height, int fps, const uint8_t* palette);
+
+    bool rendering();
+
+    // Write the frames still queued, and close
+    void stop();
+}
@@ -0,0 +1,105 @@
+/***************************************************************************
+    Start-up Profile.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "bootprof.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+struct Span
+{
+    const char* name;
+    int         depth;
+    double      start_ms, end_ms;
+};
+
+static const clock_type::time_point start = clock_type::now();   // at static initialisation
+static std::vector<Span>  spans;
+static int                depth = 0;
+static bool               bench_mode = false;
+static std::string        trace_path;
+static std::atomic<bool>  reported{false};
+
+static double elapsed_ms()
+{
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+// Phases after the summary (a video restart, say) aren't kept
+bootprof::Phase::Phase(const char* name) : index(-1)
+{
+    if (reported.load(std::memory_order_relaxed))
+        return;
+    index = int(spans.size());
+    spans.push_back({ name, depth++, elapsed_ms(), 0.0 });
+}
+
+void bootprof::Phase::end()
+{
+    if (index < 0)
+        return;
+    spans[index].end_ms = elapsed_ms();
+    depth--;
+    index = -1;
+}
+
+void bootprof::bench(const std::string& trace_file)
+{
+    bench_mode = true;
+    trace_path = trace_file;
+}
+
+bool bootprof::benchmarking()
+{
+    return bench_mode;
+}
+
+static void write_trace(const std::string& path)
+{
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Start-up: unable to write " << path << std::endl;
+        return;
+    }
+    out << "{\"traceEvents\":[\n";
+    char line[160];
+    for (size_t i = 0; i < spans.size(); i++) {
+        const Span& s = spans[i];
+        snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.0f,\"dur\":%.0f}%s\n",
+                 s.name, s.start_ms * 1000.0, (s.end_ms - s.start_ms) * 1000.0, i + 1 < spans.size() ? "," : "");
+        out << line;
+    }
+    out << "]}\n";
+    std::cout << "Start-up: trace written to " << path << std::endl;
+}
+
+bool bootprof::ready(const char* reached)
+{
+    if (reported.load(std::memory_order_relaxed) || reported.exchange(true))
+        return false;
+
+    const double total = elapsed_ms();
+    char line[96];
+    snprintf(line, sizeof(line), "\n  %-24s %8s %8s\n", "Start-up phase", "at ms", "took ms");
+    std::cout << line;
+    for (const Span& s : spans) {
+        snprintf(line, sizeof(line), "  %*s%-*s %8.1f %8.1f\n", s.depth * 2, "", 24 - s.depth * 2, s.name,
+                 s.start_ms, s.end_ms - s.start_ms);
+        std::cout << line;
+    }
+    snprintf(line, sizeof(line), "Start-up: %s reached in %.1fms\n", reached, total);
+    std::cout << line;
+
+    if (bench_mode && !trace_path.empty())
+        write_trace(trace_path);
+    return bench_mode;
+}
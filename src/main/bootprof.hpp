@@ -0,0 +1,45 @@
+/***************************************************************************
+    Start-up Profile.
+
+    Times the phases of start-up (config and ROM loading, SDL, the video
+    set-up with its graphics conversion, Blargg tables, GL and overlay, the
+    controls, menus, audio, and the engine's boot) from the start of the
+    process. When the attract mode (or the menu) is first reached, a summary
+    is printed: each phase, nested as it ran, when it started and how long
+    it took, and the total time to get there.
+
+    -startup-bench leaves once the attract mode is reached, optionally
+    writing the phases as Chrome Trace Event JSON, so that the time to
+    attract can be compared across builds and boards.
+
+    The phases all run before the game loop starts, or on it, one at a time,
+    so they are kept without locks.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <string>
+
+namespace bootprof
+{
+    // Times the enclosing scope (or up to end()) as a start-up phase, within any phase already
+    // running
+    struct Phase
+    {
+        explicit Phase(const char* name);
+        ~Phase() { end(); }
+        void end();
+        int index;
+    };
+
+    // Leave at the attract mode (see ready), writing the phases to trace_file if not empty
+    void bench(const std::string& trace_file);
+    bool benchmarking();
+
+    // Reached the attract mode, or the menu: print the summary, once. Returns true if the
+    // start-up benchmark is done and the game should quit.
+    bool ready(const char* reached);
+}
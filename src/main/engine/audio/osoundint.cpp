@@ -11,6 +11,7 @@
     James Pearce (C) 2025 - Removed dependency on FPS
 ***************************************************************************/
 
+#include <algorithm>
 #include "engine/outrun.hpp"
 #include "engine/audio/osound.hpp"
 #include "engine/audio/osoundint.hpp"
@@ -32,16 +33,20 @@ OSoundInt::~OSoundInt()
 void OSoundInt::init()
 {
     // JJP - init only when first called
+    // The chips run at sound.chip_rate when set, and Audio resamples their output
+    const int chip_rate = config.sound.chip_rate > 0 ? config.sound.chip_rate : config.sound.rate;
     if (pcm == NULL) {
         pcm = new SegaPCM(SOUND_CLOCK, &roms.pcm, pcm_ram, SegaPCM::BANK_512);
-        pcm->init(config.sound.rate);
+        pcm->init(chip_rate);
     }
 
     if (ym == NULL) {
         ym = new YM2151(0.5f, SOUND_CLOCK);
-        ym->init(config.sound.rate);
+        ym->init(chip_rate);
     }
 
+    pcm->set_glide(config.sound.smooth_engine ? ENGINE_CHANNELS : 0);
+
     reset();
 
     // Clear PCM Chip RAM
@@ -49,7 +54,10 @@ void OSoundInt::init()
         pcm_ram[i] = 0;
 
     for (uint8_t i = 0; i < 8; i++)
-        engine_data[i] = 0;
+        engine_data[i] = osound.engine_data[i] = 0;
+
+    glide     = {};
+    glide_due = ticks_played.load(std::memory_order_relaxed);
 
     osound.init(ym, pcm_ram);
 }
@@ -59,9 +67,7 @@ void OSoundInt::init()
 void OSoundInt::reset()
 {
     sound_counter = 0;
-    sound_head    = 0;
-    sound_tail    = 0;
-    sounds_queued = 0;
+    queue_clear();
 
     audio_ticks = 0;
 }
@@ -70,6 +76,7 @@ void OSoundInt::tick()
 {
     play_queued_sound();
     osound.tick();
+    tick_count++;
 }
 
 // ----------------------------------------------------------------------------
@@ -81,36 +88,89 @@ void OSoundInt::tick()
 // Source: 0x564E
 void OSoundInt::play_queued_sound()
 {
+    // skip anything cleared (or everything, before boot)
+    uint32_t head       = sound_head.load(std::memory_order_relaxed);
+    const uint32_t tail = sound_tail.load(std::memory_order_acquire);
+    const uint32_t skip = has_booted ? sound_clear.load(std::memory_order_acquire) : tail;
+    if (int32_t(skip - head) > 0)
+        head = skip;
+
     if (!has_booted)
     {
-        sound_head = 0;
-        sounds_queued = 0;
+        sound_head.store(head, std::memory_order_release);
         return;
     }
 
-    // Process the lot in one go.
-    for (int counter = 0; counter < 8; counter++)
+    // Process queued sound, once it's due
+    const queued_sound_t& next = queue[head & QUEUE_LENGTH];
+    if (head != tail && int32_t(tick_count - next.due) >= 0)
     {
-        // Process queued sound
-        if (counter == 0)
-        {
-            if (sounds_queued != 0)
-            {
-                osound.command_input = queue[sound_head];
-                sound_head = (sound_head + 1) & QUEUE_LENGTH;
-                sounds_queued--;
-            }
-            else
-            {
-                osound.command_input = sound::RESET;
-            }
-        }
-        // Process player engine sounds and passing traffic
-        else
-        {
-            osound.engine_data[counter] = engine_data[counter];
-        }
+        osound.command_input = next.snd;
+        head++;
     }
+    else
+    {
+        osound.command_input = sound::RESET;
+    }
+    sound_head.store(head, std::memory_order_release);
+
+    // Process player engine sounds and passing traffic
+    play_engine();
+}
+
+// Engine data for this sound tick
+void OSoundInt::play_engine()
+{
+    if (!config.sound.smooth_engine)
+    {
+        for (int i = 1; i < 8; i++)
+            osound.engine_data[i] = engine_data[i];
+        return;
+    }
+
+    // Each stamp falling due starts a glide from where the last had got to, over the time between
+    // the two stamps: one logic tick, as the sound ticks have it. The traffic data isn't glided.
+    uint32_t head       = engine_head.load(std::memory_order_relaxed);
+    const uint32_t tail = engine_tail.load(std::memory_order_acquire);
+    for (; head != tail && int32_t(tick_count - engine_queue[head & ENGINE_QUEUE_LENGTH].due) >= 0; head++)
+    {
+        const engine_event_t& e = engine_queue[head & ENGINE_QUEUE_LENGTH];
+        glide.pitch_from = (osound.engine_data[sound::ENGINE_PITCH_H] << 8) | osound.engine_data[sound::ENGINE_PITCH_L];
+        glide.vol_from   = osound.engine_data[sound::ENGINE_VOL];
+        glide.pitch_to   = (e.data[sound::ENGINE_PITCH_H] << 8) | e.data[sound::ENGINE_PITCH_L];
+        glide.vol_to     = e.data[sound::ENGINE_VOL];
+        glide.start      = tick_count;
+        const uint32_t gap = e.due - glide_due;
+        glide.length     = gap >= 1 && gap <= GLIDE_MAX ? gap : 1;
+        glide_due        = e.due;
+        for (int i = sound::TRAFFIC1; i < 8; i++)
+            osound.engine_data[i] = e.data[i];
+    }
+    engine_head.store(head, std::memory_order_release);
+
+    // Reaches the stamp's values on the last tick of the glide
+    const int32_t len = std::max<int32_t>(glide.length, 1);
+    const int32_t pos = std::min<int32_t>(int32_t(tick_count - glide.start) + 1, len);
+    const uint16_t pitch = glide.pitch_from + (int32_t(glide.pitch_to) - glide.pitch_from) * pos / len;
+    osound.engine_data[sound::ENGINE_PITCH_H] = pitch >> 8;
+    osound.engine_data[sound::ENGINE_PITCH_L] = pitch & 0xFF;
+    osound.engine_data[sound::ENGINE_VOL]     = glide.vol_from + (int32_t(glide.vol_to) - glide.vol_from) * pos / len;
+}
+
+// Stamp the engine data with the tick it's to be heard on. Runs on the game thread.
+void OSoundInt::engine_update()
+{
+    if (!has_booted || !config.sound.smooth_engine)
+        return;
+
+    const uint32_t tail = engine_tail.load(std::memory_order_relaxed);
+    if (tail - engine_head.load(std::memory_order_acquire) > ENGINE_QUEUE_LENGTH)
+        return;
+
+    engine_event_t& e = engine_queue[tail & ENGINE_QUEUE_LENGTH];
+    std::copy(engine_data, engine_data + 8, e.data);
+    e.due = ticks_played.load(std::memory_order_relaxed) + ticks_ahead.load(std::memory_order_relaxed);
+    engine_tail.store(tail + 1, std::memory_order_release);
 }
 
 // Queue a sound in service mode
@@ -149,14 +209,17 @@ void OSoundInt::queue_sound(uint8_t snd)
 
 void OSoundInt::add_to_queue(uint8_t snd)
 {
-    // Add sound to the tail end of the queue
-    queue[sound_tail] = snd;
-    sound_tail = (sound_tail + 1) & QUEUE_LENGTH;
-    sounds_queued++;
+    // Add sound to the tail end of the queue, unless it's full
+    const uint32_t tail = sound_tail.load(std::memory_order_relaxed);
+    if (tail - sound_head.load(std::memory_order_acquire) > QUEUE_LENGTH)
+        return;
+
+    queue[tail & QUEUE_LENGTH] = { snd, ticks_played.load(std::memory_order_relaxed) +
+                                        ticks_ahead.load(std::memory_order_relaxed) };
+    sound_tail.store(tail + 1, std::memory_order_release);
 }
 
 void OSoundInt::queue_clear()
 {
-    sound_tail = 0;
-    sounds_queued = 0;
+    sound_clear.store(sound_tail.load(std::memory_order_relaxed), std::memory_order_release);
 }
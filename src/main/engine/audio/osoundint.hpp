@@ -13,6 +13,7 @@
 
 #pragma once
 
+#include <atomic>
 #include "hwaudio/segapcm.hpp"
 #include "hwaudio/ym2151.hpp"
 #include "engine/audio/commands.hpp"
@@ -42,6 +43,14 @@ public:
     // [+7] Traffic data #4
     uint8_t engine_data[8];
 
+    // Audio clock, in 8ms sound ticks. The audio output counts the ticks handed to the device,
+    // and sets how many ticks it renders ahead of them. A queued sound is due on the tick that
+    // would be rendered next with the output buffer at that depth, so effects start a set time
+    // after they're queued however far the mixer happens to have got.
+    std::atomic<uint32_t> ticks_played{0};
+    std::atomic<uint32_t> ticks_ahead{0};
+    uint32_t ticks_rendered() const { return tick_count; }
+
     OSoundInt();
     ~OSoundInt();
 
@@ -50,6 +59,12 @@ public:
     void tick();
 
     void play_queued_sound();
+
+    // After each logic tick: pass engine_data on to the sound ticks. With sound.smooth_engine, the
+    // engine pitch and volume glide from one logic tick's values to the next over the sound ticks
+    // between them, rather than stepping at the logic rate (30Hz sounds coarse otherwise).
+    void engine_update();
+
     void queue_sound_service(uint8_t snd);
     void queue_sound(uint8_t snd);
     void queue_clear();
@@ -58,6 +73,9 @@ private:
     // 4 MHz
     static const uint32_t SOUND_CLOCK = 4000000;
 
+    // PCM channels the engine plays on (0, 2 .. 10)
+    static const uint16_t ENGINE_CHANNELS = 0x555;
+
     // Fractionally counts number of times audio code must be called
     // We call the audio code 125 times per frame from a timing perspective.
     double audio_ticks;
@@ -68,16 +86,46 @@ private:
     // Controls what type of sound we're going to process in the interrupt routine
     uint8_t sound_counter;
 
+    // Sound queue, written by the game and read by the sound ticks, which may be on another
+    // thread: single-producer/single-consumer, with free-running positions. Each sound is
+    // stamped with the tick it's due. queue_clear() moves sound_clear up to the tail, and the
+    // reader skips everything before it.
     static const uint8_t QUEUE_LENGTH = 0x1F;
-    uint8_t queue[QUEUE_LENGTH + 1];
-
-    // Number of sounds queued
-    uint8_t sounds_queued;
+    struct queued_sound_t {
+        uint8_t  snd;
+        uint32_t due;
+    };
+    queued_sound_t queue[QUEUE_LENGTH + 1];
 
     // Positions in the queue
-    uint8_t sound_head, sound_tail;
+    std::atomic<uint32_t> sound_head{0}, sound_tail{0}, sound_clear{0};
+
+    // Sound ticks run (see tick())
+    uint32_t tick_count = 0;
+
+    // Engine data, as the game left it after each logic tick: stamped as a queued sound would be,
+    // and read by the sound ticks in the same way (see engine_update())
+    static const uint8_t ENGINE_QUEUE_LENGTH = 0x7;
+    struct engine_event_t {
+        uint8_t  data[8];
+        uint32_t due;
+    };
+    engine_event_t engine_queue[ENGINE_QUEUE_LENGTH + 1];
+    std::atomic<uint32_t> engine_head{0}, engine_tail{0};
+
+    // Longest glide, in sound ticks: a logic rate of 15Hz. Longer gaps (a pause) aren't glided over.
+    static const uint32_t GLIDE_MAX = 8;
+
+    // Engine pitch and volume gliding to the last stamp due, from the values when it fell due
+    struct engine_glide_t {
+        uint16_t pitch_from, pitch_to;
+        uint8_t  vol_from, vol_to;
+        uint32_t start, length;        // sound ticks
+    } glide;
+    uint32_t glide_due = 0;            // when the last stamp was due
 
     void add_to_queue(uint8_t snd);
+    void play_engine();
 };
 
 extern OSoundInt osoundint;
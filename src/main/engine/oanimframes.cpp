@@ -0,0 +1,35 @@
+/***************************************************************************
+    Decoded Animation Frames.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include "roms.hpp"
+#include "engine/oanimframes.hpp"
+
+OAnimFrames oanimframes;
+
+// Blocks used across every sequence in the game come to a few hundred
+static const size_t EXPECTED_FRAMES = 1024;
+
+const oanimframe& OAnimFrames::get(uint32_t addr)
+{
+    if (roms.rom0p != rom)
+    {
+        frames.clear();
+        frames.reserve(EXPECTED_FRAMES);
+        rom = roms.rom0p;
+    }
+
+    auto found = frames.find(addr);
+    if (found != frames.end())
+        return found->second;
+
+    oanimframe& f = frames[addr];
+    f.addr = rom->read32(addr);
+    for (int i = 0; i < 8; i++)
+        f.b[i] = rom->read8(addr + i);
+    f.next_b7 = rom->read8(addr + 0x0F);
+    return f;
+}
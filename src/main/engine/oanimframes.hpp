@@ -0,0 +1,54 @@
+/***************************************************************************
+    Decoded Animation Frames.
+
+    The animation sequences (flag man, Ferrari driving in, the end
+    sequences) and the crash tables (car spin, bump and flip, and the
+    passengers thrown about) are stored in the ROM as blocks of 8 bytes,
+    one block per frame, and were read back from the ROM with each tick.
+
+    Each block is decoded once, the first time it is used, into the
+    native form below, and kept until the ROM set in use changes (the
+    Japanese tracks have their own program ROM). The blocks of the
+    animation sequences are laid out as described in oanimseq.cpp; the
+    crash tables put other things in bytes 4 - 7, so they are kept as
+    they are in the ROM, and named where they're used.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <unordered_map>
+#include "stdint.hpp"
+
+class RomLoader;
+
+struct oanimframe
+{
+    uint32_t addr;      // +00 [Long] Sprite data address in bits 0-19
+    uint8_t  b[8];      // +00 - +07, as in the ROM
+    uint8_t  next_b7;   // +0F: byte 7 of the block that follows
+
+    // Animation sequence blocks
+    uint8_t  pal()        const { return b[0]; }
+    bool     neg_x()      const { return b[1] & 0x80; }
+    uint8_t  priority()   const { return (b[1] & 0x70) >> 4; }
+    bool     next_block() const { return b[7] & 0x80; }
+    bool     hflip()      const { return b[7] & 0x40; }
+    uint8_t  delay()      const { return b[7] & 0x3F; }
+    uint8_t  next_delay() const { return next_b7 & 0x3F; }
+};
+
+class OAnimFrames
+{
+public:
+    // The block at this address in the program ROM in use
+    const oanimframe& get(uint32_t addr);
+
+private:
+    RomLoader* rom = nullptr;
+    std::unordered_map<uint32_t, oanimframe> frames;
+};
+
+extern OAnimFrames oanimframes;
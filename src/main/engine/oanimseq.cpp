@@ -19,6 +19,7 @@
 #include "engine/oferrari.hpp"
 #include "engine/oinputs.hpp"
 #include "engine/oanimseq.hpp"
+#include "engine/oanimframes.hpp"
 
 // ----------------------------------------------------------------------------
 // Animation Data Format.
@@ -64,7 +65,7 @@ void OAnimSeq::init(oentry* jump_table)
     sprite_flag->draw_props = oentry::BOTTOM;
 
     // Routine initalisations
-    sprite_flag->control |= OSprites::ENABLE;
+    sprite_flag->control() |= OSprites::ENABLE;
     sprite_flag->z = 400 << 16;
 
     // --------------------------------------------------------------------------------------------
@@ -74,7 +75,7 @@ void OAnimSeq::init(oentry* jump_table)
     anim_ferrari.init(sprite_ferrari);
     anim_ferrari.anim_addr_curr = outrun.adr.anim_ferrari_curr;
     anim_ferrari.anim_addr_next = outrun.adr.anim_ferrari_next;
-    sprite_ferrari->control |= OSprites::ENABLE;
+    sprite_ferrari->control() |= OSprites::ENABLE;
     sprite_ferrari->draw_props = oentry::BOTTOM;
 
     oentry* sprite_pass1 = &jump_table[OSprites::SPRITE_PASS1];
@@ -112,14 +113,14 @@ void OAnimSeq::init(oentry* jump_table)
 
 void OAnimSeq::flag_seq()
 {
-    if (!(anim_flag.sprite->control & OSprites::ENABLE))
+    if (!(anim_flag.sprite->control() & OSprites::ENABLE))
         return;
 
     if (outrun.tick_frame)
     {
         if (outrun.game_state < GS_START1 || outrun.game_state > GS_GAMEOVER)
         {
-            anim_flag.sprite->control &= ~OSprites::ENABLE;
+            anim_flag.sprite->control() &= ~OSprites::ENABLE;
             return;
         }
 
@@ -134,17 +135,17 @@ void OAnimSeq::flag_seq()
             anim_flag.anim_addr_curr = roms.rom0p->read32(&index);
             anim_flag.anim_addr_next = roms.rom0p->read32(&index);
 
-            anim_flag.frame_delay = roms.rom0p->read8(7 + anim_flag.anim_addr_curr) & 0x3F;
+            anim_flag.frame_delay = oanimframes.get(anim_flag.anim_addr_curr).delay();
             anim_flag.anim_frame  = 0;
         }
 
         // Wave Flag 
         if (outrun.game_state <= GS_INGAME)
         {
-            uint32_t index = anim_flag.anim_addr_curr + (anim_flag.anim_frame << 3);
+            const oanimframe& f = oanimframes.get(anim_flag.anim_addr_curr + (anim_flag.anim_frame << 3));
 
-            anim_flag.sprite->addr    = roms.rom0p->read32(index) & 0xFFFFF;
-            anim_flag.sprite->pal_src = roms.rom0p->read8(index);
+            anim_flag.sprite->addr    = f.addr & 0xFFFFF;
+            anim_flag.sprite->pal_src = f.pal();
 
 	        uint32_t addr = SPRITE_ZOOM_LOOKUP + (((anim_flag.sprite->z >> 16) << 2) | osprites.sprite_scroll_speed);
 	        uint32_t value = roms.rom0p->read32(addr);
@@ -153,47 +154,47 @@ void OAnimSeq::flag_seq()
 	    
             if (z16 >= 0x200)
 	        {
-                anim_flag.sprite->control &= ~OSprites::ENABLE;
+                anim_flag.sprite->control() &= ~OSprites::ENABLE;
 		        return;
 	        }
 	        anim_flag.sprite->priority = z16;
 	        anim_flag.sprite->zoom     = z16 >> 2;
 
             // Set X Position
-            int16_t sprite_x = (int8_t) roms.rom0p->read8(4 + index);
+            int16_t sprite_x = (int8_t) f.b[4];
             sprite_x -= oroad.road0_h[z16];
             int32_t final_x = (sprite_x * z16) >> 9;
 
-            if (roms.rom0p->read8(1 + index) & BIT_7)
+            if (f.neg_x())
                 final_x = -final_x;
 
             anim_flag.sprite->x = final_x;
 
             // Set Y Position
-            int16_t sprite_y      = (int8_t) roms.rom0p->read8(5 + index);
+            int16_t sprite_y      = (int8_t) f.b[5];
             int16_t final_y       = (sprite_y * z16) >> 9;
             anim_flag.sprite->y   = oroad.get_road_y(z16) - final_y;
 
             // Set H-Flip
-            if (roms.rom0p->read8(7 + index) & BIT_6)
-                anim_flag.sprite->control |= OSprites::HFLIP;
+            if (f.hflip())
+                anim_flag.sprite->control() |= OSprites::HFLIP;
             else
-                anim_flag.sprite->control &= ~OSprites::HFLIP;
+                anim_flag.sprite->control() &= ~OSprites::HFLIP;
 
             // Ready for next frame
             if (--anim_flag.frame_delay == 0)
             {
                 // Load Next Block Of Animation Data
-                if (roms.rom0p->read8(7 + index) & BIT_7)
+                if (f.next_block())
                 {
                     anim_flag.anim_addr_curr = anim_flag.anim_addr_next;
-                    anim_flag.frame_delay    = roms.rom0p->read8(7 + anim_flag.anim_addr_curr) & 0x3F;
+                    anim_flag.frame_delay    = oanimframes.get(anim_flag.anim_addr_curr).delay();
                     anim_flag.anim_frame     = 0;
                 }
                 // Last Block
                 else
                 {
-                    anim_flag.frame_delay = roms.rom0p->read8(0x0F + index) & 0x3F;
+                    anim_flag.frame_delay = f.next_delay();
                     anim_flag.anim_frame++;
                 }
             }
@@ -210,13 +211,13 @@ void OAnimSeq::flag_seq()
 // Source: 0x6036
 void OAnimSeq::ferrari_seq()
 {
-    if (!(anim_ferrari.sprite->control & OSprites::ENABLE))
+    if (!(anim_ferrari.sprite->control() & OSprites::ENABLE))
         return;
 
     if (outrun.game_state == GS_MUSIC) return;
 
-    anim_pass1.sprite->control |= OSprites::ENABLE;
-    anim_pass2.sprite->control |= OSprites::ENABLE;
+    anim_pass1.sprite->control() |= OSprites::ENABLE;
+    anim_pass2.sprite->control() |= OSprites::ENABLE;
 
     if (outrun.game_state <= GS_LOGO)
     {
@@ -224,9 +225,9 @@ void OAnimSeq::ferrari_seq()
         return;
     }
 
-    anim_ferrari.frame_delay = roms.rom0p->read8(7 + anim_ferrari.anim_addr_curr) & 0x3F;
-    anim_pass1.frame_delay   = roms.rom0p->read8(7 + anim_pass1.anim_addr_curr) & 0x3F;
-    anim_pass2.frame_delay   = roms.rom0p->read8(7 + anim_pass2.anim_addr_curr) & 0x3F;
+    anim_ferrari.frame_delay = oanimframes.get(anim_ferrari.anim_addr_curr).delay();
+    anim_pass1.frame_delay   = oanimframes.get(anim_pass1.anim_addr_curr).delay();
+    anim_pass2.frame_delay   = oanimframes.get(anim_pass2.anim_addr_curr).delay();
 
     oferrari.car_state = OFerrari::CAR_NORMAL;
     oferrari.state     = OFerrari::FERRARI_SEQ2;
@@ -250,35 +251,35 @@ void OAnimSeq::anim_seq_intro(oanimsprite* anim)
         if (anim->anim_frame >= 1)
             oferrari.car_state = OFerrari::CAR_ANIM_SEQ;
 
-        uint32_t index              = anim->anim_addr_curr + (anim->anim_frame << 3);
+        const oanimframe& f         = oanimframes.get(anim->anim_addr_curr + (anim->anim_frame << 3));
 
-        anim->sprite->addr          = roms.rom0p->read32(index) & 0xFFFFF;
-        anim->sprite->pal_src       = anim == &anim_ferrari ? oferrari.ferrari_pal : roms.rom0p->read8(index);
+        anim->sprite->addr          = f.addr & 0xFFFFF;
+        anim->sprite->pal_src       = anim == &anim_ferrari ? oferrari.ferrari_pal : f.pal();
         anim->sprite->zoom          = 0x7F;
         anim->sprite->road_priority = 0x1FE;
-        anim->sprite->priority      = 0x1FE - ((roms.rom0p->read16(index) & 0x70) >> 4);
+        anim->sprite->priority      = 0x1FE - f.priority();
 
         // Set X
-        int16_t sprite_x = (int8_t) roms.rom0p->read8(4 + index);
+        int16_t sprite_x = (int8_t) f.b[4];
         int32_t final_x = (sprite_x * anim->sprite->priority) >> 9;
-        if (roms.rom0p->read8(1 + index) & BIT_7)
+        if (f.neg_x())
             final_x = -final_x;
         anim->sprite->x = final_x;
 
         // Set Y
-        anim->sprite->y = 221 - ((int8_t) roms.rom0p->read8(5 + index));
+        anim->sprite->y = 221 - ((int8_t) f.b[5]);
 
         // Set H-Flip
-        if (roms.rom0p->read8(7 + index) & BIT_6)
-            anim->sprite->control |= OSprites::HFLIP;
+        if (f.hflip())
+            anim->sprite->control() |= OSprites::HFLIP;
         else
-            anim->sprite->control &= ~OSprites::HFLIP;
+            anim->sprite->control() &= ~OSprites::HFLIP;
 
         // Ready for next frame
         if (--anim->frame_delay == 0)
         {
             // Load Next Block Of Animation Data
-            if (roms.rom0p->read8(7 + index) & BIT_7)
+            if (f.next_block())
             {
                 // Yeah the usual OutRun code hacks to do really odd stuff!
                 // In this case, to exit the routine and setup the Ferrari on the last entry for passenger 2
@@ -294,13 +295,13 @@ void OAnimSeq::anim_seq_intro(oanimsprite* anim)
                 }
 
                 anim->anim_addr_curr = anim->anim_addr_next;
-                anim->frame_delay    = roms.rom0p->read8(7 + anim->anim_addr_curr) & 0x3F;
+                anim->frame_delay    = oanimframes.get(anim->anim_addr_curr).delay();
                 anim->anim_frame     = 0;
             }
             // Last Block
             else
             {
-                anim->frame_delay = roms.rom0p->read8(0x0F + index) & 0x3F;
+                anim->frame_delay = f.next_delay();
                 anim->anim_frame++;
             }
         }
@@ -326,7 +327,7 @@ void OAnimSeq::init_end_seq()
     oferrari.state = OFerrari::FERRARI_END_SEQ;
 
     // Setup Ferrari Sprite
-    anim_ferrari.sprite->control |= OSprites::ENABLE; 
+    anim_ferrari.sprite->control() |= OSprites::ENABLE; 
     anim_ferrari.sprite->id = 0;
     anim_ferrari.sprite->draw_props = oentry::BOTTOM;
     anim_ferrari.anim_frame = 0;
@@ -335,8 +336,8 @@ void OAnimSeq::init_end_seq()
     seq_pos = 0;
 
     // Disable Passenger Sprites. These are replaced with new versions by the animation sequence.
-    oferrari.spr_pass1->control &= ~OSprites::ENABLE;
-    oferrari.spr_pass2->control &= ~OSprites::ENABLE;
+    oferrari.spr_pass1->control() &= ~OSprites::ENABLE;
+    oferrari.spr_pass2->control() &= ~OSprites::ENABLE;
 
     obonus.bonus_control += 4;
 }
@@ -381,7 +382,7 @@ void OAnimSeq::init_end_sprites()
     ferrari_stopped = false;
     
     // 0x58A4: Car Door Opening Animation [seq_sprite_entry]
-    anim_obj1.sprite->control |= OSprites::ENABLE;
+    anim_obj1.sprite->control() |= OSprites::ENABLE;
     anim_obj1.sprite->id = 1;
     anim_obj1.sprite->shadow = 3;
     anim_obj1.sprite->draw_props = oentry::BOTTOM;
@@ -393,7 +394,7 @@ void OAnimSeq::init_end_sprites()
     anim_obj1.anim_addr_next = roms.rom0p->read32(&addr);
     
     // 0x58EC: Interior of Ferrari (Note this wobbles a little when passengers exit) [seq_sprite_entry]
-    anim_obj2.sprite->control |= OSprites::ENABLE;
+    anim_obj2.sprite->control() |= OSprites::ENABLE;
     anim_obj2.sprite->id = 2;
     anim_obj2.sprite->draw_props = oentry::BOTTOM;
     anim_obj2.anim_frame = 0;
@@ -404,7 +405,7 @@ void OAnimSeq::init_end_sprites()
     anim_obj2.anim_addr_next = roms.rom0p->read32(&addr);
 
     // 0x592A: Car Shadow [SeqSpriteShadow]
-    anim_obj3.sprite->control |= OSprites::ENABLE;
+    anim_obj3.sprite->control() |= OSprites::ENABLE;
     anim_obj3.sprite->id = 3;
     anim_obj3.sprite->draw_props = oentry::BOTTOM;
     anim_obj3.anim_frame = 0;
@@ -413,7 +414,7 @@ void OAnimSeq::init_end_sprites()
     anim_obj3.sprite->addr = outrun.adr.shadow_data;
 
     // 0x5960: Man Sprite [seq_sprite_entry]
-    anim_pass1.sprite->control |= OSprites::ENABLE;
+    anim_pass1.sprite->control() |= OSprites::ENABLE;
     anim_pass1.sprite->id = 4;
     anim_pass1.sprite->draw_props = oentry::BOTTOM;
     anim_pass1.anim_frame = 0;
@@ -424,7 +425,7 @@ void OAnimSeq::init_end_sprites()
     anim_pass1.anim_addr_next = roms.rom0p->read32(&addr);
 
     // 0x5998: Man Shadow [SeqSpriteShadow]
-    anim_obj4.sprite->control = OSprites::ENABLE;
+    anim_obj4.sprite->control() = OSprites::ENABLE;
     anim_obj4.sprite->id = 5;
     anim_obj4.sprite->shadow = 7;
     anim_obj4.sprite->draw_props = oentry::BOTTOM;
@@ -434,7 +435,7 @@ void OAnimSeq::init_end_sprites()
     anim_obj4.sprite->addr = outrun.adr.shadow_data;
 
     // 0x59BE: Female Sprite [seq_sprite_entry]
-    anim_pass2.sprite->control |= OSprites::ENABLE;
+    anim_pass2.sprite->control() |= OSprites::ENABLE;
     anim_pass2.sprite->id = 6;
     anim_pass2.sprite->draw_props = oentry::BOTTOM;
     anim_pass2.anim_frame = 0;
@@ -445,7 +446,7 @@ void OAnimSeq::init_end_sprites()
     anim_pass2.anim_addr_next = roms.rom0p->read32(&addr);
 
     // 0x59F6: Female Shadow [SeqSpriteShadow]
-    anim_obj5.sprite->control = OSprites::ENABLE;
+    anim_obj5.sprite->control() = OSprites::ENABLE;
     anim_obj5.sprite->id = 7;
     anim_obj5.sprite->shadow = 7;
     anim_obj5.sprite->draw_props = oentry::BOTTOM;
@@ -455,7 +456,7 @@ void OAnimSeq::init_end_sprites()
     anim_obj5.sprite->addr = outrun.adr.shadow_data;
 
     // 0x5A2C: Person Presenting Trophy [seq_sprite_entry]
-    anim_obj6.sprite->control |= OSprites::ENABLE;
+    anim_obj6.sprite->control() |= OSprites::ENABLE;
     anim_obj6.sprite->id = 8;
     anim_obj6.sprite->draw_props = oentry::BOTTOM;
     anim_obj6.anim_frame = 0;
@@ -466,7 +467,7 @@ void OAnimSeq::init_end_sprites()
     anim_obj6.anim_addr_next = roms.rom0p->read32(&addr);
 
     // Alternate Use Based On End Sequence
-    anim_obj7.sprite->control |= OSprites::ENABLE;
+    anim_obj7.sprite->control() |= OSprites::ENABLE;
     anim_obj7.sprite->id = 9;
     anim_obj7.sprite->draw_props = oentry::BOTTOM;
     anim_obj7.anim_frame = 0;
@@ -488,7 +489,7 @@ void OAnimSeq::init_end_sprites()
     }
 
     // 0x5AD0: Enable After Effects (e.g. cloud of smoke for genie) [seq_sprite_entry]
-    anim_obj8.sprite->control |= OSprites::ENABLE;
+    anim_obj8.sprite->control() |= OSprites::ENABLE;
     anim_obj8.sprite->id = 10;
     anim_obj8.sprite->draw_props = oentry::BOTTOM;
     anim_obj8.anim_frame = 0;
@@ -533,47 +534,47 @@ void OAnimSeq::anim_seq_outro(oanimsprite* anim, int pal_override)
         return;
 
     // Process Animation Data
-    uint32_t index = anim->anim_addr_curr + (anim->anim_frame << 3);
+    const oanimframe& f = oanimframes.get(anim->anim_addr_curr + (anim->anim_frame << 3));
 
-    anim->sprite->addr          = roms.rom0p->read32(index) & 0xFFFFF;   
+    anim->sprite->addr          = f.addr & 0xFFFFF;
     // Override palette to overcome bugs / recolour Ferrari
-    anim->sprite->pal_src       = pal_override != -1 ? pal_override : roms.rom0p->read8(index); 
-    anim->sprite->zoom          = roms.rom0p->read8(6 + index) >> 1;
-    anim->sprite->road_priority = roms.rom0p->read8(6 + index) << 1;
-    anim->sprite->priority      = anim->sprite->road_priority - ((roms.rom0p->read16(index) & 0x70) >> 4); // (bits 4-6)
-    anim->sprite->x             = (roms.rom0p->read8(4 + index) * anim->sprite->priority) >> 9;
+    anim->sprite->pal_src       = pal_override != -1 ? pal_override : f.pal();
+    anim->sprite->zoom          = f.b[6] >> 1;
+    anim->sprite->road_priority = f.b[6] << 1;
+    anim->sprite->priority      = anim->sprite->road_priority - f.priority(); // (bits 4-6)
+    anim->sprite->x             = (f.b[4] * anim->sprite->priority) >> 9;
     
-    if (roms.rom0p->read8(1 + index) & BIT_7)
+    if (f.neg_x())
         anim->sprite->x = -anim->sprite->x;
 
     // set_sprite_xy: (similar to flag code again)
 
     // Set Y Position
-    int16_t sprite_y = (int8_t) roms.rom0p->read8(5 + index);
+    int16_t sprite_y = (int8_t) f.b[5];
     int16_t final_y  = (sprite_y * anim->sprite->priority) >> 9;
     anim->sprite->y  = oroad.get_road_y(anim->sprite->priority) - final_y;
 
     // Set H-Flip
-    if (roms.rom0p->read8(7 + index) & BIT_6)
-        anim->sprite->control |= OSprites::HFLIP;
+    if (f.hflip())
+        anim->sprite->control() |= OSprites::HFLIP;
     else
-        anim->sprite->control &= ~OSprites::HFLIP;
+        anim->sprite->control() &= ~OSprites::HFLIP;
 
     // Ready for next frame
     if (outrun.tick_frame && --anim->frame_delay == 0)
     {
         // Load Next Block Of Animation Data
-        if (roms.rom0p->read8(7 + index) & BIT_7)
+        if (f.next_block())
         {
             anim->anim_props    |= 0xFF;
             anim->anim_addr_curr = anim->anim_addr_next;
-            anim->frame_delay    = roms.rom0p->read8(7 + anim->anim_addr_curr) & 0x3F;
+            anim->frame_delay    = oanimframes.get(anim->anim_addr_curr).delay();
             anim->anim_frame     = 0;
         }
         // Last Block
         else
         {
-            anim->frame_delay = roms.rom0p->read8(0x0F + index) & 0x3F;
+            anim->frame_delay = f.next_delay();
             anim->anim_frame++;
         }
     } 
@@ -665,7 +666,7 @@ bool OAnimSeq::read_anim_data(oanimsprite* anim)
     {
         // If current animation block is set, extract frame delay
         if (anim->anim_addr_curr)
-            anim->frame_delay = roms.rom0p->read8(7 + anim->anim_addr_curr) & 0x3F;
+            anim->frame_delay = oanimframes.get(anim->anim_addr_curr).delay();
 
         return PROCESS;
     }
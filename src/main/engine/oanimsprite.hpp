@@ -54,7 +54,7 @@ public:
     void init(oentry* s)
     {
         sprite = s;
-        sprite->function_holder = -1;
+        sprite->function_holder() = -1;
         anim_addr_curr = 0;
         anim_addr_next = 0;
         anim_frame = 0;
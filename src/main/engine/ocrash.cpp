@@ -26,6 +26,7 @@
 #include "engine/olevelobjs.hpp"
 #include "engine/outils.hpp"
 #include "engine/ocrash.hpp"
+#include "engine/oanimframes.hpp"
 
 OCrash ocrash;
 
@@ -60,10 +61,10 @@ bool OCrash::is_flip()
 void OCrash::enable()
 {
     // This is called multiple times, so need this check in place
-    if (spr_ferrari->control & OSprites::ENABLE) 
+    if (spr_ferrari->control() & OSprites::ENABLE) 
         return;
 
-    spr_ferrari->control |= OSprites::ENABLE;
+    spr_ferrari->control() |= OSprites::ENABLE;
     
     // Reset all corresponding variables
     spinflipcount1 = 0;
@@ -110,32 +111,32 @@ void OCrash::tick()
         return;
 
     // Do Ferrari
-    if (spr_ferrari->control & OSprites::ENABLE)
+    if (spr_ferrari->control() & OSprites::ENABLE)
         if (outrun.tick_frame) do_crash();
         else osprites.do_spr_order_shadows(spr_ferrari);
 
     // Do Car Shadow
-    if (spr_shadow->control & OSprites::ENABLE)
+    if (spr_shadow->control() & OSprites::ENABLE)
         if (outrun.tick_frame) do_shadow(spr_ferrari, spr_shadow);
         else osprites.do_spr_order_shadows(spr_shadow);
 
     // Do Passenger 1
-    if (spr_pass1->control & OSprites::ENABLE)
+    if (spr_pass1->control() & OSprites::ENABLE)
         if (outrun.tick_frame) ((ocrash).*(function_pass1))(spr_pass1);
         else osprites.do_spr_order_shadows(spr_pass1);
 
     // Do Passenger 1 Shadow
-    if (spr_pass1s->control & OSprites::ENABLE)
+    if (spr_pass1s->control() & OSprites::ENABLE)
         if (outrun.tick_frame) do_shadow(spr_pass1, spr_pass1s);
         else osprites.do_spr_order_shadows(spr_pass1s);
 
     // Do Passenger 2
-    if (spr_pass2->control & OSprites::ENABLE)
+    if (spr_pass2->control() & OSprites::ENABLE)
         if (outrun.tick_frame) ((ocrash).*(function_pass2))(spr_pass2);
         else osprites.do_spr_order_shadows(spr_pass2);
 
     // Do Passenger 2 Shadow
-    if (spr_pass2s->control & OSprites::ENABLE)
+    if (spr_pass2s->control() & OSprites::ENABLE)
         if (outrun.tick_frame) do_shadow(spr_pass2, spr_pass2s);
         else osprites.do_spr_order_shadows(spr_pass2s);
 }
@@ -297,15 +298,15 @@ void OCrash::init_collision()
     oferrari.car_state = OFerrari::CAR_ANIM_SEQ; // Denote car animation sequence
 
     // Enable crash sprites
-    spr_shadow->control |= OSprites::ENABLE;
-    spr_pass1->control  |= OSprites::ENABLE;
-    spr_pass2->control  |= OSprites::ENABLE;
+    spr_shadow->control() |= OSprites::ENABLE;
+    spr_pass1->control()  |= OSprites::ENABLE;
+    spr_pass2->control()  |= OSprites::ENABLE;
 
     // Disable normal sprites
-    oferrari.spr_ferrari->control &= ~OSprites::ENABLE;
-    oferrari.spr_shadow->control  &= ~OSprites::ENABLE;
-    oferrari.spr_pass1->control   &= ~OSprites::ENABLE;
-    oferrari.spr_pass2->control   &= ~OSprites::ENABLE;
+    oferrari.spr_ferrari->control() &= ~OSprites::ENABLE;
+    oferrari.spr_shadow->control()  &= ~OSprites::ENABLE;
+    oferrari.spr_pass1->control()   &= ~OSprites::ENABLE;
+    oferrari.spr_pass2->control()   &= ~OSprites::ENABLE;
 
     spr_ferrari->x = oferrari.spr_ferrari->x;
     spr_ferrari->y = 221;
@@ -368,21 +369,21 @@ void OCrash::do_collision()
         }
     }
     // 0x13F8
-    uint32_t property_table = addr + (frame << 3);
+    const oanimframe& property_table = oanimframes.get(addr + (frame << 3));
     crash_z = spr_ferrari->counter;
     spr_ferrari->zoom = 0x80;
     spr_ferrari->priority = 0x1FD;
     oinitengine.car_x_pos -= slide;
-    spr_ferrari->addr = roms.rom0p->read32(property_table);
+    spr_ferrari->addr = property_table.addr;
 
-    if (roms.rom0p->read8(4 + property_table))
-        spr_ferrari->control |= OSprites::HFLIP;
+    if (property_table.b[4])
+        spr_ferrari->control() |= OSprites::HFLIP;
     else
-        spr_ferrari->control &= ~OSprites::HFLIP;
+        spr_ferrari->control() &= ~OSprites::HFLIP;
 
-    //spr_ferrari->pal_src = roms.rom0p->read8(5 + property_table);
+    //spr_ferrari->pal_src = property_table.b[5];
     spr_ferrari->pal_src = oferrari.ferrari_pal;
-    spin_pass_frame = (int8_t) roms.rom0p->read8(6 + property_table);
+    spin_pass_frame = (int8_t) property_table.b[6];
 
     if (--spinflipcount2 > 0)
     {
@@ -407,8 +408,8 @@ void OCrash::do_collision()
             frame = 0;
 
             // Enable passenger shadows
-            spr_pass1s->control |= OSprites::ENABLE;
-            spr_pass2s->control |= OSprites::ENABLE;
+            spr_pass1s->control() |= OSprites::ENABLE;
+            spr_pass2s->control() |= OSprites::ENABLE;
             done(spr_ferrari);
             return;
         }
@@ -421,7 +422,7 @@ void OCrash::do_collision()
                 slide += 2;
 
             // End of frame sequence
-            if (!roms.rom0p->read8(7 + property_table))
+            if (!property_table.b[7])
             {
                 done(spr_ferrari);
                 return;
@@ -461,10 +462,10 @@ void OCrash::do_collision()
 void OCrash::end_collision()
 {
     // Enable 'normal' Ferrari object
-    oferrari.spr_ferrari->control |= OSprites::ENABLE;
-    oferrari.spr_shadow->control  |= OSprites::ENABLE;
-    oferrari.spr_pass1->control   |= OSprites::ENABLE;
-    oferrari.spr_pass2->control   |= OSprites::ENABLE;
+    oferrari.spr_ferrari->control() |= OSprites::ENABLE;
+    oferrari.spr_shadow->control()  |= OSprites::ENABLE;
+    oferrari.spr_pass1->control()   |= OSprites::ENABLE;
+    oferrari.spr_pass2->control()   |= OSprites::ENABLE;
 
     coll_count2 = coll_count1;
     if (!coll_count2)
@@ -489,12 +490,12 @@ void OCrash::end_collision()
     spin_control2 = 0;
     spin_control1 = 0;
 
-    spr_ferrari->control &= ~OSprites::ENABLE;
-    spr_shadow->control  &= ~OSprites::ENABLE;
-    spr_pass1->control   &= ~OSprites::ENABLE;
-    spr_pass1s->control  &= ~OSprites::ENABLE;
-    spr_pass2->control   &= ~OSprites::ENABLE;
-    spr_pass2s->control  &= ~OSprites::ENABLE;
+    spr_ferrari->control() &= ~OSprites::ENABLE;
+    spr_shadow->control()  &= ~OSprites::ENABLE;
+    spr_pass1->control()   &= ~OSprites::ENABLE;
+    spr_pass1s->control()  &= ~OSprites::ENABLE;
+    spr_pass2->control()   &= ~OSprites::ENABLE;
+    spr_pass2s->control()  &= ~OSprites::ENABLE;
 
     function_pass1 = &OCrash::do_crash_passengers;
     function_pass2 = &OCrash::do_crash_passengers;
@@ -516,23 +517,24 @@ void OCrash::do_bump()
 
     spr_ferrari->y = 221 - (new_position >> shift);
 
-    uint32_t frames = addr + (frame << 3);
-    spr_ferrari->addr = roms.rom0p->read32(frames);
+    const oanimframe& frame_data = oanimframes.get(addr + (frame << 3));
+    spr_ferrari->addr = frame_data.addr;
     
-    if (roms.rom0p->read8(frames + 4))
-        spr_ferrari->control |= OSprites::HFLIP;
+    if (frame_data.b[4])
+        spr_ferrari->control() |= OSprites::HFLIP;
     else
-        spr_ferrari->control &= ~OSprites::HFLIP;
+        spr_ferrari->control() &= ~OSprites::HFLIP;
     
-    //spr_ferrari->pal_src = roms.rom0p->read8(frames + 5);
+    //spr_ferrari->pal_src = frame_data.b[5];
     spr_ferrari->pal_src = oferrari.ferrari_pal;
-    spin_pass_frame = (int8_t) roms.rom0p->read8(frames + 6);
+    spin_pass_frame = (int8_t) frame_data.b[6];
 
     if (++lookup_index >= 0x10)
     {
         addr += (frame_restore << 3);
-        spr_ferrari->addr = roms.rom0p->read32(addr);
-        spin_pass_frame = (int8_t) roms.rom0p->read8(addr + 6);
+        const oanimframe& restore = oanimframes.get(addr);
+        spr_ferrari->addr = restore.addr;
+        spin_pass_frame = (int8_t) restore.b[6];
         crash_state = 4;      // Trigger smoke cloud
         crash_spin_count = 1; // Denote Crash
     }
@@ -595,14 +597,15 @@ void OCrash::do_car_flip()
     // flip_cont
     olevelobjs.collision_sprite = 0; // Moved this for clarity
     uint32_t frames = addr + (frame << 3);
-    spr_ferrari->addr = roms.rom0p->read32(frames);
+    const oanimframe& frame_data = oanimframes.get(frames);
+    spr_ferrari->addr = frame_data.addr;
 
     // ------------------------------------------------------------------------
     // Fast Crash: Car Heads towards camera in sky, before vanishing (0x161E)
     // ------------------------------------------------------------------------
     if (crash_speed == 0)
     {
-        spr_shadow->control &= ~OSprites::ENABLE; // Disable Shadow
+        spr_shadow->control() &= ~OSprites::ENABLE; // Disable Shadow
         spr_ferrari->counter += crash_zinc;       // Increment Crash Z
         if (spr_ferrari->counter > 0x3FF)
         {
@@ -634,7 +637,7 @@ void OCrash::do_car_flip()
     int16_t x_diff = (slide * spr_ferrari->priority) >> 9;
     oinitengine.car_x_pos -= x_diff;
 
-    int16_t passenger_frame = (int8_t) roms.rom0p->read8(6 + frames);
+    int16_t passenger_frame = (int8_t) frame_data.b[6];
 
     // Start of sequence
     if (passenger_frame == 0)
@@ -661,15 +664,15 @@ void OCrash::do_car_flip()
 
     // Set Ferrari H-Flip
     if (crash_side) 
-        spr_ferrari->control |= OSprites::HFLIP;
+        spr_ferrari->control() |= OSprites::HFLIP;
     else 
-        spr_ferrari->control &= ~OSprites::HFLIP;
+        spr_ferrari->control() &= ~OSprites::HFLIP;
   
     // Palette Hack for recoloured cars. Original version was simply: spr_ferrari->pal_src = roms.rom0p->read8(4 + frames);
     if (frame >= 7)
         spr_ferrari->pal_src = oferrari.ferrari_pal;
     else
-        spr_ferrari->pal_src = oferrari.ferrari_pal == OFerrari::PAL_RED ? roms.rom0p->read8(4 + frames) : oferrari.ferrari_pal + 4;
+        spr_ferrari->pal_src = oferrari.ferrari_pal == OFerrari::PAL_RED ? frame_data.b[4] : oferrari.ferrari_pal + 4;
 
     if (--spinflipcount2 > 0)
     {
@@ -685,7 +688,7 @@ void OCrash::do_car_flip()
     {
         frame++;
         // End of frame sequence
-        if ((roms.rom0p->read8(7 + frames) & BIT_7) == 0)
+        if ((frame_data.b[7] & BIT_7) == 0)
         {
             done(spr_ferrari);
             return;
@@ -747,17 +750,18 @@ void OCrash::trigger_smoke()
     // Slide Car
     oinitengine.car_x_pos -= slide_copy;
 
-    spr_ferrari->addr = roms.rom0p->read32(addr);
+    const oanimframe& frame_data = oanimframes.get(addr);
+    spr_ferrari->addr = frame_data.addr;
 
     // Set Ferrari H-Flip
-    if (roms.rom0p->read8(4 + addr))
-        spr_ferrari->control |= OSprites::HFLIP;
+    if (frame_data.b[4])
+        spr_ferrari->control() |= OSprites::HFLIP;
     else 
-        spr_ferrari->control &= ~OSprites::HFLIP;
+        spr_ferrari->control() &= ~OSprites::HFLIP;
 
-    //spr_ferrari->pal_src =     roms.rom0p->read8(5 + addr);
+    //spr_ferrari->pal_src = frame_data.b[5];
     spr_ferrari->pal_src = oferrari.ferrari_pal;
-    spin_pass_frame = (int8_t) roms.rom0p->read8(6 + addr);
+    spin_pass_frame = (int8_t) frame_data.b[6];
 
     // Slow Car
     oinitengine.car_increment = 
@@ -1142,17 +1146,18 @@ void OCrash::crash_pass1(oentry* sprite)
 {
     uint32_t frames = (sprite == spr_pass1 ? outrun.adr.sprite_crash_man1 : outrun.adr.sprite_crash_girl1) + (spin_pass_frame << 3);
     
-    sprite->addr    = roms.rom0p->read32(frames);
-    uint8_t props   = roms.rom0p->read8(4 + frames);
-    sprite->pal_src = roms.rom0p->read8(5 + frames);
-    sprite->x       = spr_ferrari->x + (int8_t) roms.rom0p->read8(6 + frames);
-    sprite->y       = spr_ferrari->y + (int8_t) roms.rom0p->read8(7 + frames);
+    const oanimframe& f = oanimframes.get(frames);
+    sprite->addr    = f.addr;
+    uint8_t props   = f.b[4];
+    sprite->pal_src = f.b[5];
+    sprite->x       = spr_ferrari->x + (int8_t) f.b[6];
+    sprite->y       = spr_ferrari->y + (int8_t) f.b[7];
 
     // Check H-Flip
     if (props & BIT_7)
-        sprite->control |= OSprites::HFLIP;
+        sprite->control() |= OSprites::HFLIP;
     else
-        sprite->control &= ~OSprites::HFLIP;
+        sprite->control() &= ~OSprites::HFLIP;
 
     // Test whether we should set priority higher (unused on passenger sprites I think)
     if (props & BIT_0)
@@ -1183,17 +1188,18 @@ void OCrash::crash_pass2(oentry* sprite)
     // Use crash_delay to toggle between two distinct frames
     frames += ((coll_count2 & 3) << 4) + (crash_delay & 8);
     
-    sprite->addr    = roms.rom0p->read32(frames);
-    uint8_t props   = roms.rom0p->read8(4 + frames);
-    sprite->pal_src = roms.rom0p->read8(5 + frames);
-    sprite->x       = spr_ferrari->x + (int8_t) roms.rom0p->read8(6 + frames);
-    sprite->y       = spr_ferrari->y + (int8_t) roms.rom0p->read8(7 + frames);
+    const oanimframe& f = oanimframes.get(frames);
+    sprite->addr    = f.addr;
+    uint8_t props   = f.b[4];
+    sprite->pal_src = f.b[5];
+    sprite->x       = spr_ferrari->x + (int8_t) f.b[6];
+    sprite->y       = spr_ferrari->y + (int8_t) f.b[7];
 
     // Check H-Flip
     if (props & BIT_7)
-        sprite->control |= OSprites::HFLIP;
+        sprite->control() |= OSprites::HFLIP;
     else
-        sprite->control &= ~OSprites::HFLIP;
+        sprite->control() &= ~OSprites::HFLIP;
 
     // Test whether we should set priority higher (unused on passenger sprites I think)
     if (props & BIT_0)
@@ -1321,11 +1327,11 @@ void OCrash::pass_flip(oentry* sprite)
             sprite->reload = 1; // // Passenger Control: Passengers sit up on road after crash
 
             // Disable sprite and shadow
-            sprite->control &= ~OSprites::ENABLE;
+            sprite->control() &= ~OSprites::ENABLE;
             if (sprite == spr_pass1)
-                spr_pass1s->control &= ~OSprites::ENABLE;
+                spr_pass1s->control() &= ~OSprites::ENABLE;
             else
-                spr_pass2s->control &= ~OSprites::ENABLE;
+                spr_pass2s->control() &= ~OSprites::ENABLE;
             return;
         }
     }
@@ -1348,11 +1354,11 @@ void OCrash::pass_flip(oentry* sprite)
     if (zoom < 0x40) zoom = 0x40;
     sprite->zoom = (uint8_t) zoom;
 
-    uint32_t frames = sprite->z + (sprite->xw1 << 3);
-    sprite->addr = roms.rom0p->read32(frames);
+    const oanimframe& f = oanimframes.get(sprite->z + (sprite->xw1 << 3));
+    sprite->addr = f.addr;
 
     uint16_t offset = sprite->counter > 0x1FF ? 0x1FF : sprite->counter;
-    int16_t y_change = (((int8_t) roms.rom0p->read8(6 + frames)) * offset) >> 9; // d1
+    int16_t y_change = (((int8_t) f.b[6]) * offset) >> 9; // d1
 
     sprite->y = -(oroad.road_y[oroad.road_p0 + offset] >> 4) + 223;
     sprite->y -= y_change;
@@ -1361,11 +1367,11 @@ void OCrash::pass_flip(oentry* sprite)
 
     sprite->priority = offset;
     if (crash_side) 
-        sprite->control |= OSprites::HFLIP;
+        sprite->control() |= OSprites::HFLIP;
     else 
-        sprite->control &= ~OSprites::HFLIP;
+        sprite->control() &= ~OSprites::HFLIP;
 
-    sprite->pal_src = roms.rom0p->read8(4 + frames);
+    sprite->pal_src = f.b[4];
     
     // Decrement spin count
     // Increment frame of passengers for first spins
@@ -1375,17 +1381,16 @@ void OCrash::pass_flip(oentry* sprite)
         sprite->xw1++; // Increase passenger frame
 
         // End of animation sequence. Progress to next sequnce of animations.
-        if (roms.rom0p->read8(7 + frames) & BIT_7)
+        if (f.b[7] & BIT_7)
         {
             sprite->reload = 1; // Passenger Control: Passengers sit up on road after crash
             sprite->xw1    = 0; // Reset passenger frame
             
             // Update address of animation sequence to be used
             sprite->z      = sprite == spr_pass1 ? outrun.adr.sprite_crash_flip_m2 : outrun.adr.sprite_crash_flip_g2;
-            frames         = sprite->z;
 
             // Set Frame Delay for this animation sequence from lower bytes
-            sprite->traffic_speed = roms.rom0p->read8(7 + frames) & 0x7F;
+            sprite->traffic_speed = oanimframes.get(sprite->z).b[7] & 0x7F;
 
             done(sprite);
             return;
@@ -1394,7 +1399,7 @@ void OCrash::pass_flip(oentry* sprite)
 
     // set_passenger_x
     sprite->x =  spr_ferrari->x;
-    sprite->x += ((int8_t) roms.rom0p->read8(5 + frames));
+    sprite->x += ((int8_t) f.b[5]);
     done(sprite);
 }
 
@@ -1406,17 +1411,17 @@ void OCrash::pass_situp(oentry* sprite)
     int16_t x_diff = (oferrari.car_x_diff * sprite->counter) >> 9;
     sprite->x += x_diff;
 
-    uint32_t frames = sprite->z + (sprite->xw1 << 3);
-    sprite->addr    = roms.rom0p->read32(frames);
-    sprite->pal_src = roms.rom0p->read8(4 + frames);
+    const oanimframe& f = oanimframes.get(sprite->z + (sprite->xw1 << 3));
+    sprite->addr    = f.addr;
+    sprite->pal_src = f.b[4];
 
     // Decrement frame delay counter
     if (--sprite->traffic_speed <= 0)
     {
-        sprite->traffic_speed = roms.rom0p->read8(0xF + frames) & 0x7F;
+        sprite->traffic_speed = f.next_b7 & 0x7F;
 
         // End of animation sequence. Progress to next sequnce of animations.
-        if (roms.rom0p->read8(7 + frames) & BIT_7)
+        if (f.b[7] & BIT_7)
         {
             sprite->reload = 2; // Passenger Control: Passengers turn head and look at car
         }
@@ -1440,12 +1445,12 @@ void OCrash::pass_turnhead(oentry* sprite)
     int16_t x_diff = (oferrari.car_x_diff * sprite->counter) >> 9;
     sprite->x += x_diff;
 
-    uint32_t frames = sprite->z + (sprite->xw1 << 3);
-    sprite->addr    = roms.rom0p->read32(frames);
-    sprite->pal_src = roms.rom0p->read8(4 + frames);
+    const oanimframe& f = oanimframes.get(sprite->z + (sprite->xw1 << 3));
+    sprite->addr    = f.addr;
+    sprite->pal_src = f.b[4];
 
     // End of animation sequence.
-    if (roms.rom0p->read8(7 + frames) & BIT_7)
+    if (f.b[7] & BIT_7)
     {
         done(sprite);
         return;
@@ -1454,7 +1459,7 @@ void OCrash::pass_turnhead(oentry* sprite)
     // Decrement frame delay counter
     if (--sprite->traffic_speed <= 0)
     {
-        sprite->traffic_speed = roms.rom0p->read8(0xF + frames) & 0x7F;
+        sprite->traffic_speed = f.next_b7 & 0x7F;
         sprite->xw1++; // Increase passenger frame
     }
 
@@ -19,6 +19,17 @@
     being able to debug the conversion.
     
     All in-game objects that populate the gameworld use this structure.
+
+    As in the original, each entry is a 64 byte block: aligned to a cache
+    line, so the routines iterating the jump table each tick touch one
+    line per entry rather than two for most of them.
+
+    The two fields the jump table is scanned by each tick, for every entry
+    whether in use or not (control, to see if it's enabled, and the routine
+    it runs), are held apart in a packed array (OSprites::hot), 32 entries
+    to a line, and reached here through control() and function_holder().
+    The scans read the array directly, so entries not in use aren't
+    touched at all.
     
     Copyright Chris White.
     See license.txt for more details.
@@ -28,9 +39,9 @@
 
 #include "stdint.hpp"
 
-class oentry
+// An entry's fields held in OSprites::hot (see above)
+struct oentry_hot
 {
-public:
 	// +00 [Byte] Bit 7 Enables/Disables Address
 	//            Bit 6
 	//            Bit 5 Set to Draw Sprite
@@ -41,11 +52,28 @@ public:
 	//            Bit 0 Set to Horizontally Flip Image
 	uint8_t control;
 
+	// +02 [Long] Jump Address
+	int8_t function_holder;
+};
+
+class alignas(64) oentry
+{
+public:
+	// Entries live in OSprites::jump_table alone: their index there finds their hot fields
+	oentry() = default;
+	oentry(const oentry&) = delete;
+	oentry& operator=(const oentry&) = delete;
+
+	// +00 control, in OSprites::hot. Defined with OSprites.
+	inline uint8_t& control();
+	inline uint8_t  control() const;
+
 	// +01 [Byte] Index Number of Jump 0,1,2,3 etc.
 	uint8_t jump_index;
 
-	// +02 [Long] Jump Address
-	int8_t function_holder;
+	// +02 function_holder, in OSprites::hot
+	inline int8_t& function_holder();
+	inline int8_t  function_holder() const;
 
 	// +06 [Byte] Multiple Uses. Used to identify sprites.
 	// E.g. Passenger Sprites: Denote Man (0) or Woman (1) Sprite.
@@ -159,9 +187,9 @@ public:
 	// Initalize to default values
 	void init(uint8_t i)
 	{
-        control = 0;
+        control() = 0;
         jump_index = i;
-		function_holder = -1;
+		function_holder() = -1;
 		id = 0;
 		shadow = 3;
 		zoom = 0;
@@ -191,3 +219,5 @@ public:
         hidden = 0;
 	}
 };
+
+static_assert(sizeof(oentry) == 64, "oentry should fill one cache line");
@@ -58,10 +58,10 @@ void OFerrari::init(oentry *f, oentry *p1, oentry *p2, oentry *s)
     spr_pass2   = p2;
     spr_shadow  = s;
 
-    spr_ferrari->control |= OSprites::ENABLE;
-    spr_pass1->control   |= OSprites::ENABLE;
-    spr_pass2->control   |= OSprites::ENABLE;
-    spr_shadow->control  |= OSprites::ENABLE;
+    spr_ferrari->control() |= OSprites::ENABLE;
+    spr_pass1->control()   |= OSprites::ENABLE;
+    spr_pass2->control()   |= OSprites::ENABLE;
+    spr_shadow->control()  |= OSprites::ENABLE;
 
     state             = 0;
     counter           = 0;
@@ -166,20 +166,20 @@ void OFerrari::tick()
             break;
 
         case FERRARI_INIT:
-            if (spr_ferrari->control & OSprites::ENABLE) 
+            if (spr_ferrari->control() & OSprites::ENABLE) 
                 if (outrun.tick_frame)
                     init_ingame();
             break;
 
         case FERRARI_LOGIC:
-            if (spr_ferrari->control & OSprites::ENABLE) 
+            if (spr_ferrari->control() & OSprites::ENABLE) 
             {
                 if (outrun.tick_frame)
                     logic();
                 else
                     draw_sprite(spr_ferrari);
             }
-            if (spr_pass1->control & OSprites::ENABLE) 
+            if (spr_pass1->control() & OSprites::ENABLE) 
             {
                 if (outrun.tick_frame)
                     set_passenger_sprite(spr_pass1);
@@ -187,7 +187,7 @@ void OFerrari::tick()
                     draw_sprite(spr_pass1);
             }
 
-            if (spr_pass2->control & OSprites::ENABLE)
+            if (spr_pass2->control() & OSprites::ENABLE)
             {
                 if (outrun.tick_frame)
                     set_passenger_sprite(spr_pass2);
@@ -409,9 +409,9 @@ void OFerrari::setup_ferrari_sprite()
     if (!ocrash.skid_counter)
     {
         if (d4 >= 0)
-            spr_ferrari->control &= ~OSprites::HFLIP;
+            spr_ferrari->control() &= ~OSprites::HFLIP;
         else
-            spr_ferrari->control |= OSprites::HFLIP;
+            spr_ferrari->control() |= OSprites::HFLIP;
 
         // 0x9E4E not_skidding:
 
@@ -447,11 +447,11 @@ void OFerrari::setup_ferrari_sprite()
 
         if (skid_counter < 0)
         {
-            spr_ferrari->control |= OSprites::HFLIP;
+            spr_ferrari->control() |= OSprites::HFLIP;
             skid_counter = -skid_counter; // Needs to be positive
         }
         else
-            spr_ferrari->control &= ~OSprites::HFLIP;
+            spr_ferrari->control() &= ~OSprites::HFLIP;
 
         int16_t frame = 0;
 
@@ -493,9 +493,9 @@ void OFerrari::setup_ferrari_bonus_sprite()
     spr_ferrari->priority = spr_ferrari->road_priority = 0x1FD;
 
     if (oinputs.steering_adjust > 0)
-        spr_ferrari->control &= ~OSprites::HFLIP;
+        spr_ferrari->control() &= ~OSprites::HFLIP;
     else
-        spr_ferrari->control |= OSprites::HFLIP;
+        spr_ferrari->control() |= OSprites::HFLIP;
 
     // Get abs version of ferrari turn
     int16_t turn_frame_offset = 0;
@@ -550,7 +550,7 @@ void OFerrari::do_end_seq()
     sprite_pass_y        = roms.rom0p->read8(4 + addr);  // Set Passenger Y Offset
     spr_ferrari->x       = roms.rom0p->read8(5 + addr);
     spr_ferrari->pal_src = ferrari_pal;//  roms.rom0p->read8(6 + addr);
-    spr_ferrari->control = roms.rom0p->read8(7 + addr) | (spr_ferrari->control & 0xFE); // HFlip
+    spr_ferrari->control() = roms.rom0p->read8(7 + addr) | (spr_ferrari->control() & 0xFE); // HFlip
 
     osprites.map_palette(spr_ferrari);
     osprites.do_spr_order_shadows(spr_ferrari);
@@ -857,7 +857,7 @@ void OFerrari::set_curve_adjust()
 // Source: 0xA7BC
 void OFerrari::draw_shadow()
 {
-    if (spr_shadow->control & OSprites::ENABLE)
+    if (spr_shadow->control() & OSprites::ENABLE)
     {
         if (outrun.game_state == GS_MUSIC) return;
 
@@ -899,7 +899,7 @@ void OFerrari::set_passenger_sprite(oentry* sprite)
 
     // Is this a bug in the original? Note that by negating HFLIP check the passengers
     // shift right a few pixels on acceleration.
-    if ((oinitengine.car_increment >> 16 >= 0x14) && !(spr_ferrari->control & OSprites::HFLIP))
+    if ((oinitengine.car_increment >> 16 >= 0x14) && !(spr_ferrari->control() & OSprites::HFLIP))
         frame += 4;
 
     // --------------------------------------------------------------------------------------------
@@ -11,8 +11,11 @@
     See license.txt for more details.
 ***************************************************************************/
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
 
+#include "main.hpp"
 #include "../utils.hpp"
 #include "engine/oferrari.hpp"
 #include "engine/outils.hpp"
@@ -82,6 +85,107 @@ void OHud::draw_fps_counter(int16_t fps)
     blit_text_new(30, 4, str.c_str());
 }
 
+// Performance HUD (video.fps_counter = 2, or F6), in place of the FPS counter. Shows the frame
+// rate and dropped frames, the 30/60fps mode, audio underruns, the time taken by the main stages
+// of the frame (see frametrace.hpp), the time from the controls being read to the frame they
+// steered being shown, a graph of recent frame times against the frame budget, and the two
+// engine subsystems taking longest per call in the stage and state being played (enginecost.hpp).
+void OHud::draw_perf_hud()
+{
+    const uint16_t X = 26;  // 14 columns, to the right hand side
+    const uint16_t Y = 4;
+    char line[32];
+
+    // Stage times, averaged over about half a second
+    static const char* STAGE_NAMES[PERF_STAGES] = { "TICK", "LAYERS", "FILTER", "UPLOAD", "DRAW", "PRESENT", "AUDIO", "FRAME", "INPUT" };
+    if (++perf_ticks >= 30) {
+        perf_ticks = 0;
+        for (int s = 0; s < PERF_STAGES; s++) {
+            // layers is the sum of the prepare stages
+            const int first = s == 0 ? frametrace::TICK
+                            : s == 1 ? frametrace::PREPARE
+                            : s == PERF_STAGES - 1 ? frametrace::LATENCY
+                            : frametrace::BLARGG + s - 2;
+            const int last  = s == 1 ? frametrace::BLARGG - 1 : first;
+            double ms = 0.0;
+            for (int point = first; point <= last; point++) {
+                uint64_t samples;
+                const double total = frametrace::total_ms(point, &samples);
+                if (samples > perf_samples[point])
+                    ms += (total - perf_total[point]) / double(samples - perf_samples[point]);
+                perf_total[point]   = total;
+                perf_samples[point] = samples;
+            }
+            perf_ms[s] = float(ms);
+        }
+
+        // Engine subsystems: a window only counts whilst the stage and state stay the same
+        int stage, state;
+        enginecost::get_context(&stage, &state);
+        const bool same = stage == perf_cost_stage && state == perf_cost_state;
+        double cost_ms[enginecost::SUBSYSTEMS] = {};
+        for (int s = 0; s < enginecost::SUBSYSTEMS; s++) {
+            uint64_t calls;
+            const double total = enginecost::total_ms(stage, state, s, &calls);
+            if (same && calls > perf_cost_calls[s])
+                cost_ms[s] = (total - perf_cost_total[s]) / double(calls - perf_cost_calls[s]);
+            perf_cost_total[s] = total;
+            perf_cost_calls[s] = calls;
+        }
+        perf_cost_stage = stage;
+        perf_cost_state = state;
+        if (same) {
+            int order[enginecost::SUBSYSTEMS];
+            for (int s = 0; s < enginecost::SUBSYSTEMS; s++) order[s] = s;
+            std::partial_sort(order, order + PERF_COSTS, order + enginecost::SUBSYSTEMS,
+                              [&](int a, int b) { return cost_ms[a] > cost_ms[b]; });
+            for (int r = 0; r < PERF_COSTS; r++) {
+                perf_cost_top[r] = order[r];
+                perf_cost_ms[r]  = float(cost_ms[order[r]]);
+            }
+        }
+    }
+
+    const Audio::ring_stats_t ring = cannonball::audio.get_ring_stats();
+    snprintf(line, sizeof(line), "FPS %2d DROP%2d", cannonball::fps_counter, std::min(cannonball::dropped_percent, 99));
+    blit_text_new(X, Y, line);
+    snprintf(line, sizeof(line), "%2d %s UR%4u", config.fps, cannonball::fps_lock ? "LOCK" : "AUTO",
+             std::min(ring.underruns, 9999u));
+    blit_text_new(X, Y + 1, line);
+    for (int s = 0; s < PERF_STAGES; s++) {
+        snprintf(line, sizeof(line), "%-8s%6.2f", STAGE_NAMES[s], std::min(perf_ms[s], 999.0f));
+        blit_text_new(X, Y + 2 + s, line);
+    }
+
+    // Frame time graph, newest on the right. The rows are filled above half the frame budget,
+    // above the budget (a frame missed), and above twice the budget.
+    const float budget = 1000.0f / float(config.fps);
+    std::memmove(frame_ms, frame_ms + 1, sizeof(frame_ms) - sizeof(frame_ms[0]));
+    frame_ms[PERF_GRAPH - 1] = float(frametrace::last_ms(frametrace::FRAME));
+    const float levels[3] = { budget * 2.0f, budget * 1.05f, budget * 0.5f };
+    for (int row = 0; row < 3; row++) {
+        char* c = line;
+        for (int i = 0; i < PERF_GRAPH; i++)
+            *c++ = frame_ms[i] > levels[row] ? 'I' : (row == 2 ? '.' : ' ');
+        *c = 0;
+        blit_text_new(X, Y + 2 + PERF_STAGES + row, line, row == 2 ? GREEN : PINK);
+    }
+    for (int r = 0; r < PERF_COSTS; r++) {
+        snprintf(line, sizeof(line), "%-8s%6.2f", enginecost::name(perf_cost_top[r]), std::min(perf_cost_ms[r], 999.0f));
+        blit_text_new(X, Y + 2 + PERF_STAGES + 3 + r, line);
+    }
+    perf_hud_shown = true;
+}
+
+// Remove the performance HUD from the text layer, if shown
+void OHud::clear_perf_hud()
+{
+    if (!perf_hud_shown) return;
+    for (uint16_t y = 4; y < 4 + PERF_ROWS; y++)
+        blit_text_new(26, y, "              ");
+    perf_hud_shown = false;
+}
+
 
 // Routine to setup and draw mini-map (bottom RHS of HUD)
 //
@@ -246,7 +350,7 @@ void OHud::draw_score(uint32_t addr, const uint32_t score, uint8_t font)
     // Blank tile for comparison purposes
     const uint16_t BLANK = 0x8020;
 
-    uint8_t* digits = new uint8_t[8];
+    uint8_t digits[8];
 
     // Topmost digit
     digits[0] = ((score >> 16) & 0xF000) >> 12;
@@ -274,7 +378,6 @@ void OHud::draw_score(uint32_t addr, const uint32_t score, uint8_t font)
     }
 
     video.write_text16(&addr, digits[7] + BASE); // Always draw last digit
-    delete[] digits;
 }
 
 // Same as above function but writes to tile ram instead.
@@ -287,7 +390,7 @@ void OHud::draw_score_tile(uint32_t addr, const uint32_t score, uint8_t font)
     // Blank tile for comparison purposes
     const uint16_t BLANK = 0x8020;
 
-    uint8_t* digits = new uint8_t[8];
+    uint8_t digits[8];
 
     // Topmost digit
     digits[0] = ((score >> 16) & 0xF000) >> 12;
@@ -315,7 +418,6 @@ void OHud::draw_score_tile(uint32_t addr, const uint32_t score, uint8_t font)
     }
 
     video.write_tile16(&addr, digits[7] + BASE); // Always draw last digit
-    delete[] digits;
 }
 
 // Modified Version Of Draw Digits
@@ -14,6 +14,8 @@
 #pragma once
 
 #include "outrun.hpp"
+#include "frametrace.hpp"
+#include "enginecost.hpp"
 
 class OHud
 {
@@ -35,6 +37,8 @@ public:
 
     void draw_main_hud();
     void draw_fps_counter(int16_t);
+    void draw_perf_hud();
+    void clear_perf_hud();
     void clear_timetrial_text();
     void do_mini_map();
     void draw_timer1(uint16_t);
@@ -61,6 +65,23 @@ public:
 
 private:
     void draw_mini_map(uint32_t);
+
+    // Performance HUD state (see draw_perf_hud)
+    static const int PERF_STAGES = 9;   // rows of stage times
+    static const int PERF_GRAPH  = 14;  // frames in the frame time graph
+    static const int PERF_COSTS  = 2;   // rows of costliest engine subsystems
+    static const int PERF_ROWS   = 2 + PERF_STAGES + 3 + PERF_COSTS;
+    bool     perf_hud_shown = false;
+    int      perf_ticks     = 30;
+    float    perf_ms[PERF_STAGES] = {};
+    float    frame_ms[PERF_GRAPH] = {};
+    double   perf_total[frametrace::POINTS]   = {};
+    uint64_t perf_samples[frametrace::POINTS] = {};
+    int      perf_cost_stage = -1, perf_cost_state = -1;
+    int      perf_cost_top[PERF_COSTS] = {};
+    float    perf_cost_ms[PERF_COSTS]  = {};
+    double   perf_cost_total[enginecost::SUBSYSTEMS] = {};
+    uint64_t perf_cost_calls[enginecost::SUBSYSTEMS] = {};
 };
 
 extern OHud ohud;
\ No newline at end of file
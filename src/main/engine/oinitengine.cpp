@@ -12,6 +12,7 @@
 ***************************************************************************/
 
 #include "trackloader.hpp"
+#include "ghost.hpp"
 
 #include "engine/oanimseq.hpp"
 #include "engine/obonus.hpp"
@@ -153,23 +154,22 @@ void OInitEngine::init_road_seg_master()
 void OInitEngine::update_road()
 {
     check_road_split(); // Check/Process road split if necessary
-    uint32_t addr = 0;
-    uint16_t d0 = trackloader.read_width_height(&addr);
+    uint16_t d0 = trackloader.wh_pos();
     // Update next road section
     if (d0 <= oroad.road_pos >> 16)
     {
         // Skip road width adjustment if set and adjust height
-        if (trackloader.read_width_height(&addr) == 0)
+        if (trackloader.wh_is_width() == 0)
         {
             // ROM:0000B8A6 skip_next_width
             if (oroad.height_lookup == 0)
-                 oroad.height_lookup = trackloader.read_width_height(&addr); // Set new height lookup section
+                 oroad.height_lookup = trackloader.wh_value(); // Set new height lookup section
         }
         else
         {
             // ROM:0000B87A
-            int16_t width  = trackloader.read_width_height(&addr); // Segment road width
-            int16_t change = trackloader.read_width_height(&addr); // Segment adjustment speed
+            int16_t width  = trackloader.wh_value();  // Segment road width
+            int16_t change = trackloader.wh_change(); // Segment adjustment speed
 
             if (width != (int16_t) (oroad.road_width >> 16))
             {
@@ -181,7 +181,7 @@ void OInitEngine::update_road()
                 change_width = -1; // Denote road width is changing
             }
         }
-        trackloader.wh_offset += 8;
+        trackloader.wh_index++;
     }
 
     // ROM:0000B8BC set_road_width    
@@ -224,7 +224,7 @@ void OInitEngine::update_road()
 
     // ROM:0000B91C set_road_type: 
 
-    int16_t segment_pos = trackloader.read_curve(0);
+    int16_t segment_pos = trackloader.curve_pos();
 
     if (segment_pos != -1)
     {
@@ -232,15 +232,15 @@ void OInitEngine::update_road()
 
         if (d1 <= (int16_t) (oroad.road_pos >> 16))
         {
-            road_curve_next = trackloader.read_curve(2);
-            road_type_next  = trackloader.read_curve(4);
+            road_curve_next = trackloader.curve_value();
+            road_type_next  = trackloader.curve_type();
         }
 
         if (segment_pos <= (int16_t) (oroad.road_pos >> 16))
         {
-            road_curve = trackloader.read_curve(2);
-            road_type  = trackloader.read_curve(4);
-            trackloader.curve_offset += 6;
+            road_curve = trackloader.curve_value();
+            road_type  = trackloader.curve_type();
+            trackloader.curve_index++;
             road_type_next = 0;
             road_curve_next = 0;
         }
@@ -301,7 +301,7 @@ void OInitEngine::update_engine()
         }
 
         if (config.engine.layout_debug)
-            ohud.draw_debug_info(oroad.road_pos, oroad.height_lookup_wrk, trackloader.read_sprite_pattern_index());
+            ohud.draw_debug_info(oroad.road_pos, oroad.height_lookup_wrk, trackloader.scenery_pattern());
     }
 
     if (olevelobjs.spray_counter > 0)
@@ -394,7 +394,7 @@ void OInitEngine::check_road_split()
 
         // State 8: Init Road Merge before checkpoint sign. Setting traffic_split = -1 causes
         //          OTraffic::tick_spawned_sprite() to swap traffic between roads using
-        //          sprite->control ^= OSprites::TRAFFIC_RHS.
+        //          sprite->control() ^= OSprites::TRAFFIC_RHS.
         //          This is probably the cause of the ghost cars.
         case 8:
             otraffic.traffic_split = -1;
@@ -473,6 +473,7 @@ void OInitEngine::check_stage()
 
         // Check for new best laptime
         int16_t counter = ostats.stage_counters[outrun.ttrial.current_lap];
+        ghost::end_lap(counter, counter < outrun.ttrial.best_lap_counter);
         if (counter < outrun.ttrial.best_lap_counter)
         {
             outrun.ttrial.best_lap_counter = counter;
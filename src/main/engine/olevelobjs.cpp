@@ -62,7 +62,7 @@ void OLevelObjs::init_entries(uint32_t a4, const uint8_t start_index, const uint
     {
         oentry *sprite = &osprites.jump_table[i];
 
-        sprite->control    = roms.rom0p->read8(&a4);
+        sprite->control()    = roms.rom0p->read8(&a4);
         sprite->draw_props = roms.rom0p->read8(&a4);
         sprite->shadow     = roms.rom0p->read8(&a4);
         sprite->pal_src    = roms.rom0p->read8(&a4);
@@ -81,7 +81,7 @@ void OLevelObjs::init_entries(uint32_t a4, const uint8_t start_index, const uint
         int16_t road_x = oroad.road0_h[z_orig];
         int16_t xw1 = sprite->xw1;
 
-        if (xw1 >= 0 && (sprite->control & OSprites::WIDE_ROAD) == 0)
+        if (xw1 >= 0 && (sprite->control() & OSprites::WIDE_ROAD) == 0)
         {
             xw1 += (oroad.road_width << 1) << 16;
         }
@@ -94,23 +94,23 @@ void OLevelObjs::init_entries(uint32_t a4, const uint8_t start_index, const uint
 
         // Hack to choose correct routine, and not use lookup table from ROM
         if (i >= 0 && i <= 27)
-            sprite->function_holder = 0; // SpriteCollisionZ1
+            sprite->function_holder() = 0; // SpriteCollisionZ1
         else if (i >= 28 && i <= 43)
-            sprite->function_holder = 7; // SpriteCollisionZ1C
+            sprite->function_holder() = 7; // SpriteCollisionZ1C
         else if (no_entries == HISCORE_SPRITE_ENTRIES)
-            sprite->function_holder = 8; // SpriteNoCollisionZ2;
+            sprite->function_holder() = 8; // SpriteNoCollisionZ2;
         // Vertical Sign on LHS with Lights
         else if (i == 44)
-            sprite->function_holder = 4; // Lights
+            sprite->function_holder() = 4; // Lights
         // Vertical Sign on RHS
         else if (i == 45)
-            sprite->function_holder = 0; // SpriteCollisionZ1
+            sprite->function_holder() = 0; // SpriteCollisionZ1
         // Two halves of start sign
         else if (i == 46 || i == 47)
-            sprite->function_holder = 0; // SpriteNoCollisionZ1
+            sprite->function_holder() = 0; // SpriteNoCollisionZ1
         // Crowd of people
         else if (i >= 48 && i <= 67)
-            sprite->function_holder = 8; // SpriteNoCollisionZ2;
+            sprite->function_holder() = 8; // SpriteNoCollisionZ2;
 
         osprites.map_palette(sprite);    
     }
@@ -126,7 +126,7 @@ void OLevelObjs::setup_sprites(uint32_t z)
     // Setup entries that have not yet been enabled
     for (uint8_t i = 0; i < osprites.no_sprites; i++)
     {
-        if ((osprites.jump_table[i].control & OSprites::ENABLE) == 0)
+        if ((osprites.hot[i].control & OSprites::ENABLE) == 0)
         {
             setup_sprite(&osprites.jump_table[i], z);
             return;
@@ -155,7 +155,7 @@ void OLevelObjs::setup_sprite(oentry* sprite, uint32_t z)
     #define READ16(x) trackloader.read16(trackloader.scenerymap_data, x)
     #define READ32(x) trackloader.read32(trackloader.scenerymap_data, x)
 
-    sprite->control |= OSprites::ENABLE; // Turn sprite on
+    sprite->control() |= OSprites::ENABLE; // Turn sprite on
     uint32_t addr = osprites.seg_spr_addr + osprites.seg_spr_offset1;
 
     // Set sprite x,y (world coordinates)
@@ -173,29 +173,29 @@ void OLevelObjs::setup_sprite(oentry* sprite, uint32_t z)
     sprite->z = z; // Set default zoom
     
     if (READ8(addr + 0) & 1)
-        sprite->control |= OSprites::HFLIP;
+        sprite->control() |= OSprites::HFLIP;
     else
-        sprite->control &=~ OSprites::HFLIP;
+        sprite->control() &=~ OSprites::HFLIP;
 
     if (READ8(addr + 0) & 2)
-        sprite->control |= OSprites::SHADOW;
+        sprite->control() |= OSprites::SHADOW;
     else
-        sprite->control &=~ OSprites::SHADOW;
+        sprite->control() &=~ OSprites::SHADOW;
 
     if ((int16_t) (oroad.road_width >> 16) > 0x118)
-        sprite->control |= OSprites::WIDE_ROAD;
+        sprite->control() |= OSprites::WIDE_ROAD;
     else
-        sprite->control &=~ OSprites::WIDE_ROAD;
+        sprite->control() &=~ OSprites::WIDE_ROAD;
 
     sprite->draw_props = READ8(addr + 0) & 0xF0;
-    sprite->function_holder = sprite->draw_props >> 4; // set sprite type
+    sprite->function_holder() = sprite->draw_props >> 4; // set sprite type
 
     setup_sprite_routine(sprite);
 }
 
 void OLevelObjs::setup_sprite_routine(oentry* sprite)
 {
-    switch (sprite->function_holder)
+    switch (sprite->function_holder())
     {
         // Normal Sprite: (Possible With/Without Collision)
         case 0:
@@ -206,7 +206,7 @@ void OLevelObjs::setup_sprite_routine(oentry* sprite)
         case 1: // Grass Sprite
         case 11:  // Stone Strips
             sprite->shadow = 7;
-            if (sprite->control & OSprites::HFLIP)
+            if (sprite->control() & OSprites::HFLIP)
                 sprite->draw_props |= 2;
             else
                 sprite->draw_props |= 1;
@@ -215,7 +215,7 @@ void OLevelObjs::setup_sprite_routine(oentry* sprite)
         // Overhead Clouds
         case 2: 
             sprite->shadow = 3;
-            if (sprite->control & OSprites::HFLIP)
+            if (sprite->control() & OSprites::HFLIP)
                 sprite->draw_props |= 0xA;
             else
                 sprite->draw_props |= 9;
@@ -231,7 +231,7 @@ void OLevelObjs::setup_sprite_routine(oentry* sprite)
         // Water Sprite
         case 3:
             sprite->shadow = 3;
-            if (sprite->control & OSprites::HFLIP)
+            if (sprite->control() & OSprites::HFLIP)
                 sprite->draw_props |= 2; // anchor x right
             else
                 sprite->draw_props |= 1; // anchor x left
@@ -249,7 +249,7 @@ void OLevelObjs::setup_sprite_routine(oentry* sprite)
         // Draw From Top Left Collision Check
         case 7:
             sprite->shadow = 7;
-            if (sprite->control & OSprites::HFLIP)
+            if (sprite->control() & OSprites::HFLIP)
                 sprite->draw_props |= 9;
             else
                 sprite->draw_props |= 0xA;
@@ -259,7 +259,7 @@ void OLevelObjs::setup_sprite_routine(oentry* sprite)
         case 10:
         case 14: // version for wider road widths
             sprite->shadow = 3;
-            if (sprite->control & OSprites::HFLIP)
+            if (sprite->control() & OSprites::HFLIP)
                 sprite->draw_props |= 2;
             else
                 sprite->draw_props |= 1;
@@ -268,7 +268,7 @@ void OLevelObjs::setup_sprite_routine(oentry* sprite)
         // Mini Tree
         case 12:
             sprite->shadow = 7;
-            if (sprite->control & OSprites::HFLIP)
+            if (sprite->control() & OSprites::HFLIP)
                 sprite->draw_props |= 0xA;
             else
                 sprite->draw_props |= 9;
@@ -282,102 +282,127 @@ void OLevelObjs::setup_sprite_routine(oentry* sprite)
     }
 }
 
+const uint8_t OLevelObjs::routine_batch[ROUTINES] = { 0, 1, 2, 1, 4, 5, 6, 7, 8, 9, 10, 11, 12, 1, 14 };
+
+// The enabled sprites are run a routine at a time, each batch in jump table order, so that
+// each routine's code and branches stay hot. Apart from the spray (see routine_batch), the
+// routines touch nothing of one another's, and their sprites are added to the sprite list in
+// jump table order as before (OSprites::defer_order), so the result is as if run in order.
 void OLevelObjs::do_sprite_routine()
 {
+    uint8_t start[ROUTINES + 1] = {};
+    uint8_t batched[OSprites::JUMP_ENTRIES_TOTAL];
+
     for (uint8_t i = 0; i < osprites.no_sprites; i++)
     {
-        oentry* sprite = &osprites.jump_table[i];
+        const oentry_hot& sprite = osprites.hot[i];
+        if ((sprite.control & OSprites::ENABLE) && uint8_t(sprite.function_holder) < ROUTINES)
+            start[routine_batch[sprite.function_holder] + 1]++;
+    }
+    for (uint8_t r = 0; r < ROUTINES; r++)
+        start[r + 1] += start[r];
+    const uint8_t total = start[ROUTINES];
+    for (uint8_t i = 0; i < osprites.no_sprites; i++)
+    {
+        const oentry_hot& sprite = osprites.hot[i];
+        if ((sprite.control & OSprites::ENABLE) && uint8_t(sprite.function_holder) < ROUTINES)
+            batched[start[routine_batch[sprite.function_holder]]++] = i;
+    }
 
-        if (sprite->control & OSprites::ENABLE)
-        {
-            switch (sprite->function_holder)
-            {
-                // Normal Sprite: (Possible With/Without Collision, Zoom 1)
-                case 0:
-                    if (sprite->yw == 0)
-                       sprite_normal(sprite, 1);
-                    else
-                       set_spr_zoom_priority(sprite, 1);
-                    break;
-
-                // Grass Sprite
-                case 1:
-                    sprite_grass(sprite);
-                    break;
-
-                // Sprite based clouds that span entire sky
-                case 2:
-                    sprite_clouds(sprite);
-                    break;
-
-                // Water on LHS of Stage 1
-                case 3:
-                    sprite_water(sprite);
-                    break;
-
-                // Start Lights & Base Pillar of Checkpoint Sign
-                case 4:
-                    sprite_lights(sprite);
-                    break;
-                
-                // 5 - Checkpoint (Bottom Of Sign)
-                case 5:
-                    set_spr_zoom_priority(sprite, 1);
-                    break;
-
-                // 6 - Checkpoint (Top Of Sign)
-                case 6:
-                    set_spr_zoom_priority(sprite, 1);
-                    // Have we passed the checkpoint?
-                    if (!(sprite->control & OSprites::ENABLE))
-                        oinitengine.checkpoint_marker = -1;
-                    break;
-
-                // Draw From Centre Collision Check
-                case 7:
-                    sprite_collision_z1c(sprite);
-                    break;
-
-                // Normal Sprite: (Collision, Zoom 2)
-                case 8:
-                    sprite_normal(sprite, 2);
-                    break;
-
-                // Wide Rocks on Stage 2
-                case 9:
-                    sprite_rocks(sprite);
-                    break;
-
-                // Sand Strips
-                case 10:
-                    do_thickness_sprite(sprite, outrun.adr.sprite_sand);
-                    break;
-
-                // Stone Strips
-                case 11:
-                    do_thickness_sprite(sprite, outrun.adr.sprite_stone);
-                    break;
-
-                // Mini-Tree (Stage 5, Level ID: 0x24)
-                case 12:
-                    sprite_minitree(sprite);
-                    break;
-                
-                // Track Debris on Stage 3a
-                case 13:
-                    sprite_debris(sprite);
-                    break;
-
-                // Sand (Again) - Used in end sequence #2
-                case 14:
-                    do_thickness_sprite(sprite, outrun.adr.sprite_sand);
-                    break;
-
-                /*default:
-                    std::cout << "do_sprite_routine() " << int16_t(sprite->function_holder) << std::endl;
-                    break;*/
-            }
-        }
+    osprites.defer_order();
+    for (uint8_t n = 0; n < total; n++)
+        run_routine(&osprites.jump_table[batched[n]]);
+    osprites.flush_order();
+}
+
+void OLevelObjs::run_routine(oentry* sprite)
+{
+    switch (sprite->function_holder())
+    {
+        // Normal Sprite: (Possible With/Without Collision, Zoom 1)
+        case 0:
+            if (sprite->yw == 0)
+               sprite_normal(sprite, 1);
+            else
+               set_spr_zoom_priority(sprite, 1);
+            break;
+
+        // Grass Sprite
+        case 1:
+            sprite_grass(sprite);
+            break;
+
+        // Sprite based clouds that span entire sky
+        case 2:
+            sprite_clouds(sprite);
+            break;
+
+        // Water on LHS of Stage 1
+        case 3:
+            sprite_water(sprite);
+            break;
+
+        // Start Lights & Base Pillar of Checkpoint Sign
+        case 4:
+            sprite_lights(sprite);
+            break;
+        
+        // 5 - Checkpoint (Bottom Of Sign)
+        case 5:
+            set_spr_zoom_priority(sprite, 1);
+            break;
+
+        // 6 - Checkpoint (Top Of Sign)
+        case 6:
+            set_spr_zoom_priority(sprite, 1);
+            // Have we passed the checkpoint?
+            if (!(sprite->control() & OSprites::ENABLE))
+                oinitengine.checkpoint_marker = -1;
+            break;
+
+        // Draw From Centre Collision Check
+        case 7:
+            sprite_collision_z1c(sprite);
+            break;
+
+        // Normal Sprite: (Collision, Zoom 2)
+        case 8:
+            sprite_normal(sprite, 2);
+            break;
+
+        // Wide Rocks on Stage 2
+        case 9:
+            sprite_rocks(sprite);
+            break;
+
+        // Sand Strips
+        case 10:
+            do_thickness_sprite(sprite, outrun.adr.sprite_sand);
+            break;
+
+        // Stone Strips
+        case 11:
+            do_thickness_sprite(sprite, outrun.adr.sprite_stone);
+            break;
+
+        // Mini-Tree (Stage 5, Level ID: 0x24)
+        case 12:
+            sprite_minitree(sprite);
+            break;
+        
+        // Track Debris on Stage 3a
+        case 13:
+            sprite_debris(sprite);
+            break;
+
+        // Sand (Again) - Used in end sequence #2
+        case 14:
+            do_thickness_sprite(sprite, outrun.adr.sprite_sand);
+            break;
+
+        /*default:
+            std::cout << "do_sprite_routine() " << int16_t(sprite->function_holder()) << std::endl;
+            break;*/
     }
 }
 
@@ -398,7 +423,7 @@ void OLevelObjs::sprite_normal(oentry *sprite, uint8_t zoom)
     int16_t x2; 
 
     // H-Flip - swap x co-ordinates
-    if (sprite->control & OSprites::HFLIP)
+    if (sprite->control() & OSprites::HFLIP)
     {
         x2 = (int16_t) roms.rom0.read16(&offset_addr);
         x1 = (int16_t) roms.rom0.read16(&offset_addr);
@@ -442,7 +467,7 @@ void OLevelObjs::sprite_lights(oentry *sprite)
     int16_t x2; 
 
     // H-Flip - swap x co-ordinates
-    if (sprite->control & OSprites::HFLIP)
+    if (sprite->control() & OSprites::HFLIP)
     {
         x2 = (int16_t) roms.rom0.read16(&offset_addr);
         x1 = (int16_t) roms.rom0.read16(&offset_addr);
@@ -527,11 +552,11 @@ void OLevelObjs::set_spr_zoom_priority(oentry *sprite, uint8_t zoom)
     if (xw1 >= 0)
     {
         // Bit of a hack here to avoid code duplication
-        if (sprite->function_holder >= 4 && sprite->function_holder <= 6) 
+        if (sprite->function_holder() >= 4 && sprite->function_holder() <= 6) 
             xw1 += (oroad.road_width >> 16) << 1;
         else
         {
-            if ((sprite->control & OSprites::WIDE_ROAD) == 0)
+            if ((sprite->control() & OSprites::WIDE_ROAD) == 0)
                 xw1 += (oroad.road_width >> 16) << 1;
         }
     }
@@ -564,7 +589,7 @@ void OLevelObjs::sprite_collision_z1c(oentry* sprite)
     int16_t x2; 
 
     // H-Flip - swap x co-ordinates
-    if (sprite-> control & OSprites::HFLIP)
+    if (sprite->control() & OSprites::HFLIP)
     {
         x2 = (int16_t) roms.rom0.read16(&offset_addr);
         x1 = (int16_t) roms.rom0.read16(&offset_addr);
@@ -626,7 +651,7 @@ void OLevelObjs::set_spr_zoom_priority2(oentry *sprite, uint8_t zoom)
     int16_t road_x = oroad.road0_h[z16];
     int16_t xw1 = sprite->xw1;
 
-    if (xw1 >= 0 && (sprite->control & OSprites::WIDE_ROAD) == 0)
+    if (xw1 >= 0 && (sprite->control() & OSprites::WIDE_ROAD) == 0)
     {
         xw1 +=  ((int16_t) (oroad.road_width >> 16)) << 1;
     }
@@ -657,8 +682,8 @@ void OLevelObjs::sprite_water(oentry* sprite)
 
         }
         // Check whether to initialise spray
-        else if (((sprite->control & OSprites::HFLIP) == 0               && sprite->x < 0) ||
-                 ((sprite->control & OSprites::HFLIP) == OSprites::HFLIP && sprite->x > 0))
+        else if (((sprite->control() & OSprites::HFLIP) == 0               && sprite->x < 0) ||
+                 ((sprite->control() & OSprites::HFLIP) == OSprites::HFLIP && sprite->x > 0))
         {
             spray_counter = SPRAY_RESET;
             spray_type = 0;
@@ -680,8 +705,8 @@ void OLevelObjs::sprite_grass(oentry* sprite)
 
         }
         // Check whether to initialise spray
-        else if (((sprite->control & OSprites::HFLIP) == 0               && sprite->x < 0) ||
-                 ((sprite->control & OSprites::HFLIP) == OSprites::HFLIP && sprite->x > 0))
+        else if (((sprite->control() & OSprites::HFLIP) == 0               && sprite->x < 0) ||
+                 ((sprite->control() & OSprites::HFLIP) == OSprites::HFLIP && sprite->x > 0))
         {
             spray_counter = SPRAY_RESET;
             spray_type = 4; // Set Spray Type = Yellow
@@ -778,7 +803,7 @@ void OLevelObjs::sprite_debris(oentry* sprite)
     int16_t x2; 
 
     // H-Flip - swap x co-ordinates
-    if (sprite->control & OSprites::HFLIP)
+    if (sprite->control() & OSprites::HFLIP)
     {
         x2 = (int16_t) roms.rom0.read16(&offset_addr);
         x1 = (int16_t) roms.rom0.read16(&offset_addr);
@@ -910,7 +935,7 @@ void OLevelObjs::do_thickness_sprite(oentry* sprite, const uint32_t sprite_table
 
     if (xw1 >= 0)
     {
-        if (sprite->id != 14 || (sprite->control & OSprites::WIDE_ROAD) == 0) // Rolled in separate routine with this one line. (Sand 2 used in bonus sequence)
+        if (sprite->id != 14 || (sprite->control() & OSprites::WIDE_ROAD) == 0) // Rolled in separate routine with this one line. (Sand 2 used in bonus sequence)
             xw1 += ((int16_t) (oroad.road_width >> 16)) << 1;
     }
 
@@ -974,7 +999,7 @@ void OLevelObjs::sprite_rocks(oentry *sprite)
     int16_t x2; 
 
     // H-Flip - swap x co-ordinates
-    if (sprite->control & OSprites::HFLIP)
+    if (sprite->control() & OSprites::HFLIP)
     {
         x2 = (int16_t) roms.rom0.read16(&offset_addr);
         x1 = (int16_t) roms.rom0.read16(&offset_addr);
@@ -1033,7 +1058,7 @@ void OLevelObjs::set_spr_zoom_priority_rocks(oentry *sprite, uint8_t zoom)
     int16_t road_x = oroad.road0_h[z16];
     int16_t xw1 = sprite->xw1;
    
-    if (xw1 >= 0 && (sprite->control & OSprites::WIDE_ROAD) == 0)
+    if (xw1 >= 0 && (sprite->control() & OSprites::WIDE_ROAD) == 0)
     {
         xw1 +=  ((int16_t) (oroad.road_width >> 16)) << 1;
     }
@@ -1055,5 +1080,5 @@ void OLevelObjs::hide_sprite(oentry *sprite)
 {
     sprite->z = 0;
     sprite->zoom = 0; // Hide the sprite
-    sprite->control &= ~OSprites::ENABLE; // Disable entry in jump table
+    sprite->control() &= ~OSprites::ENABLE; // Disable entry in jump table
 }
\ No newline at end of file
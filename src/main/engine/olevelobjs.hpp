@@ -59,9 +59,16 @@ class OLevelObjs
         const static uint8_t HISCORE_SPRITE_ENTRIES = 0x40;
 
         const static uint8_t COLLISION_RESET = 4;
+
+        // Sprite routines (oentry::function_holder), and the batch each is run in by
+        // do_sprite_routine(). Grass, water and debris all set the wheel spray, which the last
+        // of them run has the say over, so they share a batch to keep jump table order.
+        const static uint8_t ROUTINES = 15;
+        const static uint8_t routine_batch[ROUTINES];
         const static uint16_t SPRAY_RESET = 0xC;
 
         void init_entries(uint32_t, const uint8_t start_index, const uint8_t);
+        void run_routine(oentry*);
 	    void setup_sprite(oentry*, uint32_t);
 	    void setup_sprite_routine(oentry*);		
         void sprite_collision_z1c(oentry*);
@@ -59,7 +59,7 @@ void OLogo::disable()
     // Enable block of sprites
     for (int i = entry_start; i < entry_start + 7; i++)
     {
-        osprites.jump_table[i].control &= ~OSprites::ENABLE;
+        osprites.jump_table[i].control() &= ~OSprites::ENABLE;
     }
 }
 
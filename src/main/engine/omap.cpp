@@ -153,7 +153,7 @@ void OMap::blit()
     for (uint8_t i = 0; i <= MAP_PIECES; i++)
     {
         oentry* sprite = &osprites.jump_table[i];
-        if (sprite->control & OSprites::ENABLE)
+        if (sprite->control() & OSprites::ENABLE)
             osprites.do_spr_order_shadows(sprite);
     }
 }
@@ -195,7 +195,7 @@ void OMap::draw_course_map()
     // Draw Backdrop Map Pieces
     for (uint8_t i = 26; i <= MAP_PIECES; i++)
     {
-        if (sprite->control & OSprites::ENABLE)
+        if (sprite->control() & OSprites::ENABLE)
             osprites.do_spr_order_shadows(sprite++);
     }
 }
@@ -232,7 +232,7 @@ void OMap::load_sprites()
     {
         oentry* sprite     = &osprites.jump_table[i];
         sprite->id         = i+1;
-        sprite->control    = roms.rom0p->read8(&adr);
+        sprite->control()    = roms.rom0p->read8(&adr);
         sprite->draw_props = roms.rom0p->read8(&adr);
         sprite->shadow     = roms.rom0p->read8(&adr);
         sprite->zoom       = roms.rom0p->read8(&adr);
@@ -323,21 +323,21 @@ void OMap::map_display()
 // Source: 0x3740
 void OMap::draw_vert_top(oentry* sprite)
 {
-    if (sprite->control & OSprites::ENABLE)
+    if (sprite->control() & OSprites::ENABLE)
         draw_piece(sprite, outrun.adr.sprite_coursemap_top);
 }
 
 // Source: 0x3736
 void OMap::draw_vert_bottom(oentry* sprite)
 {
-    if (sprite->control & OSprites::ENABLE)
+    if (sprite->control() & OSprites::ENABLE)
         draw_piece(sprite, outrun.adr.sprite_coursemap_bot);
 }
 
 // Source: 0x372C
 void OMap::draw_horiz_end(oentry* sprite)
 {
-    if (sprite->control & OSprites::ENABLE)
+    if (sprite->control() & OSprites::ENABLE)
         draw_piece(sprite, outrun.adr.sprite_coursemap_end);
 }
 
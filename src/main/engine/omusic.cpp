@@ -110,7 +110,7 @@ void OMusic::disable()
     // Disable block of sprites
     for (int i = entry_start; i < entry_start + 5; i++)
     {
-        osprites.jump_table[i].control &= ~OSprites::ENABLE;
+        osprites.jump_table[i].control() &= ~OSprites::ENABLE;
     }
 
     video.tile_layer->set_x_clamp(video.tile_layer->RIGHT);
@@ -29,6 +29,8 @@
 #include "engine/oinputs.hpp"
 #include "engine/ooutputs.hpp"
 #include "directx/ffeedback.hpp"
+#include "haptics.hpp"
+#include "outlink.hpp"
 
 OOutputs::OOutputs(void)
 {
@@ -42,6 +44,11 @@ OOutputs::OOutputs(void)
     limit_left         = 0;
     limit_right        = 0;
     motor_enabled      = true;
+    motor_input        = 0;
+    motor_threaded     = false;
+    motor_fresh        = false;
+    motor_in           = MotorInputs();
+    motor_latest       = MotorInputs();
 }
 
 OOutputs::~OOutputs(void)
@@ -53,6 +60,7 @@ OOutputs::~OOutputs(void)
 // Source: 0xECE8
 void OOutputs::init()
 {
+    std::lock_guard<std::mutex> lock(motor_mutex);
     motor_state        = STATE_INIT;
     hw_motor_control   = MOTOR_OFF;
     hw_motor_control_old = MOTOR_OFF;
@@ -85,6 +93,7 @@ void OOutputs::set_mode(int m)
 
 void OOutputs::tick(int16_t input_motor)
 {
+    motor_input = input_motor;
     switch (mode)
     {
         case MODE_DISABLED:
@@ -92,6 +101,7 @@ void OOutputs::tick(int16_t input_motor)
 
         // Force Feedback Steering Wheels
         case MODE_FFEEDBACK:
+            capture_motor_inputs(motor_in);
             do_motors(mode, input_motor);   // Use X-Position of wheel instead of motor position
             motor_output(hw_motor_control); // Force Feedback Handling
             break;
@@ -100,7 +110,20 @@ void OOutputs::tick(int16_t input_motor)
         case MODE_CABINET:
             if (config.smartypi.cabinet == Config::CABINET_MOVING)
             {
-                do_motors(mode, input_motor);
+                std::lock_guard<std::mutex> lock(motor_mutex);
+                if (motor_threaded && outrun.game_state != GS_CALIBRATE_MOTOR)
+                {
+                    // motor_step() runs the motor from this
+                    capture_motor_inputs(motor_latest);
+                    motor_posted = std::chrono::steady_clock::now();
+                    motor_fresh  = true;
+                }
+                else
+                {
+                    motor_fresh = false;
+                    capture_motor_inputs(motor_in);
+                    do_motors(mode, input_motor);
+                }
             }
             else
             {
@@ -118,8 +141,48 @@ void OOutputs::tick(int16_t input_motor)
     }
 }
 
+// Moving cabinet, motor thread: one step of the motor code, from the engine state last posted
+// by tick(). False, with nothing done, if the game hasn't posted any of late.
+bool OOutputs::motor_step(int16_t input_motor)
+{
+    std::lock_guard<std::mutex> lock(motor_mutex);
+    if (!motor_fresh || std::chrono::steady_clock::now() - motor_posted > std::chrono::milliseconds(250))
+        return false;
+
+    motor_in    = motor_latest;
+    motor_input = input_motor;
+    do_motors(mode, input_motor);
+    return true;
+}
+
+int16_t OOutputs::motor_position()
+{
+    return motor_input;
+}
+
+uint8_t OOutputs::digital()
+{
+    return dig_out;
+}
+
+void OOutputs::capture_motor_inputs(MotorInputs& in)
+{
+    in.game_state      = outrun.game_state;
+    in.crash_counter   = ocrash.crash_counter;
+    in.skid_counter    = ocrash.skid_counter;
+    in.car_inc         = oinitengine.car_increment >> 16;
+    in.wheel_state     = oferrari.wheel_state;
+    in.road_curve      = oinitengine.road_curve;
+    in.steering_adjust = oinputs.steering_adjust;
+    in.car_x_diff      = oferrari.car_x_diff;
+}
+
 void OOutputs::writeDigitalToConsole()
 {
+    // Binary link, every tick (see outlink.hpp). The motor thread sends it instead, when running.
+    if (config.smartypi.enabled && !motor_threaded)
+        outlink::post(dig_out, hw_motor_control, motor_input);
+
     if (config.smartypi.enabled && config.smartypi.ouputs)
     {
         if ((dig_out & D_BRAKE_LAMP) != (dig_out_old & D_BRAKE_LAMP))
@@ -163,6 +226,9 @@ int OOutputs::is_set(uint8_t output)
 
 bool OOutputs::diag_motor(int16_t input_motor, uint8_t hw_motor_limit)
 {
+    std::lock_guard<std::mutex> lock(motor_mutex);
+    motor_fresh = false;
+    motor_input = input_motor;
     switch (motor_state)
     {
         // Initalize
@@ -311,6 +377,9 @@ void OOutputs::diag_done()
 
 bool OOutputs::calibrate_motor(int16_t input_motor, uint8_t hw_motor_limit)
 {
+    std::lock_guard<std::mutex> lock(motor_mutex);
+    motor_fresh = false;
+    motor_input = input_motor;
     switch (motor_state)
     {
         // Initalize
@@ -558,22 +627,22 @@ void OOutputs::do_motors(int MODE, int16_t input_motor)
     }
 
     // In-Game: Test for crash, skidding, whether car is moving
-    if (outrun.game_state == GS_INGAME)
+    if (motor_in.game_state == GS_INGAME)
     {
-        if (ocrash.crash_counter)
+        if (motor_in.crash_counter)
         {
-            if ((oinitengine.car_increment >> 16) <= 0x14)
+            if (motor_in.car_inc <= 0x14)
                 car_stationary();
             else
                 do_motor_crash();
         }
-        else if (ocrash.skid_counter)
+        else if (motor_in.skid_counter)
         {
             do_motor_crash();
         }
         else
         {
-            if ((oinitengine.car_increment >> 16) <= 0x14)
+            if (motor_in.car_inc <= 0x14)
             {
                 if (!was_small_change)
                     done();
@@ -603,29 +672,29 @@ void OOutputs::car_moving(const int MODE)
     }
     
     // Motor is not currently moving. Setup new movement as necessary.
-    if (oferrari.wheel_state != OFerrari::WHEELS_ON)
+    if (motor_in.wheel_state != OFerrari::WHEELS_ON)
     {
         do_motor_offroad();
         return;
     }
 
-    const uint16_t car_inc = oinitengine.car_increment >> 16;
+    const uint16_t car_inc = motor_in.car_inc;
     if (car_inc <= 0x64)                    speed = 0;
     else if (car_inc <= 0xA0)               speed = 1 << 3;
     else if (car_inc <= 0xDC)               speed = 2 << 3;
     else                                    speed = 3 << 3;
 
-    if (oinitengine.road_curve == 0)         curve = 0;
-    else if (oinitengine.road_curve <= 0x3C) curve = 2; // sharp curve
-    else if (oinitengine.road_curve <= 0x5A) curve = 1; // gentle curve
+    if (motor_in.road_curve == 0)         curve = 0;
+    else if (motor_in.road_curve <= 0x3C) curve = 2; // sharp curve
+    else if (motor_in.road_curve <= 0x5A) curve = 1; // gentle curve
     else                                     curve = 0;
 
-    int16_t steering = oinputs.steering_adjust;
+    int16_t steering = motor_in.steering_adjust;
     steering += (movement_adjust1 + movement_adjust2 + movement_adjust3);
     steering >>= 2;
     movement_adjust3 = movement_adjust2;                   // Trickle down values
     movement_adjust2 = movement_adjust1;
-    movement_adjust1 = oinputs.steering_adjust;
+    movement_adjust1 = motor_in.steering_adjust;
 
     // Veer Left
     if (steering >= 0)
@@ -773,9 +842,9 @@ void OOutputs::adjust_motor()
 // Source: 0xE994
 void OOutputs::do_motor_crash()
 {
-    if (oferrari.car_x_diff == 0)
+    if (motor_in.car_x_diff == 0)
         set_value(MOTOR_VALUES_OFFROAD1, 3);
-    else if (oferrari.car_x_diff < 0)
+    else if (motor_in.car_x_diff < 0)
         set_value(MOTOR_VALUES_OFFROAD4, 3);
     else
         set_value(MOTOR_VALUES_OFFROAD3, 3);
@@ -785,9 +854,9 @@ void OOutputs::do_motor_crash()
 // Source: 0xE9BE
 void OOutputs::do_motor_offroad()
 {
-    const uint8_t* table = (oferrari.wheel_state != OFerrari::WHEELS_OFF) ? MOTOR_VALUES_OFFROAD2 : MOTOR_VALUES_OFFROAD1;
+    const uint8_t* table = (motor_in.wheel_state != OFerrari::WHEELS_OFF) ? MOTOR_VALUES_OFFROAD2 : MOTOR_VALUES_OFFROAD1;
 
-    const uint16_t car_inc = oinitengine.car_increment >> 16;
+    const uint16_t car_inc = motor_in.car_inc;
     uint8_t index;
     if (car_inc <= 0x32)      index = 0;
     else if (car_inc <= 0x50) index = 1;
@@ -832,7 +901,7 @@ void OOutputs::motor_output(uint8_t cmd)
     else if (cmd > MOTOR_CENTRE) // right
         force = 15 - cmd;
 
-    forcefeedback::set(cmd, force);
+    haptics::force(cmd, force);
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include "stdint.hpp"
 
 struct CoinChute
@@ -39,7 +42,9 @@ public:
     // 5 = Left
     // 8 = Centre
     // B = Right
-    uint8_t hw_motor_control, hw_motor_control_old;
+    // Atomic, as the motor thread writes it (see motorloop.hpp)
+    std::atomic<uint8_t> hw_motor_control;
+    uint8_t hw_motor_control_old;
 
     // Digital Outputs
     enum
@@ -70,10 +75,43 @@ public:
     int is_set(uint8_t);
     void coin_chute_out(CoinChute* chute, bool insert);
 
+    // Moving cabinet motor on a thread of its own (see motorloop.hpp). Set by motorloop:
+    // tick() then only takes the engine state for the motor, and motor_step() runs it.
+    std::atomic<bool> motor_threaded;
+    bool motor_step(int16_t input_motor);
+    int16_t motor_position();
+    uint8_t digital();
+
 private:
     int mode;
 
-    uint8_t dig_out, dig_out_old;
+    std::atomic<uint8_t> dig_out;
+    uint8_t dig_out_old;
+
+    // Motor (or wheel) position last passed in, for the output link
+    std::atomic<int16_t> motor_input;
+
+    // The engine state the motor code reads, taken on the game thread
+    struct MotorInputs
+    {
+        int8_t   game_state;
+        int16_t  crash_counter;
+        int16_t  skid_counter;
+        uint16_t car_inc;           // oinitengine.car_increment >> 16
+        uint8_t  wheel_state;
+        int16_t  road_curve;
+        int16_t  steering_adjust;
+        int16_t  car_x_diff;
+    };
+    MotorInputs motor_in;           // used by do_motors()
+
+    // Held whilst the motor state is read or changed, once the motor thread runs
+    std::mutex motor_mutex;
+    MotorInputs motor_latest;       // posted by tick() for motor_step()
+    std::chrono::steady_clock::time_point motor_posted;
+    bool motor_fresh;               // motor_latest is from the game, not calibration or menus
+
+    void capture_motor_inputs(MotorInputs& in);
 
     const static uint16_t STATE_INIT   = 0;
     const static uint16_t STATE_DELAY  = 1;
@@ -40,10 +40,12 @@ void OPalette::setup_sky_palette()
 {
     // Read Address of sky palette information from index
     uint32_t src = trackloader.read_pal_sky_table(trackloader.current_level->pal_sky);
-    uint32_t dst = 0x120F00; // palette ram
+    uint32_t sky[0x20];
 
     for (int16_t i = 0; i <= 0x1F; i++)
-        video.write_pal32(&dst, trackloader.read32(trackloader.pal_sky_data, &src));
+        sky[i] = trackloader.read32(trackloader.pal_sky_data, &src);
+
+    video.write_pal32(0x120F00, sky, 0x20); // palette ram
 }
 
 // Setup data in RAM necessary for sky palette fade.
@@ -182,35 +184,24 @@ void OPalette::fade_sky_pal_entry(const uint16_t start_colour, const uint16_t en
     g2 = (g2 - g1) >> 5;
     b2 = (b2 - b1) >> 5;
 
+    // Step i is the start colour plus i + 1 differences (wrapping as the 16-bit adds of the
+    // original did), so the steps don't depend on each other and are worked out together
+    uint16_t rgb[0x1E];
     for (int16_t i = 0; i < 0x1E; i++)
     {
-        r1 += r2;
-        g1 += g2;
-        b1 += b2;
-
-        uint16_t r_bak = r1;
-        uint16_t g_bak = g1;
-        uint16_t b_bak = b1;
-
-        // new value!
-        uint16_t rgb = (((r1 >> 6) & 1) << 12) | (((g1 >> 6) & 1) << 13) | (((b1 >> 6) & 1) << 14); // bit 0
-        r1 = ((r1 >> 7) & 0xF);
-        g1 = ((g1 >> 7) & 0xF) << 4;
-        b1 = ((b1 >> 7) & 0xF) << 8;
-        rgb |= r1 | g1 | b1;
-
-        // Hack due to using longs
-        if (addr & 1)
-            pal_manip[addr >> 1] = (pal_manip[addr >> 1] & 0xFFFF0000) | rgb;
-        else
-            pal_manip[addr >> 1] = (pal_manip[addr >> 1] & 0xFFFF) | (rgb << 16);
-
-        addr += 0x40; // another hack
-
-        r1 = r_bak;
-        g1 = g_bak;
-        b1 = b_bak;
+        const uint16_t r = uint16_t(r1 + (i + 1) * r2);
+        const uint16_t g = uint16_t(g1 + (i + 1) * g2);
+        const uint16_t b = uint16_t(b1 + (i + 1) * b2);
+
+        rgb[i] = (((r >> 6) & 1) << 12) | (((g >> 6) & 1) << 13) | (((b >> 6) & 1) << 14) | // bit 0
+                 ((r >> 7) & 0xF) | (((g >> 7) & 0xF) << 4) | (((b >> 7) & 0xF) << 8);
     }
+
+    // Hack due to using longs: one word of the entry in each of the 0x1E palettes
+    const uint32_t keep  = (addr & 1) ? 0xFFFF0000 : 0xFFFF;
+    const int      shift = (addr & 1) ? 0 : 16;
+    for (int16_t i = 0; i < 0x1E; i++, addr += 0x40)
+        pal_manip[addr >> 1] = (pal_manip[addr >> 1] & keep) | (uint32_t(rgb[i]) << shift);
 }
 
 // - Cycle sky palette colours on level transition.
@@ -242,10 +233,7 @@ void OPalette::cycle_sky_palette()
     // Note that this aligns the palette to memory addresses at blocks of 0x80 bytes. (or 4*1F Longs)
     pal_index <<= 5;
 
-    uint32_t pal_addr = 0x120F00; // dst
-
-    for (int16_t i = 0; i <= 0x1F; i++)
-        video.write_pal32(&pal_addr, pal_manip[i + pal_index]);
+    video.write_pal32(0x120F00, &pal_manip[pal_index], 0x20); // dst
 }
 
 // ----------------------------------------------------------------------------
@@ -470,26 +458,19 @@ void OPalette::repack_rgb(const uint32_t addr)
 // Source: 0x93F0
 void OPalette::write_fade_to_palram()
 {
+    uint16_t road[8], ground[16];
     uint32_t src = 1;
-    uint32_t road1_pal_addr = 0x120800; // Road 1 palette
-    uint32_t road2_pal_addr = 0x120810; // Road 2 palette
 
-    for (int16_t i = 0; i < 8; i++)
-    {
-        video.write_pal16(&road1_pal_addr, pal_fade[src]);
-        video.write_pal16(&road2_pal_addr, pal_fade[src]);
-        src += 9;
-    }
+    for (int16_t i = 0; i < 8; i++, src += 9)
+        road[i] = pal_fade[src];
 
-    road1_pal_addr = 0x120840;
-    road2_pal_addr = 0x120860;
+    for (int16_t i = 0; i < 16; i++, src += 9)
+        ground[i] = pal_fade[src];
 
-    for (int16_t i = 0; i < 16; i++)
-    {
-        video.write_pal16(&road1_pal_addr, pal_fade[src]);
-        video.write_pal16(&road2_pal_addr, pal_fade[src]);
-        src += 9;
-    }
+    video.write_pal16(0x120800, road, 8);     // Road 1 palette
+    video.write_pal16(0x120810, road, 8);     // Road 2 palette
+    video.write_pal16(0x120840, ground, 16);  // Ground 1 palette
+    video.write_pal16(0x120860, ground, 16);  // Ground 2 palette
 }
 
 // ----------------------------------------------------------------------------
@@ -502,15 +483,13 @@ void OPalette::setup_ground_color()
 {
     // Read Address of ground palette information
     uint32_t src = trackloader.read_pal_gnd_table(trackloader.current_level->pal_gnd);
-    uint32_t dst_pal_ground1 = 0x120840; // palette ram: ground 1
-    uint32_t dst_pal_ground2 = 0x120860; // palette ram: ground 2
+    uint32_t ground[8];
 
     for (int16_t i = 0; i < 8; i++)
-    {
-        uint32_t data = trackloader.read32(trackloader.pal_gnd_data, &src);
-        video.write_pal32(&dst_pal_ground1, data);
-        video.write_pal32(&dst_pal_ground2, data);
-    }
+        ground[i] = trackloader.read32(trackloader.pal_gnd_data, &src);
+
+    video.write_pal32(0x120840, ground, 8); // palette ram: ground 1
+    video.write_pal32(0x120860, ground, 8); // palette ram: ground 2
 }
 
 void OPalette::setup_road_centre()
@@ -18,6 +18,8 @@
     See license.txt for more details.
 ***************************************************************************/
 
+#include <algorithm>
+#include <cstdlib>
 #include "stdint.hpp"
 #include "globals.hpp"
 #include "roms.hpp"
@@ -28,6 +30,7 @@
 #include "engine/oinitengine.hpp"
 
 #include "engine/oroad.hpp"
+#include "frametrace.hpp"
 #include "engine/ostats.hpp"
 
 ORoad oroad;
@@ -43,6 +46,8 @@ ORoad::~ORoad(void)
 
 void ORoad::tick()
 {
+    frametrace::Scope trace(frametrace::ROAD_TICK);
+
     // Enhancement: Adjust View
     if (horizon_target != horizon_offset)
     {
@@ -80,6 +85,8 @@ void ORoad::init()
     // Extra initalization code here
     set_view_mode(VIEW_ORIGINAL, true);
     road_pos         = 0;
+    hscroll_prev_set = false;
+    hscroll_pending  = false;
     tilemap_h_target = 0;
     stage_lookup_off = 0;
     road_width_bak   = 0;
@@ -199,13 +206,39 @@ void ORoad::do_road()
     set_horizon_y();
     do_road_data();
     blit_roads();
-    output_hscroll(&road0_h[0], HW_HSCROLL_TABLE0);
-    output_hscroll(&road1_h[0], HW_HSCROLL_TABLE1);
+    hscroll_pending = config.interpolate && hscroll_prev_set;
+    if (hscroll_pending)
+    {
+        output_hscroll_mid(&road0_h[0], hscroll_prev[0], HW_HSCROLL_TABLE0);
+        output_hscroll_mid(&road1_h[0], hscroll_prev[1], HW_HSCROLL_TABLE1);
+    }
+    else
+    {
+        output_hscroll(&road0_h[0], HW_HSCROLL_TABLE0);
+        output_hscroll(&road1_h[0], HW_HSCROLL_TABLE1);
+    }
+    hscroll_prev_set = config.interpolate;
+    if (hscroll_prev_set)
+    {
+        std::copy_n(road0_h, ARRAY_LENGTH, hscroll_prev[0]);
+        std::copy_n(road1_h, ARRAY_LENGTH, hscroll_prev[1]);
+    }
     copy_bg_color();
 
     hwroad.read_road_control(); // swap halves of road ram
 }
 
+// The rest of road RAM is already this tick's: only the hscroll tables were shown midway
+void ORoad::present_exact()
+{
+    if (!hscroll_pending)
+        return;
+    hscroll_pending = false;
+    output_hscroll(&road0_h[0], HW_HSCROLL_TABLE0);
+    output_hscroll(&road1_h[0], HW_HSCROLL_TABLE1);
+    hwroad.read_road_control();
+}
+
 // Set Default Horizontal Scroll Values
 // 
 // Source Address: 0x1106
@@ -529,8 +562,10 @@ void ORoad::setup_hscroll()
 void ORoad::do_road_offset(int16_t* dst_x, int16_t width, bool invert)
 {
     int32_t car_offset = car_x_bak + width + oinitengine.camera_x_off; // note extra debug of camera x
-    int32_t scanline_inc = 0; // Total amount to increment scanline (increased every line)
-    int16_t* src_x = road_x; // a0
+    const int16_t* src_x = road_x; // a0
+
+    // Each line is independent, so the loops below are written per line (line i's scanline
+    // increment is i * car_offset) for the compiler to vectorise.
 
     // ---------------------------------------------------------------
     // Process H-Scroll: Car not central on road 0
@@ -540,26 +575,14 @@ void ORoad::do_road_offset(int16_t* dst_x, int16_t width, bool invert)
     if (car_offset != 0)
     {
         car_offset <<= 7;
-        for (uint16_t i = 0; i <= 0x1FF; i++)
+        const int16_t sign = invert ? -1 : 1;
+        for (int32_t i = 0; i < ARRAY_LENGTH; i++)
         {
-            int16_t h_scroll = scanline_inc >> 16;
-
             // If ignore car position
-            if (*src_x == 0x3210)
-                h_scroll = 0;
+            const int16_t h_scroll = (src_x[i] == 0x3210) ? 0 : int16_t((i * car_offset) >> 16);
 
-            // Get next line of road x data
-            int16_t x_off = (*src_x++) >> 6;
-
-            if (!invert)
-                h_scroll += x_off;
-            else
-                h_scroll -= x_off;
-            
-            // Write final h-scroll value 
-            (*dst_x++) = h_scroll;
-
-            scanline_inc += car_offset;
+            // Write final h-scroll value (next line of road x data added on)
+            dst_x[i] = int16_t(h_scroll + sign * (src_x[i] >> 6));
         }
         return;
     }
@@ -569,33 +592,13 @@ void ORoad::do_road_offset(int16_t* dst_x, int16_t width, bool invert)
 
     if (!invert)
     {
-        for (uint16_t i = 0; i <= 0x3F; i++)
-        {
-            (*dst_x++) = (*src_x++) >> 6;
-            (*dst_x++) = (*src_x++) >> 6;
-            (*dst_x++) = (*src_x++) >> 6;
-            (*dst_x++) = (*src_x++) >> 6;
-
-            (*dst_x++) = (*src_x++) >> 6;
-            (*dst_x++) = (*src_x++) >> 6;
-            (*dst_x++) = (*src_x++) >> 6;
-            (*dst_x++) = (*src_x++) >> 6;
-        }
+        for (int32_t i = 0; i < ARRAY_LENGTH; i++)
+            dst_x[i] = src_x[i] >> 6;
     }
     else
     {
-        for (uint16_t i = 0; i <= 0x3F; i++)
-        {
-            (*dst_x++) = -(*src_x++) >> 6;
-            (*dst_x++) = -(*src_x++) >> 6;
-            (*dst_x++) = -(*src_x++) >> 6;
-            (*dst_x++) = -(*src_x++) >> 6;
-
-            (*dst_x++) = -(*src_x++) >> 6;
-            (*dst_x++) = -(*src_x++) >> 6;
-            (*dst_x++) = -(*src_x++) >> 6;
-            (*dst_x++) = -(*src_x++) >> 6;
-        }
+        for (int32_t i = 0; i < ARRAY_LENGTH; i++)
+            dst_x[i] = int16_t(-src_x[i] >> 6);
     }
 }
 
@@ -1088,13 +1091,18 @@ void ORoad::set_y_2044()
     // Write this section of road number of times dictated by length
     // Source: 0x2080: write_y
     // ------------------------------------------------------------------------
+    // Line k down from y_addr is total_height + (k + 1) * change_per_entry, so each is worked
+    // out on its own (with the wrap of the original 32-bit total) for the compiler to vectorise
     if (section_length >= 0)
     {
-        for (uint16_t i = 0; i <= section_length; i++)
-        {
-            total_height += change_per_entry; 
-            road_y[--y_addr] = (total_height << 4) >> 16;
-        }        
+        const uint32_t lines  = section_length + 1;
+        const uint32_t base   = total_height;
+        const uint32_t change = change_per_entry;
+        int16_t* dst = &road_y[y_addr - lines];
+        for (uint32_t j = 0; j < lines; j++)
+            dst[j] = int16_t(((base + (lines - j) * change) << 4) >> 16);
+        total_height = int32_t(base + lines * change);
+        y_addr -= lines;
     }
 
     // ------------------------------------------------------------------------
@@ -1220,15 +1228,10 @@ void ORoad::set_y_horizon()
     int32_t d1 = (horizon_mod * (height_start - 0x100)) >> 4;
     int32_t d2 = ((horizon_base + horizon_offset) << 4) + d1;
     
-    uint32_t total_height = 0;
-
-    // write_next_y:
-    for (uint16_t i = 0; i <= 0x1FF; i++) // (1FF height positions)
-    {
-        total_height += d2;
-        uint32_t d0 = (total_height << 4) >> 16;
-        road_y[--a0] = d0;
-    }
+    // write_next_y: (1FF height positions), line k down from a0 at (k + 1) * d2
+    int16_t* dst = &road_y[a0 - 0x200];
+    for (uint32_t j = 0; j < 0x200; j++)
+        dst[j] = int16_t(((uint32_t(0x200 - j) * uint32_t(d2)) << 4) >> 16);
 
     road_unk[0] = 0;
     
@@ -1525,56 +1528,36 @@ void ORoad::blit_roads()
 
 void ORoad::blit_road(uint32_t a0)
 {
-    uint32_t a2 = 0x400 + road_p2;
-
-    // Write 0x1A0 bytes total Src: (0x260 - 0x400) Dst: 0x1C0
-    for (int16_t i = 0; i <= 13; i++)
-    {
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-        a0 -= 2; hwroad.write16(a0, road_y[--a2]);
-    }
+    // Write 0x1C0 bytes total Src: (0x240 - 0x400) Dst: 0x1C0, working down from both ends
+    const int WORDS = 0xE0;
+    hwroad.write_block(a0 - (WORDS * 2), &road_y[0x400 + road_p2 - WORDS], WORDS);
 }
 
 void ORoad::output_hscroll(int16_t* src, uint32_t dst)
 {
     const int32_t d6 = 0x654;
-    uint32_t src_addr = 0;
 
-    // Copy 16 bytes
-    for (int32_t i = 0; i <= 0x3F; i++)
+    int16_t hscroll[ARRAY_LENGTH];
+    for (int32_t i = 0; i < ARRAY_LENGTH; i++)
+        hscroll[i] = int16_t(-src[i] + d6);
+    hwroad.write_block(dst, hscroll, ARRAY_LENGTH);
+}
+
+// The same, midway between the last tick's values (prev) and this tick's, for render
+// interpolation. Large steps (a new stage, a change of view) are shown as they are.
+void ORoad::output_hscroll_mid(int16_t* src, int16_t* prev, uint32_t dst)
+{
+    const int32_t d6 = 0x654;
+    const int32_t MAX_STEP = 0x40;
+
+    int16_t hscroll[ARRAY_LENGTH];
+    for (int32_t i = 0; i < ARRAY_LENGTH; i++)
     {
-        int16_t d0h = -src[src_addr++] + d6;
-        int16_t d0l = -src[src_addr++] + d6;
-        int16_t d1h = -src[src_addr++] + d6;
-        int16_t d1l = -src[src_addr++] + d6;
-        int16_t d2h = -src[src_addr++] + d6;
-        int16_t d2l = -src[src_addr++] + d6;
-        int16_t d3h = -src[src_addr++] + d6;
-        int16_t d3l = -src[src_addr++] + d6;
-        hwroad.write16(&dst, d0h);
-        hwroad.write16(&dst, d0l);
-        hwroad.write16(&dst, d1h);
-        hwroad.write16(&dst, d1l);
-        hwroad.write16(&dst, d2h);
-        hwroad.write16(&dst, d2l);
-        hwroad.write16(&dst, d3h);
-        hwroad.write16(&dst, d3l);
+        const int32_t step = src[i] - prev[i];
+        const int32_t mid  = (std::abs(step) < MAX_STEP) ? src[i] - (step / 2) : src[i];
+        hscroll[i] = int16_t(-mid + d6);
     }
+    hwroad.write_block(dst, hscroll, ARRAY_LENGTH);
 }
 
 // Copy Background Colour To Road.
@@ -158,6 +158,9 @@ public:
 	~ORoad();
 	void init();
 	void tick();
+	// Render interpolation (config.interpolate): each tick's road curves are first shown midway
+	// from the last tick's, then as they are on the frame between ticks (called from vint)
+	void present_exact();
     uint8_t get_view_mode();
     int16_t get_road_y(uint16_t);
     void set_view_mode(uint8_t, bool snap = false);
@@ -310,7 +313,14 @@ private:
 	void blit_road(uint32_t);
 	
 	void output_hscroll(int16_t*, uint32_t);
+	void output_hscroll_mid(int16_t*, int16_t*, uint32_t);
 	void copy_bg_color();
+
+	// Render interpolation: the hscroll tables of the last tick, and whether this tick's are
+	// still to be shown as they are
+	int16_t hscroll_prev[2][ARRAY_LENGTH];
+	bool    hscroll_prev_set;
+	bool    hscroll_pending;
 };
 
 extern ORoad oroad;
\ No newline at end of file
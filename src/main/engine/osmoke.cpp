@@ -216,7 +216,7 @@ void OSmoke::tick_smoke_anim(oentry* sprite, int8_t anim_ctrl, uint32_t addr)
             // Car is slid to the side, so we need to offset the smoke accordingly
             if (ocrash.crash_state == 4)
             {
-                if (ocrash.spr_ferrari->control & OSprites::HFLIP)
+                if (ocrash.spr_ferrari->control() & OSprites::HFLIP)
                 {
                     if (sprite == &osprites.jump_table[OSprites::SPRITE_SMOKE2])
                     {
@@ -337,8 +337,8 @@ void OSmoke::tick_smoke_anim(oentry* sprite, int8_t anim_ctrl, uint32_t addr)
     sprite->x += (x * zoom) >> 8;
 
     // Set H-Flip
-    if (hflip & 1) sprite->control |= OSprites::HFLIP;
-    else sprite->control &= ~OSprites::HFLIP;
+    if (hflip & 1) sprite->control() |= OSprites::HFLIP;
+    else sprite->control() &= ~OSprites::HFLIP;
 
     osprites.map_palette(sprite);
     osprites.do_spr_order_shadows(sprite);
@@ -14,6 +14,8 @@
     Modifications for CannonBall-SE (c) 2005 James Pearce
 ***************************************************************************/
 
+#include <algorithm>
+#include <cstdlib>
 #include "../trackloader.hpp"
 
 #include "engine/oanimseq.hpp"
@@ -43,15 +45,17 @@ void OSprites::init()
     for (uint16_t i = 0; i < PAL_LOOKUP_LENGTH; i++)
         pal_lookup[i] = 0;
 
-    for (uint16_t i = 0; i < 0x2000; i++)
+    for (uint16_t i = 0; i < JUMP_ENTRIES_TOTAL; i++)
     {
+        order_priority[i] = 0;
+        order_jump[i] = 0;
         sprite_order[i] = 0;
-        sprite_order2[i] = 0;
     }
 
     // Reset hardware entries
-    for (uint16_t i = 0; i < JUMP_ENTRIES_TOTAL; i++)
+    for (uint16_t i = 0; i <= HW_ENTRIES_MAX; i++)
         sprite_entries[i].init();
+    setup_rom = nullptr;
 
     for (uint8_t i = 0; i < SPRITE_ENTRIES; i++)
         jump_table[i].init(i);
@@ -74,7 +78,7 @@ void OSprites::init()
     for (uint8_t i = SPRITE_TRAFF1; i <= SPRITE_TRAFF8; i++)
     {
         jump_table[i].init(i);      
-        jump_table[i].control |= SHADOW;
+        jump_table[i].control() |= SHADOW;
         jump_table[i].addr = outrun.adr.sprite_porsche; // Initial offset of traffic sprites. Will be changed.
     }
 
@@ -116,6 +120,8 @@ void OSprites::init()
 
     jump_table[SPRITE_FLAG].init(SPRITE_FLAG);
     oanimseq.init(jump_table);
+
+    jump_table[SPRITE_GHOST].init(SPRITE_GHOST);
     
     seg_pos             = 0;
     seg_total_sprites   = 0;
@@ -125,6 +131,9 @@ void OSprites::init()
     seg_spr_addr        = 0;
 
     do_sprite_swap      = false;
+    interp_prev_count   = 0;
+    interp_prev_shadows = 0;
+    interp_pending      = false;
     sprite_scroll_speed = 0;
     shadow_offset       = 0;
     sprite_count        = 0;
@@ -151,7 +160,7 @@ void OSprites::update_sprites()
 void OSprites::disable_sprites()
 {
     for (uint8_t i = 0; i < SPRITE_ENTRIES; i++)
-        jump_table[i].control &= ~OSprites::ENABLE;
+        hot[i].control &= ~OSprites::ENABLE;
 }
 
 void OSprites::tick()
@@ -212,15 +221,15 @@ void OSprites::tick()
 
 void OSprites::sprite_control()
 {
-    uint16_t pos = trackloader.read_scenery_pos();
+    uint16_t pos = trackloader.scenery_pos();
 
     // Populate next road segment
     if (pos <= oroad.road_pos >> 16)
     {
         seg_pos = pos;                                                          // Position In Level Data [Word]
-        seg_total_sprites = trackloader.read_total_sprites();                   // Number of Sprites In Segment
-        uint8_t pattern_index = trackloader.read_sprite_pattern_index();        // Block Of Sprites
-        trackloader.scenery_offset += 4;                                        // Advance to next scenery point
+        seg_total_sprites = trackloader.scenery_total();                        // Number of Sprites In Segment
+        uint8_t pattern_index = trackloader.scenery_pattern();                  // Block Of Sprites
+        trackloader.scenery_index++;                                            // Advance to next scenery point
         
         uint32_t a0 = trackloader.read_scenerymap_table(pattern_index);         // Get Address of Scenery Pattern
         seg_sprite_freq = trackloader.read16(trackloader.scenerymap_data, &a0); // Scenery Frequency
@@ -357,39 +366,39 @@ void OSprites::map_palette(oentry* spr)
 //
 // Notes:
 // 1/ Reads Sprite-to-Sprite priority of individual sprite
-// 2/ Creates ordered sprite table starting at 0x64000
-// 3/ The format of this table is detailed in the comments at 0x78B0
-// 4/ Optionally adds shadow to sprite if requires
+// 2/ Adds the sprite to the list sorted by sprite_copy (originally a table at 0x64000 of
+//    0x200 priorities, each with room for 14 sprites, further sprites being lost)
+// 3/ Optionally adds shadow to sprite if requires
 //
 // The end result is a table of sprite entries at 0x64000
 
 void OSprites::do_spr_order_shadows(oentry* input)
 {
-    if (input->hidden) return;  // JJP ghost car related safety-net check
-
-    // LayOut specific fix to avoid memory crash on over populated scenery segments
-    if (spr_cnt_main + spr_cnt_shadow >= JUMP_ENTRIES_TOTAL)
+    if (order_deferred)
+    {
+        order_pending[input->jump_index]++;
         return;
+    }
 
-    // Use priority as lookup into table. Assume we're on boundaries of 0x10
-    uint16_t priority = (input->priority & 0x1FF) << 4;
-    uint8_t bytes_to_copy = sprite_order[priority];
+    if (input->hidden) return;  // JJP ghost car related safety-net check
 
-    // Maximum number of bytes we want to copy is 0x10
-    if (bytes_to_copy < 0xE)
+    // Each jump table entry is normally added once a frame. Sprites beyond what the
+    // hardware holds are dropped by sprite_copy, furthest first.
+    if (spr_cnt_main < JUMP_ENTRIES_TOTAL)
     {
-        bytes_to_copy++;
-        sprite_order[priority] = bytes_to_copy;
-        sprite_order[priority + bytes_to_copy + 1] = input->jump_index; // put at offset +2
+        order_priority[spr_cnt_main] = input->priority & 0x1FF;
+        order_jump[spr_cnt_main]     = input->jump_index;
         spr_cnt_main++;
+        if (input->control() & TRAFFIC_SPRITE)
+            otraffic.order_traffic(input);
     }
 
     // Code to handle shadows under sprites
     // test_shadow: 
-    if (!(input->control & SHADOW)) return;
+    if (!(input->control() & SHADOW)) return;
 
-    // LayOut specific fix to avoid memory crash on over populated scenery segments
-    if (spr_cnt_main + spr_cnt_shadow >= JUMP_ENTRIES_TOTAL)
+    // Shadows are written straight to the hardware entries, so stop short of the end marker
+    if (spr_cnt_shadow >= HW_ENTRIES_MAX)
         return;
 
     input->dst_index = spr_cnt_shadow;
@@ -404,7 +413,7 @@ void OSprites::do_spr_order_shadows(oentry* input)
     
     input->x += (input->road_priority * shadow_offset) >> 9; // d0 = sprite z / distance into screen
 
-    if (input->control & TRAFFIC_SPRITE)
+    if (input->control() & TRAFFIC_SPRITE)
     {
         input->addr = outrun.adr.sprite_shadow_small;
         input->x = x;
@@ -422,6 +431,16 @@ void OSprites::do_spr_order_shadows(oentry* input)
     input->addr = addr;
 }
 
+void OSprites::flush_order()
+{
+    order_deferred = false;
+    for (uint8_t i = 0; i < JUMP_ENTRIES_TOTAL; i++)
+    {
+        for (; order_pending[i]; order_pending[i]--)
+            do_spr_order_shadows(&jump_table[i]);
+    }
+}
+
 // Sprite Copying Routine
 // 
 // Source Address: 0x78B0
@@ -431,64 +450,40 @@ void OSprites::do_spr_order_shadows(oentry* input)
 
 void OSprites::sprite_copy()
 {
+    spr_cnt_dropped = 0;
     if (spr_cnt_main == 0)
     {
         finalise_sprites();
         return;
     }
 
-    if (spr_cnt_main + spr_cnt_shadow > 0x7F)
-    {
-        spr_cnt_main = spr_cnt_shadow = 0;
-        finalise_sprites();
-        return;
-    }
-
-    uint32_t spr_cnt_main_copy = spr_cnt_main;
-
-    // look up in sprite_order
-    int32_t src_addr = -0x10;
-
-    // copy to sprite_entries
-    uint32_t dst_index = 0;
-
-    // Get next relevant entry (number of bytes to copy, followed by indexes of sprites)
-    while (spr_cnt_main_copy != 0)
-    {
-        src_addr += 0x10;
-        uint8_t bytes_to_copy = sprite_order[src_addr]; // warning: actually reads a word here normally, so this is wrong
-
-        // Copy the required number of bytes
-        if (bytes_to_copy != 0)
-        {
-            int32_t src_offset = src_addr + 2;
-
-            do
-            {
-                // Sprite Index To Draw
-                sprite_order2[dst_index++] = sprite_order[src_offset++];                
-                if (--spr_cnt_main_copy == 0) break; // Loop continues until this is zero.
-            }
-            // Decrement number of bytes to copy
-            while (--bytes_to_copy != 0);
-        }
+    // Counting sort by priority into sprite_order. Stable, so sprites of the same priority
+    // are drawn in the order they were added, as from the original table.
+    uint16_t start[0x201] = {};
+    for (uint16_t i = 0; i < spr_cnt_main; i++)
+        start[order_priority[i] + 1]++;
+    for (uint16_t p = 0; p < 0x200; p++)
+        start[p + 1] += start[p];
+    for (uint16_t i = 0; i < spr_cnt_main; i++)
+        sprite_order[start[order_priority[i]]++] = order_jump[i];
 
-        // Clear number of bytes to copy
-        sprite_order[src_addr] = 0; 
-    }
+    // More than the hardware holds: drop the lowest priorities, which are the furthest away
+    const uint16_t room  = HW_ENTRIES_MAX - spr_cnt_shadow;
+    const uint16_t first = spr_cnt_main > room ? spr_cnt_main - room : 0;
 
     // cont2:
     uint16_t cnt_shadow_copy = spr_cnt_shadow;
 
     // next_sprite
-    for (uint16_t i = 0; i < spr_cnt_main; i++)
+    for (uint16_t i = first; i < spr_cnt_main; i++)
     {
-        uint16_t jump_index = sprite_order2[i];
-        oentry *entry = &jump_table[jump_index];
+        oentry *entry = &jump_table[sprite_order[i]];
         entry->dst_index = cnt_shadow_copy;
         cnt_shadow_copy++;
         do_sprite(entry);
     }
+    spr_cnt_main -= first;
+    spr_cnt_dropped = first;
 
     finalise_sprites();
 }
@@ -526,12 +521,93 @@ void OSprites::finalise_sprites()
 //
 
 void OSprites::blit_sprites()
+{
+    interp_pending = false;
+    if (!config.interpolate)
+    {
+        interp_prev_count = 0;
+        blit_entries(sprite_entries);
+        return;
+    }
+
+    interpolate_entries();
+    blit_entries(interp_mid);
+    interp_pending = true;
+
+    std::copy_n(sprite_entries, sprite_count, interp_prev);
+    interp_prev_count   = sprite_count;
+    interp_prev_shadows = spr_cnt_shadow;
+}
+
+void OSprites::present_exact()
+{
+    if (!interp_pending)
+        return;
+    interp_pending = false;
+    blit_entries(sprite_entries);
+    video.sprite_layer->swap();
+}
+
+// Midway entries, into interp_mid. Each entry is matched with the one drawn from the same jump
+// table entry last tick (shadows with shadows: they come first), and where both are shown and
+// the step is small it is put half way back along the step. The size is this tick's: the zoom
+// decides the sprite frame and its line data, which can't be split.
+void OSprites::interpolate_entries()
+{
+    const int MAX_STEP = 64;
+
+    int16_t prev_of[2][256];
+    std::fill_n(&prev_of[0][0], 2 * 256, int16_t(-1));
+    for (uint16_t p = 0; p < interp_prev_count; p++)
+    {
+        if (!(interp_prev[p].data[0] & 0x4000))
+            prev_of[p < interp_prev_shadows][interp_prev[p].scratch & 0xFF] = p;
+    }
+
+    for (uint16_t i = 0; i <= sprite_count; i++)
+    {
+        const osprite& cur = sprite_entries[i];
+        osprite& mid = interp_mid[i];
+        mid = cur;
+        if (i == sprite_count || (cur.data[0] & 0x4000))
+            continue;
+
+        const int16_t p = prev_of[i < spr_cnt_shadow][cur.scratch & 0xFF];
+        if (p < 0)
+            continue;
+        const osprite& prev = interp_prev[p];
+
+        const int dx = int16_t(cur.data[6]) - int16_t(prev.data[6]);
+        if (dx != 0 && std::abs(dx) < MAX_STEP)
+        {
+            mid.data[6] = uint16_t(int16_t(cur.data[6]) - (dx / 2));
+            // midway is on screen wherever both ends are, but may cross an edge if either does
+            mid.set_clip(((cur.data[0] | prev.data[0]) & 0x2000) != 0);
+        }
+
+        // the top line, unless either end is clipped at the top of the screen (0x100)
+        const int top  = cur.data[0] & 0x1FF;
+        const int ptop = prev.data[0] & 0x1FF;
+        const int dy   = top - ptop;
+        if (top > 0x100 && ptop > 0x100 && dy != 0 && std::abs(dy) < MAX_STEP)
+            mid.data[0] = uint16_t((cur.data[0] & ~0x1FF) | (top - (dy / 2)));
+    }
+}
+
+void OSprites::blit_entries(osprite* entries)
 {
     uint32_t dst_addr = SPRITE_RAM;
 
     for (uint16_t i = 0; i <= sprite_count; i++)
     {
-        uint16_t* data = sprite_entries[i].data;
+        uint16_t* data = entries[i].data;
+
+        // native sprite list: the entry goes over whole, and is decoded for drawing once
+        if (config.video.sprite_list)
+        {
+            video.sprite_layer->add_sprite(i, data);
+            continue;
+        }
 
         // Write sprite info
         for (int i=0; i<16; i++)
@@ -542,66 +618,22 @@ void OSprites::blit_sprites()
     }
 }
 
-// Convert Sprite From Internal Software Format To Hardware Format
-// 
-// Source Address: 0x94EC
-// Input:          Sprite To Copy
-// Output:         None
-//
-// 1. Copies Sprite Information From Jump Table Area To RAM
-// 2. Stores In Similar Format To Sprite Hardware, but with 4 extra bytes of scratch data on end
-// 3. Note: Mostly responsible for setting x,y,width,height,zoom,pitch,priorities etc.
-//
-// 0x11ED2: Table of Sprite Addresses for Hardware. Contains:
-//
-// 5 x 10 bytes. One block for each sprite size lookup. 
-// The exact sprite is selected using the ozoom_lookup.hpp table.
-//
-// + 0 : [Byte] Unused
-// + 1 : [Byte] Width Helper Lookup  [Offsets into 0x20000 (the width and height table)]
-// + 2 : [Byte] Line Data Width
-// + 3 : [Byte] Height Helper Lookup [Offsets into 0x20000 (the width and height table)]
-// + 4 : [Byte] Line Data Height
-// + 5 : [Byte] Sprite Pitch
-// + 7 : [Byte] Sprite Bank
-// + 8 : [Word] Offset Within Sprite Bank
-
-void OSprites::do_sprite(oentry* input)
+// The part of do_sprite() that depends only on the frame and its zoom: which frame size is drawn,
+// its dimensions on screen and where it is in the sprite ROM. Of the game's own width/height lookup
+// only the width is still used (by set_hrender); calc_width/calc_height have replaced the rest.
+const OSprites::sprite_setup_t& OSprites::sprite_setup(oentry* input)
 {
-    input->control |= DRAW_SPRITE; // Display input sprite
-
-    // Get Correct Output Entry
-    osprite* output = &sprite_entries[input->dst_index];
-
-    // Copy address sprite was copied from.
-    // todo: pass pointer?
-    output->scratch = input->jump_index;
-
-    // Hide Sprite if zoom lookup not set
-    if (input->zoom == 0)
+    const uint8_t hires = config.video.hiresprites;
+    if (roms.rom0p != setup_rom)
     {
-        hide_hwsprite(input, output);
-        return;
+        for (int i = 0; i < SETUP_CACHE; i++)
+            setup_cache[i].valid = false;
+        setup_rom = roms.rom0p;
     }
 
-    // JJP - Ghost car fix. Hide the sprite if it's hidden count-down is >0
-    // The 'hidden' field is set in OTraffic::move_spawned_sprite()
-    if (input->hidden > 0) {
-        hide_hwsprite(input, output);
-        return;
-    }
-/*
-// dumps the WH_TABLE contents
-std::cout << "\n";
-for (uint32_t i=0; i<0x8000; ) {
-    std::cout << std::dec << uint16_t(roms.rom0p->read8(WH_TABLE + i++));
-    std::cout << "," << std::dec << uint16_t(roms.rom0p->read8(WH_TABLE + i++)) << "\n";
-}
-std::exit(9);
-*/
-    // Sprite Width/Height Settings
-    uint16_t width = 0;
-    uint16_t height = 0;
+    sprite_setup_t& s = setup_cache[((input->addr >> 4) ^ (input->zoom * 37)) & (SETUP_CACHE - 1)];
+    if (s.valid && s.addr == input->addr && s.zoom == input->zoom && s.hires == hires)
+        return s;
 
     // Set real h/v zoom values
     uint32_t index = (input->zoom * 4); // x4 as table is 4-words per line
@@ -610,7 +642,6 @@ std::exit(9);
     uint32_t input_index = 0;
     uint32_t multiplier = 512;
     int16_t  offset = 0;
-    uint32_t zoom = 0;
     switch (ZOOM_LOOKUP[index+2]) {
         case SIZE1: input_index = 127; break;  //  1:1 zoom for largest size
         case SIZE2: input_index =  62; multiplier = 516; offset =  3; break;  // 1.008:1 (closest we have)
@@ -627,132 +658,137 @@ std::exit(9);
     d0 = (d0 & 0xFF00) + roms.rom0p->read8(src_offsets + 3);
     uint32_t sprite_height = (roms.rom0p->read8(WH_TABLE + d0) * multiplier) >> 9;
 
-    // now adjust for which type we actually have
-    if (input_index != 127) {
-        if (config.video.hiresprites == 1) {
-            // now adjust for difference in sprite type being used
-            uint32_t original_size = ZOOM_LOOKUP_HIRES[(index*4)+2];
-            sprite_height <<= 1;
-            sprite_width  <<= 1;
-        }
+    // now adjust for difference in sprite type being used
+    if (input_index != 127 && hires == 1) {
+        sprite_height <<= 1;
+        sprite_width  <<= 1;
     }
 
-    output->set_rawh(sprite_height);
-    output->set_offset(offset);
-
     // determine output size (game logic)
-    if (config.video.hiresprites == 0) {
+    uint32_t zoom;
+    uint32_t size_offset;   // frame the game's width is taken from
+    uint16_t size;          // and its size e.g. SIZE1
+    if (hires == 0) {
         // original game resolution. Use (patched) original game sprite sizes.
-
         zoom = ZOOM_LOOKUP[index];
-        output->set_vzoom(zoom);
-        output->set_hzoom(zoom);
-
-        // -------------------------------------------------------------------------
-        // Set width & height values using lookup
-        // -------------------------------------------------------------------------
         lookup_mask = ZOOM_LOOKUP[index+1]; // Width/Height lookup helper
 
         // This is the address of the frame required for the level of zoom we're using
         // There are 5 unique frames that are typically used for zoomed sprites.
         // which correspond to different screen sizes
         src_offsets = input->addr + ZOOM_LOOKUP[index+2]; // sprite size e.g. SIZE1
-
-        d0 = input->draw_props | (input->zoom << 8);
-        uint16_t top_bit = d0 & 0x8000; // set if zoom >= 0x80
-        d0 &= 0x7FFF; // Clear top bit
-
-        if (top_bit == 0) // zoom < 0x80
-        {
-            if (ZOOM_LOOKUP[index+2] != SIZE1) // Not largest sized sprite
-            {
-                lookup_mask += 0x4000;
-                d0 = lookup_mask;
-            }
-
-            d0 = (d0 & 0xFF00) + roms.rom0p->read8(src_offsets + 1);
-            width = roms.rom0p->read8(WH_TABLE + d0);
-            d0 = (d0 & 0xFF00) + roms.rom0p->read8(src_offsets + 3);
-            height = roms.rom0p->read8(WH_TABLE + d0);
-        }
-        // loc_9560:
-        else
-        {
-            d0 &= 0x7C00;
-            uint16_t h = d0;
-
-            d0 = (d0 & 0xFF00) + roms.rom0p->read8(src_offsets + 1);
-            width = roms.rom0p->read8(WH_TABLE + d0);
-            d0 &= 0xFF;
-            width += d0;
-
-            h |= roms.rom0p->read8(src_offsets + 3);
-            height = roms.rom0p->read8(WH_TABLE + h);
-            h &= 0xFF;
-            height += h;
-        }
+        size_offset = src_offsets;
+        size        = ZOOM_LOOKUP[index+2];
     } else {
         // hires path. Use larger sprites to improve image quality.
         zoom = ZOOM_LOOKUP_HIRES[index];
-        output->set_vzoom(zoom);
-        output->set_hzoom(zoom);
-
-        uint16_t lookup_mask = ZOOM_LOOKUP_HIRES[index+1]; // Width/Height lookup helper
+        lookup_mask = ZOOM_LOOKUP_HIRES[index+1]; // Width/Height lookup helper
 
         src_offsets = input->addr + ZOOM_LOOKUP_HIRES[index+2]; // sprite size e.g. SIZE1
         // original sprite size entry from which rendered size will be determined.
         // this is different, because we are using "the next size up" sprites to improve hi-res fidelity
         // index+3 was previously an unused field
-        uint32_t size_offset = input->addr + ZOOM_LOOKUP_HIRES[index+3];
-
-        uint16_t d0 = input->draw_props | (input->zoom << 8);
-        uint16_t top_bit = d0 & 0x8000; // set if zoom >= 0x80
-        d0 &= 0x7FFF; // Clear top bit
-
-        if (top_bit == 0) {
-            // zoom < 0x80
-            if (ZOOM_LOOKUP_HIRES[index+3] != SIZE1) {
-                // Not largest sized sprite
-                lookup_mask += 0x4000;
-                d0 = lookup_mask;
-            }
+        size_offset = input->addr + ZOOM_LOOKUP_HIRES[index+3];
+        size        = ZOOM_LOOKUP_HIRES[index+3];
+    }
+
+    // -------------------------------------------------------------------------
+    // Set width value using lookup (the height isn't needed)
+    // -------------------------------------------------------------------------
+    uint16_t width;
+    d0 = (input->zoom << 8) & 0x7FFF; // draw_props in the low byte is always replaced
+    if ((input->zoom & 0x80) == 0) // zoom < 0x80
+    {
+        if (size != SIZE1) // Not largest sized sprite
+            d0 = lookup_mask + 0x4000;
+        d0 = (d0 & 0xFF00) + roms.rom0p->read8(size_offset + 1);
+        width = roms.rom0p->read8(WH_TABLE + d0);
+    }
+    // loc_9560:
+    else
+    {
+        d0 = (d0 & 0x7C00) + roms.rom0p->read8(size_offset + 1);
+        width = roms.rom0p->read8(WH_TABLE + d0) + (d0 & 0xFF);
+    }
+
+    s.valid       = true;
+    s.addr        = input->addr;
+    s.zoom        = input->zoom;
+    s.hires       = hires;
+    s.rawh        = uint8_t(sprite_height);
+    s.offset      = offset;
+    s.hw_zoom     = uint16_t(zoom);
+    s.game_width  = width;
+    s.width       = (0x200 * sprite_width)  / zoom;
+    s.height      = (0x200 * sprite_height) / zoom;
+    s.bank_offset = roms.rom0p->read16(src_offsets + 8);
+    s.bank        = roms.rom0p->read8(src_offsets + 7) << 1;
+    s.line_width  = roms.rom0p->read16(src_offsets + 2);
+    s.line_length = roms.rom0p->read16(src_offsets + 4);
+    s.pitch       = roms.rom0p->read8(src_offsets + 5) << 1;
+    return s;
+}
+
+// Convert Sprite From Internal Software Format To Hardware Format
+// 
+// Source Address: 0x94EC
+// Input:          Sprite To Copy
+// Output:         None
+//
+// 1. Copies Sprite Information From Jump Table Area To RAM
+// 2. Stores In Similar Format To Sprite Hardware, but with 4 extra bytes of scratch data on end
+// 3. Note: Mostly responsible for setting x,y,width,height,zoom,pitch,priorities etc.
+//
+// 0x11ED2: Table of Sprite Addresses for Hardware. Contains:
+//
+// 5 x 10 bytes. One block for each sprite size lookup. 
+// The exact sprite is selected using the ozoom_lookup.hpp table.
+//
+// + 0 : [Byte] Unused
+// + 1 : [Byte] Width Helper Lookup  [Offsets into 0x20000 (the width and height table)]
+// + 2 : [Byte] Line Data Width
+// + 3 : [Byte] Height Helper Lookup [Offsets into 0x20000 (the width and height table)]
+// + 4 : [Byte] Line Data Height
+// + 5 : [Byte] Sprite Pitch
+// + 7 : [Byte] Sprite Bank
+// + 8 : [Word] Offset Within Sprite Bank
 
-            d0 = (d0 & 0xFF00) + roms.rom0p->read8(size_offset + 1);
-            width = roms.rom0p->read8(WH_TABLE + d0);
-            d0 = (d0 & 0xFF00) + roms.rom0p->read8(size_offset + 3);
-            height = roms.rom0p->read8(WH_TABLE + d0);
+void OSprites::do_sprite(oentry* input)
+{
+    input->control() |= DRAW_SPRITE; // Display input sprite
 
-        } else {
+    // Get Correct Output Entry
+    osprite* output = &sprite_entries[input->dst_index];
 
-            d0 &= 0x7C00;
-            uint16_t h = d0;
+    // Copy address sprite was copied from.
+    // todo: pass pointer?
+    output->scratch = input->jump_index;
 
-            d0 = (d0 & 0xFF00) + roms.rom0p->read8(size_offset + 1);
-            width = roms.rom0p->read8(WH_TABLE + d0);
-            d0 &= 0xFF;
-            width += d0;
+    // Hide Sprite if zoom lookup not set
+    if (input->zoom == 0)
+    {
+        hide_hwsprite(input, output);
+        return;
+    }
 
-            h |= roms.rom0p->read8(size_offset + 3);
-            height = roms.rom0p->read8(WH_TABLE + h);
-            h &= 0xFF;
-            height += h;
-        }
+    // JJP - Ghost car fix. Hide the sprite if it's hidden count-down is >0
+    // The 'hidden' field is set in OTraffic::move_spawned_sprite()
+    if (input->hidden > 0) {
+        hide_hwsprite(input, output);
+        return;
     }
 
-    //int32_t sprite_width = (roms.rom0p->read8(src_offsets + 5)) * 8; // pitch, 8 pixels per 32-bit word
-    int32_t calc_width   = ceil((0x200 * sprite_width)  / zoom);
-    int32_t calc_height  = ceil((0x200 * sprite_height) / zoom);
+    // Sprite size, zoom and ROM location for this frame and zoom level
+    const sprite_setup_t& setup = sprite_setup(input);
+    const int16_t offset      = setup.offset;
+    const int32_t calc_width  = setup.width;
+    const int32_t calc_height = setup.height;
+
+    output->set_rawh(setup.rawh);
+    output->set_offset(offset);
+    output->set_vzoom(setup.hw_zoom);
+    output->set_hzoom(setup.hw_zoom);
 
-/*
-{
-if ((calc_width < width) || (calc_height < height)) {
-    std::cout << "\rGame Width/Height: " << width << "/" << height <<
-      "\t\tDetermined: " << sprite_width << "/" << sprite_height <<
-      "\t\tCalculated: " << ((0x200 * sprite_width) / zoom) << "/" << ((0x200 * sprite_height) / zoom) <<
-      "\t\t(zoom: " << std::hex << zoom << std::dec << ")\n";
-    }
-}
-*/
     // loc 9582:
 //    input->width = width;
     input->width = calc_width;
@@ -803,8 +839,8 @@ if ((calc_width < width) || (calc_height < height)) {
     // Set Palette & Sprite Bank Information
     // -------------------------------------------------------------------------
     output->set_pal(input->pal_dst); // Set Sprite Colour Palette
-    output->set_offset(roms.rom0p->read16(src_offsets + 8)); // Set Offset within selected sprite bank
-    output->set_bank(roms.rom0p->read8(src_offsets + 7) << 1); // Set Sprite Bank Value
+    output->set_offset(setup.bank_offset); // Set Offset within selected sprite bank
+    output->set_bank(setup.bank); // Set Sprite Bank Value
 
     // -------------------------------------------------------------------------
     // Set Sprite Height
@@ -812,10 +848,10 @@ if ((calc_width < width) || (calc_height < height)) {
     if (sprite_y1 < 256)
     {
         int16_t y_adj = -(sprite_y1 - 256);
-        y_adj *= roms.rom0p->read16(src_offsets + 2); // Width of line data (Unsigned multiply)
+        y_adj *= setup.line_width; // Width of line data (Unsigned multiply)
 //        y_adj /= height; // Unsigned divide
         y_adj /= calc_height; // Unsigned divide
-        y_adj *= roms.rom0p->read16(src_offsets + 4); // Length of line data (Unsigned multiply)
+        y_adj *= setup.line_length; // Length of line data (Unsigned multiply)
         output->inc_offset(y_adj);
         output->data[0x0] = (output->data[0x0] & 0xFF00) | 0x100; // Mask on negative y index
         output->set_height((uint8_t) sprite_y2);
@@ -895,19 +931,19 @@ if ((calc_width < width) || (calc_height < height)) {
     }
 
     // cont2:
-    set_hrender(input, output, roms.rom0p->read16(src_offsets + 4), width);
+    set_hrender(input, output, setup.line_length, setup.game_width);
     
     // -------------------------------------------------------------------------
     // Set Sprite Pitch & Priority
     // -------------------------------------------------------------------------
-    output->set_pitch(roms.rom0p->read8(src_offsets + 5) << 1);
+    output->set_pitch(setup.pitch);
     output->set_priority(input->shadow << 4); // todo: where does this get set?
 }
 
 // Hide Input And Output Entry
 void OSprites::hide_hwsprite(oentry* input, osprite* output)
 {
-    input->control &= ~DRAW_SPRITE; // Hide input sprite
+    input->control() &= ~DRAW_SPRITE; // Hide input sprite
     output->hide();
 }
 
@@ -997,7 +1033,7 @@ void OSprites::set_hrender(oentry* input, osprite* output, uint16_t offset, uint
     else if (anchor & 2 || input->x < 0)
         props = 0;
 
-    if (input->control & HFLIP)
+    if (input->control() & HFLIP)
     {
         if (props == 0) props = 0x40; // If H-Flip & Right To Left Render: Read data backwards
         else props = 0x20; // If H-Flip && Left To Right: Render left to right & Read data forwards
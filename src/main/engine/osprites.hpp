@@ -48,6 +48,9 @@ public:
     // Total number of object entries, including SPRITE_ENTRIES, FERRARI, PASSENGERS, TRAFFIC etc.
     const static uint8_t JUMP_ENTRIES_TOTAL = SPRITE_ENTRIES + 24;
 
+    // Entries the sprite hardware holds, less the end marker
+    const static uint8_t HW_ENTRIES_MAX = 0x7F;
+
     const static uint8_t SPRITE_FERRARI = SPRITE_ENTRIES + 1;
     const static uint8_t SPRITE_PASS1   = SPRITE_ENTRIES + 2;   // Passengers
     const static uint8_t SPRITE_PASS2   = SPRITE_ENTRIES + 3;
@@ -72,11 +75,16 @@ public:
 
     const static uint8_t SPRITE_FLAG  = SPRITE_ENTRIES + 21;    // Flag Man
 
+    const static uint8_t SPRITE_GHOST = SPRITE_ENTRIES + 22;    // Time Trial Ghost Car (ghost.hpp), or a linked cabinet's (twinlink.hpp)
+
 	// Jump Table Sprite Entries
 	oentry jump_table[JUMP_ENTRIES_TOTAL]; 
 
-	// Converted sprite entries in RAM for hardware.
-	osprite sprite_entries[JUMP_ENTRIES_TOTAL];
+	// Each entry's control and routine, packed for the per-tick scans (see oentry.hpp)
+	oentry_hot hot[JUMP_ENTRIES_TOTAL];
+
+	// Converted sprite entries in RAM for hardware (shadows first, then sprites, then the end marker).
+	osprite sprite_entries[HW_ENTRIES_MAX + 1];
 
 	// -------------------------------------------------------------------------
 	// Jump Table 2 Entries For Sprite Control
@@ -118,6 +126,9 @@ public:
 	// Number of shadows to draw
 	uint16_t spr_cnt_shadow;
 
+	// Sprites left out of the hardware list by the last sprite_copy(), being beyond what it holds
+	uint16_t spr_cnt_dropped;
+
 	OSprites(void);
 	~OSprites(void);
 	void init();
@@ -131,7 +142,15 @@ public:
 	void sprite_copy();
 	void blit_sprites();
 
+    // Render interpolation (config.interpolate): each tick's sprites are first shown midway from
+    // the last tick's, then as they are on the frame between ticks (called from vint)
+    void present_exact();
+
 	void do_spr_order_shadows(oentry*);
+	// While deferred, do_spr_order_shadows() only notes each sprite, and flush_order() then adds
+	// them in jump table order: sprites processed out of order are still listed as in order
+	void defer_order() { order_deferred = true; }
+	void flush_order();
 	void do_sprite(oentry*);
 	void set_sprite_xy(oentry*, osprite*, uint16_t, uint16_t);
 	void set_hrender(oentry*, osprite*, uint16_t, uint16_t);
@@ -140,6 +159,9 @@ public:
 
 private:
 
+	bool    order_deferred = false;
+	uint8_t order_pending[JUMP_ENTRIES_TOTAL] = {};     // do_spr_order_shadows() calls held back
+
 	// Start of Sprite RAM
 	static const uint32_t SPRITE_RAM = 0x130000;
 
@@ -172,13 +194,55 @@ private:
 	// Palette Lookup Table (was 0x100, but extended to account for extra palettes in CannonBall)
 	uint8_t pal_lookup[PAL_LOOKUP_LENGTH];
 
-	// Converted sprite entries in RAM for hardware.
-	uint8_t sprite_order[0x2000];
-	uint8_t sprite_order2[0x2000];
+	// Sprites to draw this frame as they were added: priority (0 - 0x1FF) and jump table index.
+	// Sorted by priority into sprite_order by sprite_copy().
+	uint16_t order_priority[JUMP_ENTRIES_TOTAL];
+	uint8_t  order_jump[JUMP_ENTRIES_TOTAL];
+	uint8_t  sprite_order[JUMP_ENTRIES_TOTAL];
+
+    // Render interpolation: the last tick's entries (and how many were shadows), the midway
+    // entries shown first, and whether this tick's are still to be shown as they are
+    osprite  interp_prev[HW_ENTRIES_MAX + 1];
+    uint16_t interp_prev_count;
+    uint16_t interp_prev_shadows;
+    osprite  interp_mid[HW_ENTRIES_MAX + 1];
+    bool     interp_pending;
+
+    // do_sprite() set-up for a frame at a zoom level, from the zoom tables and the frame's header in
+    // ROM. The same frames are drawn at the same few zooms every tick, so the results are kept, by
+    // frame address and zoom, until the ROMs in use or hiresprites change.
+    struct sprite_setup_t
+    {
+        bool     valid;
+        uint32_t addr;          // frame address
+        uint8_t  zoom;          // oentry zoom (0 - 0xFF)
+        uint8_t  hires;         // config.video.hiresprites
+        uint8_t  rawh;
+        int16_t  offset;        // x adjust for the frame size drawn
+        uint16_t hw_zoom;       // hardware zoom value
+        int32_t  width, height; // on screen
+        uint16_t game_width;    // as the game's width/height lookup gives it
+        uint16_t bank_offset;   // offset within sprite bank
+        uint8_t  bank;
+        uint16_t line_width, line_length;
+        uint8_t  pitch;
+    };
+    static const int SETUP_CACHE = 512; // entries, a power of 2
+    sprite_setup_t setup_cache[SETUP_CACHE] = {};
+    const RomLoader* setup_rom = nullptr;
+
+    const sprite_setup_t& sprite_setup(oentry*);
 
     void sprite_control();
 	void hide_hwsprite(oentry*, osprite*);
 	void finalise_sprites();
+    void blit_entries(osprite*);
+    void interpolate_entries();
 };
 
 extern OSprites osprites;
+
+inline uint8_t& oentry::control()               { return osprites.hot[this - osprites.jump_table].control; }
+inline uint8_t  oentry::control() const         { return osprites.hot[this - osprites.jump_table].control; }
+inline int8_t&  oentry::function_holder()       { return osprites.hot[this - osprites.jump_table].function_holder; }
+inline int8_t   oentry::function_holder() const { return osprites.hot[this - osprites.jump_table].function_holder; }
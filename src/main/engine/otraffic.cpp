@@ -46,6 +46,8 @@ void OTraffic::init()
     traffic_speed_avg   = 0;
     traffic_pal_cycle   = 0;
     traffic_count       = 0;
+    traffic_ordered     = 0;
+    traffic_order_full  = false;
     spawn_counter       = 0;
     spawn_location      = 0;
     // Set wheel animation reset value across all traffic (moved from spawn traffic routine)
@@ -58,14 +60,14 @@ void OTraffic::init_stage1_traffic()
     const uint8_t flags = OSprites::TRAFFIC_SPRITE | OSprites::TRAFFIC_RHS | OSprites::ENABLE;
 
     oentry* t = &osprites.jump_table[OSprites::SPRITE_TRAFF1];
-    t->function_holder = TRAFFIC_INIT;
-    t->control        |= flags;
+    t->function_holder() = TRAFFIC_INIT;
+    t->control()        |= flags;
     t->draw_props     |= oentry::BOTTOM;
     t->z               = 0x140F520;
 
     t = &osprites.jump_table[OSprites::SPRITE_TRAFF2];
-    t->function_holder = TRAFFIC_INIT;
-    t->control        |= flags;
+    t->function_holder() = TRAFFIC_INIT;
+    t->control()        |= flags;
     t->draw_props     |= oentry::BOTTOM;
     t->xw1             = 0x70;
     t->z               = 0x14004E0;
@@ -73,8 +75,8 @@ void OTraffic::init_stage1_traffic()
     t->xw2             = 0x70;
 
     t = &osprites.jump_table[OSprites::SPRITE_TRAFF3];
-    t->function_holder = TRAFFIC_INIT;
-    t->control        |= flags;
+    t->function_holder() = TRAFFIC_INIT;
+    t->control()        |= flags;
     t->draw_props     |= oentry::BOTTOM;
     t->xw1             = -0x70;
     t->z               = 0x14004E0;
@@ -82,8 +84,8 @@ void OTraffic::init_stage1_traffic()
     t->xw2             = -0x70;
 
     t = &osprites.jump_table[OSprites::SPRITE_TRAFF4];
-    t->function_holder = TRAFFIC_INIT;
-    t->control        |= flags;
+    t->function_holder() = TRAFFIC_INIT;
+    t->control()        |= flags;
     t->draw_props     |= oentry::BOTTOM;
     t->xw1             = 0x70;
     t->z               = 0x1D004E0;
@@ -91,8 +93,8 @@ void OTraffic::init_stage1_traffic()
     t->xw2             = 0x70;
 
     t = &osprites.jump_table[OSprites::SPRITE_TRAFF5];
-    t->function_holder = TRAFFIC_INIT;
-    t->control        |= flags;
+    t->function_holder() = TRAFFIC_INIT;
+    t->control()        |= flags;
     t->draw_props     |= oentry::BOTTOM;
     t->xw1             = -0x70;
     t->z               = 0x1D004E0;
@@ -113,7 +115,7 @@ void OTraffic::tick()
     {
         oentry* sprite = &osprites.jump_table[i];
 
-        if (sprite->function_holder == TRAFFIC_INIT)
+        if (sprite->function_holder() == TRAFFIC_INIT)
         {
             if (outrun.game_state != GS_INGAME && outrun.game_state != GS_ATTRACT)
             {
@@ -122,19 +124,19 @@ void OTraffic::tick()
                 continue;
             }
             sprite->traffic_orig_speed = 0xD4;
-            sprite->function_holder = TRAFFIC_ENTRY;
+            sprite->function_holder() = TRAFFIC_ENTRY;
         }
 
         // Skip collision code in first section of level
-        if (sprite->function_holder == TRAFFIC_ENTRY)
+        if (sprite->function_holder() == TRAFFIC_ENTRY)
         {
             if (oroad.road_pos >> 16 >= 0x80)
-                sprite->function_holder = TRAFFIC_TICK;
+                sprite->function_holder() = TRAFFIC_TICK;
             else
                 move_spawned_sprite(sprite); // Skip collision code
         }
 
-        if (sprite->function_holder == TRAFFIC_TICK)
+        if (sprite->function_holder() == TRAFFIC_TICK)
             tick_spawned_sprite(sprite);
     }
 }
@@ -144,7 +146,7 @@ void OTraffic::tick()
 void OTraffic::disable_traffic()
 {
     for (uint8_t i = OSprites::SPRITE_TRAFF1; i <= OSprites::SPRITE_TRAFF8; i++)
-        osprites.jump_table[i].control &= ~OSprites::ENABLE;
+        osprites.hot[i].control &= ~OSprites::ENABLE;
 }
 
 // Master Function to determine when to spawn traffic
@@ -188,11 +190,9 @@ void OTraffic::spawn_traffic()
     // Spawn Traffic if possible in one of the eight slots
     for (uint8_t i = OSprites::SPRITE_TRAFF1; i <= OSprites::SPRITE_TRAFF8; i++)
     {
-        oentry* sprite = &osprites.jump_table[i];
-        
-        if (!(sprite->control & OSprites::ENABLE))
+        if (!(osprites.hot[i].control & OSprites::ENABLE))
         {
-            spawn_car(sprite);
+            spawn_car(&osprites.jump_table[i]);
             return;
         }
     }
@@ -204,7 +204,7 @@ void OTraffic::spawn_traffic()
 // Source: 0x4BAC
 void OTraffic::spawn_car(oentry* sprite)
 {
-    sprite->control |= OSprites::ENABLE | OSprites::TRAFFIC_SPRITE;
+    sprite->control() |= OSprites::ENABLE | OSprites::TRAFFIC_SPRITE;
     sprite->draw_props = oentry::BOTTOM;
     sprite->shadow = 7;     // Used as priority
     sprite->width = 0;
@@ -218,18 +218,18 @@ void OTraffic::spawn_car(oentry* sprite)
     if (spawn_location & 1)
     {
         const int8_t TABLE[] = {0, -0x70, -0x70, 0x70};
-        sprite->control &= ~OSprites::TRAFFIC_RHS;
+        sprite->control() &= ~OSprites::TRAFFIC_RHS;
         // note we use (rnd & 6) >> 1 rather than (rnd & 3) to match original random number generation
         sprite->xw1 = sprite->xw2 = TABLE[(rnd & 6) >> 1];  
-        sprite->control |= OSprites::HFLIP;   
+        sprite->control() |= OSprites::HFLIP;   
     }
     // Spawn On Right Hand Side Of Road
     else
     {
         const int8_t TABLE[] = {0, -0x70, 0x70, 0x70};
-        sprite->control |= OSprites::TRAFFIC_RHS;
+        sprite->control() |= OSprites::TRAFFIC_RHS;
         sprite->xw1 = sprite->xw2 = TABLE[(rnd & 6) >> 1];
-        sprite->control &= ~OSprites::HFLIP;
+        sprite->control() &= ~OSprites::HFLIP;
     }
     
     rnd = (int8_t) rnd; // ext.w
@@ -255,7 +255,7 @@ void OTraffic::spawn_car(oentry* sprite)
     };
 
     sprite->type = TYPE[spawn_index] << 3;
-    sprite->function_holder = TRAFFIC_TICK;
+    sprite->function_holder() = TRAFFIC_TICK;
     // JJP ghost car fix
     sprite->hidden = 0;
 }
@@ -269,9 +269,9 @@ void OTraffic::tick_spawned_sprite(oentry* sprite)
     {
         // Force side of road when in bonus mode, or road splitting
         if (bonus_lhs)
-            sprite->control |= OSprites::TRAFFIC_RHS;
+            sprite->control() |= OSprites::TRAFFIC_RHS;
         else if (traffic_split)
-            sprite->control ^= OSprites::TRAFFIC_RHS;
+            sprite->control() ^= OSprites::TRAFFIC_RHS;
 
         // Check for collision with player's car
         // JJP - Ghost car related fix. Don't check sprites where hidden is positive.
@@ -338,7 +338,7 @@ void OTraffic::move_spawned_sprite(oentry* sprite)
     // Road Splitting: Return if enemy on opposite side of road to split
     if (oinitengine.road_remove_split)
     {
-        if (((oinitengine.route_selected ^ sprite->control) & OSprites::TRAFFIC_RHS) == 0) {
+        if (((oinitengine.route_selected ^ sprite->control()) & OSprites::TRAFFIC_RHS) == 0) {
             // JJP Ghost car fix.
             // Tag this as a potentially problematic sprite.
             sprite->hidden = (config.fps == 60) ? 4 : 2;
@@ -472,7 +472,7 @@ void OTraffic::update_props(oentry* sprite)
     set_zoom_lookup(sprite);
 
     // Set Screen X
-    int16_t* road_x = (sprite->control & OSprites::TRAFFIC_RHS) ? oroad.road1_h : oroad.road0_h;
+    int16_t* road_x = (sprite->control() & OSprites::TRAFFIC_RHS) ? oroad.road1_h : oroad.road0_h;
     int32_t x = (sprite->xw1 * z16) >> 9;
     sprite->x = x + road_x[z16];
 
@@ -500,7 +500,7 @@ void OTraffic::update_props(oentry* sprite)
 
     x = oinitengine.car_x_pos - (oroad.road_width >> 16);
 
-    if (sprite->control & OSprites::TRAFFIC_RHS)
+    if (sprite->control() & OSprites::TRAFFIC_RHS)
     {
         x += (oroad.road_width >> 16) << 1;
     }
@@ -526,11 +526,11 @@ void OTraffic::update_props(oentry* sprite)
 
     if (x < 0)
     {
-        sprite->control &= ~OSprites::HFLIP;
+        sprite->control() &= ~OSprites::HFLIP;
     }
     else
     {
-        sprite->control |= OSprites::HFLIP;
+        sprite->control() |= OSprites::HFLIP;
     }
 
     // ------------------------------------------------------------------------
@@ -646,95 +646,109 @@ void OTraffic::set_max_traffic()
 // a4 = Address of sprite ready for HW
 //
 // Source: 0x7990
-void OTraffic::traffic_logic()
+// Traffic added to the sprite list. Kept by priority, after any of the same priority, as
+// the stable sort in OSprites::sprite_copy() places them.
+void OTraffic::order_traffic(oentry* sprite)
 {
-    uint16_t sprite_count = osprites.sprite_count - osprites.spr_cnt_shadow;
-    uint16_t spawned = 0; // d5
-    
-    if (!sprite_count)
+    if (traffic_ordered == TRAFFIC_ORDER_MAX)
     {
-        calculate_avg_speed(0);
+        traffic_order_full = true;
         return;
     }
-       
-    oentry* first = 0;
-    uint8_t index = 0;
-    uint16_t spr_index = osprites.spr_cnt_shadow;
-
-    // Find First Traffic Entry. Note we use the hardware sprite list here to extract the original object.
-    for (index = 0; index < sprite_count; index++)
+    const uint16_t priority = sprite->priority & 0x1FF;
+    uint8_t i = traffic_ordered++;
+    for (; i > 0 && traffic_order_pri[i - 1] > priority; i--)
     {
-        uint16_t src_index = osprites.sprite_entries[spr_index++].scratch;
+        traffic_order[i]     = traffic_order[i - 1];
+        traffic_order_pri[i] = traffic_order_pri[i - 1];
+    }
+    traffic_order[i]     = sprite;
+    traffic_order_pri[i] = priority;
+}
+
+void OTraffic::traffic_logic()
+{
+    uint16_t spawned = 0; // d5
 
-        first = &osprites.jump_table[src_index];
-        if (first->control & OSprites::TRAFFIC_SPRITE)
+    // Traffic in the order of the hardware sprite list. That's traffic_order, unless sprites were
+    // left out of the list, when the list itself is walked to find what made it in.
+    oentry* listed[OSprites::HW_ENTRIES_MAX];
+    oentry* const* traffic = traffic_order;
+    uint16_t count = traffic_ordered;
+    if (traffic_order_full || osprites.spr_cnt_dropped)
+    {
+        const uint16_t sprite_count = osprites.sprite_count - osprites.spr_cnt_shadow;
+        count   = 0;
+        traffic = listed;
+        for (uint16_t i = 0; i < sprite_count; i++)
         {
-            traffic_adr[spawned++] = first;
-            break;
+            oentry* e = &osprites.jump_table[osprites.sprite_entries[osprites.spr_cnt_shadow + i].scratch];
+            if (e->control() & OSprites::TRAFFIC_SPRITE)
+                listed[count++] = e;
         }
     }
+    traffic_ordered    = 0;
+    traffic_order_full = false;
 
     // No Traffic Found, get out of there
-    if (!spawned)
+    if (!count)
     {
         calculate_avg_speed(0);
         return;
     }
 
+    oentry* first = traffic[0];
+    traffic_adr[spawned++] = first;
     oentry* next = 0;
 
     // Compare Current Traffic Entry With Previous One
-    for (uint8_t index2 = index + 1; index2 < sprite_count; index2++)
+    for (uint16_t index2 = 1; index2 < count; index2++)
     {
-        uint16_t src_index = osprites.sprite_entries[spr_index++].scratch;
-        next = &osprites.jump_table[src_index];
-        if (next->control & OSprites::TRAFFIC_SPRITE)
-        {
-            traffic_adr[spawned++] = next;
-            next->traffic_proximity = 0;
-
-            uint16_t z16 = first->z >> 16;
-
-            if (z16 < 0x40)
-            {
-                first = next;
-                continue;
-            }
+        next = traffic[index2];
+        traffic_adr[spawned++] = next;
+        next->traffic_proximity = 0;
 
-            z16 += (z16 >> 1) + (z16 >> 2); // [x1.75 original value]
+        uint16_t z16 = first->z >> 16;
 
-            if (z16 <= next->z >> 16)   
-            {
-                first = next;
-                continue;
-            }
+        if (z16 < 0x40)
+        {
+            first = next;
+            continue;
+        }
 
-            next->traffic_proximity |= BIT_2; // Denote entry2 is close to other traffic (z axis)
+        z16 += (z16 >> 1) + (z16 >> 2); // [x1.75 original value]
 
-            int16_t x_diff = first->xw1 - next->xw1; // d1
-            int16_t x_diff_abs = x_diff < 0 ? -x_diff : x_diff; // d0
+        if (z16 <= next->z >> 16)   
+        {
+            first = next;
+            continue;
+        }
 
-            if (x_diff_abs - 0x80 >= 0)
-            {
-                first = next;
-                continue;
-            }
+        next->traffic_proximity |= BIT_2; // Denote entry2 is close to other traffic (z axis)
 
-            if (x_diff >= 0)
-            {
-                first->traffic_proximity |= BIT_1; // Entry 1: Denote traffic on RHS
-                next->traffic_proximity |= BIT_0;  // Entry 2: Denote traffic on LHS [remember x scale is reversed on outrun]
-            }
-            else
-            {
-                first->traffic_proximity |= BIT_0; // Entry 1: Denote traffic on LHS
-                next->traffic_proximity |= BIT_1;  // Entry 2: Denote traffic on RHS
-            }
+        int16_t x_diff = first->xw1 - next->xw1; // d1
+        int16_t x_diff_abs = x_diff < 0 ? -x_diff : x_diff; // d0
 
-            // Copy car speed into entry 2 to avoid collision
-            next->traffic_near_speed = first->traffic_speed;
+        if (x_diff_abs - 0x80 >= 0)
+        {
             first = next;
+            continue;
+        }
+
+        if (x_diff >= 0)
+        {
+            first->traffic_proximity |= BIT_1; // Entry 1: Denote traffic on RHS
+            next->traffic_proximity |= BIT_0;  // Entry 2: Denote traffic on LHS [remember x scale is reversed on outrun]
+        }
+        else
+        {
+            first->traffic_proximity |= BIT_0; // Entry 1: Denote traffic on LHS
+            next->traffic_proximity |= BIT_1;  // Entry 2: Denote traffic on RHS
         }
+
+        // Copy car speed into entry 2 to avoid collision
+        next->traffic_near_speed = first->traffic_speed;
+        first = next;
     }
 
     calculate_avg_speed(spawned);
@@ -44,6 +44,7 @@ public:
     void set_max_traffic();
     void traffic_logic();
     void traffic_sound();
+    void order_traffic(oentry* sprite);
 
 private:
 
@@ -60,6 +61,14 @@ private:
     // Onscreen traffic objects
     oentry* traffic_adr[9];
 
+    // Traffic added to the sprite list this frame, by priority as the hardware list holds them,
+    // so that traffic_logic() needn't walk the hardware list to find them
+    const static uint8_t TRAFFIC_ORDER_MAX = 16;
+    oentry*  traffic_order[TRAFFIC_ORDER_MAX];
+    uint16_t traffic_order_pri[TRAFFIC_ORDER_MAX];
+    uint8_t  traffic_ordered;
+    bool     traffic_order_full;
+
     // Maximum number of on-screen enemies
     uint8_t max_traffic;
 
@@ -34,6 +34,10 @@ void outils::reset_random_seed()
     rnd_seed = 0;
 }
 
+// Kept in engine state snapshots, so that a restart sees the same traffic
+uint32_t outils::get_random_seed()      { return rnd_seed; }
+void outils::set_random_seed(uint32_t s) { rnd_seed = s; }
+
 uint32_t outils::random()
 {
 	// New seed value
@@ -21,6 +21,8 @@ public:
 	~outils();
 
     static void reset_random_seed();
+    static uint32_t get_random_seed();
+    static void set_random_seed(uint32_t);
 	static uint32_t random();
 	static int32_t isqrt(int32_t);
     static uint16_t convert16_dechex(uint16_t);
@@ -9,6 +9,9 @@
 
 #include "main.hpp"
 #include "trackloader.hpp"
+#include "enginestate.hpp"
+#include "ghost.hpp"
+#include "twinlink.hpp"
 #include "../utils.hpp"
 #include "engine/oattractai.hpp"
 #include "engine/oanimseq.hpp"
@@ -29,6 +32,8 @@
 #include "engine/otiles.hpp"
 #include "engine/otraffic.hpp"
 #include "engine/outils.hpp"
+#include "frametrace.hpp"
+#include "enginecost.hpp"
 #include <iostream>
 
 Outrun outrun;
@@ -107,6 +112,34 @@ void Outrun::boot()
 void Outrun::tick(bool tick_frame)
 {
     this->tick_frame = tick_frame;
+
+    // Instant Replay: the ticks of the race are kept, and the end of it is played back before the
+    // score entry screen. The game carries on from where it left off afterwards.
+    if (enginestate::replaying())
+    {
+        enginestate::step_replay();
+        if (enginestate::replaying())
+            ohud.blit_text_new(17, 8, "REPLAY");
+        return;
+    }
+    if (cannonball_mode != MODE_TTRIAL)
+    {
+        if (game_state == GS_INIT_BEST2 && enginestate::begin_replay())
+            return;
+        if (game_state == GS_INIT_GAME)
+            enginestate::clear_ring();
+        else if (game_state >= GS_START1 && game_state <= GS_INGAME)
+            enginestate::record();
+    }
+
+    // Time Trial Quick Restart: the state as the race is set up is taken, and START puts it back
+    if (tick_frame && cannonball_mode == MODE_TTRIAL && config.ttrial.quick_restart)
+    {
+        if (game_state == GS_INIT_GAME)
+            enginestate::save(enginestate::RACE_START);
+        else if (game_state >= GS_START1 && game_state <= GS_GAMEOVER && input.has_pressed(Input::START))
+            enginestate::restore(enginestate::RACE_START);
+    }
     
     if (tick_frame)
     {
@@ -125,6 +158,8 @@ void Outrun::tick(bool tick_frame)
         }
     }
 
+    enginecost::set_context(ostats.cur_stage, game_state);
+
     // Only tick the road cpu twice for every time we tick the main cpu
     // The timing here isn't perfect, as normally the road CPU would run in parallel with the main CPU.
     // We can potentially hack this by calling the road CPU twice.
@@ -136,7 +171,8 @@ void Outrun::tick(bool tick_frame)
     if (config.fps == 30 && config.tick_fps == 30)
     {
         jump_table();
-        oroad.tick();
+        tick_road();
+        osoundint.engine_update();
         vint();
         vint();
     }
@@ -148,7 +184,8 @@ void Outrun::tick(bool tick_frame)
         if (tick_frame)
         {
             jump_table();
-            oroad.tick();
+            tick_road();
+            osoundint.engine_update();
         }
         vint();
     }
@@ -158,7 +195,8 @@ void Outrun::tick(bool tick_frame)
     else
     {
         jump_table();
-        oroad.tick();
+        tick_road();
+        osoundint.engine_update();
         vint();
     }
 
@@ -170,16 +208,27 @@ void Outrun::tick(bool tick_frame)
         outputs->coin_chute_out(&outputs->chute2, coin == 2);
     }
 
-    // Draw FPS
-    if (config.video.fps_count)
-        ohud.draw_fps_counter(cannonball::fps_counter);
+    // Draw FPS, or the performance HUD
+    if (config.video.fps_count == 2) {
+        ohud.draw_perf_hud();
+    } else {
+        ohud.clear_perf_hud();
+        if (config.video.fps_count)
+            ohud.draw_fps_counter(cannonball::fps_counter);
+    }
 }
 
 // Vertical Interrupt
 void Outrun::vint()
 {
+    enginecost::Scope cost(enginecost::VINT);
     otiles.write_tilemap_hw();
     osprites.update_sprites();
+    if (config.interpolate && !tick_frame)
+    {
+        osprites.present_exact();
+        oroad.present_exact();
+    }
     otiles.update_tilemaps(cannonball_mode == MODE_ORIGINAL ? ostats.cur_stage : 0);
     opalette.cycle_sky_palette();
     opalette.fade_palette();
@@ -190,9 +239,14 @@ void Outrun::vint()
 
 void Outrun::jump_table()
 {
+    frametrace::Scope trace(frametrace::JUMP_TABLE);
+
     if (tick_frame && game_state != GS_CALIBRATE_MOTOR)
     {
-        main_switch();                  // Address #1 (0xB128) - Main Switch
+        {
+            enginecost::Scope cost(enginecost::MAIN_SWITCH);
+            main_switch();              // Address #1 (0xB128) - Main Switch
+        }
         oinputs.adjust_inputs();        // Address #2 (0x74D8) - Adjust Analogue Inputs
     }
 
@@ -211,8 +265,8 @@ void Outrun::jump_table()
 
         case GS_MUSIC:
             if (tick_frame) omusic.check_start(); // Check for start button
-            osprites.tick();
-            olevelobjs.do_sprite_routine();
+            tick_sprites();
+            tick_levelobjs();
 
             if (!outrun.tick_frame)
             {
@@ -225,8 +279,8 @@ void Outrun::jump_table()
         // ----------------------------------------------------------------------------------------
         case GS_INIT_BEST2:
         case GS_BEST2:
-            osprites.tick();
-            olevelobjs.do_sprite_routine();
+            tick_sprites();
+            tick_levelobjs();
 
             if (!tick_frame)
             {
@@ -250,29 +304,49 @@ void Outrun::jump_table()
             [[fallthrough]];
 
         default:
-            if (tick_frame) osprites.tick();                // Address #3 Jump_SetupSprites
-            olevelobjs.do_sprite_routine();                 // replaces calling each sprite individually
+            if (tick_frame) tick_sprites();                 // Address #3 Jump_SetupSprites
+            tick_levelobjs();                               // replaces calling each sprite individually
             if (!config.engine.disable_traffic)
+            {
+                enginecost::Scope cost(enginecost::TRAFFIC);
                 otraffic.tick();                            // Spawn & Tick Traffic
+            }
             if (tick_frame) oinitengine.init_crash_bonus(); // Initalize crash sequence or bonus code
-            oferrari.tick();
+            {
+                enginecost::Scope cost(enginecost::FERRARI);
+                oferrari.tick();
+            }
+            ghost::tick();                                  // Time Trial Ghost Car
+            twinlink::tick();                               // Linked Cabinet's Car
             if (oferrari.state != OFerrari::FERRARI_END_SEQ)
             {
-                oanimseq.flag_seq();
-                ocrash.tick();
-                osmoke.draw_ferrari_smoke(&osprites.jump_table[OSprites::SPRITE_SMOKE1]); // Do Left Hand Smoke
-                oferrari.draw_shadow();                                                   // (0xF1A2) - Draw Ferrari Shadow
-                osmoke.draw_ferrari_smoke(&osprites.jump_table[OSprites::SPRITE_SMOKE2]); // Do Right Hand Smoke
+                {
+                    enginecost::Scope cost(enginecost::ANIMSEQ);
+                    oanimseq.flag_seq();
+                }
+                {
+                    enginecost::Scope cost(enginecost::CRASH);
+                    ocrash.tick();
+                }
+                draw_smoke(OSprites::SPRITE_SMOKE1);                                      // Do Left Hand Smoke
+                {
+                    enginecost::Scope cost(enginecost::FERRARI);
+                    oferrari.draw_shadow();                                               // (0xF1A2) - Draw Ferrari Shadow
+                }
+                draw_smoke(OSprites::SPRITE_SMOKE2);                                      // Do Right Hand Smoke
             }
             else
             {
-                osmoke.draw_ferrari_smoke(&osprites.jump_table[OSprites::SPRITE_SMOKE1]); // Do Left Hand Smoke
-                osmoke.draw_ferrari_smoke(&osprites.jump_table[OSprites::SPRITE_SMOKE2]); // Do Right Hand Smoke
+                draw_smoke(OSprites::SPRITE_SMOKE1);                                      // Do Left Hand Smoke
+                draw_smoke(OSprites::SPRITE_SMOKE2);                                      // Do Right Hand Smoke
             }
             break;
     }
 
-    osprites.sprite_copy();
+    {
+        enginecost::Scope cost(enginecost::SPRITE_COPY);
+        osprites.sprite_copy();
+    }
 
     // Motor Code
     if (tick_frame)
@@ -300,6 +374,31 @@ void Outrun::jump_table()
     }
 }
 
+// Engine routines timed for enginecost.hpp, where called from more than one place
+void Outrun::tick_road()
+{
+    enginecost::Scope cost(enginecost::ROAD);
+    oroad.tick();
+}
+
+void Outrun::tick_sprites()
+{
+    enginecost::Scope cost(enginecost::SPRITES);
+    osprites.tick();
+}
+
+void Outrun::tick_levelobjs()
+{
+    enginecost::Scope cost(enginecost::LEVELOBJS);
+    olevelobjs.do_sprite_routine();
+}
+
+void Outrun::draw_smoke(int sprite)
+{
+    enginecost::Scope cost(enginecost::SMOKE);
+    osmoke.draw_ferrari_smoke(&osprites.jump_table[sprite]);
+}
+
 // Source: 0xB15E
 void Outrun::main_switch()
 {
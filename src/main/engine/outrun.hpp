@@ -244,6 +244,12 @@ private:
     void init_attract();
     void tick_attract();
     void check_freeplay_start();
+
+    // Timed (see enginecost.hpp)
+    void tick_road();
+    void tick_sprites();
+    void tick_levelobjs();
+    void draw_smoke(int sprite);
 };
 
 extern Outrun outrun;
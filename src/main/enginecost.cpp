@@ -0,0 +1,84 @@
+/***************************************************************************
+    Engine Cost Accounting.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include "enginecost.hpp"
+
+static const char* NAMES[enginecost::SUBSYSTEMS] = {
+    "switch", "sprites", "levelobj", "traffic", "ferrari", "animseq", "crash", "smoke",
+    "spr_copy", "road", "vint"
+};
+
+struct Cost
+{
+    uint64_t ticks[enginecost::SUBSYSTEMS];
+    uint64_t calls[enginecost::SUBSYSTEMS];
+};
+static Cost costs[enginecost::STAGES][enginecost::STATES];
+static Cost* current = &costs[0][0];
+static int   cur_stage = 0, cur_state = 0;
+
+void enginecost::set_context(int stage, int game_state)
+{
+    cur_stage = std::clamp(stage, 0, STAGES - 1);
+    cur_state = game_state >= 0 && game_state < STATES - 1 ? game_state : STATES - 1;
+    current   = &costs[cur_stage][cur_state];
+}
+
+void enginecost::get_context(int* stage, int* game_state)
+{
+    *stage      = cur_stage;
+    *game_state = cur_state;
+}
+
+void enginecost::record(int subsystem, uint64_t start)
+{
+    current->ticks[subsystem] += frametrace::now() - start;
+    current->calls[subsystem]++;
+}
+
+double enginecost::total_ms(int stage, int game_state, int subsystem, uint64_t* calls)
+{
+    const Cost& c = costs[stage][game_state];
+    *calls = c.calls[subsystem];
+    return frametrace::to_ms(c.ticks[subsystem]);
+}
+
+const char* enginecost::name(int subsystem)
+{
+    return NAMES[subsystem];
+}
+
+void enginecost::report(std::ostream& out)
+{
+    char line[32];
+    snprintf(line, sizeof(line), "%-17s", "Engine cost (ms)");
+    out << line;
+    for (int s = 0; s < SUBSYSTEMS; s++) {
+        snprintf(line, sizeof(line), " %8s", NAMES[s]);
+        out << line;
+    }
+    out << "\n";
+
+    for (int stage = 0; stage < STAGES; stage++)
+        for (int state = 0; state < STATES; state++) {
+            const Cost& c = costs[stage][state];
+            if (std::none_of(c.calls, c.calls + SUBSYSTEMS, [](uint64_t n) { return n != 0; }))
+                continue;
+            snprintf(line, sizeof(line), "stage %d state %-3d", stage + 1, state);
+            out << line;
+            for (int s = 0; s < SUBSYSTEMS; s++) {
+                if (c.calls[s])
+                    snprintf(line, sizeof(line), " %8.3f", frametrace::to_ms(c.ticks[s]) / double(c.calls[s]));
+                else
+                    snprintf(line, sizeof(line), " %8s", "-");
+                out << line;
+            }
+            out << "\n";
+        }
+}
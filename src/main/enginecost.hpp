@@ -0,0 +1,75 @@
+/***************************************************************************
+    Engine Cost Accounting.
+
+    The frame trace times the game logic as a whole (frametrace::JUMP_TABLE);
+    this splits it by subsystem: the main switch, each of the engine's tick
+    routines called from the jump table, the road and the vertical interrupt.
+    Each is timed with the frame trace's counter, and the time and calls are
+    added up separately for every stage (ostats.cur_stage) and game state, as
+    a heavy stage or route may stress a board where others don't.
+
+    The totals are kept for the whole run. The performance HUD shows the
+    costliest subsystems of the stage and state being played, and report()
+    writes the lot as a table, on exit when video.trace is set.
+
+    All of this runs on the game thread, so the totals are plain counts.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include "frametrace.hpp"
+
+namespace enginecost
+{
+    enum
+    {
+        MAIN_SWITCH,    // Outrun::main_switch()
+        SPRITES,        // OSprites::tick()
+        LEVELOBJS,      // OLevelObjs::do_sprite_routine()
+        TRAFFIC,        // OTraffic::tick()
+        FERRARI,        // OFerrari::tick() and draw_shadow()
+        ANIMSEQ,        // OAnimSeq::flag_seq()
+        CRASH,          // OCrash::tick()
+        SMOKE,          // OSmoke::draw_ferrari_smoke()
+        SPRITE_COPY,    // OSprites::sprite_copy()
+        ROAD,           // ORoad::tick()
+        VINT,           // Outrun::vint()
+        SUBSYSTEMS
+    };
+
+    // Stages kept apart (later ones are added to the last), and game states (GS_CALIBRATE_MOTOR
+    // and anything else out of range share the last)
+    const int STAGES = 8;
+    const int STATES = 23;
+
+    // What's being played, from Outrun::tick(): the costs that follow are added to this stage
+    // and state
+    void set_context(int stage, int game_state);
+    void get_context(int* stage, int* game_state);
+
+    // Add the time since start to subsystem's total in the current stage and state
+    void record(int subsystem, uint64_t start);
+
+    // Times the enclosing scope
+    struct Scope
+    {
+        explicit Scope(int subsystem) : subsystem(subsystem), start(frametrace::now()) {}
+        ~Scope() { record(subsystem, start); }
+        int subsystem;
+        uint64_t start;
+    };
+
+    // Total time (ms) and calls of subsystem in a stage and state, since start-up
+    double total_ms(int stage, int game_state, int subsystem, uint64_t* calls);
+
+    // Short name of a subsystem, for the HUD and report
+    const char* name(int subsystem);
+
+    // Write the mean time per call of each subsystem, a line per stage and state seen
+    void report(std::ostream& out);
+}
@@ -0,0 +1,346 @@
+/***************************************************************************
+    Engine State Snapshots.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <spanstream>
+#include <sstream>
+#include <vector>
+#include "enginestate.hpp"
+#include "trackloader.hpp"
+#include "video.hpp"
+#include "frontend/config.hpp"
+#include "engine/oanimseq.hpp"
+#include "engine/oattractai.hpp"
+#include "engine/obonus.hpp"
+#include "engine/ocrash.hpp"
+#include "engine/oferrari.hpp"
+#include "engine/ohud.hpp"
+#include "engine/oinitengine.hpp"
+#include "engine/oinputs.hpp"
+#include "engine/olevelobjs.hpp"
+#include "engine/ologo.hpp"
+#include "engine/omap.hpp"
+#include "engine/omusic.hpp"
+#include "engine/opalette.hpp"
+#include "engine/oroad.hpp"
+#include "engine/osmoke.hpp"
+#include "engine/osprites.hpp"
+#include "engine/ostats.hpp"
+#include "engine/otiles.hpp"
+#include "engine/otraffic.hpp"
+#include "engine/outils.hpp"
+#include "engine/outrun.hpp"
+
+// Engine objects copied as bytes, in arena order
+struct Object
+{
+    void*  data;
+    size_t bytes;
+};
+
+static const Object OBJECTS[] =
+{
+    { &outrun,      sizeof(outrun)      },
+    { &ostats,      sizeof(ostats)      },
+    { &oinitengine, sizeof(oinitengine) },
+    { &oroad,       sizeof(oroad)       },
+    { &otraffic,    sizeof(otraffic)    },
+    { &osprites,    sizeof(osprites)    },
+    { &osmoke,      sizeof(osmoke)      },
+    { &oferrari,    sizeof(oferrari)    },
+    { &ocrash,      sizeof(ocrash)      },
+    { &olevelobjs,  sizeof(olevelobjs)  },
+    { &oanimseq,    sizeof(oanimseq)    },
+    { &obonus,      sizeof(obonus)      },
+    { &omap,        sizeof(omap)        },
+    { &ologo,       sizeof(ologo)       },
+    { &ohud,        sizeof(ohud)        },
+    { &opalette,    sizeof(opalette)    },
+    { &otiles,      sizeof(otiles)      },
+    { &omusic,      sizeof(omusic)      },
+    { &oinputs,     sizeof(oinputs)     },
+    { &oattractai,  sizeof(oattractai)  },
+    { &trackloader, sizeof(trackloader) },
+};
+
+// Settings a slot was taken under
+struct Key
+{
+    uint8_t cannonball_mode;
+    engine_settings_t engine;
+    uint8_t ttrial_level;
+    uint8_t ttrial_laps;
+    uint8_t custom_traffic;
+    int widescreen;
+    int hires;
+
+    bool operator==(const Key&) const = default;
+};
+
+// Values outside the engine objects, stored after them
+struct Extra
+{
+    uint32_t random_seed;
+    bool     video_enabled;
+};
+
+struct Store
+{
+    bool valid = false;
+    Key key;
+    std::vector<uint8_t> arena;
+};
+
+static Store slots[enginestate::SLOTS];
+
+// Replay ring. Each tick is stored as the words changed since the tick before, as runs of
+// (words unchanged, words changed, the changed words), with the whole arena every KEY_INTERVAL
+// ticks so that the oldest ticks can be dropped a key frame at a time.
+static const int KEY_INTERVAL   = 64;
+static const int REPLAY_SECONDS = 10;
+
+struct Frame
+{
+    bool key;
+    std::vector<uint32_t> words;
+};
+
+static std::deque<Frame>     ring;
+static size_t                ring_bytes = 0;
+static std::vector<uint8_t>  ring_last;      // arena of the newest tick
+static std::vector<uint8_t>  ring_arena;     // arena being captured
+static std::vector<uint8_t>  replay_arena;   // arena of the tick being replayed
+static int                   since_key   = 0;
+static size_t                replay_next = 0;
+static bool                  replay_on   = false;
+
+static Key current_key()
+{
+    Key key;
+    key.cannonball_mode = outrun.cannonball_mode;
+    key.engine          = config.engine;
+    key.ttrial_level    = outrun.ttrial.level;
+    key.ttrial_laps     = outrun.ttrial.laps;
+    key.custom_traffic  = outrun.custom_traffic;
+    key.widescreen      = config.video.widescreen;
+    key.hires           = config.video.hires;
+    return key;
+}
+
+// The engine into arena, padded to whole words for the replay ring
+static bool capture(std::vector<uint8_t>& arena)
+{
+    static std::ostringstream layers;
+    layers.str(std::string());
+    if (!video.save_state(layers))
+    {
+        std::cerr << "Unable to take engine state" << std::endl;
+        return false;
+    }
+    const std::string video_state = layers.str();
+
+    size_t bytes = sizeof(Extra) + video_state.size();
+    for (const Object& o : OBJECTS)
+        bytes += o.bytes;
+    arena.resize((bytes + 3) & ~size_t(3));
+
+    uint8_t* p = arena.data();
+    for (const Object& o : OBJECTS)
+    {
+        std::memcpy(p, o.data, o.bytes);
+        p += o.bytes;
+    }
+    const Extra extra = { outils::get_random_seed(), video.enabled };
+    std::memcpy(p, &extra, sizeof(extra));
+    p += sizeof(extra);
+    std::memcpy(p, video_state.data(), video_state.size());
+    return true;
+}
+
+static void apply(const std::vector<uint8_t>& arena)
+{
+    const uint8_t* p = arena.data();
+    for (const Object& o : OBJECTS)
+    {
+        std::memcpy(o.data, p, o.bytes);
+        p += o.bytes;
+    }
+    Extra extra;
+    std::memcpy(&extra, p, sizeof(extra));
+    p += sizeof(extra);
+
+    outils::set_random_seed(extra.random_seed);
+    video.enabled = extra.video_enabled;
+
+    std::ispanstream layers(std::span<const char>(reinterpret_cast<const char*>(p),
+                                                  size_t(arena.data() + arena.size() - p)));
+    if (!video.load_state(layers))
+        std::cerr << "Engine state video layers are truncated" << std::endl;
+}
+
+void enginestate::save(Slot slot)
+{
+    Store& s = slots[slot];
+    s.valid = capture(s.arena);
+    s.key   = current_key();
+}
+
+bool enginestate::restore(Slot slot)
+{
+    Store& s = slots[slot];
+    if (!s.valid || !(s.key == current_key()))
+        return false;
+
+    // The best lap so far stands, and a record set since the slot was taken is still saved
+    const int16_t best_lap_counter = outrun.ttrial.best_lap_counter;
+    uint8_t best_lap[3];
+    std::memcpy(best_lap, outrun.ttrial.best_lap, sizeof(best_lap));
+    const bool new_high_score = outrun.ttrial.new_high_score;
+
+    apply(s.arena);
+
+    outrun.ttrial.best_lap_counter = best_lap_counter;
+    std::memcpy(outrun.ttrial.best_lap, best_lap, sizeof(best_lap));
+    outrun.ttrial.new_high_score = new_high_score;
+
+    osoundint.init();
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Replay Ring
+// ------------------------------------------------------------------------------------------------
+
+static size_t frame_bytes(const Frame& f) { return f.words.size() * sizeof(uint32_t); }
+
+// Changes from prev to next, both of the same number of words
+static void encode_delta(const uint32_t* prev, const uint32_t* next, size_t n, std::vector<uint32_t>& out)
+{
+    out.clear();
+    size_t i = 0;
+    while (i < n)
+    {
+        const size_t same_from = i;
+        while (i < n && prev[i] == next[i]) i++;
+        if (i == n)
+            break;
+        const size_t diff_from = i;
+        while (i < n && prev[i] != next[i]) i++;
+        out.push_back(uint32_t(diff_from - same_from));
+        out.push_back(uint32_t(i - diff_from));
+        out.insert(out.end(), next + diff_from, next + i);
+    }
+}
+
+static void apply_frame(const Frame& f, std::vector<uint8_t>& arena)
+{
+    if (f.key)
+    {
+        arena.resize(frame_bytes(f));
+        std::memcpy(arena.data(), f.words.data(), frame_bytes(f));
+        return;
+    }
+    uint32_t* words = reinterpret_cast<uint32_t*>(arena.data());
+    size_t at = 0;
+    for (size_t i = 0; i < f.words.size(); )
+    {
+        at += f.words[i];
+        const uint32_t changed = f.words[i + 1];
+        std::memcpy(words + at, &f.words[i + 2], changed * sizeof(uint32_t));
+        at += changed;
+        i  += 2 + changed;
+    }
+}
+
+void enginestate::record()
+{
+    const size_t budget = size_t(std::max(config.engine.replay_mb, 0)) << 20;
+    if (!budget || replay_on || !capture(ring_arena))
+        return;
+
+    Frame f;
+    f.key = ring.empty() || ring_last.size() != ring_arena.size() || ++since_key >= KEY_INTERVAL;
+    if (f.key)
+        since_key = 0;
+    if (f.key)
+        f.words.assign(reinterpret_cast<const uint32_t*>(ring_arena.data()),
+                       reinterpret_cast<const uint32_t*>(ring_arena.data() + ring_arena.size()));
+    else
+        encode_delta(reinterpret_cast<const uint32_t*>(ring_last.data()),
+                     reinterpret_cast<const uint32_t*>(ring_arena.data()),
+                     ring_arena.size() / sizeof(uint32_t), f.words);
+    f.words.shrink_to_fit();
+    ring_bytes += frame_bytes(f);
+    ring.push_back(std::move(f));
+    ring_last.swap(ring_arena);
+
+    // Drop the oldest key frame and the ticks that depend on it, while keeping the newest
+    while (ring_bytes > budget && ring.size() > 1)
+    {
+        do {
+            ring_bytes -= frame_bytes(ring.front());
+            ring.pop_front();
+        } while (!ring.empty() && !ring.front().key);
+    }
+    if (ring.empty())
+        ring_last.clear();
+}
+
+void enginestate::clear_ring()
+{
+    ring.clear();
+    ring_bytes = 0;
+    ring_last.clear();
+}
+
+bool enginestate::begin_replay()
+{
+    // Start from the latest key frame at least REPLAY_SECONDS from the end, or the oldest
+    const size_t want = size_t(REPLAY_SECONDS * config.fps);
+    size_t first = 0;
+    for (size_t i = ring.size(); i-- > 0; )
+    {
+        if (ring[i].key && ring.size() - i >= want)
+        {
+            first = i;
+            break;
+        }
+    }
+    if (ring.empty() || !ring[first].key)
+        return false;
+
+    save(REPLAY_LIVE);
+    if (!slots[REPLAY_LIVE].valid)
+        return false;
+
+    apply_frame(ring[first], replay_arena);
+    apply(replay_arena);
+    replay_next = first + 1;
+    replay_on   = true;
+    osoundint.init();
+    return true;
+}
+
+bool enginestate::replaying() { return replay_on; }
+
+void enginestate::step_replay()
+{
+    if (replay_next < ring.size())
+    {
+        apply_frame(ring[replay_next++], replay_arena);
+        apply(replay_arena);
+        return;
+    }
+
+    // Back to the game as the replay began
+    replay_on = false;
+    clear_ring();
+    restore(REPLAY_LIVE);
+}
@@ -0,0 +1,59 @@
+/***************************************************************************
+    Engine State Snapshots.
+
+    The whole of the game engine's state, taken at a point worth returning
+    to and held in one contiguous arena: the engine objects as they are in
+    memory, the random seed, then the video hardware state (palette, tile,
+    sprite and road layers) as Video::save_state() writes it.
+
+    The engine objects hold plain values, and pointers only into ROM data,
+    track data and their own arrays, none of which move once the course is
+    selected, so a byte copy restores them. Left out, as they must outlast a
+    restore: the hi-score tables, the sound chips (the audio thread owns
+    them; a restore resets the sound queue instead) and the best lap of a
+    time trial.
+
+    A slot only restores under the settings it was taken with: game mode,
+    engine options, time trial course, laps and traffic, and the video
+    mode. Otherwise restore() fails and the caller carries on as before.
+
+    Used for the time trial quick restart (time_trial.quick_restart): the
+    state is taken as the race is set up, and START puts it back.
+
+    The replay ring holds the state of every tick of a race, each as the
+    words changed since the tick before (most of road and sprite RAM, and
+    of the engine, is the same from one tick to the next), with the whole
+    state every so often so that the oldest ticks can be dropped. It's kept
+    within engine.replay_mb, and the last ten seconds in it are played back
+    before the score entry screen. Any tick in it could be put back, which
+    is what rollback between linked cabinets would need.
+
+    Taken and restored on the game thread, in tick(), while no layer is
+    being prepared.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+namespace enginestate
+{
+    enum Slot { RACE_START, REPLAY_LIVE, SLOTS };
+
+    // Take the engine state into slot, replacing what was there
+    void save(Slot slot);
+
+    // Put slot back. False, with nothing changed, if it's empty or the settings have changed since.
+    bool restore(Slot slot);
+
+    // Add this tick to the replay ring (nothing with engine.replay_mb 0, or while replaying)
+    void record();
+    void clear_ring();
+
+    // Play back the end of the ring, one tick per step_replay(). False if the ring is empty.
+    // Once the replay ends the game is put back as it was at begin_replay(), and the ring cleared.
+    bool begin_replay();
+    bool replaying();
+    void step_replay();
+}
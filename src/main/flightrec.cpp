@@ -0,0 +1,134 @@
+/***************************************************************************
+    Slow Frame Flight Recorder.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "flightrec.hpp"
+#include "frametrace.hpp"
+#include "threadpolicy.hpp"
+#include "main.hpp"
+#include "frontend/config.hpp"
+#include "engine/outrun.hpp"
+#include "engine/ostats.hpp"
+#include "engine/osprites.hpp"
+#include "engine/audio/osoundint.hpp"
+
+static const uint32_t FRAMES = 256;   // about 4 seconds at 60fps; a power of two
+static const uint32_t SETTLE = 60;    // frames recorded before a slow one counts, after reset()
+
+struct Record
+{
+    uint32_t frame;
+    float    frame_ms, tick_ms, layers_ms, blargg_ms, upload_ms, draw_ms, present_ms, audio_ms;
+    int16_t  game_state;
+    int8_t   stage;
+    uint8_t  pcm_voices;
+    uint16_t sprites, sprites_dropped;
+    uint8_t  wav_state;
+    uint32_t underruns;
+};
+
+static const char* WAV_STATES[] = { "none", "loading", "streaming", "loaded" };
+
+static Record            ring[FRAMES];
+static uint32_t          frame_no   = 0;
+static uint32_t          recorded   = 0;   // since reset()
+static uint32_t          next_dump  = 0;   // frame_no from which a slow frame may dump again
+static uint32_t          dumps      = 0;
+static std::thread       writer;
+static std::atomic<bool> writing{false};
+
+static void write_dump(std::vector<Record> frames, float budget_ms, uint32_t dump)
+{
+    threadpolicy::apply(threads_settings_t::STATS);
+
+    const std::string path = config.data.save_path + "slowframes.txt";
+    FILE* f = std::fopen(path.c_str(), "a");
+    if (!f) {
+        fprintf(stderr, "flightrec: unable to write %s\n", path.c_str());
+        writing.store(false, std::memory_order_release);
+        return;
+    }
+    const Record& slow = frames.back();
+    fprintf(f, "Slow frame %u (dump %u): %.2fms against a budget of %.2fms\n",
+            slow.frame, dump, slow.frame_ms, budget_ms);
+    fprintf(f, "%8s %7s %7s %7s %7s %7s %7s %7s %7s %5s %5s %4s %4s %3s %-9s %5s\n",
+            "frame", "frame", "tick", "layers", "filter", "upload", "draw", "present", "audio",
+            "state", "stage", "spr", "drop", "pcm", "wav", "ur");
+    for (const Record& r : frames)
+        fprintf(f, "%8u %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f %5d %5d %4u %4u %3u %-9s %5u\n",
+                r.frame, r.frame_ms, r.tick_ms, r.layers_ms, r.blargg_ms, r.upload_ms, r.draw_ms,
+                r.present_ms, r.audio_ms, r.game_state, r.stage + 1, r.sprites, r.sprites_dropped,
+                r.pcm_voices, WAV_STATES[r.wav_state], r.underruns);
+    fprintf(f, "\n");
+    std::fclose(f);
+    writing.store(false, std::memory_order_release);
+}
+
+void flightrec::frame()
+{
+    if (config.video.slow_frame <= 0)
+        return;
+
+    Record& r = ring[frame_no & (FRAMES - 1)];
+    r.frame      = frame_no;
+    r.frame_ms   = float(frametrace::last_ms(frametrace::FRAME));
+    r.tick_ms    = float(frametrace::last_ms(frametrace::TICK));
+    r.layers_ms  = 0.0f;
+    for (int point = frametrace::PREPARE; point < frametrace::BLARGG; point++)
+        r.layers_ms += float(frametrace::last_ms(point));
+    r.blargg_ms  = float(frametrace::last_ms(frametrace::BLARGG));
+    r.upload_ms  = float(frametrace::last_ms(frametrace::UPLOAD));
+    r.draw_ms    = float(frametrace::last_ms(frametrace::DRAW));
+    r.present_ms = float(frametrace::last_ms(frametrace::PRESENT));
+    r.audio_ms   = float(frametrace::last_ms(frametrace::AUDIO_MIX));
+    r.game_state = int16_t(outrun.game_state);
+    r.stage      = ostats.cur_stage;
+    r.sprites         = osprites.sprite_count;
+    r.sprites_dropped = osprites.spr_cnt_dropped;
+    r.pcm_voices = osoundint.pcm ? uint8_t(osoundint.pcm->active_channels()) : 0;
+    r.wav_state  = uint8_t(cannonball::audio.wav_state());
+    r.underruns  = cannonball::audio.get_ring_stats().underruns;
+
+    frame_no++;
+    if (++recorded < SETTLE)
+        return;
+
+    const float budget = 1000.0f / float(config.fps);
+    if (r.frame_ms <= budget * float(100 + config.video.slow_frame) / 100.0f ||
+        int32_t(frame_no - next_dump) < 0 || writing.load(std::memory_order_acquire))
+        return;
+
+    // oldest first, up to the slow frame
+    const uint32_t n = std::min(recorded, FRAMES);
+    std::vector<Record> frames;
+    frames.reserve(n);
+    for (uint32_t i = frame_no - n; i != frame_no; i++)
+        frames.push_back(ring[i & (FRAMES - 1)]);
+
+    if (writer.joinable())
+        writer.join();
+    writing.store(true, std::memory_order_relaxed);
+    writer    = std::thread(write_dump, std::move(frames), budget, ++dumps);
+    next_dump = frame_no + FRAMES;
+    printf("\nSlow frame: %.1fms, last %u frames written to slowframes.txt\n", r.frame_ms, n);
+}
+
+void flightrec::reset()
+{
+    recorded = 0;
+}
+
+void flightrec::stop()
+{
+    if (writer.joinable())
+        writer.join();
+}
@@ -0,0 +1,32 @@
+/***************************************************************************
+    Slow Frame Flight Recorder.
+
+    The console shows how many frames a cabinet drops, but not why. This
+    keeps the last few seconds of frames in a ring: the time of each and of
+    its main stages (from frametrace), the game state and stage, the sprites
+    drawn and dropped, the PCM voices playing, the custom music loader's
+    state and the audio underruns so far.
+
+    When a frame takes video.slow_frame percent longer than the frame
+    budget, the ring is copied and written, by a background thread, to
+    slowframes.txt in the save folder, so a stutter on stage 3 comes with
+    the frames leading up to it. Dumps are a ring's length apart at least.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+namespace flightrec
+{
+    // Record the frame just shown, once a frame from the main loop, and dump the ring if it was
+    // slow. Does nothing with video.slow_frame at 0.
+    void frame();
+
+    // Ignore the frames about to follow (e.g. a video restart or the menus loading)
+    void reset();
+
+    // Finish any dump being written
+    void stop();
+}
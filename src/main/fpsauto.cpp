@@ -0,0 +1,107 @@
+/***************************************************************************
+    30/60fps Auto Mode.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "fpsauto.hpp"
+#include "quality.hpp"
+
+// Thresholds, as fractions of a 60fps frame
+static const double FRAME_60_MS    = 1000.0 / 60.0;
+static const double LATE_INTERVAL  = 1.25;  // 60fps: p95 interval above this means over 5% of frames late
+static const double MAX_DROPPED    = 0.05;  // 60fps: fraction of frames dropped
+static const double HEADROOM       = 0.75;  // 30fps: p95 work below this fits comfortably at 60fps
+static const double HEADROOM_RETRY = 0.50;  // 30fps: the same, for a stage marked as needing 30fps
+
+static std::vector<float> intervals;        // ms, rendered frames since the last evaluation
+static std::vector<float> work;             // ms
+static int dropped    = 0;
+static int stages     = 0;                  // mask of stage keys marked as needing 30fps
+static int last_stage = -1;
+
+int fpsauto::stage_key(int stage_lookup_off, bool in_game)
+{
+    // stage_lookup_off is 8 per level, plus the column of the map (0 to the level)
+    const int level = stage_lookup_off >> 3;
+    const int col   = stage_lookup_off & 7;
+    if (!in_game || stage_lookup_off < 0 || level > 4 || col > level)
+        return STAGE_OTHER;
+    return (level * (level + 1) / 2) + col;
+}
+
+void fpsauto::set_stages(int mask) { stages = mask & 0xFFFF; }
+int  fpsauto::get_stages()         { return stages; }
+
+void fpsauto::add_frame(double interval_ms, double work_ms)
+{
+    intervals.push_back(float(interval_ms));
+    work.push_back(float(work_ms));
+}
+
+void fpsauto::add_dropped() { dropped++; }
+
+void fpsauto::reset()
+{
+    intervals.clear();
+    work.clear();
+    dropped = 0;
+}
+
+static double percentile95(std::vector<float>& v)
+{
+    auto nth = v.begin() + (v.size() * 95 / 100);
+    std::nth_element(v.begin(), nth, v.end());
+    return *nth;
+}
+
+int fpsauto::update(int fps, int stage, long window_seconds, bool scale_quality)
+{
+    const bool marked = (stages >> stage) & 1;
+
+    // A new stage is judged on its own frames, and one marked as needing 30fps drops straight away
+    if (stage != last_stage) {
+        last_stage = stage;
+        reset();
+        if (fps == 60 && marked) {
+            printf("\nPerformance check: stage needed 30 FPS last time. Switching to 30 FPS.\n");
+            return 30;
+        }
+    }
+
+    const size_t frames = size_t(window_seconds * fps);
+    if (intervals.size() < frames)
+        return fps;
+
+    int next = fps;
+    if (fps == 60) {
+        const double late      = percentile95(intervals) / FRAME_60_MS;
+        const double drop_rate = double(dropped) / double(intervals.size() + dropped);
+        if (late > LATE_INTERVAL || drop_rate > MAX_DROPPED) {
+            if (scale_quality && quality::reduce()) {
+                reset();
+                return fps;
+            }
+            printf("\nPerformance check: 95%% of frames within %.1fms, %.0f%% dropped. Switching to 30 FPS.\n",
+                   late * FRAME_60_MS, drop_rate * 100.0);
+            stages |= 1 << stage;
+            next = 30;
+        } else if (scale_quality) {
+            quality::restore(percentile95(work) / FRAME_60_MS < HEADROOM);
+        }
+    } else {
+        const double busy = percentile95(work) / FRAME_60_MS;
+        if (busy < (marked ? HEADROOM_RETRY : HEADROOM)) {
+            printf("\nPerformance check: 95%% of frames drawn within %.1fms. Switching to 60 FPS.\n",
+                   busy * FRAME_60_MS);
+            stages &= ~(1 << stage);
+            next = 60;
+        }
+    }
+    reset();
+    return next;
+}
@@ -0,0 +1,50 @@
+/***************************************************************************
+    30/60fps Auto Mode.
+
+    Chooses the frame rate when it isn't locked on the command line. At
+    60fps the rate drops to 30 when the 95th percentile interval between
+    rendered frames runs well over a refresh, or when frames are dropped,
+    which catches vsync misses that an average hides. At 30fps the rate goes
+    back up when the 95th percentile of the time spent on a frame (before
+    the wait for the next) leaves clear headroom inside a 60fps frame.
+
+    Each route stage that had to drop to 30fps is marked, so the rate drops
+    as soon as that stage is reached again, and isn't retried there unless
+    the headroom is large. The marks can be kept across plays in config.xml
+    (video.fps_remember), so the second play of a stage starts at the right
+    rate.
+
+    With the quality governor on (video.quality_governor), 60fps frames that
+    run late turn the effects down a step first (see quality.hpp), and the
+    rate only drops once there are no steps left. Headroom at 60fps brings
+    the steps back.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+namespace fpsauto
+{
+    // Route stage keys: 0-14 for the stages of the map, STAGE_OTHER for the menus
+    const int STAGE_OTHER = 15;
+    int stage_key(int stage_lookup_off, bool in_game);
+
+    // Stages marked as needing 30fps, as a mask of stage keys
+    void set_stages(int mask);
+    int  get_stages();
+
+    // Samples for each rendered frame: time since the last rendered frame started, and the time
+    // spent on this one before the wait for the next. Frames dropped are counted separately.
+    void add_frame(double interval_ms, double work_ms);
+    void add_dropped();
+
+    // Forget the samples so far (after a pause such as a video restart)
+    void reset();
+
+    // Rate to run at (30 or 60), given the current one and the stage being played. Evaluates once
+    // window_seconds of frames are in, or right away on reaching a stage marked as needing 30fps.
+    // With scale_quality, effects are turned down before the rate is.
+    int update(int fps, int stage, long window_seconds, bool scale_quality);
+}
@@ -0,0 +1,86 @@
+/***************************************************************************
+    Frame Buffer Arena.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <cstdint>
+#include <iostream>
+#include <new>
+#include <vector>
+#include "framearena.hpp"
+#include "frontend/config.hpp"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+static const size_t PAGE      = 4096;
+static const size_t HUGE_PAGE = 2 * 1024 * 1024;
+static const size_t RESERVE   = 64 * 1024 * 1024;   // address space only; well over the largest mode
+
+static uint8_t* base     = nullptr;
+static size_t   capacity = 0;
+static size_t   offset   = 0;
+static bool     reserved = false;
+
+// Blocks from the heap, where the region ran out (or there is none)
+struct HeapBlock
+{
+    void*  p;
+    size_t bytes;
+};
+static std::vector<HeapBlock> heap_blocks;
+
+static void reserve()
+{
+    reserved = true;
+#ifdef __linux__
+    // a huge page's worth over, to start the region on one
+    void* p = mmap(nullptr, RESERVE + HUGE_PAGE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "framearena: unable to reserve frame buffer memory; using the heap" << std::endl;
+        return;
+    }
+    base     = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(p) + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1));
+    capacity = RESERVE;
+  #ifdef MADV_HUGEPAGE
+    if (config.video.huge_pages)
+        madvise(base, capacity, MADV_HUGEPAGE);
+  #endif
+#endif
+}
+
+void* framearena::alloc(size_t bytes)
+{
+    if (!reserved)
+        reserve();
+
+    const size_t size = (bytes + PAGE - 1) & ~(PAGE - 1);
+    if (base && offset + size <= capacity) {
+        void* p = base + offset;
+        offset += size;
+        return p;
+    }
+    void* p = ::operator new(size, std::align_val_t(PAGE));
+    heap_blocks.push_back({ p, size });
+    return p;
+}
+
+void framearena::reset()
+{
+    offset = 0;
+    for (const HeapBlock& b : heap_blocks)
+        ::operator delete(b.p, std::align_val_t(PAGE));
+    heap_blocks.clear();
+}
+
+size_t framearena::used()
+{
+    size_t bytes = offset;
+    for (const HeapBlock& b : heap_blocks)
+        bytes += b.bytes;
+    return bytes;
+}
@@ -0,0 +1,38 @@
+/***************************************************************************
+    Frame Buffer Arena.
+
+    The buffers a video mode draws into (the S16 pixel buffer ring and the
+    game surfaces the renderer fills, with the Blargg filter's output) are
+    carved from one region, rather than each being allocated on its own.
+    Each block starts on a page, so on a cache line too, and the region is
+    kept from one video mode to the next: a restart carves the new mode's
+    buffers from the same pages, so a cabinet running for months doesn't
+    fragment its heap, and the frames keep to the same few TLB entries.
+
+    On Linux the region is reserved as anonymous memory, which costs only
+    the pages touched, aligned for transparent huge pages and advised to use
+    them with video.huge_pages. Elsewhere, and for anything that doesn't
+    fit, blocks come from the heap, page aligned.
+
+    The blocks of a mode are freed together, by reset(), once nothing is
+    drawing into them. Both are called from the thread setting up the video.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+namespace framearena
+{
+    // A page aligned block, until the next reset()
+    void* alloc(size_t bytes);
+
+    // Free every block, for the next video mode
+    void reset();
+
+    // Bytes in blocks now
+    size_t used();
+}
@@ -0,0 +1,113 @@
+/***************************************************************************
+    Frame Pacing.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <ostream>
+#include <thread>
+#include "framepacer.hpp"
+
+#ifdef _WIN32
+  #include <windows.h>
+#elif defined(__linux__)
+  #include <cerrno>
+  #include <time.h>
+#endif
+
+using clock_type = std::chrono::steady_clock;
+using std::chrono::nanoseconds;
+
+// Spin margin limits. The margin starts at the top and settles a little above the worst recent
+// oversleep, so a system with a good timer spins for well under a millisecond.
+static const nanoseconds MARGIN_MIN = std::chrono::microseconds(100);
+static const nanoseconds MARGIN_MAX = std::chrono::microseconds(2000);
+static nanoseconds margin    = MARGIN_MAX;
+static double      oversleep = double(MARGIN_MAX.count()); // worst recent oversleep, ns, decaying
+
+// Error statistics since the last report
+static long     waits   = 0;
+static long     late    = 0;                 // returned over 1ms after the deadline
+static double   error_sum = 0.0;             // ns
+static int64_t  error_max = 0;               // ns
+
+#ifdef _WIN32
+// A high-resolution waitable timer where the OS has them (Windows 10 1803+), else an ordinary one
+static HANDLE wait_timer()
+{
+    static HANDLE timer = [] {
+        HANDLE t = CreateWaitableTimerExW(nullptr, nullptr, 0x00000002 /* CREATE_WAITABLE_TIMER_HIGH_RESOLUTION */,
+                                          TIMER_ALL_ACCESS);
+        return t ? t : CreateWaitableTimerW(nullptr, TRUE, nullptr);
+    }();
+    return timer;
+}
+#endif
+
+// Sleep until wake on the best timer available
+static void sleep_until(clock_type::time_point wake)
+{
+#if defined(__linux__)
+    // steady_clock is CLOCK_MONOTONIC, so the deadline can be given as is
+    const int64_t ns = std::chrono::duration_cast<nanoseconds>(wake.time_since_epoch()).count();
+    timespec ts;
+    ts.tv_sec  = time_t(ns / 1000000000);
+    ts.tv_nsec = long(ns % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+#elif defined(_WIN32)
+    const auto wait = wake - clock_type::now();
+    HANDLE timer = wait_timer();
+    if (wait <= nanoseconds(0)) return;
+    if (!timer) { std::this_thread::sleep_for(wait); return; }
+    LARGE_INTEGER due;
+    due.QuadPart = -std::max<int64_t>(1, std::chrono::duration_cast<nanoseconds>(wait).count() / 100); // relative, 100ns units
+    if (SetWaitableTimer(timer, &due, 0, nullptr, nullptr, FALSE))
+        WaitForSingleObject(timer, INFINITE);
+#else
+    std::this_thread::sleep_until(wake);
+#endif
+}
+
+void framepacer::wait_until(clock_type::time_point deadline, bool precise)
+{
+    if (!precise) {
+        std::this_thread::sleep_until(deadline);
+    } else {
+        const auto wake = deadline - margin;
+        if (clock_type::now() < wake) {
+            sleep_until(wake);
+            // adapt the margin to how late the sleep returned
+            const double over = double(std::chrono::duration_cast<nanoseconds>(clock_type::now() - wake).count());
+            oversleep = std::max(over, oversleep * 0.98);
+            margin = std::clamp(nanoseconds(int64_t(oversleep * 1.25)), MARGIN_MIN, MARGIN_MAX);
+        }
+        // yield rather than busy-wait, so that on a single core the mixer and render threads
+        // still get the CPU
+        while (clock_type::now() < deadline)
+            std::this_thread::yield();
+    }
+
+    const int64_t error = std::chrono::duration_cast<nanoseconds>(clock_type::now() - deadline).count();
+    waits++;
+    error_sum += double(error);
+    error_max  = std::max(error_max, error);
+    late      += (error > 1000000);
+}
+
+void framepacer::report(std::ostream& out)
+{
+    char line[160];
+    if (waits == 0) {
+        out << "Pacing: no waits (vsync, or running behind)\n";
+    } else {
+        snprintf(line, sizeof(line), "Pacing: %ld waits, error mean %.0fus max %.0fus, %ld over 1ms late, spin margin %.0fus\n",
+                 waits, error_sum / waits / 1000.0, error_max / 1000.0, late, margin.count() / 1000.0);
+        out << line;
+    }
+    waits = late = 0;
+    error_sum = 0.0;
+    error_max = 0;
+}
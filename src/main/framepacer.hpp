@@ -0,0 +1,30 @@
+/***************************************************************************
+    Frame Pacing.
+
+    Waits for the next frame when vsync isn't pacing the loop. The OS sleep
+    alone wakes anything up to a few milliseconds late (1-15ms on Windows,
+    depending on the timer resolution), which shows as uneven frame times,
+    so the wait sleeps on an absolute high-resolution timer to just short of
+    the deadline and spins the rest. The margin left for the spin follows
+    how late recent sleeps woke.
+
+    The error of each wait (how late it returned) is kept for the console
+    report alongside the frame stage timings (video.trace).
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <iosfwd>
+
+namespace framepacer
+{
+    // Return at deadline. With precise off, just sleeps until it, as the loop used to.
+    void wait_until(std::chrono::steady_clock::time_point deadline, bool precise = true);
+
+    // Pacing error since the last report: mean and worst lateness, and waits over 1ms late
+    void report(std::ostream& out);
+}
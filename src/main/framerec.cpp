@@ -0,0 +1,246 @@
+/***************************************************************************
+    Gameplay Recording.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "framerec.hpp"
+#include "globals.hpp"
+#include "threadpolicy.hpp"
+#include "frontend/config.hpp"
+
+static const uint32_t SLOTS         = 8;  // frames the writer may fall behind by
+static const size_t   PALETTE_BYTES = S16_PALETTE_ENTRIES * 2;
+
+struct Slot
+{
+    uint32_t              frame;
+    int                   width, height, fps;
+    std::vector<uint16_t> pixels;
+    uint8_t               palette[PALETTE_BYTES];
+};
+
+// Single producer (capture, on the game thread), single consumer (the writer). A slot is the
+// writer's from when head passes it until tail does.
+static Slot                  slots[SLOTS];
+static std::atomic<uint32_t> head{0};
+static std::atomic<uint32_t> tail{0};
+static std::atomic<uint32_t> posted{0};     // bumped to wake the writer
+static std::atomic<bool>     stopping{false};
+static bool                  active = false;
+static std::thread           writer;
+static std::ofstream         file;
+static std::string           file_path;
+static uint32_t              frame_no = 0;
+static uint32_t              dropped  = 0;
+
+// The writer's copy of the last frame written
+static std::vector<uint16_t> prev_pixels;
+static int                   prev_width = 0, prev_height = 0;
+static uint8_t               prev_palette[PALETTE_BYTES];
+static bool                  first = true;
+static uint64_t              bytes_in = 0, bytes_out = 0;
+
+static void put_varint(std::vector<uint8_t>& out, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(uint8_t(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+static void put_word(std::vector<uint8_t>& out, uint16_t v)
+{
+    out.push_back(uint8_t(v));
+    out.push_back(uint8_t(v >> 8));
+}
+
+// See the file layout in framerec.hpp. Unchanged pixels and flat spans (sky, road, the HUD)
+// take a few bytes; what moves is kept as it is.
+static void encode(const uint16_t* cur, const uint16_t* prev, size_t count, std::vector<uint8_t>& out)
+{
+    size_t i = 0;
+    while (i < count)
+    {
+        size_t n = 0;
+        while (i + n < count && cur[i + n] == prev[i + n]) n++;
+        if (n >= 2)
+        {
+            put_varint(out, uint32_t(n << 2) | framerec::SKIP);
+            i += n;
+            continue;
+        }
+
+        n = 1;
+        while (i + n < count && cur[i + n] == cur[i]) n++;
+        if (n >= 3)
+        {
+            put_varint(out, uint32_t(n << 2) | framerec::RUN);
+            put_word(out, cur[i]);
+            i += n;
+            continue;
+        }
+
+        // literals, up to where a skip or run would start
+        size_t end = i + 1;
+        while (end < count &&
+               !(end + 1 < count && cur[end] == prev[end] && cur[end + 1] == prev[end + 1]) &&
+               !(end + 2 < count && cur[end] == cur[end + 1] && cur[end] == cur[end + 2]))
+            end++;
+        put_varint(out, uint32_t((end - i) << 2) | framerec::LITERAL);
+        for (; i < end; i++)
+            put_word(out, cur[i]);
+    }
+}
+
+static void write_frame(const Slot& s, std::vector<uint8_t>& pixel_ops)
+{
+    const size_t count = size_t(s.width) * s.height;
+    if (s.width != prev_width || s.height != prev_height)
+    {
+        prev_pixels.assign(count, 0);
+        prev_width  = s.width;
+        prev_height = s.height;
+    }
+
+    framerec::FrameHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.frame  = s.frame;
+    header.width  = uint16_t(s.width);
+    header.height = uint16_t(s.height);
+    header.fps    = uint32_t(s.fps);
+    for (int b = 0; b < framerec::PALETTE_BLOCKS; b++)
+    {
+        const size_t at = size_t(b) * framerec::PALETTE_BLOCK_BYTES;
+        if (first || std::memcmp(s.palette + at, prev_palette + at, framerec::PALETTE_BLOCK_BYTES) != 0)
+            header.palette_blocks |= uint64_t(1) << b;
+    }
+
+    pixel_ops.clear();
+    encode(s.pixels.data(), prev_pixels.data(), count, pixel_ops);
+    header.pixel_bytes = uint32_t(pixel_ops.size());
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (int b = 0; b < framerec::PALETTE_BLOCKS; b++)
+        if (header.palette_blocks & (uint64_t(1) << b))
+            file.write(reinterpret_cast<const char*>(s.palette) + size_t(b) * framerec::PALETTE_BLOCK_BYTES,
+                       framerec::PALETTE_BLOCK_BYTES);
+    file.write(reinterpret_cast<const char*>(pixel_ops.data()), std::streamsize(pixel_ops.size()));
+
+    std::memcpy(prev_pixels.data(), s.pixels.data(), count * sizeof(uint16_t));
+    std::memcpy(prev_palette, s.palette, PALETTE_BYTES);
+    first      = false;
+    bytes_in  += count * sizeof(uint16_t);
+    bytes_out += sizeof(header) + pixel_ops.size() +
+                 size_t(std::popcount(header.palette_blocks)) * framerec::PALETTE_BLOCK_BYTES;
+}
+
+static void run()
+{
+    threadpolicy::apply(threads_settings_t::STATS);
+
+    std::vector<uint8_t> pixel_ops;
+    uint32_t seen = 0;
+    for (;;)
+    {
+        const bool last = stopping.load(std::memory_order_acquire);
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        const uint32_t h = head.load(std::memory_order_acquire);
+        for (; t != h; t++)
+        {
+            write_frame(slots[t % SLOTS], pixel_ops);
+            tail.store(t + 1, std::memory_order_release);
+        }
+        if (last)
+            break;
+        posted.wait(seen, std::memory_order_acquire);
+        seen = posted.load(std::memory_order_acquire);
+    }
+}
+
+bool framerec::start(const std::string& path)
+{
+    stop();
+    file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cerr << "framerec: unable to write " << path << std::endl;
+        return false;
+    }
+    const FileHeader header{ MAGIC, VERSION };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    file_path   = path;
+    frame_no    = dropped = 0;
+    bytes_in    = bytes_out = 0;
+    first       = true;
+    prev_width  = prev_height = 0;
+    head.store(0);
+    tail.store(0);
+    stopping.store(false);
+    writer = std::thread(run);
+    active = true;
+    std::cout << "framerec: recording to " << path << std::endl;
+    return true;
+}
+
+void framerec::capture(const uint16_t* pixels, int width, int height, int fps, const uint8_t* palette)
+{
+    if (!active)
+        return;
+
+    const uint32_t frame = frame_no++;
+    const uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= SLOTS)
+    {
+        dropped++;
+        return;
+    }
+
+    Slot& s = slots[h % SLOTS];
+    s.frame  = frame;
+    s.width  = width;
+    s.height = height;
+    s.fps    = fps;
+    s.pixels.resize(size_t(width) * height);
+    std::memcpy(s.pixels.data(), pixels, s.pixels.size() * sizeof(uint16_t));
+    std::memcpy(s.palette, palette, PALETTE_BYTES);
+    head.store(h + 1, std::memory_order_release);
+
+    posted.fetch_add(1, std::memory_order_release);
+    posted.notify_one();
+}
+
+bool framerec::recording()
+{
+    return active;
+}
+
+void framerec::stop()
+{
+    if (!active)
+        return;
+    active = false;
+    stopping.store(true, std::memory_order_release);
+    posted.fetch_add(1, std::memory_order_release);
+    posted.notify_one();
+    writer.join();
+
+    file.flush();
+    if (!file)
+        std::cerr << "framerec: unable to write " << file_path << std::endl;
+    file.close();
+    std::cout << "framerec: " << frame_no << " frames (" << dropped << " dropped) to " << file_path << ", "
+              << bytes_out / 1024 << "KB, " << (bytes_out ? double(bytes_in) / double(bytes_out) : 0.0)
+              << ":1" << std::endl;
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+    Gameplay Recording.
+
+    Records the game as the S16 hardware draws it: each frame's palette
+    indexed pixels, and the palette RAM they index. Footage taken this way
+    costs the game a copy of the frame a frame, rather than a read back of
+    the GPU's output, so it can run on a Pi during play.
+
+    The copy goes into a ring of frame slots, emptied by a background
+    thread which compresses each frame against the one before it and
+    writes it out. Should the writer fall behind, frames are dropped rather
+    than held up, and the gap is kept in the frame numbers.
+
+    cannonball-recrender (src/tools) turns a recording into RGB frames,
+    for ffmpeg or similar to encode.
+
+    See -capture.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace framerec
+{
+    // ------------------------------------------------------------------------------------------
+    // File layout: a FileHeader, then for each frame recorded a FrameHeader, the palette blocks
+    // changed since the frame before (PALETTE_BLOCK_BYTES each, in block order), then the pixels
+    // as pixel_bytes of operations against the frame before (all zero for the first frame, and
+    // for a frame of another size):
+    //
+    //   varint (n << 2) | SKIP     n pixels as the frame before
+    //   varint (n << 2) | RUN      n pixels of the 16-bit value that follows
+    //   varint (n << 2) | LITERAL  n 16-bit values follow
+    //
+    // varints are 7 bits a byte, low first; values are little endian.
+    // ------------------------------------------------------------------------------------------
+
+    const uint32_t MAGIC               = 0x52464243; // "CBFR"
+    const uint32_t VERSION             = 1;
+    const int      PALETTE_BLOCKS      = 64;
+    const int      PALETTE_BLOCK_BYTES = 128;        // of the 8KB palette RAM
+    enum { SKIP = 0, RUN = 1, LITERAL = 2 };
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+    };
+
+    struct FrameHeader
+    {
+        uint32_t frame;             // number since recording began; a gap is frames dropped
+        uint16_t width, height;
+        uint32_t fps;               // frames a second the game was running at
+        uint64_t palette_blocks;    // bit per palette block that follows
+        uint32_t pixel_bytes;
+        uint32_t unused;
+    };
+
+    // Start recording to path. False, with a message, if it can't be written.
+    bool start(const std::string& path);
+
+    // Once a frame, as it's completed: copy it for the writer (game thread)
+    void capture(const uint16_t* pixels, int width, int height, int fps, const uint8_t* palette);
+
+    bool recording();
+
+    // Write out the frames still queued, and close the file
+    void stop();
+}
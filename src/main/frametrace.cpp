@@ -0,0 +1,279 @@
+/***************************************************************************
+    Frame Timing Trace.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "frametrace.hpp"
+
+static const char* POINT_NAMES[frametrace::POINTS] = {
+    "tick", "jump_table", "road_tick",
+    "prepare_begin", "road_bg", "tiles_bg", "tiles_fg", "road_fg", "sprites", "text",
+    "blargg", "upload", "draw", "present", "audio_mix", "frame", "render", "latency",
+    "repeat"
+};
+
+// Four buckets per power of two of the counter difference, so a percentile is within 12%
+using frametrace::BUCKETS;
+
+struct Histogram
+{
+    std::atomic<uint32_t> count[BUCKETS];   // this window
+    std::atomic<uint64_t> total[BUCKETS];   // since start-up, for window()
+    std::atomic<uint64_t> sum;              // since start-up, as are samples
+    std::atomic<uint64_t> samples;
+    std::atomic<uint64_t> last;
+};
+static Histogram histograms[frametrace::POINTS];
+
+// sum and samples at the last report
+static uint64_t reported_sum[frametrace::POINTS];
+static uint64_t reported_samples[frametrace::POINTS];
+
+// Event ring. Writers claim a slot with one atomic increment; a slot may be overwritten whilst
+// dump() reads it, which at worst garbles that one event.
+struct Event
+{
+    uint64_t start, end;
+    uint16_t point, thread;
+};
+static std::vector<Event>    events;
+static uint64_t              event_mask = 0;
+static std::atomic<uint64_t> event_head{0};
+static std::atomic<bool>     recording{false};
+static std::atomic<bool>     dump_requested{false};
+
+// Threads, numbered as they first record an event
+static const int MAX_THREADS = 64;
+static std::atomic<int>         threads_seen{0};
+static std::atomic<const char*> thread_names[MAX_THREADS];
+static thread_local int         thread_index = -1;
+
+static int this_thread()
+{
+    if (thread_index < 0)
+        thread_index = std::min(threads_seen.fetch_add(1, std::memory_order_relaxed), MAX_THREADS - 1);
+    return thread_index;
+}
+
+// Counter rate, measured against steady_clock from start-up where the CPU doesn't report it
+static const uint64_t start_ticks = frametrace::now();
+static const auto     start_time  = std::chrono::steady_clock::now();
+
+static int bucket(uint64_t ticks)
+{
+    if (ticks < 4) return int(ticks);
+    const int octave = 63 - std::countl_zero(ticks);
+    return octave * 4 + int((ticks >> (octave - 2)) & 3);
+}
+
+// Middle of the range of counter differences held by bucket b
+static double bucket_ticks(int b)
+{
+    if (b < 4) return double(b);
+    const int octave = b / 4;
+    return double((4 + (b & 3)) * 2 + 1) * double(uint64_t(1) << (octave - 2)) / 2.0;
+}
+
+static double ticks_per_ms()
+{
+#if defined(__aarch64__)
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return double(freq) / 1000.0;
+#elif defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    return ms > 0.0 ? double(frametrace::now() - start_ticks) / ms : 1.0;
+#else
+    return 1e6; // steady_clock nanoseconds
+#endif
+}
+
+uint64_t frametrace::record(int point, uint64_t start)
+{
+    const uint64_t end   = now();
+    const uint64_t ticks = end - start;
+    Histogram& h = histograms[point];
+    const int b = bucket(ticks);
+    h.count[b].fetch_add(1, std::memory_order_relaxed);
+    h.total[b].fetch_add(1, std::memory_order_relaxed);
+    h.sum.fetch_add(ticks, std::memory_order_relaxed);
+    h.samples.fetch_add(1, std::memory_order_relaxed);
+    h.last.store(ticks, std::memory_order_relaxed);
+
+    if (recording.load(std::memory_order_relaxed)) {
+        Event& e = events[event_head.fetch_add(1, std::memory_order_relaxed) & event_mask];
+        e = { start, end, uint16_t(point), uint16_t(this_thread()) };
+    }
+    return end;
+}
+
+double frametrace::last_ms(int point)
+{
+    return double(histograms[point].last.load(std::memory_order_relaxed)) / ticks_per_ms();
+}
+
+double frametrace::total_ms(int point, uint64_t* samples)
+{
+    *samples = histograms[point].samples.load(std::memory_order_relaxed);
+    return double(histograms[point].sum.load(std::memory_order_relaxed)) / ticks_per_ms();
+}
+
+// p50 and p99 of samples spread over counts, in counter ticks
+template <typename T>
+static void percentiles(const T* counts, uint64_t samples, double* p50, double* p99)
+{
+    *p50 = *p99 = 0.0;
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        if (!counts[b]) continue;
+        if (seen < (samples + 1) / 2 && seen + counts[b] >= (samples + 1) / 2)
+            *p50 = bucket_ticks(b);
+        seen += counts[b];
+        if (seen * 100 >= samples * 99) {
+            *p99 = bucket_ticks(b);
+            break;
+        }
+    }
+}
+
+uint64_t frametrace::window(int point, Window& w, double* p50_ms, double* p99_ms)
+{
+    uint64_t counts[BUCKETS];
+    uint64_t samples = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        const uint64_t total = histograms[point].total[b].load(std::memory_order_relaxed);
+        counts[b]   = total - w.counts[b];
+        w.counts[b] = total;
+        samples    += counts[b];
+    }
+    double p50, p99;
+    percentiles(counts, samples, &p50, &p99);
+    const double rate = ticks_per_ms();
+    *p50_ms = p50 / rate;
+    *p99_ms = p99 / rate;
+    return samples;
+}
+
+const char* frametrace::name(int point)
+{
+    return POINT_NAMES[point];
+}
+
+double frametrace::to_ms(uint64_t ticks)
+{
+    return double(ticks) / ticks_per_ms();
+}
+
+void frametrace::report(std::ostream& out)
+{
+    const double rate = ticks_per_ms();
+    char line[128];
+    snprintf(line, sizeof(line), "%-14s %9s %9s %9s %9s\n", "Frame trace", "mean ms", "p50 ms", "p99 ms", "samples");
+    out << line;
+
+    for (int point = 0; point < POINTS; point++) {
+        // take the window's samples, leaving the histogram empty for the next. A sample recorded
+        // whilst this runs may land in either window.
+        Histogram& h = histograms[point];
+        uint32_t counts[BUCKETS];
+        uint64_t samples = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            counts[b] = h.count[b].exchange(0, std::memory_order_relaxed);
+            samples  += counts[b];
+        }
+        const uint64_t total = h.sum.load(std::memory_order_relaxed);
+        const uint64_t sum   = total - reported_sum[point];
+        reported_sum[point]  = total;
+        const uint64_t total_samples = h.samples.load(std::memory_order_relaxed);
+        const uint64_t sum_samples   = total_samples - reported_samples[point];
+        reported_samples[point]      = total_samples;
+        if (samples == 0 || sum_samples == 0) continue;
+
+        double p50, p99;
+        percentiles(counts, samples, &p50, &p99);
+        snprintf(line, sizeof(line), "%-14s %9.3f %9.3f %9.3f %9llu\n", POINT_NAMES[point],
+                 double(sum) / sum_samples / rate, p50 / rate, p99 / rate, (unsigned long long) samples);
+        out << line;
+    }
+}
+
+void frametrace::start_events(int n)
+{
+    if (n <= 0 || !events.empty()) return;
+    const uint64_t size = std::bit_ceil(uint64_t(n));
+    events.resize(size);
+    event_mask = size - 1;
+    recording.store(true, std::memory_order_relaxed);
+}
+
+void frametrace::name_thread(const char* name)
+{
+    thread_names[this_thread()].store(name, std::memory_order_relaxed);
+}
+
+void frametrace::request_dump()
+{
+    dump_requested.store(true, std::memory_order_relaxed);
+}
+
+void frametrace::check_dump(const std::string& path)
+{
+    if (!dump_requested.exchange(false, std::memory_order_relaxed)) return;
+    if (events.empty()) {
+        std::cerr << "Frame trace: no events kept; set video.trace_events in config.xml" << std::endl;
+        return;
+    }
+
+    // pause recording whilst the ring is read, letting events being written finish
+    recording.store(false, std::memory_order_relaxed);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    const uint64_t head  = event_head.load(std::memory_order_relaxed);
+    const uint64_t count = std::min<uint64_t>(head, events.size());
+    const double   rate  = ticks_per_ms() / 1000.0;   // ticks per microsecond
+
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Frame trace: unable to write " << path << std::endl;
+        recording.store(true, std::memory_order_relaxed);
+        return;
+    }
+
+    // times are from the earliest event kept
+    uint64_t base = UINT64_MAX;
+    for (uint64_t i = head - count; i < head; i++)
+        base = std::min(base, events[i & event_mask].start);
+
+    char line[160];
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    const int threads = std::min(threads_seen.load(std::memory_order_relaxed), MAX_THREADS);
+    for (int t = 0; t < threads; t++) {
+        const char* name = thread_names[t].load(std::memory_order_relaxed);
+        snprintf(line, sizeof(line),
+                 "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s%s\"}},\n",
+                 t, name ? name : "thread", name ? "" : std::to_string(t).c_str());
+        out << line;
+    }
+    for (uint64_t i = head - count; i < head; i++) {
+        const Event& e = events[i & event_mask];
+        if (e.point >= POINTS || e.end < e.start || e.start < base) continue;
+        snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n",
+                 POINT_NAMES[e.point], unsigned(e.thread), double(e.start - base) / rate, double(e.end - e.start) / rate);
+        out << line;
+    }
+    // closing metadata event, so the list needs no trailing comma handling
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"cannonball\"}}\n]}\n";
+    out.close();
+
+    recording.store(true, std::memory_order_relaxed);
+    std::cout << "\nFrame trace: " << count << " events written to " << path << std::endl;
+}
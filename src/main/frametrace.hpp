@@ -0,0 +1,118 @@
+/***************************************************************************
+    Frame Timing Trace.
+
+    Always-on timing of the stages of a frame: game logic, each hardware
+    layer, the Blargg filter bands, the GPU upload, draw and present, and
+    the audio mix. Each timed section adds one sample to a histogram for its
+    point, using the CPU's own counter (TSC on x86, CNTVCT on ARM64) so that
+    the cost is a couple of counter reads and an atomic increment.
+
+    report() gives the mean, p50 and p99 of each point since the last report,
+    and starts a new window, so the figures follow what the engine is doing
+    now. See video.trace in config.xml.
+
+    Optionally, each section is also kept as an event, with the thread it ran
+    on, in a ring of the most recent events. dump() writes the ring as Chrome
+    Trace Event JSON, to show the frame pipeline in chrome://tracing or
+    Perfetto. See video.trace_events in config.xml.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <ostream>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+  #ifdef _MSC_VER
+    #include <intrin.h>
+  #else
+    #include <x86intrin.h>
+  #endif
+#endif
+
+namespace frametrace
+{
+    enum
+    {
+        TICK,           // main.cpp tick(): input and game logic
+        JUMP_TABLE,     // Outrun::jump_table()
+        ROAD_TICK,      // ORoad::tick()
+        PREPARE,        // Video::prepare_stage(), one point per stage (Video::PREPARE_STAGES)
+        BLARGG = PREPARE + 7,   // RenderSurface::blargg_filter(), per band
+        UPLOAD,         // RenderSurface::finalize_frame(): frame to the GPU
+        DRAW,           // RenderSurface::finalize_frame(): shader and overlay passes
+        PRESENT,        // RenderSurface::finalize_frame(): buffer swap
+        AUDIO_MIX,      // Audio::fill_and_mix()
+        FRAME,          // main_loop(): time between frames shown
+        RENDER,         // Video::render_frame(), per band
+        LATENCY,        // main.cpp: controls read by tick() to that frame presented
+        REPEAT,         // RenderSurface::repeat_frame(): a refresh between frames (high refresh displays)
+        POINTS
+    };
+
+    // Counter value; only differences are meaningful
+    inline uint64_t now()
+    {
+    #if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        return __rdtsc();
+    #elif defined(__aarch64__)
+        uint64_t t;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(t));
+        return t;
+    #else
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count());
+    #endif
+    }
+
+    // Add the time since start to point's histogram. Returns now(), to start the next section.
+    uint64_t record(int point, uint64_t start);
+
+    // Times the enclosing scope
+    struct Scope
+    {
+        explicit Scope(int point) : point(point), start(now()) {}
+        ~Scope() { record(point, start); }
+        int point;
+        uint64_t start;
+    };
+
+    // Write a line per point with samples since the last report, then start a new window
+    void report(std::ostream& out);
+
+    // For the performance HUD: the last sample of point, and the total time and count of its
+    // samples since start-up (the HUD takes its own windows from these), in milliseconds
+    double last_ms(int point);
+    double total_ms(int point, uint64_t* samples);
+
+    // A difference of now() values, in milliseconds
+    double to_ms(uint64_t ticks);
+
+    // A reader's own window on a point's samples, apart from report()'s: each call of window()
+    // gives the p50 and p99 (ms) of the samples since the last with the same Window, and returns
+    // how many there were
+    const int BUCKETS = 64 * 4;
+    struct Window { uint64_t counts[BUCKETS] = {}; };
+    uint64_t window(int point, Window& w, double* p50_ms, double* p99_ms);
+
+    // Short name of a point, as in the report
+    const char* name(int point);
+
+    // Start keeping the most recent events (rounded up to a power of two; 0 = none). Call once,
+    // before the other threads start.
+    void start_events(int events);
+
+    // Name the calling thread in the event trace
+    void name_thread(const char* name);
+
+    // Ask for a dump at the next check_dump(). Safe to call from a signal handler.
+    void request_dump();
+
+    // Write the event ring to path as Chrome Trace Event JSON if a dump was asked for
+    void check_dump(const std::string& path);
+}
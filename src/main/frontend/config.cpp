@@ -22,6 +22,7 @@
 #include <filesystem>
 #include <regex>
 #include <map>
+#include <mutex>
 #include <algorithm>
 #include <cctype>
 #include <string>
@@ -30,6 +31,9 @@
 #include "main.hpp"
 #include "config.hpp"
 #include "globals.hpp"
+#include "ghost.hpp"
+#include "journal.hpp"
+#include "persist.hpp"
 #include "../utils.hpp"
 
 #include "engine/ohiscore.hpp"
@@ -186,6 +190,12 @@ void Config::load()
     data.res_path         = cfg.get_string("data.respath", "res/");   // Path to resources
     data.save_path        = cfg.get_string("data.savepath", "./");    // Path to Save Data
     data.crc32            = cfg.get_int   ("data.crc32", 1);
+    data.binary_saves     = cfg.get_int   ("data.binary_saves", 1);
+    data.stats_cache      = cfg.get_string("data.stats_cache", "");
+    data.stats_flush      = cfg.get_int   ("data.stats_flush", 15);
+    data.lean_memory      = cfg.get_int   ("data.lean_memory", 0);
+    data.shared_gfx       = cfg.get_int   ("data.shared_gfx", 0);
+    data.telemetry        = cfg.get_string("data.telemetry", "");
 
     data.file_scores      = data.save_path + "hiscores.xml";
     data.file_scores_jap  = data.save_path + "hiscores_jap.xml";
@@ -201,6 +211,7 @@ void Config::load()
 
     menu.enabled           = cfg.get_int("menu.enabled",   0);
     menu.road_scroll_speed = cfg.get_int("menu.roadspeed", 50);
+    menu.fast_boot         = cfg.get_int("menu.fast_boot", 0);
 
     // ------------------------------------------------------------------------
     // Video Settings
@@ -214,6 +225,42 @@ void Config::load()
     video.hires_next    =
     video.hires         = cfg.get_int("video.hires",           1); // Hi-Resolution Mode
     video.hiresprites   = cfg.get_int("video.hiresprites",     0); // enable hires sprites with hires mode
+    video.fused_layers  = cfg.get_int("video.fused_layers",    1); // draw sky fill with background tiles in one pass
+    video.strip_lines   = cfg.get_int("video.strip_lines",     0); // draw all layers a strip of lines at a time (0 = layer by layer)
+    video.prepare_bands = cfg.get_int("video.prepare_bands",   0); // draw bands of the frame in parallel (0 = one pass)
+    video.low_latency   = cfg.get_int("video.low_latency",     0); // draw, filter and show each frame in the same refresh
+    video.overlap_logic = cfg.get_int("video.overlap_logic",   0); // tick the next frame whilst this one's layers are drawn
+    video.present_thread= cfg.get_int("video.present_thread",  0); // present frames from the main thread, game on its own
+    video.gpu_ntsc      = cfg.get_int("video.gpu_ntsc",        0); // NTSC filter as a GPU shader pass
+    video.gpu_palette   = cfg.get_int("video.gpu_palette",     0); // palette lookup as a GPU shader pass
+    video.blargg_tables = cfg.get_int("video.blargg_tables",   3); // Blargg filter tables cached
+    video.overlay_cache = cfg.get_int("video.overlay_cache",   1); // CRT overlay mask saved for next start
+    video.overlay_gpu   = cfg.get_int("video.overlay_gpu",     1); // CRT overlay mask drawn by the shader
+    video.shader_cache  = cfg.get_int("video.shader_cache",    1); // linked shaders saved for next start
+    video.shader_scale  = cfg.get_int("video.shader_scale",  100); // CRT shader resolution (% of output)
+    video.crt_bloom     = cfg.get_int("video.crt_bloom",       0); // bloom between CPU scanlines
+    video.gpu_scanlines = cfg.get_int("video.gpu_scanlines",   0); // scanlines in the shader
+    video.row_reuse     = cfg.get_int("video.row_reuse",       1); // reuse unchanged filtered rows
+    video.blargg_16bit  = cfg.get_int("video.blargg_16bit",    0); // 16-bit Blargg output
+    video.static_frames = cfg.get_int("video.static_frames",   0); // hold frames unchanged from the last
+    video.huge_pages    = cfg.get_int("video.huge_pages",      1); // huge pages for the frame buffers
+    video.trace         = cfg.get_int("video.trace",           0); // frame stage timing report
+    video.trace_events  = cfg.get_int("video.trace_events",    0); // timeline events kept for a dump
+    video.slow_frame    = cfg.get_int("video.slow_frame",      0); // slow frame flight recorder margin (%)
+    video.pacing        = cfg.get_int("video.pacing",          1); // precise frame pacing without vsync
+    video.vrr           = cfg.get_int("video.vrr",             0); // variable refresh rate display
+    video.vrr_rate      = cfg.get_int("video.vrr_rate",        0); // VRR pacing rate (Hz x 100, 0 = game rate)
+    video.high_refresh  = cfg.get_int("video.high_refresh",    0); // 120Hz+ displays: frames shown again in between
+    video.fps_remember  = cfg.get_int("video.fps_remember",    1); // auto 30/60fps kept per stage across plays
+    video.fps_stages    = cfg.get_int("video.fps_stages",      0); // stages learned to need 30fps
+    video.quality_governor = cfg.get_int("video.quality_governor", 1); // effects turned down before 30fps
+    video.attract_idle  = cfg.get_int("video.attract_idle",    0); // idle attract mode to 30fps (seconds)
+    video.attract_temp  = cfg.get_int("video.attract_temp",   70); // idle attract mode effects off (degrees C)
+    video.sprite_list   = cfg.get_int("video.sprite_list",     1); // sprites decoded once per frame
+    video.interpolate   = cfg.get_int("video.interpolate",     1); // 60fps frames between 30fps ticks interpolated
+    video.driver        = cfg.get_string("video.driver",       ""); // SDL video driver (kmsdrm = no desktop needed)
+    video.renderer      = cfg.get_int("video.renderer",        0); // 0 = GLES, 1 = framebuffer
+    video.fb_device     = cfg.get_string("video.fb_device",    "/dev/fb0");
     video.vsync         = cfg.get_int("video.vsync",           1); // Use V-Sync where available (e.g. Open GL)
     video.x_offset      = cfg.get_int("video.x_offset",        0); // Offset from calculated image X position
     video.y_offset      = cfg.get_int("video.y_offset",        0); // Offset from calculated image Y position
@@ -246,12 +293,19 @@ void Config::load()
     // ------------------------------------------------------------------------
     sound.enabled     = cfg.get_int("sound.enable",      1);
     sound.rate        = cfg.get_int("sound.rate",        44100);
+    sound.chip_rate   = cfg.get_int("sound.chip_rate",   0);
     sound.advertise   = cfg.get_int("sound.advertise",   1);
     sound.preview     = cfg.get_int("sound.preview",     1);
     sound.fix_samples = cfg.get_int("sound.fix_samples", 1);
     sound.music_timer = cfg.get_int("sound.music_timer", 0);
     // JJP - allow either standard 8ms audio callbacks, or a slower 16ms rate (required with WSL2)
     sound.callback_rate   = cfg.get_int("sound.callback_rate",0);
+    // Target for the audio mixed ahead of playback (ms); Audio increases it if underruns occur
+    sound.latency         = cfg.get_int("sound.latency", 32);
+    // Or mix in the SDL callback itself, with nothing mixed ahead
+    sound.direct          = cfg.get_int("sound.direct", 0);
+    // Glide the engine sound between logic ticks
+    sound.smooth_engine   = cfg.get_int("sound.smooth_engine", 1);
     // Index of SDL playback device to request, -1 for default
     sound.playback_device = cfg.get_int("sound.playback_device", -1);
 
@@ -270,12 +324,28 @@ void Config::load()
     // JJP - Wave file playback volume, 1-8 where 4 = no adjustment
     sound.wave_volume = cfg.get_int("sound.wave_volume",4);
 
+    // Keep decoded copies of custom .mp3 tracks, so they play without decoding in-game
+    sound.music_cache = cfg.get_int("sound.music_cache",0);
+
     // ------------------------------------------------------------------------
     // SMARTYPI Settings
     // ------------------------------------------------------------------------
     smartypi.enabled = cfg.get_int("smartypi.<xmlattr>.enabled",        0);
     smartypi.ouputs  = cfg.get_int("smartypi.outputs",                  1);
     smartypi.cabinet = cfg.get_int("smartypi.cabinet",                  1);
+    smartypi.link    = cfg.get_string("smartypi.link",                  "");
+    smartypi.motor_hz = cfg.get_int("smartypi.motor_hz",                0);
+
+    // ------------------------------------------------------------------------
+    // Thread Scheduling
+    // ------------------------------------------------------------------------
+    static const char* thread_roles[threads_settings_t::ROLES] = { "mixer", "render", "game", "stats" };
+    threads.rr = cfg.get_int("threads.rr", 0);
+    for (int role = 0; role < threads_settings_t::ROLES; role++) {
+        const std::string key = std::string("threads.") + thread_roles[role];
+        threads.priority[role] = cfg.get_int(key + ".priority", 0);
+        threads.cores[role]    = cfg.get_int(key + ".cores",    0);
+    }
 
     // ------------------------------------------------------------------------
     // Controls
@@ -321,6 +391,8 @@ void Config::load()
     controls.invert[2]     = cfg.get_int("controls.analog.axis.brake.<xmlattr>.invert", 0);
     controls.asettings[0]  = cfg.get_int("controls.analog.wheel.zone",  75);
     controls.asettings[1]  = cfg.get_int("controls.analog.wheel.dead",  0);
+    controls.latch_ms      = cfg.get_int("controls.latch_ms",           0);
+    controls.evdev         = cfg.get_string("controls.evdev",           "");
 
     controls.haptic        = cfg.get_int("controls.analog.haptic.<xmlattr>.enabled",    1);
     controls.max_force     = cfg.get_int("controls.analog.haptic.max_force",            9000);
@@ -358,6 +430,7 @@ void Config::load()
     engine.bumper          = cfg.get_int("engine.bumper",        0);
     engine.turbo           = cfg.get_int("engine.turbo",         0);
     engine.car_pal         = cfg.get_int("engine.car_color",     0);
+    engine.replay_mb       = cfg.get_int("engine.replay_mb",     16);
 
     if (!engine.hiscore_timer)
         engine.hiscore_timer = HIGHSCORE_TIMER;
@@ -374,6 +447,8 @@ void Config::load()
 
     ttrial.laps    = cfg.get_int("time_trial.laps",    5);
     ttrial.traffic = cfg.get_int("time_trial.traffic", 3);
+    ttrial.quick_restart = cfg.get_int("time_trial.quick_restart", 1);
+    ttrial.ghost   = cfg.get_int("time_trial.ghost",   1);
     cont_traffic   = cfg.get_int("continuous.traffic", 3);
 
     if (!file_found) {
@@ -398,6 +473,36 @@ bool Config::save()
     cfg.put_int("video.vsync",              video.vsync);         // V-Sync (1)
     cfg.put_int("video.hires",              video.hires);         // Game engine hires mode (1=enabled)
     cfg.put_int("video.hiresprites",        video.hiresprites);   // hi-res sprites (1=enabled)
+    cfg.put_int("video.fused_layers",       video.fused_layers);  // fused sky/background tile pass (1=enabled)
+    cfg.put_int("video.strip_lines",        video.strip_lines);   // lines per strip when compositing by strip (0=off)
+    cfg.put_int("video.prepare_bands",      video.prepare_bands); // bands drawn in parallel (0=off)
+    cfg.put_int("video.low_latency",        video.low_latency);   // sliced same-refresh presentation (1=enabled)
+    cfg.put_int("video.overlap_logic",      video.overlap_logic); // logic alongside the layer stages (1=enabled)
+    cfg.put_int("video.present_thread",     video.present_thread);// decoupled presentation thread (1=enabled)
+    cfg.put_int("video.gpu_ntsc",           video.gpu_ntsc);      // NTSC filter on the GPU (1=enabled)
+    cfg.put_int("video.gpu_palette",        video.gpu_palette);   // palette lookup on the GPU (1=enabled)
+    cfg.put_int("video.blargg_tables",      video.blargg_tables); // Blargg filter tables cached (3)
+    cfg.put_int("video.overlay_cache",      video.overlay_cache); // CRT overlay mask disk cache (1=enabled)
+    cfg.put_int("video.overlay_gpu",        video.overlay_gpu);   // CRT overlay mask in the shader (1=enabled)
+    cfg.put_int("video.shader_cache",       video.shader_cache);  // shader program disk cache (1=enabled)
+    cfg.put_int("video.shader_scale",       video.shader_scale);  // CRT shader resolution (100=native)
+    cfg.put_int("video.crt_bloom",          video.crt_bloom);     // bloom between scanlines (1=enabled)
+    cfg.put_int("video.gpu_scanlines",      video.gpu_scanlines); // scanlines in the shader (1=enabled)
+    cfg.put_int("video.row_reuse",          video.row_reuse);     // reuse unchanged Blargg rows (1=enabled)
+    cfg.put_int("video.blargg_16bit",       video.blargg_16bit);  // 16-bit Blargg output (1=enabled)
+    cfg.put_int("video.static_frames",      video.static_frames); // hold unchanged frames (1=enabled)
+    cfg.put_int("video.huge_pages",         video.huge_pages);    // huge pages for frame buffers (1=enabled)
+    cfg.put_int("video.trace",              video.trace);         // frame stage timing report (0=off)
+    cfg.put_int("video.trace_events",       video.trace_events);  // timeline events kept (0=off)
+    cfg.put_int("video.slow_frame",         video.slow_frame);    // slow frame dump margin, % (0=off)
+    cfg.put_int("video.pacing",             video.pacing);        // precise frame pacing (1=enabled)
+    cfg.put_int("video.fps_remember",       video.fps_remember);  // auto 30/60fps remembered per stage (1=enabled)
+    cfg.put_int("video.fps_stages",         video.fps_stages);    // stages learned to need 30fps (mask)
+    cfg.put_int("video.quality_governor",   video.quality_governor); // effects turned down before 30fps (1=enabled)
+    cfg.put_int("video.attract_idle",       video.attract_idle);  // idle attract mode to 30fps (seconds, 0=off)
+    cfg.put_int("video.attract_temp",       video.attract_temp);  // idle attract mode effects off (degrees C)
+    cfg.put_int("video.sprite_list",        video.sprite_list);   // native sprite list (1=enabled)
+    cfg.put_int("video.interpolate",        video.interpolate);   // render interpolation (1=enabled)
     cfg.put_int("video.x_offset",           video.x_offset);      // X offset
     cfg.put_int("video.y_offset",           video.y_offset);      // Y offset
     // JJP Additional configuration for CRT emulation
@@ -429,9 +534,14 @@ bool Config::save()
     cfg.put_int("sound.preview",            sound.preview);
     cfg.put_int("sound.fix_samples",        sound.fix_samples);
     cfg.put_int("sound.rate",               sound.rate);             // audio sampling rate e.g. 44100 (Hz)
+    cfg.put_int("sound.chip_rate",          sound.chip_rate);        // sound chip rate (Hz), 0 = as sound.rate
     cfg.put_int("sound.callback_rate",      sound.callback_rate);    // JJP - 0=8ms callbacks, 1=16ms
+    cfg.put_int("sound.latency",            sound.latency);          // audio mixed ahead, target (ms)
+    cfg.put_int("sound.direct",             sound.direct);           // 1 = mix in the SDL callback, no ring
+    cfg.put_int("sound.smooth_engine",      sound.smooth_engine);    // 1 = engine glides between logic ticks
     cfg.put_int("sound.playback_device",    sound.playback_device);  // JJP - Index of SDL playback device to request, -1 for default  
     cfg.put_int("sound.wave_volume",        sound.wave_volume);      // JJP - volume adjustment to .wav files
+    cfg.put_int("sound.music_cache",        sound.music_cache);      // decoded .mp3 cache, 0=off 1=on
 
     if (config.smartypi.enabled)
         cfg.put_int("smartypi.cabinet",     config.smartypi.cabinet);
@@ -491,9 +601,12 @@ bool Config::save()
     cfg.put_int("engine.bumper",          (int) engine.bumper);
     cfg.put_int("engine.turbo",           (int) engine.turbo);
     cfg.put_int("engine.car_color",       engine.car_pal);
+    cfg.put_int("engine.replay_mb",       engine.replay_mb);
 
     cfg.put_int("time_trial.laps",    ttrial.laps);
     cfg.put_int("time_trial.traffic", ttrial.traffic);
+    cfg.put_int("time_trial.quick_restart", ttrial.quick_restart);
+    cfg.put_int("time_trial.ghost", ttrial.ghost);
     cfg.put_int("continuous.traffic", cont_traffic);
 
     // Sync back from doc (mirrors original behavior)
@@ -502,13 +615,95 @@ bool Config::save()
     cont_traffic   = cfg.get_int("continuous.traffic", 3);
 
     // Write out to the current directory (even if we loaded from res/)
-    if (!xml_parser::write_xml(data.cfg_file, cfg)) {
+    if (!persist::write(data.cfg_file, xml_parser::print_xml(cfg))) {
         std::cerr << "Could not save settings to " << data.cfg_file << std::endl;
         return false;
     }
     return true;
 }
 
+// ------------------------------------------------------------------------------------------------
+// Binary saves (data.binary_saves)
+//
+// A file of fixed size beside each XML one (hiscores.xml -> hiscores.bin): "CBS1", the number of
+// 32-bit words, the words, then a CRC32 of all that, each little endian. Read in preference to the
+// XML unless the XML file has been changed since, in which case it is imported.
+// ------------------------------------------------------------------------------------------------
+
+static const char BINARY_MAGIC[4] = { 'C', 'B', 'S', '1' };
+
+static std::string binary_file(const std::string& xml_file)
+{
+    return std::filesystem::path(xml_file).replace_extension(".bin").string();
+}
+
+// Play stats journal (journal.hpp) on the card, and its copy in data.stats_cache
+static std::string journal_file(const std::string& xml_file)
+{
+    return std::filesystem::path(xml_file).replace_extension(".journal").string();
+}
+
+static std::string cache_file(const std::string& xml_file)
+{
+    return config.data.stats_cache + std::filesystem::path(journal_file(xml_file)).filename().string();
+}
+
+static std::mutex stats_mutex;            // save_stats() runs on the stats thread
+static uint32_t   stats_seq         = 0;  // journal record last written
+static int        stats_unflushed   = 0;  // saves to the cache since the card was written
+static int        stats_card_writes = 0;
+
+// The binary file, unless the XML one is newer
+static bool use_binary(const std::string& bin_file, const std::string& xml_file)
+{
+    std::error_code ec;
+    const auto bin_time = std::filesystem::last_write_time(bin_file, ec);
+    if (ec) return false;
+    const auto xml_time = std::filesystem::last_write_time(xml_file, ec);
+    return ec || xml_time <= bin_time;
+}
+
+static void put_word(std::string& out, uint32_t w)
+{
+    for (int i = 0; i < 4; i++)
+        out += char((w >> (i * 8)) & 0xFF);
+}
+
+static uint32_t get_word(const uint8_t* p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static std::string pack_binary(const std::vector<uint32_t>& words)
+{
+    std::string out(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    put_word(out, uint32_t(words.size()));
+    for (uint32_t w : words)
+        put_word(out, w);
+    put_word(out, Utils::crc32(out.data(), out.size()));
+    return out;
+}
+
+// Exactly count words, or false
+static bool read_binary(const std::string& file, std::vector<uint32_t>& words, size_t count)
+{
+    std::ifstream ifs(file, std::ios::binary);
+    const std::string in((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(in.data());
+    const size_t body = sizeof(BINARY_MAGIC) + 4 + count * 4;
+
+    if (in.size() != body + 4 || in.compare(0, sizeof(BINARY_MAGIC), BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 ||
+        get_word(p + 4) != count || get_word(p + body) != Utils::crc32(p, body)) {
+        std::cerr << "Warning: " << file << " is not valid, reading the XML file instead." << std::endl;
+        return false;
+    }
+
+    words.resize(count);
+    for (size_t i = 0; i < count; i++)
+        words[i] = get_word(p + 8 + i * 4);
+    return true;
+}
+
 void Config::load_scores(bool original_mode)
 {
     std::string scores_file;
@@ -518,6 +713,25 @@ void Config::load_scores(bool original_mode)
     else
         scores_file = engine.jap ? data.file_cont_jap : data.file_cont;
 
+    // Per score: score, initials (one a byte), map tiles, time
+    std::vector<uint32_t> words;
+    const std::string bin_file = binary_file(scores_file);
+    if (data.binary_saves && use_binary(bin_file, scores_file) && read_binary(bin_file, words, ohiscore.NO_SCORES * 4))
+    {
+        for (int i = 0; i < ohiscore.NO_SCORES; i++)
+        {
+            score_entry* e = &ohiscore.scores[i];
+            const uint32_t* w = &words[i * 4];
+            e->score    = w[0];
+            e->initial1 = w[1] & 0xFF;
+            e->initial2 = (w[1] >> 8) & 0xFF;
+            e->initial3 = (w[1] >> 16) & 0xFF;
+            e->maptiles = w[2];
+            e->time     = uint16_t(w[3]);
+        }
+        return;
+    }
+
     xml_parser::ptree scores("scores");
     if (!xml_parser::read_xml(scores_file, scores)) {
         std::cerr << "Warning: " << scores_file << " could not be loaded." << std::endl;
@@ -575,15 +789,58 @@ void Config::save_scores(bool original_mode)
         scores.put_string(xmltag + ".time",     Utils::to_hex_string(e->time));
     }
 
-    if (!xml_parser::write_xml(scores_file, scores)) {
+    // The XML is still written, to be read and edited
+    if (!persist::write(scores_file, xml_parser::print_xml(scores))) {
         std::cerr << "Could not save hiscores to: " << scores_file << std::endl;
     }
+
+    if (data.binary_saves)
+    {
+        std::vector<uint32_t> words;
+        for (int i = 0; i < ohiscore.NO_SCORES; i++)
+        {
+            const score_entry* e = &ohiscore.scores[i];
+            words.push_back(e->score);
+            words.push_back(e->initial1 | (e->initial2 << 8) | (e->initial3 << 16));
+            words.push_back(e->maptiles);
+            words.push_back(e->time);
+        }
+        if (!persist::write(binary_file(scores_file), pack_binary(words)))
+            std::cerr << "Could not save hiscores to: " << binary_file(scores_file) << std::endl;
+    }
 }
 
 void Config::load_stats()
 {
     std::string stats_file = data.file_stats;
 
+    // The latest record of the card's journal and the cache's, unless the XML has been edited since
+    if (data.binary_saves)
+    {
+        const std::lock_guard<std::mutex> lock(stats_mutex);
+        uint32_t words[2], cached[2], seq = 0, cached_seq = 0;
+        std::string from = journal_file(stats_file);
+        bool found = journal::read(from, words, 2, seq);
+        if (!data.stats_cache.empty() && journal::read(cache_file(stats_file), cached, 2, cached_seq) &&
+            (!found || cached_seq > seq))
+        {
+            from     = cache_file(stats_file);
+            words[0] = cached[0];
+            words[1] = cached[1];
+            seq      = cached_seq;
+            found    = true;
+            stats_unflushed = 1;  // the card is behind
+        }
+        stats_seq = seq;
+
+        if (found && use_binary(from, stats_file))
+        {
+            stats.playcount = int(words[0]);
+            stats.runtime   = int(words[1]);
+            return;
+        }
+    }
+
     xml_parser::ptree stats_data("playstats");
     if (!xml_parser::read_xml(stats_file, stats_data)) {
         std::cerr << "Warning: " << stats_file << " could not be loaded." << std::endl;
@@ -601,22 +858,62 @@ void Config::save_stats()
 {
     std::string stats_file = data.file_stats;
 
+    // Saved every minute, so a record in the journal rather than a new file. With a cache, the
+    // card is written every data.stats_flush saves, and the XML every journal::SLOTS card writes.
+    if (data.binary_saves)
+    {
+        const std::lock_guard<std::mutex> lock(stats_mutex);
+        const uint32_t words[2] = { uint32_t(stats.playcount), uint32_t(stats.runtime) };
+        ++stats_seq;
+        if (!data.stats_cache.empty() &&
+            journal::write(cache_file(stats_file), words, 2, stats_seq) &&
+            ++stats_unflushed < std::max(data.stats_flush, 1))
+            return;
+
+        journal::write(journal_file(stats_file), words, 2, stats_seq);
+        stats_unflushed = 0;
+        if (++stats_card_writes % journal::SLOTS != 0)
+            return;
+    }
+
     xml_parser::ptree stats_data("playstats");
 
     stats_data.put_int("playcount", stats.playcount);
     stats_data.put_int("runtime",   stats.runtime);
 
-    if (!xml_parser::write_xml(stats_file, stats_data)) {
+    if (!persist::write(stats_file, xml_parser::print_xml(stats_data))) {
         std::cerr << "Could not save machine stats to: " << stats_file << std::endl;
     }
 }
 
+void Config::flush_stats()
+{
+    const std::lock_guard<std::mutex> lock(stats_mutex);
+    if (!data.binary_saves || !stats_unflushed)
+        return;
+
+    const uint32_t words[2] = { uint32_t(stats.playcount), uint32_t(stats.runtime) };
+    if (journal::write(journal_file(data.file_stats), words, 2, ++stats_seq))
+        stats_unflushed = 0;
+}
+
 void Config::load_timetrial_scores()
 {
     // Counter value that represents 1m 15s 0ms
     static const uint16_t COUNTER_1M_15 = 0x11D0;
 
     std::string timetrial_file = engine.jap ? config.data.file_ttrial_jap : config.data.file_ttrial;
+
+    // Best time per course
+    std::vector<uint32_t> words;
+    const std::string bin_file = binary_file(timetrial_file);
+    if (data.binary_saves && use_binary(bin_file, timetrial_file) && read_binary(bin_file, words, 15))
+    {
+        for (int i = 0; i < 15; i++)
+            ttrial.best_times[i] = uint16_t(words[i]);
+        return;
+    }
+
     xml_parser::ptree timetrial_scores("timetrial_scores");
 
     if (!xml_parser::read_xml(timetrial_file, timetrial_scores)) {
@@ -647,9 +944,16 @@ void Config::save_timetrial_scores()
     }
 
 
-    if (!xml_parser::write_xml(timetrial_file, timetrial_scores)) {
+    if (!persist::write(timetrial_file, xml_parser::print_xml(timetrial_scores))) {
         std::cerr << "Could not save time trial scores to: " << timetrial_file << std::endl;
     }
+
+    if (data.binary_saves)
+    {
+        const std::vector<uint32_t> words(ttrial.best_times, ttrial.best_times + 15);
+        if (!persist::write(binary_file(timetrial_file), pack_binary(words)))
+            std::cerr << "Could not save time trial scores to: " << binary_file(timetrial_file) << std::endl;
+    }
 }
 
 bool Config::clear_scores()
@@ -657,6 +961,9 @@ bool Config::clear_scores()
     // Init Default Hiscores
     ohiscore.init_def_scores();
 
+    // A save still queued would put a file back afterwards
+    persist::flush();
+
     int deleted = 0;          // number of successful deletions
 
     auto try_remove = [&](const std::string& path) {
@@ -669,6 +976,14 @@ bool Config::clear_scores()
     try_remove(data.file_ttrial_jap);
     try_remove(data.file_cont);
     try_remove(data.file_cont_jap);
+    for (const std::string* f : { &data.file_scores, &data.file_scores_jap, &data.file_ttrial,
+                                  &data.file_ttrial_jap, &data.file_cont, &data.file_cont_jap })
+        try_remove(binary_file(*f));
+    for (int i = 0; i < 15; i++)
+    {
+        try_remove(ghost::file(i, false));
+        try_remove(ghost::file(i, true));
+    }
 
     // returns true if at least one file was deleted
     return (deleted > 0);
@@ -683,6 +998,8 @@ void Config::set_fps(int fps)
     // Original game ticks sprites at 30fps but background scroll at 60fps
     tick_fps  = video.fps < 2 ? 30 : 60;
 
+    interpolate = video.interpolate && this->fps == 60 && tick_fps == 30;
+
     cannonball::frame_ms = 1000.0 / this->fps;
 
     /* JJP - Sound initialised in seperate thread so not required here */
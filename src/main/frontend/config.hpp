@@ -24,6 +24,12 @@ struct data_settings_t
     std::string save_path;
     std::string cfg_file;
     int crc32;
+    int binary_saves;                   // Scores and stats also kept in compact binary files (1), read in preference to the XML
+    std::string stats_cache;            // Directory on a RAM disk for the play stats journal, written to the card every
+    int stats_flush;                    // stats_flush minutes ("" = straight to the card)
+    int lean_memory;                    // Free the tile, sprite and road ROMs once converted for the video hardware
+    int shared_gfx;                     // Converted sprite tables in shared memory, built once for every instance (Linux)
+    std::string telemetry;              // File the metrics are written to every 10s, Prometheus format ("" = none)
 
     std::string file_scores;            // Arcade Hi-Scores (World & Japanese)
     std::string file_scores_jap;
@@ -60,6 +66,8 @@ struct ttrial_settings_t
 {
     int laps;
     int traffic;
+    int quick_restart;     // START restarts the race (from a snapshot of its start), MENU leaves
+    int ghost;             // Race a ghost of the course's best lap (ghost.hpp)
     uint16_t best_times[15];
 };
 
@@ -67,6 +75,7 @@ struct menu_settings_t
 {
     int enabled;
     int road_scroll_speed;
+    int fast_boot;          // Start straight in attract mode, without the settling delay
 };
 
 struct video_settings_t
@@ -80,7 +89,7 @@ struct video_settings_t
     int scanlines;
     int widescreen;
     int fps;
-    int fps_count;
+    int fps_count;          // 0 = off, 1 = FPS counter, 2 = performance HUD (toggled with F6)
     int hires;
     int hires_next;
     int filtering;
@@ -132,20 +141,61 @@ struct video_settings_t
     int desaturate_edges;
     int brightboost;
     int hiresprites;        // 0 = original; 1 = hires mode
+    int fused_layers;       // 1 = draw sky fill with the background tile layer; 0 = separately
+    int strip_lines;        // >0 = composite all layers this many output lines at a time; 0 = layer by layer
+    int prepare_bands;      // >1 = draw the frame in this many bands of lines at once, on the game threads
+    int low_latency;        // 1 = prepare, filter and upload each frame in slices and show it in the same refresh
+    int overlap_logic;      // 1 = draw the hardware layers of one frame whilst the game ticks the next
+    int present_thread;     // 1 = run the game on its own thread, leaving the main thread to present frames
+    int gpu_ntsc;           // 1 = apply the Blargg filter setting with a GPU shader rather than on the CPU
+    int gpu_palette;        // 1 = look up the game palette in a GPU shader (when the Blargg filter is off)
+    int blargg_tables;      // Blargg filter tables kept for recently used settings (32MB each, min 2)
+    int overlay_cache;      // 1 = keep the CRT overlay mask in use on disk, for the next start
+    int overlay_gpu;        // 1 = work the CRT overlay mask out in the shader, not as a CPU-built texture
+    int shader_cache;       // 1 = keep linked shader programs on disk, where the GPU driver allows
+    int shader_scale;       // CRT shader resolution, percent of the output size (25-100), upscaled
+    int crt_bloom;          // 1 = soften the rows between CPU scanlines (Blargg filter only)
+    int gpu_scanlines;      // 1 = dim the scanlines in the shader drawing the game image, not on the CPU
+    int row_reuse;          // 1 = Blargg filter: copy rows unchanged since a frame of the same burst phase
+    int blargg_16bit;       // 1 = Blargg filter: pack the output to 16 bits a pixel for the GPU upload
+    int static_frames;      // 1 = a frame the same as the last isn't filtered or uploaded again
+    int huge_pages;         // Linux: 1 = ask for transparent huge pages for the frame buffers (see framearena)
+    int trace;              // frame stage timings: 0 = off, 1 = console every 10s, 2 = also frametrace.txt
+    int trace_events;       // frame timeline events kept for a Chrome trace dump (F4, SIGUSR1); 0 = off
+    int slow_frame;         // percent over the frame budget that dumps recent frames (see flightrec); 0 = off
+    int pacing;             // without vsync: 1 = wait for each frame on a precise timer, 0 = plain sleep
+    int vrr;                // 1 = variable refresh rate display: present on completion, paced by timer
+    int vrr_rate;           // VRR: frame rate paced to, in hundredths of a Hz (0 = 60, or 30 at 30fps)
+    int high_refresh;       // display at a multiple of the frame rate: 0 = no vsync, 1 = repeat frames, 2 = black frames
+    int fps_remember;       // auto 30/60fps: 1 = keep the stages that needed 30fps for the next play
+    int fps_stages;         // auto 30/60fps: mask of route stages (0-14, 15 = menus) that needed 30fps
+    int quality_governor;   // auto 30/60fps: 1 = turn effects down a step at a time before dropping to 30fps
+    int attract_idle;       // seconds of attract mode without input before 30fps (see attractgov); 0 = off
+    int attract_temp;       // attract mode: SoC degrees C at which effects are turned down too; 0 = throttling only
+    int sprite_list;        // 1 = sprites handed to the renderer decoded, 0 = unpacked from sprite RAM
+    int interpolate;        // 1 = at 60fps with 30fps logic (fps 1), show sprites and curves midway between ticks
+    std::string driver;     // SDL video driver to ask for, e.g. kmsdrm; empty = SDL's choice
+    int renderer;           // 0 = GLES (RenderSurface), 1 = Linux framebuffer, no GPU (RenderFB)
+    std::string fb_device;  // framebuffer device for renderer 1
 };
 
 struct sound_settings_t
 {
     int enabled;
     int rate;
+    int chip_rate;       // rate the sound chips run at (Hz), resampled to 'rate'; 0 = 'rate'
     int advertise;
     int preview;
     int fix_samples;
     int music_timer;
     std::vector <music_t> music;
     int callback_rate;   // 0 = 8ms, 1 = 16ms (needed for WSL2)
+    int latency;         // audio mixed ahead of playback to aim for (ms); grown if underruns occur
+    int direct;          // mix in the SDL callback itself, with no ring or mixing thread (ignores latency)
+    int smooth_engine;   // glide the engine pitch and volume between logic ticks, rather than stepping
     int playback_device; // omit from config file or set to -1 to use system default
     int wave_volume;     // when using .wav files, the playback volume (1-8 where 5 = no adjustment)
+    int music_cache;     // decode custom .mp3 tracks to .wav files under the save path, in attract mode
     int custom_tracks_loaded = 0; // used to mask help text at startup if tracks are loaded
 };
 
@@ -166,6 +216,8 @@ struct controls_settings_t
     int axis[4];       // Analog Axis
     int asettings[2];  // Analog Settings
     bool invert[3];    // Invert Analog Axis
+    int latch_ms;      // Read the controls this far into each frame drawn (0 = at its start)
+    std::string evdev; // Linux: read the joystick from this /dev/input/event* device, rather than through SDL
 
     float rumble;      // Simple Controller Rumble Support
     int haptic;        // Force Feedback Enabled
@@ -178,9 +230,25 @@ struct smartypi_settings_t
 {
     int enabled;      // CannonBall used in conjunction with SMARTYPI in arcade cabinet
     int ouputs;       // Write Digital Outputs to console
+    std::string link; // Linux: also send the outputs, as binary packets, to this UNIX datagram socket
+    int motor_hz;     // Moving cabinet: run the motor on a thread of its own, at this rate (0 = with the game)
     int cabinet;      // Cabinet Type
 };
 
+// Scheduling of the engine's threads (see threadpolicy.hpp)
+struct threads_settings_t
+{
+    const static int MIXER  = 0;   // audio mixing thread
+    const static int RENDER = 1;   // frame job workers (render bands and frame preparation)
+    const static int GAME   = 2;   // game loop thread
+    const static int STATS  = 3;   // play stats and watchdog thread
+    const static int ROLES  = 4;
+
+    int rr;                        // real-time priorities use SCHED_RR (1) rather than SCHED_FIFO (0)
+    int priority[ROLES];           // real-time priority 1-99; 0 leaves the thread as normal
+    int cores[ROLES];              // bit mask of the cores the thread may run on; 0 = any
+};
+
 struct engine_settings_t
 {
     int dip_time;
@@ -204,6 +272,9 @@ struct engine_settings_t
     bool bumper;          // Handling: Smash into other cars without spinning
     bool turbo;           // Handling: Faster Car
     int car_pal;          // Car Palette
+    int replay_mb;        // Memory for the replay ring, in MB (0 = no replays)
+
+    bool operator==(const engine_settings_t&) const = default;
 };
 
 class Config
@@ -218,6 +289,7 @@ public:
     engine_settings_t      engine;
     ttrial_settings_t      ttrial;
     smartypi_settings_t    smartypi;
+    threads_settings_t     threads;
 
     int master_break_key = SDLK_ESCAPE;
 
@@ -237,6 +309,9 @@ public:
     // Original game ticks sprites at 30fps but background scroll at 60fps
     int tick_fps;
 
+    // Frames between 30fps ticks shown interpolated (video.interpolate, at 60fps with 30fps logic)
+    bool interpolate;
+
     // Continuous Mode: Traffic Setting
     int cont_traffic;
 
@@ -251,6 +326,7 @@ public:
     void save_scores(bool original_mode);
     void load_stats();
     void save_stats();
+    void flush_stats();
     void load_timetrial_scores();
     void save_timetrial_scores();
     bool clear_scores();
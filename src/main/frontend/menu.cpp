@@ -328,6 +328,7 @@ void Menu::init(bool init_main_menu)
     outrun.select_course(false, config.engine.prototype != 0);
     video.enabled = true;
     video.sprite_layer->set_x_clip(false); // Stop clipping in wide-screen mode.
+    video.wait_prepared();
     video.sprite_layer->reset();
     video.clear_text_ram();
     video.tile_layer->restore_tiles();
@@ -752,7 +753,8 @@ void Menu::tick_menu()
             }
             else if (SELECTED(ENTRY_FPS_COUNTER))
             {
-                config.video.fps_count ^= 1; // cycle between 0 and 1
+                if (++config.video.fps_count > 2)
+                    config.video.fps_count = 0; // off, FPS, performance HUD
             }
             else if (SELECTED(ENTRY_FULLSCREEN))
             {
@@ -1294,7 +1296,7 @@ void Menu::refresh_menu()
         }
         else if (menu_selected == &menu_video)
         {
-            if (SELECTED(ENTRY_FPS_COUNTER))        set_menu_text(ENTRY_FPS_COUNTER, config.video.fps_count ? "ON" : "OFF");
+            if (SELECTED(ENTRY_FPS_COUNTER))        set_menu_text(ENTRY_FPS_COUNTER, config.video.fps_count == 2 ? "PERF" : config.video.fps_count ? "ON" : "OFF");
             else if (SELECTED(ENTRY_FULLSCREEN))    set_menu_text(ENTRY_FULLSCREEN, VIDEO_LABELS[config.video.mode]);
             else if (SELECTED(ENTRY_WIDESCREEN))    set_menu_text(ENTRY_WIDESCREEN, config.video.widescreen ? "ON" : "OFF");
             else if (SELECTED(ENTRY_SCALE))         set_menu_text(ENTRY_SCALE, Utils::to_string(config.video.scale) + "X");
@@ -7,6 +7,7 @@
 ***************************************************************************/
 
 #include "sdl2/input.hpp"
+#include "ghost.hpp"
 
 #include "frontend/ttrial.hpp"
 
@@ -103,6 +104,7 @@ int TTrial::tick()
                     outrun.ttrial.overtakes        = 0;
                     outrun.ttrial.crashes          = 0;
                     outrun.ttrial.vehicle_cols     = 0;
+                    ghost::load(level_selected);
                     ostats.credits = 1;
                     return INIT_GAME;
                 }
@@ -126,4 +128,5 @@ void TTrial::update_best_time()
 {
     best_times[level_selected] = outrun.ttrial.best_lap_counter;
     config.save_timetrial_scores();
+    ghost::save();
 }
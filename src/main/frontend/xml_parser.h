@@ -500,11 +500,12 @@ namespace xml_parser
     }
 
     /*============================================================
-     * 6.  write_xml – preserves header & comments
+     * 6.  print_xml / write_xml – preserve header & comments
+     *     print_xml gives the text write_xml would write, for
+     *     writing elsewhere (e.g. off the calling thread).
      *============================================================*/
-    inline bool write_xml(const std::string& filename,
-                          ptree& tree,
-                          const std::string& xml_declaration = R"(<?xml version="1.0" encoding="UTF-8"?>)")
+    inline std::string print_xml(ptree& tree,
+                                 const std::string& xml_declaration = R"(<?xml version="1.0" encoding="UTF-8"?>)")
     {
         /* 1. Ensure the declaration is present at the very top */
         if (!tree.doc.FirstChild())
@@ -647,10 +648,18 @@ namespace xml_parser
                 }
             }
 
-            result.swap(out);  // <-- fill 'result' for the writer below
+            result.swap(out);  // <-- fill 'result' for the caller
         }
 
+        return result;
+    }
+
+    inline bool write_xml(const std::string& filename,
+                          ptree& tree,
+                          const std::string& xml_declaration = R"(<?xml version="1.0" encoding="UTF-8"?>)")
+    {
         /* 4. Write the adjusted XML to disk */
+        const std::string result = print_xml(tree, xml_declaration);
         std::ofstream ofs(filename, std::ios::binary);
         if (!ofs) return false;
         ofs << result;
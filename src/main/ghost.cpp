@@ -0,0 +1,303 @@
+/***************************************************************************
+    Time Trial Ghost Car.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include "ghost.hpp"
+#include "persist.hpp"
+#include "frontend/config.hpp"
+#include "engine/oferrari.hpp"
+#include "engine/oinitengine.hpp"
+#include "engine/oroad.hpp"
+#include "engine/osprites.hpp"
+#include "engine/outrun.hpp"
+
+static const uint32_t MAGIC   = 0x48474243; // "CBGH"
+static const uint32_t VERSION = 1;
+
+// A lap longer than five minutes isn't kept
+static const size_t MAX_SAMPLES = 30 * 60 * 5;
+
+// Traffic depth (OTraffic::update_props) grows by (speed difference * z) >> 11 a tick while
+// the road moves by OFerrari::CAR_BASE_INC (0x12F) * speed difference, so a car DEPTH of road position
+// further ahead is at 1/e of the depth. PLAYER_Z is the depth of the player's car, where traffic hits it.
+static const double  DEPTH    = 0x12F * 2048.0;
+static const int16_t PLAYER_Z = 0x1E0;
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint8_t  course, jap, prototype, unused;
+    int16_t  counter;           // lap time, as the time trial scores
+    uint16_t unused2;
+    uint32_t samples;
+};
+
+// The player's Ferrari, one tick of a lap
+struct Sample
+{
+    int32_t  road_pos;
+    int16_t  x;                 // oinitengine.car_x_pos
+    uint32_t addr;              // sprite frame
+    uint8_t  pal;               // less the car's colour: brake lights, wheels and incline
+    bool     hflip;
+    bool     visible;
+};
+
+enum { VISIBLE = 1, HFLIP = 2, NEW_FRAME = 4 };
+
+static std::vector<Sample> lap;         // being driven
+static std::vector<Sample> best;        // the ghost
+static bool                overflow = false;
+static bool                unsaved  = false;
+static int                 course   = -1;
+static int16_t             counter  = 0;
+
+std::string ghost::file(int n, bool jap)
+{
+    std::filesystem::path scores(jap ? config.data.file_ttrial_jap : config.data.file_ttrial);
+    return scores.replace_filename(scores.stem().string() + "_ghost" + std::to_string(n) + ".bin").string();
+}
+
+// Zigzag varint: small changes either way take a byte
+static void put(std::string& out, int32_t v)
+{
+    uint32_t u = (uint32_t(v) << 1) ^ uint32_t(v >> 31);
+    while (u >= 0x80)
+    {
+        out += char(u | 0x80);
+        u >>= 7;
+    }
+    out += char(u);
+}
+
+static bool get(const std::string& in, size_t& pos, int32_t& v)
+{
+    uint32_t u = 0;
+    for (int shift = 0; shift < 35 && pos < in.size(); shift += 7)
+    {
+        const uint8_t b = uint8_t(in[pos++]);
+        u |= uint32_t(b & 0x7F) << shift;
+        if (!(b & 0x80))
+        {
+            v = int32_t(u >> 1) ^ -int32_t(u & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Road position as the change in speed, x as the change, and the frame only when it changes
+static std::string encode(const std::vector<Sample>& samples)
+{
+    std::string out;
+    out.reserve(samples.size() * 4);
+    Sample  prev{};
+    int32_t prev_step = 0;
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        const Sample& s = samples[i];
+        const bool new_frame = i == 0 || s.addr != prev.addr || s.pal != prev.pal;
+        out += char((s.visible ? VISIBLE : 0) | (s.hflip ? HFLIP : 0) | (new_frame ? NEW_FRAME : 0));
+        const int32_t step = s.road_pos - prev.road_pos;
+        put(out, step - prev_step);
+        put(out, s.x - prev.x);
+        if (new_frame)
+        {
+            put(out, int32_t(s.addr - prev.addr));
+            out += char(s.pal);
+        }
+        prev      = s;
+        prev_step = step;
+    }
+    return out;
+}
+
+static bool decode(const std::string& in, size_t pos, uint32_t count, std::vector<Sample>& samples)
+{
+    samples.clear();
+    samples.reserve(count);
+    Sample  s{};
+    int32_t step = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (pos >= in.size())
+            return false;
+        const uint8_t flags = uint8_t(in[pos++]);
+        int32_t d_step, d_x, d_addr;
+        if (!get(in, pos, d_step) || !get(in, pos, d_x))
+            return false;
+        if (flags & NEW_FRAME)
+        {
+            if (!get(in, pos, d_addr) || pos >= in.size())
+                return false;
+            s.addr += uint32_t(d_addr);
+            s.pal   = uint8_t(in[pos++]);
+        }
+        step      += d_step;
+        s.road_pos += step;
+        s.x        = int16_t(s.x + d_x);
+        s.hflip    = (flags & HFLIP) != 0;
+        s.visible  = (flags & VISIBLE) != 0;
+        samples.push_back(s);
+    }
+    return true;
+}
+
+void ghost::load(int c)
+{
+    lap.clear();
+    best.clear();
+    overflow = false;
+    unsaved  = false;
+    course   = c;
+
+    const std::string path = file(course, config.engine.jap != 0);
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return; // no ghost for this course yet
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    Header header;
+    if (data.size() < sizeof(header))
+    {
+        std::cerr << "ghost: " << path << " is incomplete" << std::endl;
+        return;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION || header.samples > MAX_SAMPLES ||
+        header.course != course || header.jap != (config.engine.jap != 0) || header.prototype != (config.engine.prototype != 0))
+    {
+        std::cerr << "ghost: " << path << " is not a ghost of this course" << std::endl;
+        return;
+    }
+    if (!decode(data, sizeof(header), header.samples, best))
+    {
+        std::cerr << "ghost: " << path << " is incomplete" << std::endl;
+        best.clear();
+        return;
+    }
+    counter = header.counter;
+}
+
+static Sample capture()
+{
+    const oentry& car = osprites.jump_table[OSprites::SPRITE_FERRARI];
+    Sample s;
+    s.road_pos = oroad.road_pos;
+    s.x        = oinitengine.car_x_pos;
+    s.addr     = car.addr;
+    s.pal      = uint8_t(std::clamp(int(car.pal_src) - int(oferrari.ferrari_pal), 0, 4));
+    s.hflip    = (car.control() & OSprites::HFLIP) != 0;
+    s.visible  = oferrari.state == OFerrari::FERRARI_LOGIC && (car.control() & OSprites::ENABLE);
+    return s;
+}
+
+static void draw(const Sample& s, int32_t road_pos, int16_t x)
+{
+    if (s.visible)
+        ghost::draw_car(road_pos, x, s.addr, s.pal, s.hflip);
+}
+
+// As OTraffic::update_props places a car on the left hand road
+void ghost::draw_car(int32_t road_pos, int16_t x, uint32_t addr, uint8_t pal, bool hflip)
+{
+    const double z = PLAYER_Z * std::exp(double(oroad.road_pos - road_pos) / DEPTH);
+    if (z <= 8.0 || z >= double(ORoad::ARRAY_LENGTH))
+        return; // beyond the horizon, or behind the player
+    const int32_t z16 = int32_t(z);
+
+    oentry* sprite = &osprites.jump_table[OSprites::SPRITE_GHOST];
+    sprite->control()    = OSprites::ENABLE | (hflip ? OSprites::HFLIP : 0);
+    sprite->draw_props = oentry::BOTTOM;
+    sprite->priority   = sprite->road_priority = std::min<int32_t>(z16, 0x1FC); // under the player's car
+    sprite->y          = -(oroad.road_y[oroad.road_p0 + z16] >> 4) + 223;
+    sprite->zoom       = uint8_t(std::min<int32_t>((z16 >> 2) + 4, 0x7F));
+
+    // the same place across the road as the player's car, where x_diff in OTraffic is zero
+    const int32_t xw = (oroad.road_width >> 16) - x;
+    sprite->x = int16_t(((xw * z16) >> 9) + oroad.road0_h[z16]);
+
+    sprite->addr    = addr;
+    sprite->pal_src = uint16_t((oferrari.ferrari_pal == OFerrari::PAL_BLUE ? OFerrari::PAL_CYAN : OFerrari::PAL_BLUE) + pal);
+    osprites.map_palette(sprite);
+    osprites.do_spr_order_shadows(sprite);
+}
+
+void ghost::tick()
+{
+    if (!config.ttrial.ghost || outrun.cannonball_mode != Outrun::MODE_TTRIAL)
+        return;
+
+    if (outrun.game_state != GS_INGAME)
+    {
+        lap.clear();
+        overflow = false;
+        return;
+    }
+
+    if (outrun.tick_frame)
+    {
+        if (lap.size() < MAX_SAMPLES)
+            lap.push_back(capture());
+        else
+            overflow = true;
+    }
+
+    // Frame by frame at 60 fps, half way to the next tick
+    const size_t i = lap.size();
+    if (i == 0 || i > best.size())
+        return; // the ghost has finished its lap
+    const Sample& s = best[i - 1];
+    if (outrun.tick_frame || i == best.size())
+        draw(s, s.road_pos, s.x);
+    else
+        draw(s, s.road_pos + (best[i].road_pos - s.road_pos) / 2, int16_t(s.x + (best[i].x - s.x) / 2));
+}
+
+void ghost::end_lap(int16_t lap_counter, bool is_best)
+{
+    if (is_best && !overflow && !lap.empty())
+    {
+        best.swap(lap);
+        counter = lap_counter;
+        unsaved = true;
+    }
+    lap.clear();
+    overflow = false;
+}
+
+void ghost::save()
+{
+    if (!unsaved || course < 0)
+        return;
+    unsaved = false;
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic     = MAGIC;
+    header.version   = VERSION;
+    header.course    = uint8_t(course);
+    header.jap       = config.engine.jap != 0;
+    header.prototype = config.engine.prototype != 0;
+    header.counter   = counter;
+    header.samples   = uint32_t(best.size());
+
+    std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+    data += encode(best);
+
+    const std::string path = file(course, config.engine.jap != 0);
+    if (!persist::write(path, std::move(data)))
+        std::cerr << "ghost: unable to write " << path << std::endl;
+}
@@ -0,0 +1,50 @@
+/***************************************************************************
+    Time Trial Ghost Car.
+
+    The best lap of each time trial course is kept, and driven again by a
+    ghost car as the player races the course: not simulated, but played
+    back from what the player's Ferrari did each tick of that lap - its
+    road position, its position across the road and its sprite frame.
+
+    The ghost is drawn as an extra sprite, placed against the road as a
+    traffic car is from how far ahead of the player it is, so it costs no
+    more than a traffic car. It doesn't collide with anything, and is drawn
+    in another colour to the player's car.
+
+    A lap is kept once it beats the course's best time, and written with
+    the time trial scores (hiscores_timetrial_ghost<n>.bin). The samples
+    are stored as the change from the tick before, a few bytes a tick.
+
+    See time_trial.ghost in config.xml.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace ghost
+{
+    // Load the ghost of course (0-14, as the time trial scores), if one was saved
+    void load(int course);
+
+    // In the jump table, after the Ferrari: note this tick of the lap, and draw the ghost
+    void tick();
+
+    // The lap has ended, taking counter. The lap becomes the ghost when it's the best yet.
+    void end_lap(int16_t counter, bool best);
+
+    // With the time trial scores: write the ghost, if it's a new one
+    void save();
+
+    // Where the ghost of course is kept
+    std::string file(int course, bool jap);
+
+    // Draw a Ferrari as the ghost is drawn: at road_pos, at x across the road (as car_x_pos),
+    // in sprite frame addr, pal being the brake light/wheel/incline offset from the car's colour.
+    // Also draws a linked cabinet's car (twinlink.hpp).
+    void draw_car(int32_t road_pos, int16_t x, uint32_t addr, uint8_t pal, bool hflip);
+}
@@ -0,0 +1,140 @@
+/***************************************************************************
+    Haptics Output Thread.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include "haptics.hpp"
+#include "threadpolicy.hpp"
+#include "frontend/config.hpp"
+#include "sdl2/input.hpp"
+#include "directx/ffeedback.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+// A command: sustained in bit 63, then two values of 31 and 32 bits
+static const uint64_t EMPTY = ~uint64_t(0);
+
+static std::atomic<uint64_t> mailbox[haptics::CHANNELS] = { EMPTY, EMPTY };
+static std::atomic<uint32_t> posted{0};
+static std::atomic<bool>     running{false};
+static std::thread           worker;
+static std::mutex            device_mutex;
+
+static uint64_t pack(int a, int b, bool sustained)
+{
+    return (uint64_t(sustained) << 63) | (uint64_t(uint32_t(a) & 0x7FFFFFFF) << 32) | uint32_t(b);
+}
+
+static void write(int channel, uint64_t cmd)
+{
+    const int a = int(cmd >> 32) & 0x7FFFFFFF;
+    const int b = int(uint32_t(cmd));
+
+    std::lock_guard<std::mutex> lock(device_mutex);
+    if (channel == haptics::RUMBLE)
+        input.write_rumble((a & 1) != 0, float(b) / 1000.0f, a >> 1);
+    else
+        forcefeedback::set(a, b);
+}
+
+static void post(int channel, uint64_t cmd)
+{
+    if (!running.load(std::memory_order_acquire))
+    {
+        write(channel, cmd);
+        return;
+    }
+    mailbox[channel].store(cmd, std::memory_order_release);
+    posted.fetch_add(1, std::memory_order_release);
+    posted.notify_one();
+}
+
+static void run()
+{
+    threadpolicy::apply(threads_settings_t::GAME);
+
+    const auto keep_alive   = std::chrono::milliseconds(haptics::KEEP_ALIVE_MS);
+    const auto min_interval = std::chrono::milliseconds(haptics::MIN_INTERVAL_MS);
+    uint64_t           last[haptics::CHANNELS]    = { EMPTY, EMPTY };
+    clock_type::time_point written[haptics::CHANNELS] = {};
+
+    uint32_t seen = 0;
+    while (running.load(std::memory_order_acquire))
+    {
+        posted.wait(seen, std::memory_order_acquire);
+        seen = posted.load(std::memory_order_acquire);
+
+        for (int c = 0; c < haptics::CHANNELS; c++)
+        {
+            uint64_t cmd = mailbox[c].exchange(EMPTY, std::memory_order_acq_rel);
+            if (cmd == EMPTY)
+                continue;
+
+            const bool sustained = (cmd >> 63) != 0;
+            if (cmd == last[c] && !(sustained && clock_type::now() - written[c] >= keep_alive))
+                continue;
+
+            // too soon after the last write: wait, and take whatever is newest by then
+            if (clock_type::now() - written[c] < min_interval)
+            {
+                std::this_thread::sleep_until(written[c] + min_interval);
+                const uint64_t newer = mailbox[c].exchange(EMPTY, std::memory_order_acq_rel);
+                if (newer != EMPTY)
+                    cmd = newer;
+            }
+            write(c, cmd);
+            last[c]    = cmd;
+            written[c] = clock_type::now();
+        }
+    }
+
+    // what's left, so that a motor isn't left running
+    for (int c = 0; c < haptics::CHANNELS; c++)
+    {
+        const uint64_t cmd = mailbox[c].exchange(EMPTY, std::memory_order_acq_rel);
+        if (cmd != EMPTY && cmd != last[c])
+            write(c, cmd);
+    }
+}
+
+void haptics::start()
+{
+    if (worker.joinable())
+        return;
+    running = true;
+    worker  = std::thread(run);
+}
+
+void haptics::stop()
+{
+    if (!worker.joinable())
+        return;
+    running = false;
+    posted.fetch_add(1, std::memory_order_release);
+    posted.notify_one();
+    worker.join();
+}
+
+void haptics::rumble(bool enable, float strength, int mode)
+{
+    // strength in thousandths, so that the command is a whole number
+    const int thousandths = int(std::max(0.0f, strength) * 1000.0f + 0.5f);
+    post(RUMBLE, pack((mode << 1) | int(enable), thousandths, enable));
+}
+
+void haptics::force(int command, int force)
+{
+    post(FORCE, pack(command, force, true));
+}
+
+std::mutex& haptics::devices()
+{
+    return device_mutex;
+}
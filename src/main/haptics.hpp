@@ -0,0 +1,48 @@
+/***************************************************************************
+    Haptics Output Thread.
+
+    Controller rumble (hidraw, SDL or kernel force feedback) and the wheel
+    force feedback of ffeedback.cpp are written from a thread of their own.
+    A USB HID write can take milliseconds, and the game asks for the rumble
+    state on every logic tick.
+
+    Each channel holds only the latest command posted, in an atomic word,
+    so posting never waits. The thread writes a command when it differs
+    from the last one written. A sustained command (a timed effect that
+    ends unless repeated, such as rumble on) is written again at most every
+    KEEP_ALIVE_MS, and no channel is written more often than every
+    MIN_INTERVAL_MS.
+
+    Before start(), and after stop(), commands are written straight away.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <mutex>
+
+namespace haptics
+{
+    enum Channel
+    {
+        RUMBLE,     // Input::write_rumble(enable, strength, mode)
+        FORCE,      // forcefeedback::set(command, force)
+        CHANNELS
+    };
+
+    const int KEEP_ALIVE_MS   = 30;
+    const int MIN_INTERVAL_MS = 8;
+
+    void start();
+
+    // Write what is still posted, then end the thread
+    void stop();
+
+    void rumble(bool enable, float strength, int mode);
+    void force(int command, int force);
+
+    // Held whilst a command is written: take it to open or close a device
+    std::mutex& devices();
+}
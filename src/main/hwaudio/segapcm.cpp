@@ -54,13 +54,20 @@
  * 
  */
 
+#include <algorithm>
 #include "hwaudio/segapcm.hpp"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 SegaPCM::SegaPCM(uint32_t clock, RomLoader* rom, uint8_t* ram, int32_t bank)
 {
     this->ram = ram;
     pcm_rom = rom->rom;  
-    low = new uint8_t[16];
+    low = new uint8_t[16]();
     max_addr = rom->length;
     bankshift = bank & 0xFF;
     rgnmask = max_addr - 1;
@@ -89,11 +96,51 @@ void SegaPCM::init(int rate)
     int FREQ = rate;
     downsample = 31250.0 / double(FREQ);
     SoundChip::init(STEREO, FREQ);
+
+    // Cannonball Change: Output at configured sample rate.
+    for (int32_t d = 0; d < 0x100; d++)
+        step[d] = (int32_t) (double(d) * downsample);
+
+    samples.assign(frame_size, 0);
+    mix_left.assign(frame_size, 0);
+    mix_right.assign(frame_size, 0);
+}
+
+// Adds n samples of one channel, scaled by its volume, to a mix buffer.
+// |sample * volume| <= 128 * 255, so the products fit in 16 bits.
+static inline void mix_channel(int32_t* mix, const int16_t* v, uint32_t n, int16_t volume)
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128i vol = _mm_set1_epi16(volume);
+    for (; i + 8 <= n; i += 8) {
+        const __m128i p  = _mm_mullo_epi16(_mm_loadu_si128((const __m128i*) (v + i)), vol);
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(p, p), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(p, p), 16);
+        _mm_storeu_si128((__m128i*) (mix + i),     _mm_add_epi32(_mm_loadu_si128((const __m128i*) (mix + i)),     lo));
+        _mm_storeu_si128((__m128i*) (mix + i + 4), _mm_add_epi32(_mm_loadu_si128((const __m128i*) (mix + i + 4)), hi));
+    }
+#elif defined(__ARM_NEON)
+    const int16x4_t vol = vdup_n_s16(volume);
+    for (; i + 4 <= n; i += 4)
+        vst1q_s32(mix + i, vmlal_s16(vld1q_s32(mix + i), vld1_s16(v + i), vol));
+#endif
+    for (; i < n; i++)
+        mix[i] += v[i] * volume;
+}
+
+int SegaPCM::active_channels() const
+{
+    int n = 0;
+    for (int ch = 0; ch < 16; ch++)
+        n += (ram[8 * ch + 0x86] & 1) == 0;
+    return n;
 }
 
 void SegaPCM::stream_update()
 {
-    SoundChip::clear_buffer();
+    std::fill(mix_left.begin(),  mix_left.end(),  0);
+    std::fill(mix_right.begin(), mix_right.end(), 0);
 
     // loop over channels
     for (int ch = 0; ch < 16; ch++)
@@ -108,45 +155,83 @@ void SegaPCM::stream_update()
             uint32_t addr = (regs[0x85] << 16) | (regs[0x84] << 8) | low[ch];
             uint32_t loop = (regs[0x05] << 16) | (regs[0x04] << 8);
             uint8_t end   =  regs[0x06] + 1;
+            const uint32_t target = step[regs[7]];
 
-            uint32_t i;
+            // A gliding channel playing on from the last frame moves to its new step in parts
+            const bool     same  = last_step[ch] && loop == last_loop[ch];
+            const uint32_t from  = (glide >> ch & 1) && same ? last_step[ch] : target;
+            const uint32_t parts = from == target ? 1 : GLIDE_PARTS;
 
-            // loop over samples on this channel
-            for (i = 0; i < frame_size; i++) 
+            uint32_t i = 0;
+            bool halted = false;
+
+            for (uint32_t part = 1; part <= parts && !halted; part++)
             {
-                int8_t v = 0;
+                const uint32_t inc      = from + (int32_t(target) - int32_t(from)) * int32_t(part) / int32_t(parts);
+                const uint32_t part_end = frame_size * part / parts;
 
-                // handle looping if we've hit the end
-                if ((addr >> 16) == end) 
+                // fetch the samples for this channel, a block at a time up to the end address
+                while (i < part_end) 
                 {
-                    if ((regs[0x86] & 2) == 0) 
-                    {
-                        addr = loop;
-                    } 
-                    else 
+                    // handle looping if we've hit the end
+                    if ((addr >> 16) == end) 
                     {
-                        regs[0x86] |= 1;
-                        break;
+                        if ((regs[0x86] & 2) == 0) 
+                        {
+                            addr = loop;
+                        } 
+                        else 
+                        {
+                            regs[0x86] |= 1;
+                            halted = true;
+                            break;
+                        }
                     }
-                }
 
-                // fetch the sample
-                v = rom[(addr >> 8) & rgnmask] - 0x80;
-
-                // apply panning
-                write_buffer(LEFT,  i, read_buffer(LEFT,  i) + (v * regs[2]));
-                write_buffer(RIGHT, i, read_buffer(RIGHT, i) + (v * regs[3]));
+                    // samples before the end is reached. The step is under 0x10000, so the top
+                    // byte of the address can't pass over the end value.
+                    uint32_t n = part_end - i;
+                    if ((addr >> 16) == end) 
+                    {
+                        n = 1; // looped to the end block itself: play a sample before checking again
+                    }
+                    else if (inc != 0) 
+                    {
+                        const uint32_t distance = ((uint32_t(end) << 16) - addr) & 0xffffff;
+                        n = std::min(n, (distance + inc - 1) / inc);
+                    }
 
-                // Advance.
-                // Cannonball Change: Output at configured sample rate.
-                double increment = ((double)regs[7]) * downsample;
-                addr = (addr + (int) increment) & 0xffffff;
+                    for (const uint32_t block_end = i + n; i < block_end; i++)
+                    {
+                        samples[i] = int16_t(rom[(addr >> 8) & rgnmask]) - 0x80;
+                        addr = (addr + inc) & 0xffffff;
+                    }
+                }
             }
+            last_step[ch] = halted ? 0 : target;
+            last_loop[ch] = loop;
+
+            // apply panning
+            mix_channel(mix_left.data(),  samples.data(), i, regs[2]);
+            mix_channel(mix_right.data(), samples.data(), i, regs[3]);
 
             // store back the updated address and info
             regs[0x84] = addr >> 8;
             regs[0x85] = addr >> 16;
             low[ch] = regs[0x86] & 1 ? 0 : addr;
         }
+        else
+        {
+            last_step[ch] = 0;
+        }
+    }
+
+    // Interleave into the output. The 16-bit result wraps, as when each channel was
+    // added to the output directly.
+    int16_t* out = get_buffer();
+    for (uint32_t i = 0; i < frame_size; i++)
+    {
+        out[2 * i]     = int16_t(mix_left[i]);
+        out[2 * i + 1] = int16_t(mix_right[i]);
     }
 }
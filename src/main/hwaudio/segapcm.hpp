@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <vector>
 #include "stdint.hpp"
 #include "romloader.hpp"
 #include "hwaudio/soundchip.hpp"
@@ -31,6 +32,13 @@ public:
     void init(int rate);
     void stream_update();
 
+    // Channels playing (not halted), as the sound program last set them
+    int active_channels() const;
+
+    // Channels (bit per channel) whose pitch glides across a frame from the last frame's, rather
+    // than changing at its start. Only while the channel plays on with the same sample.
+    void set_glide(uint16_t channels) { glide = channels; }
+
 private:
     // PCM Chip Emulation
     uint8_t* ram;
@@ -42,4 +50,18 @@ private:
     int32_t rgnmask;
 
     double downsample;
+
+    // Address step per output sample for each delta (pitch) register value
+    int32_t step[0x100];
+
+    // Gliding channels, and each channel's step at the end of the last frame (0 if it wasn't
+    // playing) and the sample it was playing
+    static const uint32_t GLIDE_PARTS = 4;
+    uint16_t glide = 0;
+    uint32_t last_step[16] = {};
+    uint32_t last_loop[16] = {};
+
+    // Mixing buffers for one frame: a channel's samples, then the left and right sums
+    std::vector<int16_t> samples;
+    std::vector<int32_t> mix_left, mix_right;
 };
@@ -16,6 +16,8 @@
 #include <stdlib.h>
 #include <cmath>
 #include <cstring>  // For memset on GCC
+#include <algorithm>
+#include <array>
 #include "hwaudio/ym2151.hpp"
 
 signed int     chanout[8];
@@ -42,6 +44,7 @@ uint8_t        amd;                 /* LFO Amplitude Modulation Depth   */
 int8_t         pmd;                 /* LFO Phase Modulation Depth       */
 uint32_t       lfa;                 /* LFO current AM output            */
 int32_t        lfp;                 /* LFO current PM output            */
+int32_t        lfo_calc_phase;      /* lfo_phase lfa/lfp are for (-1 = calculate again) */
 
 uint8_t        test;                /* TEST register */
 uint8_t        ct;                  /* output control pins (bit1-CT2, bit0-CT1) */
@@ -142,15 +145,136 @@ uint32_t       noise_tab[32];       /* 17bit Noise Generator periods */
 *   TL_RES_LEN - sinus resolution (X axis)
 */
 #define TL_TAB_LEN (13*2*TL_RES_LEN)
-static signed int tl_tab[TL_TAB_LEN];
+
+/*  The tables are worked out by the compiler rather than as the chip starts.
+*   The <cmath> functions aren't constexpr, so these stand in for them over
+*   the ranges used; every table comes out the same as with libm.
+*/
+namespace ctmath
+{
+    constexpr double PI  = M_PI;
+    constexpr double LN2 = 0.693147180559945309417;
+
+    /* e^x, for |x| <= 1 */
+    constexpr double exp_small(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 30; k++)
+        {
+            term *= x / k;
+            sum  += term;
+        }
+        return sum;
+    }
+
+    /* 2^x, for x >= 0 */
+    constexpr double exp2(double x)
+    {
+        int whole = (int)x;
+        double r = (x == whole) ? 1.0 : exp_small((x - whole) * LN2);
+        for (; whole > 0; whole--)
+            r *= 2.0;
+        return r;
+    }
+
+    /* ln x, for x > 0: scaled by powers of two to near 1, then 2*atanh((x-1)/(x+1)) */
+    constexpr double log(double x)
+    {
+        int k = 0;
+        while (x > 1.5)  { x /= 2.0; k++; }
+        while (x < 0.75) { x *= 2.0; k--; }
+        const double z = (x - 1.0) / (x + 1.0);
+        double sum = 0.0, term = z;
+        for (int n = 1; n < 60; n += 2)
+        {
+            sum  += term / n;
+            term *= z * z;
+        }
+        return 2.0 * sum + k * LN2;
+    }
+
+    /* sin x, for 0 <= x <= 2*PI */
+    constexpr double sin(double x)
+    {
+        double sign = 1.0;
+        if (x > PI)     { x = 2.0 * PI - x; sign = -1.0; }
+        if (x > PI / 2)   x = PI - x;
+        double sum = 0.0, term = x;
+        for (int k = 1; k < 40; k += 2)
+        {
+            sum  += term;
+            term *= -x * x / ((k + 1) * (k + 2));
+        }
+        return sign * sum;
+    }
+}
+
+static constexpr std::array<signed int, TL_TAB_LEN> tl_tab = []
+{
+    std::array<signed int, TL_TAB_LEN> tab{};
+    for (int x=0; x<TL_RES_LEN; x++)
+    {
+        double m = (1<<16) / ctmath::exp2((x+1) * (ENV_STEP/4.0) / 8.0);
+
+        /* we never reach (1<<16) here due to the (x+1) */
+        /* result fits within 16 bits at maximum */
+
+        int n = (int)m;     /* 16 bits here (m is positive, so this is floor(m)) */
+        n >>= 4;            /* 12 bits here */
+        if (n&1)            /* round to closest */
+            n = (n>>1)+1;
+        else
+            n = n>>1;
+                            /* 11 bits here (rounded) */
+        n <<= 2;            /* 13 bits here (as in real chip) */
+        tab[ x*2 + 0 ] = n;
+        tab[ x*2 + 1 ] = -tab[ x*2 + 0 ];
+
+        for (int i=1; i<13; i++)
+        {
+            tab[ x*2+0 + i*2*TL_RES_LEN ] =  tab[ x*2+0 ]>>i;
+            tab[ x*2+1 + i*2*TL_RES_LEN ] = -tab[ x*2+0 + i*2*TL_RES_LEN ];
+        }
+    }
+    return tab;
+}();
 
 #define ENV_QUIET        (TL_TAB_LEN>>3)
 
 /* sin waveform table in 'decibel' scale */
-static unsigned int sin_tab[SIN_LEN];
+static constexpr std::array<unsigned int, SIN_LEN> sin_tab = []
+{
+    std::array<unsigned int, SIN_LEN> tab{};
+    for (int i=0; i<SIN_LEN; i++)
+    {
+        /* non-standard sinus */
+        double m = ctmath::sin( ((i*2)+1) * ctmath::PI / SIN_LEN ); /* verified on the real chip */
+
+        /* we never reach zero here due to ((i*2)+1) */
+
+        double o = 8*ctmath::log(1.0/(m>0.0 ? m : -m))/ctmath::LN2;    /* convert to 'decibels' */
+
+        o = o / (ENV_STEP/4);
+
+        int n = (int)(2.0*o);
+        if (n&1)                        /* round to closest */
+            n = (n>>1)+1;
+        else
+            n = n>>1;
+
+        tab[ i ] = n*2 + (m>=0.0? 0: 1 );
+    }
+    return tab;
+}();
 
 /* translate from D1L to volume index (16 D1L levels) */
-static uint32_t d1l_tab[16];
+static constexpr std::array<uint32_t, 16> d1l_tab = []
+{
+    std::array<uint32_t, 16> tab{};
+    for (int i=0; i<16; i++)
+        tab[i] = (uint32_t) ((i!=15 ? i : i+16) * (4.0/ENV_STEP));   /* every 3 'dB' except for all bits = 1 = 45+48 'dB' */
+    return tab;
+}();
 
 #define RATE_STEPS (8)
 static const uint8_t eg_inc[19*RATE_STEPS]={
@@ -293,7 +417,7 @@ static const uint32_t dt2_tab[4] = { 0, 384, 500, 608 };
 *   Detune table shown in YM2151 User's Manual is wrong (verified on the real chip)
 */
 
-static const uint8_t dt1_tab[4*32] = { /* 4*32 DT1 values */
+static constexpr uint8_t dt1_tab[4*32] = { /* 4*32 DT1 values */
 /* DT1=0 */
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -311,7 +435,7 @@ static const uint8_t dt1_tab[4*32] = { /* 4*32 DT1 values */
   8, 8, 9,10,11,12,13,14,16,17,19,20,22,22,22,22
 };
 
-static const uint16_t phaseinc_rom[768]={
+static constexpr uint16_t phaseinc_rom[768]={
 1299,1300,1301,1302,1303,1304,1305,1306,1308,1309,1310,1311,1313,1314,1315,1316,
 1318,1319,1320,1321,1322,1323,1324,1325,1327,1328,1329,1330,1332,1333,1334,1335,
 1337,1338,1339,1340,1341,1342,1343,1344,1346,1347,1348,1349,1351,1352,1353,1354,
@@ -403,120 +527,28 @@ static const uint8_t lfo_noise_waveform[256] = {
 0xE2,0x4D,0x8A,0xA6,0x46,0x95,0x0F,0x8F,0xF5,0x15,0x97,0x32,0xD4,0x28,0x1E,0x55
 };
 
-/* save output as raw 16-bit sample */
-/* #define SAVE_SAMPLE */
-/* #define SAVE_SEPARATE_CHANNELS */
-#if defined SAVE_SAMPLE || defined SAVE_SEPARATE_CHANNELS
-static FILE *sample[9];
-#endif
-
-YM2151::YM2151(float volume, uint32_t clock)
-{
-    this->volume = volume;  
-    this->clock = clock;
-}
-
-YM2151::~YM2151()
-{
-}
-
-
-void YM2151::init_tables()
+/*  Tables that depend on the chip clock and sampling rate. These are built at
+*   compile time for the Outrun clock at the usual output rates, and only
+*   worked out as the chip starts for any other rate.
+*/
+struct ChipTables
 {
-    signed int i,x,n;
-    double o,m;
-
-    for (x=0; x<TL_RES_LEN; x++)
-    {
-        m = (1<<16) / pow(2, (x+1) * (ENV_STEP/4.0) / 8.0);
-        m = floor(m);
-
-        /* we never reach (1<<16) here due to the (x+1) */
-        /* result fits within 16 bits at maximum */
-
-        n = (int)m;        /* 16 bits here */
-        n >>= 4;        /* 12 bits here */
-        if (n&1)        /* round to closest */
-            n = (n>>1)+1;
-        else
-            n = n>>1;
-                        /* 11 bits here (rounded) */
-        n <<= 2;        /* 13 bits here (as in real chip) */
-        tl_tab[ x*2 + 0 ] = n;
-        tl_tab[ x*2 + 1 ] = -tl_tab[ x*2 + 0 ];
-
-        for (i=1; i<13; i++)
-        {
-            tl_tab[ x*2+0 + i*2*TL_RES_LEN ] =  tl_tab[ x*2+0 ]>>i;
-            tl_tab[ x*2+1 + i*2*TL_RES_LEN ] = -tl_tab[ x*2+0 + i*2*TL_RES_LEN ];
-        }
-    #if 0
-        logerror("tl %04i", x*2);
-        for (i=0; i<13; i++)
-            logerror(", [%02i] %4i", i*2, tl_tab[ x*2 /*+1*/ + i*2*TL_RES_LEN ]);
-        logerror("\n");
-    #endif
-    }
-    /*logerror("TL_TAB_LEN = %i (%i bytes)\n",TL_TAB_LEN, (int)sizeof(tl_tab));*/
-    /*logerror("ENV_QUIET= %i\n",ENV_QUIET );*/
-
-
-    for (i=0; i<SIN_LEN; i++)
-    {
-        /* non-standard sinus */
-        m = sin( ((i*2)+1) * M_PI / SIN_LEN ); /* verified on the real chip */
-
-        /* we never reach zero here due to ((i*2)+1) */
-
-        if (m>0.0)
-            o = 8*log(1.0/m)/log(2.0);    /* convert to 'decibels' */
-        else
-            o = 8*log(-1.0/m)/log(2.0);    /* convert to 'decibels' */
-
-        o = o / (ENV_STEP/4);
-
-        n = (int)(2.0*o);
-        if (n&1)                        /* round to closest */
-            n = (n>>1)+1;
-        else
-            n = n>>1;
-
-        sin_tab[ i ] = n*2 + (m>=0.0? 0: 1 );
-        /*logerror("sin [0x%4x]= %4i (tl_tab value=%8x)\n", i, sin_tab[i],tl_tab[sin_tab[i]]);*/
-    }
-    /* calculate d1l_tab table */
-    for (i=0; i<16; i++)
-    {
-        m = (i!=15 ? i : i+16) * (4.0/ENV_STEP);   /* every 3 'dB' except for all bits = 1 = 45+48 'dB' */
-        d1l_tab[i] = (uint32_t) m;
-        /*logerror("d1l_tab[%02x]=%08x\n",i,d1l_tab[i] );*/
-    }
-
-#ifdef SAVE_SAMPLE
-    sample[8]=fopen("sampsum.pcm","wb");
-#endif
-#ifdef SAVE_SEPARATE_CHANNELS
-    sample[0]=fopen("samp0.pcm","wb");
-    sample[1]=fopen("samp1.pcm","wb");
-    sample[2]=fopen("samp2.pcm","wb");
-    sample[3]=fopen("samp3.pcm","wb");
-    sample[4]=fopen("samp4.pcm","wb");
-    sample[5]=fopen("samp5.pcm","wb");
-    sample[6]=fopen("samp6.pcm","wb");
-    sample[7]=fopen("samp7.pcm","wb");
-#endif
-}
-
+    uint32_t freq[11*768];
+    int32_t  dt1_freq[8*32];
+    uint32_t tim_A_tab[1024];
+    uint32_t tim_B_tab[256];
+    uint32_t noise_tab[32];
+};
 
-void YM2151::init_chip_tables()
+static constexpr ChipTables make_chip_tables(double clock, double sampfreq)
 {
+    ChipTables t{};
     int i,j;
     double mult,phaseinc,Hz;
     double scaler;
     double pom;
 
-    scaler = ( (double)clock / 64.0 ) / ( (double)sampfreq ); // JJP - was 64
-    /*logerror("scaler    = %20.15f\n", scaler);*/
+    scaler = ( clock / 64.0 ) / sampfreq; // JJP - was 64
 
     /* this loop calculates Hertz values for notes from c-0 to b-7 */
     /* including 64 'cents' (100/64 that is 1.5625 of real cent) per note */
@@ -527,43 +559,27 @@ void YM2151::init_chip_tables()
 
     for (i=0; i<768; i++)
     {
-        /* 3.4375 Hz is note A; C# is 4 semitones higher */
-        Hz = 1000;
-#if 0
-        /* Hz is close, but not perfect */
-        //Hz = scaler * 3.4375 * pow (2, (i + 4 * 64 ) / 768.0 );
-        /* calculate phase increment */
-        phaseinc = (Hz*SIN_LEN) / (double)sampfreq;
-#endif
-
         phaseinc = phaseinc_rom[i];    /* real chip phase increment */
         phaseinc *= scaler;            /* adjust */
 
-
         /* octave 2 - reference octave */
-        freq[ 768+2*768+i ] = ((int)(phaseinc*mult)) & 0xffffffc0; /* adjust to X.10 fixed point */
+        t.freq[ 768+2*768+i ] = ((int)(phaseinc*mult)) & 0xffffffc0; /* adjust to X.10 fixed point */
         /* octave 0 and octave 1 */
         for (j=0; j<2; j++)
         {
-            freq[768 + j*768 + i] = (freq[ 768+2*768+i ] >> (2-j) ) & 0xffffffc0; /* adjust to X.10 fixed point */
+            t.freq[768 + j*768 + i] = (t.freq[ 768+2*768+i ] >> (2-j) ) & 0xffffffc0; /* adjust to X.10 fixed point */
         }
         /* octave 3 to 7 */
         for (j=3; j<8; j++)
         {
-            freq[768 + j*768 + i] = freq[ 768+2*768+i ] << (j-2);
+            t.freq[768 + j*768 + i] = t.freq[ 768+2*768+i ] << (j-2);
         }
-
-    #if 0
-            pom = (double)freq[ 768+2*768+i ] / ((double)(1<<FREQ_SH));
-            pom = pom * (double)sampfreq / (double)SIN_LEN;
-            logerror("1freq[%4i][%08x]= real %20.15f Hz  emul %20.15f Hz\n", i, freq[ 768+2*768+i ], Hz, pom);
-    #endif
     }
 
     /* octave -1 (all equal to: oct 0, _KC_00_, _KF_00_) */
     for (i=0; i<768; i++)
     {
-        freq[ 0*768 + i ] = freq[1*768+0];
+        t.freq[ 0*768 + i ] = t.freq[1*768+0];
     }
 
     /* octave 8 and 9 (all equal to: oct 7, _KC_14_, _KF_63_) */
@@ -571,91 +587,128 @@ void YM2151::init_chip_tables()
     {
         for (i=0; i<768; i++)
         {
-            freq[768+ j*768 + i ] = freq[768 + 8*768 -1];
+            t.freq[768+ j*768 + i ] = t.freq[768 + 8*768 -1];
         }
     }
 
-#if 0
-        for (i=0; i<11*768; i++)
-        {
-            pom = (double)freq[i] / ((double)(1<<FREQ_SH));
-            pom = pom * (double)sampfreq / (double)SIN_LEN;
-            logerror("freq[%4i][%08x]= emul %20.15f Hz\n", i, freq[i], pom);
-        }
-#endif
-
     mult = (1<<FREQ_SH);
     for (j=0; j<4; j++)
     {
         for (i=0; i<32; i++)
         {
-            Hz = ( (double)dt1_tab[j*32+i] * ((double)clock/64.0) ) / (double)(1<<20);
+            Hz = ( (double)dt1_tab[j*32+i] * (clock/64.0) ) / (double)(1<<20);
 
             /*calculate phase increment*/
-            phaseinc = (Hz*SIN_LEN) / (double)sampfreq;
+            phaseinc = (Hz*SIN_LEN) / sampfreq;
 
             /*positive and negative values*/
-            dt1_freq[ (j+0)*32 + i ] = (int32_t) (phaseinc * mult);
-            dt1_freq[ (j+4)*32 + i ] = -dt1_freq[ (j+0)*32 + i ];
-
-#if 0
-            {
-                int x = j*32 + i;
-                pom = (double)dt1_freq[x] / mult;
-                pom = pom * (double)sampfreq / (double)SIN_LEN;
-                logerror("DT1(%03i)[%02i %02i][%08x]= real %19.15f Hz  emul %19.15f Hz\n",
-                         x, j, i, dt1_freq[x], Hz, pom);
-            }
-#endif
+            t.dt1_freq[ (j+0)*32 + i ] = (int32_t) (phaseinc * mult);
+            t.dt1_freq[ (j+4)*32 + i ] = -t.dt1_freq[ (j+0)*32 + i ];
         }
     }
 
-
     /* calculate timers' deltas */
     /* User's Manual pages 15,16  */
     mult = (1<<TIMER_SH);
     for (i=0; i<1024; i++)
     {
-        /* ASG 980324: changed to compute both tim_A_tab and timer_A_time */
-        //pom= attotime::from_hz(clock) * (64 * (1024 - i));
         // JJP - per datasheet, time in MS that the counter will run, before generating interrupt (if
         // enabled) will be calculated in "pom" for each possible timer valve. The timer is 10-bit,
         // therefore there are 1024 possible start values.
-        pom= ( 64.0  *  (1024.0-i) / (double)clock );
-        #ifdef USE_MAME_TIMERS
-            timer_A_time[i] = pom;
-        #else
-            //tim_A_tab[i] = pom.as_double() * (double)sampfreq * mult;  /* number of samples that timer period takes (fixed point) */
-            // the value stored in tim_A-tab is actually the number of samples that would be played in the period
-            // but * 1,000 and * (1<<TIMER_SH), the latter being what will be decremented on each cycle through
-            // the look later.
-            tim_A_tab[i] = (int)(pom * (double)sampfreq * mult);
-        #endif
+        pom= ( 64.0  *  (1024.0-i) / clock );
+        // the value stored in tim_A-tab is actually the number of samples that would be played in the period
+        // but * 1,000 and * (1<<TIMER_SH), the latter being what will be decremented on each cycle through
+        // the look later.
+        t.tim_A_tab[i] = (int)(pom * sampfreq * mult);
     }
     for (i=0; i<256; i++)
     {
-        /* ASG 980324: changed to compute both tim_B_tab and timer_B_time */
-        //pom= attotime::from_hz(clock) * (1024 * (256 - i));
-        pom= ( 1024.0 * (256.0-i)  / (double)clock ); //JJP
-        #ifdef USE_MAME_TIMERS
-            timer_B_time[i] = pom;
-        #else
-            //tim_B_tab[i] = pom.as_double() * (double)sampfreq * mult;  /* number of samples that timer period takes (fixed point) */
-            tim_B_tab[i] = (int)(pom * (double)sampfreq * mult); 
-        #endif
+        pom= ( 1024.0 * (256.0-i)  / clock ); //JJP
+        t.tim_B_tab[i] = (int)(pom * sampfreq * mult);
     }
 
     /* calculate noise periods table */
-    scaler = ( (double)clock / 64.0 ) / ( (double)sampfreq );
     for (i=0; i<32; i++)
     {
         j = (i!=31 ? i : 30);                /* rate 30 and 31 are the same */
         j = 32-j;
         j = (int) (65536.0 / (double)(j*32.0));    /* number of samples per one shift of the shift register */
         /*noise_tab[i] = j * 64;*/    /* number of chip clock cycles per one shift */
-        noise_tab[i] = (uint32_t) (j * 64 * scaler);
-        /*logerror("noise_tab[%02x]=%08x\n", i, noise_tab[i]);*/
+        t.noise_tab[i] = (uint32_t) (j * 64 * scaler);
     }
+    return t;
+}
+
+static const int BUILT_CLOCK = 4000000;  /* OSoundInt::SOUND_CLOCK */
+static constexpr ChipTables chip_tables_44100 = make_chip_tables(BUILT_CLOCK, 44100);
+static constexpr ChipTables chip_tables_22050 = make_chip_tables(BUILT_CLOCK, 22050);  /* single core Pi */
+
+/* save output as raw 16-bit sample */
+/* #define SAVE_SAMPLE */
+/* #define SAVE_SEPARATE_CHANNELS */
+#if defined SAVE_SAMPLE || defined SAVE_SEPARATE_CHANNELS
+static FILE *sample[9];
+#endif
+
+YM2151::YM2151(float volume, uint32_t clock)
+{
+    this->volume = volume;  
+    this->clock = clock;
+}
+
+YM2151::~YM2151()
+{
+}
+
+
+void YM2151::init_tables()
+{
+    /* tl_tab, sin_tab and d1l_tab are built at compile time */
+
+#ifdef SAVE_SAMPLE
+    sample[8]=fopen("sampsum.pcm","wb");
+#endif
+#ifdef SAVE_SEPARATE_CHANNELS
+    sample[0]=fopen("samp0.pcm","wb");
+    sample[1]=fopen("samp1.pcm","wb");
+    sample[2]=fopen("samp2.pcm","wb");
+    sample[3]=fopen("samp3.pcm","wb");
+    sample[4]=fopen("samp4.pcm","wb");
+    sample[5]=fopen("samp5.pcm","wb");
+    sample[6]=fopen("samp6.pcm","wb");
+    sample[7]=fopen("samp7.pcm","wb");
+#endif
+}
+
+
+void YM2151::init_chip_tables()
+{
+    const ChipTables* t = nullptr;
+    ChipTables computed;
+    if (clock == BUILT_CLOCK && sampfreq == 44100)
+        t = &chip_tables_44100;
+    else if (clock == BUILT_CLOCK && sampfreq == 22050)
+        t = &chip_tables_22050;
+    else
+    {
+        computed = make_chip_tables(clock, sampfreq);
+        t = &computed;
+    }
+
+    std::memcpy(freq,      t->freq,      sizeof(freq));
+    std::memcpy(dt1_freq,  t->dt1_freq,  sizeof(dt1_freq));
+    std::memcpy(noise_tab, t->noise_tab, sizeof(noise_tab));
+
+#ifdef USE_MAME_TIMERS
+    /* ASG 980324: changed to compute both tim_A_tab and timer_A_time */
+    for (int i=0; i<1024; i++)
+        timer_A_time[i] = ( 64.0  *  (1024.0-i) / (double)clock );
+    for (int i=0; i<256; i++)
+        timer_B_time[i] = ( 1024.0 * (256.0-i)  / (double)clock );
+#else
+    std::memcpy(tim_A_tab, t->tim_A_tab, sizeof(tim_A_tab));
+    std::memcpy(tim_B_tab, t->tim_B_tab, sizeof(tim_B_tab));
+#endif
 }
 
 #define KEY_ON(op, key_set){                                    \
@@ -1300,6 +1353,8 @@ void YM2151::init(int rate)
 {
     SoundChip::init(STEREO, rate);
     this->sampfreq = rate;
+    mix_left.assign(frame_size, 0);
+    mix_right.assign(frame_size, 0);
     init_tables();
 
     //this->sampfreq = rate ? rate : 31250;  /* avoid division by 0 in init_chip_tables() */
@@ -1825,7 +1880,7 @@ void YM2151::advance_eg()
 }
 
 
-void YM2151::advance()
+void YM2151::advance(uint32_t active)
 {
     YM2151Operator *op;
     unsigned int i;
@@ -1847,68 +1902,73 @@ void YM2151::advance()
         }
     }
 
-    i = lfo_phase;
-    /* calculate LFO AM and PM waveform value (all verified on real chip, except for noise algorithm which is impossible to analyse)*/
-    switch (lfo_wsel)
+    /* the LFO output only changes with its phase (or the registers, see stream_update) */
+    if ((int32_t) lfo_phase != lfo_calc_phase)
     {
-    case 0:
-        /* saw */
-        /* AM: 255 down to 0 */
-        /* PM: 0 to 127, -127 to 0 (at PMD=127: LFP = 0 to 126, -126 to 0) */
-        a = 255 - i;
-        if (i<128)
-            p = i;
-        else
-            p = i - 255;
-        break;
-    case 1:
-        /* square */
-        /* AM: 255, 0 */
-        /* PM: 128,-128 (LFP = exactly +PMD, -PMD) */
-        if (i<128)
-        {
-            a = 255;
-            p = 128;
-        }
-        else
+        lfo_calc_phase = lfo_phase;
+        i = lfo_phase;
+        /* calculate LFO AM and PM waveform value (all verified on real chip, except for noise algorithm which is impossible to analyse)*/
+        switch (lfo_wsel)
         {
-            a = 0;
-            p = -128;
-        }
-        break;
-    case 2:
-        /* triangle */
-        /* AM: 255 down to 1 step -2; 0 up to 254 step +2 */
-        /* PM: 0 to 126 step +2, 127 to 1 step -2, 0 to -126 step -2, -127 to -1 step +2*/
-        if (i<128)
-            a = 255 - (i*2);
-        else
-            a = (i*2) - 256;
-
-        if (i<64)                        /* i = 0..63 */
-            p = i*2;                    /* 0 to 126 step +2 */
-        else if (i<128)                    /* i = 64..127 */
-                p = 255 - i*2;            /* 127 to 1 step -2 */
-            else if (i<192)                /* i = 128..191 */
-                    p = 256 - i*2;        /* 0 to -126 step -2*/
-                else                    /* i = 192..255 */
-                    p = i*2 - 511;        /*-127 to -1 step +2*/
-        break;
-    case 3:
-    default:    /*keep the compiler happy*/
-        /* random */
-        /* the real algorithm is unknown !!!
-            We just use a snapshot of data from real chip */
+        case 0:
+            /* saw */
+            /* AM: 255 down to 0 */
+            /* PM: 0 to 127, -127 to 0 (at PMD=127: LFP = 0 to 126, -126 to 0) */
+            a = 255 - i;
+            if (i<128)
+                p = i;
+            else
+                p = i - 255;
+            break;
+        case 1:
+            /* square */
+            /* AM: 255, 0 */
+            /* PM: 128,-128 (LFP = exactly +PMD, -PMD) */
+            if (i<128)
+            {
+                a = 255;
+                p = 128;
+            }
+            else
+            {
+                a = 0;
+                p = -128;
+            }
+            break;
+        case 2:
+            /* triangle */
+            /* AM: 255 down to 1 step -2; 0 up to 254 step +2 */
+            /* PM: 0 to 126 step +2, 127 to 1 step -2, 0 to -126 step -2, -127 to -1 step +2*/
+            if (i<128)
+                a = 255 - (i*2);
+            else
+                a = (i*2) - 256;
+
+            if (i<64)                        /* i = 0..63 */
+                p = i*2;                    /* 0 to 126 step +2 */
+            else if (i<128)                    /* i = 64..127 */
+                    p = 255 - i*2;            /* 127 to 1 step -2 */
+                else if (i<192)                /* i = 128..191 */
+                        p = 256 - i*2;        /* 0 to -126 step -2*/
+                    else                    /* i = 192..255 */
+                        p = i*2 - 511;        /*-127 to -1 step +2*/
+            break;
+        case 3:
+        default:    /*keep the compiler happy*/
+            /* random */
+            /* the real algorithm is unknown !!!
+                We just use a snapshot of data from real chip */
 
-        /* AM: range 0 to 255    */
-        /* PM: range -128 to 127 */
+            /* AM: range 0 to 255    */
+            /* PM: range -128 to 127 */
 
-        a = lfo_noise_waveform[i];
-        p = a-128;
-        break;
+            a = lfo_noise_waveform[i];
+            p = a-128;
+            break;
+        }
+        lfa = a * amd / 128;
+        lfp = p * pmd / 128;
     }
-    lfa = a * amd / 128;
-    lfp = p * pmd / 128;
 
 
     /*  The Noise Generator of the YM2151 is 17-bit shift register.
@@ -1933,7 +1993,11 @@ void YM2151::advance()
     i = 8;
     do
     {
-        if (op->pms)    /* only when phase modulation from LFO is enabled for this channel */
+        if (!(active & 1))
+        {
+            /* silent channel (see stream_update): the phase is cleared on KEY ON */
+        }
+        else if (op->pms)    /* only when phase modulation from LFO is enabled for this channel */
         {
             int32_t mod_ind = lfp;        /* -128..+127 (8bits signed) */
             if (op->pms < 6)
@@ -1966,6 +2030,7 @@ void YM2151::advance()
         }
 
         op+=4;
+        active >>= 1;
         i--;
     }while (i);
 
@@ -2015,10 +2080,19 @@ void YM2151::advance()
 *   'length' is the number of samples that should be generated
 */
 
-void YM2151::stream_update()
+// Whether a channel is silent and stays so until a KEY ON: every operator has finished its
+// envelope (so is at maximum attenuation, above ENV_QUIET whatever the TL or AM), and the
+// feedback and delayed sample have emptied. Its output and state would not change.
+bool YM2151::channel_silent(unsigned int chan)
 {
-    SoundChip::clear_buffer();
+    const YM2151Operator *op = &oper[chan*4];
+    return op[0].state == EG_OFF && op[1].state == EG_OFF &&
+           op[2].state == EG_OFF && op[3].state == EG_OFF &&
+           op[0].fb_out_prev == 0 && op[0].fb_out_curr == 0 && op[0].mem_value == 0;
+}
 
+void YM2151::stream_update()
+{
     const uint32_t length = frame_size;
 
     // Hoist pan masks out of the per-sample loop
@@ -2034,6 +2108,19 @@ void YM2151::stream_update()
     // Fixed-point gain once per frame (recompute only when volume changes)
     const uint32_t vol_q15 = (int)lrintf(volume * 32768.0f);
 
+    // Registers written since the last frame may have changed the LFO output
+    lfo_calc_phase = -1;
+
+    // Channels to calculate this frame. A silent channel can only start again with a KEY ON,
+    // which (CSM aside) is only written between frames.
+    uint32_t active = 0xff;
+    if (!csm_req && !(irq_enable & 0x80))
+    {
+        for (unsigned int ch = 0; ch < 8; ch++)
+            if (channel_silent(ch))
+                active &= ~(1u << ch);
+    }
+
 #ifndef USE_MAME_TIMERS
     // timer B pre-pass (unchanged semantics)
     if (tim_B) {
@@ -2049,6 +2136,9 @@ void YM2151::stream_update()
     }
 #endif
 
+    int32_t* mixl = mix_left.data();
+    int32_t* mixr = mix_right.data();
+
     for (uint32_t i = 0; i < length; ++i) {
 
         advance_eg();
@@ -2058,8 +2148,14 @@ void YM2151::stream_update()
         chanout[4]=chanout[5]=chanout[6]=chanout[7]=0;
 
         // 8 channels
-        chan_calc(0); chan_calc(1); chan_calc(2); chan_calc(3);
-        chan_calc(4); chan_calc(5); chan_calc(6); chan7_calc();
+        if (active == 0xff) {
+            chan_calc(0); chan_calc(1); chan_calc(2); chan_calc(3);
+            chan_calc(4); chan_calc(5); chan_calc(6); chan7_calc();
+        } else {
+            for (unsigned int ch = 0; ch < 7; ch++)
+                if (active & (1u << ch)) chan_calc(ch);
+            if (active & 0x80) chan7_calc();
+        }
 
         // mix with hoisted pan masks (FINAL_SH is 0, so no shifts)
         int32_t outl  = (chanout[0] & p0L);
@@ -2072,20 +2168,8 @@ void YM2151::stream_update()
         outl += (chanout[6] & p6L);  outr += (chanout[6] & p6R);
         outl += (chanout[7] & p7L);  outr += (chanout[7] & p7R);
 
-        outl >>= FINAL_SH;
-        outr >>= FINAL_SH;
-#ifndef __arm__
-        if (outl > MAXOUT) outl = MAXOUT;
-            else if (outl < MINOUT) outl = MINOUT;
-        if (outr > MAXOUT) outr = MAXOUT;
-            else if (outr < MINOUT) outr = MINOUT;
-#else
-        // saturate to 16-bit (ARMv6)
-        outl = __builtin_arm_ssat(outl, 16);
-        outr = __builtin_arm_ssat(outr, 16);
-#endif
-        write_buffer(LEFT,  i, (outl * vol_q15) >> 15);
-        write_buffer(RIGHT, i, (outr * vol_q15) >> 15);
+        mixl[i] = outl >> FINAL_SH;
+        mixr[i] = outr >> FINAL_SH;
 
 #ifndef USE_MAME_TIMERS
         if (tim_A) {
@@ -2101,7 +2185,16 @@ void YM2151::stream_update()
             }
         }
 #endif
-        advance();
+        advance(active);
+    }
+
+    // saturate to 16-bit, apply the gain and interleave into the output
+    int16_t* out = get_buffer();
+    for (uint32_t i = 0; i < length; ++i) {
+        const int32_t outl = std::clamp<int32_t>(mixl[i], MINOUT, MAXOUT);
+        const int32_t outr = std::clamp<int32_t>(mixr[i], MINOUT, MAXOUT);
+        out[2 * i]     = (int16_t) ((outl * vol_q15) >> 15);
+        out[2 * i + 1] = (int16_t) ((outr * vol_q15) >> 15);
     }
 }
 
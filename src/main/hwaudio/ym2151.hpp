@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <vector>
 #include "stdint.hpp"
 #include "romloader.hpp"
 #include "hwaudio/soundchip.hpp"
@@ -86,6 +87,9 @@ private:
     int sampfreq;     /*sampling frequency in Hz (passed from 2151intf.c)*/
     float volume;
 
+    // One frame of the mixed output, before saturation and gain
+    std::vector<int32_t> mix_left, mix_right;
+
     void init_tables();
     void init_chip_tables();
     inline void envelope_KONKOFF(YM2151Operator * op, int v);
@@ -96,6 +100,7 @@ private:
     inline signed int op_calc1(YM2151Operator * OP, unsigned int env, signed int pm);
     inline void chan_calc(unsigned int chan);
     inline void chan7_calc();
+    inline bool channel_silent(unsigned int chan);
     inline void advance_eg();
-    inline void advance();
+    inline void advance(uint32_t active);
 };
@@ -1,6 +1,10 @@
 #include <algorithm> // Required for std::fill_n
+#include <istream>
+#include <ostream>
+#include <vector>
 #include "hwvideo/hwroad.hpp"
 #include "globals.hpp"
+#include "jobsystem.hpp"
 #include "frontend/config.hpp"
 
 /***************************************************************************
@@ -125,6 +129,7 @@ HWRoad::~HWRoad()
 void HWRoad::init(const uint8_t* src_road, const bool hires)
 {
     road_control = 0;
+    frame_control = 0;
     color_offset1 = 0x400;
     color_offset2 = 0x420;
     color_offset3 = 0x780;
@@ -135,12 +140,12 @@ void HWRoad::init(const uint8_t* src_road, const bool hires)
 
     if (hires)
     {
-        render_background = &HWRoad::render_background_hires;
+        render_background = &HWRoad::render_background_res<true>;
         render_foreground = &HWRoad::render_foreground_hires;
     }
     else
     {
-        render_background = &HWRoad::render_background_lores;
+        render_background = &HWRoad::render_background_res<false>;
         render_foreground = &HWRoad::render_foreground_lores;
     }
 }
@@ -170,27 +175,176 @@ void HWRoad::init(const uint8_t* src_road, const bool hires)
 
 void HWRoad::decode_road(const uint8_t* src_road)
 {
-    for (int y = 0; y < 256 * 2; y++) 
-    {
-        const int src = ((y & 0xff) * 0x40 + (y >> 8) * 0x8000) % rom_size; // tempGfx
-        const int dst = y * 512; // System16Roads
+    // only needed to build the runs below
+    std::vector<uint8_t> roads(ROAD_ROWS * 512);
 
-        // loop over columns
-        for (int x = 0; x < 512; x++) 
+    jobsystem.parallel_for(0, 256 * 2, [&](int first, int last) {
+        for (int y = first; y < last; y++)
         {
-            roads[dst + x] = (((src_road[src + (x / 8)] >> (~x & 7)) & 1) << 0) | (((src_road[src + (x / 8 + 0x4000)] >> (~x & 7)) & 1) << 1);
+            const int src = ((y & 0xff) * 0x40 + (y >> 8) * 0x8000) % rom_size; // tempGfx
+            const int dst = y * 512; // System16Roads
+
+            // loop over columns
+            for (int x = 0; x < 512; x++) 
+            {
+                roads[dst + x] = (((src_road[src + (x / 8)] >> (~x & 7)) & 1) << 0) | (((src_road[src + (x / 8 + 0x4000)] >> (~x & 7)) & 1) << 1);
 
-            // pre-mark road data in the "stripe" area with a high bit
-            if (x >= 256 - 8 && x < 256 && roads[dst + x] == 3)
-                roads[dst + x] |= 4;
+                // pre-mark road data in the "stripe" area with a high bit
+                if (x >= 256 - 8 && x < 256 && roads[dst + x] == 3)
+                    roads[dst + x] |= 4;
+            }
         }
-    }
+    });
 
     // set up a dummy road in the last entry
     for (int i = 0; i < 512; i++) 
     {
         roads[256 * 2 * 512 + i] = 3;
     }
+
+    // and the run-length version used for drawing
+    run_end.clear();
+    run_pix.clear();
+    for (uint32_t row = 0; row < ROAD_ROWS; row++)
+    {
+        const uint8_t* src = roads.data() + row * 512;
+        run_first[row] = uint32_t(run_end.size());
+        for (int x = 0; x < 512; )
+        {
+            const uint8_t pix = src[x];
+            int end = x + 1;
+            while (end < 512 && src[end] == pix)
+                end++;
+            run_end.push_back(uint16_t(end));
+            run_pix.push_back(pix);
+            x = end;
+        }
+    }
+    run_first[ROAD_ROWS] = uint32_t(run_end.size());
+}
+
+// ------------------------------------------------------------------------------------------------
+// Run-length line drawing, shared by the lores and hires renderers
+// ------------------------------------------------------------------------------------------------
+
+static const uint8_t priority_map[2][8] =
+{
+    { 0x80,0x81,0x81,0x87,0,0,0,0x00 },
+    { 0x81,0x81,0x81,0x8f,0,0,0,0x80 }
+};
+
+// Define a lookup table mapping (pix0, pix1) to color indices
+// for the hot path
+static const ALIGN64 uint8_t priority_lookup[8][8] = {
+    // pix1: 0  1  2  3  4  5  6  7
+    {   0,  0,  0,  0,  0,  0,  0, 1 }, // pix0 = 0
+    {   1,  0,  0,  0,  0,  0,  0, 1 }, // pix0 = 1
+    {   1,  0,  0,  0,  0,  0,  0, 1 }, // pix0 = 2
+    {   1,  1,  1,  0,  0,  0,  0, 1 }, // pix0 = 3
+    {   0,  0,  0,  0,  0,  0,  0, 0 }, // pix0 = 4
+    {   0,  0,  0,  0,  0,  0,  0, 0 }, // pix0 = 5
+    {   0,  0,  0,  0,  0,  0,  0, 0 }, // pix0 = 6
+    {   0,  0,  0,  0,  0,  0,  0, 0 }  // pix0 = 7
+};
+
+// Split 'count' positions of a road line, starting at hpos, into runs of constant pixel value.
+// Positions outside the 512 pixel road (hpos 0x200-0xfff) read as exterior (3).
+int HWRoad::line_runs(uint32_t row, uint32_t hpos, int count, RoadRun* out) const
+{
+    const uint16_t* ends  = run_end.data() + run_first[row];
+    const uint8_t*  pix   = run_pix.data() + run_first[row];
+    const int       nruns = int(run_first[row + 1] - run_first[row]);
+
+    int n = 0;
+    int r = -1; // current run, once known
+    hpos &= 0xfff;
+    while (count > 0)
+    {
+        int     len;
+        uint8_t p;
+        if (hpos >= 0x200)
+        {
+            len = std::min<int>(count, 0x1000 - hpos);
+            p   = 3;
+            r   = 0; // wraps round to the start of the road
+        }
+        else
+        {
+            if (r < 0)
+                r = int(std::upper_bound(ends, ends + nruns, uint16_t(hpos)) - ends);
+            len = std::min<int>(count, ends[r] - hpos);
+            p   = pix[r++];
+        }
+
+        if (n && out[n - 1].pix == p)
+            out[n - 1].len += len;
+        else
+            out[n++] = { uint16_t(len), p };
+
+        hpos   = (hpos + len) & 0xfff;
+        count -= len;
+    }
+    return n;
+}
+
+// Draw one line of road. Each of the 'count' road positions covers 'scale' output pixels.
+void HWRoad::draw_line(uint16_t* pixels, uint32_t control, uint32_t row0, uint32_t hpos0,
+                       uint32_t row1, uint32_t hpos1, const uint16_t* color_table, int count, int scale) const
+{
+    RoadRun runs0[MAX_RUNS], runs1[MAX_RUNS];
+
+    switch (control)
+    {
+        case 0:
+        case 3:
+        {
+            // a single road
+            const RoadRun*  runs = runs0;
+            const uint16_t* ct   = color_table;
+            int n;
+            if (control == 0)
+                n = line_runs(row0, hpos0, count, runs0);
+            else
+            {
+                n  = line_runs(row1, hpos1, count, runs0);
+                ct = color_table + 0x10;
+            }
+            for (int i = 0; i < n; i++)
+            {
+                const int len = runs[i].len * scale;
+                std::fill_n(pixels, len, ct[runs[i].pix]);
+                pixels += len;
+            }
+            break;
+        }
+
+        case 1:
+        case 2:
+        {
+            // both roads, merging the two sets of runs
+            const int n0 = line_runs(row0, hpos0, count, runs0);
+            const int n1 = line_runs(row1, hpos1, count, runs1);
+            int i = 0, j = 0;
+            int left0 = n0 ? runs0[0].len : 0;
+            int left1 = n1 ? runs1[0].len : 0;
+            while (i < n0 && j < n1)
+            {
+                const int     len = std::min(left0, left1);
+                const uint8_t p0  = runs0[i].pix;
+                const uint8_t p1  = runs1[j].pix;
+
+                const bool road1 = (control == 1) ? priority_lookup[p0][p1] != 0
+                                                  : ((priority_map[1][p0] >> p1) & 1) != 0;
+                const uint16_t c = road1 ? color_table[0x10 + p1] : color_table[0x00 + p0];
+                std::fill_n(pixels, len * scale, c);
+                pixels += len * scale;
+
+                if ((left0 -= len) == 0 && ++i < n0) left0 = runs0[i].len;
+                if ((left1 -= len) == 0 && ++j < n1) left1 = runs1[j].len;
+            }
+            break;
+        }
+    }
 }
 
 // Writes go to RAM, but we read from the RAM Buffer.
@@ -217,16 +371,8 @@ void HWRoad::write32(uint32_t* adr, const uint32_t data)
 */
 uint16_t HWRoad::read_road_control()
 {
-    uint32_t *src = (uint32_t *)ram;
-    uint32_t *dst = (uint32_t *)ramBuff;
-
     // swap the halves of the road RAM
-    for (uint16_t i = 0; i < ROAD_RAM_SIZE/4; i++)
-    {
-        uint32_t temp = *src;
-        *src++ = *dst;
-        *dst++ = temp;
-    }
+    ram.swap();
 
     return 0xffff;
 }
@@ -236,91 +382,113 @@ void HWRoad::write_road_control(const uint8_t road_control)
     this->road_control = road_control;
 }
 
+bool HWRoad::save_state(std::ostream& out) const
+{
+    out.write(reinterpret_cast<const char*>(ram.ram),         ram.BYTES);
+    out.write(reinterpret_cast<const char*>(ram.ready_ram()), ram.BYTES);
+    out.write(reinterpret_cast<const char*>(&road_control),  sizeof(road_control));
+    out.write(reinterpret_cast<const char*>(&color_offset1), sizeof(color_offset1));
+    out.write(reinterpret_cast<const char*>(&color_offset2), sizeof(color_offset2));
+    out.write(reinterpret_cast<const char*>(&color_offset3), sizeof(color_offset3));
+    out.write(reinterpret_cast<const char*>(&x_offset),      sizeof(x_offset));
+    return bool(out);
+}
+
+bool HWRoad::load_state(std::istream& in)
+{
+    in.read(reinterpret_cast<char*>(ram.ram),         ram.BYTES);
+    in.read(reinterpret_cast<char*>(ram.ready_ram()), ram.BYTES);
+    in.read(reinterpret_cast<char*>(&road_control),  sizeof(road_control));
+    in.read(reinterpret_cast<char*>(&color_offset1), sizeof(color_offset1));
+    in.read(reinterpret_cast<char*>(&color_offset2), sizeof(color_offset2));
+    in.read(reinterpret_cast<char*>(&color_offset3), sizeof(color_offset3));
+    in.read(reinterpret_cast<char*>(&x_offset),      sizeof(x_offset));
+    return bool(in);
+}
+
 // ------------------------------------------------------------------------------------------------
 // Road Rendering: Lores Version
 // ------------------------------------------------------------------------------------------------
 
-// Background: Look for solid fill scanlines
-void HWRoad::render_background_lores(uint16_t* pixels)
+// Solid fill colour of a (lores) scanline, or -1 if the line isn't solid filled
+int32_t HWRoad::background_color(int y) const
 {
-    const uint16_t* roadram = ramBuff;
+    const uint16_t* roadram = ram.frame();
+
+    const int data0 = roadram[0x000 + y];
+    const int data1 = roadram[0x100 + y];
+
+    int color = -1;
 
-    for (uint16_t y = 0; y < S16_HEIGHT; y++)
+    // based on the info->control, we can figure out which sky to draw
+    switch (frame_control & 3)
     {
-        const int data0 = roadram[0x000 + y];
-        const int data1 = roadram[0x100 + y];
+        case 0:
+            if (data0 & 0x800)
+                color = data0 & 0x7f;
+            break;
+
+        case 1:
+            if (data0 & 0x800)
+                color = data0 & 0x7f;
+            else if (data1 & 0x800)
+                color = data1 & 0x7f;
+            break;
+
+        case 2:
+            if (data1 & 0x800)
+                color = data1 & 0x7f;
+            else if (data0 & 0x800)
+                color = data0 & 0x7f;
+            break;
+
+        case 3:
+            if (data1 & 0x800)
+                color = data1 & 0x7f;
+            break;
+    }
 
-        int color = -1;
+    return (color != -1) ? int32_t(color | color_offset3) : -1;
+}
 
-        // based on the info->control, we can figure out which sky to draw
-        switch (road_control & 3)
-        {
-            case 0:
-                if (data0 & 0x800)
-                    color = data0 & 0x7f;
-                break;
-
-            case 1:
-                if (data0 & 0x800)
-                    color = data0 & 0x7f;
-                else if (data1 & 0x800)
-                    color = data1 & 0x7f;
-                break;
-
-            case 2:
-                if (data1 & 0x800)
-                    color = data1 & 0x7f;
-                else if (data0 & 0x800)
-                    color = data0 & 0x7f;
-                break;
-
-            case 3:
-                if (data1 & 0x800)
-                    color = data1 & 0x7f;
-                break;
-        }
+// Solid fill colours of every (lores) scanline, for renderers that draw the background
+// together with another layer
+void HWRoad::background_colors(int32_t* colors) const
+{
+    for (int y = 0; y < S16_HEIGHT; y++)
+        colors[y] = background_color(y);
+}
+
+// Background: Look for solid fill scanlines. In hi-res mode each line of road RAM fills a pair of
+// output lines.
+template <bool HIRES>
+void HWRoad::render_background_res(uint16_t* pixels, int y_begin, int y_end)
+{
+    for (int y = y_begin; y < y_end; y += (1 << HIRES))
+    {
+        const int32_t color = background_color(y >> HIRES);
 
         if (color != -1) {
             const std::size_t w = config.s16_width;
-            uint16_t c = static_cast<uint16_t>(color | color_offset3);
+            uint16_t c = static_cast<uint16_t>(color);
             uint16_t* pPixel = pixels + (y * w);
             uint32_t* out32 = reinterpret_cast<uint32_t*>(pPixel); // enable writing as 32-bit values
-            // Fill both y and y+1 scanlines with final_color
-            // Total pixels to fill: width * 2 pixels = 2 lines
-            std::fill_n(out32, w >> 1, static_cast<uint32_t>(c << 16) | c);
+            // (1 << HIRES) lines of w pixels, two at a time
+            std::fill_n(out32, (w << HIRES) >> 1, static_cast<uint32_t>(c << 16) | c);
         }
     }
 }
 
 
 // Foreground: Render From ROM
-void HWRoad::render_foreground_lores(uint16_t* pixels)
+void HWRoad::render_foreground_lores(uint16_t* pixels, int y_begin, int y_end)
 {
-    uint16_t* roadram = ramBuff;
+    const uint16_t* roadram = ram.frame();
 
-    for (uint16_t y = 0; y < S16_HEIGHT; y++)
+    for (int y = y_begin; y < y_end; y++)
     {
         uint16_t color_table[32];
 
-        static const uint8_t priority_map[2][8] =
-        {
-            { 0x80,0x81,0x81,0x87,0,0,0,0x00 },
-            { 0x81,0x81,0x81,0x8f,0,0,0,0x80 }
-        };
-        // Define a lookup table mapping (pix0, pix1) to color indices
-        // for the hot path
-        static const ALIGN64 uint8_t priority_lookup[8][8] = {
-            // pix1: 0  1  2  3  4  5  6  7
-            {   0,  0,  0,  0,  0,  0,  0, 1 }, // pix0 = 0
-            {   1,  0,  0,  0,  0,  0,  0, 1 }, // pix0 = 1
-            {   1,  0,  0,  0,  0,  0,  0, 1 }, // pix0 = 2
-            {   1,  1,  1,  0,  0,  0,  0, 1 }, // pix0 = 3
-            {   0,  0,  0,  0,  0,  0,  0, 0 }, // pix0 = 4
-            {   0,  0,  0,  0,  0,  0,  0, 0 }, // pix0 = 5
-            {   0,  0,  0,  0,  0,  0,  0, 0 }, // pix0 = 6
-            {   0,  0,  0,  0,  0,  0,  0, 0 }  // pix0 = 7
-        };
-
         const uint32_t data0 = roadram[0x000 + y];
         const uint32_t data1 = roadram[0x100 + y];
 
@@ -330,20 +498,19 @@ void HWRoad::render_foreground_lores(uint16_t* pixels)
 
         uint16_t* pPixel = pixels + (y * config.s16_width);
         uint32_t hpos0, hpos1, color0, color1;
-        uint32_t control = road_control & 3;
+        uint32_t control = frame_control & 3;
 
-        uint8_t *src0, *src1;
         uint32_t bgcolor; // 8 bits
 
         // get road 0 data
-        src0   = ((data0 & 0x800) != 0) ? roads + 256 * 2 * 512 : (roads + (0x000 + ((data0 >> 1) & 0xff)) * 512);
-        hpos0  = roadram[0x200 + (((road_control & 4) != 0) ? y : (data0 & 0x1ff))] & 0xfff;
-        color0 = roadram[0x600 + (((road_control & 4) != 0) ? y : (data0 & 0x1ff))];
+        const uint32_t row0 = ((data0 & 0x800) != 0) ? 256 * 2 : (0x000 + ((data0 >> 1) & 0xff));
+        hpos0  = roadram[0x200 + (((frame_control & 4) != 0) ? y : (data0 & 0x1ff))] & 0xfff;
+        color0 = roadram[0x600 + (((frame_control & 4) != 0) ? y : (data0 & 0x1ff))];
 
         // get road 1 data
-        src1   = ((data1 & 0x800) != 0) ? roads + 256 * 2 * 512 : (roads + (0x100 + ((data1 >> 1) & 0xff)) * 512);
-        hpos1  = roadram[0x400 + (((road_control & 4) != 0) ? (0x100 + y) : (data1 & 0x1ff))] & 0xfff;
-        color1 = roadram[0x600 + (((road_control & 4) != 0) ? (0x100 + y) : (data1 & 0x1ff))];
+        const uint32_t row1 = ((data1 & 0x800) != 0) ? 256 * 2 : (0x100 + ((data1 >> 1) & 0xff));
+        hpos1  = roadram[0x400 + (((frame_control & 4) != 0) ? (0x100 + y) : (data1 & 0x1ff))] & 0xfff;
+        color1 = roadram[0x600 + (((frame_control & 4) != 0) ? (0x100 + y) : (data1 & 0x1ff))];
 
         // determine the 5 colors for road 0
         color_table[0x00] = color_offset1 ^ 0x00 ^ ((color0 >> 0) & 1);
@@ -365,265 +532,32 @@ void HWRoad::render_foreground_lores(uint16_t* pixels)
         uint16_t s16_x = 0x5f8 + config.s16_x_off;
 
         // draw the road
-        switch (control)
-        {
-            case 0: {
-                if (data0 & 0x800)
-                    continue;
-                uint16_t pairs = config.s16_width >> 1;
-                uint32_t h0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
-                uint32_t* out32 = reinterpret_cast<uint32_t*>(pPixel);
-                while (pairs--) {
-                    // pixel 0
-                    unsigned p0 = 3u;
-                    if (h0 < 0x200u) p0 = src0[h0];
-                    uint16_t c0 = color_table[p0];
-                    h0 = (h0 + 1) & 0xfff;
-
-                    // pixel 1
-                    p0 = 3u;
-                    if (h0 < 0x200u) p0 = src0[h0];
-                    uint16_t c1 = color_table[p0];
-                    h0 = (h0 + 1) & 0xfff;
-
-                    // one 32-bit store (c0 low, c1 high; little-endian)
-                    *out32++ = (uint32_t)c0 | ((uint32_t)c1 << 16);
-                }
-                hpos0 = h0;
-                break;
-            }
-
-            case 1: {
-                // hot path
-                uint16_t pairs = config.s16_width >> 1;               // number of 2-pixel pairs
-                uint32_t h0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
-                uint32_t h1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                uint32_t* out32 = reinterpret_cast<uint32_t*>(pPixel);
-
-                while (pairs--) {
-                    unsigned p0 = 3u;
-                    unsigned p1 = 3u;
-                    if (h0 < 0x200u) p0 = src0[h0];
-                    if (h1 < 0x200u) p1 = src1[h1];
-
-                    uint16_t c0;
-                    if (priority_lookup[p0][p1]) {
-                        c0 = color_table[0x10 + p1];
-                    } else {
-                        // this is the hot path, 85% or so, rely on branch prediction to handle it
-                        c0 = color_table[0x00 + p0];
-                    }
-
-                    h0 = (h0 + 1) & 0xfff;
-                    h1 = (h1 + 1) & 0xfff;
-
-                    p0 = 3u;
-                    p1 = 3u;
-                    if (h0 < 0x200u) p0 = src0[h0];
-                    if (h1 < 0x200u) p1 = src1[h1];
-
-                    uint16_t c1;
-                    if (priority_lookup[p0][p1]) {
-                        c1 = color_table[0x10 + p1];
-                    } else {
-                        // this is the hot path, 85% or so, rely on branch prediction to handle it
-                        c1 = color_table[0x00 + p0];
-                    }
-
-                    h0 = (h0 + 1) & 0xfff;
-                    h1 = (h1 + 1) & 0xfff;
-
-                    *out32++ = (uint32_t)c0 | ((uint32_t)c1 << 16);
-                }
-                hpos0 = h0;
-                hpos1 = h1;
-
-                break;
-            }
-
-            case 2: {
-                uint16_t pairs = config.s16_width >> 1;               // number of 2-pixel pairs
-                uint32_t h0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
-                uint32_t h1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                uint32_t* out32 = reinterpret_cast<uint32_t*>(pPixel);
-
-                while (pairs--) {
-                    unsigned p0 = 3u;
-                    unsigned p1 = 3u;
-                    if (h0 < 0x200u) p0 = src0[h0];
-                    if (h1 < 0x200u) p1 = src1[h1];
-
-                    uint16_t c0;
-                    if (((priority_map[1][p0] >> p1) & 1) != 0) {
-                        c0 = color_table[0x10 + p1];
-                    } else {
-                        c0 = color_table[0x00 + p0];
-                    }
-
-                    h0 = (h0 + 1) & 0xfff;
-                    h1 = (h1 + 1) & 0xfff;
-
-                    p0 = 3u;
-                    p1 = 3u;
-                    if (h0 < 0x200u) p0 = src0[h0];
-                    if (h1 < 0x200u) p1 = src1[h1];
-
-                    uint16_t c1;
-                    if (((priority_map[1][p0] >> p1) & 1) != 0) {
-                        c1 = color_table[0x10 + p1];
-                    } else {
-                        c1 = color_table[0x00 + p0];
-                    }
-
-                    h0 = (h0 + 1) & 0xfff;
-                    h1 = (h1 + 1) & 0xfff;
-
-                    *out32++ = (uint32_t)c0 | ((uint32_t)c1 << 16);
-                }
-                hpos0 = h0;
-                hpos1 = h1;
-
-                break;
-            }
-
-            case 3: {
-                if (data1 & 0x800)
-                    continue;
-                uint16_t pairs = config.s16_width >> 1;
-                uint32_t h1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                uint32_t* out32 = reinterpret_cast<uint32_t*>(pPixel);
-                while (pairs--) {
-                    // pixel 0
-                    unsigned p0 = 3u;
-                    if (h1 < 0x200u) p0 = src1[h1];
-                    uint16_t c0 = color_table[0x10 + p0];
-                    h1 = (h1 + 1) & 0xfff;
-
-                    // pixel 1
-                    p0 = 3u;
-                    if (h1 < 0x200u) p0 = src1[h1];
-                    uint16_t c1 = color_table[0x10 + p0];
-                    h1 = (h1 + 1) & 0xfff;
-
-                    // one 32-bit store (c0 low, c1 high; little-endian)
-                    *out32++ = (uint32_t)c0 | ((uint32_t)c1 << 16);
-                }
-                hpos1 = h1;
-                break;
-            }
-        } // end switch
+        if ((control == 0 && (data0 & 0x800)) || (control == 3 && (data1 & 0x800)))
+            continue;
+        draw_line(pPixel, control,
+                  row0, hpos0 - (s16_x + x_offset),
+                  row1, hpos1 - (s16_x + x_offset),
+                  color_table, config.s16_width, 1);
     } // end for
 }
 
-// ------------------------------------------------------------------------------------------------
-// High Resolution (Double Resolution) Road Rendering
-// ------------------------------------------------------------------------------------------------
-void HWRoad::render_background_hires(uint16_t* pixels)
-{
-    int x, y;
-    uint16_t* roadram = ramBuff;
-
-    for (y = 0; y < config.s16_height; y += 2)
-    {
-        int data0 = roadram[0x000 + (y >> 1)];
-        int data1 = roadram[0x100 + (y >> 1)];
-
-        int color = -1;
-
-        // based on the info->control, we can figure out which sky to draw
-        switch (road_control & 3)
-        {
-            case 0:
-                if (data0 & 0x800)
-                    color = data0 & 0x7f;
-                break;
-
-            case 1:
-                if (data0 & 0x800)
-                    color = data0 & 0x7f;
-                else if (data1 & 0x800)
-                    color = data1 & 0x7f;
-                break;
-
-            case 2:
-                if (data1 & 0x800)
-                    color = data1 & 0x7f;
-                else if (data0 & 0x800)
-                    color = data0 & 0x7f;
-                break;
-
-            case 3:
-                if (data1 & 0x800)
-                    color = data1 & 0x7f;
-                break;
-        }
-
-        // fill the scanline with color
-        // JJP - this is in the hot-path, over 5% CPU spent here
-        // Optimise by replacing per-pixel processing with per-two-lines processing
-        // Assumes the memcpy outside the loop is redundant when color = -1
-        /* Original Code: */
-        /* if (color != -1)
-        {
-            uint16_t* pPixel = pixels + (y * config.s16_width);
-            color |= color_offset3;
-            
-            for (x = 0; x < config.s16_width; x++)
-                *(pPixel)++ = color;
-        }
-
-        // Hi-Res Mode: Copy extra line of background
-        memcpy(pixels + ((y+1) * config.s16_width), pixels + (y * config.s16_width), sizeof(uint16_t) * config.s16_width);
-        */
-
-        // Hi-speed version - might leave road with gaps
-        if (color != -1) {
-            uint16_t* pPixel = pixels + (y * config.s16_width);
-            uint32_t* out32 = reinterpret_cast<uint32_t*>(pPixel); // enable writing as 32-bit values
-            uint16_t c = static_cast<uint16_t>(color | color_offset3);
-            // Fill both y and y+1 scanlines with final_color
-            // Total pixels to fill: width * 2 pixels = 2 lines
-            std::fill_n(out32, config.s16_width, static_cast<uint32_t>(c << 16) | c);
-        }
-    }
-}
-
 // ------------------------------------------------------------------------------------------------
 // Render Road Foreground - High Resolution Version
 // Interpolates previous scanline with next.
 // ------------------------------------------------------------------------------------------------
-void HWRoad::render_foreground_hires(uint16_t* pixels)
+void HWRoad::render_foreground_hires(uint16_t* pixels, int y_begin, int y_end)
 {
-    int x, y, yy;
-    uint16_t* roadram = ramBuff;
+    int y, yy;
+    const uint16_t* roadram = ram.frame();
 
     uint16_t color_table[32];
     int32_t color0, color1;
     int32_t bgcolor; // 8 bits
 
-    for (y = 0; y < config.s16_height; y++)
+    for (y = y_begin; y < y_end; y++)
     {
         yy = y >> 1;
 
-        static const uint8_t priority_map[2][8] =
-        {
-            { 0x80,0x81,0x81,0x87,0,0,0,0x00 },
-            { 0x81,0x81,0x81,0x8f,0,0,0,0x80 }
-        };
-        // Define a lookup table mapping (pix0, pix1) to color indices
-        // for the hot path
-        static const ALIGN64 uint8_t priority_lookup[8][8] = {
-            // pix1: 0  1  2  3  4  5  6  7
-            {   0,  0,  0,  0,  0,  0,  0, 1 }, // pix0 = 0
-            {   1,  0,  0,  0,  0,  0,  0, 1 }, // pix0 = 1
-            {   1,  0,  0,  0,  0,  0,  0, 1 }, // pix0 = 2
-            {   1,  1,  1,  0,  0,  0,  0, 1 }, // pix0 = 3
-            {   0,  0,  0,  0,  0,  0,  0, 0 }, // pix0 = 4
-            {   0,  0,  0,  0,  0,  0,  0, 0 }, // pix0 = 5
-            {   0,  0,  0,  0,  0,  0,  0, 0 }, // pix0 = 6
-            {   0,  0,  0,  0,  0,  0,  0, 0 }  // pix0 = 7
-        };
-
         uint32_t data0 = roadram[0x000 + yy];
         uint32_t data1 = roadram[0x100 + yy];
 
@@ -634,13 +568,13 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
             continue;
         }
 
-        uint8_t *src0 = NULL, *src1 = NULL;
+        int32_t row0 = -1, row1 = -1;
 
         // get road 0 data
-        int32_t hpos0  = roadram[0x200 + (((road_control & 4) != 0) ? yy : (data0 & 0x1ff))] & 0xfff;
+        int32_t hpos0  = roadram[0x200 + (((frame_control & 4) != 0) ? yy : (data0 & 0x1ff))] & 0xfff;
 
         // get road 1 data
-        int32_t hpos1  = roadram[0x400 + (((road_control & 4) != 0) ? (0x100 + yy) : (data1 & 0x1ff))] & 0xfff;
+        int32_t hpos1  = roadram[0x400 + (((frame_control & 4) != 0) ? (0x100 + yy) : (data1 & 0x1ff))] & 0xfff;
 
         // ----------------------------------------------------------------------------------------
         // Interpolate Scanlines when in hi-resolution mode.
@@ -650,8 +584,8 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
             uint32_t data0_next = roadram[0x000 + yy + 1];
             uint32_t data1_next = roadram[0x100 + yy + 1];
 
-            int32_t  hpos0_next = roadram[0x200 + (((road_control & 4) != 0) ? yy + 1 : (data0_next & 0x1ff))] & 0xfff;
-            int32_t  hpos1_next = roadram[0x400 + (((road_control & 4) != 0) ? yy + 1 : (data1_next & 0x1ff))] & 0xfff;
+            int32_t  hpos0_next = roadram[0x200 + (((frame_control & 4) != 0) ? yy + 1 : (data0_next & 0x1ff))] & 0xfff;
+            int32_t  hpos1_next = roadram[0x400 + (((frame_control & 4) != 0) ? yy + 1 : (data1_next & 0x1ff))] & 0xfff;
 
             // Interpolate road 1 position
             if (((data0 & 0x800) == 0) && (data0_next & 0x800) == 0)
@@ -659,7 +593,7 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
                 data0      = (data0      >> 1) & 0xFF;
                 data0_next = (data0_next >> 1) & 0xFF;
                 int32_t diff = (data0 + ((data0_next - data0) >> 1)) & 0xFF;
-                src0 = (roads + (0x000 + diff) * 512);
+                row0 = 0x000 + diff;
                 hpos0 = (hpos0 + ((hpos0_next - hpos0) >> 1)) & 0xFFF;
             }
             // Interpolate road 2 source position
@@ -668,7 +602,7 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
                 data1      = (data1      >> 1) & 0xFF;
                 data1_next = (data1_next >> 1) & 0xFF;
                 int32_t diff = (data1 + ((data1_next - data1) >> 1)) & 0xFF;
-                src1 = (roads + (0x100 + diff) * 512);
+                row1 = 0x100 + diff;
                 hpos1 = (hpos1 + ((hpos1_next - hpos1) >> 1)) & 0xFFF;
             }     
         }
@@ -677,8 +611,8 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
         // ----------------------------------------------------------------------------------------
         else
         {            
-            color0 = roadram[0x600 + (((road_control & 4) != 0) ? yy :           (data0 & 0x1ff))];
-            color1 = roadram[0x600 + (((road_control & 4) != 0) ? (0x100 + yy) : (data1 & 0x1ff))];
+            color0 = roadram[0x600 + (((frame_control & 4) != 0) ? yy :           (data0 & 0x1ff))];
+            color1 = roadram[0x600 + (((frame_control & 4) != 0) ? (0x100 + yy) : (data1 & 0x1ff))];
         
             // determine the 5 colors for road 0
             color_table[0x00] = color_offset1 ^ 0x00 ^ ((color0 >> 0) & 1);
@@ -697,94 +631,23 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
             color_table[0x17] = color_offset1 ^ 0x0e ^ ((color1 >> 7) & 1);
         }
 
-        if (src0 == NULL)
-            src0 = ((data0 & 0x800) != 0) ? roads + 256 * 2 * 512 : (roads + (0x000 + ((data0 >> 1) & 0xff)) * 512);
-        if (src1 == NULL)
-            src1 = ((data1 & 0x800) != 0) ? roads + 256 * 2 * 512 : (roads + (0x100 + ((data1 >> 1) & 0xff)) * 512);
+        if (row0 < 0)
+            row0 = ((data0 & 0x800) != 0) ? 256 * 2 : (0x000 + ((data0 >> 1) & 0xff));
+        if (row1 < 0)
+            row1 = ((data1 & 0x800) != 0) ? 256 * 2 : (0x100 + ((data1 >> 1) & 0xff));
 
         // Shift road dependent on whether we are in widescreen mode or not
         uint16_t s16_x = 0x5f8 + config.s16_x_off;
         uint16_t* const pPixel = pixels + (y * config.s16_width);
-        uint16_t* pP;
 
         // draw the road
-        switch (road_control & 3)
-        {
-            case 0:{
-                // infrequently called in Outrun
-                if (data0 & 0x800)
-                    continue;
-                auto thpos0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
-                uint32_t* out32 = reinterpret_cast<uint32_t*>(pPixel);
-                int xmax = config.s16_width >> 1;
-                while (xmax) {
-                    int pix0 = (thpos0 < 0x200) ? src0[thpos0] : 3;
-                    uint16_t c = color_table[0x00 + pix0];
-                    *out32++ = (static_cast<uint32_t>(c) << 16) | c; // write two pixels
-                    thpos0 = (thpos0 + 1) & 0xfff;
-                    xmax--;
-                }
-                break;
-            }
-            case 1: {
-                // JJP - Outrun hot path - optimised via pre-computed
-                // lookup table & unroll to avoid hpos calculation tests
-                auto thpos0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
-                auto thpos1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                uint32_t* out32 = reinterpret_cast<uint32_t*>(pPixel);
-                int xmax = config.s16_width >> 1;
-                while (xmax) {
-                    int pix0 = (thpos0 < 0x200) ? src0[thpos0] : 3;
-                    int pix1 = (thpos1 < 0x200) ? src1[thpos1] : 3;
-                    uint16_t c;
-                    if (priority_lookup[pix0][pix1]) {
-                        c = color_table[0x10 + pix1];
-                    }
-                    else {
-                        // this is the hot path, 85% or so, rely on branch prediction to handle it
-                        c = color_table[0x00 + pix0];
-                    }
-                    *out32++ = (static_cast<uint32_t>(c) << 16) | c; // write two pixels
-                    thpos0 = (thpos0 + 1) & 0xfff;
-                    thpos1 = (thpos1 + 1) & 0xfff;
-                    xmax--;
-                }
-                break;
-            }
-            case 2:
-                // seems to be never taken in Outrun
-                hpos0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
-                hpos1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                for (x = 0; x < config.s16_width; x++) 
-                {
-                    int pix0 = (hpos0 < 0x200) ? src0[hpos0] : 3;
-                    int pix1 = (hpos1 < 0x200) ? src1[hpos1] : 3;
-                    if (((priority_map[1][pix0] >> pix1) & 1) != 0)
-                        pPixel[x] = color_table[0x10 + pix1];
-                    else
-                        pPixel[x] = color_table[0x00 + pix0];
-                    if (x & 1)
-                    {
-                        hpos0 = (hpos0 + 1) & 0xfff;
-                        hpos1 = (hpos1 + 1) & 0xfff;
-                    }
-                }
-                break;
-
-            case 3:
-                // seems to be never taken in Outrun
-                if (data1 & 0x800)
-                    continue;
-                hpos1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                for (x = 0; x < config.s16_width; x++)
-                {
-                    int pix1 = (hpos1 < 0x200) ? src1[hpos1] : 3;
-                    pPixel[x] = color_table[0x10 + pix1];
-                    if (x & 1)
-                        hpos1 = (hpos1 + 1) & 0xfff;
-                }
-                break;
-            } // end switch
+        const uint32_t control = frame_control & 3;
+        if ((control == 0 && (data0 & 0x800)) || (control == 3 && (data1 & 0x800)))
+            continue;
+        draw_line(pPixel, control,
+                  row0, hpos0 - (s16_x + x_offset),
+                  row1, hpos1 - (s16_x + x_offset),
+                  color_table, config.s16_width >> 1, 2);
     } // end for
 }
 
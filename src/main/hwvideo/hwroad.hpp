@@ -1,6 +1,10 @@
 #pragma once
 
 #include "stdint.hpp"
+#include "hwvideo/ramring.hpp"
+#include <cstring>
+#include <iosfwd>
+#include <vector>
 
 class HWRoad
 {
@@ -10,26 +14,42 @@ public:
 
     void init(const uint8_t*, const bool hires);
     inline void write16(uint32_t adr, const uint16_t data) {
-        ram[(adr >> 1) & 0x7FF] = data;
+        ram.ram[(adr >> 1) & 0x7FF] = data;
     };
     inline void write16(uint32_t* adr, const uint16_t data) {
         uint32_t a = *adr;
-        ram[(a >> 1) & 0x7FF] = data;
+        ram.ram[(a >> 1) & 0x7FF] = data;
         *adr += 2;
     };
+    // words of road RAM from byte address adr, in one copy (the range mustn't wrap)
+    inline void write_block(uint32_t adr, const int16_t* src, int words) {
+        std::memcpy(&ram.ram[(adr >> 1) & 0x7FF], src, words * sizeof(uint16_t));
+    };
     inline void write32(uint32_t* adr, const uint32_t data) {
         uint32_t a = (*adr) >> 1;
-        ram[a & 0x7FF] = data >> 16;
-        ram[(a + 1) & 0x7FF] = data & 0xFFFF;
+        ram.ram[a & 0x7FF] = data >> 16;
+        ram.ram[(a + 1) & 0x7FF] = data & 0xFFFF;
         *adr += 4;
     };
     uint16_t read_road_control();
+    // Keep the road RAM being drawn for the whole frame, across a swap (see ramring.hpp), and
+    // the control register it was written with
+    void hold_frame()    { ram.hold(); frame_control = road_control; }
+    void release_frame() { ram.release(); }
     void write_road_control(const uint8_t);
-    void (HWRoad::*render_background)(uint16_t*);
-    void (HWRoad::*render_foreground)(uint16_t*);
+    // Render output lines [y_begin, y_end). In hi-res mode both bounds must be even, as each
+    // pair of lines is built from one line of road RAM.
+    void (HWRoad::*render_background)(uint16_t*, int y_begin, int y_end);
+    void (HWRoad::*render_foreground)(uint16_t*, int y_begin, int y_end);
+    void background_colors(int32_t* colors) const;
+
+    // Road RAM and control registers, for video snapshots (see Video::save_snapshot)
+    bool save_state(std::ostream& out) const;
+    bool load_state(std::istream& in);
   
 private:
     uint8_t road_control;
+    uint8_t frame_control;      // road_control for the frame being drawn
     uint16_t color_offset1;
     uint16_t color_offset2;
     uint16_t color_offset3;
@@ -38,18 +58,31 @@ private:
     static const uint16_t ROAD_RAM_SIZE = 0x1000;
     static const uint16_t rom_size = 0x8000;
 
-    // Decoded road graphics
-    uint8_t roads[0x40200];
+    // Decoded road graphics, as runs of constant pixel value: each road line is a handful of
+    // runs (exterior, stripes, road, centre line), so lines are drawn a run at a time.
+    static const uint32_t ROAD_ROWS  = (256 * 2) + 1;   // both roads, plus the dummy road
+    static const int      MAX_RUNS   = 1024 + 4;        // per output line, worst case
+    struct RoadRun
+    {
+        uint16_t len;
+        uint8_t  pix;
+    };
+    std::vector<uint16_t> run_end;                      // end x (exclusive) of each run
+    std::vector<uint8_t>  run_pix;                      // pixel value of each run
+    uint32_t              run_first[ROAD_ROWS + 1];     // first run of each row
+
+    int  line_runs(uint32_t row, uint32_t hpos, int count, RoadRun* out) const;
+    void draw_line(uint16_t* pixels, uint32_t control, uint32_t row0, uint32_t hpos0,
+                   uint32_t row1, uint32_t hpos1, const uint16_t* color_table, int count, int scale) const;
 
-    // Two halves of RAM
-    uint16_t ram[ROAD_RAM_SIZE / 2];
-    uint16_t ramBuff[ROAD_RAM_SIZE / 2];
+    // Two halves of RAM (see ramring.hpp)
+    RamRing<uint16_t, ROAD_RAM_SIZE / 2> ram;
 
     void decode_road(const uint8_t*);
-    void render_background_lores(uint16_t*);
-    void render_foreground_lores(uint16_t*);
-    void render_background_hires(uint16_t*);
-    void render_foreground_hires(uint16_t*);
+    int32_t background_color(int y) const;
+    template <bool HIRES> void render_background_res(uint16_t*, int, int);
+    void render_foreground_lores(uint16_t*, int, int);
+    void render_foreground_hires(uint16_t*, int, int);
 };
 
 extern HWRoad hwroad;
@@ -1,8 +1,16 @@
 #include "video.hpp"
 #include "hwvideo/hwsprites.hpp"
 #include "globals.hpp"
+#include "jobsystem.hpp"
 #include "frontend/config.hpp"
+#include "utils.hpp"
+#include "sharedgfx.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <istream>
+#include <new>
+#include <ostream>
 
 /***************************************************************************
     Video Emulation: OutRun Sprite Rendering Hardware.
@@ -57,8 +65,38 @@
 // Enable for hardware pixel accuracy, where sprite shadowing delayed by 1 clock cycle (slower)
 #define PIXEL_ACCURACY 0
 
+// Vectorised span rasteriser. Used on SSE2/SSE4.1 (x86) and NEON (ARM) builds; other targets,
+// and PIXEL_ACCURACY mode, use the line kernels below.
+#if PIXEL_ACCURACY
+    #define HWSPRITES_SIMD 0
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define HWSPRITES_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #if defined(__SSE4_1__)
+        #include <smmintrin.h>
+    #endif
+    #define HWSPRITES_SIMD 1
+#else
+    #define HWSPRITES_SIMD 0
+#endif
+
 #include <stdio.h>
 #include <stdint.h>
+#include <iostream>
+#include <fstream>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+#ifdef __linux__
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+#endif
 
 
 #define DEFINE_RW_FUNCS(TYPE, SUFFIX)                                      \
@@ -88,23 +126,87 @@ hwsprites::hwsprites()
 
 hwsprites::~hwsprites()
 {
+    stop_prewarm();
+    release_tables();
 }
 
 
-void hwsprites::init(const uint8_t* src_sprites)
+void hwsprites::init(const uint8_t* src_sprites, const std::string& cache_file)
 {
     reset();
+
+    // Without a ROM (a video restart), the converted sprites, their CRC and the flipped rows
+    // built so far are all kept, none of them depending on the video mode
     if (src_sprites)
     {
-        // Convert S16 tiles to a more useable format
-        const uint8_t *spr = src_sprites;
+        stop_prewarm();
+        release_tables();
+        rom_crc = Utils::crc32(src_sprites, SPRITES_LENGTH * sizeof(uint32_t));
+
+        auto build = [&](Tables* tables) {
+            point_at(tables);
+            convert(src_sprites);
+            clear_tables();
+            if (!cache_file.empty())
+                load_cache(cache_file);
+        };
+
+        if (config.data.shared_gfx)
+        {
+            // The first instance builds the tables; the others take them as they are, with
+            // every row converted so far
+            char name[48];
+            std::snprintf(name, sizeof(name), "cannonball-sprites-%08x-v%u", rom_crc, CACHE_VERSION);
+            bool created = false;
+            void* p = sharedgfx::attach(name, sizeof(Tables), [&](void* data) { build(new (data) Tables); }, &created);
+            if (p)
+            {
+                shared = static_cast<Tables*>(p);
+                point_at(shared);
+                if (!created)
+                    cache_dirty = false;
+                return;
+            }
+        }
+        own.reset(new Tables);
+        build(own.get());
+    }
+}
 
-        for (uint32_t i = 0; i < SPRITES_LENGTH; i++)
+void hwsprites::point_at(Tables* tables)
+{
+    sprites            = tables->sprites;
+    sprites_flipped    = tables->sprites_flipped;
+    sprites_shadowinfo = tables->sprites_shadowinfo;
+    row_state          = tables->row_state;
+    row_lock           = &tables->row_lock;
+}
+
+void hwsprites::release_tables()
+{
+    own.reset();
+    if (shared)
+    {
+        sharedgfx::detach(shared, sizeof(Tables));
+        shared = nullptr;
+    }
+    sprites = sprites_flipped = nullptr;
+    sprites_shadowinfo = nullptr;
+    row_state          = nullptr;
+    row_lock           = nullptr;
+}
+
+// Convert S16 tiles to a more useable format
+void hwsprites::convert(const uint8_t* src_sprites)
+{
+    jobsystem.parallel_for(0, SPRITES_LENGTH, [&](int first, int last) {
+        for (uint32_t i = first; i < uint32_t(last); i++)
         {
-            uint8_t d3 = *spr++;
-            uint8_t d2 = *spr++;
-            uint8_t d1 = *spr++;
-            uint8_t d0 = *spr++;
+            const uint8_t *spr = src_sprites + i * 4;
+            uint8_t d3 = spr[0];
+            uint8_t d2 = spr[1];
+            uint8_t d1 = spr[2];
+            uint8_t d0 = spr[3];
 
             // Forward (just endian swap of bytes, keep pixel order p0..p7)
             sprites[i] = ((uint32_t)d0 << 24) |
@@ -112,19 +214,159 @@ void hwsprites::init(const uint8_t* src_sprites)
                          ((uint32_t)d2 <<  8) |
                          ((uint32_t)d3 <<  0);
         }
+    });
+}
+
+// ------------------------------------------------------------------------------------------------
+// Flipped sprite cache
+//
+// File layout: CacheHeader, sprites_flipped[SPRITES_LENGTH], sprites_shadowinfo[SPRITES_LENGTH],
+// row_state[SPRITES_LENGTH].
+// Stored in native byte order; a file from another machine simply fails the magic check.
+// ------------------------------------------------------------------------------------------------
+
+bool hwsprites::load_cache(const std::string& filename)
+{
+    stop_prewarm();
+
+    const size_t flipped_bytes = sizeof(Tables::sprites_flipped);
+    const size_t shadow_bytes  = sizeof(Tables::sprites_shadowinfo);
+    const size_t state_bytes   = sizeof(Tables::row_state);
+    const size_t file_bytes    = sizeof(CacheHeader) + flipped_bytes + shadow_bytes + state_bytes;
+
+    auto valid = [&](const CacheHeader* h) {
+        return h->magic   == CACHE_MAGIC &&
+               h->version == CACHE_VERSION &&
+               h->rom_crc == rom_crc &&
+               h->hires   == uint32_t(config.video.hires != 0) &&
+               h->length  == SPRITES_LENGTH;
+    };
+
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) != file_bytes)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(nullptr, file_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    const uint8_t* data = static_cast<const uint8_t*>(map);
+    const bool ok = valid(reinterpret_cast<const CacheHeader*>(data));
+    if (ok)
+    {
+        data += sizeof(CacheHeader);
+        std::memcpy(sprites_flipped,    data,                 flipped_bytes);
+        std::memcpy(sprites_shadowinfo, data + flipped_bytes, shadow_bytes);
+        std::memcpy(row_state,          data + flipped_bytes + shadow_bytes, state_bytes);
+    }
+    munmap(map, file_bytes);
+#else
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        return false;
+
+    CacheHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    bool ok = in && valid(&header);
+    if (ok)
+    {
+        in.read(reinterpret_cast<char*>(sprites_flipped),    flipped_bytes);
+        in.read(reinterpret_cast<char*>(sprites_shadowinfo), shadow_bytes);
+        in.read(reinterpret_cast<char*>(row_state),          state_bytes);
+        ok = bool(in);
+        if (!ok)
+            clear_tables();
+    }
+#endif
+
+    if (!ok)
+    {
+        std::cerr << "Sprite cache " << filename << " is out of date; it will be rebuilt." << std::endl;
+        return false;
+    }
+    cache_dirty = false;
+    return true;
+}
+
+bool hwsprites::save_cache(const std::string& filename)
+{
+    stop_prewarm();
+
+    if (!cache_dirty || !rom_crc)
+        return true;
+
+    CacheHeader header;
+    header.magic   = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.rom_crc = rom_crc;
+    header.hires   = uint32_t(config.video.hires != 0);
+    header.length  = SPRITES_LENGTH;
+
+    // write to a temporary file then rename, so an interrupted save can't leave a bad cache
+#ifndef _WIN32
+    const std::string tmp = filename + "." + std::to_string(getpid()) + ".tmp"; // instances may share the cache
+#else
+    const std::string tmp = filename + ".tmp";
+#endif
+    {
+        // shared tables may be having rows converted by other instances as they are written
+        if (shared)
+            while (row_lock->test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header),             sizeof(header));
+        out.write(reinterpret_cast<const char*>(sprites_flipped),     sizeof(Tables::sprites_flipped));
+        out.write(reinterpret_cast<const char*>(sprites_shadowinfo),  sizeof(Tables::sprites_shadowinfo));
+        out.write(reinterpret_cast<const char*>(row_state),           sizeof(Tables::row_state));
+        out.close();
+        if (shared)
+            row_lock->clear(std::memory_order_release);
+        if (!out)
+        {
+            std::cerr << "Unable to write sprite cache " << tmp << std::endl;
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+    std::remove(filename.c_str());
+    if (std::rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        std::cerr << "Unable to write sprite cache " << filename << std::endl;
+        return false;
     }
-//    read_bytes_u32("sprites_flipped.bin", sprites_flipped, SPRITES_LENGTH);
-//    read_bytes_u8("sprites_shadows.bin", sprites_shadows, SPRITES_LENGTH);
+    cache_dirty = false;
+    return true;
 }
 
 
 void hwsprites::reset()
 {
     // Clear Sprite RAM buffers
-    std::fill_n(ram,                 std::size(ram),                0x0);
-    std::fill_n(ramBuff,             std::size(ramBuff),            0x0);
-    std::fill_n(sprites_flipped,     std::size(sprites_flipped),    0xffffffff);
-    std::fill_n(sprites_shadowinfo,  std::size(sprites_shadowinfo), 0xff);
+    ram.clear();
+    list.clear();
+}
+
+// Forget the flipped rows, which are then built again as needed
+void hwsprites::clear_tables()
+{
+    stop_prewarm();
+    std::fill_n(sprites_flipped,     SPRITES_LENGTH, 0xffffffff);
+    std::fill_n(sprites_shadowinfo,  SPRITES_LENGTH, 0xff);
+    std::fill_n(row_state,           SPRITES_LENGTH, ROW_FREE);
+    for (SpanState& st : span_state)
+    {
+        st.row_key      = 0;
+        st.pending_rows = 0;
+    }
 }
 
 // Clip areas of the screen in wide-screen mode
@@ -133,20 +375,20 @@ void hwsprites::set_x_clip(bool on)
     // Clip to central 320 width window.
     if (on)
     {
-        x1 = config.s16_x_off;
-        x2 = x1 + S16_WIDTH;
+        clip_x1 = config.s16_x_off;
+        clip_x2 = clip_x1 + S16_WIDTH;
 
         if (config.video.hires)
         {
-            x1 <<= 1;
-            x2 <<= 1;
+            clip_x1 <<= 1;
+            clip_x2 <<= 1;
         }
     }
     // Allow full wide-screen.
     else
     {
-        x1 = 0;
-        x2 = config.s16_width;
+        clip_x1 = 0;
+        clip_x2 = config.s16_width;
     }
 }
 
@@ -154,831 +396,725 @@ uint8_t hwsprites::read(const uint16_t adr)
 {
     uint16_t a = adr >> 1;
     if ((adr & 1) == 1)
-        return ram[a] & 0xff;
+        return ram.ram[a] & 0xff;
     else
-        return ram[a] >> 8;
+        return ram.ram[a] >> 8;
 }
 
 void hwsprites::write(const uint16_t adr, const uint16_t data)
 {
-    ram[adr >> 1] = data;
+    ram.ram[adr >> 1] = data;
 }
 
-// Copy back buffer to main ram, ready for blit
+// Swap the halves of sprite RAM, ready for blit
 void hwsprites::swap()
 {
-    uint16_t *src = (uint16_t *)ram;
-    uint16_t *dst = (uint16_t *)ramBuff;
+    ram.swap();
+    list.swap();
 
-    // swap the halves of the road RAM
-    for (uint16_t i = 0; i < SPRITE_RAM_SIZE; i++)
+    // new frame; start the zoom-step cache afresh
+    clear_zoom_steps();
+}
+
+void hwsprites::clear_zoom_steps()
+{
+    for (SpanState& st : span_state)
     {
-        uint16_t temp = *src;
-        *src++ = *dst;
-        *dst++ = temp;
+        std::memset(st.zoom_slot, 0, sizeof(st.zoom_slot));
+        st.zoom_used = 0;
+        st.zoom_next = 0;
     }
 }
 
-#if PIXEL_ACCURACY
+bool hwsprites::save_state(std::ostream& out) const
+{
+    out.write(reinterpret_cast<const char*>(ram.ram),         ram.BYTES);
+    out.write(reinterpret_cast<const char*>(ram.ready_ram()), ram.BYTES);
+    return bool(out);
+}
 
-// Reproduces glowy edge around sprites on top of shadows as seen on Hardware.
-// Believed to be caused by shadowing being out by one clock cycle / pixel.
+bool hwsprites::load_state(std::istream& in)
+{
+    in.read(reinterpret_cast<char*>(ram.ram),         ram.BYTES);
+    in.read(reinterpret_cast<char*>(ram.ready_ram()), ram.BYTES);
+    build_list(ram.ram,         *list.ram);
+    build_list(ram.ready_ram(), *list.ready_ram());
+    clear_zoom_steps();
+    return bool(in);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Line kernels
+//
+// Each draws one sprite line to ROWS output rows (1-3), stepping through the line's pixels with
+// the xacc zoom accumulator:
+// - CLIP tests each pixel against the x1-x2 window; without it the line is known to be on screen
+// - SHADOW treats pixel 0xa as shadow, setting the shadow bit rather than drawing a colour
+// - ACCURATE (PIXEL_ACCURACY) reproduces the glowy edge around sprites on top of shadows as seen
+//   on hardware, believed to be caused by shadowing being out by one clock cycle / pixel:
+//
+//   1/ Sprites Drawn on top of Shadow clears the shadow flags for its opaque pixels.
+//   2/ Either the flag clear or the sprite itself is offset by one pixel horizontally.
 //
-// 1/ Sprites Drawn on top of Shadow clears the shadow flags for its opaque pixels.
-// 2/ Either the flag clear or the sprite itself is offset by one pixel horizontally.
+//   Thanks to Alex B. for this implementation.
 //
-// Thanks to Alex B. for this implementation.
-
-#define draw_pixel()                                                                                  \
-{                                                                                                     \
-    if (x >= x1 && x < x2)                                                                            \
-    {                                                                                                 \
-        if (shadow && pix == 0xa)                                                                     \
-        {                                                                                             \
-            pPixel[x] &= 0xfff;                                                                       \
-            pPixel[x] += S16_PALETTE_ENTRIES;                                                         \
-        }                                                                                             \
-        else if (pix != 0 && pix != 15)                                                               \
-        {                                                                                             \
-            if (x > x1) pPixel[x-1] &= 0xfff;                                                         \
-            pPixel[x] = (pix | color);                                                                \
-        }                                                                                             \
-    }                                                                                                 \
+// Every combination is instantiated into line_kernels, indexed the same way as the jump_key
+// computed in draw_sprite().
+// ------------------------------------------------------------------------------------------------
+
+// 0 and 15 are transparent
+static inline bool is_opaque(uint32_t pix)
+{
+    return (pix - 1u) < 14u;
 }
 
-#else
+// Draw one source pixel for as many output pixels as the zoom gives it
+template <int ROWS, bool CLIP, bool SHADOW, bool ACCURATE>
+static inline void draw_pixel(uint16_t*& pPix, int32_t& x, int32_t& xacc, const uint32_t pix,
+                              const int row_pitch, const int32_t zoom, const int32_t color,
+                              const int32_t x1, const unsigned span)
+{
+    while (xacc < 0x200)
+    {
+        if (is_opaque(pix) && (!CLIP || (unsigned)(x - x1) < span))
+        {
+            for (int r = 0; r < ROWS; r++)
+            {
+                uint16_t* out = pPix + (r * row_pitch);
+                if (SHADOW && pix == 0xa)
+                    *out = ACCURATE ? uint16_t((*out & 0xfff) + S16_PALETTE_ENTRIES)
+                                    : uint16_t(*out | S16_PALETTE_ENTRIES);
+                else
+                {
+                    if (ACCURATE && x > x1) out[-1] &= 0xfff;
+                    *out = uint16_t(pix | color);
+                }
+            }
+        }
+        pPix++;
+        if (CLIP || ACCURATE) x++;
+        xacc += zoom;
+    }
+    xacc -= 0x200;
+}
 
-// MACROS WITH SHADOW SUPPORT
-
-#define IF_IS_DRAWABLE_()        if (x >= x1 && x < x2 && pix != 0 && pix != 15)
-#define IF_IS_DRAWABLE()         if (((unsigned)(pix - 1u) < 14u) && ((unsigned)(x - x1) < span))
-#define IS_DRAWABLE()               (((unsigned)(pix - 1u) < 14u) && ((unsigned)(x - x1) < span))
-#define IF_IS_DRAWABLE_NO_CLIP() if  ((unsigned)(pix - 1u) < 14u)
-#define IS_DRAWABLE_NO_CLIP()        ((unsigned)(pix - 1u) < 14u)
-
-#define draw_pixel_1row()                                       \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE() {                                      \
-            if (pix == 0xa) {                                   \
-                *pPix1 |= S16_PALETTE_ENTRIES;                  \
-            } else {                                            \
-                *pPix1 = (pix | color);                         \
-            }                                                   \
-        }                                                       \
-        pPix1++;                                                \
-        x++; xacc += zoom;                                      \
-    }                                                           \
-    xacc -= 0x200;                                              \
-}
-
-#define draw_pixel_2row()                                       \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE() {                                      \
-            if (pix == 0xa) {                                   \
-                *pPix1 |= S16_PALETTE_ENTRIES;                  \
-                *pPix2 |= S16_PALETTE_ENTRIES;                  \
-            } else {                                            \
-                *pPix1 = (pix | color);                         \
-                *pPix2 = (pix | color);                         \
-            }                                                   \
-        }                                                       \
-        pPix1++; pPix2++;                                       \
-        x++; xacc += zoom;                                      \
-    }                                                           \
-    xacc -= 0x200;                                              \
-}
-
-#define draw_pixel_3row()                                       \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE() {                                      \
-            if (pix == 0xa) {                                   \
-                *pPix1 |= S16_PALETTE_ENTRIES;                  \
-                *pPix2 |= S16_PALETTE_ENTRIES;                  \
-                *pPix3 |= S16_PALETTE_ENTRIES;                  \
-            } else {                                            \
-                *pPix1 = (pix | color);                         \
-                *pPix2 = (pix | color);                         \
-                *pPix3 = (pix | color);                         \
-            }                                                   \
-        }                                                       \
-        pPix1++; pPix2++; pPix3++;                              \
-        x++; xacc += zoom;                                      \
-    }                                                           \
-    xacc -= 0x200;                                              \
-}
-
-#define draw_pixel_1row_nc()                                    \
-{                                                               \
-int i = 0;\
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE_NO_CLIP() {                              \
-i++;\
-            if (pix == 0xa) {                                   \
-                *pPix1 |= S16_PALETTE_ENTRIES;                  \
-            } else {                                            \
-                *pPix1 = (pix | color);                         \
-            }                                                   \
-        }                                                       \
-        pPix1++;                                                \
-        xacc += zoom;                                           \
-    }                                                           \
-    xacc -= 0x200;                                              \
-reps[i]++;\
-}
-
-#define draw_pixel_2row_nc()                                    \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE_NO_CLIP() {                              \
-            if (pix == 0xa) {                                   \
-                *pPix1 |= S16_PALETTE_ENTRIES;                  \
-                *pPix2 |= S16_PALETTE_ENTRIES;                  \
-            } else {                                            \
-                *pPix1 = (pix | color);                         \
-                *pPix2 = (pix | color);                         \
-            }                                                   \
-        }                                                       \
-        pPix1++; pPix2++;                                       \
-        xacc += zoom;                                           \
-    }                                                           \
-    xacc -= 0x200;                                              \
-}
-
-#define draw_pixel_3row_nc()                                    \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE_NO_CLIP() {                              \
-            if (pix == 0xa) {                                   \
-                *pPix1 |= S16_PALETTE_ENTRIES;                  \
-                *pPix2 |= S16_PALETTE_ENTRIES;                  \
-                *pPix3 |= S16_PALETTE_ENTRIES;                  \
-            } else {                                            \
-                *pPix1 = (pix | color);                         \
-                *pPix2 = (pix | color);                         \
-                *pPix3 = (pix | color);                         \
-            }                                                   \
-        }                                                       \
-        pPix1++; pPix2++; pPix3++;                              \
-        xacc += zoom;                                           \
-    }                                                           \
-    xacc -= 0x200;                                              \
-}
-
-// MACROS WITHOUT SHADOW SUPPORT
-
-#define draw_pixel_1row_ns()                                    \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE() {                                      \
-            *pPix1 = (pix | color);                             \
-        }                                                       \
-        pPix1++;                                                \
-        x++; xacc += zoom;                                      \
-    }                                                           \
-    xacc -= 0x200;                                              \
-}
-
-#define draw_pixel_2row_ns()                                    \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE() {                                      \
-            *pPix1 = (pix | color);                             \
-            *pPix2 = (pix | color);                             \
-        }                                                       \
-        pPix1++; pPix2++;                                       \
-        x++; xacc += zoom;                                      \
-    }                                                           \
-    xacc -= 0x200;                                              \
-}
-
-#define draw_pixel_3row_ns()                                    \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE() {                                      \
-            *pPix1 = (pix | color);                             \
-            *pPix2 = (pix | color);                             \
-            *pPix3 = (pix | color);                             \
-        }                                                       \
-        pPix1++; pPix2++; pPix3++;                              \
-        x++; xacc += zoom;                                      \
-    }                                                           \
-    xacc -= 0x200;                                              \
-}
-
-#define draw_pixel_1row_nc_ns()                                 \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE_NO_CLIP() {                              \
-            *pPix1 = (pix | color);                             \
-        }                                                       \
-        pPix1++;                                                \
-        xacc += zoom;                                           \
-    }                                                           \
-    xacc -= 0x200;                                              \
-}
-
-#define draw_pixel_2row_nc_ns()                                 \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE_NO_CLIP() {                              \
-            *pPix1 = (pix | color);                             \
-            *pPix2 = (pix | color);                             \
-        }                                                       \
-        pPix1++; pPix2++;                                       \
-        xacc += zoom;                                           \
-    }                                                           \
-    xacc -= 0x200;                                              \
-}
-
-#define draw_pixel_3row_nc_ns()                                 \
-{                                                               \
-    while (xacc < 0x200) {                                      \
-        IF_IS_DRAWABLE_NO_CLIP() {                              \
-            *pPix1 = (pix | color);                             \
-            *pPix2 = (pix | color);                             \
-            *pPix3 = (pix | color);                             \
-        }                                                       \
-        pPix1++; pPix2++; pPix3++;                              \
-        xacc += zoom;                                           \
-    }                                                           \
-    xacc -= 0x200;                                              \
+template <int ROWS, bool CLIP, bool SHADOW, bool ACCURATE>
+static void draw_line(uint16_t* pPix, const int row_pitch, const uint32_t* data, const int32_t xpos,
+                      const int32_t zoom, const int32_t color, const int32_t x1, const unsigned span,
+                      const int32_t scrn_width)
+{
+    int32_t x = xpos, xacc = 0;
+    uint32_t pixels;
+    do
+    {
+        if (CLIP && x >= scrn_width)
+            break;
+        pixels = *data++;
+        // draw eight pixels
+        draw_pixel<ROWS, CLIP, SHADOW, ACCURATE>(pPix, x, xacc, (pixels >> 28) & 0xf, row_pitch, zoom, color, x1, span);
+        draw_pixel<ROWS, CLIP, SHADOW, ACCURATE>(pPix, x, xacc, (pixels >> 24) & 0xf, row_pitch, zoom, color, x1, span);
+        draw_pixel<ROWS, CLIP, SHADOW, ACCURATE>(pPix, x, xacc, (pixels >> 20) & 0xf, row_pitch, zoom, color, x1, span);
+        draw_pixel<ROWS, CLIP, SHADOW, ACCURATE>(pPix, x, xacc, (pixels >> 16) & 0xf, row_pitch, zoom, color, x1, span);
+        draw_pixel<ROWS, CLIP, SHADOW, ACCURATE>(pPix, x, xacc, (pixels >> 12) & 0xf, row_pitch, zoom, color, x1, span);
+        draw_pixel<ROWS, CLIP, SHADOW, ACCURATE>(pPix, x, xacc, (pixels >>  8) & 0xf, row_pitch, zoom, color, x1, span);
+        draw_pixel<ROWS, CLIP, SHADOW, ACCURATE>(pPix, x, xacc, (pixels >>  4) & 0xf, row_pitch, zoom, color, x1, span);
+        draw_pixel<ROWS, CLIP, SHADOW, ACCURATE>(pPix, x, xacc, (pixels >>  0) & 0xf, row_pitch, zoom, color, x1, span);
+        // stop if the second-to-last pixel in the group was 0xf
+    } while ((pixels & 0x000000f0) != 0x000000f0);
 }
 
-#endif
+typedef void (*LineKernel)(uint16_t*, int, const uint32_t*, int32_t, int32_t, int32_t, int32_t, unsigned, int32_t);
+
+static const bool ACCURATE = PIXEL_ACCURACY != 0;
 
+// jump_key: rows - 1 (bits 0-1, 4 rows unused), unclipped (bit 2), shadows (bit 3)
+static const LineKernel line_kernels[16] =
+{
+    draw_line<1, true,  false, ACCURATE>, draw_line<2, true,  false, ACCURATE>, draw_line<3, true,  false, ACCURATE>, nullptr,
+    draw_line<1, false, false, ACCURATE>, draw_line<2, false, false, ACCURATE>, draw_line<3, false, false, ACCURATE>, nullptr,
+    draw_line<1, true,  true,  ACCURATE>, draw_line<2, true,  true,  ACCURATE>, draw_line<3, true,  true,  ACCURATE>, nullptr,
+    draw_line<1, false, true,  ACCURATE>, draw_line<2, false, true,  ACCURATE>, draw_line<3, false, true,  ACCURATE>, nullptr,
+};
 
 
-void hwsprites::render(uint16_t* pixels, const uint8_t priority)
+// ------------------------------------------------------------------------------------------------
+// Flipped row conversion
+//
+// Each sprite row is converted once: the flipped copy is written to sprites_flipped and a flag
+// noting whether it contains shadow pixels to sprites_shadowinfo. Rows are converted either by
+// render() on first use, or ahead of time by the prewarm thread.
+//
+// The two writers are serialised by row_lock, which is only ever held for the conversion of a
+// single row (at most MAX_PITCH words). render() checks row_state without the lock, so never
+// waits on the prewarm pass - at worst it waits for the one row the thread is converting.
+//
+// The game can address the same words as rows of different pitches, and converting one rewrites
+// the words of any other it overlaps. That is only done whilst no other row can be in use: when
+// the frame is drawn in one pass, or by settle_rows() before the bands of a frame start. Whilst
+// the bands are drawn, a row that would overlap another is converted into the band's own
+// SpanState::row and drawn from there, and is converted in the tables before the next frame.
+// ------------------------------------------------------------------------------------------------
+
+// Flip the row of 'pitch' words at src into dst, returning its sprites_shadowinfo entry
+static uint8_t flip_row(const uint32_t* src, uint32_t* dst, int pitch)
 {
-    static uint32_t reps[6] = {0,0,0,0,0,0};
+    uint32_t* writeaddr    = dst + pitch;
+    uint8_t   shadow_found = 0;
+    for (int x = 0; x < pitch; x++)
+    {
+        uint32_t pixels = *src++;
+        uint8_t  px[8];
+        // check for shadows
+        uint32_t pxt = pixels ^ 0xAAAAAAAAu;
+        if (((pxt - 0x11111111u) & ~pxt & 0x88888888u) != 0)
+            shadow_found = 0x11;
+        // process eight pixels
+        px[0] = (pixels >> 28) & 0xf;
+        px[1] = (pixels >> 24) & 0xf;
+        px[2] = (pixels >> 20) & 0xf;
+        px[3] = (pixels >> 16) & 0xf;
+        px[4] = (pixels >> 12) & 0xf;
+        px[5] = (pixels >>  8) & 0xf;
+        px[6] = (pixels >>  4) & 0xf;
+        px[7] = (pixels >>  0) & 0xf;
+
+        *--writeaddr =
+            (px[0] <<  0) |
+            (px[1] <<  4) |
+            (px[2] <<  8) |
+            (px[3] << 12) |
+            (px[4] << 16) |
+            (px[5] << 20) |
+            (px[6] << 24) |
+            (px[7] << 28);
+    }
+    return shadow_found;
+}
 
-    static uint32_t freq[32];
-    const uint32_t numbanks = SPRITES_LENGTH / 0x10000;
+// Convert the row at 'start' if it hasn't been converted for this pitch. Returns false if it is
+// to be drawn from st.row this time, as converting it in the tables would rewrite a row in use.
+inline bool hwsprites::prepare_row(uint32_t start, int pitch, SpanState& st)
+{
+    auto converted = [&] {
+        return std::atomic_ref<uint16_t>(row_state[start]).load(std::memory_order_acquire) == pitch + 1;
+    };
+    if (pitch <= 0 || start + pitch > SPRITES_LENGTH || converted())
+        return true;
+    if (convert_row(start, pitch, !rows_fixed && !shared))
+    {
+        cache_dirty = true;
+        return true;
+    }
+    if (converted())
+        return true;    // by another band meanwhile
 
-    for (uint16_t data = 0; data < SPRITE_RAM_SIZE; data += 16) // was +=8
+    const uint32_t key = start | uint32_t(pitch) << 24;
+    if (st.row_key != key)
     {
-        auto start = std::chrono::high_resolution_clock::now();
-        // stop when we hit the end of sprite list
-        if ((ramBuff[data+0] & 0x8000) != 0) break;
-
-        uint32_t sprpri  = 1 << ((ramBuff[data+3] >> 12) & 3);
-        if (sprpri != priority) continue;
-
-        // if hidden, or top greater than/equal to bottom, or invalid bank, punt
-        int16_t hide    = (ramBuff[data+0] & 0x5000);
-        int32_t height  = (ramBuff[data+5] >> 8) + 1;
-        if (hide != 0 || height == 0) continue;
-
-        int16_t bank      =  (ramBuff[data+0] >> 9) & 7;
-        int32_t top       =  (ramBuff[data+0] & 0x1ff) - 0x100;
-        bool     clip     =  (ramBuff[data+0] & 0x2000);
-        uint32_t addr     =   ramBuff[data+1];
-        int32_t pitch     = ((ramBuff[data+2] >> 1) | ((ramBuff[data+4] & 0x1000) << 3)) >> 8;
-        uint8_t shadow    =  (ramBuff[data+3] >> 14) & 1;
-//        int32_t  zoom     =   ramBuff[data+3] & 0x7ff;
-        int32_t  zoom     =   ramBuff[data+3] & 0x0fff;
-        int32_t ydelta    = ((ramBuff[data+4] & 0x8000) != 0) ? 1 : -1;
-        int32_t flip      = (~ramBuff[data+4] >> 14) & 1;
-        int32_t xdelta    = ((ramBuff[data+4] & 0x2000) != 0) ? 1 : -1;
-//        int32_t hzoom     =   ramBuff[data+4] & 0x7ff;
-        int32_t width     =   ramBuff[data+4] & 0x7ff;
-        int32_t color     = COLOR_BASE +
-                            ((ramBuff[data+5] & 0x7f) << 4);
-        int32_t sprite_scanlines =
-                            ((ramBuff[data+5] & 0xff00) >> 16) +1;
-        int32_t xpos      =   ramBuff[data+6]; // moved from original structure to accomodate widescreen
-        int32_t rawh      =   ramBuff[data+7]; // JJP - height of sprite in rows
-        int32_t y, ytarget, yacc = 0;
-
-        int16_t offset    =   ramBuff[data+15]; // JJP - provides horizontal offset for hires sprite rendering
-        // adjust X coordinate
-        // note: the threshhold below is a guess. If it is too high, rachero will draw garbage
-        // If it is too low, smgp won't draw the bottom part of the road
-        if (xpos < 0x80 && xdelta < 0)
-            xpos += 0x200;
-        xpos -= 0xbe;
-
- //       // initialize the end address to the start address
- //       ramBuff[data+7] = addr;
-
-        // clamp to within the memory region size
-        if (numbanks)
-            bank %= numbanks;
-
-        const uint32_t* spriterom = sprites + 0x10000 * bank;
-        uint32_t* spriterom_flipped = sprites_flipped + 0x10000 * bank;
-        uint8_t* spriterom_shadowinfo = sprites_shadowinfo + 0x10000 * bank;
-
-        // loop from top to bottom
-        ytarget = top + ydelta * height;
-
-        // Adjust for widescreen mode
-        xpos += config.s16_x_off;
-
-        // Adjust for hi-res mode
-        if (config.video.hires) {
-            xpos <<= 1;
-            top <<= 1;
-            ytarget <<= 1;
-            zoom >>= 1;
+        st.row_shadow = flip_row(sprites + start, st.row, pitch);
+        st.row[pitch] = 0xffffffff;
+        st.row_key    = key;
+        if (!shared && st.pending_rows < PENDING_ROWS)
+            st.pending[st.pending_rows++] = key;
+    }
+    return false;
+}
+
+// Convert the rows the bands of the last frame drew from their own copies
+void hwsprites::settle_rows(bool banded)
+{
+    for (SpanState& st : span_state)
+    {
+        for (int i = 0; i < st.pending_rows; i++)
+        {
+            if (convert_row(st.pending[i] & 0xffffff, int(st.pending[i] >> 24), true))
+                cache_dirty = true;
         }
+        st.pending_rows = 0;
+        st.row_key      = 0;
+    }
+    rows_fixed = banded;
+}
+
+// Convert a row in the tables. Only with 'rewrite' are the words of other rows it overlaps
+// taken over; otherwise it is converted only if none of its words are in use.
+bool hwsprites::convert_row(uint32_t start, int pitch, bool rewrite)
+{
+    auto state = [&](uint32_t i) { return std::atomic_ref<uint16_t>(row_state[i]); };
 
-        // JJP - maintain converted sprites to aid writing them
-        uint32_t sprite_height = 0;
-        // Determine underlying sprite height
-        int32_t steps = ytarget - top;  // true as ydelta is always + or - 1.
-        // Use 64-bit multiply to avoid overflow
-        sprite_height = ((uint64_t)steps * zoom) >> 9;
-
-//std::cout << "\rSprite height: " << height << ", Calculated Height: " << sprite_height << ", raw height: " << rawh << "\n";
-
-/* The above replaces...
-        uint32_t yacc_t = 0;
-        for (int y = top; y != ytarget; y += ydelta) {
-            yacc_t += zoom;
-            sprite_height += (yacc_t >> 9);
-            yacc_t &= 0x1ff;
+    while (row_lock->test_and_set(std::memory_order_acquire))
+        std::this_thread::yield();
+
+    const uint32_t end = start + pitch;
+    if (state(start).load(std::memory_order_relaxed) == pitch + 1)
+    {
+        row_lock->clear(std::memory_order_release);
+        return false;
+    }
+    if (!rewrite)
+    {
+        // the prewarm thread only guesses at row boundaries, and rows in use can't be moved
+        for (uint32_t i = start; i < end; i++)
+        {
+            if (state(i).load(std::memory_order_relaxed) != ROW_FREE)
+            {
+                row_lock->clear(std::memory_order_release);
+                return false;
+            }
         }
-*/
-        static uint32_t converted_sprites = 0;
-        static uint32_t processed_lines = 0;
-
-        if (xdelta == -1) {
-            xdelta = 1;       // always draw left-to-right
-            xpos  -= (width << (config.video.hires ? 1 : 0));   // move draw position left by rendered width
-            if (flip) {
-                flip = 0;
-                addr -= (pitch - 1);
-            } else {
-                flip = 1;
-                addr += (pitch - 1);
+    }
+    else
+    {
+        // the row is about to be rewritten; invalidate any other row it overlaps
+        for (uint32_t i = start; i < end; i++)
+        {
+            uint16_t st = state(i).load(std::memory_order_relaxed);
+            if (st == ROW_FREE || i == start)
+                continue;
+
+            uint32_t owner = i;
+            if (st == ROW_INTERIOR)
+            {
+                // walk back to the start of the row this word belongs to
+                const uint32_t limit = (i > uint32_t(MAX_PITCH)) ? i - MAX_PITCH : 0;
+                while (owner > limit && state(owner).load(std::memory_order_relaxed) == ROW_INTERIOR)
+                    owner--;
+                st = state(owner).load(std::memory_order_relaxed);
+                if (st == ROW_FREE || st == ROW_INTERIOR || owner + st - 1 <= i || owner == start)
+                    continue;
             }
+            state(owner).store(ROW_FREE, std::memory_order_relaxed);
         }
+    }
 
-        uint32_t shadowaddr = addr;
+    sprites_shadowinfo[start] = flip_row(sprites + start, sprites_flipped + start, pitch);
 
-        if (flip) {
-/*
-            converted_sprites++;
-            if (converted_sprites==1024) {
-                write_bytes_u32("sprites_flipped.bin", sprites_flipped, SPRITES_LENGTH);
-                write_bytes_u8("sprites_shadowinfo.bin", sprites_shadowinfo, SPRITES_LENGTH);
-                converted_sprites=0;
-            }
-*/
-            // first encounter of sprite, created flipped entry
-            shadowaddr -= (pitch - 1); // start of data, if unflipped
-
-            for (int y = 0; y < sprite_height; y++) {
-//            for (int y = 0; y < height; y++) {
-                // calculate the addresses for this line
-                uint32_t readaddr     = shadowaddr;
-                uint32_t writeaddr    = shadowaddr + pitch;
-                uint32_t shadow_found = 0;
-                if (spriterom_flipped[readaddr] == 0xffffffff) {
-/*
-processed_lines++;
-std::cout << "\r\t\t\t\t" << processed_lines << " sprite lines flipped";
-*/
-                    // first time we've seen this row
-                    for (int x = 0; x < pitch; x++) {
-                        uint32_t pixels = spriterom[readaddr++];
-                        uint8_t  px[8];
-                        // check for shadows
-                        uint32_t pxt = pixels ^ 0xAAAAAAAAu;
-                        if (((pxt - 0x11111111u) & ~pxt & 0x88888888u) != 0)
-                            shadow_found = 0x11;
-                        // process eight pixels
-                        px[0] = (pixels >> 28) & 0xf;
-                        px[1] = (pixels >> 24) & 0xf;
-                        px[2] = (pixels >> 20) & 0xf;
-                        px[3] = (pixels >> 16) & 0xf;
-                        px[4] = (pixels >> 12) & 0xf;
-                        px[5] = (pixels >>  8) & 0xf;
-                        px[6] = (pixels >>  4) & 0xf;
-                        px[7] = (pixels >>  0) & 0xf;
-
-                        spriterom_flipped[--writeaddr] =
-                            (px[0] <<  0) |
-                            (px[1] <<  4) |
-                            (px[2] <<  8) |
-                            (px[3] << 12) |
-                            (px[4] << 16) |
-                            (px[5] << 20) |
-                            (px[6] << 24) |
-                            (px[7] << 28);
-                    };
-                    spriterom_shadowinfo[shadowaddr] = shadow_found;
-                }
-                shadowaddr += pitch;
-            }
-        } else {
-            // not flipped
-            for (int y = 0; y < sprite_height; y++) {
-                if (spriterom_shadowinfo[shadowaddr] == 0xff) {
-                    // first time seeing this sprite line
-                    uint32_t readaddr = shadowaddr;
-                    uint32_t shadow_found = 0;
-                    for (int i = 0; i < pitch; ++i) {
-                        uint32_t pixels = spriterom[readaddr++];
-                        // check for shadows
-                        uint32_t pxt = pixels ^ 0xAAAAAAAAu;
-                        if (((pxt - 0x11111111u) & ~pxt & 0x88888888u) != 0) {
-                            shadow_found = 0x11;
-                            break;
-                        }
-                    }
-                    spriterom_shadowinfo[shadowaddr] = shadow_found;
-                }
-                shadowaddr += pitch;
-            }
+    for (uint32_t i = start + 1; i < end; i++)
+        state(i).store(ROW_INTERIOR, std::memory_order_relaxed);
+    state(start).store(uint16_t(pitch + 1), std::memory_order_release);
+
+    row_lock->clear(std::memory_order_release);
+    return true;
+}
+
+// Background conversion of every row in the sprite ROM. Rows are found from the edge markers
+// the renderer relies on: the row starts at a word whose second pixel is 0xf (where flipped
+// drawing stops), and ends at the next word whose seventh pixel is 0xf (where forward drawing
+// stops). Rows the game addresses differently are simply converted on first use as before.
+void hwsprites::prewarm()
+{
+#ifdef __linux__
+    setpriority(PRIO_PROCESS, pid_t(syscall(SYS_gettid)), 19);
+#endif
+
+    uint32_t converted = 0;
+    uint32_t i = 0;
+    while (i < SPRITES_LENGTH && !prewarm_stop.load(std::memory_order_relaxed))
+    {
+        if (((sprites[i] >> 24) & 0xf) != 0xf)
+        {
+            i++;
+            continue;
         }
 
-        // adjust x-position with pre-determined offset for hi-res sprite rendering
-        if (config.video.hiresprites == 1)
-            xpos += offset;
+        uint32_t end = i;
+        while (end < SPRITES_LENGTH && end - i < uint32_t(MAX_PITCH) && (sprites[end] & 0xf0) != 0xf0)
+            end++;
+        if (end == SPRITES_LENGTH || end - i == uint32_t(MAX_PITCH))
+        {
+            i++;
+            continue;
+        }
 
-        // choose which ROM to read from - flipped or non-flipped
-        const uint32_t* spritedata;
-        if (flip) {
-            addr = addr - pitch + 1; // set pointer to start of sprite row
-            spritedata = &spriterom_flipped[0];
-        } else {
-            spritedata = &spriterom[0];
+        if (convert_row(i, end - i + 1, false))
+            converted++;
+        i = end + 1;
+    }
+
+    if (converted)
+        cache_dirty = true;
+}
+
+void hwsprites::start_prewarm()
+{
+    stop_prewarm();
+    prewarm_stop.store(false, std::memory_order_relaxed);
+    prewarm_thread = std::thread(&hwsprites::prewarm, this);
+}
+
+void hwsprites::stop_prewarm()
+{
+    if (!prewarm_thread.joinable())
+        return;
+    prewarm_stop.store(true, std::memory_order_relaxed);
+    prewarm_thread.join();
+}
+
+// ------------------------------------------------------------------------------------------------
+// Span rasteriser
+//
+// Equivalent to the line kernels above, but for a whole sprite line at a time:
+// 1. the line's packed pixels are unpacked up to the end-of-line marker
+// 2. each output pixel takes the source pixel given by the zoomed index sequence (xacc)
+// 3. the zoomed line is blended into each output row: 0 and 15 are transparent, and 0xa
+//    sets the shadow bit when the line contains shadows.
+// ------------------------------------------------------------------------------------------------
+
+static inline void span_blend_scalar(uint16_t* dst, const uint8_t* px, int len, uint16_t color, bool shadow)
+{
+    for (int k = 0; k < len; k++)
+    {
+        const uint32_t pix = px[k];
+        if (is_opaque(pix))
+        {
+            if (shadow && pix == 0xa)
+                dst[k] |= S16_PALETTE_ENTRIES;
+            else
+                dst[k] = (pix | color);
         }
+    }
+}
+
+#if HWSPRITES_SIMD
+static inline void span_blend(uint16_t* dst, const uint8_t* px, int len, uint16_t color, bool shadow)
+{
+    int k = 0;
 
-        const uint16_t scrn_width = config.s16_width;
-        const unsigned span = (unsigned)(x2 - x1);
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint16x8_t v_color  = vdupq_n_u16(color);
+    const uint16x8_t v_shbit  = vdupq_n_u16(S16_PALETTE_ENTRIES);
+    const uint16x8_t v_zero   = vdupq_n_u16(0);
+    const uint16x8_t v_f      = vdupq_n_u16(0xf);
+    const uint16x8_t v_a      = vdupq_n_u16(0xa);
+    const uint16x8_t v_shmask = vdupq_n_u16(shadow ? 0xffff : 0);
 
-//        setup += std::chrono::high_resolution_clock::now() - start;
-//        start = std::chrono::high_resolution_clock::now();
-        uint32_t jump_key = 3;
-        // drawing loop
-        for (y = top; y != ytarget; y += ydelta)
+    for (; k + 8 <= len; k += 8)
+    {
+        const uint16x8_t p = vmovl_u8(vld1_u8(px + k));
+        const uint16x8_t d = vld1q_u16(dst + k);
+
+        // opaque: not 0 and not 15
+        const uint16x8_t opaque = vmvnq_u16(vorrq_u16(vceqq_u16(p, v_zero), vceqq_u16(p, v_f)));
+        const uint16x8_t shad   = vandq_u16(vceqq_u16(p, v_a), v_shmask);
+
+        uint16x8_t out = vbslq_u16(opaque, vorrq_u16(p, v_color), d);
+        out = vbslq_u16(shad, vorrq_u16(d, v_shbit), out);
+        vst1q_u16(dst + k, out);
+    }
+#else
+    const __m128i v_color  = _mm_set1_epi16((short)color);
+    const __m128i v_shbit  = _mm_set1_epi16((short)S16_PALETTE_ENTRIES);
+    const __m128i v_zero   = _mm_setzero_si128();
+    const __m128i v_f      = _mm_set1_epi16(0xf);
+    const __m128i v_a      = _mm_set1_epi16(0xa);
+    const __m128i v_shmask = _mm_set1_epi16(shadow ? (short)0xffff : 0);
+
+    for (; k + 8 <= len; k += 8)
+    {
+        const __m128i p = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(px + k)), v_zero);
+        const __m128i d = _mm_loadu_si128((const __m128i*)(dst + k));
+
+        // transparent: 0 or 15
+        const __m128i clear = _mm_or_si128(_mm_cmpeq_epi16(p, v_zero), _mm_cmpeq_epi16(p, v_f));
+        const __m128i shad  = _mm_and_si128(_mm_cmpeq_epi16(p, v_a), v_shmask);
+        const __m128i pix   = _mm_or_si128(p, v_color);
+        const __m128i dsh   = _mm_or_si128(d, v_shbit);
+
+    #if defined(__SSE4_1__)
+        __m128i out = _mm_blendv_epi8(pix, d, clear);
+        out = _mm_blendv_epi8(out, dsh, shad);
+    #else
+        __m128i out = _mm_or_si128(_mm_and_si128(clear, d), _mm_andnot_si128(clear, pix));
+        out = _mm_or_si128(_mm_and_si128(shad, dsh), _mm_andnot_si128(shad, out));
+    #endif
+        _mm_storeu_si128((__m128i*)(dst + k), out);
+    }
+#endif
+
+    span_blend_scalar(dst + k, px + k, len - k, color, shadow);
+}
+#endif
+
+// Find (or start) the zoomed source-index sequence for this zoom value.
+hwsprites::ZoomSteps* hwsprites::find_zoom_steps(SpanState& st, int32_t zoom)
+{
+    uint8_t& slot = st.zoom_slot[zoom & (ZOOM_VALUES - 1)];
+    if (slot)
+        return &st.zoom_steps[slot - 1];
+
+    int entry;
+    if (st.zoom_used < ZOOM_CACHE_SIZE)
+        entry = st.zoom_used++;
+    else
+    {
+        // cache full; recycle the entries round-robin
+        entry = st.zoom_next;
+        st.zoom_next = (st.zoom_next + 1) % ZOOM_CACHE_SIZE;
+        st.zoom_slot[st.zoom_steps[entry].zoom & (ZOOM_VALUES - 1)] = 0;
+    }
+
+    ZoomSteps* steps = &st.zoom_steps[entry];
+    steps->zoom   = zoom;
+    steps->xacc   = 0;
+    steps->n      = 0;
+    steps->len[0] = 0;
+    slot = entry + 1;
+    return steps;
+}
+
+// Extend the zoomed source-index sequence to cover the first n source pixels.
+// Mirrors the xacc accumulator of the line kernels, which restarts at 0 on every line.
+bool hwsprites::extend_span(ZoomSteps* steps, int n)
+{
+    int32_t  xacc = steps->xacc;
+    uint16_t k    = steps->len[steps->n];
+    for (uint16_t i = steps->n; i < n; i++)
+    {
+        while (xacc < 0x200)
         {
-            // skip drawing if not within the cliprect
-            if (y >= 0 && y < config.s16_height)
-            {
-                uint16_t* pPix1 = pixels + ((y+0) * scrn_width) + xpos;
-                uint32_t spriteaddr = addr;
-                int32_t xacc = 0;
-
-                // determine how many rows will be written on this pass
-                uint16_t count = 1;
-                uint32_t frac = yacc + zoom;
-                uint16_t countmax = std::min( (uint16_t)(ytarget - y),
-                                              std::min<uint16_t>(3, config.s16_height - y));
-                while (frac < 0x200 && count < countmax) {
-                    frac += zoom;
-                    count++;
-                }
-                // count now contains a value between 1 and 3.
-                // we can also use (count-1) as the *minimum* number of pixels that will be written out
-                // but each x-pass, since hzoom=vzoom.
+            if (k == SPAN_MAX_OUT)
+                return false; // leaves the sequence as it was, covering steps->n pixels
+            steps->src[k++] = i;
+            xacc += steps->zoom;
+        }
+        xacc -= 0x200;
+        steps->len[i + 1] = k;
+    }
+    steps->xacc = xacc;
+    steps->n    = n;
+    return true;
+}
+
+// Draw one sprite line into 'rows' consecutive output rows, starting at dst (which is at xpos
+// on the first row). Returns false if the line can't be handled here, in which case the caller
+// falls back to the scalar path.
+bool hwsprites::draw_span(SpanState& st, uint16_t* dst, int row_pitch, int rows, const uint32_t* data,
+                          int32_t zoom, uint16_t color, bool shadow, bool clip, int32_t xpos)
+{
+#if HWSPRITES_SIMD
+    if (zoom <= 0)
+        return false;
+
+    // Clipped sprites only need output up to the right edge of the clip window
+    const int out_limit = clip ? std::min<int>(int(x2) - xpos, SPAN_MAX_OUT) : SPAN_MAX_OUT;
+    if (out_limit <= 0)
+        return true;
+
+    ZoomSteps* steps = find_zoom_steps(st, zoom);
+    uint8_t* span_px = st.span_px;
+    uint8_t* line_px = st.line_px;
+
+    // 1. unpack the line, stopping after the word whose second-to-last pixel is 0xf
+    int n = 0;
+    for (int w = 0; ; w++)
+    {
+        if (w == SPAN_MAX_WORDS)
+            return false;
+
+        const uint32_t pixels = data[w];
+        span_px[n + 0] = (pixels >> 28) & 0xf;
+        span_px[n + 1] = (pixels >> 24) & 0xf;
+        span_px[n + 2] = (pixels >> 20) & 0xf;
+        span_px[n + 3] = (pixels >> 16) & 0xf;
+        span_px[n + 4] = (pixels >> 12) & 0xf;
+        span_px[n + 5] = (pixels >>  8) & 0xf;
+        span_px[n + 6] = (pixels >>  4) & 0xf;
+        span_px[n + 7] = (pixels >>  0) & 0xf;
+        n += 8;
+
+        if (n > steps->n && !extend_span(steps, n))
+            return false;
+
+        if ((pixels & 0x000000f0) == 0x000000f0 || steps->len[n] >= out_limit)
+            break;
+    }
+
+    // 2. zoom the line over the range of output pixels to be drawn
+    int k0 = 0;
+    int k1 = std::min<int>(steps->len[n], out_limit);
+    if (clip)
+        k0 = std::max<int>(0, int(x1) - xpos);
+    if (k0 >= k1)
+        return true;
+
+    const uint16_t* src = steps->src;
+    for (int k = k0; k < k1; k++)
+        line_px[k] = span_px[src[k]];
 
-                bool shadowfound = shadow && (spriterom_shadowinfo[addr] == 0x11);
+    // 3. blend into each output row
+    for (int r = 0; r < rows; r++)
+        span_blend(dst + (r * row_pitch) + k0, line_px + k0, k1 - k0, color, shadow);
 
-                // the following should compile to a jump table, making it much quicker to get to the
-                // optimised drawing path we need without wading through layers of if/else etc
+    return true;
+#else
+    return false;
+#endif
+}
 
-                count = (count - 1) & 3; // 0..3
-                //uint32_t jump_key = //((xdelta>0)     ? 0u : 1u)   /* draw direction */
-                jump_key =   (count                   ) | /* output rows, 1-4, selected via 0-3 */
-                             ((clip)         ? 0u : 4u) | /* sprite requires x-clip */
-                             ((shadowfound)  ? 8u : 0u); /* sprite has shadows */
+void hwsprites::render(uint16_t* pixels, const uint8_t priority)
+{
+    render(pixels, priority, 0, config.s16_height);
+}
 
-                // Note - the proportion of sprite *lines* following the (shadowfound) path (jump_key>7) is
-                // low, approx 10%, however the cost of rendering them is much, much higher.
+// Draw only output rows [y_begin, y_end). Each sprite is still stepped through from its top
+// row, so a frame built from strips matches one drawn in a single pass.
+// Decode one entry of sprite RAM, adjusted for widescreen, hi-res and drawing left to right.
+// Returns the priority (0-3), or -1 if the sprite isn't drawn.
+int hwsprites::decode(const uint16_t* words, Sprite& out) const
+{
+    const uint32_t numbanks = SPRITES_LENGTH / 0x10000;
 
-                freq[jump_key]++;
+    // if hidden, or top greater than/equal to bottom, or invalid bank, punt
+    int16_t hide    = (words[0] & 0x5000);
+    int32_t height  = (words[5] >> 8) + 1;
+    if (hide != 0 || height == 0) return -1;
+
+    int16_t bank      =  (words[0] >> 9) & 7;
+    int32_t top       =  (words[0] & 0x1ff) - 0x100;
+    bool     clip     =  (words[0] & 0x2000);
+    uint32_t addr     =   words[1];
+    int32_t pitch     = ((words[2] >> 1) | ((words[4] & 0x1000) << 3)) >> 8;
+    uint8_t shadow    =  (words[3] >> 14) & 1;
+//        int32_t  zoom     =   words[3] & 0x7ff;
+    int32_t  zoom     =   words[3] & 0x0fff;
+    int32_t ydelta    = ((words[4] & 0x8000) != 0) ? 1 : -1;
+    int32_t flip      = (~words[4] >> 14) & 1;
+    int32_t xdelta    = ((words[4] & 0x2000) != 0) ? 1 : -1;
+//        int32_t hzoom     =   words[4] & 0x7ff;
+    int32_t width     =   words[4] & 0x7ff;
+    int32_t color     = COLOR_BASE +
+                        ((words[5] & 0x7f) << 4);
+    int32_t xpos      =   words[6]; // moved from original structure to accomodate widescreen
+    int32_t ytarget;
+
+    int16_t offset    =   words[15]; // JJP - provides horizontal offset for hires sprite rendering
+    // adjust X coordinate
+    // note: the threshhold below is a guess. If it is too high, rachero will draw garbage
+    // If it is too low, smgp won't draw the bottom part of the road
+    if (xpos < 0x80 && xdelta < 0)
+        xpos += 0x200;
+    xpos -= 0xbe;
+
+    // clamp to within the memory region size
+    if (numbanks)
+        bank %= numbanks;
+
+    // loop from top to bottom
+    ytarget = top + ydelta * height;
+
+    // Adjust for widescreen mode
+    xpos += config.s16_x_off;
+
+    // Adjust for hi-res mode
+    if (config.video.hires) {
+        xpos <<= 1;
+        top <<= 1;
+        ytarget <<= 1;
+        zoom >>= 1;
+    }
 
-//std::cout << "Clip: " << clip << ", Count: " << count << ", flip: " << flip << ", jump_key: " << jump_key << std::endl;
+    if (xdelta == -1) {
+        // always draw left-to-right
+        xpos  -= (width << (config.video.hires ? 1 : 0));   // move draw position left by rendered width
+        if (flip) {
+            flip = 0;
+            addr -= (pitch - 1);
+        } else {
+            flip = 1;
+            addr += (pitch - 1);
+        }
+    }
 
-                switch (jump_key) {
-
-                    case 0:
-                    {
-                        // no shadows, clipped, count==1, not flipped
-                        for (int32_t x = xpos; (xdelta > 0 && x < scrn_width) || (xdelta < 0 && x >= 0); ) {
-                            uint32_t pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_1row_ns();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_1row_ns();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_1row_ns();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_1row_ns();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_1row_ns();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_1row_ns();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_1row_ns();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_1row_ns();
-                            // stop if the second-to-last pixel in the group was 0xf
-                            if ((pixels & 0x000000f0) == 0x000000f0)
-                                break;
-                        }
-                        break;
-                    }
-                    case 1:
-                    {
-                        // no shadows, clipped, count==2, not-flipped
-                        uint16_t* pPix2 = pixels + ((y+1) * scrn_width) + xpos;
-                        for (int32_t x = xpos; (xdelta > 0 && x < scrn_width) || (xdelta < 0 && x >= 0); ) {
-                            uint32_t pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_2row_ns();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_2row_ns();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_2row_ns();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_2row_ns();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_2row_ns();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_2row_ns();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_2row_ns();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_2row_ns();
-                            // stop if the second-to-last pixel in the group was 0xf
-                            if ((pixels & 0x000000f0) == 0x000000f0)
-                                break;
-                        }
-                        // accumulate extra zoom factor
-                        yacc += zoom;
-                        addr += pitch * (yacc >> 9);
-                        yacc &= 0x1ff;
-                        y++;
-                        break;
-                    }
-                    case 2:
-                    {
-                        // no shadows, clipped, count==3, not-flipped
-                        uint16_t* pPix2 = pixels + ((y+1) * scrn_width) + xpos;
-                        uint16_t* pPix3 = pixels + ((y+2) * scrn_width) + xpos;
-                        for (int32_t x = xpos; (xdelta > 0 && x < scrn_width) || (xdelta < 0 && x >= 0); ) {
-                            uint32_t pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_3row_ns();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_3row_ns();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_3row_ns();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_3row_ns();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_3row_ns();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_3row_ns();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_3row_ns();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_3row_ns();
-                            // stop if the second-to-last pixel in the group was 0xf
-                            if ((pixels & 0x000000f0) == 0x000000f0)
-                                break;
-                        }
-                        // accumulate extra zoom factors
-                        for (int i=1; i<2; i++) {
-                            yacc += zoom;
-                            addr += pitch * (yacc >> 9);
-                            yacc &= 0x1ff;
-                            y++;
-                        }
-                        break;
-                    }
-                    case 3: break; // count==4 - not used as <1%
-                    case 4:
-                    {
-                        // no shadows, not clipped, count==1, not flipped
-                        //for (int32_t x = xpos; (xdelta > 0 && x < scrn_width) || (xdelta < 0 && x >= 0); ) {
-                        uint32_t pixels;
-                        do {
-                            pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_1row_nc_ns();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_1row_nc_ns();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_1row_nc_ns();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_1row_nc_ns();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_1row_nc_ns();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_1row_nc_ns();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_1row_nc_ns();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_1row_nc_ns();
-                            // stop if the second-to-last pixel in the group was 0xf
-                        } while ((pixels & 0x000000f0) != 0x000000f0);
-                        break;
-                    }
-                    case 5:
-                    {
-                        // no shadows, not clipped, count==2, not flipped
-                        uint16_t* pPix2 = pixels + ((y+1) * scrn_width) + xpos;
-                        uint32_t pixels;
-                        do {
-                            pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_2row_nc_ns();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_2row_nc_ns();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_2row_nc_ns();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_2row_nc_ns();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_2row_nc_ns();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_2row_nc_ns();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_2row_nc_ns();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_2row_nc_ns();
-                            // stop if the second-to-last pixel in the group was 0xf
-                        } while ((pixels & 0x000000f0) != 0x000000f0);
-                        // accumulate extra zoom factor
-                        yacc += zoom;
-                        addr += pitch * (yacc >> 9);
-                        yacc &= 0x1ff;
-                        y++;
-                        break;
-                    }
-                    case 6:
-                    {
-                        // no shadows, not clipped, count==3, not flipped
-                        uint16_t* pPix2 = pixels + ((y+1) * scrn_width) + xpos;
-                        uint16_t* pPix3 = pixels + ((y+2) * scrn_width) + xpos;
-                        uint32_t pixels;
-                        do {
-                            pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_3row_nc_ns();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_3row_nc_ns();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_3row_nc_ns();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_3row_nc_ns();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_3row_nc_ns();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_3row_nc_ns();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_3row_nc_ns();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_3row_nc_ns();
-                            // stop if the second-to-last pixel in the group was 0xf
-                        } while ((pixels & 0x000000f0) != 0x000000f0);
-                        // accumulate extra zoom factors
-                        for (int i=1; i<2; i++) {
-                            yacc += zoom;
-                            addr += pitch * (yacc >> 9);
-                            yacc &= 0x1ff;
-                            y++;
-                        }
-                        break;
-                    }
-                    case 7: break; // count==4 - not used as <1%
-                    case 8:
-                    {
-                        // shadows, clipped, count==1, not flipped
-                        for (int32_t x = xpos; (xdelta > 0 && x < scrn_width) || (xdelta < 0 && x >= 0); ) {
-                            uint32_t pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_1row();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_1row();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_1row();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_1row();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_1row();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_1row();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_1row();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_1row();
-                            // stop if the second-to-last pixel in the group was 0xf
-                            if ((pixels & 0x000000f0) == 0x000000f0)
-                                break;
-                        }
-                        break;
-                    }
-                    case 9:
-                    {
-                        // shadows, clipped, count==2, not-flipped
-                        uint16_t* pPix2 = pixels + ((y+1) * scrn_width) + xpos;
-                        for (int32_t x = xpos; (xdelta > 0 && x < scrn_width) || (xdelta < 0 && x >= 0); ) {
-                            uint32_t pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_2row();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_2row();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_2row();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_2row();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_2row();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_2row();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_2row();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_2row();
-                            // stop if the second-to-last pixel in the group was 0xf
-                            if ((pixels & 0x000000f0) == 0x000000f0)
-                                break;
-                        }
-                        // accumulate extra zoom factor
-                        yacc += zoom;
-                        addr += pitch * (yacc >> 9);
-                        yacc &= 0x1ff;
-                        y++;
-                        break;
-                    }
-                    case 10:
-                    {
-                        // shadows, clipped, count==3, not-flipped
-                        uint16_t* pPix2 = pixels + ((y+1) * scrn_width) + xpos;
-                        uint16_t* pPix3 = pixels + ((y+2) * scrn_width) + xpos;
-                        for (int32_t x = xpos; (xdelta > 0 && x < scrn_width) || (xdelta < 0 && x >= 0); ) {
-                            uint32_t pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_3row();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_3row();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_3row();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_3row();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_3row();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_3row();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_3row();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_3row();
-                            // stop if the second-to-last pixel in the group was 0xf
-                            if ((pixels & 0x000000f0) == 0x000000f0)
-                                break;
-                        }
-                        // accumulate extra zoom factors
-                        for (int i=1; i<2; i++) {
-                            yacc += zoom;
-                            addr += pitch * (yacc >> 9);
-                            yacc &= 0x1ff;
-                            y++;
-                        }
-                        break;
-                    }
-                    case 11: break; // count==4 - not used as <1%
-                    case 12:
-                    {
-                        // shadows, not clipped, count==1, not flipped
-                        //for (int32_t x = xpos; (xdelta > 0 && x < scrn_width) || (xdelta < 0 && x >= 0); ) {
-                        uint32_t pixels;
-                        do {
-                            pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_1row_nc();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_1row_nc();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_1row_nc();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_1row_nc();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_1row_nc();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_1row_nc();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_1row_nc();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_1row_nc();
-                            // stop if the second-to-last pixel in the group was 0xf
-                        } while ((pixels & 0x000000f0) != 0x000000f0);
-                        break;
-                    }
-                    case 13:
-                    {
-                        // shadows, not clipped, count==2, not flipped
-                        uint16_t* pPix2 = pixels + ((y+1) * scrn_width) + xpos;
-                        uint32_t pixels;
-                        do {
-                            pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_2row_nc();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_2row_nc();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_2row_nc();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_2row_nc();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_2row_nc();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_2row_nc();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_2row_nc();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_2row_nc();
-                            // stop if the second-to-last pixel in the group was 0xf
-                        } while ((pixels & 0x000000f0) != 0x000000f0);
-                        // accumulate extra zoom factor
-                        yacc += zoom;
-                        addr += pitch * (yacc >> 9);
-                        yacc &= 0x1ff;
-                        y++;
-                        break;
-                    }
-                    case 14:
-                    {
-                        // shadows, not clipped, count==3, not flipped
-                        uint16_t* pPix2 = pixels + ((y+1) * scrn_width) + xpos;
-                        uint16_t* pPix3 = pixels + ((y+2) * scrn_width) + xpos;
-                        uint32_t pixels;
-                        do {
-                            pixels = spritedata[spriteaddr++];
-                            uint32_t pix;
-                            // draw eight pixels
-                            pix = (pixels >> 28) & 0xf; draw_pixel_3row_nc();
-                            pix = (pixels >> 24) & 0xf; draw_pixel_3row_nc();
-                            pix = (pixels >> 20) & 0xf; draw_pixel_3row_nc();
-                            pix = (pixels >> 16) & 0xf; draw_pixel_3row_nc();
-                            pix = (pixels >> 12) & 0xf; draw_pixel_3row_nc();
-                            pix = (pixels >>  8) & 0xf; draw_pixel_3row_nc();
-                            pix = (pixels >>  4) & 0xf; draw_pixel_3row_nc();
-                            pix = (pixels >>  0) & 0xf; draw_pixel_3row_nc();
-                            // stop if the second-to-last pixel in the group was 0xf
-                        } while ((pixels & 0x000000f0) != 0x000000f0);
-                        // accumulate extra zoom factors
-                        for (int i=1; i<2; i++) {
-                            yacc += zoom;
-                            addr += pitch * (yacc >> 9);
-                            yacc &= 0x1ff;
-                            y++;
-                        }
-                        break;
-                    }
-                    case 15: break; // count==4 - not used as <1%
-                }
-            }
-            // accumulate zoom factors; if we carry into the high bit, skip an extra row
-            yacc += zoom;
-            addr += pitch * (yacc >> 9);
-            yacc &= 0x1ff;
+    // adjust x-position with pre-determined offset for hi-res sprite rendering
+    if (config.video.hiresprites == 1)
+        xpos += offset;
+
+    // choose which ROM to read from - flipped or non-flipped
+    if (flip) {
+        addr = addr - pitch + 1; // set pointer to start of sprite row
+        out.data = sprites_flipped + 0x10000 * bank;
+    } else {
+        out.data = sprites + 0x10000 * bank;
+    }
+    out.shadowinfo = sprites_shadowinfo + 0x10000 * bank;
+    out.rom_offset = 0x10000 * bank;
+    out.addr       = addr;
+    out.pitch      = pitch;
+    out.top        = top;
+    out.ytarget    = ytarget;
+    out.ydelta     = ydelta;
+    out.zoom       = zoom;
+    out.xpos       = xpos;
+    out.color      = color;
+    out.clip       = clip;
+    out.shadow     = shadow;
+    return (words[3] >> 12) & 3;
+}
+
+// Decode a sprite list from sprite RAM, up to the end marker
+void hwsprites::build_list(const uint16_t* words, SpriteList& out) const
+{
+    std::memset(out.count, 0, sizeof(out.count));
+    out.sprites = 0;
+    out.ended   = false;
+    for (int i = 0; i < SPRITE_ENTRIES && !out.ended; i++)
+        add_to_list(out, words + i * 16);
+}
+
+void hwsprites::add_to_list(SpriteList& out, const uint16_t* words) const
+{
+    // stop when we hit the end of sprite list
+    if (out.ended || (words[0] & 0x8000) != 0) {
+        out.ended = true;
+        return;
+    }
+    const int pri = decode(words, out.sprite[out.sprites]);
+    if (pri >= 0)
+        out.index[pri][out.count[pri]++] = out.sprites++;
+}
+
+// Native sprite list: the game writes each entry through here rather than word by word. The
+// words still go to sprite RAM, in one copy, for snapshots and the packed path; the entry is
+// decoded into the list drawn as it arrives, so render() doesn't unpack RAM every pass.
+void hwsprites::add_sprite(const uint16_t index, const uint16_t* words)
+{
+    const int entry = index % SPRITE_ENTRIES;
+    std::memcpy(ram.ram + entry * 16, words, 16 * sizeof(uint16_t));
+
+    SpriteList& out = *list.ram;
+    if (entry == 0) {
+        std::memset(out.count, 0, sizeof(out.count));
+        out.sprites = 0;
+        out.ended   = false;
+    }
+    add_to_list(out, words);
+}
+
+void hwsprites::render(uint16_t* pixels, const uint8_t priority, const int32_t y_begin, const int32_t y_end, int band)
+{
+    SpanState& st = span_state[band & (MAX_BANDS - 1)];
+
+    // priority is one bit of four
+    const int pri = priority == 1 ? 0 : priority == 2 ? 1 : priority == 4 ? 2 : priority == 8 ? 3 : -1;
+    if (pri < 0)
+        return;
+
+    if (config.video.sprite_list) {
+        const SpriteList& sprites = *list.frame();
+        for (int i = 0; i < sprites.count[pri]; i++)
+            draw_sprite(sprites.sprite[sprites.index[pri][i]], pixels, y_begin, y_end, st);
+    } else {
+        // packed path: unpack sprite RAM as the hardware does
+        const uint16_t* ramBuff = ram.frame();
+        for (uint16_t data = 0; data < SPRITE_RAM_SIZE; data += 16) // was +=8
+        {
+            // stop when we hit the end of sprite list
+            if ((ramBuff[data+0] & 0x8000) != 0) break;
+
+            Sprite sprite;
+            if (decode(ramBuff + data, sprite) == pri)
+                draw_sprite(sprite, pixels, y_begin, y_end, st);
         }
-        draw[jump_key] += std::chrono::high_resolution_clock::now() - start;
     }
 
 /* Timing display
@@ -994,10 +1130,127 @@ std::cout << "\r\t\t\t\t" << processed_lines << " sprite lines flipped";
             << std::setw(8) << freq[i]  << "  "
             << std::setw(9) << ms       << " ms\n";
     }
-    std::cout << "\033[K"; // clear to end of line
-    std::cout << std::dec << "Path 12 rep count: ";
-    for (int i=0; i<6; i++) std::cout << reps[i] << ",";
 
     std::cout << "\033[K"; // clear to end of line
 */
 }
+
+void hwsprites::draw_sprite(const Sprite& sprite, uint16_t* pixels, const int32_t y_begin, const int32_t y_end, SpanState& st)
+{
+//    static uint32_t freq[32];
+
+//    auto start = std::chrono::high_resolution_clock::now();
+    const uint32_t* spritedata           = sprite.data;
+    const uint8_t*  spriterom_shadowinfo = sprite.shadowinfo;
+    const uint32_t  rom_offset           = sprite.rom_offset;
+    const int32_t   pitch   = sprite.pitch;
+    const int32_t   top     = sprite.top;
+    const int32_t   ytarget = sprite.ytarget;
+    const int32_t   ydelta  = sprite.ydelta;
+    const int32_t   zoom    = sprite.zoom;
+    const int32_t   xpos    = sprite.xpos;
+    const int32_t   color   = sprite.color;
+    const bool      clip    = sprite.clip;
+    const uint8_t   shadow  = sprite.shadow;
+    uint32_t addr = sprite.addr;
+    int32_t y, yacc = 0;
+
+    const uint16_t scrn_width = config.s16_width;
+    const unsigned span = (unsigned)(x2 - x1);
+
+//        setup += std::chrono::high_resolution_clock::now() - start;
+//        start = std::chrono::high_resolution_clock::now();
+    uint32_t jump_key = 3;
+    // drawing loop
+    for (y = top; y != ytarget; y += ydelta)
+    {
+        // once past the strip being drawn, no later pass can reach it
+        if ((ydelta > 0) ? (y >= y_end) : (y + 2 < y_begin))
+            break;
+
+        // skip drawing if not within the cliprect
+        if (y >= 0 && y < config.s16_height)
+        {
+            // determine how many rows will be written on this pass
+            uint16_t count = 1;
+            uint32_t frac = yacc + zoom;
+            uint16_t countmax = std::min( (uint16_t)(ytarget - y),
+                                          std::min<uint16_t>(3, config.s16_height - y));
+            while (frac < 0x200 && count < countmax) {
+                frac += zoom;
+                count++;
+            }
+            // count now contains a value between 1 and 3.
+            // we can also use (count-1) as the *minimum* number of pixels that will be written out
+            // but each x-pass, since hzoom=vzoom.
+
+            // every row of a pass is the same sprite line, so clipping the pass to the strip
+            // just drops rows; the pass must still be stepped through to keep yacc and addr
+            // in step with a full-frame render
+            const int32_t row     = std::max<int32_t>(y, y_begin);
+            const int32_t row_end = std::min<int32_t>(y + count, y_end);
+            const bool    visible = row < row_end;
+
+            uint16_t* pPix1 = pixels + (row * scrn_width) + xpos;
+            const uint32_t* linedata = spritedata + addr;
+            uint8_t shadowinfo = spriterom_shadowinfo[addr];
+
+            // make sure the flipped data and shadow info exist for this row, converting it
+            // now if neither the prewarm thread nor an earlier frame has done so
+            if (visible && !prepare_row(rom_offset + addr, pitch, st))
+            {
+                if (spritedata == sprites_flipped + rom_offset)
+                    linedata = st.row;
+                shadowinfo = st.row_shadow;
+            }
+
+            bool shadowfound = visible && shadow && (shadowinfo == 0x11);
+
+            // the line kernel for this pass is looked up directly, rather than through layers of
+            // if/else for every line
+
+            const uint32_t rows = (row_end - row - 1) & 3; // 0..3
+            //uint32_t jump_key = //((xdelta>0)     ? 0u : 1u)   /* draw direction */
+            jump_key =   (rows                    ) | /* output rows, 1-4, selected via 0-3 */
+                         ((clip)         ? 0u : 4u) | /* sprite requires x-clip */
+                         ((shadowfound)  ? 8u : 0u); /* sprite has shadows */
+
+            // Note - the proportion of sprite *lines* following the (shadowfound) path (jump_key>7) is
+            // low, approx 10%, however the cost of rendering them is much, much higher.
+
+//            if (visible)
+//                freq[jump_key]++;
+
+//std::cout << "Clip: " << clip << ", Count: " << count << ", flip: " << flip << ", jump_key: " << jump_key << std::endl;
+
+            if (!visible)
+            {
+                // pass lies entirely outside the strip
+            }
+            // Vectorised span path, drawing the same rows as the matching line kernel
+            else if (HWSPRITES_SIMD && rows < 3 &&
+                     draw_span(st, pPix1, scrn_width, rows + 1, linedata,
+                               zoom, color, shadowfound, clip, xpos))
+            {
+            }
+            else if (rows < 3) // count==4 - never produced
+            {
+                line_kernels[jump_key](pPix1, scrn_width, linedata, xpos,
+                                       zoom, color, x1, span, scrn_width);
+            }
+
+            // a multi-row pass consumes an extra line of the sprite
+            if (count > 1) {
+                yacc += zoom;
+                addr += pitch * (yacc >> 9);
+                yacc &= 0x1ff;
+                y++;
+            }
+        }
+        // accumulate zoom factors; if we carry into the high bit, skip an extra row
+        yacc += zoom;
+        addr += pitch * (yacc >> 9);
+        yacc &= 0x1ff;
+    }
+//    draw[jump_key] += std::chrono::high_resolution_clock::now() - start;
+}
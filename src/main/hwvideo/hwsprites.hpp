@@ -1,7 +1,13 @@
 #pragma once
 
 #include "stdint.hpp"
+#include "hwvideo/ramring.hpp"
+#include <atomic>
 #include <chrono>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <thread>
 
 class video;
 
@@ -10,37 +16,201 @@ class hwsprites
 public:
     hwsprites();
     ~hwsprites();
-    void init(const uint8_t*);
+    // With a ROM, converts it and loads the flipped rows from cache_file (see load_cache)
+    void init(const uint8_t*, const std::string& cache_file = "");
     void reset();
+    void clear_tables();
+    bool load_cache(const std::string& filename);
+    bool save_cache(const std::string& filename);
+    void start_prewarm();
+    void stop_prewarm();
+    // Bytes of the tables below held by this instance (none where they are shared)
+    size_t table_bytes() const { return own ? sizeof(Tables) : 0; }
     void set_x_clip(bool);
     void swap();
+    // Keep the sprite RAM being drawn for the whole frame, across a swap() (see ramring.hpp),
+    // and the clip set for it
+    void hold_frame()    { ram.hold(); list.hold(); x1 = clip_x1; x2 = clip_x2; }
+    void release_frame() { ram.release(); list.release(); rows_fixed = false; }
+    // Before a frame's sprites are drawn, whilst none are: converts the rows the last frame
+    // couldn't, and with banded, leaves every row converted as it is until release_frame()
+    void settle_rows(bool banded);
     uint8_t read(const uint16_t adr);
     void write(const uint16_t adr, const uint16_t data);
+    // Write sprite RAM entry index (16 words), and with video.sprite_list decode it for drawing
+    void add_sprite(const uint16_t index, const uint16_t* words);
     void render(uint16_t* pixels, const uint8_t);
+    // Lines [y_begin, y_end) only. Bands of a frame drawn at once each need their own band
+    // (0 to MAX_BANDS - 1), for the span path's scratch buffers.
+    void render(uint16_t* pixels, const uint8_t, const int32_t y_begin, const int32_t y_end, int band = 0);
+    static const int MAX_BANDS = 8;
+
+    // Both halves of sprite RAM, for video snapshots (see Video::save_snapshot)
+    bool save_state(std::ostream& out) const;
+    bool load_state(std::istream& in);
 
     std::chrono::nanoseconds setup{}; //initialises to zero
     std::chrono::nanoseconds draw[16]{};
 
 private:
-    // Clip values.
-    uint16_t x1, x2;
+    // Clip values: as set by the game, and for the frame being drawn
+    uint16_t clip_x1 = 0, clip_x2 = 0;
+    uint16_t x1 = 0, x2 = 0;
 
     // 128 sprites, 16 bytes each (0x400)
     static const uint16_t SPRITE_RAM_SIZE = 128 * 16; // was *8
     static const uint32_t SPRITES_LENGTH = 0x100000 >> 2;
     static const uint16_t COLOR_BASE = 0x800;
 
-    uint32_t sprites[SPRITES_LENGTH];               // Little-endian forward sprites
-    uint32_t sprites_flipped[SPRITES_LENGTH];       // Little-endian flipped sprites
-    // sprites_shadowinfo contains, at the start address of each sprite,
-    // - 0xff for each row that has not yest been processed
-    // - 0x11 for each row that contains a shadow entry (0xA);
-    // - 0x00 otherwise
-    // This helps with rendering as we can use a lower-cost routine 90% of the time
-    uint8_t sprites_shadowinfo[SPRITES_LENGTH];
-
-    // Two halves of RAM
-    uint16_t ram[SPRITE_RAM_SIZE];
-    uint16_t ramBuff[SPRITE_RAM_SIZE];
+    // The converted sprite ROM and the rows converted from it, allocated by init(). With
+    // data.shared_gfx they are in shared memory, built by the first instance (see sharedgfx.hpp)
+    // and converted further by every instance; row_lock then serialises writers across them.
+    struct Tables
+    {
+        uint32_t sprites[SPRITES_LENGTH];           // Little-endian forward sprites
+        uint32_t sprites_flipped[SPRITES_LENGTH];   // Little-endian flipped sprites
+        // sprites_shadowinfo contains, at the start address of each sprite,
+        // - 0xff for each row that has not yest been processed
+        // - 0x11 for each row that contains a shadow entry (0xA);
+        // - 0x00 otherwise
+        // This helps with rendering as we can use a lower-cost routine 90% of the time
+        uint8_t sprites_shadowinfo[SPRITES_LENGTH];
+
+        // Conversion state of each word of the two tables above, so rows can be converted ahead
+        // of use by the prewarm thread. The first word of a converted row holds pitch + 1 (rows
+        // are keyed on start address *and* pitch); the rest of the row holds ROW_INTERIOR.
+        // Read lock-free by render(); written only while holding row_lock.
+        uint16_t row_state[SPRITES_LENGTH];
+        std::atomic_flag row_lock = ATOMIC_FLAG_INIT;
+    };
+    static const uint16_t ROW_FREE     = 0;
+    static const uint16_t ROW_INTERIOR = 0xffff;
+    static const int      MAX_PITCH    = 0xff;
+
+    std::unique_ptr<Tables> own;                    // tables of this instance's own, or
+    Tables*                 shared = nullptr;       // those in shared memory
+
+    // The tables in use
+    uint32_t*         sprites            = nullptr;
+    uint32_t*         sprites_flipped    = nullptr;
+    uint8_t*          sprites_shadowinfo = nullptr;
+    uint16_t*         row_state          = nullptr;
+    std::atomic_flag* row_lock           = nullptr;
+
+    void point_at(Tables* tables);
+    void release_tables();
+    void convert(const uint8_t* src_sprites);
+
+    std::thread       prewarm_thread;
+    std::atomic<bool> prewarm_stop{false};
+
+    // Set by settle_rows() for a frame drawn in bands: a row may then be in use whilst another
+    // is converted, so no converted row is rewritten. Always so with the tables shared.
+    bool rows_fixed = false;
+
+    struct SpanState;
+    inline bool prepare_row(uint32_t start, int pitch, SpanState& st);
+    bool convert_row(uint32_t start, int pitch, bool rewrite);
+    void prewarm();
+
+    // On-disk cache of the lazily generated tables above, so rows flipped in earlier sessions
+    // are available from the first frame. Keyed on the sprite ROM CRC32 and hi-res mode.
+    struct CacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t rom_crc;
+        uint32_t hires;
+        uint32_t length;
+    };
+    static const uint32_t CACHE_MAGIC   = 0x43534243; // "CBSC"
+    static const uint32_t CACHE_VERSION = 2;
+
+    uint32_t          rom_crc = 0;
+    std::atomic<bool> cache_dirty{false};           // rows generated since last load/save
+
+    // Two halves of RAM (see ramring.hpp)
+    RamRing<uint16_t, SPRITE_RAM_SIZE> ram;
+
+    // A sprite RAM entry decoded, adjusted for widescreen and hi-res and to draw left to right:
+    // all that the drawing loop needs
+    struct Sprite
+    {
+        const uint32_t* data;           // sprite ROM of the bank, flipped or not
+        const uint8_t*  shadowinfo;     // sprites_shadowinfo of the bank
+        uint32_t rom_offset;            // of the bank
+        uint32_t addr;                  // first word of the top line
+        int32_t  pitch, top, ytarget, ydelta, zoom, xpos, color;
+        bool     clip;
+        uint8_t  shadow;
+    };
+
+    // The sprites of a frame, decoded once rather than on every render() pass, with each
+    // priority's sprites listed in RAM order (video.sprite_list). Swapped with the RAM.
+    static const int SPRITE_ENTRIES = SPRITE_RAM_SIZE / 16;
+    struct SpriteList
+    {
+        uint8_t count[4];                       // sprites at each priority
+        uint8_t index[4][SPRITE_ENTRIES];       // into sprite[]
+        uint8_t sprites;                        // decoded
+        bool    ended;                          // end of list marker reached
+        Sprite  sprite[SPRITE_ENTRIES];
+    };
+    RamRing<SpriteList, 1> list;
+
+    int  decode(const uint16_t* words, Sprite& out) const;
+    void add_to_list(SpriteList& out, const uint16_t* words) const;
+    void build_list(const uint16_t* words, SpriteList& out) const;
+    void draw_sprite(const Sprite& sprite, uint16_t* pixels, const int32_t y_begin, const int32_t y_end, SpanState& st);
+
+    // Span rasteriser (SIMD builds). Each sprite line is unpacked once, mapped through
+    // the zoomed source-index sequence, then blended into up to three output rows.
+    static const int SPAN_MAX_WORDS = 128;                 // longest sprite line, in 8-pixel words
+    static const int SPAN_MAX_SRC   = SPAN_MAX_WORDS * 8;  // source pixels
+    static const int SPAN_MAX_OUT   = 2048;                // output pixels
+
+    // Zoomed source-index sequences, one per zoom value seen this frame. Each depends only
+    // on the zoom, so is shared by every line of a sprite and by all sprites at the same
+    // zoom (roadside scenery, traffic at the same distance). Built lazily and extended on
+    // demand; the cache is emptied on swap().
+    struct ZoomSteps
+    {
+        int32_t  zoom;                          // zoom the sequence was built for
+        int32_t  xacc;                          // zoom accumulator at n
+        uint16_t n;                             // source pixels covered
+        uint16_t src[SPAN_MAX_OUT];             // output pixel -> source pixel
+        uint16_t len[SPAN_MAX_SRC + 1];         // source pixels -> output pixels produced
+    };
+
+    static const int ZOOM_VALUES     = 0x1000;  // zoom is 12 bits
+    static const int ZOOM_CACHE_SIZE = 32;
+    static const int PENDING_ROWS    = 64;
+
+    // The zoom cache and line buffers, one set per band being drawn
+    struct SpanState
+    {
+        ZoomSteps zoom_steps[ZOOM_CACHE_SIZE];
+        uint8_t   zoom_slot[ZOOM_VALUES] = {};  // zoom -> cache entry + 1, 0 if not cached
+        int       zoom_used = 0;                // entries allocated this frame
+        int       zoom_next = 0;                // next entry to recycle once full
+
+        alignas(16) uint8_t span_px[SPAN_MAX_SRC]; // unpacked source line
+        alignas(16) uint8_t line_px[SPAN_MAX_OUT]; // zoomed line
+
+        // A row that couldn't be converted in the tables whilst rows are fixed, converted here
+        // instead (ended by a word of 0xf pixels), and the rows settle_rows() is to convert
+        uint32_t row[MAX_PITCH + 1];
+        uint32_t row_key    = 0;                // start | pitch << 24 of the row held, 0 if none
+        uint8_t  row_shadow = 0;                // its sprites_shadowinfo entry
+        uint32_t pending[PENDING_ROWS];         // start | pitch << 24
+        int      pending_rows = 0;
+    };
+    SpanState span_state[MAX_BANDS];
+
+    void clear_zoom_steps();
+    static ZoomSteps* find_zoom_steps(SpanState& st, int32_t zoom);
+    static bool extend_span(ZoomSteps* steps, int n);
+    bool draw_span(SpanState& st, uint16_t* dst, int row_pitch, int rows, const uint32_t* data,
+                   int32_t zoom, uint16_t color, bool shadow, bool clip, int32_t xpos);
 
 };
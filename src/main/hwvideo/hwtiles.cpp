@@ -1,9 +1,25 @@
+#include <algorithm>
+#include <bit>     // std::countr_zero, std::popcount
 #include <cstring> // memcpy
+#include <istream>
+#include <ostream>
 #include "globals.hpp"
+#include "jobsystem.hpp"
 #include "romloader.hpp"
 #include "hwvideo/hwtiles.hpp"
 #include "frontend/config.hpp"
 
+// Vectorised tile rows, on SSE2 (x86) and NEON (ARM) builds; other targets draw pixel by pixel
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define HWTILES_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define HWTILES_SIMD 1
+#else
+    #define HWTILES_SIMD 0
+#endif
+
 /***************************************************************************
     Video Emulation: OutRun Tilemap Hardware.
     Based on MAME source code.
@@ -85,6 +101,12 @@ hwtiles::hwtiles(void)
         tile_banks[i] = i;
 
     set_x_clamp(CENTRE);
+    frame_x_clamp = x_clamp;
+
+    memset(tile_dirty, 0, sizeof(tile_dirty));
+    memset(frame_dirty, 0, sizeof(frame_dirty));
+    memset(text_dirty, 0, sizeof(text_dirty));
+    memset(text_frame_dirty, 0, sizeof(text_frame_dirty));
 
     // Tile format conversion LUT
     for (int b = 0; b < 256; ++b) {
@@ -115,30 +137,52 @@ void hwtiles::init(uint8_t* src_tiles, const bool hires)
         uint8_t *p1 = src_tiles + 0x10000;
         uint8_t *p2 = src_tiles + 0x20000;
 
-        for (size_t i = 0; i < TILES_LENGTH; ++i) {
-            uint32_t val = PL0[p0[i]] | PL1[p1[i]] | PL2[p2[i]];
-            tiles[i] = val;
-            tiles_backup[i] = val;
-        }
+        jobsystem.parallel_for(0, TILES_LENGTH, [&](int first, int last) {
+            for (size_t i = first; i < size_t(last); ++i) {
+                uint32_t val = PL0[p0[i]] | PL1[p1[i]] | PL2[p2[i]];
+                tiles[i] = val;
+                tiles_backup[i] = val;
+            }
+        });
     }
 
+    hires_mode = hires;
+    invalidate_layers();
+
     if (hires)
     {
         s16_width_noscale = config.s16_width >> 1;
-        render8x8_tile_mask      = &hwtiles::render8x8_tile_mask_hires;
-        render8x8_tile_mask_clip = &hwtiles::render8x8_tile_mask_clip_hires;
+        render8x8_tile_mask      = &hwtiles::render8x8_mask<true>;
+        render8x8_tile_mask_clip = &hwtiles::render8x8_mask_clip<true>;
     }
     else
     {
         s16_width_noscale = config.s16_width;
-        render8x8_tile_mask      = &hwtiles::render8x8_tile_mask_lores;
-        render8x8_tile_mask_clip = &hwtiles::render8x8_tile_mask_clip_lores;
+        render8x8_tile_mask      = &hwtiles::render8x8_mask<false>;
+        render8x8_tile_mask_clip = &hwtiles::render8x8_mask_clip<false>;
     }
 }
 
-// Patch Tileset with new data
+// Patch Tileset with new data. Made to the frame after the one being drawn, with restore_tiles(),
+// so the game can change the tile set whilst a frame is drawn.
 void hwtiles::patch_tiles(RomLoader* patch)
 {
+    tile_changes.push_back(patch);
+}
+
+void hwtiles::restore_tiles()
+{
+    tile_changes.push_back(nullptr);
+}
+
+void hwtiles::change_tiles(RomLoader* patch)
+{
+    if (!patch)
+    {
+        memcpy(tiles, tiles_backup, TILES_LENGTH * sizeof(uint32_t));
+        return;
+    }
+
     memcpy(tiles_backup, tiles, TILES_LENGTH * sizeof(uint32_t));
 
     for (uint32_t i = 0; i < patch->length;)
@@ -155,9 +199,50 @@ void hwtiles::patch_tiles(RomLoader* patch)
     }
 }
 
-void hwtiles::restore_tiles()
+void hwtiles::invalidate_layers()
 {
-    memcpy(tiles, tiles_backup, TILES_LENGTH * sizeof(uint32_t));
+    layers_invalid = true;
+    text_invalid   = true;
+}
+
+void hwtiles::invalidate_text_layer()
+{
+    text_invalid = true;
+}
+
+int hwtiles::tile_dirty_count() const
+{
+    int n = 0;
+    for (uint64_t bits : tile_dirty)
+        n += std::popcount(bits);
+    return n;
+}
+
+int hwtiles::text_dirty_count() const
+{
+    int n = 0;
+    for (uint64_t bits : text_dirty)
+        n += std::popcount(bits);
+    return n;
+}
+
+bool hwtiles::save_state(std::ostream& out) const
+{
+    out.write(reinterpret_cast<const char*>(tile_ram),   sizeof(tile_ram));
+    out.write(reinterpret_cast<const char*>(text_ram),   sizeof(text_ram));
+    out.write(reinterpret_cast<const char*>(tile_banks), sizeof(tile_banks));
+    return bool(out);
+}
+
+bool hwtiles::load_state(std::istream& in)
+{
+    in.read(reinterpret_cast<char*>(tile_ram),   sizeof(tile_ram));
+    in.read(reinterpret_cast<char*>(text_ram),   sizeof(text_ram));
+    in.read(reinterpret_cast<char*>(tile_banks), sizeof(tile_banks));
+    // everything has changed under the cached layers
+    invalidate_layers();
+    text_generation++;
+    return bool(in);
 }
 
 // Set Tilemap X Clamp
@@ -184,15 +269,69 @@ void hwtiles::set_x_clamp(const uint16_t props)
     }
 }
 
+// Copy the 16-bit entries marked in dirty from the game's RAM to the frame's
+static void copy_dirty(uint8_t* dst, const uint8_t* src, const uint64_t* dirty, uint32_t entries)
+{
+    for (uint32_t w = 0; w < entries / 64; w++)
+    {
+        for (uint64_t bits = dirty[w]; bits; bits &= bits - 1)
+        {
+            const uint32_t index = ((w << 6) | uint32_t(std::countr_zero(bits))) << 1;
+            memcpy(dst + index, src + index, 2);
+        }
+    }
+}
+
 void hwtiles::update_tile_values()
 {
+    bool tiles_changed = !tile_changes.empty();
+    for (RomLoader* patch : tile_changes)
+        change_tiles(patch);
+    tile_changes.clear();
+
+    if (layers_invalid || tiles_changed)
+    {
+        for (auto& page_caches : layer_cache)
+            for (auto& cache : page_caches)
+                cache.valid = false;
+        memcpy(frame_tile_ram, tile_ram, sizeof(frame_tile_ram));
+        layers_invalid = false;
+        text_invalid   = true;
+    }
+    else
+        copy_dirty(frame_tile_ram, tile_ram, tile_dirty, TILE_ENTRIES);
+
+    if (text_invalid)
+    {
+        for (auto& cache : text_cache)
+            cache.valid = false;
+        memcpy(frame_text_ram, text_ram, sizeof(frame_text_ram));
+        text_invalid = false;
+    }
+    else if (text_generation != text_frame_generation)
+        copy_dirty(frame_text_ram, text_ram, text_dirty, TEXT_ENTRIES);
+
+    frame_x_clamp = x_clamp;
+
     for (int i = 0; i < 4; i++)
     {
-        page[i] = ((text_ram[0xe80 + (i * 2) + 0] << 8) | text_ram[0xe80 + (i * 2) + 1]);
+        page[i] = ((frame_text_ram[0xe80 + (i * 2) + 0] << 8) | frame_text_ram[0xe80 + (i * 2) + 1]);
 
-        scroll_x[i] = ((text_ram[0xe98 + (i * 2) + 0] << 8) | text_ram[0xe98 + (i * 2) + 1]);
-        scroll_y[i] = ((text_ram[0xe90 + (i * 2) + 0] << 8) | text_ram[0xe90 + (i * 2) + 1]);
+        scroll_x[i] = ((frame_text_ram[0xe98 + (i * 2) + 0] << 8) | frame_text_ram[0xe98 + (i * 2) + 1]);
+        scroll_y[i] = ((frame_text_ram[0xe90 + (i * 2) + 0] << 8) | frame_text_ram[0xe90 + (i * 2) + 1]);
     }
+
+    // Latch the tilemap entries written since the last frame for the cached layers
+    memcpy(frame_dirty, tile_dirty, sizeof(frame_dirty));
+    memset(tile_dirty, 0, sizeof(tile_dirty));
+
+    if (text_generation != text_frame_generation)
+    {
+        memcpy(text_frame_dirty, text_dirty, sizeof(text_frame_dirty));
+        memset(text_dirty, 0, sizeof(text_dirty));
+        text_frame_generation = text_generation;
+    }
+    frame_number++;
 }
 
 // A quick and dirty debug function to display the contents of tile memory.
@@ -209,253 +348,529 @@ void hwtiles::render_all_tiles(uint16_t* buf)
     }
 }
 
-void hwtiles::render_tile_layer(uint16_t* buf, uint8_t page_index, uint8_t priority_draw)
+// fill, if given, holds a colour for each scanline (or -1) that is drawn behind the layer in the
+// same pass, rather than being drawn into the buffer beforehand.
+void hwtiles::render_tile_layer(uint16_t* buf, uint8_t page_index, uint8_t priority_draw, const int32_t* fill)
 {
-    int16_t Colour, x, y, Priority = 0;
+    prepare_tile_layer(page_index, priority_draw);
+    blit_tile_layer(buf, page_index, priority_draw, 0, config.s16_height, fill);
+}
 
-    uint16_t ActPage = 0;
+// Bring the cached layer up to date for this frame. Call once per frame before blitting it.
+void hwtiles::prepare_tile_layer(uint8_t page_index, uint8_t priority_draw)
+{
     const uint16_t EffPage = page[page_index];
     uint16_t xScroll = scroll_x[page_index];
     uint16_t yScroll = scroll_y[page_index];
 
     // Need to support this at each row/column
     if ((xScroll & 0x8000) != 0)
-        xScroll = (text_ram[0xf80 + (0x40 * page_index) + 0] << 8) | text_ram[0xf80 + (0x40 * page_index) + 1];
+        xScroll = (frame_text_ram[0xf80 + (0x40 * page_index) + 0] << 8) | frame_text_ram[0xf80 + (0x40 * page_index) + 1];
     if ((yScroll & 0x8000) != 0)
-        yScroll = (text_ram[0xf16 + (0x40 * page_index) + 0] << 8) | text_ram[0xf16 + (0x40 * page_index) + 1];
+        yScroll = (frame_text_ram[0xf16 + (0x40 * page_index) + 0] << 8) | frame_text_ram[0xf16 + (0x40 * page_index) + 1];
 
-    int x_decrement = (x_clamp - xScroll) & 0x3ff;
+    int x_decrement = (frame_x_clamp - xScroll) & 0x3ff;
     int y_decrement = yScroll & 0x1ff;
 
-    int my8 = -8, mx8;
+    LayerCache& cache = layer_cache[page_index & 3][priority_draw & 1];
+
+    // The cache can be updated in place if it was drawn for the previous frame with the same
+    // scroll, page and bank settings. Otherwise the whole layer is redrawn.
+    const bool reusable = cache.valid &&
+                          cache.frame + 1 == frame_number &&
+                          cache.pixels.size() == size_t(s16_width_noscale) * S16_HEIGHT &&
+                          cache.eff_page == EffPage &&
+                          cache.x_scroll == xScroll &&
+                          cache.y_scroll == yScroll &&
+                          cache.x_clamp  == frame_x_clamp &&
+                          cache.tile_banks[0] == tile_banks[0] &&
+                          cache.tile_banks[1] == tile_banks[1];
+
+    if (!reusable || update_layer(cache, EffPage, x_decrement, y_decrement, priority_draw) < 0)
+        rebuild_layer(cache, EffPage, x_decrement, y_decrement, priority_draw);
+
+    cache.valid         = true;
+    cache.frame         = frame_number;
+    cache.eff_page      = EffPage;
+    cache.x_scroll      = xScroll;
+    cache.y_scroll      = yScroll;
+    cache.x_clamp       = frame_x_clamp;
+    cache.tile_banks[0] = tile_banks[0];
+    cache.tile_banks[1] = tile_banks[1];
+}
+
+// Draw output lines [y_begin, y_end) of a layer prepared for this frame. In hi-res mode both
+// bounds must be even.
+void hwtiles::blit_tile_layer(uint16_t* buf, uint8_t page_index, uint8_t priority_draw,
+                              int y_begin, int y_end, const int32_t* fill)
+{
+    const int shift = hires_mode ? 1 : 0;
+    blit_layer(buf, layer_cache[page_index & 3][priority_draw & 1], fill, y_begin >> shift, y_end >> shift);
+}
+
+// Redraw the complete layer into the cache
+void hwtiles::rebuild_layer(LayerCache& cache, uint16_t eff_page, int x_decrement, int y_decrement, uint8_t priority_draw)
+{
+    cache.pixels.assign(size_t(s16_width_noscale) * S16_HEIGHT, 0);
+    cache.row_used.assign(S16_HEIGHT, 0);
+
     for (int my = 0; my < 64; my++)
-    {
-        my8 += 8;
-        mx8 = -8;
         for (int mx = 0; mx < 128; mx++)
+            draw_layer_cell(cache, mx, my, eff_page, x_decrement, y_decrement, priority_draw, false);
+}
+
+// Redraw only the tilemap entries written since the previous frame.
+// Returns the number of cells redrawn, or -1 if a full redraw would be quicker.
+int hwtiles::update_layer(LayerCache& cache, uint16_t eff_page, int x_decrement, int y_decrement, uint8_t priority_draw)
+{
+    int cells = 0;
+    for (uint32_t w = 0; w < TILE_ENTRIES / 64; w++)
+    {
+        uint64_t bits = frame_dirty[w];
+        while (bits)
         {
-            mx8 += 8;
-            const unsigned quad = ((unsigned)(my >= 32) << 1) | (unsigned)(mx >= 64);
-            const uint16_t ActPage = (EffPage >> (quad * 4)) & 0x0F;
-/*            if (my < 32 && mx < 64)                    // top left
-                ActPage = (EffPage >> 0) & 0x0f;
-            if (my < 32 && mx >= 64)                   // top right
-                ActPage = (EffPage >> 4) & 0x0f;
-            if (my >= 32 && mx < 64)                   // bottom left
-                ActPage = (EffPage >> 8) & 0x0f;
-            if (my >= 32 && mx >= 64)                  // bottom right page
-                ActPage = (EffPage >> 12) & 0x0f;
-*/
-
-            const uint32_t base   = (ActPage << 12) | ((unsigned(my) & 31u) << 7);
-            const uint32_t offset = (unsigned(mx) & 63u) << 1;
-            const uint32_t TileIndex = base | offset;
-/*
-            uint32_t TileIndex = 64 * 32 * 2 * ActPage + ((2 * 64 * my) & 0xfff) + ((2 * mx) & 0x7f);
-*/
-
-            uint16_t Data = (tile_ram[TileIndex + 0] << 8) | tile_ram[TileIndex + 1];
-
-            Priority = (Data >> 15) & 1;
-
-            if (Priority == priority_draw)
+            const uint32_t entry = (w << 6) | uint32_t(std::countr_zero(bits));
+            bits &= bits - 1;
+
+            // tile RAM byte offset -> page, row and column within that page
+            const uint32_t index    = entry << 1;
+            const uint16_t act_page = index >> 12;
+            const int      row      = (index >> 7) & 31;
+            const int      col      = (index >> 1) & 63;
+
+            // a page can be mapped into more than one quadrant of the layer
+            for (unsigned quad = 0; quad < 4; quad++)
             {
-                uint32_t Code = Data & 0x1fff;
-                Code = (tile_banks[Code >> 12] << 12) | (Code & 0xFFF);
-/*
-                Code = tile_banks[Code / 0x1000] * 0x1000 + Code % 0x1000;
-*/
-                Code &= (NUM_TILES - 1);
-
-                if (Code == 0) continue;
-
-                Colour = (Data >> 6) & 0x7f;
-
-                x = mx8;
-                y = my8;
-
-                // We take into account the internal screen resolution here
-                // to account for widescreen mode.
-                x -= x_decrement;
-//                x -= (x_clamp - xScroll) & 0x3ff;
-
-                if (x < -x_clamp)
-                    x += 1024;
-
-                y -= y_decrement;
-//                y -= yScroll & 0x1ff;
-
-
-                if (y < -288)
-                    y += 512;
-
-                const uint16_t ColourOff = (uint16_t)((Colour >> 5) << 8) | TILEMAP_COLOUR_OFFSET;
-/*
-                uint16_t ColourOff = TILEMAP_COLOUR_OFFSET;
-                if (Colour >= 0x20)
-					ColourOff = 0x100 | TILEMAP_COLOUR_OFFSET;
-                if (Colour >= 0x40)
-					ColourOff = 0x200 | TILEMAP_COLOUR_OFFSET;
-                if (Colour >= 0x60)
-					ColourOff = 0x300 | TILEMAP_COLOUR_OFFSET;
-*/
-                if (x > 7 && x < (s16_width_noscale - 8) && y > 7 && y <= (S16_HEIGHT - 8))
-                    (this->*render8x8_tile_mask)(buf, Code, x, y, Colour, 3, 0, ColourOff);
-                else if (x > -8 && x < s16_width_noscale && y > -8 && y < S16_HEIGHT)
-					(this->*render8x8_tile_mask_clip)(buf, Code, x, y, Colour, 3, 0, ColourOff);
-            } // end priority check
-        } // end for mx loop
-    } // end for my loop
+                if (((eff_page >> (quad * 4)) & 0x0F) != act_page)
+                    continue;
+                if (++cells > MAX_DIRTY_CELLS)
+                    return -1;
+                draw_layer_cell(cache, col + ((quad & 1) << 6), row + ((quad >> 1) << 5),
+                                eff_page, x_decrement, y_decrement, priority_draw, true);
+            }
+        }
+    }
+    return cells;
 }
 
-void hwtiles::render_text_layer(uint16_t* buf, uint8_t priority_draw)
+// Draw the tilemap entry at mx, my into the cache, optionally clearing the cell first
+void hwtiles::draw_layer_cell(LayerCache& cache, int mx, int my, uint16_t eff_page,
+                              int x_decrement, int y_decrement, uint8_t priority_draw, bool clear)
 {
-    uint16_t mx, my, Code, Colour, x, y, Priority, TileIndex = 0;
+    // We take into account the internal screen resolution here
+    // to account for widescreen mode.
+    int x = (mx << 3) - x_decrement;
+    if (x < -frame_x_clamp)
+        x += 1024;
+
+    int y = (my << 3) - y_decrement;
+    if (y < -288)
+        y += 512;
+
+    // Off screen?
+    if (x <= -8 || x >= s16_width_noscale || y <= -8 || y >= S16_HEIGHT)
+        return;
+
+    if (clear)
+        clear_cache_cell(cache, x, y);
 
-    int my8 = -8, mx8;
-    for (my = 0; my < 32; my++) 
+    const unsigned quad = ((unsigned)(my >= 32) << 1) | (unsigned)(mx >= 64);
+    const uint16_t ActPage = (eff_page >> (quad * 4)) & 0x0F;
+    const uint32_t TileIndex = (ActPage << 12) | ((unsigned(my) & 31u) << 7) | ((unsigned(mx) & 63u) << 1);
+
+    const uint16_t Data = (frame_tile_ram[TileIndex + 0] << 8) | frame_tile_ram[TileIndex + 1];
+
+    if (((Data >> 15) & 1) != priority_draw)
+        return;
+
+    uint32_t Code = Data & 0x1fff;
+    Code = (tile_banks[Code >> 12] << 12) | (Code & 0xFFF);
+    Code &= (NUM_TILES - 1);
+
+    if (Code == 0)
+        return;
+
+    draw_cache_tile(cache, x, y, Code, ((Data >> 6) & 0x7f) << 3);
+}
+
+// Clear the 8x8 cell at x, y (clipped to the screen) to transparent
+void hwtiles::clear_cache_cell(LayerCache& cache, int x, int y)
+{
+    const int width = s16_width_noscale;
+    const int x0 = std::max(x, 0);
+    const int x1 = std::min(x + 8, width);
+    const int y0 = std::max(y, 0);
+    const int y1 = std::min(y + 8, int(S16_HEIGHT));
+
+    for (int py = y0; py < y1; py++)
+        for (int px = x0; px < x1; px++)
+            cache.pixels[(py * width) + px] = 0;
+}
+
+// Draw an 8x8 tile at x, y (clipped to the screen) into the cache
+// ------------------------------------------------------------------------------------------------
+// One 8 pixel tile row: the packed nibbles of p0 (first pixel in the top bits), each plus palette,
+// over dst where the nibble isn't 0. The hi-res version draws each pixel as four, over dst and
+// the row pitch pixels below it.
+// ------------------------------------------------------------------------------------------------
+
+#if HWTILES_SIMD
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline uint16x8_t tile_row_pixels(uint32_t p0)
+{
+    // each lane takes one half of p0 and shifts its own nibble down
+    static const int16_t shifts[8] = { -12, -8, -4, 0, -12, -8, -4, 0 };
+    const uint16x8_t v = vcombine_u16(vdup_n_u16(uint16_t(p0 >> 16)), vdup_n_u16(uint16_t(p0)));
+    return vandq_u16(vshlq_u16(v, vld1q_s16(shifts)), vdupq_n_u16(0xf));
+}
+
+static inline void tile_row(uint16_t* dst, uint32_t p0, uint16_t palette)
+{
+    const uint16x8_t c = tile_row_pixels(p0);
+    const uint16x8_t clear = vceqq_u16(c, vdupq_n_u16(0));
+    vst1q_u16(dst, vbslq_u16(clear, vld1q_u16(dst), vaddq_u16(c, vdupq_n_u16(palette))));
+}
+
+static inline void tile_row_x2(uint16_t* dst, int pitch, uint32_t p0, uint16_t palette)
+{
+    const uint16x8_t c     = tile_row_pixels(p0);
+    const uint16x8x2_t pix = vzipq_u16(vaddq_u16(c, vdupq_n_u16(palette)), vaddq_u16(c, vdupq_n_u16(palette)));
+    const uint16x8_t clear = vceqq_u16(c, vdupq_n_u16(0));
+    const uint16x8x2_t msk = vzipq_u16(clear, clear);
+    for (int r = 0; r < 2; r++, dst += pitch)
     {
-        my8 += 8;
-        mx8 = -8;
-        for (mx = 0; mx < 64; mx++) 
+        vst1q_u16(dst,     vbslq_u16(msk.val[0], vld1q_u16(dst),     pix.val[0]));
+        vst1q_u16(dst + 8, vbslq_u16(msk.val[1], vld1q_u16(dst + 8), pix.val[1]));
+    }
+}
+
+// A layer cache row doubled across and down onto dst and dst1, zero pixels being transparent,
+// or showing fill (when fill isn't -1). Returns the pixels of src done, a multiple of 8.
+static inline int layer_row_x2(uint16_t* dst, uint16_t* dst1, const uint16_t* src, int width, int32_t fill)
+{
+    const uint16x8_t v_fill = vdupq_n_u16(uint16_t(fill));
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const uint16x8_t s     = vld1q_u16(src + x);
+        const uint16x8_t clear = vceqq_u16(s, vdupq_n_u16(0));
+        uint16_t* d0 = dst + (x << 1);
+        uint16_t* d1 = dst1 + (x << 1);
+        if (fill != -1)
         {
-            mx8 += 8;
-            Code = (text_ram[TileIndex + 0] << 8) | text_ram[TileIndex + 1];
-            Priority = (Code >> 15) & 1;
+            const uint16x8_t   p  = vbslq_u16(clear, v_fill, s);
+            const uint16x8x2_t pp = vzipq_u16(p, p);
+            vst1q_u16(d0, pp.val[0]); vst1q_u16(d0 + 8, pp.val[1]);
+            vst1q_u16(d1, pp.val[0]); vst1q_u16(d1 + 8, pp.val[1]);
+        }
+        else
+        {
+            const uint16x8x2_t ss = vzipq_u16(s, s);
+            const uint16x8x2_t cc = vzipq_u16(clear, clear);
+            vst1q_u16(d0,     vbslq_u16(cc.val[0], vld1q_u16(d0),     ss.val[0]));
+            vst1q_u16(d0 + 8, vbslq_u16(cc.val[1], vld1q_u16(d0 + 8), ss.val[1]));
+            vst1q_u16(d1,     vbslq_u16(cc.val[0], vld1q_u16(d1),     ss.val[0]));
+            vst1q_u16(d1 + 8, vbslq_u16(cc.val[1], vld1q_u16(d1 + 8), ss.val[1]));
+        }
+    }
+    return x;
+}
+#else
+static inline __m128i tile_row_pixels(uint32_t p0)
+{
+    // each lane takes one half of p0 and multiplies its own nibble up to the top, then shifts it down
+    const __m128i hi = _mm_set1_epi16(short(p0 >> 16));
+    const __m128i lo = _mm_set1_epi16(short(p0));
+    const __m128i v  = _mm_unpacklo_epi64(hi, lo);
+    return _mm_srli_epi16(_mm_mullo_epi16(v, _mm_set_epi16(4096, 256, 16, 1, 4096, 256, 16, 1)), 12);
+}
 
-            if (Priority == priority_draw) 
-            {
-                Colour = (Code >> 9) & 0x07;
-                Code &= 0x1ff;
-//                Code += tile_banks[0] * 0x1000;
-                Code += (tile_banks[0] << 12);
-                Code &= (NUM_TILES - 1);
+static inline __m128i tile_row_blend(__m128i clear, __m128i d, __m128i pix)
+{
+    return _mm_or_si128(_mm_and_si128(clear, d), _mm_andnot_si128(clear, pix));
+}
 
-                if (Code != 0) 
-                {
-//                    x = 8 * mx;
-//                    y = 8 * my;
-                    x = mx8;
-                    y = my8;
-
-                    x -= 192;
-
-                    // We also adjust the text layer for wide-screen below. But don't allow painting in the 
-                    // wide-screen areas to avoid graphical glitches.
-                    if (x > 7 && x < (s16_width_noscale - 8) && y > 7 && y <= (S16_HEIGHT - 8))
-                        (this->*render8x8_tile_mask)(buf, Code, x + config.s16_x_off, y, Colour, 3, 0, TILEMAP_COLOUR_OFFSET);
-                    else if (x > -8 && x < s16_width_noscale && y >= 0 && y < S16_HEIGHT) 
-                        (this->*render8x8_tile_mask_clip)(buf, Code, x + config.s16_x_off, y, Colour, 3, 0, TILEMAP_COLOUR_OFFSET);
-                }
-            }
-            TileIndex += 2;
+static inline void tile_row(uint16_t* dst, uint32_t p0, uint16_t palette)
+{
+    const __m128i c     = tile_row_pixels(p0);
+    const __m128i clear = _mm_cmpeq_epi16(c, _mm_setzero_si128());
+    const __m128i pix   = _mm_add_epi16(c, _mm_set1_epi16(short(palette)));
+    _mm_storeu_si128((__m128i*)dst, tile_row_blend(clear, _mm_loadu_si128((const __m128i*)dst), pix));
+}
+
+static inline void tile_row_x2(uint16_t* dst, int pitch, uint32_t p0, uint16_t palette)
+{
+    const __m128i c     = tile_row_pixels(p0);
+    const __m128i clear = _mm_cmpeq_epi16(c, _mm_setzero_si128());
+    const __m128i pix   = _mm_add_epi16(c, _mm_set1_epi16(short(palette)));
+    const __m128i pix0  = _mm_unpacklo_epi16(pix, pix),     pix1 = _mm_unpackhi_epi16(pix, pix);
+    const __m128i clr0  = _mm_unpacklo_epi16(clear, clear), clr1 = _mm_unpackhi_epi16(clear, clear);
+    for (int r = 0; r < 2; r++, dst += pitch)
+    {
+        _mm_storeu_si128((__m128i*)dst,       tile_row_blend(clr0, _mm_loadu_si128((const __m128i*)dst),       pix0));
+        _mm_storeu_si128((__m128i*)(dst + 8), tile_row_blend(clr1, _mm_loadu_si128((const __m128i*)(dst + 8)), pix1));
+    }
+}
+
+// A layer cache row doubled across and down onto dst and dst1, zero pixels being transparent,
+// or showing fill (when fill isn't -1). Returns the pixels of src done, a multiple of 8.
+static inline int layer_row_x2(uint16_t* dst, uint16_t* dst1, const uint16_t* src, int width, int32_t fill)
+{
+    const __m128i v_fill = _mm_set1_epi16(short(fill));
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m128i s     = _mm_loadu_si128((const __m128i*)(src + x));
+        const __m128i clear = _mm_cmpeq_epi16(s, _mm_setzero_si128());
+        __m128i* d0 = (__m128i*)(dst + (x << 1));
+        __m128i* d1 = (__m128i*)(dst1 + (x << 1));
+        if (fill != -1)
+        {
+            const __m128i p  = tile_row_blend(clear, v_fill, s);
+            const __m128i p0 = _mm_unpacklo_epi16(p, p), p1 = _mm_unpackhi_epi16(p, p);
+            _mm_storeu_si128(d0, p0); _mm_storeu_si128(d0 + 1, p1);
+            _mm_storeu_si128(d1, p0); _mm_storeu_si128(d1 + 1, p1);
+        }
+        else
+        {
+            const __m128i s0 = _mm_unpacklo_epi16(s, s),         s1 = _mm_unpackhi_epi16(s, s);
+            const __m128i c0 = _mm_unpacklo_epi16(clear, clear), c1 = _mm_unpackhi_epi16(clear, clear);
+            _mm_storeu_si128(d0,     tile_row_blend(c0, _mm_loadu_si128(d0),     s0));
+            _mm_storeu_si128(d0 + 1, tile_row_blend(c1, _mm_loadu_si128(d0 + 1), s1));
+            _mm_storeu_si128(d1,     tile_row_blend(c0, _mm_loadu_si128(d1),     s0));
+            _mm_storeu_si128(d1 + 1, tile_row_blend(c1, _mm_loadu_si128(d1 + 1), s1));
         }
     }
+    return x;
 }
+#endif
+#endif
 
-void hwtiles::render8x8_tile_mask_lores(
-    uint16_t *buf,
-    uint16_t nTileNumber, 
-    uint16_t StartX, 
-    uint16_t StartY, 
-    uint16_t nTilePalette, 
-    uint16_t nColourDepth, 
-    uint16_t nMaskColour, 
-    uint16_t nPaletteOffset) 
+void hwtiles::draw_cache_tile(LayerCache& cache, int x, int y, uint32_t code, uint32_t palette)
 {
-    uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
-    uint32_t* pTileData = tiles + (nTileNumber << 3);
-    buf += (StartY * config.s16_width) + StartX;
+    const int width = s16_width_noscale;
+    const int x0 = (x < 0) ? -x : 0;
+    const int x1 = (x + 8 > width) ? width - x : 8;
+    const int y0 = (y < 0) ? -y : 0;
+    const int y1 = (y + 8 > S16_HEIGHT) ? S16_HEIGHT - y : 8;
 
-    for (int y = 0; y < 8; y++) 
+    uint16_t* cell = cache.pixels.data() + (y * width) + x;
+    const uint32_t* pTileData = tiles + (code << 3);
+
+    for (int ty = y0; ty < y1; ty++)
     {
-        uint32_t p0 = *pTileData;
+        const uint32_t p0 = pTileData[ty];
+        if (p0 == 0)
+            continue;
 
-        if (p0 != nMaskColour) 
+        uint16_t* row = cell + (ty * width);
+#if HWTILES_SIMD
+        if (x0 == 0 && x1 == 8)
         {
-            uint32_t c7 = p0 & 0xf;
-            uint32_t c6 = (p0 >> 4) & 0xf;
-            uint32_t c5 = (p0 >> 8) & 0xf;
-            uint32_t c4 = (p0 >> 12) & 0xf;
-            uint32_t c3 = (p0 >> 16) & 0xf;
-            uint32_t c2 = (p0 >> 20) & 0xf;
-            uint32_t c1 = (p0 >> 24) & 0xf;
-            uint32_t c0 = (p0 >> 28);
-
-            if (c0) buf[0] = nPalette + c0;
-            if (c1) buf[1] = nPalette + c1;
-            if (c2) buf[2] = nPalette + c2;
-            if (c3) buf[3] = nPalette + c3;
-            if (c4) buf[4] = nPalette + c4;
-            if (c5) buf[5] = nPalette + c5;
-            if (c6) buf[6] = nPalette + c6;
-            if (c7) buf[7] = nPalette + c7;
+            tile_row(row, p0, uint16_t(palette));
+            cache.row_used[y + ty] = 1;
+            continue;
         }
-        buf += config.s16_width;
-        pTileData++;
+#endif
+        for (int tx = x0; tx < x1; tx++)
+        {
+            const uint32_t c = (p0 >> ((7 - tx) << 2)) & 0xf;
+            if (c) row[tx] = palette + c;
+        }
+        cache.row_used[y + ty] = 1;
     }
 }
 
-void hwtiles::render8x8_tile_mask_clip_lores(
-    uint16_t *buf,
-    uint16_t nTileNumber, 
-    int16_t StartX, 
-    int16_t StartY, 
-    uint16_t nTilePalette, 
-    uint16_t nColourDepth, 
-    uint16_t nMaskColour, 
-    uint16_t nPaletteOffset) 
+// Copy layer rows [row_begin, row_end) to the frame buffer. Zero pixels are transparent.
+void hwtiles::blit_layer(uint16_t* buf, const LayerCache& cache, const int32_t* fill, int row_begin, int row_end)
 {
-    uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
-    uint32_t* pTileData = tiles + (nTileNumber << 3);
-    buf += (StartY * config.s16_width) + StartX;
+    const int width    = s16_width_noscale;
+    const int s16width = config.s16_width;
+    const uint16_t* src = cache.pixels.data() + (row_begin * width);
 
-    for (int y = 0; y < 8; y++) 
+    for (int y = row_begin; y < row_end; y++, src += width)
     {
-        if ((StartY + y) >= 0 && (StartY + y) < S16_HEIGHT) 
-        {
-            uint32_t p0 = *pTileData;
+        const int32_t color = fill ? fill[y] : -1;
+        const int     rows  = hires_mode ? 2 : 1;
+        uint16_t*     dst   = buf + ((y * rows) * s16width);
 
-            if (p0 != nMaskColour) 
+        if (color != -1)
+        {
+            // Solid background line: every pixel is written once, from the layer or the fill
+            const uint16_t c = uint16_t(color);
+            if (!cache.row_used[y])
+            {
+                std::fill_n(dst, rows * s16width, c);
+                continue;
+            }
+            if (!hires_mode)
             {
-                uint32_t c7 = p0 & 0xf;
-                uint32_t c6 = (p0 >> 4) & 0xf;
-                uint32_t c5 = (p0 >> 8) & 0xf;
-                uint32_t c4 = (p0 >> 12) & 0xf;
-                uint32_t c3 = (p0 >> 16) & 0xf;
-                uint32_t c2 = (p0 >> 20) & 0xf;
-                uint32_t c1 = (p0 >> 24) & 0xf;
-                uint32_t c0 = (p0 >> 28);
-
-                if (c0 && 0 + StartX >= 0 && 0 + StartX < config.s16_width) buf[0] = nPalette + c0;
-                if (c1 && 1 + StartX >= 0 && 1 + StartX < config.s16_width) buf[1] = nPalette + c1;
-                if (c2 && 2 + StartX >= 0 && 2 + StartX < config.s16_width) buf[2] = nPalette + c2;
-                if (c3 && 3 + StartX >= 0 && 3 + StartX < config.s16_width) buf[3] = nPalette + c3;
-                if (c4 && 4 + StartX >= 0 && 4 + StartX < config.s16_width) buf[4] = nPalette + c4;
-                if (c5 && 5 + StartX >= 0 && 5 + StartX < config.s16_width) buf[5] = nPalette + c5;
-                if (c6 && 6 + StartX >= 0 && 6 + StartX < config.s16_width) buf[6] = nPalette + c6;
-                if (c7 && 7 + StartX >= 0 && 7 + StartX < config.s16_width) buf[7] = nPalette + c7;
+                for (int x = 0; x < width; x++)
+                    dst[x] = src[x] ? src[x] : c;
             }
+            else
+            {
+                uint16_t* dst1 = dst + s16width;
+                int x = 0;
+#if HWTILES_SIMD
+                x = layer_row_x2(dst, dst1, src, width, color);
+#endif
+                for (; x < width; x++)
+                {
+                    const uint16_t p = src[x] ? src[x] : c;
+                    dst[(x << 1)] = dst[(x << 1) + 1] = dst1[(x << 1)] = dst1[(x << 1) + 1] = p;
+                }
+            }
+            continue;
+        }
+
+        if (!cache.row_used[y])
+            continue;
+
+        if (!hires_mode)
+        {
+            for (int x = 0; x < width; x++)
+                dst[x] = src[x] ? src[x] : dst[x];
+        }
+        else
+        {
+#if HWTILES_SIMD
+            // Hires Mode: Set 4 pixels instead of one, doubling the row as it's blended
+            uint16_t* dst1 = dst + s16width;
+            for (int x = layer_row_x2(dst, dst1, src, width, -1); x < width; x++)
+                if (src[x])
+                    dst[(x << 1)] = dst[(x << 1) + 1] = dst1[(x << 1)] = dst1[(x << 1) + 1] = src[x];
+#else
+            // Hires Mode: Set 4 pixels instead of one. The row is doubled first so that
+            // both output rows are simple masked copies (which vectorise).
+            uint16_t wide[MAX_LAYER_WIDTH * 2];
+            for (int x = 0; x < width; x++)
+                wide[(x << 1)] = wide[(x << 1) + 1] = src[x];
+
+            uint16_t* dst1 = dst + s16width;
+            for (int x = 0; x < (width << 1); x++)
+                dst[x] = wide[x] ? wide[x] : dst[x];
+            for (int x = 0; x < (width << 1); x++)
+                dst1[x] = wide[x] ? wide[x] : dst1[x];
+#endif
         }
-        buf += config.s16_width;
-        pTileData++;
     }
 }
 
+void hwtiles::render_text_layer(uint16_t* buf, uint8_t priority_draw)
+{
+    prepare_text_layer(priority_draw);
+    blit_text_layer(buf, priority_draw, 0, config.s16_height);
+}
+
+void hwtiles::prepare_text_layer(uint8_t priority_draw)
+{
+    LayerCache& cache = text_cache[priority_draw & 1];
+
+    const bool reusable = cache.valid &&
+                          cache.frame + 1 == frame_number &&
+                          cache.pixels.size() == size_t(s16_width_noscale) * S16_HEIGHT &&
+                          cache.x_off == config.s16_x_off &&
+                          cache.tile_banks[0] == tile_banks[0];
+
+    if (!reusable)
+        rebuild_text_layer(cache, priority_draw);
+    else if (cache.generation != text_frame_generation && update_text_layer(cache, priority_draw) < 0)
+        rebuild_text_layer(cache, priority_draw);
+
+    cache.valid         = true;
+    cache.frame         = frame_number;
+    cache.generation    = text_frame_generation;
+    cache.x_off         = config.s16_x_off;
+    cache.tile_banks[0] = tile_banks[0];
+}
+
+void hwtiles::blit_text_layer(uint16_t* buf, uint8_t priority_draw, int y_begin, int y_end)
+{
+    const int shift = hires_mode ? 1 : 0;
+    blit_layer(buf, text_cache[priority_draw & 1], nullptr, y_begin >> shift, y_end >> shift);
+}
+
+void hwtiles::rebuild_text_layer(LayerCache& cache, uint8_t priority_draw)
+{
+    cache.pixels.assign(size_t(s16_width_noscale) * S16_HEIGHT, 0);
+    cache.row_used.assign(S16_HEIGHT, 0);
+
+    for (int my = 0; my < 32; my++)
+        for (int mx = 0; mx < 64; mx++)
+            draw_text_cell(cache, mx, my, priority_draw, false);
+}
+
+// Redraw only the text cells written since the previous frame.
+// Returns the number of cells redrawn, or -1 if a full redraw would be quicker.
+int hwtiles::update_text_layer(LayerCache& cache, uint8_t priority_draw)
+{
+    int cells = 0;
+    for (uint32_t w = 0; w < TEXT_ENTRIES / 64; w++)
+    {
+        uint64_t bits = text_frame_dirty[w];
+        while (bits)
+        {
+            const uint32_t entry = (w << 6) | uint32_t(std::countr_zero(bits));
+            bits &= bits - 1;
+
+            if (++cells > MAX_DIRTY_CELLS)
+                return -1;
+            draw_text_cell(cache, entry & 63, entry >> 6, priority_draw, true);
+        }
+    }
+    return cells;
+}
+
+void hwtiles::draw_text_cell(LayerCache& cache, int mx, int my, uint8_t priority_draw, bool clear)
+{
+    // Unsigned, as in the original loop, so cells left of the screen are skipped entirely.
+    const uint16_t x = uint16_t((mx << 3) - 192);
+    const uint16_t y = uint16_t(my << 3);
+
+    if (x >= s16_width_noscale || y >= S16_HEIGHT)
+        return;
+
+    // We also adjust the text layer for wide-screen.
+    const int StartX = x + config.s16_x_off;
+
+    if (clear)
+        clear_cache_cell(cache, StartX, y);
+
+    const uint32_t TileIndex = ((my << 6) | mx) << 1;
+    uint16_t Code = (frame_text_ram[TileIndex + 0] << 8) | frame_text_ram[TileIndex + 1];
+
+    if (((Code >> 15) & 1) != priority_draw)
+        return;
+
+    const uint16_t Colour = (Code >> 9) & 0x07;
+    Code &= 0x1ff;
+    Code += (tile_banks[0] << 12);
+    Code &= (NUM_TILES - 1);
+
+    if (Code != 0)
+        draw_cache_tile(cache, StartX, y, Code, Colour << 3);
+}
+
 // ------------------------------------------------------------------------------------------------
-// Additional routines for Hi-Res Mode.
-// Note that the tilemaps are displayed at the same resolution, we just want everything to be
-// proportional.
+// In Hi-Res Mode the tilemaps are displayed at the same resolution, we just want everything to be
+// proportional, so each pixel is drawn as four.
 // ------------------------------------------------------------------------------------------------
 
-// Hires Mode: Set 4 pixels instead of one.
-inline void set_pixel_x4(uint16_t *buf, uint32_t data, uint16_t width)
+template <bool HIRES>
+static inline void set_tile_pixel(uint16_t *buf, int x, uint32_t data, uint16_t width)
 {
-    buf[0] = buf[1] = buf[width] = buf[1 + width] = data;
+    if (HIRES)
+    {
+        buf += x << 1;
+        buf[0] = buf[1] = buf[width] = buf[1 + width] = data;
+    }
+    else
+        buf[x] = data;
 }
 
-
-void hwtiles::render8x8_tile_mask_hires(
+template <bool HIRES>
+void hwtiles::render8x8_mask(
     uint16_t *buf,
     uint16_t nTileNumber, 
     uint16_t StartX, 
@@ -467,39 +882,36 @@ void hwtiles::render8x8_tile_mask_hires(
 {
     uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
     uint32_t* pTileData = tiles + (nTileNumber << 3);
-    buf += ((StartY << 1) * config.s16_width) + (StartX << 1);
 
-    uint16_t s16width = config.s16_width;
+    const uint16_t s16width = config.s16_width;
+    buf += ((StartY << HIRES) * s16width) + (StartX << HIRES);
+
     for (int y = 0; y < 8; y++) 
     {
         uint32_t p0 = *pTileData;
 
         if (p0 != nMaskColour) 
         {
-            uint32_t c7 = p0 & 0xf;
-            uint32_t c6 = (p0 >> 4) & 0xf;
-            uint32_t c5 = (p0 >> 8) & 0xf;
-            uint32_t c4 = (p0 >> 12) & 0xf;
-            uint32_t c3 = (p0 >> 16) & 0xf;
-            uint32_t c2 = (p0 >> 20) & 0xf;
-            uint32_t c1 = (p0 >> 24) & 0xf;
-            uint32_t c0 = (p0 >> 28);
-
-            if (c0) set_pixel_x4(&buf[0],  nPalette + c0, s16width);
-            if (c1) set_pixel_x4(&buf[2],  nPalette + c1, s16width);
-            if (c2) set_pixel_x4(&buf[4],  nPalette + c2, s16width);
-            if (c3) set_pixel_x4(&buf[6],  nPalette + c3, s16width);
-            if (c4) set_pixel_x4(&buf[8],  nPalette + c4, s16width);
-            if (c5) set_pixel_x4(&buf[10], nPalette + c5, s16width);
-            if (c6) set_pixel_x4(&buf[12], nPalette + c6, s16width);
-            if (c7) set_pixel_x4(&buf[14], nPalette + c7, s16width);
+#if HWTILES_SIMD
+            if (HIRES)
+                tile_row_x2(buf, s16width, p0, uint16_t(nPalette));
+            else
+                tile_row(buf, p0, uint16_t(nPalette));
+#else
+            for (int x = 0; x < 8; x++)
+            {
+                const uint32_t c = (p0 >> (28 - (x << 2))) & 0xf;
+                if (c) set_tile_pixel<HIRES>(buf, x, nPalette + c, s16width);
+            }
+#endif
         }
-        buf += (s16width << 1);
+        buf += (s16width << HIRES);
         pTileData++;
     }
 }
 
-void hwtiles::render8x8_tile_mask_clip_hires(
+template <bool HIRES>
+void hwtiles::render8x8_mask_clip(
     uint16_t *buf,
     uint16_t nTileNumber, 
     int16_t StartX, 
@@ -512,8 +924,8 @@ void hwtiles::render8x8_tile_mask_clip_hires(
     uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
     uint32_t* pTileData = tiles + (nTileNumber << 3);
 
-    uint16_t s16width = config.s16_width;
-    buf += ((StartY << 1) * s16width) + (StartX << 1);
+    const uint16_t s16width = config.s16_width;
+    buf += ((StartY << HIRES) * s16width) + (StartX << HIRES);
 
     for (int y = 0; y < 8; y++) 
     {
@@ -523,26 +935,15 @@ void hwtiles::render8x8_tile_mask_clip_hires(
 
             if (p0 != nMaskColour) 
             {
-                uint32_t c7 = p0 & 0xf;
-                uint32_t c6 = (p0 >> 4) & 0xf;
-                uint32_t c5 = (p0 >> 8) & 0xf;
-                uint32_t c4 = (p0 >> 12) & 0xf;
-                uint32_t c3 = (p0 >> 16) & 0xf;
-                uint32_t c2 = (p0 >> 20) & 0xf;
-                uint32_t c1 = (p0 >> 24) & 0xf;
-                uint32_t c0 = (p0 >> 28);
-
-                if (c0 && 0 + StartX >= 0 && 0 + StartX < s16_width_noscale) set_pixel_x4(&buf[0],  nPalette + c0, s16width);
-                if (c1 && 1 + StartX >= 0 && 1 + StartX < s16_width_noscale) set_pixel_x4(&buf[2],  nPalette + c1, s16width);
-                if (c2 && 2 + StartX >= 0 && 2 + StartX < s16_width_noscale) set_pixel_x4(&buf[4],  nPalette + c2, s16width);
-                if (c3 && 3 + StartX >= 0 && 3 + StartX < s16_width_noscale) set_pixel_x4(&buf[6],  nPalette + c3, s16width);
-                if (c4 && 4 + StartX >= 0 && 4 + StartX < s16_width_noscale) set_pixel_x4(&buf[8],  nPalette + c4, s16width);
-                if (c5 && 5 + StartX >= 0 && 5 + StartX < s16_width_noscale) set_pixel_x4(&buf[10], nPalette + c5, s16width);
-                if (c6 && 6 + StartX >= 0 && 6 + StartX < s16_width_noscale) set_pixel_x4(&buf[12], nPalette + c6, s16width);
-                if (c7 && 7 + StartX >= 0 && 7 + StartX < s16_width_noscale) set_pixel_x4(&buf[14], nPalette + c7, s16width);
+                for (int x = 0; x < 8; x++)
+                {
+                    const uint32_t c = (p0 >> (28 - (x << 2))) & 0xf;
+                    if (c && x + StartX >= 0 && x + StartX < s16_width_noscale)
+                        set_tile_pixel<HIRES>(buf, x, nPalette + c, s16width);
+                }
             }
         }
-        buf += (s16width << 1);
+        buf += (s16width << HIRES);
         pTileData++;
     }
 }
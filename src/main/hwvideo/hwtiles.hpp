@@ -1,6 +1,8 @@
 #pragma once
 
 #include "stdint.hpp"
+#include <iosfwd>
+#include <vector>
 
 class RomLoader;
 
@@ -25,16 +27,78 @@ public:
     void patch_tiles(RomLoader* patch);
     void restore_tiles();
     void set_x_clamp(const uint16_t);
+    // Latch the game's writes since the last frame for drawing, as the frame begins. Until the
+    // next call, the layers are drawn from this frame's copy of tile and text RAM, so the game
+    // may carry on writing the next frame meanwhile.
     void update_tile_values();
-    void render_tile_layer(uint16_t*, uint8_t, uint8_t);
+    void render_tile_layer(uint16_t*, uint8_t, uint8_t, const int32_t* fill = nullptr);
     void render_text_layer(uint16_t*, uint8_t);
+
+    // The same, split so a frame can be drawn a strip at a time: prepare each layer once per
+    // frame, then blit it for any range of output lines.
+    void prepare_tile_layer(uint8_t page_index, uint8_t priority_draw);
+    void blit_tile_layer(uint16_t*, uint8_t page_index, uint8_t priority_draw,
+                         int y_begin, int y_end, const int32_t* fill = nullptr);
+    void prepare_text_layer(uint8_t priority_draw);
+    void blit_text_layer(uint16_t*, uint8_t priority_draw, int y_begin, int y_end);
     void render_all_tiles(uint16_t*);
 
+    // Record a write to tile RAM, so that cached tile layers can be updated.
+    // 'index' is the byte offset of the write within tile RAM.
+    inline void mark_dirty(uint32_t index, uint32_t bytes)
+    {
+        index &= 0xFFFF;
+        const uint32_t first = index >> 1;
+        const uint32_t last  = (index + bytes - 1) >> 1;
+        for (uint32_t e = first; e <= last; e++)
+        {
+            const uint32_t entry = e & (TILE_ENTRIES - 1);
+            tile_dirty[entry >> 6] |= (uint64_t(1) << (entry & 63));
+        }
+    }
+
+    // As above, for text RAM. Any write also advances the text RAM generation.
+    inline void mark_text_dirty(uint32_t index, uint32_t bytes)
+    {
+        index &= 0xFFF;
+        const uint32_t first = index >> 1;
+        const uint32_t last  = (index + bytes - 1) >> 1;
+        for (uint32_t e = first; e <= last; e++)
+        {
+            const uint32_t entry = e & (TEXT_ENTRIES - 1);
+            text_dirty[entry >> 6] |= (uint64_t(1) << (entry & 63));
+        }
+        text_generation++;
+    }
+
+    // Force the cached tile layers to be fully redrawn (e.g. tile RAM cleared or tiles patched),
+    // from the next update_tile_values()
+    void invalidate_layers();
+    void invalidate_text_layer();
+
+    // Tile and text RAM entries marked dirty since the last frame (for cannonball-bench's checks)
+    int tile_dirty_count() const;
+    int text_dirty_count() const;
+
+    // Tile and text RAM and the tile banks, for video snapshots (see Video::save_snapshot)
+    bool save_state(std::ostream& out) const;
+    bool load_state(std::istream& in);
+
 private:
     int16_t x_clamp;
 
+    // Tile and text RAM, tile set and clamp as the game left them for the frame being drawn
+    alignas(64) uint8_t frame_text_ram[0x1000+4];
+    alignas(64) uint8_t frame_tile_ram[0x10000+4];
+    int16_t frame_x_clamp;
+    bool    layers_invalid = true;                     // from the game, for update_tile_values()
+    bool    text_invalid   = true;
+    std::vector<RomLoader*> tile_changes;              // patch_tiles(), or nullptr for restore_tiles()
+    void    change_tiles(RomLoader* patch);
+
     // S16 Width, ignoring widescreen related scaling.
     uint16_t s16_width_noscale;
+    bool     hires_mode = false;
 
     static const int TILES_LENGTH = 0x10000;
     alignas(64) uint32_t tiles[TILES_LENGTH];        // Converted tiles
@@ -48,6 +112,61 @@ private:
 
     static const uint16_t NUM_TILES = 0x2000; // Length of graphic rom / 24
     static const uint16_t TILEMAP_COLOUR_OFFSET = 0x1c00;
+
+    // ------------------------------------------------------------------------
+    // Cached tile layers.
+    //
+    // Each layer (page index and priority) is kept pre-rendered at native
+    // resolution. When the scroll values, page selection and tile banks are
+    // unchanged from the previous frame only the tilemap entries written since
+    // then are redrawn, and the layer is then blitted with transparency.
+    // ------------------------------------------------------------------------
+    static const uint32_t TILE_ENTRIES = 0x8000;       // 16-bit tilemap entries in tile RAM
+    uint64_t tile_dirty[TILE_ENTRIES / 64];            // entries written since the last frame
+    uint64_t frame_dirty[TILE_ENTRIES / 64];           // entries written before this frame
+    uint32_t frame_number = 0;
+
+    // Widest native layer supported (widescreen caps this well below)
+    static const int MAX_LAYER_WIDTH = 1024;
+
+    // Redraw the whole cache above this many changed entries
+    static const int MAX_DIRTY_CELLS = 1024;
+
+    struct LayerCache
+    {
+        std::vector<uint16_t> pixels;                  // 0 = transparent
+        std::vector<uint8_t>  row_used;                // rows that may contain pixels
+        bool     valid = false;
+        uint32_t frame = 0;                            // frame number the cache was last drawn for
+        uint16_t eff_page = 0;
+        uint16_t x_scroll = 0;
+        uint16_t y_scroll = 0;
+        int16_t  x_clamp  = 0;
+        int16_t  x_off    = 0;                         // text layer widescreen offset
+        uint32_t generation = 0;                       // text layer: text RAM generation drawn
+        uint8_t  tile_banks[2] = {0, 0};
+    };
+    LayerCache layer_cache[4][2];                      // [page_index][priority]
+
+    // Cached text layer, using the same scheme. Text RAM changes are also counted so
+    // that an unchanged frame doesn't need to look at the dirty bitmap at all.
+    static const uint32_t TEXT_ENTRIES = 0x800;        // 16-bit entries in text RAM
+    uint64_t text_dirty[TEXT_ENTRIES / 64];
+    uint64_t text_frame_dirty[TEXT_ENTRIES / 64];
+    uint32_t text_generation       = 0;                // advanced on every text RAM write
+    uint32_t text_frame_generation = 0;                // generation latched for this frame
+    LayerCache text_cache[2];                          // [priority]
+
+    void rebuild_layer(LayerCache& cache, uint16_t eff_page, int x_decrement, int y_decrement, uint8_t priority_draw);
+    int  update_layer(LayerCache& cache, uint16_t eff_page, int x_decrement, int y_decrement, uint8_t priority_draw);
+    void draw_layer_cell(LayerCache& cache, int mx, int my, uint16_t eff_page,
+                         int x_decrement, int y_decrement, uint8_t priority_draw, bool clear);
+    void rebuild_text_layer(LayerCache& cache, uint8_t priority_draw);
+    int  update_text_layer(LayerCache& cache, uint8_t priority_draw);
+    void draw_text_cell(LayerCache& cache, int mx, int my, uint8_t priority_draw, bool clear);
+    void clear_cache_cell(LayerCache& cache, int x, int y);
+    void draw_cache_tile(LayerCache& cache, int x, int y, uint32_t code, uint32_t palette);
+    void blit_layer(uint16_t* buf, const LayerCache& cache, const int32_t* fill, int row_begin, int row_end);
     
     void (hwtiles::*render8x8_tile_mask)(
         uint16_t *buf,
@@ -69,7 +188,9 @@ private:
         uint16_t nMaskColour, 
         uint16_t nPaletteOffset); 
         
-    void render8x8_tile_mask_lores(
+    // Lo-res and hi-res versions, the hi-res one drawing each tile pixel as 2x2
+    template <bool HIRES>
+    void render8x8_mask(
         uint16_t *buf,
         uint16_t nTileNumber, 
         uint16_t StartX, 
@@ -79,27 +200,8 @@ private:
         uint16_t nMaskColour, 
         uint16_t nPaletteOffset); 
 
-    void render8x8_tile_mask_clip_lores(
-        uint16_t *buf,
-        uint16_t nTileNumber, 
-        int16_t StartX, 
-        int16_t StartY, 
-        uint16_t nTilePalette, 
-        uint16_t nColourDepth, 
-        uint16_t nMaskColour, 
-        uint16_t nPaletteOffset);
-        
-    void render8x8_tile_mask_hires(
-        uint16_t *buf,
-        uint16_t nTileNumber, 
-        uint16_t StartX, 
-        uint16_t StartY, 
-        uint16_t nTilePalette, 
-        uint16_t nColourDepth, 
-        uint16_t nMaskColour, 
-        uint16_t nPaletteOffset); 
-        
-    void render8x8_tile_mask_clip_hires(
+    template <bool HIRES>
+    void render8x8_mask_clip(
         uint16_t *buf,
         uint16_t nTileNumber, 
         int16_t StartX, 
@@ -0,0 +1,94 @@
+/***************************************************************************
+    Double Buffered Video RAM.
+
+    The sprite and road hardware each have two halves of RAM: the game
+    writes one while the other is drawn, and the halves swap once a frame.
+    Here the halves are pointers into a ring of three buffers, so the swap
+    hands a buffer over without copying it.
+
+    A renderer holds the buffer it is drawing for the whole frame (hold()
+    to release()), so a swap made meanwhile, with the game already on the
+    next frame, doesn't pull it away: the buffer the game gets back is then
+    the spare, filled with a copy of the held one, so what the game sees
+    after a swap is the same as before. Without a renderer part way through
+    a frame, a swap is just an exchange of indices.
+
+    The ring holds N of T per buffer: the words of RAM, or for the sprites
+    also the sprite list decoded from them (hwsprites::SpriteList).
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+template <typename T, int N>
+class RamRing
+{
+    static_assert(std::is_trivially_copyable_v<T>, "buffers are copied and cleared as bytes");
+
+public:
+    // Buffer being written by the game (game thread only)
+    T* ram = buffers[0];
+
+    // Publish ram for drawing. ram then holds what was last published, as on the hardware.
+    void swap()
+    {
+        uint8_t s = state.load(std::memory_order_acquire);
+        int next;
+        for (;;) {
+            const int ready = s & 3;
+            const int held  = s >> 2;
+            next = (ready == held) ? (3 - write - ready) : ready;  // the spare, if ready is in use
+            if (state.compare_exchange_weak(s, uint8_t(write | (held << 2)),
+                                            std::memory_order_acq_rel, std::memory_order_acquire))
+                break;
+        }
+        if (next != (s & 3))
+            std::memcpy(buffers[next], buffers[s & 3], sizeof(buffers[0]));
+        write = next;
+        ram   = buffers[next];
+    }
+
+    // Buffer to draw: the one held, or else the last published
+    const T* frame() const
+    {
+        const uint8_t s = state.load(std::memory_order_acquire);
+        return buffers[(s >> 2) != NONE ? (s >> 2) : (s & 3)];
+    }
+
+    // Keep the last published buffer for drawing until release(), whatever is swapped meanwhile
+    void hold()
+    {
+        uint8_t s = state.load(std::memory_order_relaxed);
+        while (!state.compare_exchange_weak(s, uint8_t((s & 3) | ((s & 3) << 2)),
+                                            std::memory_order_acq_rel, std::memory_order_relaxed)) {}
+    }
+
+    void release()
+    {
+        uint8_t s = state.load(std::memory_order_relaxed);
+        while (!state.compare_exchange_weak(s, uint8_t((s & 3) | (NONE << 2)),
+                                            std::memory_order_acq_rel, std::memory_order_relaxed)) {}
+    }
+
+    // The last published buffer, for video snapshots (no renderer may be running)
+    T* ready_ram()             { return buffers[state.load(std::memory_order_acquire) & 3]; }
+    const T* ready_ram() const { return buffers[state.load(std::memory_order_acquire) & 3]; }
+
+    void clear() { std::memset(buffers, 0, sizeof(buffers)); }
+
+    static const int BYTES = N * sizeof(T);
+
+private:
+    static const int NONE = 3;
+
+    T buffers[3][N] = {};
+    int write = 0;
+    std::atomic<uint8_t> state{1 | (NONE << 2)};  // published buffer, plus held buffer << 2
+};
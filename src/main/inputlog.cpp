@@ -0,0 +1,264 @@
+/***************************************************************************
+    Input Recording and Playback.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "inputlog.hpp"
+#include "frontend/config.hpp"
+#include "sdl2/input.hpp"
+
+static const uint32_t MAGIC   = 0x4C494243; // "CBIL"
+static const uint32_t VERSION = 1;
+
+// What the engine takes from config.xml that changes how it plays
+struct Settings
+{
+    engine_settings_t engine;
+    int32_t ttrial_laps, ttrial_traffic, ttrial_quick_restart;
+    int32_t menu_enabled, menu_fast_boot;
+    int32_t gear, steer_speed, pedal_speed;
+    int32_t cont_traffic;
+    int32_t video_fps;
+};
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_bytes;      // sizeof(Header): a log from a build with other settings fails
+    uint32_t seed;              // given to srand()
+    Settings settings;
+};
+
+// One frame's controls
+struct Sample
+{
+    uint16_t keys;              // Input::keys[], bit per key; bit 15 = gamepad in use
+    uint8_t  wheel, accel, brake;
+    uint8_t  flags;             // bits 0-1 video.fps, bits 2-3 Input::analog
+
+    bool operator==(const Sample&) const = default;
+};
+
+struct Run
+{
+    uint16_t count;
+    Sample   sample;
+};
+#pragma pack(push, 1)
+struct RunRecord
+{
+    uint16_t count, keys;
+    uint8_t  wheel, accel, brake, flags;
+};
+#pragma pack(pop)
+static_assert(sizeof(RunRecord) == 8, "a run is 8 bytes");
+
+enum Mode { OFF, RECORDING, PLAYING };
+
+static Mode          mode = OFF;
+static bool          ended = false;
+static std::fstream  file;
+static std::string   file_path;
+static Run           run{};
+static bool          live_gamepad;  // as they were before playback
+static int           live_analog;
+
+// FNV-1a of the settings, shown so that two logs can be matched
+static uint32_t settings_hash(const Settings& s)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&s);
+    uint32_t hash = 0x811c9dc5;
+    for (size_t i = 0; i < sizeof(s); i++)
+        hash = (hash ^ p[i]) * 0x01000193;
+    return hash;
+}
+
+static Settings current_settings()
+{
+    Settings s;
+    std::memset(&s, 0, sizeof(s));
+    s.engine               = config.engine;
+    s.ttrial_laps          = config.ttrial.laps;
+    s.ttrial_traffic       = config.ttrial.traffic;
+    s.ttrial_quick_restart = config.ttrial.quick_restart;
+    s.menu_enabled         = config.menu.enabled;
+    s.menu_fast_boot       = config.menu.fast_boot;
+    s.gear                 = config.controls.gear;
+    s.steer_speed          = config.controls.steer_speed;
+    s.pedal_speed          = config.controls.pedal_speed;
+    s.cont_traffic         = config.cont_traffic;
+    s.video_fps            = config.video.fps;
+    return s;
+}
+
+static void apply_settings(const Settings& s)
+{
+    config.engine                = s.engine;
+    config.ttrial.laps           = s.ttrial_laps;
+    config.ttrial.traffic        = s.ttrial_traffic;
+    config.ttrial.quick_restart  = s.ttrial_quick_restart;
+    config.menu.enabled          = s.menu_enabled;
+    config.menu.fast_boot        = s.menu_fast_boot;
+    config.controls.gear         = s.gear;
+    config.controls.steer_speed  = s.steer_speed;
+    config.controls.pedal_speed  = s.pedal_speed;
+    config.cont_traffic          = s.cont_traffic;
+    config.video.fps             = s.video_fps;
+}
+
+static Sample capture()
+{
+    Sample s;
+    s.keys = 0;
+    for (int k = 0; k < 15; k++)
+        if (input.keys[k])
+            s.keys |= uint16_t(1 << k);
+    if (input.gamepad)
+        s.keys |= 0x8000;
+    s.wheel = uint8_t(std::clamp(input.a_wheel, 0, 0xff));
+    s.accel = uint8_t(std::clamp(input.a_accel, 0, 0xff));
+    s.brake = uint8_t(std::clamp(input.a_brake, 0, 0xff));
+    s.flags = uint8_t((config.video.fps & 3) | ((input.analog & 3) << 2));
+    return s;
+}
+
+static void apply(const Sample& s)
+{
+    for (int k = 0; k < 15; k++)
+        input.keys[k] = (s.keys >> k) & 1;
+    input.gamepad = (s.keys & 0x8000) != 0;
+    input.a_wheel = s.wheel;
+    input.a_accel = s.accel;
+    input.a_brake = s.brake;
+    input.analog  = (s.flags >> 2) & 3;
+    if (config.video.fps != (s.flags & 3))
+        config.set_fps(s.flags & 3);
+}
+
+static void write_run()
+{
+    const RunRecord r{ run.count, run.sample.keys, run.sample.wheel, run.sample.accel, run.sample.brake, run.sample.flags };
+    file.write(reinterpret_cast<const char*>(&r), sizeof(r));
+}
+
+static bool read_run()
+{
+    RunRecord r;
+    if (!file.read(reinterpret_cast<char*>(&r), sizeof(r)) || r.count == 0)
+        return false;
+    run.count  = r.count;
+    run.sample = { r.keys, r.wheel, r.accel, r.brake, r.flags };
+    return true;
+}
+
+bool inputlog::record(const std::string& path)
+{
+    stop();
+    file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "inputlog: unable to write " << path << std::endl;
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic        = MAGIC;
+    header.version      = VERSION;
+    header.header_bytes = sizeof(Header);
+    header.seed         = uint32_t(std::chrono::steady_clock::now().time_since_epoch().count());
+    header.settings     = current_settings();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    srand(header.seed);
+
+    file_path = path;
+    run.count = 0;
+    mode      = RECORDING;
+    std::cout << "inputlog: recording to " << path << " (settings " << std::hex << settings_hash(header.settings)
+              << std::dec << ")" << std::endl;
+    return true;
+}
+
+bool inputlog::playback(const std::string& path)
+{
+    stop();
+    file.open(path, std::ios::in | std::ios::binary);
+    Header header;
+    if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        std::cerr << "inputlog: unable to read " << path << std::endl;
+        file.close();
+        return false;
+    }
+    if (header.magic != MAGIC || header.version != VERSION || header.header_bytes != sizeof(Header)) {
+        std::cerr << "inputlog: " << path << " was recorded by another version of CannonBall-SE" << std::endl;
+        file.close();
+        return false;
+    }
+
+    apply_settings(header.settings);
+    srand(header.seed);
+
+    live_gamepad = input.gamepad;
+    live_analog  = input.analog;
+    file_path    = path;
+    run.count    = 0;
+    mode         = PLAYING;
+    ended        = false;
+    std::cout << "inputlog: playing " << path << " (settings " << std::hex << settings_hash(header.settings)
+              << std::dec << ")" << std::endl;
+    return true;
+}
+
+void inputlog::tick()
+{
+    if (mode == RECORDING) {
+        const Sample s = capture();
+        if (run.count && run.count < 0xffff && s == run.sample) {
+            run.count++;
+        } else {
+            if (run.count)
+                write_run();
+            run = { 1, s };
+        }
+    }
+    else if (mode == PLAYING) {
+        if (!run.count && !read_run()) {
+            std::cout << "inputlog: end of " << file_path << "; the controls are live again" << std::endl;
+            stop();
+            ended = true;
+            return;
+        }
+        run.count--;
+        apply(run.sample);
+    }
+}
+
+bool inputlog::playing()  { return mode == PLAYING; }
+bool inputlog::finished() { return ended; }
+
+void inputlog::stop()
+{
+    if (mode == RECORDING) {
+        if (run.count)
+            write_run();
+        file.flush();
+        if (!file)
+            std::cerr << "inputlog: unable to write " << file_path << std::endl;
+    }
+    else if (mode == PLAYING) {
+        std::fill(std::begin(input.keys), std::end(input.keys), false);
+        input.gamepad = live_gamepad;
+        input.analog  = live_analog;
+    }
+    if (file.is_open())
+        file.close();
+    mode = OFF;
+}
@@ -0,0 +1,48 @@
+/***************************************************************************
+    Input Recording and Playback.
+
+    Records the controls as the engine sees them each frame - the buttons
+    held, the wheel and pedal positions, whether a gamepad is in use and
+    the frame rate - so that a session can be played back exactly: the
+    engine runs the same given the same controls, settings and seed.
+
+    The log starts with the settings that steer the engine (engine, time
+    trial, menu and digital control settings) and the seed given to
+    srand(); playback applies these over config.xml, so a log plays back
+    as recorded on any machine running the same build. Frames follow as
+    runs of identical samples, 8 bytes a run, so a minute of play is
+    typically a few KB. Stored in native byte order, like the sprite cache.
+
+    The hi-score tables are still those on disk, and decide whether a run
+    reaches the name entry screen, so keep them the same where that
+    matters. With -turbo, a log plays back as fast as the CPU allows.
+
+    See -record and -playback.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace inputlog
+{
+    // Start recording to path, from the next tick(). False, with a message, if it can't be written.
+    bool record(const std::string& path);
+
+    // Load the log at path and apply its settings, for playback from the next tick().
+    // False, with a message, if it can't be read or is from another build.
+    bool playback(const std::string& path);
+
+    // Once a frame, after the controls are read: note them, or replace them with the log's
+    void tick();
+
+    bool playing();     // a log is being played back
+    bool finished();    // the log being played back has ended; the controls are live again
+
+    // Write out what is still held
+    void stop();
+}
@@ -0,0 +1,207 @@
+/***************************************************************************
+    Frame Job Scheduler.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <cstdint>
+#include "jobsystem.hpp"
+
+JobSystem jobsystem;
+
+// Index of the work queue owned by the current thread. Threads not started
+// by the job system (i.e. the main thread) share queue 0.
+static thread_local int tls_queue = 0;
+
+JobSystem::JobSystem()
+{
+}
+
+JobSystem::~JobSystem()
+{
+    stop();
+}
+
+void JobSystem::start(int workers, JobFn on_start)
+{
+    stop();
+    if (workers < 0) workers = 0;
+
+    queues.clear();
+    for (int i = 0; i <= workers; i++)
+        queues.push_back(std::make_unique<WorkQueue>());
+
+    stopping.store(false, std::memory_order_release);
+    for (int i = 1; i <= workers; i++)
+        threads.emplace_back(&JobSystem::worker_loop, this, i, on_start);
+}
+
+void JobSystem::stop()
+{
+    if (threads.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(idle_mtx);
+        stopping.store(true, std::memory_order_release);
+    }
+    idle_cv.notify_all();
+    for (auto& t : threads)
+        t.join();
+    threads.clear();
+}
+
+int JobSystem::this_queue() const
+{
+    return (tls_queue < int(queues.size())) ? tls_queue : 0;
+}
+
+void JobSystem::submit(JobCounter& counter, JobFn fn)
+{
+    submit_chain(counter, std::vector<JobFn>{ std::move(fn) });
+}
+
+void JobSystem::submit_chain(JobCounter& counter, std::initializer_list<JobFn> fns)
+{
+    submit_chain(counter, std::vector<JobFn>(fns));
+}
+
+void JobSystem::submit_chain(JobCounter& counter, std::vector<JobFn> fns)
+{
+    if (fns.empty()) return;
+    counter.pending.fetch_add(1, std::memory_order_acq_rel);
+
+    Job job;
+    job.chain   = std::make_shared<std::vector<JobFn>>(std::move(fns));
+    job.step    = 0;
+    job.counter = &counter;
+
+    if (queues.empty()) {
+        // Scheduler not started; run inline so callers needn't special-case it
+        execute(0, job);
+        return;
+    }
+    push(this_queue(), std::move(job));
+}
+
+void JobSystem::push(int queue_index, Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(queues[queue_index]->mtx);
+        queues[queue_index]->jobs.push_back(std::move(job));
+    }
+    queued.fetch_add(1, std::memory_order_release);
+    {
+        // take the lock so a worker can't miss the wake-up between its check and wait
+        std::lock_guard<std::mutex> lock(idle_mtx);
+    }
+    idle_cv.notify_one();
+}
+
+bool JobSystem::pop_or_steal(int queue_index, Job& job)
+{
+    const int n = int(queues.size());
+
+    // Own queue first, newest job (LIFO keeps chains warm in cache)
+    {
+        WorkQueue& q = *queues[queue_index];
+        std::lock_guard<std::mutex> lock(q.mtx);
+        if (!q.jobs.empty()) {
+            job = std::move(q.jobs.back());
+            q.jobs.pop_back();
+            queued.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+
+    // Steal the oldest job from somebody else
+    for (int i = 1; i < n; i++) {
+        WorkQueue& q = *queues[(queue_index + i) % n];
+        std::lock_guard<std::mutex> lock(q.mtx);
+        if (!q.jobs.empty()) {
+            job = std::move(q.jobs.front());
+            q.jobs.pop_front();
+            queued.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::execute(int queue_index, Job& job)
+{
+    (*job.chain)[job.step]();
+
+    if (++job.step < job.chain->size()) {
+        // Successor now ready. Queue it locally, or run it inline without a scheduler.
+        if (queues.empty())
+            execute(queue_index, job);
+        else
+            push(queue_index, std::move(job));
+        return;
+    }
+
+    // The counter can go as soon as it reads zero, so the wake-up is through the job system
+    if (job.counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        released.fetch_add(1, std::memory_order_acq_rel);
+        released.notify_all();
+    }
+}
+
+bool JobSystem::run_one(int queue_index)
+{
+    Job job;
+    if (!pop_or_steal(queue_index, job))
+        return false;
+    execute(queue_index, job);
+    return true;
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    const int q = queues.empty() ? -1 : this_queue();
+    for (;;) {
+        // read before the counter, so that a release after the check below changes it
+        const uint32_t seen = released.load(std::memory_order_acquire);
+        if (counter.pending.load(std::memory_order_acquire) == 0) return;
+        // help out rather than block, if anything is queued
+        if (q >= 0 && run_one(q)) continue;
+        released.wait(seen, std::memory_order_acquire);
+    }
+}
+
+void JobSystem::parallel_for(int begin, int end, const std::function<void(int, int)>& fn)
+{
+    const int n     = end - begin;
+    const int parts = std::min(n, worker_count() + 1);
+    if (parts <= 1) {
+        if (n > 0) fn(begin, end);
+        return;
+    }
+    // A local is safe: no job touches the counter once wait() can see it released
+    JobCounter counter;
+    for (int p = 0; p < parts; p++) {
+        const int first = begin + int(int64_t(n) * p / parts);
+        const int last  = begin + int(int64_t(n) * (p + 1) / parts);
+        submit(counter, [&fn, first, last] { fn(first, last); });
+    }
+    wait(counter);
+}
+
+void JobSystem::worker_loop(int queue_index, JobFn on_start)
+{
+    tls_queue = queue_index;
+    if (on_start) on_start();
+    while (true) {
+        if (run_one(queue_index)) continue;
+
+        std::unique_lock<std::mutex> lock(idle_mtx);
+        idle_cv.wait(lock, [&] {
+            return stopping.load(std::memory_order_acquire) ||
+                   queued.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping.load(std::memory_order_acquire) &&
+            queued.load(std::memory_order_acquire) == 0)
+            break;
+    }
+}
@@ -0,0 +1,110 @@
+/***************************************************************************
+    Frame Job Scheduler.
+
+    Small work-stealing job system used to spread each frame across all
+    available cores. Each worker owns a deque; it pops its own work from the
+    back and steals from the front of other workers' deques when idle.
+
+    Jobs are grouped against a JobCounter, which the submitting thread can
+    wait on. Waiting threads help execute queued jobs rather than blocking.
+    Dependent work is expressed as a chain - each job in a chain is queued
+    only when the previous one has completed.
+
+    It is the only pool: the start-up work (ROM conversion, the Blargg
+    tables, the CRT overlay) is split across it with parallel_for, rather
+    than by OpenMP, whose idle threads would spin behind the frame's.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tracks outstanding jobs (or chains of jobs) submitted against it.
+struct JobCounter
+{
+    std::atomic<int> pending{0};
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+class JobSystem
+{
+public:
+    using JobFn = std::function<void()>;
+
+    JobSystem();
+    ~JobSystem();
+
+    // Start 'workers' background threads. The calling thread participates
+    // when it waits, so a 4-core machine would use 3 workers. Each worker
+    // runs 'on_start' first, if given (e.g. to set its scheduling policy).
+    void start(int workers, JobFn on_start = nullptr);
+    void stop();
+
+    int  worker_count() const { return int(threads.size()); }
+    bool running() const      { return !threads.empty(); }
+
+    // Queue an independent job.
+    void submit(JobCounter& counter, JobFn fn);
+
+    // Queue a chain of dependent jobs. Each runs after the previous one has
+    // completed; the counter is released when the last job finishes.
+    void submit_chain(JobCounter& counter, std::initializer_list<JobFn> fns);
+    void submit_chain(JobCounter& counter, std::vector<JobFn> fns);
+
+    // Wait for all jobs against the counter, running queued work meanwhile. The job system is
+    // done with the counter once this returns, so it may be a local.
+    void wait(JobCounter& counter);
+
+    // Run fn(first, last) over [begin, end), split into a range per thread (the caller's
+    // included), and wait for them. Inline without a scheduler.
+    void parallel_for(int begin, int end, const std::function<void(int, int)>& fn);
+
+private:
+    struct Job
+    {
+        std::shared_ptr<std::vector<JobFn>> chain; // chain[step] is run by this job
+        size_t      step    = 0;
+        JobCounter* counter = nullptr;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex      mtx;
+        std::deque<Job> jobs;
+    };
+
+    // Queue 0 is used by the main (or any non-worker) thread; 1..n by workers
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread>                threads;
+
+    // Idle workers sleep here until work is queued
+    std::mutex              idle_mtx;
+    std::condition_variable idle_cv;
+    std::atomic<int>        queued{0};
+    std::atomic<bool>       stopping{false};
+
+    // Bumped as each counter is released, after which its job leaves it alone: waiters sleep on
+    // this rather than on the counter, which its owner may free as soon as it reads zero
+    std::atomic<uint32_t>   released{0};
+
+    void push(int queue_index, Job job);
+    bool pop_or_steal(int queue_index, Job& job);
+    bool run_one(int queue_index);
+    void execute(int queue_index, Job& job);
+    void worker_loop(int queue_index, JobFn on_start);
+    int  this_queue() const;
+};
+
+extern JobSystem jobsystem;
@@ -0,0 +1,77 @@
+/***************************************************************************
+    Record Journal.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include "journal.hpp"
+#include "utils.hpp"
+
+// Slot: sequence number, the words, CRC32 of those, each little endian
+static void put_word(uint8_t* p, uint32_t w)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = uint8_t(w >> (i * 8));
+}
+
+static uint32_t get_word(const uint8_t* p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+bool journal::read(const std::string& file, uint32_t* words, int count, uint32_t& seq)
+{
+    FILE* f = fopen(file.c_str(), "rb");
+    if (!f)
+        return false;
+
+    const size_t slot = size_t(count + 2) * 4;
+    std::vector<uint8_t> buf(slot * SLOTS);
+    const size_t slots = fread(buf.data(), 1, buf.size(), f) / slot;
+    fclose(f);
+
+    bool found = false;
+    for (size_t s = 0; s < slots; s++)
+    {
+        const uint8_t* p = &buf[s * slot];
+        const uint32_t n = get_word(p);
+        if (get_word(p + slot - 4) != Utils::crc32(p, slot - 4) || (found && n <= seq))
+            continue;
+        seq   = n;
+        found = true;
+        for (int i = 0; i < count; i++)
+            words[i] = get_word(p + 4 + i * 4);
+    }
+    return found;
+}
+
+bool journal::write(const std::string& file, const uint32_t* words, int count, uint32_t seq)
+{
+    const size_t slot = size_t(count + 2) * 4;
+    std::vector<uint8_t> rec(slot);
+    put_word(&rec[0], seq);
+    for (int i = 0; i < count; i++)
+        put_word(&rec[4 + i * 4], words[i]);
+    put_word(&rec[slot - 4], Utils::crc32(rec.data(), slot - 4));
+
+    FILE* f = fopen(file.c_str(), "r+b");
+    if (!f)
+        f = fopen(file.c_str(), "w+b");
+    if (!f) {
+        std::cerr << "Could not open " << file << std::endl;
+        return false;
+    }
+
+    // Slots of a new file not yet written read back as zeros, which fail the check
+    const bool ok = fseek(f, long((seq % SLOTS) * slot), SEEK_SET) == 0 &&
+                    fwrite(rec.data(), 1, slot, f) == slot &&
+                    fflush(f) == 0;
+    fclose(f);
+    if (!ok)
+        std::cerr << "Could not write to " << file << std::endl;
+    return ok;
+}
@@ -0,0 +1,32 @@
+/***************************************************************************
+    Record Journal.
+
+    A small file of fixed-size slots, each holding one record: a sequence
+    number, the record's words and a CRC32 of both. Record n goes in slot
+    n % SLOTS, written in place, so saving a record touches only its slot
+    and a write cut short spoils only the record being written; the one
+    before is still there to be read. The latest record is the valid one
+    with the highest sequence number.
+
+    Used for the play stats (data.binary_saves), which are saved every
+    minute the game runs.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace journal
+{
+    const int SLOTS = 64;
+
+    // The latest valid record of count words in file, and its sequence number. False if none.
+    bool read(const std::string& file, uint32_t* words, int count, uint32_t& seq);
+
+    // Write words as record seq
+    bool write(const std::string& file, const uint32_t* words, int count, uint32_t seq);
+}
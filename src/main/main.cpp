@@ -22,6 +22,7 @@
 // SDL Specific Code
 #include "sdl2/timer.hpp"
 #include "sdl2/input.hpp"
+#include "sdl2/evdev.hpp"
 
 #include "video.hpp"
 
@@ -42,17 +43,42 @@
 #include "directx/ffeedback.hpp"
 
 // Multi-threading support
-// This implementation runs three parts of frame rendering in parallel to enable 60fps operation even on
-// Raspberry Pi Zero 2W (requires 450MHz GPU clock).
+// Frame rendering is split into jobs which are spread across all available cores, enabling 60fps
+// operation even on Raspberry Pi Zero 2W (requires 450MHz GPU clock).
+#include "jobsystem.hpp"
+#include "threadpolicy.hpp"
+#include "frametrace.hpp"
+#include "enginecost.hpp"
+#include "flightrec.hpp"
+#include "bootprof.hpp"
+#include "telemetry.hpp"
+#include "framearena.hpp"
+#include "framepacer.hpp"
+#include "fpsauto.hpp"
+#include "quality.hpp"
+#include "attractgov.hpp"
+#include "persist.hpp"
+#include "haptics.hpp"
+#include "outlink.hpp"
+#include "motorloop.hpp"
+#include "inputlog.hpp"
+#include "framerec.hpp"
+#include "batchrender.hpp"
+#include "twinlink.hpp"
+#include "engine/oroad.hpp"
+#include "engine/oinitengine.hpp"
+#include "engine/ostats.hpp"
 #include <thread>
 #include <mutex>
 #include <chrono>
-#include <semaphore>
-#include <omp.h>
 #include <condition_variable>
 #include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
 #include <algorithm>
 #include <atomic>
+#include <vector>
 
 #ifdef _WIN32
   #include <thread>
@@ -131,6 +157,12 @@ static uint32_t perf_end_frame = 0;
           sigaction(s, &sa, nullptr);
       }
   }
+
+  // SIGUSR1 writes the frame timeline, when kept (see frametrace.hpp)
+  static void trace_signal_handler(int)
+  {
+      frametrace::request_dump();
+  }
 #endif
 
 
@@ -172,13 +204,14 @@ double  cannonball::frame_ms            = 0;
 int     cannonball::frame               = 0;
 bool    cannonball::tick_frame          = true;
 int     cannonball::fps_counter         = 0;
+int     cannonball::dropped_percent     = 0;
 int     cannonball::fps_lock            = 0; // 0=no lock (auto), 30(fps), 60(fps)
 bool    cannonball::singlecore_detect   = true;
 bool    cannonball::singlecore_mode     = false;
-// fps_eval_period is the interval at which 30/60 fps is evaluated in auto mode. Starts at
-// 4 (seconds), and is doubled every time a switch back to 30fps happens
+// fps_eval_period is the interval at which 30/60 fps is evaluated in auto mode (seconds). Stages
+// that drop back to 30fps are remembered by fpsauto rather than waiting longer between tries.
 long    cannonball::fps_eval_period     = 4;
-int     cannonball::game_threads        = omp_get_max_threads();
+int     cannonball::game_threads        = std::max(1, int(std::thread::hardware_concurrency()));
 bool    cannonball::perftest            = false;
 
 // ------------------------------------------------------------------------------------------------
@@ -193,7 +226,28 @@ bool pause_engine;
 
 static void quit_func(int code)
 {
+    // Engine cost by stage and game state, for the whole run
+    if (config.video.trace) {
+        std::ostringstream cost;
+        enginecost::report(cost);
+        std::cout << "\n" << cost.str();
+        if (config.video.trace == 2) {
+            std::ofstream file(config.data.save_path + "enginecost.txt");
+            file << cost.str();
+        }
+    }
+    config.flush_stats();
+    inputlog::stop();
+    framerec::stop();
+    batchrender::stop();
+    flightrec::stop();
+    persist::stop();
     audio.stop_audio();
+    evdev::stop();
+    haptics::stop();
+    motorloop::stop();
+    outlink::stop();
+    twinlink::stop();
     input.close_joy();
     forcefeedback::close();
     if (menu) delete menu;
@@ -263,10 +317,45 @@ static void process_events(void)
                 break;
         }
     }
+
+    input.read_evdev();
+}
+
+// Input latch (controls.latch_ms): the tick of a frame to be drawn waits until this far into the
+// frame before reading the controls, so the frame is steered by more recent input when shown.
+// Low latency mode already starts each frame as late as it can. The wait is made on the frame's
+// own thread, never in a job, where it would hold a worker the render bands could use.
+static std::chrono::steady_clock::time_point frameBegan;
+
+static bool latching()
+{
+    return config.controls.latch_ms > 0 && !config.video.low_latency;
+}
+
+static void latch_input()
+{
+    if (latching())
+        std::this_thread::sleep_until(frameBegan + std::chrono::milliseconds(config.controls.latch_ms));
+}
+
+// When tick() last read the controls (frametrace::now()). The threaded pipeline shows a frame
+// two loop iterations after its tick, so those ticks are kept; the other paths show it in the
+// same iteration. Presenting a frame records the time since (frametrace::LATENCY).
+static uint64_t inputLatched = 0;
+static std::atomic<bool> inputSeen{false};   // a control pressed since the governor last looked
+static uint64_t latchRing[4] = {};
+static uint32_t latchFrames  = 0;
+
+static void record_latency(uint64_t latched)
+{
+    if (latched)
+        frametrace::record(frametrace::LATENCY, latched);
 }
 
 static void tick()
 {
+    frametrace::Scope trace(frametrace::TICK);
+
     frame++;
 
     // Determine whether to tick certain logic for the current frame.
@@ -274,7 +363,11 @@ static void tick()
                  (((frame & 1) == 0) ? 1 : 0)
                  : 1;
 
+    inputLatched = frametrace::now();
     process_events();
+    inputlog::tick();
+    if (std::any_of(std::begin(input.keys), std::end(input.keys), [](bool k) { return k; }))
+        inputSeen.store(true, std::memory_order_relaxed);
 
     if (tick_frame) {
         oinputs.tick();           // Do Controls
@@ -291,6 +384,8 @@ static void tick()
 
             if (!pause_engine || input.has_pressed(Input::STEP))
                 outrun.tick(tick_frame);
+            if (outrun.game_state == GS_ATTRACT && bootprof::ready("attract mode"))
+                cannonball::state = STATE_QUIT;   // -startup-bench
 
             if (tick_frame) input.frame_done();
         }
@@ -303,6 +398,7 @@ static void tick()
             } else {
                 tick_frame = true;
                 pause_engine = false;
+                bootprof::Phase phase("boot");
                 outrun.init();
                 cannonball::state = STATE_GAME;
             }
@@ -310,6 +406,7 @@ static void tick()
         break;
 
         case STATE_MENU:
+            bootprof::ready("menu");
             menu->tick();
             input.frame_done();
             break;
@@ -348,6 +445,7 @@ static void play_stats_and_watchdog_updater() {
     // Updates every minute in a seperate thread since SD-card access can be slow
     // and we don't want to hold up the game engine.
     // Also kicks system watchdog when compiled for Linux
+    threadpolicy::apply(threads_settings_t::STATS);
 
 #ifdef __linux__
     // Open the watchdog device. Note - device name is defined in globals.hpp
@@ -369,7 +467,16 @@ static void play_stats_and_watchdog_updater() {
 
     Timer run_time;
     run_time.start();
+    int polls = 0;
     while (cannonball::state != STATE_QUIT) {
+        // SoC temperature for the attract mode governor and telemetry, every 5 seconds
+        const bool export_metrics = !config.data.telemetry.empty();
+        const int  poll = polls++;
+        if ((config.video.attract_idle > 0 || export_metrics) && poll % 10 == 0)
+            attractgov::poll();
+        // Metrics for fleet monitoring (see telemetry.hpp)
+        if (export_metrics && poll % (telemetry::PERIOD_MS / 500) == 0)
+            telemetry::write(config.data.telemetry);
         if ((run_time.get_ticks() >= 60000) &&
             (cannonball::state == STATE_GAME) ) {
             config.stats.runtime++;  // increment machine run-time counter by 1 (minute)
@@ -394,69 +501,267 @@ static void play_stats_and_watchdog_updater() {
 }
 
 
-// Semaphore based threading for video rendering
-// used to spread the load across all available cores
+// Job based threading for video rendering
+// used to spread the load across all available cores. Each frame is submitted as:
+// - one job per render band, processing the last complete frame (Blargg filter or RGB conversion)
+// - a chain of dependent jobs for game logic, audio and each S16 hardware layer of the next frame
+// whilst the main thread presents, then helps with any remaining work.
+// With video.overlap_logic the layer jobs are for the frame ticked in the loop before, and are a
+// chain of their own beside the game logic's, which then has the whole loop to run in.
+// The loop only waits for the chains. The render bands have a second frame to finish in (Video
+// keeps a ring of pixel buffers for this), so a slow filter pass doesn't make the loop drop frames.
+// With the input latch, the game logic's chain is held back until the frame is presented and the
+// latch time reached (submit_logic_jobs()), the wait being made by the loop's thread.
 
-static std::binary_semaphore renderReady0{0};
-static std::binary_semaphore renderReady1{0};
-static std::binary_semaphore renderDone0{0};
-static std::binary_semaphore renderDone1{0};
-static std::binary_semaphore* const renderReady[2] = { &renderReady0, &renderReady1 };
-static std::binary_semaphore* const renderDone [2] = { &renderDone0,  &renderDone1  };
+static JobCounter frameJobs;
+static JobCounter renderJobs;
 
-static std::binary_semaphore prepareReady{0};
-static std::binary_semaphore prepareDone {0};
-
-static std::atomic<bool> running{true};
+// The game logic of the next frame, then (unless drawn a loop later) its layers
+static void submit_logic_jobs(bool logic_on_main)
+{
+    std::vector<JobSystem::JobFn> chain;
+    if (logic_on_main) {
+        // input must be handled on the main thread, so tick here before queueing the layers
+        tick();
+        audio.tick();
+    } else {
+        chain.push_back([] { tick(); });
+        chain.push_back([] { audio.tick(); });
+    }
+    if (!config.video.overlap_logic) {
+        for (int stage = Video::PREPARE_BEGIN; stage < Video::PREPARE_STAGES; stage++)
+            chain.push_back([=] { video.prepare_stage(stage); });
+    }
+    if (!chain.empty())
+        jobsystem.submit_chain(frameJobs, std::move(chain));
+}
 
-void render_thread(int renderthreads, int id)
+static void submit_frame_jobs(int render_bands, bool logic_on_main)
 {
-    while (running.load(std::memory_order_acquire)) {
-        renderReady[id]->acquire();
-        if (!running.load(std::memory_order_acquire)) break;
-        video.render_frame((renderthreads==1 ? -1 : id));
-        renderDone[id]->release();
+    // the last filter pass must be complete before its output is shown and the next one starts
+    jobsystem.wait(renderJobs);
+    video.swap_render_buffers();
+
+    for (int id = 0; id < render_bands; id++)
+        jobsystem.submit(renderJobs, [=] { video.render_frame(id, render_bands); });
+
+    if (config.video.overlap_logic) {
+        // the layers of the frame ticked last time round are drawn whilst the next is ticked
+        video.publish_frame(true);
+        std::vector<JobSystem::JobFn> chain;
+        for (int stage = Video::PREPARE_BEGIN; stage < Video::PREPARE_STAGES; stage++)
+            chain.push_back([=] { video.prepare_stage(stage); });
+        jobsystem.submit_chain(frameJobs, std::move(chain));
     }
+    if (!latching())
+        submit_logic_jobs(logic_on_main);
 }
 
-void prepare_thread() {
-    while (running.load(std::memory_order_acquire)) {
-        prepareReady.acquire();
-        if (!running.load(std::memory_order_acquire)) break;
+
+// Low latency mode: the frame just ticked is prepared and filtered one horizontal slice at a
+// time, and the main thread (which owns the GL context) uploads each slice as soon as it is
+// ready, so the frame can be presented in the same loop iteration it was ticked in.
+// The slice count divides the S16 height, so hi-res slices start on even lines.
+
+static const int LOW_LATENCY_SLICES = 8;
+static std::atomic<int> slicesReady{0};
+
+static void run_low_latency_frame(bool using_threading, bool logic_on_main)
+{
+    if (!using_threading) {
         tick();
         audio.tick();
-        video.prepare_frame();
-        prepareDone.release();
+        for (int slice = 0; slice < LOW_LATENCY_SLICES; slice++) {
+            video.prepare_slice(slice, LOW_LATENCY_SLICES);
+            video.upload_slice(slice, LOW_LATENCY_SLICES);
+        }
+        return;
     }
+
+    slicesReady.store(0, std::memory_order_release);
+
+    std::vector<JobSystem::JobFn> chain;
+    if (logic_on_main) {
+        tick();
+        audio.tick();
+    } else {
+        chain.push_back([] { tick(); });
+        chain.push_back([] { audio.tick(); });
+    }
+    for (int slice = 0; slice < LOW_LATENCY_SLICES; slice++) {
+        chain.push_back([=] {
+            video.prepare_slice(slice, LOW_LATENCY_SLICES);
+            slicesReady.fetch_add(1, std::memory_order_acq_rel);
+            slicesReady.notify_all();
+        });
+    }
+    jobsystem.submit_chain(frameJobs, std::move(chain));
+
+    // upload each slice whilst the next is being prepared
+    for (int slice = 0; slice < LOW_LATENCY_SLICES; slice++) {
+        int ready;
+        while ((ready = slicesReady.load(std::memory_order_acquire)) <= slice)
+            slicesReady.wait(ready, std::memory_order_acquire);
+        video.upload_slice(slice, LOW_LATENCY_SLICES);
+    }
+    jobsystem.wait(frameJobs);
 }
 
 
-void pin_thread_to_core(std::thread& t, int core_id) {
-#ifdef _WIN32
-        std::cerr << "Error setting affinity for thread to core: "
-                  << "CannonBall-SE does not support thread pinning on Windows" << "\n";
-    return;
+// Present thread mode: main_loop() runs on a thread of its own and never waits on a buffer swap.
+// Each completed frame is published here, and the main thread (which owns the SDL window and GL
+// context) presents the newest one. RenderSurface keeps three game surfaces, so the game always
+// has one to draw into whilst another is being shown. A video restart recreates the GL context,
+// so it is handed to the main thread whilst the game waits.
+
+static bool threadedPresent = false;
+static std::atomic<int> presentRepeats{0};   // refreshes shown between frames (video.high_refresh)
+static std::mutex presentMtx;
+static std::condition_variable presentCv;
+static uint64_t framesPublished = 0;
+static uint64_t publishedLatch  = 0;   // when the controls were read for the frame published
+static bool restartPending = false;
+
+static bool use_present_thread()
+{
+#ifdef WIN32
+    // input must be on the main thread, so the game can't leave it
+    return false;
 #else
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(core_id, &cpuset);
+    return config.video.present_thread && (cannonball::game_threads > 1) && !config.video.low_latency;
+#endif
+}
+
+// Memory held by each part of the emulation once started, and the process's resident total
+static void report_memory()
+{
+    auto kb = [](size_t bytes) { return (bytes + 1023) / 1024; };
+    auto rom = [](const RomLoader& r) { return size_t(r.rom ? r.length : 0); };
+
+    const size_t cpu_roms   = rom(roms.rom0) + rom(roms.rom1) + rom(roms.j_rom0) + rom(roms.j_rom1);
+    const size_t sound_roms = rom(roms.z80) + rom(roms.pcm);
+    const size_t gfx_roms   = rom(roms.tiles) + rom(roms.sprites) + rom(roms.road);
 
-    pthread_t handle = t.native_handle();
-    int err = pthread_setaffinity_np(handle, sizeof(cpuset), &cpuset);
-    if (err != 0) {
-        std::cerr << "Error setting affinity for thread to core "
-                  << core_id << ": " << std::strerror(err) << "\n";
+    std::cout << "Memory: CPU ROMs " << kb(cpu_roms) << "KB, sound ROMs " << kb(sound_roms) << "KB, graphics ROMs "
+              << kb(gfx_roms) << "KB" << (config.data.lean_memory ? " (freed once converted)" : "")
+              << ", converted graphics " << kb(video.graphics_bytes()) << "KB, frame buffers "
+              << kb(framearena::used()) << "KB";
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line); ) {
+        if (line.rfind("VmRSS:", 0) == 0) {
+            std::istringstream fields(line.substr(6));
+            size_t rss_kb = 0;
+            fields >> rss_kb;
+            std::cout << ", resident " << rss_kb << "KB";
+        }
     }
 #endif
+    std::cout << std::endl;
+}
+
+// The engine's attract mode, with no game or menu under way
+static bool attract_mode()
+{
+    return cannonball::state == STATE_GAME &&
+           (outrun.game_state <= GS_LOGO || outrun.game_state == GS_REINIT);
+}
+
+static void restart_video()
+{
+    video.disable();
+    config.video.hires = config.video.hires_next;
+    video.init(&roms, &config.video);
+    video.sprite_layer->set_x_clip(false);
+    config.videoRestartRequired = false;
+}
+
+static void publish_frame(uint64_t latched)
+{
+    {
+        std::lock_guard<std::mutex> lock(presentMtx);
+        framesPublished++;
+        publishedLatch = latched;
+    }
+    presentCv.notify_all();
+}
+
+// Called by the game thread; returns once the main thread has restarted the video
+static void request_video_restart()
+{
+    std::unique_lock<std::mutex> lock(presentMtx);
+    restartPending = true;
+    presentCv.notify_all();
+    presentCv.wait(lock, [] { return !restartPending; });
+}
+
+// video.high_refresh: the refreshes between frames, each waiting on vsync. Returns the time taken (ms).
+static double repeat_frames()
+{
+    const int repeats = presentRepeats.load(std::memory_order_relaxed);
+    if (repeats == 0)
+        return 0.0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+        if (!video.repeat_frame(config.video.high_refresh == 2))
+            break;
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void present_loop()
+{
+    uint64_t shown = 0;
+    while (cannonball::state != STATE_QUIT) {
+        std::unique_lock<std::mutex> lock(presentMtx);
+        // the timeout picks up STATE_QUIT even if no further frames arrive
+        presentCv.wait_for(lock, std::chrono::milliseconds(100),
+                           [&] { return restartPending || framesPublished != shown; });
+        if (restartPending) {
+            restart_video();
+            restartPending = false;
+            lock.unlock();
+            presentCv.notify_all();
+            continue;
+        }
+        if (framesPublished == shown) continue;
+        shown = framesPublished;
+        const uint64_t latched = publishedLatch;
+        lock.unlock();
+
+        // with vsync, this blocks the main thread only
+        video.present_frame();
+        record_latency(latched);
+        repeat_frames();
+    }
+}
+
+
+// Refreshes to show between frames at fps: on a display at a whole multiple of it, with vsync on
+// and video.high_refresh set, so that vsync still paces the loop. 0 otherwise.
+static int refresh_repeats(int refresh_rate, int fps)
+{
+    if (!config.video.high_refresh || config.video.vsync != 1 || config.video.vrr ||
+        refresh_rate <= fps || refresh_rate % fps != 0)
+        return 0;
+    return refresh_rate / fps - 1;
 }
 
+// Time per frame at fps (30 or 60). On a VRR display, video.vrr_rate can set the rate exactly.
+static std::chrono::duration<double> frame_duration(int fps)
+{
+    double rate = fps;
+    if (config.video.vrr && config.video.vrr_rate > 0)
+        rate = (config.video.vrr_rate / 100.0) * fps / 60.0;
+    return std::chrono::duration<double>(1.0 / rate);
+}
 
 static void main_loop() {
+    threadpolicy::apply(threads_settings_t::GAME);
+
     // Determine frame rate. Use auto (30/60) unless override was set on command-line
     int configured_fps = (cannonball::fps_lock == 60 ? 60 : 30);
     config.video.fps   = (configured_fps == 30 ? 0 : 2);
     config.set_fps(config.video.fps);
-    double targetFPS   = static_cast<double>(configured_fps);
 
     // Track whether vsync is enabled
     bool vsync = false;
@@ -464,58 +769,49 @@ static void main_loop() {
     SDL_DisplayMode displayMode;
     if (SDL_GetCurrentDisplayMode(0, &displayMode) == 0) {
         // Can retrieve monitor refresh rate
-        vsync = (displayMode.refresh_rate == configured_fps) && SDL_GL_GetSwapInterval() && (config.video.vsync == 1);
+        presentRepeats = refresh_repeats(displayMode.refresh_rate, configured_fps);
+        vsync = (displayMode.refresh_rate == configured_fps || presentRepeats > 0) && SDL_GL_GetSwapInterval() &&
+                (config.video.vsync == 1) && !config.video.vrr;
+        if (presentRepeats > 0)
+            std::cout << "INFO: " << displayMode.refresh_rate << "Hz display: each frame shown for "
+                      << (presentRepeats + 1) << " refreshes" << (config.video.high_refresh == 2 ? ", black between.\n" : ".\n");
         std::cout << "INFO: ";
-        if (config.video.vsync != 1)
+        if (config.video.vrr)
+            std::cout << "Variable refresh rate: frames shown as soon as ready, at "
+                      << (1.0 / frame_duration(60).count()) << "fps. ";
+        else if (config.video.vsync != 1)
             std::cout << "VSync is disabled by setting in config.xml. ";
         std::cout << "Display reports refresh rate is " << displayMode.refresh_rate << "Hz.";
-        if ((config.video.vsync == 1) && (displayMode.refresh_rate == 60) && (cannonball::fps_lock != 30))
+        if ((config.video.vsync == 1) && !config.video.vrr && (displayMode.refresh_rate == 60) && (cannonball::fps_lock != 30))
             std::cout << " VSync will be used for 60fps mode.\n";
         else
             std::cout << "\n";
     }
+    // the game thread is paced by the timer; presentation follows it
+    if (threadedPresent) vsync = false;
 
     // Determine if we'll be using threaded or sequential rendering
     int threads = cannonball::game_threads;
 
 #ifdef WIN32
-    // On Windows, input must be on the main thread. We therefore cap the thread-count to 3,
-    // thereby setting prepare_threads to 0 (below)
-    if (threads > 3) threads = 3;
+    // On Windows, input must be on the main thread, so game logic is ticked there before the
+    // hardware layers are queued.
+    const bool logic_on_main = true;
 #else
-    // On Linux, we can use up to 4 threads
-    if (threads > 4) threads = 4; // max used by cannonball-se
+    const bool logic_on_main = false;
 #endif
 
     int using_threading = (threads > 1);
-    int render_threads = (threads > 2 ? 2 : 1);
-    int prepare_threads = (threads >= 4);
-
-    std::thread t0;
-    std::thread t1;
-    std::thread t2;
-    if (using_threading) {
-        // Create worker threads.
+    int render_threads  = std::max(threads - 1, 1);
+
+    if (using_threading)
         std::cout << "Using " << threads << " threads (" << render_threads << " renderer threads)" << std::endl;
-        if (prepare_threads) {
-            // prepare_thread produces the S16 output - road, sky, sprites etc
-            // Note - this thread also launches the sound callback, so don't pin this thread to one core.
-            t0 = std::thread(prepare_thread);
-        }
-        // render_threads process with S16 output with Blargg filter, if enabled,
-        // or convert the S16 palette-based output to RGB otherwise
-        t1 = std::thread(render_thread,render_threads,0);
-        // pin_thread_to_core(t1,2);
-        if (render_threads == 2) {
-            t2 = std::thread(render_thread,render_threads,1);
-            // pin_thread_to_core(t2,3);
-        }
-    }
 
-    SDL_Delay(500); // let system stabalise
+    if (!config.menu.fast_boot)
+        SDL_Delay(500); // let system stabalise
 
     // Duration per frame (in seconds)
-    auto frameDuration = std::chrono::duration<double>(1.0 / targetFPS);
+    auto frameDuration = frame_duration(configured_fps);
 
     // Set the next frame time to now + frameDuration
     // we do x10 for the first frame so the special start frame can be seen.
@@ -526,13 +822,20 @@ static void main_loop() {
     int renderedFrames = 0;
     int droppedFrames = 0;
     auto fpsTimer = std::chrono::steady_clock::now();
+    int tracePeriods = 0;
+    uint64_t frameTrace = frametrace::now();
+    const std::string tracePath = config.data.save_path + "frametrace.json";
+
+    // Auto 30/60fps: frame times are sampled for fpsauto, with the stages it has already learned
+    auto lastFrameStart = std::chrono::steady_clock::time_point{};
+    fpsauto::set_stages(config.video.fps_remember ? config.video.fps_stages : 0);
 
-    // Performance check variables (10-second evaluation).
-    auto performanceCheckStart = std::chrono::steady_clock::now();
-    int totalRenderedFramesForCheck = 0;
-    // For 30 FPS, accumulate sleep time and frame count.
-    std::chrono::duration<double> totalSleepTime(0);
-    int frameCountForSleep = 0;
+    // Low latency mode: when the last frame was shown, and how long recent frames took to draw
+    auto lastPresent = std::chrono::steady_clock::now();
+    std::chrono::duration<double> lowLatencyWork(0);
+
+    // High refresh displays: time spent this frame on the refreshes between frames
+    double repeatMs = 0.0;
 
     // Go!
 
@@ -548,19 +851,21 @@ static void main_loop() {
         #endif
 
         frameCounter++;
+        repeatMs = 0.0;
         auto now = std::chrono::steady_clock::now();
 
-        // If running at 30 FPS, count this frame for sleep evaluation.
-        frameCountForSleep += (configured_fps == 30);
-
         // If we're behind schedule and not forcing a render, drop this frame
         // always render every 4th frame at least
+        // On a VRR display, a frame less than a frame late is shown late rather than dropped
         bool forceRender = ((frameCounter & 3) == 3);
-        if (!forceRender && now > nextFrameTime) {
+        const auto dropAfter = config.video.vrr ? nextFrameTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(frameDuration)
+                                                : nextFrameTime;
+        if (!forceRender && now > dropAfter) {
             // Update game logic for missed frame
             tick();
             audio.tick();
             ++droppedFrames;
+            fpsauto::add_dropped();
             nextFrameTime = (now + frameDuration); // reset time next frame is due
             // Skip heavy work this frame; return to top of while loop
             continue;
@@ -569,63 +874,109 @@ static void main_loop() {
         // ---- LAUNCH WORKER TASKS & RENDERING ----
 
         renderedFrames++;
-        totalRenderedFramesForCheck++;  // For performance evaluation
+        frameBegan = now;
+
+        if (config.video.low_latency) {
+            // With vsync, the last present returned at about the last refresh. Start this frame
+            // only as early as recent frames need, so input is read as late as possible.
+            if (vsync && !perftest) {
+                auto start = lastPresent +
+                             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 frameDuration - (lowLatencyWork * 1.25) - std::chrono::milliseconds(2));
+                if (start > std::chrono::steady_clock::now())
+                    std::this_thread::sleep_until(start);
+            }
 
-        if (using_threading) {
-            // Set NTSC filter to work on the last complete frame immediately
-            renderReady0.release();
-            if (render_threads==2) renderReady1.release();
+            auto workStart = std::chrono::steady_clock::now();
+            run_low_latency_frame(using_threading, logic_on_main);
+            lowLatencyWork = (lowLatencyWork * 0.9) + ((std::chrono::steady_clock::now() - workStart) * 0.1);
 
-            // Set sprite gen to work if we're threading that too
-            if (prepare_threads) {
-                prepareReady.release(); // sprites for last frame
-            } else {
-                // tick game logic
-                tick();
-                audio.tick();
-                video.prepare_frame();
+            video.present_frame();
+            lastPresent = std::chrono::steady_clock::now();
+            record_latency(inputLatched);
+            repeatMs = repeat_frames();
+        } else if (using_threading) {
+            // Set NTSC filter to work on the last complete frame immediately, plus the next frame
+            submit_frame_jobs(render_threads, logic_on_main);
+
+            // Run the GPU-bound work on the main thread (SDL limitation), or hand the frame just
+            // swapped in to the main thread's present loop
+            // the frame shown was latched two loops ago, or three when it was drawn a loop after its tick
+            const uint32_t behind  = config.video.overlap_logic ? 3 : 2;
+            const uint64_t latched = latchFrames >= behind ? latchRing[(latchFrames - behind) & 3] : 0;
+            if (threadedPresent)
+                publish_frame(latched);
+            else {
+                video.present_frame();
+                record_latency(latched);
+                repeatMs = repeat_frames();
             }
 
-            // Run the GPU-bound work on the main thread (SDL limitation)
-            video.present_frame();
+            // with the input latch, the logic starts now, once the latch time is reached
+            if (latching()) {
+                latch_input();
+                submit_logic_jobs(logic_on_main);
+            }
 
-            // await thread completion
-            renderDone0.acquire();
-            if (render_threads==2) renderDone1.acquire();
-            if (prepare_threads)   prepareDone.acquire();
+            // await game logic and layer completion, helping out meanwhile
+            jobsystem.wait(frameJobs);
+            latchRing[latchFrames++ & 3] = inputLatched;
         } else {
             // 1 Game Thread. Run logic sequentially
+            latch_input();
             tick();
             audio.tick();
             video.prepare_frame();
-            video.render_frame(-1);
+            video.flush_palette();
+            video.render_frame();
             video.present_frame();
+            record_latency(inputLatched);
+            repeatMs = repeat_frames();
         }
 
-        // Swap the buffers for the next frame.
-        video.swap_buffers();
+        // Swap the buffers for the next frame. The threaded path hands the filter output on once
+        // the render bands finish, in submit_frame_jobs().
+        if (using_threading && !config.video.low_latency)
+            video.swap_prepare_buffers();
+        else
+            video.swap_buffers();
+        frameTrace = frametrace::record(frametrace::FRAME, frameTrace);
+        flightrec::frame();
+        frametrace::check_dump(tracePath);
+        video.check_snapshot();
 
         // Check to see if anything happened needing a video restart
         if (config.videoRestartRequired) {
-            video.disable();
-            config.video.hires = config.video.hires_next;
-            video.init(&roms, &config.video);
-            video.sprite_layer->set_x_clip(false);
-            config.videoRestartRequired = false;
+            jobsystem.wait(renderJobs);
+            if (threadedPresent)
+                request_video_restart();
+            else
+                restart_video();
             // reset timers as video restart can take a while
             nextFrameTime = std::chrono::steady_clock::now();
+            latchFrames = 0;
+            lastFrameStart = {};
+            fpsauto::reset();
+            flightrec::reset();
         }
+
+        // Frame time samples for the auto 30/60fps mode, before waiting for the next frame. With
+        // vsync, the wait in the buffer swap isn't work.
+        if (lastFrameStart != std::chrono::steady_clock::time_point{}) {
+            double work = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count();
+            if (vsync)
+                work = std::max(work - frametrace::last_ms(frametrace::PRESENT) - repeatMs, 0.0);
+            fpsauto::add_frame(std::chrono::duration<double, std::milli>(now - lastFrameStart).count(), work);
+        }
+        lastFrameStart = now;
         // If we're ahead of schedule, sleep until it's time.
         if (perftest) {
             // we're trying to run the engine as fast as possible, simply update the next frame time
             nextFrameTime = std::chrono::steady_clock::now();
         } else if (!vsync) {
             if (now < nextFrameTime) {
-                auto sleepDuration = nextFrameTime - now;
-                // Only record sleep if we're at 30 FPS.
-                totalSleepTime += sleepDuration * (configured_fps == 30);
-
-                std::this_thread::sleep_for(sleepDuration);
+                framepacer::wait_until(std::chrono::time_point_cast<std::chrono::steady_clock::duration>(nextFrameTime),
+                                       config.video.pacing != 0);
                 now = std::chrono::steady_clock::now();
             }
         }
@@ -642,72 +993,78 @@ static void main_loop() {
             printf("\r%i FPS (dropped: %i%%)    ", fps, droppedPercent);
             fflush(stdout);
             fps_counter = fps;
+            dropped_percent = droppedPercent;
             renderedFrames = 0;
             droppedFrames = 0;
             fpsTimer = std::chrono::steady_clock::now();
-        }
 
-        // ---- PERFORMANCE EVALUATION (every 10 seconds) ----
-        if (cannonball::fps_lock==0) {
-            auto performanceElapsed = std::chrono::steady_clock::now() - performanceCheckStart;
-            if (performanceElapsed >= std::chrono::seconds(cannonball::fps_eval_period)) {
-                double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(performanceElapsed).count();
-                if (configured_fps == 60) {
-                    // Evaluate average FPS at 60 FPS.
-                    double avgFPS = totalRenderedFramesForCheck / seconds;
-                    if (avgFPS < 50.0) {
-                        printf("\nPerformance check: average FPS %.2f too low. Switching to 30 FPS.\n", avgFPS);
-                        config.video.fps = 0; // 0 = 30 fps
-                        config.set_fps(config.video.fps);
-                        cannonball::fps_eval_period *= 2; // double eval period for next try
-                    }
+            // Frame stage timings, every 10 seconds
+            if (config.video.trace && ++tracePeriods == 5) {
+                tracePeriods = 0;
+                std::ostringstream trace;
+                frametrace::report(trace);
+                framepacer::report(trace);
+                std::cout << "\n" << trace.str();
+                if (config.video.trace == 2) {
+                    std::ofstream file(config.data.save_path + "frametrace.txt");
+                    file << trace.str();
                 }
-                else if (configured_fps == 30) {
-                    // Evaluate average sleep fraction at 30 FPS.
-                    double avgSleepFraction = 0.0;
-                    if (frameCountForSleep > 0) {
-                        avgSleepFraction = totalSleepTime.count() / (frameDuration.count() * frameCountForSleep);
-                    }
-                    if (avgSleepFraction > 0.6) {
-                        printf("\nPerformance check: average sleep fraction %.2f%%. Switching to 60 FPS.\n", avgSleepFraction * 100.0);
-                        config.video.fps = 2; // 2 = 60 fps
-                        config.set_fps(config.video.fps);
-                    }
-                }
-                // Reset performance evaluation counters.
-                performanceCheckStart = std::chrono::steady_clock::now();
-                totalRenderedFramesForCheck = 0;
-                totalSleepTime = std::chrono::duration<double>(0);
-                frameCountForSleep = 0;
             }
-            // Update control variables if there is an FPS change
-            if (config.fps != configured_fps) {
-                configured_fps = config.fps;
-                targetFPS = static_cast<double>(configured_fps);
-                frameDuration = std::chrono::duration<double>(1.0 / targetFPS);
-                nextFrameTime = std::chrono::steady_clock::now() + frameDuration;
-
-                // Determine if we can rely on vsync (for 60fps mode)
-                SDL_DisplayMode displayMode;
-                if (SDL_GetCurrentDisplayMode(0, &displayMode) == 0) {
-                    // Can retrieve monitor refresh rate
-                    vsync = (displayMode.refresh_rate == configured_fps) && SDL_GL_GetSwapInterval() && (config.video.vsync == 1);
-                    std::cout << "INFO: ";
-                    std::cout << "Display reports refresh rate is " << displayMode.refresh_rate << "Hz.";
-                    if (vsync)
-                        std::cout << " VSync enabled.\n";
-                    else
-                        std::cout << " VSync disabled.\n";
-                }
+        }
+
+        // ---- ATTRACT MODE GOVERNOR ----
+        attractgov::tick(attract_mode(), inputSeen.exchange(false, std::memory_order_relaxed),
+                         cannonball::fps_lock != 0 || inputlog::playing());
+
+        // ---- PERFORMANCE EVALUATION (auto 30/60fps) ----
+        if (cannonball::fps_lock==0 && !inputlog::playing() && !attractgov::holding_fps()) {
+            // the menus show, and save, the settings as chosen
+            if (cannonball::state == STATE_MENU)
+                quality::restore_all();
+            const int stage = fpsauto::stage_key(oroad.stage_lookup_off, cannonball::state == STATE_GAME);
+            const int fps   = fpsauto::update(configured_fps, stage, cannonball::fps_eval_period,
+                                              config.video.quality_governor != 0);
+            if (fps != configured_fps) {
+                config.video.fps = (fps == 30 ? 0 : 2);
+                config.set_fps(config.video.fps);
+            }
+        }
+
+        // Update control variables if there is an FPS change (auto mode, or the governor)
+        if (config.fps != configured_fps) {
+            configured_fps = config.fps;
+            frameDuration = frame_duration(configured_fps);
+            nextFrameTime = std::chrono::steady_clock::now() + frameDuration;
+            lastFrameStart = {};
+            fpsauto::reset();
+
+            // Determine if we can rely on vsync (for 60fps mode)
+            SDL_DisplayMode displayMode;
+            if (SDL_GetCurrentDisplayMode(0, &displayMode) == 0) {
+                // Can retrieve monitor refresh rate
+                presentRepeats = refresh_repeats(displayMode.refresh_rate, configured_fps);
+                vsync = (displayMode.refresh_rate == configured_fps || presentRepeats > 0) && SDL_GL_GetSwapInterval() &&
+                        (config.video.vsync == 1) && !threadedPresent && !config.video.vrr;
+                std::cout << "INFO: ";
+                std::cout << "Display reports refresh rate is " << displayMode.refresh_rate << "Hz.";
+                if (vsync)
+                    std::cout << " VSync enabled.\n";
+                else
+                    std::cout << " VSync disabled.\n";
             }
         }
     }
-    // Signal the worker threads to quit.
-    if (using_threading) {
-        running.store(false);
-        if (prepare_threads)   { prepareReady.release(); t0.join(); }
-                                 renderReady0.release(); t1.join();
-        if (render_threads==2) { renderReady1.release(); t2.join(); }
+    // Signal the worker threads to quit, once the last filter pass is done.
+    jobsystem.wait(renderJobs);
+    if (using_threading)
+        jobsystem.stop();
+
+    // Keep what auto mode learned about the stages for next time
+    if (config.video.fps_remember && fpsauto::get_stages() != config.video.fps_stages) {
+        quality::restore_all();
+        attractgov::restore_all();
+        config.video.fps_stages = fpsauto::get_stages();
+        config.save();
     }
 
     // Stop audio
@@ -718,6 +1075,374 @@ static void main_loop() {
 }
 
 
+// ------------------------------------------------------------------------------------------------
+// Benchmark mode (-benchmark)
+//
+// Runs a fixed number of attract mode frames, as fast as possible and with the sound off, then
+// writes the time taken by each stage of the frame to a JSON file. The attract mode AI and the
+// random number generator are seeded identically on every run, so each run draws the same frames
+// and the figures from two builds or two machines can be compared directly. With no display, run
+// with SDL_VIDEODRIVER=offscreen.
+//
+// -snapshot also saves the video hardware state of the last frame, for the kernel benchmarks
+// (cannonball-bench), so a given frame of the attract mode can be captured reproducibly.
+// -replay instead loads a snapshot (e.g. one saved in game with F10) and draws that frame every
+// time, without running the engine.
+// ------------------------------------------------------------------------------------------------
+
+static int         benchmark_frames = 0;  // frames to run; 0 = normal operation
+static std::string benchmark_file;        // JSON report; stdout if empty
+static std::string benchmark_snapshot;    // video snapshot of the last frame; none if empty
+static std::string benchmark_replay;      // video snapshot to draw instead of running the engine
+
+// Timing of one stage of the frame, in milliseconds per frame
+struct BenchmarkStage
+{
+    const char* name;
+    std::vector<double> ms;
+};
+
+static void write_benchmark_stage(std::ostream& out, BenchmarkStage& stage, bool last)
+{
+    std::vector<double>& v = stage.ms;
+    std::sort(v.begin(), v.end());
+    double sum = 0.0;
+    for (double ms : v) sum += ms;
+    const size_t n = v.size();
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "    \"%s\": { \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f }%s\n",
+             stage.name,
+             n ? sum / n : 0.0,
+             n ? v[n / 2] : 0.0,
+             n ? v[std::min(n - 1, n * 99 / 100)] : 0.0,
+             n ? v[n - 1] : 0.0,
+             last ? "" : ",");
+    out << line;
+}
+
+static int benchmark_loop()
+{
+    threadpolicy::apply(threads_settings_t::GAME);
+
+    const int threads         = cannonball::game_threads;
+    const int using_threading = (threads > 1);
+    const int render_threads  = std::max(threads - 1, 1);
+
+    static const char* prepare_names[Video::PREPARE_STAGES] = {
+        "prepare_begin", "road_bg", "tiles_bg", "tiles_fg", "road_fg", "sprites", "text"
+    };
+    BenchmarkStage tick_stage   { "tick",    {} };
+    BenchmarkStage render_stage { "render",  {} };
+    BenchmarkStage present_stage{ "present", {} };
+    BenchmarkStage frame_stage  { "frame",   {} };
+    BenchmarkStage prepare_stages[Video::PREPARE_STAGES];
+    for (int stage = 0; stage < Video::PREPARE_STAGES; stage++)
+        prepare_stages[stage].name = prepare_names[stage];
+
+    using clock = std::chrono::steady_clock;
+    auto ms_since = [](clock::time_point t) {
+        return std::chrono::duration<double, std::milli>(clock::now() - t).count();
+    };
+
+    if (!benchmark_replay.empty() && !video.load_snapshot(benchmark_replay)) {
+        if (using_threading)
+            jobsystem.stop();
+        return 1;
+    }
+
+    std::cout << "Benchmark: running " << benchmark_frames << " frames on " << threads << " thread(s)." << std::endl;
+    auto run_start = clock::now();
+
+    for (int f = 0; f < benchmark_frames && cannonball::state != STATE_QUIT; f++) {
+        auto frame_start = clock::now();
+
+        auto t = clock::now();
+        if (benchmark_replay.empty())
+            tick();
+        tick_stage.ms.push_back(ms_since(t));
+
+        for (int stage = Video::PREPARE_BEGIN; stage < Video::PREPARE_STAGES; stage++) {
+            t = clock::now();
+            video.prepare_stage(stage);
+            prepare_stages[stage].ms.push_back(ms_since(t));
+        }
+
+        // the filter, split into bands across the workers as the threaded main loop does
+        t = clock::now();
+        video.flush_palette();
+        if (using_threading) {
+            for (int id = 0; id < render_threads; id++)
+                jobsystem.submit(renderJobs, [=] { video.render_frame(id, render_threads); });
+            jobsystem.wait(renderJobs);
+        } else {
+            video.render_frame();
+        }
+        render_stage.ms.push_back(ms_since(t));
+
+        t = clock::now();
+        video.present_frame();
+        video.swap_buffers();
+        present_stage.ms.push_back(ms_since(t));
+
+        frame_stage.ms.push_back(ms_since(frame_start));
+    }
+
+    const double seconds = std::chrono::duration<double>(clock::now() - run_start).count();
+    const size_t frames  = frame_stage.ms.size();
+
+    if (using_threading)
+        jobsystem.stop();
+
+    if (!benchmark_snapshot.empty() && video.save_snapshot(benchmark_snapshot))
+        std::cout << "Benchmark: video snapshot written to " << benchmark_snapshot << std::endl;
+
+    std::ofstream file;
+    if (!benchmark_file.empty()) {
+        file.open(benchmark_file);
+        if (!file) {
+            std::cerr << "Benchmark: unable to write " << benchmark_file << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = benchmark_file.empty() ? std::cout : file;
+
+    char line[256];
+    out << "{\n";
+    out << "  \"version\": \"" << CANNONBALL_SE_VERSION << "\",\n";
+    snprintf(line, sizeof(line),
+             "  \"frames\": %zu,\n  \"threads\": %d,\n  \"hires\": %d,\n  \"blargg\": %d,\n"
+             "  \"seconds\": %.3f,\n  \"fps\": %.2f,\n",
+             frames, threads, config.video.hires, config.video.blargg,
+             seconds, seconds > 0.0 ? frames / seconds : 0.0);
+    out << line;
+    out << "  \"stages\": {\n";
+    write_benchmark_stage(out, tick_stage, false);
+    for (auto& stage : prepare_stages)
+        write_benchmark_stage(out, stage, false);
+    write_benchmark_stage(out, render_stage, false);
+    write_benchmark_stage(out, present_stage, false);
+    write_benchmark_stage(out, frame_stage, true);
+    out << "  }\n}" << std::endl;
+
+    if (!benchmark_file.empty())
+        std::cout << "Benchmark: results written to " << benchmark_file << std::endl;
+
+    return frames == size_t(benchmark_frames) ? 0 : 1;
+}
+
+
+// ------------------------------------------------------------------------------------------------
+// Turbo mode (-turbo)
+//
+// Runs the engine alone for a number of game seconds, as fast as the CPU allows: tick() only,
+// with no drawing, sound or frame pacing. The attract mode plays as with -benchmark, seeded the
+// same on every run, on the LayOut track given with -file if any. So a track can be run through
+// to check that it plays, or two builds of the engine compared: state_hash covers the car and
+// road position, speed, score and game state of every tick, so differs if the play does.
+// Writes the speed reached and where the car got to as JSON.
+//
+// -jobs runs several such simulations at once, one process each, forked once the ROMs are loaded
+// and the graphics converted so that these are shared rather than copied. Turbo mode starts none
+// of the controls' threads, and the threads that converted the graphics are stopped before the
+// first fork, so each process begins with the one thread fork() copies. Job 0 plays as a single
+// run would; the others have the random numbers seeded by job number, and with -sweep-traffic
+// the traffic level goes through 0-3 with each job as well. Each writes its own report, to file
+// with the job number added (e.g. results-3.json), or to the console.
+// ------------------------------------------------------------------------------------------------
+
+static int         turbo_seconds = 0;     // game seconds to run; 0 = normal operation
+static std::string turbo_file;            // JSON report; stdout if empty
+static int         turbo_jobs = 1;        // simulations to run
+static bool        turbo_sweep = false;   // vary the traffic level across the jobs
+
+static int turbo_loop(int job, const std::string& report)
+{
+    threadpolicy::apply(threads_settings_t::GAME);
+
+    using clock = std::chrono::steady_clock;
+    const long ticks = long(turbo_seconds) * config.fps;
+
+    std::cout << "Turbo: running " << turbo_seconds << " game seconds (" << ticks << " ticks)." << std::endl;
+
+    // FNV-1a over a few values of each tick
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](uint32_t v) {
+        for (int b = 0; b < 4; b++, v >>= 8) {
+            hash ^= v & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+    };
+
+    auto start = clock::now();
+    long done = 0;
+    for (; done < ticks && cannonball::state != STATE_QUIT && !inputlog::finished(); done++) {
+        tick();
+        mix(uint32_t(oinitengine.car_x_pos));
+        mix(oinitengine.car_increment);
+        mix(oroad.road_pos);
+        mix(ostats.score);
+        mix(uint32_t(uint8_t(outrun.game_state)) | (uint32_t(uint8_t(ostats.cur_stage)) << 8));
+    }
+    const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    const double game    = double(done) / config.fps;
+
+    std::ofstream file;
+    if (!report.empty()) {
+        file.open(report);
+        if (!file) {
+            std::cerr << "Turbo: unable to write " << report << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = report.empty() ? std::cout : file;
+
+    char line[640];
+    snprintf(line, sizeof(line),
+             "{\n  \"version\": \"%s\",\n  \"job\": %d,\n  \"traffic\": %d,\n  \"ticks\": %ld,\n"
+             "  \"game_seconds\": %.2f,\n  \"wall_seconds\": %.3f,\n  \"speed\": %.1f,\n  \"stage\": %d,\n"
+             "  \"score\": %u,\n  \"game_state\": %d,\n  \"state_hash\": \"%016llx\"\n}",
+             CANNONBALL_SE_VERSION, job, config.engine.dip_traffic, done, game, seconds,
+             seconds > 0.0 ? game / seconds : 0.0, int(ostats.cur_stage), unsigned(ostats.score),
+             int(outrun.game_state), (unsigned long long)hash);
+    out << line << std::endl;
+
+    if (!report.empty())
+        std::cout << "Turbo: results written to " << report << std::endl;
+
+    return done == ticks || inputlog::finished() ? 0 : 1;
+}
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// -jobs: each simulation in a process of its own, as many at once as there are cores
+static int turbo_parallel()
+{
+    auto report = [](int job) {
+        if (turbo_file.empty())
+            return std::string();
+        const size_t slash = turbo_file.find_last_of("/\\");
+        size_t cut = turbo_file.find_last_of('.');
+        if (cut == std::string::npos || (slash != std::string::npos && cut < slash))
+            cut = turbo_file.size();
+        return turbo_file.substr(0, cut) + "-" + std::to_string(job) + turbo_file.substr(cut);
+    };
+
+    // fork() copies only the calling thread: one left running could hold a lock the jobs then wait on
+    video.sprite_layer->stop_prewarm();
+    jobsystem.stop();
+
+    const int cores = std::max(1, int(std::thread::hardware_concurrency()));
+    std::cout << "Turbo: " << turbo_jobs << " jobs, " << std::min(cores, turbo_jobs) << " at a time." << std::endl;
+    auto start = std::chrono::steady_clock::now();
+
+    int next = 0, running = 0, failed = 0;
+    while (next < turbo_jobs || running) {
+        if (next < turbo_jobs && running < cores) {
+            const int job = next++;
+            std::cout.flush();
+            const pid_t pid = fork();
+            if (pid == 0) {
+                if (turbo_sweep)
+                    config.engine.dip_traffic = job & 3;
+                const int seed = turbo_sweep ? job >> 2 : job;
+                if (seed) {
+                    config.engine.randomgen = 0;
+                    srand(unsigned(seed));
+                }
+                const int code = turbo_loop(job, report(job));
+                std::cout.flush();
+                _exit(code);
+            }
+            if (pid < 0) {
+                std::cerr << "Turbo: unable to start job " << job << ": " << std::strerror(errno) << std::endl;
+                failed++;
+            } else {
+                running++;
+            }
+            continue;
+        }
+        int status = 0;
+        if (wait(&status) > 0) {
+            running--;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed++;
+        } else {
+            break;
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Turbo: " << turbo_jobs - failed << " of " << turbo_jobs << " jobs completed in " << seconds
+              << "s, " << (seconds > 0.0 ? double(turbo_seconds) * (turbo_jobs - failed) / seconds : 0.0)
+              << " game seconds a second altogether." << std::endl;
+    return failed ? 1 : 0;
+}
+#else
+static int turbo_parallel()
+{
+    std::cerr << "Turbo: -jobs is not available on Windows; running job 0 only." << std::endl;
+    return turbo_loop(0, turbo_file);
+}
+#endif
+
+
+// ------------------------------------------------------------------------------------------------
+// Batch render (-render)
+//
+// Runs the session as fast as possible without a display, as turbo mode does, but draws every
+// frame and writes it out as video (see batchrender.hpp). A -playback log plays to its end, unless
+// a number of frames is given, which is required without one (for the attract mode).
+// ------------------------------------------------------------------------------------------------
+
+static std::string render_file;           // video out; empty = normal operation
+static long        render_frames = 0;     // frames to render; 0 = to the end of the playback log
+
+static int render_loop()
+{
+    threadpolicy::apply(threads_settings_t::GAME);
+    if (!batchrender::start(render_file))
+        return 1;
+
+    std::cout << "Render: " << (render_frames ? std::to_string(render_frames) + " frames" : "to the end of the log")
+              << " on " << jobsystem.worker_count() + 1 << " thread(s)." << std::endl;
+
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    long done = 0;
+    for (; (!render_frames || done < render_frames) && cannonball::state != STATE_QUIT && !inputlog::finished(); done++) {
+        tick();
+        video.prepare_frame();
+        video.swap_prepare_buffers();   // hands the frame to batchrender
+    }
+    batchrender::stop();
+
+    const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    const double fps     = seconds > 0.0 ? done / seconds : 0.0;
+    char line[160];
+    snprintf(line, sizeof(line), "Render: %ld frames in %.2fs, %.1f fps (%.1fx real time).",
+             done, seconds, fps, fps / config.fps);
+    std::cout << line << std::endl;
+
+    return !render_frames || done == render_frames ? 0 : 1;
+}
+
+
+// Input recording (-record) and playback (-playback); see inputlog.hpp
+static std::string record_file;
+static std::string playback_file;
+
+// Gameplay recording (-capture); see framerec.hpp
+static std::string capture_file;
+
+// Linked twin cabinets (-twin); see twinlink.hpp
+static std::string twin_peer;
+
+
 // Very (very) simple command line parser.
 // Returns true if everything is ok to proceed with launching the game engine.
 static bool parse_command_line(int argc, char* argv[]) {
@@ -747,12 +1472,13 @@ static bool parse_command_line(int argc, char* argv[]) {
             fps_set = true;
         }
         else if (strcmp(argv[i], "-t") == 0 && i+1 < argc) {
-            std::string arg = argv[i + 1];
-            if (arg.size() == 1 && arg[0] >= '1' && arg[0] <= '4') {
-                cannonball::game_threads = arg[0] - '0';  // convert char to int
+            const int max_threads = std::max(1, int(std::thread::hardware_concurrency()));
+            const int t = std::atoi(argv[i + 1]);
+            if (t >= 1 && t <= max_threads) {
+                cannonball::game_threads = t;
                 std::cout << "Game will use " << cannonball::game_threads << " threads.\n";
             } else {
-                std::cerr << "-t: specified threads must be between 1 and 4.\n";
+                std::cerr << "-t: specified threads must be between 1 and " << max_threads << ".\n";
             }
         }
         else if (strcmp(argv[i], "-x") == 0) {
@@ -767,6 +1493,70 @@ static bool parse_command_line(int argc, char* argv[]) {
             cannonball::perftest = true;
             std::cout << "Running in performance test mode.\n";
         }
+        else if (strcmp(argv[i], "-benchmark") == 0) {
+            if (i + 1 < argc)
+                benchmark_frames = std::atoi(argv[++i]);
+            if (benchmark_frames <= 0) {
+                std::cerr << "-benchmark: specify the number of frames to run.\n";
+                return false;
+            }
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                benchmark_file = argv[++i];
+            cannonball::perftest = true;
+            std::cout << "Running in benchmark mode.\n";
+        }
+        else if (strcmp(argv[i], "-startup-bench") == 0) {
+            std::string trace_file;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                trace_file = argv[++i];
+            bootprof::bench(trace_file);
+            std::cout << "Timing start-up to the attract mode.\n";
+        }
+        else if (strcmp(argv[i], "-turbo") == 0) {
+            if (i + 1 < argc)
+                turbo_seconds = std::atoi(argv[++i]);
+            if (turbo_seconds <= 0) {
+                std::cerr << "-turbo: specify the number of game seconds to run.\n";
+                return false;
+            }
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                turbo_file = argv[++i];
+            std::cout << "Running in turbo mode.\n";
+        }
+        else if (strcmp(argv[i], "-jobs") == 0 && i + 1 < argc) {
+            turbo_jobs = std::atoi(argv[++i]);
+            if (turbo_jobs <= 0) {
+                std::cerr << "-jobs: specify the number of simulations to run.\n";
+                return false;
+            }
+        }
+        else if (strcmp(argv[i], "-sweep-traffic") == 0) {
+            turbo_sweep = true;
+        }
+        else if (strcmp(argv[i], "-record") == 0 && i + 1 < argc) {
+            record_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "-playback") == 0 && i + 1 < argc) {
+            playback_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "-capture") == 0 && i + 1 < argc) {
+            capture_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "-render") == 0 && i + 1 < argc) {
+            render_file = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                render_frames = std::atol(argv[++i]);
+            std::cout << "Running in batch render mode.\n";
+        }
+        else if (strcmp(argv[i], "-twin") == 0 && i + 1 < argc) {
+            twin_peer = argv[++i];
+        }
+        else if (strcmp(argv[i], "-snapshot") == 0 && i + 1 < argc) {
+            benchmark_snapshot = argv[++i];
+        }
+        else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc) {
+            benchmark_replay = argv[++i];
+        }
         else if (   (strcmp(argv[i], "-help") == 0)  ||
                     (strcmp(argv[i], "--help") == 0) ||
                     (strcmp(argv[i], "-h") == 0)     ||
@@ -779,10 +1569,24 @@ static bool parse_command_line(int argc, char* argv[]) {
                          "-list-audio-devices  : Lists available playback devices then quit\n" <<
                          "-30                  : Lock to 30fps\n" <<
                          "-60                  : Lock to 60fps\n" <<
-                         "-t x                 : Number of game threads (1-4)\n" <<
+                         "-t x                 : Number of game threads (1-number of cores)\n" <<
                          "-x                   : Disable single-core RaspberryPi board detection\n" <<
                          "-1                   : Use single-core mode\n" <<
-                         "-perftest            : Assess max frame rate possible on this platform\n\n" <<
+                         "-perftest            : Assess max frame rate possible on this platform\n" <<
+                         "-benchmark n [file]  : Time n attract mode frames and write the results as JSON\n" <<
+                         "-snapshot file       : With -benchmark, save the video state of the last frame\n" <<
+                         "-replay file         : With -benchmark, draw a saved video state instead of running the game\n" <<
+                         "-startup-bench [file]: Time start-up to the attract mode, then quit; file takes a trace\n" <<
+                         "-turbo n [file]      : Run n seconds of attract mode as fast as possible, without drawing or\n" <<
+                         "                       sound, and write the results as JSON\n" <<
+                         "-jobs n              : With -turbo, run n simulations at once, seeded by job number\n" <<
+                         "-sweep-traffic       : With -jobs, also take the traffic level through 0-3 across the jobs\n" <<
+                         "-record file         : Record the controls of the session to file\n" <<
+                         "-playback file       : Play back the controls recorded in file, with the settings they were recorded with\n" <<
+                         "-capture file        : Record the game's frames to file, for cannonball-recrender to turn into video\n" <<
+                         "-render out [n]      : Draw n frames, or the -playback log to its end, as fast as possible and\n" <<
+                         "                       write them as RGB24 to out (- for stdout, a path with %06d for PPM files)\n" <<
+                         "-twin host:port      : Link to a second cabinet at host, racing its car, on UDP port (on both)\n\n" <<
                          "CannonBall-SE man page is in the res folder. Open it with 'man -l docs/cannonball-se.6'" << std::endl;
             _Exit(0);
         }
@@ -798,6 +1602,11 @@ int main(int argc, char* argv[]) {
 #ifdef __linux__
     install_segv_handler();
 #endif
+    // -render - gives stdout to the frames, so everything printed goes to stderr from the start
+    for (int i = 1; i + 1 < argc; i++)
+        if (strcmp(argv[i], "-render") == 0 && strcmp(argv[i + 1], "-") == 0)
+            batchrender::claim_stdout();
+
     std::cout << "CannonBall-SE " << CANNONBALL_SE_VERSION << "\n";
     std::cout << "  An enhanced build of the SEGA Outrun engine by Chris White (https://github.com/djyt/cannonball)\n";
     std::cout << "  CannonBall-SE is Copyright (c) 2025, James Pearce (https://github.com/J1mbo/cannonball)\n";
@@ -807,8 +1616,14 @@ int main(int argc, char* argv[]) {
     bool ok = parse_command_line(argc, argv);
 
     if (ok) {
-        config.load(); // Load config.XML file, also loads custom music files
-        ok = roms.load_revb_roms(config.sound.fix_samples);
+        {
+            bootprof::Phase phase("config");
+            config.load(); // Load config.XML file, also loads custom music files
+        }
+        {
+            bootprof::Phase phase("roms");
+            ok = roms.load_revb_roms(config.sound.fix_samples);
+        }
 
         if (cannonball::singlecore_detect || cannonball::singlecore_mode) {
             if (singleCorePi() || cannonball::singlecore_mode) {
@@ -821,10 +1636,13 @@ int main(int argc, char* argv[]) {
                 config.video.blargg        =  0;        // disable Blargg NTSC filter
                 config.video.shader_mode   =  2;        // full glsl shader (VideoCore IV can handle it easily at 30fps)
                 config.video.shadow_mask   =  2;        // glsl shader based overlay (looks better)
+                config.video.overlay_gpu   =  0;        // CRT shape mask read from a texture (cheaper on VideoCore IV)
                 config.video.crt_shape     =  1;        // enable shape overlay
                 config.video.noise         =  10;       // as Blargg filter is disabled, add more analogue noise
-                config.sound.rate          =  22050;    // 22kHz audio rate
+                if (config.sound.chip_rate == 0)        // unless the chip rate is configured,
+                    config.sound.rate      =  22050;    // 22kHz audio rate
                 config.sound.callback_rate =  1;        // 16ms sound callbacks
+                config.sound.direct        =  1;        // mixed in the callback, no mixing thread
                 if (cannonball::fps_lock == 0) cannonball::fps_lock = 30; // lock to 30fps unless user has overriden
             }
         }
@@ -834,6 +1652,56 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    frametrace::start_events(config.video.trace_events);
+    frametrace::name_thread("main");
+#ifdef __linux__
+    if (config.video.trace_events)
+        signal(SIGUSR1, trace_signal_handler);
+#endif
+
+    if (!render_file.empty() && !render_frames && playback_file.empty()) {
+        std::cerr << "-render: give -playback a log, or the number of frames to render.\n";
+        quit_func(1);
+    }
+    if (benchmark_frames || turbo_seconds || !render_file.empty()) {
+        // the same frames every run: attract mode from boot, no sound, no frame pacing
+        config.menu.enabled     = 0;
+        config.sound.enabled    = 0;
+        config.video.vsync      = 0;
+        config.video.fps        = (cannonball::fps_lock == 30 || turbo_seconds ? 0 :
+                                   !render_file.empty() ? 1 : 2);
+        config.engine.randomgen = 1;
+        srand(0);
+    }
+    // turbo mode has no player or cabinet, and shows nothing: the controls' outputs and their
+    // threads are left off, as is the NTSC filter, whose tables are otherwise built on a thread
+    if (turbo_seconds) {
+        config.video.blargg     = 0;
+        config.controls.evdev.clear();
+        config.controls.rumble  = 0;
+        config.controls.haptic  = 0;
+        config.smartypi.enabled = 0;
+        if (turbo_jobs > 1 && (!twin_peer.empty() || !capture_file.empty())) {
+            std::cerr << "-jobs: can't be used with -twin or -capture.\n";
+            quit_func(1);
+        }
+    }
+    // the menu would wait for a player; time start-up to the attract mode
+    if (bootprof::benchmarking())
+        config.menu.fast_boot = 1;
+    // nothing is shown, so no display is needed
+    if ((turbo_seconds || !render_file.empty()) && config.video.driver.empty())
+        config.video.driver = "offscreen";
+
+    // The controls, from the first tick. Playback also takes the settings it was recorded with.
+    if (!playback_file.empty() ? !inputlog::playback(playback_file)
+                               : !record_file.empty() && !inputlog::record(record_file))
+        quit_func(1);
+    if (!capture_file.empty() && !framerec::start(capture_file))
+        quit_func(1);
+    if (!twin_peer.empty() && !twinlink::start(twin_peer))
+        quit_func(1);
+
     // Display help text around custom music if none was found
     if (config.sound.custom_tracks_loaded == 0) {
         std::cout << "Custom Music: Put .WAV, .MP3, or .YM files in res/ folder named as:" << std::endl;
@@ -857,15 +1725,32 @@ int main(int argc, char* argv[]) {
     //#define SDL_HINT_QTWAYLAND_WINDOW_FLAGS "StaysOnTop BypassWindowManager"
     SDL_SetHint(SDL_HINT_QTWAYLAND_WINDOW_FLAGS,
             "StaysOnTop BypassWindowManager");
-    if (const char* drv = std::getenv("SDL_VIDEODRIVER"); drv && std::strcmp(drv, "wayland") != 0) {
+    if (const char* drv = std::getenv("SDL_VIDEODRIVER"); drv && std::strcmp(drv, "wayland") != 0 && std::strcmp(drv, "kmsdrm") != 0) {
         std::cout << "\nCannonball requires wayland video driver for 60fps operation under desktop environment. Start cannonball like:" << std::endl;
         std::cout << "$ SDL_VIDEODRIVER=""wayland"" build/cannonball" << std::endl;
     }
 #endif
     SDL_SetHint(SDL_HINT_APP_NAME, "Cannonball");
     //SDL_SetHint(SDL_HINT_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR, "1");
-    if (SDL_Init(   SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER |
-                    SDL_INIT_HAPTIC | SDL_INIT_EVENTS) == -1) {
+
+    // video.driver, unless SDL_VIDEODRIVER is already set. If it can't be started, SDL's own choice.
+    const bool set_driver = !config.video.driver.empty() && !SDL_getenv("SDL_VIDEODRIVER");
+    if (set_driver)
+        SDL_setenv("SDL_VIDEODRIVER", config.video.driver.c_str(), 1);
+
+    const Uint32 sdl_systems = SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER |
+                               SDL_INIT_HAPTIC | SDL_INIT_EVENTS;
+    int sdl_init;
+    {
+        bootprof::Phase phase("sdl_init");
+        sdl_init = SDL_Init(sdl_systems);
+        if (sdl_init == -1 && set_driver) {
+            std::cerr << "Unable to start video driver " << config.video.driver << ": " << SDL_GetError() << std::endl;
+            SDL_setenv("SDL_VIDEODRIVER", "", 1);
+            sdl_init = SDL_Init(sdl_systems);
+        }
+    }
+    if (sdl_init == -1) {
         std::cerr << "SDL Initialization Failed: " << SDL_GetError() << std::endl;
         return 1;
     }
@@ -876,18 +1761,28 @@ int main(int argc, char* argv[]) {
         std::cout << SDL_GetVideoDriver(i);
         if (++i < ndri) std::cout << ", ";
     }
-    std::cout << std::endl;
+    std::cout << " (using " << SDL_GetCurrentVideoDriver() << ")" << std::endl;
 
     // Load patched widescreen tilemaps
     if (!omusic.load_widescreen_map(config.data.res_path))
         std::cerr << "Unable to load widescreen tilemaps" << std::endl;
 
+    // Create the worker threads, for the start-up work and then the frames. The main thread makes
+    // up the last one, as it helps whilst waiting.
+    if (cannonball::game_threads > 1)
+        jobsystem.start(cannonball::game_threads - 1, [] { threadpolicy::apply(threads_settings_t::RENDER); });
+
     // Initialize SDL Video
     config.set_fps(config.video.fps);
-    if (!video.init(&roms, &config.video))
-        quit_func(1);
+    {
+        bootprof::Phase phase("video");
+        if (!video.init(&roms, &config.video))
+            quit_func(1);
+    }
+    report_memory();
 
-    cannonball::state = config.menu.enabled ? STATE_INIT_MENU : STATE_INIT_GAME;
+    // A fast boot goes straight to attract mode; the menu is then a press of MENU away
+    cannonball::state = (config.menu.enabled && !config.menu.fast_boot) ? STATE_INIT_MENU : STATE_INIT_GAME;
 
     /* Initalize SDL Controls */
 
@@ -896,10 +1791,15 @@ int main(int argc, char* argv[]) {
     // In that case, Input::set_rumble() needs to be amended for the specific controller.
     // Controller Rumble function is controlled in tick() above.
 
+    bootprof::Phase controls_phase("controls");
     input.init(config.controls.pad_id,
                config.controls.keyconfig, config.controls.padconfig,
                config.controls.analog,    config.controls.axis, config.controls.invert, config.controls.asettings);
 
+    // Linux cabinets: read the wheel interface directly; without it, SDL's events are used
+    if (!config.controls.evdev.empty())
+        evdev::start(config.controls.evdev);
+
     // Regardless to rumble, if haptic is enabled in config.xml, this is handled via ffeedback.cpp using either
     // DirectX (Windows) or /dev/input/event on Linux. This also includes control of real cabinet hardware via
     // SmartyPi. Therefore, haptic takes priority over simple rumble.
@@ -907,19 +1807,54 @@ int main(int argc, char* argv[]) {
     if (config.controls.haptic)
         config.controls.haptic = forcefeedback::init(config.controls.max_force, config.controls.min_force, config.controls.force_duration);
 
+    if (!turbo_seconds)
+        haptics::start();
+
+    // SmartyPi and motor controllers: the cabinet outputs as binary packets
+    if (config.smartypi.enabled && !config.smartypi.link.empty())
+        outlink::start(config.smartypi.link);
+
+    // Moving cabinet: drive the motor at a fixed rate, whatever the frame rate
+    if (config.smartypi.enabled && config.smartypi.cabinet == Config::CABINET_MOVING && config.smartypi.motor_hz > 0)
+        motorloop::start(config.smartypi.motor_hz);
+    controls_phase.end();
+
     // Populate menus
-    menu = new Menu();
-    menu->populate();
+    {
+        bootprof::Phase phase("menus");
+        menu = new Menu();
+        menu->populate();
+    }
+
+    if (benchmark_frames)
+        quit_func(benchmark_loop());
+    if (turbo_seconds)
+        quit_func(turbo_jobs > 1 ? turbo_parallel() : turbo_loop(0, turbo_file));
+    if (!render_file.empty())
+        quit_func(render_loop());
 
     // start the game threads
 #ifdef __linux__
     register_watchdog_signal_handlers();
 #endif
+    persist::start();                                   // Score, stats and settings file writer
     std::thread stats(play_stats_and_watchdog_updater); // Play stats file updater thread
 
     // Now start the main game loop, which includes SDL video and input
-    audio.init();
-    main_loop();
+    {
+        bootprof::Phase phase("audio");
+        audio.init();
+    }
+    if (use_present_thread()) {
+        std::cout << "INFO: Presenting frames from the main thread, game running on its own thread." << std::endl;
+        threadedPresent = true;
+        video.set_threaded_present(true);
+        std::thread game(main_loop);
+        present_loop();
+        game.join();
+    } else {
+        main_loop();
+    }
 
     // Wait for threads to finish
     //sound.join();
@@ -18,6 +18,7 @@ namespace cannonball
 
     // FPS Counter
     extern int fps_counter;
+    extern int dropped_percent; // of frames over the same period as fps_counter
 
     // Engine Master State
     extern int state;
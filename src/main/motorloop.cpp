@@ -0,0 +1,83 @@
+/***************************************************************************
+    Moving Cabinet Motor Thread.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "motorloop.hpp"
+#include "outlink.hpp"
+#include "threadpolicy.hpp"
+#include "engine/outrun.hpp"
+#include "engine/ooutputs.hpp"
+#include "frontend/config.hpp"
+#include "sdl2/evdev.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+static std::thread       worker;
+static std::atomic<bool> running{false};
+
+// As Input::scale_trigger() does for a joystick axis
+static int16_t position(OOutputs* outputs)
+{
+    int16_t value;
+    if (evdev::latest(config.controls.axis[3], &value))
+        return int16_t((value + 0x8000) / 0x100);
+    return outputs->motor_position();
+}
+
+static void run(int rate)
+{
+    threadpolicy::apply(threads_settings_t::GAME);
+
+    OOutputs* outputs = outrun.outputs;
+    const auto period = std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(1.0 / rate));
+    const auto logic  = std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(1.0 / motorloop::LOGIC_HZ));
+
+    auto next      = clock_type::now();
+    auto next_step = next;
+    while (running.load(std::memory_order_acquire))
+    {
+        const int16_t pos = position(outputs);
+        const auto now    = clock_type::now();
+        if (now >= next_step)
+        {
+            outputs->motor_step(pos);
+            next_step += logic;
+            if (now - next_step > logic)
+                next_step = now + logic; // after a stall, carry on rather than catch up
+        }
+        outlink::post(outputs->digital(), outputs->hw_motor_control, pos);
+
+        next += period;
+        if (now - next > period)
+            next = now + period;
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void motorloop::start(int rate)
+{
+    if (worker.joinable())
+        return;
+    rate = std::max(rate, int(LOGIC_HZ));
+    std::cout << "motorloop: moving cabinet motor at " << LOGIC_HZ << "Hz, outputs sent at " << rate << "Hz" << std::endl;
+    outrun.outputs->motor_threaded = true;
+    running = true;
+    worker  = std::thread(run, rate);
+}
+
+void motorloop::stop()
+{
+    if (!worker.joinable())
+        return;
+    running = false;
+    worker.join();
+    outrun.outputs->motor_threaded = false;
+}
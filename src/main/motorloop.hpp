@@ -0,0 +1,36 @@
+/***************************************************************************
+    Moving Cabinet Motor Thread.
+
+    Runs the deluxe moving cabinet's motor code on a fixed-rate thread of
+    its own, rather than from the engine tick, so that the motor is driven
+    steadily when frames are late or dropped.
+
+    The game thread only posts the engine state the motor code reads
+    (OOutputs::tick()). Each step of the motor code uses the latest of
+    these, with the motor position read as the step is run: straight from
+    the device when it is read through evdev, otherwise as last seen by
+    the game. The motor code is a port of the original's and its tables
+    assume its 30Hz rate, so it is stepped at 30Hz of the thread's own
+    clock. Every loop, at the thread's rate, the outputs and the motor
+    position are sent to the output link (see outlink.hpp), so a motion
+    controller sees the position the motor code acted on within 1/rate.
+
+    Calibration, the cabinet tests and the menus drive the motor from the
+    game thread as before; the thread stands by until the game posts again.
+
+    See smartypi.motor_hz in config.xml.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+namespace motorloop
+{
+    const int LOGIC_HZ = 30;    // rate the original ran the motor code
+
+    // Start the thread, looping rate times a second (at least LOGIC_HZ)
+    void start(int rate);
+    void stop();
+}
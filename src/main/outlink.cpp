@@ -0,0 +1,158 @@
+/***************************************************************************
+    Cabinet Output Link (Linux).
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include "outlink.hpp"
+
+#ifdef __linux__
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "threadpolicy.hpp"
+#include "frontend/config.hpp"
+
+static int                   sock = -1;
+static struct sockaddr_un    addr;
+static std::thread           sender;
+static std::atomic<bool>     running{false};
+
+// Single producer (the game thread), single consumer (the sender)
+static outlink::Packet       ring[outlink::RING];
+static std::atomic<uint32_t> head{0};   // packets posted
+static std::atomic<uint32_t> tail{0};   // packets taken by the sender
+static std::atomic<uint32_t> wake{0};    // bumped to wake the sender
+static uint32_t              seq = 0;
+
+static bool connect_socket()
+{
+    return ::connect(sock, (const struct sockaddr*) &addr, sizeof(addr)) == 0;
+}
+
+static void send_packets(bool& connected, std::chrono::steady_clock::time_point& retry)
+{
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    const uint32_t h = head.load(std::memory_order_acquire);
+
+    if (!connected && std::chrono::steady_clock::now() >= retry)
+    {
+        connected = connect_socket();
+        retry = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    }
+
+    for (; t != h; t++)
+    {
+        if (!connected)
+            continue;
+        const outlink::Packet& p = ring[t % outlink::RING];
+        if (::send(sock, &p, sizeof(p), MSG_DONTWAIT | MSG_NOSIGNAL) < 0 &&
+            errno != EAGAIN && errno != EWOULDBLOCK)
+            connected = false; // reader gone: drop until it is back
+    }
+    tail.store(t, std::memory_order_release);
+}
+
+static void run()
+{
+    threadpolicy::apply(threads_settings_t::GAME);
+
+    bool connected = connect_socket();
+    auto retry     = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+    uint32_t seen = 0;
+    while (running.load(std::memory_order_acquire))
+    {
+        wake.wait(seen, std::memory_order_acquire);
+        seen = wake.load(std::memory_order_acquire);
+        send_packets(connected, retry);
+    }
+    send_packets(connected, retry);
+}
+
+bool outlink::start(const std::string& path)
+{
+    if (sock >= 0)
+        return true;
+
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "outlink: socket path too long: " << path << std::endl;
+        return false;
+    }
+
+    sock = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+    {
+        std::cerr << "outlink: unable to create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+    std::cout << "outlink: sending cabinet outputs to " << path << std::endl;
+    running = true;
+    sender  = std::thread(run);
+    return true;
+}
+
+void outlink::stop()
+{
+    if (sock < 0)
+        return;
+    running = false;
+    wake.fetch_add(1, std::memory_order_release);
+    wake.notify_one();
+    sender.join();
+    ::close(sock);
+    sock = -1;
+}
+
+void outlink::post(uint8_t digital, uint8_t motor, int16_t motor_input)
+{
+    if (!running.load(std::memory_order_relaxed))
+        return;
+
+    const uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= uint32_t(RING))
+    {
+        seq++;  // ring full: this one is lost, and the gap in seq shows it
+        return;
+    }
+
+    Packet& p     = ring[h % RING];
+    p.magic       = MAGIC;
+    p.seq         = seq++;
+    p.time_us     = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count());
+    p.digital     = digital;
+    p.motor       = motor;
+    p.motor_input = motor_input;
+
+    head.store(h + 1, std::memory_order_release);
+    wake.fetch_add(1, std::memory_order_release);
+    wake.notify_one();
+}
+
+#else
+
+bool outlink::start(const std::string&)
+{
+    std::cerr << "outlink: the cabinet output link is only available on Linux" << std::endl;
+    return false;
+}
+
+void outlink::stop() {}
+void outlink::post(uint8_t, uint8_t, int16_t) {}
+
+#endif
@@ -0,0 +1,51 @@
+/***************************************************************************
+    Cabinet Output Link (Linux).
+
+    Sends the cabinet outputs - the digital outputs (lamps, wheel motor,
+    coin meters) and the bank motor command - as a fixed-size binary
+    packet every tick, to a UNIX datagram socket. A motor controller or
+    SmartyPi helper reads one packet per datagram, with no text to parse.
+
+    post() copies the packet into a ring and returns; a thread of its own
+    sends it, without waiting. If nothing is listening at the socket, the
+    packets are dropped and the thread tries again once a second. If the
+    reader falls behind and the ring fills, new packets are lost rather than
+    the game waiting; the gap in seq shows how many.
+
+    See smartypi.link in config.xml.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace outlink
+{
+    const uint32_t MAGIC   = 0x314F4243; // "CBO1", in host byte order
+    const int      RING    = 64;         // packets held for the thread
+
+    #pragma pack(push, 1)
+    struct Packet
+    {
+        uint32_t magic;
+        uint32_t seq;           // one per tick; a gap is packets lost
+        uint64_t time_us;       // CLOCK_MONOTONIC, microseconds
+        uint8_t  digital;       // OOutputs::D_* bits
+        uint8_t  motor;         // OOutputs::hw_motor_control
+        int16_t  motor_input;   // motor position (moving cabinet) or wheel position (force feedback)
+    };
+    #pragma pack(pop)
+
+    // Start sending to the socket at path. False, with a message, if it can't be created.
+    bool start(const std::string& path);
+
+    // Send what is still held, then end the thread
+    void stop();
+
+    // Queue the outputs of this tick. Does nothing before start().
+    void post(uint8_t digital, uint8_t motor, int16_t motor_input);
+}
@@ -0,0 +1,113 @@
+/***************************************************************************
+    Background File Writer.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "persist.hpp"
+#include "threadpolicy.hpp"
+#include "frontend/config.hpp"
+
+static std::mutex                         mtx;
+static std::condition_variable            cv;
+static std::condition_variable            idle;     // signalled once the queue is written
+static std::map<std::string, std::string> pending;  // filename -> latest contents
+static std::thread                        worker;
+static bool                               running  = false;  // taking writes
+static bool                               stopping = false;
+static bool                               busy     = false;  // a file part way through writing
+
+// Write via a temporary file, renamed over the old one once complete
+static bool write_file(const std::string& filename, const std::string& contents)
+{
+    const std::string temp = filename + ".tmp";
+    {
+        std::ofstream ofs(temp, std::ios::binary | std::ios::trunc);
+        if (!ofs || !ofs.write(contents.data(), std::streamsize(contents.size())) || !ofs.flush()) {
+            std::cerr << "Could not write " << temp << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp, filename, ec);
+    if (ec) {
+        std::cerr << "Could not replace " << filename << ": " << ec.message() << std::endl;
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+static void run()
+{
+    threadpolicy::apply(threads_settings_t::STATS);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    for (;;) {
+        cv.wait(lock, [] { return stopping || !pending.empty(); });
+        if (pending.empty()) {
+            running = false;
+            idle.notify_all();
+            break;
+        }
+
+        auto node = pending.extract(pending.begin());
+        busy = true;
+        lock.unlock();
+        write_file(node.key(), node.mapped());
+        lock.lock();
+        busy = false;
+        if (pending.empty())
+            idle.notify_all();
+    }
+}
+
+void persist::start()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (worker.joinable())
+        return;
+    stopping = false;
+    running  = true;
+    worker   = std::thread(run);
+}
+
+void persist::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!worker.joinable())
+            return;
+        stopping = true;
+    }
+    cv.notify_one();
+    worker.join();
+}
+
+void persist::flush()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    idle.wait(lock, [] { return !running || (pending.empty() && !busy); });
+}
+
+bool persist::write(const std::string& filename, std::string contents)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (running) {
+            pending[filename] = std::move(contents);
+            cv.notify_one();
+            return true;
+        }
+    }
+    return write_file(filename, contents);
+}
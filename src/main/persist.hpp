@@ -0,0 +1,37 @@
+/***************************************************************************
+    Background File Writer.
+
+    Writes the score, time trial, play stats and settings files away from
+    the game thread: SD cards can take a few hundred milliseconds over a
+    small file, and these are saved just as a race or score entry ends.
+
+    The caller serialises the file to a string and hands it over; the
+    worker writes it to a temporary file beside the real one and renames it
+    into place, so a power cut leaves either the old file or the new one.
+    A file queued again before it was written is written once, with the
+    latest contents.
+
+    Before start(), and after stop(), files are written straight away on
+    the calling thread.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <string>
+
+namespace persist
+{
+    void start();
+
+    // Write everything still queued, then end the worker
+    void stop();
+
+    // Wait until everything queued is written
+    void flush();
+
+    // Queue contents to be written to filename. False only if written straight away and that failed.
+    bool write(const std::string& filename, std::string contents);
+}
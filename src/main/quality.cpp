@@ -0,0 +1,126 @@
+/***************************************************************************
+    Quality Governor.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include "frontend/config.hpp"
+#include "quality.hpp"
+
+static const int SHADER_SCALE_REDUCED = 75;  // percent
+static const int HOLD_MAX             = 32;  // evaluations
+
+static int  taken[quality::STEPS];           // steps taken, in order
+static int  saved[quality::STEPS];           // the setting each replaced
+static int  steps        = 0;
+static int  hold         = 1;                // evaluations with headroom before undoing a step
+static int  waited       = 0;
+static bool just_restored = false;
+
+static const char* step_name(int step)
+{
+    static const char* names[quality::STEPS] = {
+        "CRT bloom", "CRT shader resolution", "full CRT shader", "hi-res sprites", "Blargg filter" };
+    return names[step];
+}
+
+// The setting each step changes, and whether the step does anything with it as it is
+static int* setting(int step)
+{
+    video_settings_t& v = config.video;
+    switch (step) {
+        case quality::BLOOM:         return &v.crt_bloom;
+        case quality::SHADER_SCALE:  return &v.shader_scale;
+        case quality::SHADER_FAST:   return &v.shader_mode;
+        case quality::HIRES_SPRITES: return &v.hiresprites;
+        default:                     return &v.blargg;
+    }
+}
+
+static bool applies(int step)
+{
+    const video_settings_t& v = config.video;
+    switch (step) {
+        case quality::BLOOM:         return v.crt_bloom && v.blargg && v.scanlines;
+        case quality::SHADER_SCALE:  return v.shader_mode != video_settings_t::SHADER_OFF &&
+                                            v.shader_scale > SHADER_SCALE_REDUCED;
+        case quality::SHADER_FAST:   return v.shader_mode == video_settings_t::SHADER_FULL;
+        case quality::HIRES_SPRITES: return v.hires && v.hiresprites;
+        default:                     return v.blargg != video_settings_t::BLARGG_DISABLE;
+    }
+}
+
+static bool needs_restart(int step)
+{
+    return step == quality::SHADER_SCALE || step == quality::SHADER_FAST || step == quality::BLARGG;
+}
+
+bool quality::reduce()
+{
+    if (config.videoRestartRequired)
+        return false;
+
+    // An undone step that had to be taken straight back waits twice as long next time
+    if (just_restored)
+        hold = std::min(hold * 2, HOLD_MAX);
+    just_restored = false;
+    waited = 0;
+
+    const int first = steps ? taken[steps - 1] + 1 : 0;
+    for (int step = first; step < STEPS; step++) {
+        if (!applies(step))
+            continue;
+        int* value = setting(step);
+        saved[steps]   = *value;
+        taken[steps++] = step;
+        switch (step) {
+            case BLOOM:         *value = 0; break;
+            case SHADER_SCALE:  *value = SHADER_SCALE_REDUCED; break;
+            case SHADER_FAST:   *value = video_settings_t::SHADER_FAST; break;
+            case HIRES_SPRITES: *value = 0; break;
+            case BLARGG:        *value = video_settings_t::BLARGG_DISABLE; break;
+        }
+        if (needs_restart(step))
+            config.videoRestartRequired = true;
+        printf("\nPerformance check: turning down %s to hold 60 FPS.\n", step_name(step));
+        return true;
+    }
+    return false;
+}
+
+bool quality::restore(bool headroom)
+{
+    just_restored = false;
+    if (!headroom || steps == 0 || config.videoRestartRequired || ++waited < hold)
+        return false;
+    waited = 0;
+
+    const int step = taken[--steps];
+    *setting(step) = saved[steps];
+    if (needs_restart(step))
+        config.videoRestartRequired = true;
+    just_restored = true;
+    printf("\nPerformance check: restoring %s.\n", step_name(step));
+    return true;
+}
+
+void quality::restore_all()
+{
+    if (steps == 0)
+        return;
+    bool restart = false;
+    while (steps) {
+        const int step = taken[--steps];
+        *setting(step) = saved[steps];
+        restart |= needs_restart(step);
+    }
+    if (restart)
+        config.videoRestartRequired = true;
+    just_restored = false;
+    waited = 0;
+}
+
+int quality::level() { return steps; }
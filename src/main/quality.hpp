@@ -0,0 +1,44 @@
+/***************************************************************************
+    Quality Governor.
+
+    When frames at 60fps run late, auto mode (fpsauto) first turns the
+    costlier effects down a step at a time, and only drops to 30fps once
+    there's nothing left to turn down. The steps, in order:
+
+      1. CRT bloom off
+      2. CRT shader at 75% resolution, upscaled
+      3. Full CRT shader to fast
+      4. Hi-res sprites off
+      5. Blargg filter off
+
+    A step is only taken where the setting is on; steps 2, 3 and 5 restart
+    the video. As headroom returns the steps are undone, latest first,
+    waiting longer before trying again each time an undone step has to be
+    taken straight back.
+
+    The settings chosen in the menus are always what's saved: every step is
+    undone when the menu opens and before the config is written.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+namespace quality
+{
+    enum { BLOOM, SHADER_SCALE, SHADER_FAST, HIRES_SPRITES, BLARGG, STEPS };
+
+    // Take the next step down. False if there's none left (or a video restart is pending).
+    bool reduce();
+
+    // For each evaluation at 60fps that kept up: undo the latest step when there's headroom, and
+    // it's been long enough since one was last taken straight back
+    bool restore(bool headroom);
+
+    // Undo every step, at once
+    void restore_all();
+
+    // Steps taken
+    int level();
+}
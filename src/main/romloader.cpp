@@ -8,7 +8,7 @@
     See license.txt for more details.
 
     Refactored to remove Boost and Dirent dependency.
-    Uses std::filesystem for directory scanning and a small CRC32 impl.
+    Uses std::filesystem for directory scanning and the CRC32 in Utils.
 ***************************************************************************/
 
 #include <iostream>
@@ -17,46 +17,138 @@
 #include <unordered_map>
 #include <cstdint>
 #include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "stdint.hpp"
 #include "romloader.hpp"
+#include "persist.hpp"
+#include "utils.hpp"
 #include "frontend/config.hpp"
 
-// -------------------------------
-// Local CRC32 (IEEE 802.3) impl
-// -------------------------------
-namespace {
+static std::unordered_map<int, std::string> map;
+static bool map_created;
+static bool map_from_index;   // some CRCs in map were taken from the index, not the files
+static uint32_t map_bytes;    // most bytes of each file checksummed for map
+static std::mutex map_mutex;  // ROMs are loaded from several threads at once
 
-inline const uint32_t* crc32_table()
+// CRC32 index, so that a boot only checksums ROM directory files that are new or changed since
+// the last. A text file in the save path, a line per file: CRC, size, modified time, bytes
+// checksummed, path.
+static const char* ROM_INDEX_HEADER = "cannonball rom index 1";
+
+struct RomIndexEntry
 {
-    static uint32_t table[256];
-    static bool init = false;
-    if (!init) {
-        for (uint32_t i = 0; i < 256; ++i) {
-            uint32_t c = i;
-            for (int k = 0; k < 8; ++k)
-                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
-            table[i] = c;
-        }
-        init = true;
+    uintmax_t size;
+    long long mtime;
+    uint32_t  bytes;
+    uint32_t  crc;
+};
+
+static std::string rom_index_file() { return config.data.save_path + "rom_index.txt"; }
+
+static std::unordered_map<std::string, RomIndexEntry> read_rom_index()
+{
+    std::unordered_map<std::string, RomIndexEntry> index;
+    std::ifstream src(rom_index_file());
+    std::string line;
+    if (!src || !std::getline(src, line) || line != ROM_INDEX_HEADER)
+        return index;
+
+    while (std::getline(src, line)) {
+        std::istringstream fields(line);
+        RomIndexEntry e;
+        std::string path;
+        if (fields >> std::hex >> e.crc >> std::dec >> e.size >> e.mtime >> e.bytes && fields.get() == ' ' &&
+            std::getline(fields, path))
+            index[path] = e;
     }
-    return table;
+    return index;
 }
 
-inline uint32_t crc32(const void* data, std::size_t n)
+static void write_rom_index(const std::unordered_map<std::string, RomIndexEntry>& index)
 {
-    const uint8_t* p = static_cast<const uint8_t*>(data);
-    uint32_t c = 0xFFFFFFFFu;
-    const uint32_t* T = crc32_table();
-    for (std::size_t i = 0; i < n; ++i)
-        c = T[(c ^ p[i]) & 0xFFu] ^ (c >> 8);
-    return c ^ 0xFFFFFFFFu;
+    std::ostringstream out;
+    out << ROM_INDEX_HEADER << "\n";
+    for (const auto& [path, e] : index)
+        out << std::hex << e.crc << std::dec << " " << e.size << " " << e.mtime << " " << e.bytes << " " << path << "\n";
+    if (!persist::write(rom_index_file(), out.str()))
+        std::cerr << "Could not save the ROM index to " << rom_index_file() << std::endl;
 }
 
-} // namespace
+// A file's contents: memory mapped on Linux, so ROMs are de-interleaved straight from the page
+// cache, and read into memory elsewhere.
+class RomFile
+{
+public:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
 
-static std::unordered_map<int, std::string> map;
-static bool map_created;
+    explicit RomFile(const std::string& path)
+    {
+#ifdef __linux__
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            ok = true;
+            if (st.st_size > 0) {
+                void* m = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m != MAP_FAILED) {
+                    mapped = m;
+                    data   = static_cast<const uint8_t*>(m);
+                    size   = size_t(st.st_size);
+                } else {
+                    ok = false;
+                }
+            }
+        }
+        close(fd);
+#else
+        std::ifstream src(path, std::ios::in | std::ios::binary);
+        if (!src)
+            return;
+        buffer.assign(std::istreambuf_iterator<char>(src), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+        ok   = true;
+#endif
+    }
+
+    ~RomFile()
+    {
+#ifdef __linux__
+        if (mapped)
+            munmap(mapped, size);
+#endif
+    }
+
+    RomFile(const RomFile&) = delete;
+    RomFile& operator=(const RomFile&) = delete;
+
+    explicit operator bool() const { return ok; }
+
+private:
+    bool ok = false;
+#ifdef __linux__
+    void* mapped = nullptr;
+#else
+    std::vector<uint8_t> buffer;
+#endif
+};
 
 RomLoader::RomLoader()
 {
@@ -67,8 +159,7 @@ RomLoader::RomLoader()
 
 RomLoader::~RomLoader()
 {
-    if (rom != NULL)
-        delete[] rom;
+    unload();
 }
 
 void RomLoader::init(const uint32_t length)
@@ -80,8 +171,14 @@ void RomLoader::init(const uint32_t length)
 
 void RomLoader::unload(void)
 {
-    delete[] rom;
+#ifdef __linux__
+    if (mapped && rom != NULL)
+        munmap(rom, length);
+    else
+#endif
+        delete[] rom;
     rom = NULL;
+    mapped = false;
 }
 
 int RomLoader::load_rom(const char* filename, const int offset, const int length, const int expected_crc, const uint8_t interleave, const bool verbose)
@@ -89,7 +186,7 @@ int RomLoader::load_rom(const char* filename, const int offset, const int length
     std::string path = config.data.rom_path;
     path += std::string(filename);
 
-    std::ifstream src(path, std::ios::in | std::ios::binary);
+    RomFile src(path);
     if (!src)
     {
         if (verbose) std::cout << "cannot open rom: " << path << std::endl;
@@ -97,10 +194,8 @@ int RomLoader::load_rom(const char* filename, const int offset, const int length
         return 1;
     }
 
-    char* buffer = new char[length];
-    src.read(buffer, length);
-
-    const uint32_t crc = crc32(buffer, static_cast<std::size_t>(src.gcount()));
+    const size_t bytes = std::min(src.size, static_cast<std::size_t>(length));
+    const uint32_t crc = Utils::crc32(src.data, bytes);
 
     if (expected_crc != static_cast<int>(crc))
     {
@@ -108,26 +203,30 @@ int RomLoader::load_rom(const char* filename, const int offset, const int length
             std::cout << std::hex
                       << filename << " has incorrect checksum.\nExpected: "
                       << expected_crc << " Found: " << crc << std::endl;
-
-        delete[] buffer;
-        src.close();
         return 1;
     }
 
-    for (int i = 0; i < length; i++)
-    {
-        rom[(i * interleave) + offset] = buffer[i];
-    }
-
-    delete[] buffer;
-    src.close();
+    copy_interleaved(src.data, bytes, offset, interleave);
     loaded = true;
     return 0;
 }
 
+void RomLoader::copy_interleaved(const uint8_t* src, const size_t bytes, const int offset, const uint8_t interleave)
+{
+    uint8_t* dst = rom + offset;
+    if (interleave == NORMAL) {
+        std::memcpy(dst, src, bytes);
+        return;
+    }
+    for (size_t i = 0; i < bytes; i++)
+        dst[i * interleave] = src[i];
+}
+
 int RomLoader::create_map()
 {
-    map_created = true;
+    map_created    = true;
+    map_from_index = false;
+    map_bytes      = length;
     namespace fs = std::filesystem;
 
     std::string path = config.data.rom_path;
@@ -138,21 +237,62 @@ int RomLoader::create_map()
         return 1;
     }
 
+    // Files unchanged since the index was written keep their CRC; the rest are checksummed
+    const std::unordered_map<std::string, RomIndexEntry> old_index = read_rom_index();
+    std::unordered_map<std::string, RomIndexEntry> index;
+    std::vector<std::string> files;
+    std::vector<RomIndexEntry> entries;
     for (auto& entry : fs::directory_iterator(dir))
     {
-        if (!entry.is_regular_file()) continue;
-        std::ifstream src(entry.path(), std::ios::in | std::ios::binary);
-        if (!src) continue;
-
-        char* buffer = new char[length];
-        src.read(buffer, length);
-        const uint32_t c = crc32(buffer, static_cast<std::size_t>(src.gcount()));
-        map.insert({ static_cast<int>(c), entry.path().string() });
+        std::error_code ec;
+        if (!entry.is_regular_file(ec)) continue;
+        const std::string file = entry.path().string();
+        RomIndexEntry e = { entry.file_size(ec), 0, length, 0 };
+        e.mtime = static_cast<long long>(entry.last_write_time(ec).time_since_epoch().count());
+
+        auto known = old_index.find(file);
+        if (known != old_index.end() && known->second.size == e.size && known->second.mtime == e.mtime &&
+            known->second.bytes == e.bytes)
+        {
+            index[file] = known->second;
+            map.insert({ static_cast<int>(known->second.crc), file });
+            map_from_index = true;
+            continue;
+        }
+        files.push_back(file);
+        entries.push_back(e);
+    }
 
-        delete[] buffer;
-        src.close();
+    // Checksum the files on several threads at once, as much to overlap the reads as the CRCs
+    std::vector<char> read_ok(files.size(), 0);
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < files.size(); ) {
+            RomFile src(files[i]);
+            if (!src) continue;
+            entries[i].crc = Utils::crc32(src.data, std::min(src.size, static_cast<std::size_t>(length)));
+            read_ok[i]     = 1;
+        }
+    };
+    const size_t threads = std::min<size_t>(files.size(), std::max(2u, std::thread::hardware_concurrency()));
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; t++)
+        pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool)
+        t.join();
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        if (!read_ok[i]) continue;
+        map.insert({ static_cast<int>(entries[i].crc), files[i] });
+        index[files[i]] = entries[i];
     }
 
+    // Rewritten only when something changed
+    if (!files.empty() || index.size() != old_index.size())
+        write_rom_index(index);
+
     if (map.empty())
         std::cout << "Warning: Could not create CRC32 Map. Did you copy the ROM files into the directory? " << std::endl;
 
@@ -161,6 +301,7 @@ int RomLoader::create_map()
 
 int RomLoader::load_crc32(const char* debug, const int offset, const int length, const int expected_crc, const uint8_t interleave, const bool verbose)
 {
+    std::unique_lock<std::mutex> lock(map_mutex);
     if (!map_created)
         create_map();
 
@@ -178,7 +319,11 @@ int RomLoader::load_crc32(const char* debug, const int offset, const int length,
     }
 
     std::string file = search->second;
-    std::ifstream src(file, std::ios::in | std::ios::binary);
+
+    const bool from_index = map_from_index;
+    lock.unlock();
+
+    RomFile src(file);
     if (!src)
     {
         if (verbose) std::cout << "cannot open rom: " << file << std::endl;
@@ -186,14 +331,23 @@ int RomLoader::load_crc32(const char* debug, const int offset, const int length,
         return 1;
     }
 
-    char* buffer = new char[length];
-    src.read(buffer, length);
-
-    for (int i = 0; i < length; i++)
-        rom[(i * interleave) + offset] = buffer[i];
+    // A CRC from the index is checked here, as the file is read anyway. If it's wrong the index is
+    // out of date (a file changed without its size or time changing), so the directory is rescanned.
+    if (from_index &&
+        static_cast<int>(Utils::crc32(src.data, std::min(src.size, static_cast<std::size_t>(map_bytes)))) != expected_crc)
+    {
+        lock.lock();
+        if (map_from_index) {
+            std::cout << "ROM index is out of date, checking every file in " << config.data.rom_path << std::endl;
+            std::remove(rom_index_file().c_str());
+            map.clear();
+            create_map();
+        }
+        lock.unlock();
+        return load_crc32(debug, offset, length, expected_crc, interleave, verbose);
+    }
 
-    delete[] buffer;
-    src.close();
+    copy_interleaved(src.data, std::min(src.size, static_cast<std::size_t>(length)), offset, interleave);
     loaded = true;
     return 0;
 }
@@ -209,6 +363,26 @@ int RomLoader::load_binary(const char* filename)
     }
 
     length = filesize(filename);
+
+#ifdef __linux__
+    // Mapped, so only the parts of a large track pack that are used are read in
+    const int fd = open(filename, O_RDONLY);
+    if (fd >= 0 && length > 0)
+    {
+        void* m = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (m != MAP_FAILED)
+        {
+            rom    = static_cast<uint8_t*>(m);
+            mapped = true;
+            loaded = true;
+            return 0;
+        }
+    }
+    else if (fd >= 0)
+        close(fd);
+#endif
+
     char* buffer = new char[length];
     src.read(buffer, length);
     rom = (uint8_t*) buffer;
@@ -10,6 +10,10 @@
 
 #pragma once
 
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
 class RomLoader
 {
 
@@ -31,23 +35,42 @@ public:
     int (RomLoader::*load)(const char*, const int, const int, const int, const uint8_t, const bool);
     int load_rom(const char* filename, const int offset, const int length, const int expected_crc, const uint8_t mode = NORMAL, const bool verbose = true);
     int load_crc32(const char* debug, const int offset, const int length, const int expected_crc, const uint8_t mode = NORMAL, const bool verbose = true);
+    // Whole file, memory mapped where possible (read only: used for LayOut tracks)
     int load_binary(const char* filename);
     void unload(void);
 
+    // ----------------------------------------------------------------------------
+    // Values stored in either byte order, read with a single load (and byteswap
+    // where the host order differs) rather than assembled a byte at a time.
+    // Any address is fine, aligned or not.
+    // ----------------------------------------------------------------------------
+
+    template <typename T>
+    static inline T load_value(const uint8_t* p, const std::endian order)
+    {
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        return (order == std::endian::native) ? value : std::byteswap(value);
+    }
+
+    static inline uint32_t be32(const uint8_t* p) { return load_value<uint32_t>(p, std::endian::big); }
+    static inline uint16_t be16(const uint8_t* p) { return load_value<uint16_t>(p, std::endian::big); }
+    static inline uint16_t le16(const uint8_t* p) { return load_value<uint16_t>(p, std::endian::little); }
+
     // ----------------------------------------------------------------------------
     // Used by translated 68000 Code
     // ----------------------------------------------------------------------------
 
     inline uint32_t read32(uint32_t* addr)
     {    
-        uint32_t data = (rom[*addr] << 24) | (rom[*addr+1] << 16) | (rom[*addr+2] << 8) | (rom[*addr+3]);
+        uint32_t data = be32(rom + *addr);
         *addr += 4;
         return data;
     }
 
     inline uint16_t read16(uint32_t* addr)
     {
-        uint16_t data = (rom[*addr] << 8) | (rom[*addr+1]);
+        uint16_t data = be16(rom + *addr);
         *addr += 2;
         return data;
     }
@@ -59,12 +82,12 @@ public:
 
     inline uint32_t read32(uint32_t addr)
     {    
-        return (rom[addr] << 24) | (rom[addr+1] << 16) | (rom[addr+2] << 8) | rom[addr+3];
+        return be32(rom + addr);
     }
 
     inline uint16_t read16(uint32_t addr)
     {
-        return (rom[addr] << 8) | rom[addr+1];
+        return be16(rom + addr);
     }
 
     inline uint8_t read8(uint32_t addr)
@@ -79,7 +102,7 @@ public:
 
     inline uint16_t read16(uint16_t* addr)
     {
-        uint16_t data = (rom[*addr+1] << 8) | (rom[*addr]);
+        uint16_t data = le16(rom + *addr);
         *addr += 2;
         return data;
     }
@@ -91,7 +114,7 @@ public:
 
     inline uint16_t read16(uint16_t addr)
     {
-        return (rom[addr+1] << 8) | rom[addr];
+        return le16(rom + addr);
     }
 
     inline uint8_t read8(uint16_t addr)
@@ -100,6 +123,9 @@ public:
     }
 
 private:
+    bool mapped = false;    // rom is a file mapping from load_binary, not allocated
+
     int create_map();
+    void copy_interleaved(const uint8_t* src, const size_t bytes, const int offset, const uint8_t interleave);
     int filesize(const char* filename);
 };
\ No newline at end of file
@@ -26,8 +26,19 @@
 #include <cctype>
 #include <algorithm>        // for std::min & std::clamp
 #include <cstring>
+#include <cstdio>           // SEEK_SET
+#include <fstream>
+#include <filesystem>
 
 #include "sdl2/audio.hpp"
+#include "threadpolicy.hpp"
+#include "frametrace.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 //#include "frontend/config.hpp" // fps
 #include "engine/audio/osoundint.hpp"
@@ -105,9 +116,15 @@ static const MpgLike kWavApi = {
 static constexpr uint32_t FADE_BITS    = 18;
 static constexpr uint32_t FADE_LEN     = (1u << FADE_BITS);
 
+// Ring for streamed .mp3 playback (see Audio::stream_mp3)
+// 2^19 samples at 44.1kHz stereo is about 6 seconds
+static constexpr uint32_t WAV_RING_LEN = (1u << 19);
+
 
 Audio::~Audio()
 {
+    music_cache_stop = true;
+    if (music_cache_thread.joinable()) music_cache_thread.join();
     stop_audio();
     mpg123_exit();
     wav123_exit();
@@ -124,6 +141,7 @@ void Audio::init()
             std::cerr << "Failed to init wav123\n";
         }
         start_audio();
+        start_music_cache();
         bits_per_sample = BITS;
         // std::cout << "Audio::init: Bits per sample: " << bits_per_sample << "\n";
     }
@@ -226,6 +244,33 @@ void Audio::start_audio(bool list_devices_only)
 
         mix_buffer_bytes = obtained.samples * CHANNELS * (BITS / 8);
 
+        // or no ring at all: the callback renders each buffer as it's asked for it
+        direct = config.sound.direct != 0;
+
+        // ring depth for the configured latency, in whole buffers
+        period_ms        = std::max(1u, uint32_t(obtained.samples) * 1000 / FREQ);
+        window_callbacks = std::max(1u, 2000 / period_ms);
+        target_depth     = std::clamp<uint32_t>((std::max(config.sound.latency, 0) + period_ms / 2) / period_ms,
+                                                1, RING_MAX);
+        ring_depth.store(target_depth, std::memory_order_relaxed);
+        if (direct)
+            std::cout << "Audio rendered directly by the SDL callback (" << period_ms << "ms)" << std::endl;
+        else
+            std::cout << "Audio latency target: " << target_depth * period_ms << "ms ("
+                      << target_depth << " buffers)" << std::endl;
+
+        // resample the chips if they run at another rate (see OSoundInt::init)
+        const uint32_t chip_rate = config.sound.chip_rate > 0 ? uint32_t(config.sound.chip_rate) : FREQ;
+        if (chip_rate != FREQ) {
+            resampler.init(chip_rate / 125, FREQ / 125);
+            chip_mix.assign(size_t(resampler.get_frames_in()) * CHANNELS, 0);
+            chip_out.assign(size_t(resampler.get_frames_out()) * CHANNELS, 0);
+            chip_silence.assign(chip_out.size(), 0);
+            std::cout << "Sound chips at " << chip_rate << "Hz, resampled to " << FREQ << "Hz" << std::endl;
+        } else {
+            resampler.init(0, 0);
+        }
+
         clear_buffers();
         clear_wav();
 
@@ -260,10 +305,10 @@ void Audio::stop_audio()
     SDL_PauseAudioDevice(dev, 1);
     SDL_LockAudioDevice(dev);
 
-//    running.store(false);
-//    spaceAvailable.release(BUFFER_COUNT);
-    // Fix for Windows to avoid over-release of counting semaphore
+    // the callback is stopped, so wake the mixing thread ourselves
     running.store(false, std::memory_order_relaxed);
+    wake.fetch_add(1, std::memory_order_release);
+    wake.notify_one();
     if (mixThread.joinable()) mixThread.join();
 
     audio_paused = 2;
@@ -293,44 +338,230 @@ void Audio::tick()
     if (audio_paused) {
         // Drop anything still queued
         clear_buffers();
+        prodIndex.store(0, std::memory_order_relaxed);
+        consIndex.store(0, std::memory_order_relaxed);
+        window_count    = 0;
+        window_min_lead = RING_MAX;
+        quiet_windows   = 1;
+        ring_primed     = false;
+
+        // restart the audio clock from the mixer's position
+        osoundint.ticks_played.store(osoundint.ticks_rendered(), std::memory_order_relaxed);
 
         running.store(true);
-        // launch mixing thread
-        mixThread = std::thread(&Audio::mixing_loop, this);
+        // launch mixing thread, unless the callback does the mixing itself
+        if (!direct)
+            mixThread = std::thread(&Audio::mixing_loop, this);
 
         // and unpause the device
         SDL_PauseAudioDevice(dev, 0);
         audio_paused = 0;
         std::cout << "Audio started" << std::endl;
     }
+
+    // 3) Report changes made by the adaptive ring depth (the callback mustn't block on output),
+    //    and keep the sound queue's look-ahead to match
+    if (direct) {
+        // each tick is rendered as it's played, so a queued sound is due on the next
+        osoundint.ticks_ahead.store(0, std::memory_order_relaxed);
+        return;
+    }
+    const uint32_t depth = ring_depth.load(std::memory_order_relaxed);
+    osoundint.ticks_ahead.store(depth * (config.sound.callback_rate == 0 ? 1 : 2), std::memory_order_relaxed);
+    if (reported_depth != 0 && depth != reported_depth)
+        std::cout << "Audio latency now " << depth * period_ms << "ms ("
+                  << underruns.load(std::memory_order_relaxed) << " underruns)" << std::endl;
+    reported_depth = depth;
 }
 
 
-/* Linux safe version
-void Audio::mixing_loop() {
-    while (running.load()) {
-        // wait for space
-        spaceAvailable.acquire();
-        // fill next buffer slot
-        auto &dst = ringBuffer[prodIndex.load()];
-        fill_and_mix(reinterpret_cast<uint8_t*>(dst.data()), mix_buffer_bytes);
-        // signal data ready
-        samplesReady.release();
-        prodIndex = (prodIndex + 1) % BUFFER_COUNT;
+Audio::ring_stats_t Audio::get_ring_stats() const
+{
+    return { underruns.load(std::memory_order_relaxed), ring_depth.load(std::memory_order_relaxed),
+             lead_ms.load(std::memory_order_relaxed),   grows.load(std::memory_order_relaxed),
+             shrinks.load(std::memory_order_relaxed) };
+}
+
+
+int Audio::wav_state() const
+{
+    if (!wavfile.streaming.load(std::memory_order_relaxed))
+        return wav_job_pending.load(std::memory_order_relaxed) ? WAV_LOADING : WAV_NONE;
+    return wavfile.fully_loaded.load(std::memory_order_relaxed) ? WAV_LOADED : WAV_STREAMING;
+}
+
+
+// Called by the callback with whether it found nothing to play, and how many buffers were ready
+// when it ran. Underruns before the first buffer has been played are just the mixer starting.
+void Audio::adapt_ring(bool underrun, uint32_t lead)
+{
+    uint32_t depth = ring_depth.load(std::memory_order_relaxed);
+    if (!underrun) ring_primed = true;
+
+    if (underrun && ring_primed) {
+        underruns.fetch_add(1, std::memory_order_relaxed);
+        if (quiet_windows > 0 && depth < uint32_t(RING_MAX)) {
+            // at most one increase per window, giving the mixer time to fill the extra buffer
+            ring_depth.store(depth + 1, std::memory_order_relaxed);
+            grows.fetch_add(1, std::memory_order_relaxed);
+        }
+        quiet_windows   = 0;
+        window_count    = 0;
+        window_min_lead = RING_MAX;
+        return;
+    }
+
+    window_min_lead = std::min(window_min_lead, lead);
+    if (++window_count < window_callbacks) return;
+
+    // end of a window
+    lead_ms.store(window_min_lead * period_ms, std::memory_order_relaxed);
+    if (++quiet_windows >= 8 && window_min_lead >= 2 && depth > target_depth) {
+        // no underruns for 8 windows, and always a buffer to spare: one fewer will do
+        ring_depth.store(depth - 1, std::memory_order_relaxed);
+        shrinks.fetch_add(1, std::memory_order_relaxed);
+        quiet_windows = 1;
     }
+    window_count    = 0;
+    window_min_lead = RING_MAX;
 }
-*/
-// JJP - Cross-platform safe version; avoids over-release of counting semaphore
+
+
+// Fills the ring whenever it has space, and otherwise sleeps until the callback takes a buffer
+// (or stop_audio() wakes it).
 void Audio::mixing_loop() {
+    threadpolicy::apply(threads_settings_t::MIXER);
     while (running.load(std::memory_order_relaxed)) {
-        // wait for space, but time out so we can re-check 'running'
-        if (!spaceAvailable.try_acquire_for(std::chrono::milliseconds(2))) {
-            continue; // timed out; loop back and re-check 'running'
+        // read 'wake' first, so a callback after the check below still ends the wait
+        const uint32_t w    = wake.load(std::memory_order_acquire);
+        const uint32_t prod = prodIndex.load(std::memory_order_relaxed);
+        if (prod - consIndex.load(std::memory_order_acquire) >= ring_depth.load(std::memory_order_relaxed)) {
+            wake.wait(w, std::memory_order_acquire);
+            continue;
         }
-        auto &dst = ringBuffer[prodIndex.load(std::memory_order_relaxed)];
+        auto &dst = ringBuffer[prod % RING_MAX];
         fill_and_mix(reinterpret_cast<uint8_t*>(dst.data()), mix_buffer_bytes);
-        samplesReady.release();
-        prodIndex = (prodIndex + 1) % BUFFER_COUNT;
+        prodIndex.store(prod + 1, std::memory_order_release);  // publish the slot
+    }
+}
+
+
+// Final mix of n samples: out = clamp(a + b + (wav * vol >> 13)), or clamp(a + b) without a wav.
+// Sums are formed in 32 bits and narrowed with saturation, so match the scalar clamp exactly.
+static void mix_block(int16_t* out, const int16_t* a, const int16_t* b,
+                      const int16_t* wav, int32_t vol, uint32_t n)
+{
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128i v = _mm_set1_epi16(int16_t(vol));
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x = _mm_loadu_si128((const __m128i*) (a + i));
+        const __m128i y = _mm_loadu_si128((const __m128i*) (b + i));
+        // sign extend by unpacking each sample to the top half of a 32-bit lane
+        __m128i lo = _mm_add_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16),
+                                   _mm_srai_epi32(_mm_unpacklo_epi16(y, y), 16));
+        __m128i hi = _mm_add_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16),
+                                   _mm_srai_epi32(_mm_unpackhi_epi16(y, y), 16));
+        if (wav) {
+            const __m128i w  = _mm_loadu_si128((const __m128i*) (wav + i));
+            const __m128i pl = _mm_mullo_epi16(w, v);
+            const __m128i ph = _mm_mulhi_epi16(w, v);
+            lo = _mm_add_epi32(lo, _mm_srai_epi32(_mm_unpacklo_epi16(pl, ph), 13));
+            hi = _mm_add_epi32(hi, _mm_srai_epi32(_mm_unpackhi_epi16(pl, ph), 13));
+        }
+        _mm_storeu_si128((__m128i*) (out + i), _mm_packs_epi32(lo, hi));
+    }
+#elif defined(__ARM_NEON)
+    const int16x4_t v = vdup_n_s16(int16_t(vol));
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t x = vld1q_s16(a + i);
+        const int16x8_t y = vld1q_s16(b + i);
+        int32x4_t lo = vaddl_s16(vget_low_s16(x),  vget_low_s16(y));
+        int32x4_t hi = vaddl_s16(vget_high_s16(x), vget_high_s16(y));
+        if (wav) {
+            const int16x8_t w = vld1q_s16(wav + i);
+            lo = vaddq_s32(lo, vshrq_n_s32(vmull_s16(vget_low_s16(w),  v), 13));
+            hi = vaddq_s32(hi, vshrq_n_s32(vmull_s16(vget_high_s16(w), v), 13));
+        }
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+#endif
+    for (; i < n; i++) {
+        int32_t s = int32_t(a[i]) + b[i];
+        if (wav) s += (int32_t(wav[i]) * vol) >> 13;
+        out[i] = static_cast<int16_t>(std::clamp(s, -32768, 32767));
+    }
+}
+
+
+// Cross-fade of n samples on repeat: the tail fades out over FADE_LEN samples, fadein of which
+// have passed, and the head is added at full volume. Matches the scalar float arithmetic.
+static void mix_fade(int16_t* out, const int16_t* a, const int16_t* b,
+                     const int16_t* tail, const int16_t* head, int32_t vol, uint32_t fadein, uint32_t n)
+{
+    const float step = 1.0f / FADE_LEN; // exact, FADE_LEN being a power of two
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128i v    = _mm_set1_epi16(int16_t(vol));
+    const __m128  one  = _mm_set1_ps(1.0f);
+    const __m128  vstep = _mm_set1_ps(step);
+    __m128i frame = _mm_add_epi32(_mm_set1_epi32(int32_t(fadein)), _mm_setr_epi32(0, 1, 2, 3));
+    const __m128i four = _mm_set1_epi32(4);
+    for (; i + 8 <= n; i += 8) {
+        const __m128i x  = _mm_loadu_si128((const __m128i*) (a + i));
+        const __m128i y  = _mm_loadu_si128((const __m128i*) (b + i));
+        const __m128i t  = _mm_loadu_si128((const __m128i*) (tail + i));
+        const __m128i h  = _mm_loadu_si128((const __m128i*) (head + i));
+        const __m128i tl = _mm_mullo_epi16(t, v), th = _mm_mulhi_epi16(t, v);
+        const __m128i hl = _mm_mullo_epi16(h, v), hh = _mm_mulhi_epi16(h, v);
+        __m128i s[2];
+        for (int k = 0; k < 2; k++) {
+            const __m128i tail_samp = _mm_srai_epi32(k ? _mm_unpackhi_epi16(tl, th) : _mm_unpacklo_epi16(tl, th), 13);
+            const __m128i head_samp = _mm_srai_epi32(k ? _mm_unpackhi_epi16(hl, hh) : _mm_unpacklo_epi16(hl, hh), 13);
+            const __m128  m  = _mm_mul_ps(_mm_cvtepi32_ps(frame), vstep);
+            const __m128i wf = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(tail_samp), _mm_sub_ps(one, m)),
+                                                           _mm_cvtepi32_ps(head_samp)));
+            const __m128i xs = _mm_srai_epi32(k ? _mm_unpackhi_epi16(x, x) : _mm_unpacklo_epi16(x, x), 16);
+            const __m128i ys = _mm_srai_epi32(k ? _mm_unpackhi_epi16(y, y) : _mm_unpacklo_epi16(y, y), 16);
+            s[k]  = _mm_add_epi32(_mm_add_epi32(xs, ys), wf);
+            frame = _mm_add_epi32(frame, four);
+        }
+        _mm_storeu_si128((__m128i*) (out + i), _mm_packs_epi32(s[0], s[1]));
+    }
+#elif defined(__ARM_NEON)
+    const int16x4_t v     = vdup_n_s16(int16_t(vol));
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const int32_t first[4] = {0, 1, 2, 3};
+    int32x4_t frame = vaddq_s32(vdupq_n_s32(int32_t(fadein)), vld1q_s32(first));
+    for (; i + 8 <= n; i += 8) {
+        const int16x8_t x = vld1q_s16(a + i);
+        const int16x8_t y = vld1q_s16(b + i);
+        const int16x8_t t = vld1q_s16(tail + i);
+        const int16x8_t h = vld1q_s16(head + i);
+        int16x4_t r[2];
+        for (int k = 0; k < 2; k++) {
+            const int32x4_t tail_samp = vshrq_n_s32(vmull_s16(k ? vget_high_s16(t) : vget_low_s16(t), v), 13);
+            const int32x4_t head_samp = vshrq_n_s32(vmull_s16(k ? vget_high_s16(h) : vget_low_s16(h), v), 13);
+            const float32x4_t m = vmulq_n_f32(vcvtq_f32_s32(frame), step);
+            // separate multiply and add (not fused), as the scalar code
+            const float32x4_t f = vaddq_f32(vmulq_f32(vcvtq_f32_s32(tail_samp), vsubq_f32(one, m)),
+                                            vcvtq_f32_s32(head_samp));
+            const int32x4_t s = vaddq_s32(vaddl_s16(k ? vget_high_s16(x) : vget_low_s16(x),
+                                                    k ? vget_high_s16(y) : vget_low_s16(y)),
+                                          vcvtq_s32_f32(f));
+            r[k]  = vqmovn_s32(s);
+            frame = vaddq_s32(frame, vdupq_n_s32(4));
+        }
+        vst1q_s16(out + i, vcombine_s16(r[0], r[1]));
+    }
+#endif
+    for (; i < n; i++) {
+        float m = float(fadein + i) * step;
+        int32_t tail_samp = (int32_t(tail[i]) * vol) >> 13;
+        int32_t head_samp = (int32_t(head[i]) * vol) >> 13;
+        int32_t wf = int32_t(tail_samp*(1.0f - m) + head_samp); // head_samp*m to fade-in repeat track
+        int32_t s = int32_t(a[i]) + b[i] + wf;
+        out[i] = static_cast<int16_t>(std::clamp(s, -32768, 32767));
     }
 }
 
@@ -338,6 +569,7 @@ void Audio::mixing_loop() {
 void Audio::fill_and_mix(uint8_t *stream, int len)
 {
     // Call-back routine - provides SDL with 8ms (or 16ms if config.sound.callback_rate != 0) of audio samples
+    frametrace::Scope trace(frametrace::AUDIO_MIX);
 
     int16_t *out       = reinterpret_cast<int16_t*>(stream);
     int cycles         = (config.sound.callback_rate == 0 ? 1 : 2);
@@ -353,34 +585,63 @@ void Audio::fill_and_mix(uint8_t *stream, int len)
         osoundint.pcm->stream_update();
         osoundint.ym ->stream_update();
 
-        auto* pcm_buf = osoundint.pcm->get_buffer();
-        auto* ym_buf  = osoundint.ym ->get_buffer();
-        if (osoundint.pcm->buffer_size < samples)
+        const int16_t* pcm_buf = osoundint.pcm->get_buffer();
+        const int16_t* ym_buf  = osoundint.ym ->get_buffer();
+        if (resampler.active()) {
+            // chips at their own rate: mix them and resample once, then mix the result as the PCM
+            const size_t n = std::min<size_t>(chip_mix.size(), std::min(osoundint.pcm->buffer_size,
+                                                                        osoundint.ym->buffer_size));
+            mix_block(chip_mix.data(), pcm_buf, ym_buf, nullptr, 0, uint32_t(n));
+            resampler.process(chip_mix.data(), chip_out.data());
+            pcm_buf = chip_out.data();
+            ym_buf  = chip_silence.data();
+            if (chip_out.size() < samples)
+                samples = chip_out.size();
+        } else if (osoundint.pcm->buffer_size < samples)
             samples = osoundint.pcm->buffer_size;
 
-        // 2) mix +/- optional WAV
-        if (wavfile.streaming) {
-            std::lock_guard<std::mutex> lock(wav_mutex);
-            uint32_t pos       = wavfile.pos;
-            uint32_t fade_pos  = wavfile.fade_pos;
-            uint32_t avail     = wavfile.loaded_length - pos; // number of samples we could use
-            uint32_t total_len = wavfile.total_length;
+        // 2) mix +/- optional WAV (lock-free, see wav_t)
+        wav_in_use.store(true);
+        if (wavfile.streaming.load()) {
+            uint32_t pos       = wavfile.pos.load(std::memory_order_relaxed);
+            const bool fully_loaded = wavfile.fully_loaded.load(std::memory_order_acquire);
+            uint32_t fade_pos  = wavfile.fade_pos.load(std::memory_order_relaxed);
+            uint32_t total_len = wavfile.total_length.load(std::memory_order_relaxed);
+            uint64_t lap_base  = wavfile.lap_base.load(std::memory_order_relaxed);
+            const bool ring    = wavfile.ring_len != 0;
+            const uint32_t ring_mask = wavfile.ring_len - 1;
+            const int32_t vol  = WAV_VOL_TABLE[config.sound.wave_volume];
+
+            // track samples from p, and in *len how many of the n wanted follow on in memory
+            auto span = [&](uint32_t p, uint32_t n, uint32_t* len) -> const int16_t* {
+                if (!ring)        { *len = n; return wavfile.data + p; }
+                if (p < FADE_LEN) { *len = std::min(n, FADE_LEN - p); return wavfile.head + p; }
+                const uint32_t r = uint32_t(lap_base + p - FADE_LEN) & ring_mask;
+                *len = std::min(n, wavfile.ring_len - r);
+                return wavfile.data + r;
+            };
+            // number of samples from pos we could use (up to the end of the track)
+            auto available = [&]() -> uint32_t {
+                int64_t a = int64_t(wavfile.loaded_length.load(std::memory_order_acquire)) - pos;
+                if (ring)
+                    a += int64_t(wavfile.ring_write.load(std::memory_order_acquire)) - int64_t(lap_base);
+                return uint32_t(std::clamp<int64_t>(a, 0, total_len - pos));
+            };
+            uint32_t avail     = available();
 
             uint32_t i = 0;
             // first part - run till lesser or avail and samples
             uint32_t end = std::min(samples, avail);
 
-            if (wavfile.fully_loaded && (pos >= fade_pos) && (fade_pos > 0)) {
+            if (fully_loaded && (pos >= fade_pos) && (fade_pos > 0)) {
                 // near the end of the trade, fade out tail and fail-in head)
-                for (; i < end; ++i, ++pos, ++fadein) {
-                    float m = float(fadein) / FADE_LEN;
-                    int32_t tail_samp = (int32_t(wavfile.data[pos]) * WAV_VOL_TABLE[config.sound.wave_volume]) >> 13;
-                    int32_t head_samp = (int32_t(wavfile.data[fadein]) * WAV_VOL_TABLE[config.sound.wave_volume]) >> 13;
-                    int32_t wf = int32_t(tail_samp*(1.0f - m) + head_samp); // head_samp*m to fade-in repeat track
-
-                    // add generated audio and mixed wav, then clamp to 16-bit
-                    int32_t s = pcm_buf[i] + ym_buf[i] + wf;
-                    *out++ = static_cast<int16_t>(std::clamp(s, -32768, 32767));
+                // add generated audio and mixed wav, then clamp to 16-bit
+                while (i < end) {
+                    uint32_t n;
+                    const int16_t* tail = span(pos, end - i, &n);
+                    const int16_t* head = span(fadein, n, &n);
+                    mix_fade(out, pcm_buf + i, ym_buf + i, tail, head, vol, fadein, n);
+                    out += n; i += n; pos += n; fadein += n;
                 }
             }
 
@@ -388,16 +649,18 @@ void Audio::fill_and_mix(uint8_t *stream, int len)
             if (pos >= total_len) {
                 pos     = fadein; // continue after the fadein
                 fadein  = 0;
-                avail   = wavfile.loaded_length - pos;
+                if (ring)
+                    lap_base += total_len - FADE_LEN;
+                avail   = available();
                 end     = std::min(samples, avail);
             }
 
             // Process the remainder of this callback from the start of the file
-            for (; i < end; ++i) {
-                int32_t s = pcm_buf[i] + ym_buf[i];
-                // mix in wave/mp3 sample
-                s += (int32_t(wavfile.data[pos++]) * WAV_VOL_TABLE[config.sound.wave_volume]) >> 13;
-                *out++ = static_cast<int16_t>(std::clamp(s, -32768, 32767));
+            while (i < end) {
+                uint32_t n;
+                const int16_t* wav = span(pos, end - i, &n);
+                mix_block(out, pcm_buf + i, ym_buf + i, wav, vol, n);
+                out += n; i += n; pos += n;
             }
 
             // check position again (should never meet this case)
@@ -407,33 +670,57 @@ void Audio::fill_and_mix(uint8_t *stream, int len)
             }
 
             // Finally anything left from just generate audio (wav file might be still loading)
-            for (; i < samples; ++i) {
-                int32_t s = pcm_buf[i] + ym_buf[i];
-                *out++ = static_cast<int16_t>(std::clamp(s, -32768, 32767));
+            if (i < samples) {
+                mix_block(out, pcm_buf + i, ym_buf + i, nullptr, 0, samples - i);
+                out += samples - i;
+            }
+            wavfile.pos.store(pos, std::memory_order_relaxed);
+            if (ring) {
+                // the loader may overwrite anything before this
+                wavfile.lap_base.store(lap_base, std::memory_order_relaxed);
+                wavfile.ring_read.store(lap_base + (pos > FADE_LEN ? pos - FADE_LEN : 0),
+                                        std::memory_order_release);
             }
-            wavfile.pos = pos;
         } else {
             // no wav/mp3 playing - mix PCM+YM and output
-            for (uint32_t i = 0; i < samples; ++i) {
-                int32_t s = pcm_buf[i] + ym_buf[i];
-                *out++ = static_cast<int16_t>(std::clamp(s, -32768, 32767));
-            }
+            mix_block(out, pcm_buf, ym_buf, nullptr, 0, samples);
+            out += samples;
         }
+        wav_in_use.store(false, std::memory_order_release);
     }
 }
 
 
 void Audio::sdl_callback_trampoline(void* udata, Uint8* stream, int len)
 {
+    // Runs on SDL's audio thread, so must never block
     auto* self = static_cast<Audio*>(udata);
-    // wait until a buffer is ready
-    self->samplesReady.acquire();
-    // copy one buffer
-    auto &src = self->ringBuffer[self->consIndex.load()];
-    memcpy(stream, src.data(), len);
-    self->consIndex = (self->consIndex + 1) % BUFFER_COUNT;
-    // free space for mixer
-    self->spaceAvailable.release();
+    if (self->direct) {
+        // no ring: render straight into SDL's buffer. Never an underrun, but the whole mix
+        // must now fit inside the callback.
+        if (self->audio_paused) {
+            memset(stream, 0, len);
+            return;
+        }
+        self->fill_and_mix(stream, len);
+        osoundint.ticks_played.fetch_add(config.sound.callback_rate == 0 ? 1 : 2, std::memory_order_relaxed);
+        return;
+    }
+    const uint32_t cons = self->consIndex.load(std::memory_order_relaxed);
+    const uint32_t lead = self->prodIndex.load(std::memory_order_acquire) - cons;
+    if (lead == 0) {
+        // underrun: nothing mixed yet
+        memset(stream, 0, len);
+    } else {
+        // copy one buffer, then hand its slot back to the mixer
+        auto &src = self->ringBuffer[cons % RING_MAX];
+        memcpy(stream, src.data(), len);
+        self->consIndex.store(cons + 1, std::memory_order_release);
+        osoundint.ticks_played.fetch_add(config.sound.callback_rate == 0 ? 1 : 2, std::memory_order_relaxed);
+    }
+    self->adapt_ring(lead == 0, lead);
+    self->wake.fetch_add(1, std::memory_order_release);
+    self->wake.notify_one();
 }
 
 
@@ -455,6 +742,17 @@ void Audio::load_audio(const char* filename)
     std::string ext = fn.substr(dot + 1);
     for (auto& c : ext) c = static_cast<char>(tolower(c));
 
+    // play an .mp3 from its decoded copy, if there is one (see thread_music_cache)
+    if (ext == "mp3" && config.sound.music_cache) {
+        const std::string cached = music_cache_file(fn);
+        std::error_code ec;
+        if (!cached.empty() && std::filesystem::exists(cached, ec)) {
+            fn  = cached;
+            ext = "wav";
+            filename = fn.c_str();
+        }
+    }
+
     // Check if we already have loaded (or are loading) this file under the lock
     {
         std::lock_guard<std::mutex> lock(wav_mutex);
@@ -527,12 +825,52 @@ void Audio::thread_load_wav(std::string filename)
         return;
     }
 
+    // A .wav already in the mixer format needn't be decoded at all: play it straight from a
+    // mapping of the file. The handle is kept open to hold the mapping until clear_wav().
+    if (is_wav) {
+        size_t mapped_samples = 0;
+        const int16_t* mapped = wav123_map((wav123_handle*)h, &mapped_samples);
+        if (mapped && mapped_samples > 0) {
+            // trim the quiet tail as below; this only reads the samples
+            long lowerthreshold = (long(6144) * WAV_THRESHOLD_TABLE[config.sound.wave_volume]) >> 13;
+            size_t i = std::min<size_t>(mapped_samples, UINT32_MAX);
+            const uint32_t length = uint32_t(i);
+            while (i>0) { if (mapped[--i] > lowerthreshold) break; }
+            {
+                std::lock_guard<std::mutex> lock(wav_mutex);
+                if (wavfile.data && wavfile.data != EMPTY_BUFFER)
+                    std::free(wavfile.data);
+                wavfile.data          = const_cast<int16_t*>(mapped); // never written
+                wavfile.mapped        = (wav123_handle*)h;
+                wavfile.filename      = filename;
+                const uint32_t total  = (i>0) ? uint32_t(i) : length;
+                wavfile.total_length  = total;
+                wavfile.loaded_length = total;
+                wavfile.pos           = 0;
+                wavfile.fade_pos      = (total > FADE_LEN) ? (total - FADE_LEN) : 0;
+                wavfile.fully_loaded  = true;
+                wavfile.stopping      = false;
+                wavfile.streaming     = true;   // publishes the above to the mixer
+            }
+            std::cout << "Audio file " << filename << " mapped (" << length << " samples)." << std::endl;
+            return;
+        }
+    }
+
     // 1) Determine total sample count (frames × channels) at output rate
     const off_t frames = api.length(h);
     size_t total_samples = frames > 0 ? static_cast<size_t>(frames) * CHANNELS
                                       : (FREQ * 60 * CHANNELS); // fallback 60s if unknown
     const size_t threshold = FREQ * 2 * CHANNELS; // begin playback after ~2s decoded
 
+    // an .mp3 of more than a few seconds is decoded as it plays, rather than held in full
+    if (!is_wav && frames > 0 && total_samples > 2 * FADE_LEN + WAV_RING_LEN) {
+        stream_mp3(h, filename);
+        api.close(h);
+        api.del(h);
+        return;
+    }
+
     // 2) Allocate/initialize shared buffer state
     {
         std::lock_guard<std::mutex> lock(wav_mutex);
@@ -565,10 +903,7 @@ void Audio::thread_load_wav(std::string filename)
                          ((outrun.game_state == GS_INIT_MUSIC) ?
                              wait_time_init_music
                            : wait_time);
-        {
-            std::lock_guard<std::mutex> lock(wav_mutex);
-            stopping = wavfile.stopping;
-        }
+        stopping = wavfile.stopping;
         if (stopping) break;
 
         // check to see if we're just moving away from the start line
@@ -587,18 +922,16 @@ void Audio::thread_load_wav(std::string filename)
             const int r = api.read(h, buf.data(), buf.size(), &done);
             if (done > 0) {
                 const size_t samples = done / sizeof(int16_t);
-                std::lock_guard<std::mutex> lock(wav_mutex);
-                if (!stopping) {
-                    size_t room = (wavfile.total_length > wavfile.loaded_length)
-                                  ? (wavfile.total_length - wavfile.loaded_length)
-                                  : 0;
-                    size_t to_copy = std::min(samples, room);
-                    std::memcpy(wavfile.data + wavfile.loaded_length, buf.data(), to_copy * sizeof(int16_t));
-                    wavfile.loaded_length += to_copy;
-                    i_samples += to_copy;
-                    if (!wavfile.streaming && wavfile.loaded_length >= threshold) {
-                        wavfile.streaming = true; // okay to start playback now
-                    }
+                // only this thread writes the buffer, and the mixer reads only up to loaded_length
+                const uint32_t loaded = wavfile.loaded_length.load(std::memory_order_relaxed);
+                const uint32_t total  = wavfile.total_length.load(std::memory_order_relaxed);
+                size_t room = (total > loaded) ? (total - loaded) : 0;
+                size_t to_copy = std::min(samples, room);
+                std::memcpy(wavfile.data + loaded, buf.data(), to_copy * sizeof(int16_t));
+                wavfile.loaded_length.store(loaded + uint32_t(to_copy), std::memory_order_release);
+                i_samples += to_copy;
+                if (!wavfile.streaming && loaded + to_copy >= threshold) {
+                    wavfile.streaming = true; // okay to start playback now
                 }
             }
 
@@ -633,36 +966,302 @@ void Audio::thread_load_wav(std::string filename)
         // 5) Log fully loaded
         std::cout << "Audio file " << filename << " loaded (" << wavfile.total_length << " samples)." << std::endl;
         // 6) Mark load complete; set fade position (for cross-fade on repeat)
-        {
-            std::lock_guard<std::mutex> lock(wav_mutex);
-            wavfile.total_length  = i_samples; // trim to what we actually filled
-            wavfile.loaded_length = wavfile.total_length;
-            wavfile.fully_loaded  = true;
-            wavfile.fade_pos      =   (wavfile.total_length > FADE_LEN)
-                                    ? (wavfile.total_length - FADE_LEN) : 0;
-        }
+        wavfile.total_length  = uint32_t(i_samples); // trim to what we actually filled
+        wavfile.loaded_length = uint32_t(i_samples);
+        wavfile.fade_pos      = (i_samples > FADE_LEN) ? uint32_t(i_samples - FADE_LEN) : 0;
+        wavfile.fully_loaded  = true;                  // publishes the above to the mixer
     } else {
         std::cout << "Audio file load cancelled." << std::endl;
     }
 }
 
 
-void Audio::clear_wav()
+void Audio::stream_mp3(void* h, const std::string& filename)
 {
-    // If a previous wave load job is still running, wait for it to finish
+    // runs on the loader thread until clear_wav(), keeping the ring filled ahead of playback. The
+    // first FADE_LEN samples go to the head buffer; the rest of the track follows through the
+    // ring, then mpg123 seeks back to FADE_LEN and the next lap follows on.
+    const MpgLike& api = kMp3Api;
+    int16_t* ring = (int16_t*)std::malloc(WAV_RING_LEN * sizeof(int16_t));
+    int16_t* head = (int16_t*)std::malloc(FADE_LEN * sizeof(int16_t));
+    if (!ring || !head) {
+        std::cerr << "Audio::stream_mp3: out of memory" << std::endl;
+        std::free(ring);
+        std::free(head);
+        return;
+    }
+
     {
         std::lock_guard<std::mutex> lock(wav_mutex);
-        wavfile.stopping = true;
+        if (wavfile.data && wavfile.data != EMPTY_BUFFER)
+            std::free(wavfile.data);
+        wavfile.data          = ring;
+        wavfile.head          = head;
+        wavfile.filename      = filename;
+        wavfile.total_length  = UINT32_MAX;  // until the end of the track is found
+        wavfile.loaded_length = 0;
+        wavfile.pos           = 0;
+        wavfile.fade_pos      = 0;
+        wavfile.streaming     = false;
+        wavfile.fully_loaded  = false;
+        wavfile.stopping      = false;
+        wavfile.ring_len      = WAV_RING_LEN;
+        wavfile.ring_write    = 0;
+        wavfile.ring_read     = 0;
+        wavfile.lap_base      = 0;
+    }
+
+    const size_t threshold  = FREQ * 2 * CHANNELS;  // begin playback after ~2s decoded
+    const uint32_t mask     = WAV_RING_LEN - 1;
+    std::vector<int16_t> buf(8192);                 // about 90ms assuming 44.1kHz stereo
+    uint32_t dec_pos = 0;                           // track position of the next sample decoded
+    uint32_t total   = UINT32_MAX;                  // track length, once known
+
+    // pacing as thread_load_wav()
+    auto wait_time            = std::chrono::duration<double>(1.0 / 30);
+    auto wait_time_init_music = std::chrono::duration<double>(1.0 / 120);
+    int64_t buffer_min = (FREQ * CHANNELS) >> 3;    // 125ms worth of data
+
+    while (true) {
+        auto nextframe = std::chrono::steady_clock::now() +
+                         ((outrun.game_state == GS_INIT_MUSIC) ?
+                             wait_time_init_music
+                           : wait_time);
+        if (wavfile.stopping) break;
+        // ring_read (acquire) marks what the mixer has finished with
+        const uint64_t room     = WAV_RING_LEN - (wavfile.ring_write.load(std::memory_order_relaxed)
+                                                - wavfile.ring_read.load(std::memory_order_acquire));
+        const int64_t  buffered = int64_t(wavfile.loaded_length.load()) - int64_t(wavfile.pos.load())
+                                + int64_t(wavfile.ring_write.load()) - int64_t(wavfile.lap_base.load());
+
+        // as thread_load_wav(), hold off moving away from the start line if there's enough on-hand
+        const bool start_line = ((outrun.game_state == GS_START2) ||
+                                 (outrun.game_state == GS_START3) ||
+                                 (outrun.game_state == GS_INGAME))    &&
+                                (ostats.cur_stage  == 0)              &&
+                                (ostats.stage_times[0][0] == 0)       &&
+                                (ostats.stage_times[0][1]  < 2)       &&
+                                (wavfile.streaming)                   &&
+                                (buffered > buffer_min);
+
+        if (!start_line && room >= buf.size()) {
+            size_t done = 0;
+            const int r = api.read(h, (unsigned char*)buf.data(), buf.size() * sizeof(int16_t), &done);
+            const size_t samples = done / sizeof(int16_t);
+            // only this thread writes; the samples are published to the mixer by the stores after
+            uint32_t head_len = wavfile.loaded_length.load(std::memory_order_relaxed);
+            uint64_t write    = wavfile.ring_write.load(std::memory_order_relaxed);
+            for (size_t k = 0; k < samples && dec_pos < total; k++, dec_pos++) {
+                if (dec_pos < FADE_LEN)
+                    wavfile.head[head_len++] = buf[k];
+                else
+                    wavfile.data[write++ & mask] = buf[k];
+            }
+            wavfile.loaded_length.store(head_len, std::memory_order_release);
+            wavfile.ring_write.store(write, std::memory_order_release);
+            if (!wavfile.streaming && dec_pos >= threshold)
+                wavfile.streaming = true; // okay to start playback now
+
+            if (r == api.err) {
+                std::cerr << "mpg123_read failed\n";
+                break;
+            }
+
+            if (r == api.done || dec_pos >= total) {
+                if (total == UINT32_MAX) {
+                    // end of the first lap: trim any quiet part at the end, as thread_load_wav(), but
+                    // not back past what has been played or into the cross-fade
+                    long lowerthreshold = (long(6144) * WAV_THRESHOLD_TABLE[config.sound.wave_volume]) >> 13;
+                    const uint64_t lowest = std::max<uint64_t>(wavfile.ring_read.load(), FADE_LEN);
+                    uint64_t i = wavfile.ring_write.load();
+                    while (i > lowest) { if (wavfile.data[--i & mask] > lowerthreshold) break; }
+                    if (i > lowest) wavfile.ring_write = i;
+
+                    total = FADE_LEN + uint32_t(wavfile.ring_write.load()); // lap_base is 0 on the first lap
+                    wavfile.total_length = total;
+                    wavfile.fade_pos     = total - FADE_LEN;
+                    wavfile.fully_loaded = true;  // publishes the above to the mixer
+                    wavfile.streaming    = true;
+                    std::cout << "Audio file " << filename << " streaming (" << total << " samples)." << std::endl;
+                }
+                // the head is already held, so the next lap follows on from FADE_LEN
+                if (mpg123_seek((mpg123_handle*)h, FADE_LEN / CHANNELS, SEEK_SET) < 0) {
+                    std::cerr << "mpg123_seek failed: " << api.strerror(h) << std::endl;
+                    break;
+                }
+                dec_pos = FADE_LEN;
+            }
+        }
+
+        // throttle CPU load of decoding once playing, and wait for room when the ring is full
+        if (wavfile.streaming || room < buf.size()) {
+            auto this_wait_time = nextframe - std::chrono::steady_clock::now();
+            if (this_wait_time < std::chrono::milliseconds(5))
+                this_wait_time = std::chrono::milliseconds(5);
+            if (this_wait_time > std::chrono::milliseconds(30))
+                this_wait_time = std::chrono::milliseconds(30);
+            std::this_thread::sleep_for(this_wait_time);
+        }
+    }
+}
+
+
+// Name of the decoded copy of an .mp3 in the music cache, or "" if the file can't be found. The
+// name includes the size and modified time of the .mp3, so an edited file is decoded again, and
+// the output rate the copy was decoded at.
+std::string Audio::music_cache_file(const std::string& filename) const
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const auto size  = fs::file_size(filename, ec);
+    if (ec) return "";
+    const auto mtime = fs::last_write_time(filename, ec);
+    if (ec) return "";
+
+    char key[64];
+    std::snprintf(key, sizeof(key), "_%llx_%llx_%u.wav", (unsigned long long) size,
+                  (unsigned long long) mtime.time_since_epoch().count(), unsigned(FREQ));
+    return config.data.save_path + "music_cache/" + fs::path(filename).stem().string() + key;
+}
+
+
+void Audio::start_music_cache()
+{
+    if (!config.sound.music_cache || !sound_enabled || music_cache_thread.joinable())
+        return;
+    music_cache_stop = false;
+    music_cache_thread = std::thread(&Audio::thread_music_cache, this);
+}
+
+
+// Decodes each custom .mp3 track, once, to a .wav in the mixer format in the music cache. These
+// play from a mapping of the file (wav123_map), taking mp3 decoding out of gameplay. Decoding
+// only runs in attract mode, since it would otherwise compete with the game on slower systems.
+void Audio::thread_music_cache()
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const fs::path dir = config.data.save_path + "music_cache";
+    fs::create_directories(dir, ec);
+
+    auto idle = [] {
+        return outrun.game_state <= GS_LOGO; // GS_INIT to GS_LOGO are attract mode
+    };
+    // wait for attract mode, returns false if stopping
+    auto wait_idle = [&] {
+        while (!music_cache_stop && !idle())
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        return !music_cache_stop;
+    };
+
+    for (const auto& track : config.sound.music) {
+        if (track.type != music_t::IS_WAV || !has_ext_ci(track.filename, "mp3")) continue;
+        const std::string source = config.data.res_path + track.filename;
+        const std::string cached = music_cache_file(source);
+        if (cached.empty() || fs::exists(cached, ec)) continue;
+        if (!wait_idle()) return;
+
+        // copies from an older version of the file, or for another rate, are no longer needed
+        const std::string prefix = fs::path(source).stem().string() + "_";
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            const std::string name = entry.path().filename().string();
+            if (name.compare(0, prefix.size(), prefix) == 0)
+                fs::remove(entry.path(), ec);
+        }
+
+        const MpgLike& api = kMp3Api;
+        int err = 0;
+        void* h = api.newh(nullptr, &err);
+        if (!h) continue;
+        if (api.open(h, source.c_str()) != api.ok ||
+            api.format_none(h) != api.ok ||
+            api.format(h, FREQ, CHANNELS, api.enc_signed_16) != api.ok) {
+            api.del(h);
+            continue;
+        }
+
+        // written under a temporary name, so that only complete copies are ever played
+        const std::string partial = cached + ".part";
+        std::ofstream out(partial, std::ios::binary);
+        struct WavHeader {
+            char     riff[4] = {'R','I','F','F'};
+            uint32_t riff_size;
+            char     wave[4] = {'W','A','V','E'};
+            char     fmt[4]  = {'f','m','t',' '};
+            uint32_t fmt_size    = 16;
+            uint16_t format      = 1;   // PCM
+            uint16_t channels    = CHANNELS;
+            uint32_t rate;
+            uint32_t byte_rate;
+            uint16_t block_align = CHANNELS * sizeof(int16_t);
+            uint16_t bits        = 16;
+            char     data[4] = {'d','a','t','a'};
+            uint32_t data_size;
+        } header;
+        header.rate      = FREQ;
+        header.byte_rate = FREQ * header.block_align;
+        header.data_size = 0;
+        header.riff_size = 0;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        std::cout << "Caching decoded audio file " << source << std::endl;
+        std::vector<unsigned char> buf(16384);
+        uint64_t bytes = 0;
+        bool complete = false;
+        while (out && wait_idle()) {
+            size_t done = 0;
+            const int r = api.read(h, buf.data(), buf.size(), &done);
+            out.write(reinterpret_cast<const char*>(buf.data()), done);
+            bytes += done;
+            if (r == api.done) { complete = true; break; }
+            if (r == api.err || bytes > UINT32_MAX - sizeof(header)) break;
+            // pace as thread_load_wav() does in-game, leaving attract mode most of the CPU
+            std::this_thread::sleep_for(std::chrono::milliseconds(1000 / 30));
+        }
+        api.close(h);
+        api.del(h);
+
+        if (complete) {
+            header.data_size = uint32_t(bytes);
+            header.riff_size = uint32_t(bytes + sizeof(header) - 8);
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+        out.close();
+        if (complete && out)
+            fs::rename(partial, cached, ec);
+        else
+            fs::remove(partial, ec);
+        if (music_cache_stop) return;
     }
+}
+
+
+void Audio::clear_wav()
+{
+    // If a previous wave load job is still running, wait for it to finish
+    wavfile.stopping = true;
     if (wav_loader_thread.joinable())
         wav_loader_thread.join();
 
-    SDL_LockAudioDevice(dev);
+    // stop the mixer starting on the samples, then let any mix already using them finish. Both
+    // are sequentially consistent, so the mixer either sees streaming clear or is seen in use.
+    wavfile.streaming = false;
+    while (wav_in_use.load())
+        std::this_thread::yield();
+
     {
         std::lock_guard<std::mutex> lock(wav_mutex);
 
-        if (wavfile.fully_loaded)
+        if (wavfile.mapped) {
+            wav123_delete(wavfile.mapped);  // unmaps data
+            wavfile.mapped = nullptr;
+        }
+        else if (wavfile.fully_loaded || wavfile.ring_len)
             std::free(wavfile.data);
+        std::free(wavfile.head);
+        wavfile.head           = nullptr;
+        wavfile.ring_len       = 0;
 
         wavfile.data           = EMPTY_BUFFER;
         wavfile.filename       = "";
@@ -674,7 +1273,6 @@ void Audio::clear_wav()
         wavfile.fully_loaded   = false;
         wavfile.stopping       = false;
     }
-    SDL_UnlockAudioDevice(dev);
 }
 
 #endif
@@ -29,10 +29,13 @@
 #include <array>
 #include <string>
 #include <SDL.h>
-#include <semaphore>
+#include <vector>
+#include "sdl2/resampler.hpp"
 
 #ifdef COMPILE_SOUND_CODE
 
+struct wav123_handle;
+
 
 // A Q15-style table mapping slider 1–8 to roughly –8 dB to +6 dB.
 // This is used to allow the user to control the playback volume of
@@ -79,9 +82,7 @@ public:
         bits_per_sample(BITS),
         mix_buffer_bytes(0),
         audio_paused(1),
-        dev(0),
-        wavfile{ /*filename*/ "", /*data*/ nullptr, /*total_length*/0, /*loaded_length*/ 0,
-                 /*pos*/0, /*streaming*/ false, /*fully_loaded*/false, /*stopping*/false }
+        dev(0)
     {}
 
     ~Audio();
@@ -93,9 +94,24 @@ public:
     void stop_audio();
     void clear_wav();
     void load_audio(const char* filename);
+    void start_music_cache();
     void tick();
     void fill_and_mix(uint8_t *stream, int len);
 
+    // Ring buffer monitoring (see adapt_ring)
+    struct ring_stats_t {
+        uint32_t underruns;   // SDL callbacks that found nothing mixed, and so played silence
+        uint32_t depth;       // buffers the mixer may fill ahead of playback
+        uint32_t lead_ms;     // least audio mixed ahead at a callback, over the last window
+        uint32_t grows;       // depth increases after underruns
+        uint32_t shrinks;     // depth decreases back towards the target
+    };
+    ring_stats_t get_ring_stats() const;
+
+    // Custom music loader state, for the flight recorder (flightrec.hpp)
+    enum { WAV_NONE, WAV_LOADING, WAV_STREAMING, WAV_LOADED };
+    int wav_state() const;
+
 private:
     // Stereo. Could be changed, requires some recoding.
     static const uint32_t CHANNELS = 2;
@@ -111,18 +127,36 @@ private:
 
     void clear_buffers();
 
-    // wave file related
+    // wave file related. The mixing thread never takes wav_mutex: the loader fills in data and
+    // then publishes it by setting streaming, and further samples by storing loaded_length (or
+    // ring_write) with release ordering. fully_loaded likewise publishes the final total_length
+    // and fade_pos. The mixer owns pos (and lap_base and ring_read) whilst streaming. To take the
+    // samples away, clear_wav() clears streaming then waits until wav_in_use is clear, so that
+    // any mix already using them has finished. wav_mutex covers the rest (e.g. filename).
     struct wav_t {
         std::string filename = "";
         int16_t*   data                 = nullptr;   // interleaved PCM samples
-        uint32_t   total_length         = 0;         // full sample‐count (int16_t) for entire file
-        uint32_t   loaded_length        = 0;         // how many samples have actually been read so far
-        uint32_t   pos                  = 0;         // read‐cursor for playback
-        uint32_t   fade_pos             = 0;         // position where we start to loop
-        bool       streaming            = false;     // true once we've buffered the initial threshold
-        bool       fully_loaded         = false;     // true after the loader thread finishes
-        bool       stopping             = false;
+        std::atomic<uint32_t> total_length{0};       // full sample‐count (int16_t) for entire file
+        std::atomic<uint32_t> loaded_length{0};      // how many samples have actually been read so far
+        std::atomic<uint32_t> pos{0};                // read‐cursor for playback
+        std::atomic<uint32_t> fade_pos{0};           // position where we start to loop
+        std::atomic<bool>     streaming{false};      // true once we've buffered the initial threshold
+        std::atomic<bool>     fully_loaded{false};   // true after the loader thread finishes
+        std::atomic<bool>     stopping{false};
+        wav123_handle* mapped           = nullptr;   // data is this file's mapping (wav123_map), not a copy
+
+        // Streamed .mp3 (ring_len != 0): rather than the whole track, data is a ring of ring_len
+        // samples that the loader keeps filled ahead of pos, and head holds the first FADE_LEN
+        // samples (loaded_length of them decoded so far) for the cross-fade on repeat. The
+        // ring holds track positions FADE_LEN..total_length of each lap in turn, indexed by a
+        // free-running count of samples; lap_base is the count at FADE_LEN of the lap playing.
+        int16_t*   head                 = nullptr;
+        uint32_t   ring_len             = 0;         // power of two
+        std::atomic<uint64_t> ring_write{0};         // samples written by the loader
+        std::atomic<uint64_t> ring_read{0};          // samples played
+        std::atomic<uint64_t> lap_base{0};
     };
+    std::atomic<bool>  wav_in_use{false};            // mixer is reading wavfile.data
 
     // threading
     std::thread        wav_loader_thread;
@@ -138,16 +172,50 @@ private:
 
     void thread_load_wav(std::string filename);
     void load_wav(const char* filename);
-
-    // new semaphore queue based approach
-    // Ring buffer for PCM frames (8ms each)
-    static constexpr int BUFFER_COUNT = 4;
-    std::vector<int16_t> ringBuffer[BUFFER_COUNT];
-    std::atomic<int> prodIndex{0}, consIndex{0};
-    std::counting_semaphore<BUFFER_COUNT> spaceAvailable{BUFFER_COUNT};
-    std::counting_semaphore<BUFFER_COUNT> samplesReady{0};
+    void stream_mp3(void* h, const std::string& filename);
+
+    // Decoded copies of the custom .mp3 tracks, made in attract mode (see thread_music_cache)
+    std::thread        music_cache_thread;
+    std::atomic<bool>  music_cache_stop{false};
+    void thread_music_cache();
+    std::string music_cache_file(const std::string& filename) const;
+
+    // Single-producer/single-consumer ring of PCM frames (8ms each). The mixing thread fills
+    // slots and the SDL callback empties them; each only ever writes its own index, and the
+    // indices run freely (slot = index % RING_MAX), so the ring is full when they differ by
+    // ring_depth. The callback never waits: with nothing ready it plays silence. Each
+    // callback bumps 'wake' to rouse the mixing thread when it is waiting for space.
+    static constexpr int RING_MAX = 16;   // power of two, as the indices wrap
+    std::vector<int16_t> ringBuffer[RING_MAX];
+    std::atomic<uint32_t> prodIndex{0}, consIndex{0};
+    std::atomic<uint32_t> wake{0};
     std::atomic<bool> running{false};
 
+    // Direct rendering (config.sound.direct): the SDL callback runs the sound ticks and mixes
+    // into its own buffer, with no ring and no mixing thread. The least latency and one thread
+    // fewer, for single-core boards; but an overrun in the mix is heard at once.
+    bool direct = false;
+
+    // Adaptive ring depth, run by the callback (adapt_ring). The depth starts at the configured
+    // latency, grows by a buffer after an underrun, and comes back down a buffer at a time
+    // once there has been none for a while and the mixer has kept more than a buffer spare.
+    std::atomic<uint32_t> ring_depth{4};
+    uint32_t target_depth       = 4;
+    uint32_t period_ms          = 8;   // audio in one buffer
+    uint32_t window_callbacks   = 250; // callbacks in a measurement window (about 2s)
+    uint32_t window_count       = 0;
+    uint32_t window_min_lead    = RING_MAX;
+    uint32_t quiet_windows      = 1;   // windows since the last underrun, plus one at the start
+    uint32_t reported_depth     = 0;   // last depth logged by tick()
+    bool     ring_primed        = false; // a buffer has been played since the start
+    std::atomic<uint32_t> underruns{0}, lead_ms{0}, grows{0}, shrinks{0};
+    void adapt_ring(bool underrun, uint32_t lead);
+
+    // Sound chips running at their own rate (config.sound.chip_rate): their mix, and that
+    // resampled to FREQ, one tick at a time
+    Resampler resampler;
+    std::vector<int16_t> chip_mix, chip_out, chip_silence;
+
     std::thread mixThread;
     void mixing_loop();
     static void sdl_callback_trampoline(void* udata, Uint8* stream, int len);
@@ -0,0 +1,224 @@
+/***************************************************************************
+    Direct evdev Input (Linux).
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <atomic>
+#include <iostream>
+#include "sdl2/evdev.hpp"
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include "threadpolicy.hpp"
+#include "frontend/config.hpp"
+
+static int                   fd = -1;
+static std::thread           reader;
+static std::atomic<bool>     running{false};   // device open and being read
+static std::atomic<bool>     stopping{false};
+
+// Device codes to SDL's numbering (-1 = not used), and each axis's range
+static int8_t                axis_map[ABS_CNT];
+static int8_t                button_map[KEY_CNT];
+static int32_t               axis_min[evdev::AXES];
+static int32_t               axis_max[evdev::AXES];
+static int                   axis_count = 0;
+
+static std::atomic<int32_t>  axes[evdev::AXES];
+static std::atomic<uint64_t> pressed{0}, released{0}, down{0};
+static int32_t               axes_read[evdev::AXES];   // as last returned by axis()
+
+static bool has_bit(const unsigned long* bits, int bit)
+{
+    const int BPL = sizeof(unsigned long) * 8;
+    return (bits[bit / BPL] >> (bit % BPL)) & 1UL;
+}
+
+// As SDL's Linux joystick driver: axes in code order less the hats, then buttons from
+// BTN_JOYSTICK up, then those from BTN_MISC below it
+static void map_device()
+{
+    const int BPL = sizeof(unsigned long) * 8;
+    unsigned long abs_bits[(ABS_CNT + BPL - 1) / BPL] = {};
+    unsigned long key_bits[(KEY_CNT + BPL - 1) / BPL] = {};
+    ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits);
+    ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits);
+
+    std::memset(axis_map,   -1, sizeof(axis_map));
+    std::memset(button_map, -1, sizeof(button_map));
+
+    int n = 0;
+    for (int code = 0; code < ABS_MAX && n < evdev::AXES; code++)
+    {
+        if (code >= ABS_HAT0X && code <= ABS_HAT3Y) continue;
+        if (!has_bit(abs_bits, code)) continue;
+
+        struct input_absinfo info;
+        if (ioctl(fd, EVIOCGABS(code), &info) != 0) continue;
+        axis_min[n] = info.minimum;
+        axis_max[n] = info.maximum > info.minimum ? info.maximum : info.minimum + 1;
+        axis_map[code] = int8_t(n++);
+    }
+    axis_count = n;
+
+    n = 0;
+    for (int code = BTN_JOYSTICK; code < KEY_MAX && n < evdev::BUTTONS; code++)
+        if (has_bit(key_bits, code)) button_map[code] = int8_t(n++);
+    for (int code = BTN_MISC; code < BTN_JOYSTICK && n < evdev::BUTTONS; code++)
+        if (has_bit(key_bits, code)) button_map[code] = int8_t(n++);
+}
+
+static int32_t scale(int axis, int32_t value)
+{
+    const int64_t range = int64_t(axis_max[axis]) - axis_min[axis];
+    const int64_t v     = (int64_t(value) - axis_min[axis]) * 65535 / range - 32768;
+    return int32_t(v < -32768 ? -32768 : v > 32767 ? 32767 : v);
+}
+
+static void run()
+{
+    threadpolicy::apply(threads_settings_t::GAME);
+
+    struct input_event events[64];
+    while (!stopping.load(std::memory_order_relaxed))
+    {
+        // the timeout lets stop() end the thread
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+
+        const ssize_t bytes = ::read(fd, events, sizeof(events));
+        if (bytes < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (bytes <= 0)
+        {
+            std::cerr << "evdev: input device lost, back to SDL input" << std::endl;
+            break;
+        }
+
+        for (size_t i = 0; i < size_t(bytes) / sizeof(events[0]); i++)
+        {
+            const struct input_event& e = events[i];
+            if (e.type == EV_ABS && e.code < ABS_CNT && axis_map[e.code] >= 0)
+            {
+                const int a = axis_map[e.code];
+                axes[a].store(scale(a, e.value), std::memory_order_relaxed);
+            }
+            else if (e.type == EV_KEY && e.code < KEY_CNT && button_map[e.code] >= 0 && e.value != 2)
+            {
+                const uint64_t bit = uint64_t(1) << button_map[e.code];
+                if (e.value)
+                {
+                    down.fetch_or(bit, std::memory_order_relaxed);
+                    pressed.fetch_or(bit, std::memory_order_relaxed);
+                }
+                else
+                {
+                    down.fetch_and(~bit, std::memory_order_relaxed);
+                    released.fetch_or(bit, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+    running.store(false, std::memory_order_release);
+}
+
+bool evdev::start(const std::string& device)
+{
+    if (fd >= 0)
+        return true;
+
+    fd = ::open(device.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "evdev: unable to open " << device << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    char name[128] = "unknown";
+    ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+    map_device();
+
+    // start from where the axes are now, not from zero
+    for (int code = 0; code < ABS_CNT; code++)
+    {
+        struct input_absinfo info;
+        if (axis_map[code] >= 0 && ioctl(fd, EVIOCGABS(code), &info) == 0)
+            axes[axis_map[code]].store(scale(axis_map[code], info.value));
+    }
+    for (int a = 0; a < AXES; a++)
+        axes_read[a] = INT_MIN;
+
+    std::cout << "evdev: reading " << name << " from " << device << std::endl;
+    stopping = false;
+    running  = true;
+    reader   = std::thread(run);
+    return true;
+}
+
+void evdev::stop()
+{
+    if (fd < 0)
+        return;
+    stopping = true;
+    reader.join();
+    ::close(fd);
+    fd = -1;
+}
+
+bool evdev::active()
+{
+    return running.load(std::memory_order_acquire);
+}
+
+bool evdev::axis(int axis, int16_t* value)
+{
+    const int32_t v = axes[axis].load(std::memory_order_relaxed);
+    if (axis >= axis_count || v == axes_read[axis])
+        return false;
+    axes_read[axis] = v;
+    *value = int16_t(v);
+    return true;
+}
+
+bool evdev::latest(int axis, int16_t* value)
+{
+    if (axis < 0 || axis >= axis_count || !active())
+        return false;
+    *value = int16_t(axes[axis].load(std::memory_order_relaxed));
+    return true;
+}
+
+void evdev::buttons(uint64_t* p, uint64_t* r, uint64_t* d)
+{
+    *p = pressed.exchange(0, std::memory_order_relaxed);
+    *r = released.exchange(0, std::memory_order_relaxed);
+    *d = down.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool evdev::start(const std::string&)
+{
+    std::cerr << "evdev: direct device input is only available on Linux" << std::endl;
+    return false;
+}
+
+void evdev::stop() {}
+bool evdev::active() { return false; }
+bool evdev::axis(int, int16_t*) { return false; }
+bool evdev::latest(int, int16_t*) { return false; }
+void evdev::buttons(uint64_t* p, uint64_t* r, uint64_t* d) { *p = *r = *d = 0; }
+
+#endif
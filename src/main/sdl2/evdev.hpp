@@ -0,0 +1,47 @@
+/***************************************************************************
+    Direct evdev Input (Linux).
+
+    Reads a wheel, pedal or button interface straight from its
+    /dev/input/event* node on a thread of its own, as fast as the device
+    reports, rather than through SDL's event queue. The latest value of each
+    axis, and the buttons pressed and released, are held in atomics for
+    Input to pick up at the start of each tick.
+
+    Axes and buttons are numbered as SDL numbers them for the same device,
+    so the axis and button settings under <controls> apply unchanged. While
+    the device is open, SDL's joystick events are ignored; if it goes away,
+    they are used again.
+
+    See controls.evdev in config.xml.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace evdev
+{
+    const int AXES    = 16;
+    const int BUTTONS = 64;
+
+    // Open device and start reading it. False, with a message, if it can't be opened.
+    bool start(const std::string& device);
+    void stop();
+
+    // The device is open and being read
+    bool active();
+
+    // The latest value of axis (-32768 to 32767). False if unchanged since the last call.
+    bool axis(int axis, int16_t* value);
+
+    // The latest value of axis, whether or not it has changed; safe from any thread.
+    // False if there is no such axis or the device isn't being read.
+    bool latest(int axis, int16_t* value);
+
+    // Buttons pressed and released since the last call, and those down now (bit n = button n)
+    void buttons(uint64_t* pressed, uint64_t* released, uint64_t* down);
+}
@@ -5,18 +5,21 @@
 // Copyright (c) 2025, James Pearce.
 //
 // Overlay textures are applied as 8-bit (1 byte/pixel) alpha masks.
-// 0xFF = transparent and 0x0 = fully black.
+// 0xFF = transparent and 0x0 = fully black. Where the GPU has full precision floats, the CRT
+// edge mask can instead be worked out per pixel by the shader (see set_edge_mask).
 
 #include <SDL.h>
 #include <SDL_opengles2.h>
 
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <cmath>
 #include <iostream>
+#include <fstream>
+#include <cstdio>
 
 namespace glb {
 
@@ -33,15 +36,110 @@ static const char* kDefaultVS =
 
 static const char* kDefaultFS =
     // 'Default' shader used when none provided.
-    // It multiplies uTex0 by uTex1 when present.
+    // It multiplies uTex0 by uTex1 when present (and not built with NO_OVERLAY), or by the
+    // edge mask when built with EDGE_MASK.
     "precision mediump float;\n"
     "varying vec2 vUV;\n"
     "uniform sampler2D uTex0;\n"
     "uniform sampler2D uTex1;\n"
+    "uniform vec2 scanline;\n"       // odd row level, game image rows (see U_SCANLINE)
     "void main(){\n"
-    "    gl_FragColor = texture2D(uTex0, vUV) * texture2D(uTex1, vUV);\n"
+    "    vec4 c = texture2D(uTex0, vUV);\n"
+    "    if (mod(floor(vUV.y * scanline.y), 2.0) >= 1.0)\n"
+    "        c.rgb *= mix(scanline.x, 1.0, dot(c.rgb, vec3(0.30, 0.59, 0.11)));\n"
+    "#if defined(EDGE_MASK)\n"
+    "    gl_FragColor = vec4(c.rgb * edgeMask(vUV), c.a);\n"
+    "#elif defined(NO_OVERLAY)\n"
+    "    gl_FragColor = c;\n"
+    "#else\n"
+    "    gl_FragColor = c * texture2D(uTex1, vUV);\n"
+    "#endif\n"
     "}\n";
 
+// Upscale of the offscreen pass to the window, with the overlay multiply. The offscreen image
+// is bottom-up (as drawn), whereas the overlay is uploaded top-down like the game image.
+static const char* kUpscaleFS =
+    "precision mediump float;\n"
+    "varying vec2 vUV;\n"
+    "uniform sampler2D uTex0;\n"
+    "uniform sampler2D uTex1;\n"
+    "void main(){\n"
+    "#if defined(EDGE_MASK)\n"
+    "    gl_FragColor = texture2D(uTex0, vec2(vUV.x, 1.0 - vUV.y)) * vec4(vec3(edgeMask(vUV)), 1.0);\n"
+    "#elif defined(NO_OVERLAY)\n"
+    "    gl_FragColor = texture2D(uTex0, vec2(vUV.x, 1.0 - vUV.y));\n"
+    "#else\n"
+    "    gl_FragColor = texture2D(uTex0, vec2(vUV.x, 1.0 - vUV.y)) * texture2D(uTex1, vUV);\n"
+    "#endif\n"
+    "}\n";
+
+// The CRT edge mask of RenderSurface::init_overlay(), per pixel: the rounded corners, the curved
+// edges faded over edge_radius, and (shader modes 0 and 1) the vignette. uv is the position in
+// the overlay rectangle; the mask is symmetrical, so is worked out for the top-left quarter.
+// The curve radii run to tens of thousands of pixels, so this needs highp (see set_edge_mask).
+//   edgeSize   (width, height, edge radius, corner radius), in pixels
+//   edgeCurve  (x curve radius, y curve radius, where the curves meet top left + edge radius)
+//   edgeCorner (corner centre, 1 if the corner radius meets both curves, vignette level)
+//   edgeCentre (vignette inner and outer radius, centre)
+static const char* kEdgeMaskFS =
+    "uniform highp vec4 edgeSize;\n"
+    "uniform highp vec4 edgeCurve;\n"
+    "uniform highp vec4 edgeCorner;\n"
+    "uniform highp vec4 edgeCentre;\n"
+    "highp float edgeFade(highp float r, highp float shade) {\n"
+    "    return r <= 0.0 ? 0.0 : (r < edgeSize.z ? shade * r / edgeSize.z : shade);\n"
+    "}\n"
+    "highp float edgeMask(highp vec2 uv) {\n"
+    "    highp vec2 p = floor(uv * edgeSize.xy);\n"
+    "    p = min(p, edgeSize.xy - 1.0 - p);\n"
+    "    highp float e = edgeSize.z, c = edgeSize.w;\n"
+    "    highp float d1 = distance(p, edgeCentre.zw);\n"
+    "    if (d1 >= edgeCentre.y) return 0.0;\n"
+    "    highp float shade = 1.0;\n"
+    "    if (d1 >= edgeCentre.x) {\n"
+    "        highp float v = (d1 - edgeCentre.x) / (edgeCentre.y - edgeCentre.x);\n"
+    "        shade = 1.0 - edgeCorner.w * v * v;\n"
+    "    }\n"
+    "    if (edgeCorner.z > 0.0) {\n"
+    "        if (p.x <= edgeCorner.x && p.y <= edgeCorner.y) {\n"
+    "            highp float d5 = distance(p, edgeCorner.xy);\n"
+    "            return d5 >= e + c ? 0.0 : (d5 > c ? shade * (e + c - d5) / e : shade);\n"
+    "        }\n"
+    "    } else if (p.x <= edgeCurve.z && p.y <= edgeCurve.w) {\n"
+    "        highp float d4 = distance(p, edgeCurve.zw);\n"
+    "        if (d4 < e) return shade * (e - d4) / e;\n"
+    "    }\n"
+    "    if (p.x <= edgeCurve.z)\n"
+    "        return p.y <= edgeCurve.w ? 0.0 :\n"
+    "               edgeFade(edgeCurve.x - distance(p, vec2(edgeCurve.x, edgeCentre.w)), shade);\n"
+    "    if (p.y <= edgeCurve.w)\n"
+    "        return edgeFade(edgeCurve.y - distance(p, vec2(edgeCentre.z, edgeCurve.y)), shade);\n"
+    "    return shade;\n"
+    "}\n";
+
+// A fragment shader's source with text added after any #version line
+static std::string with_prelude(const char* fs, const std::string& text) {
+    std::string src(fs);
+    size_t at = 0;
+    if (src.compare(0, 8, "#version") == 0) {
+        at = src.find('\n');
+        at = (at == std::string::npos) ? src.size() : at + 1;
+    }
+    return src.insert(at, text);
+}
+
+// A fragment shader's source with NO_OVERLAY defined. The programs built from it are drawn while
+// there's no overlay, saving a texture read of every pixel of the window (see draw()).
+static std::string without_overlay(const char* fs) {
+    return with_prelude(fs, "#define NO_OVERLAY\n");
+}
+
+// The same with EDGE_MASK defined and edgeMask() declared, for the shader's own mask in place of
+// the overlay texture
+static std::string with_edge_mask(const char* fs) {
+    return with_prelude(fs, std::string("#define EDGE_MASK\n") + kEdgeMaskFS);
+}
+
 // ---------------- Internal helpers ----------------
 static GLuint compile(GLenum type, const char* src) {
     GLuint s = glCreateShader(type);
@@ -60,7 +158,8 @@ static GLuint compile(GLenum type, const char* src) {
     return s;
 }
 
-static GLuint makeProgram(const char* vs, const char* fs) {
+// Compile and link (see makeProgram, which first tries the program binary cache)
+static GLuint compileProgram(const char* vs, const char* fs) {
     GLuint v = compile(GL_VERTEX_SHADER,   vs);
     GLuint f = compile(GL_FRAGMENT_SHADER, fs);
     if (!v || !f) { if (v) glDeleteShader(v); if (f) glDeleteShader(f); return 0; }
@@ -99,17 +198,17 @@ inline bool hasExtensionStr(const char* name) {
 // Robust, low-overhead texture upload helper.
 // Uploads RGBA/ABGR 8bpp with UNPACK_ALIGNMENT=4 and uses GL_EXT_unpack_subimage
 // to respect row pitches when available. Otherwise packs once into G.scratch.
-static void upload_rgba8(GLuint tex, GLenum fmt, const void* pixels, int pitchBytes, int w, int h) {
+static void upload_rgba8(GLuint tex, GLenum fmt, const void* pixels, int pitchBytes, int w, int h, int y0 = 0) {
     glBindTexture(GL_TEXTURE_2D, tex);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     const bool tight = (pitchBytes == w * 4);
     const bool haveRowLen = hasExtensionStr("GL_EXT_unpack_subimage");
     if (tight) {
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, fmt, GL_UNSIGNED_BYTE, pixels);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, w, h, fmt, GL_UNSIGNED_BYTE, pixels);
     } else if (haveRowLen) {
 #ifdef GL_UNPACK_ROW_LENGTH
         glPixelStorei(GL_UNPACK_ROW_LENGTH, pitchBytes / 4);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, fmt, GL_UNSIGNED_BYTE, pixels);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, w, h, fmt, GL_UNSIGNED_BYTE, pixels);
         glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 #else
         // Fallback pack if the enum is missing in headers
@@ -118,7 +217,7 @@ static void upload_rgba8(GLuint tex, GLenum fmt, const void* pixels, int pitchBy
         for (int y = 0; y < h; ++y) {
             std::memcpy(&tmp[(size_t)y * w * 4], src + (size_t)y * pitchBytes, (size_t)w * 4);
         }
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, fmt, GL_UNSIGNED_BYTE, tmp.data());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, w, h, fmt, GL_UNSIGNED_BYTE, tmp.data());
 #endif
     } else {
         // pack row-by-row into a tight buffer
@@ -127,7 +226,7 @@ static void upload_rgba8(GLuint tex, GLenum fmt, const void* pixels, int pitchBy
         for (int y = 0; y < h; ++y) {
             std::memcpy(&tmp[(size_t)y * w * 4], src + (size_t)y * pitchBytes, (size_t)w * 4);
         }
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, fmt, GL_UNSIGNED_BYTE, tmp.data());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, w, h, fmt, GL_UNSIGNED_BYTE, tmp.data());
     }
 }
 
@@ -164,18 +263,18 @@ static void upload_alpha8(GLuint tex, GLenum fmt, const void* pixels, int pitchB
     }
 }
 
-// 16bpp uploader (RGB5_A1). Uses row length when available; otherwise packs rows tightly.
-static void upload_rgb555_16(GLuint tex, const void* pixels, int pitchBytes, int w, int h) {
+// 16bpp uploader (RGB5_A1, or any 2 byte format). Uses row length when available; otherwise packs rows tightly.
+static void upload_16bpp(GLuint tex, GLenum fmt, GLenum type, const void* pixels, int pitchBytes, int w, int h, int y0 = 0) {
     glBindTexture(GL_TEXTURE_2D, tex);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
     const bool tight = (pitchBytes == w * 2);
     const bool haveRowLen = hasExtensionStr("GL_EXT_unpack_subimage");
     if (tight) {
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, pixels);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, w, h, fmt, type, pixels);
     } else if (haveRowLen) {
     #ifdef GL_UNPACK_ROW_LENGTH
         glPixelStorei(GL_UNPACK_ROW_LENGTH, pitchBytes / 2);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, pixels);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, w, h, fmt, type, pixels);
         glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     #else
         std::vector<uint16_t> tmp; tmp.resize((size_t)w * h);
@@ -183,7 +282,7 @@ static void upload_rgb555_16(GLuint tex, const void* pixels, int pitchBytes, int
         for (int y = 0; y < h; ++y) {
             std::memcpy(&tmp[(size_t)y * w], src + (size_t)y * pitchBytes, (size_t)w * 2);
         }
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, tmp.data());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, w, h, fmt, type, tmp.data());
     #endif
     } else {
         std::vector<uint16_t> tmp; tmp.resize((size_t)w * h);
@@ -191,10 +290,14 @@ static void upload_rgb555_16(GLuint tex, const void* pixels, int pitchBytes, int
         for (int y = 0; y < h; ++y) {
             std::memcpy(&tmp[(size_t)y * w], src + (size_t)y * pitchBytes, (size_t)w * 2);
         }
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, tmp.data());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, w, h, fmt, type, tmp.data());
     }
 }
 
+static void upload_rgb555_16(GLuint tex, const void* pixels, int pitchBytes, int w, int h, int y0 = 0) {
+    upload_16bpp(tex, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, pixels, pitchBytes, w, h, y0);
+}
+
 
 
 static GLuint makeVBO(const float* verts, size_t bytes){
@@ -204,21 +307,50 @@ static GLuint makeVBO(const float* verts, size_t bytes){
     return b;
 }
 
+// ---------------- Main program uniforms ----------------
+// The CRT shader controls. Locations are resolved once by loadShaders(); set_uniform() only
+// updates a CPU-side copy, and flush_uniforms() sends the values changed, before each draw().
+// U_SCANLINE is the level of the odd rows of the game image (1 = no scanlines, as the CPU pass
+// blends it by luminance) and the number of rows, for the shader scanlines. U_MASK_TILE is one
+// over the size of the shadow mask tile (see set_shadow_mask).
+enum Uniform {
+    U_WARP_X, U_WARP_Y, U_INV_EXPAND, U_BRIGHTBOOST, U_NOISE_INTENSITY, U_VIGNETTE,
+    U_DESAT_INV0, U_DESAT_INV1, U_OUTPUT_SIZE, U_TIME, U_SCANLINE, U_MASK_TILE,
+    U_COUNT
+};
+
+static const struct { const char* name; int size; } kUniforms[U_COUNT] = {
+    { "warpX",          1 }, { "warpY",          1 }, { "invExpand",      2 },
+    { "brightboost",    1 }, { "noiseIntensity", 1 }, { "vignette",       1 },
+    { "desat_inv0",     1 }, { "desat_inv1",     1 }, { "OutputSize",     2 },
+    { "u_Time",         2 }, { "scanline",       2 }, { "maskTile",       2 },
+};
+
 // ---------------- State ----------------
 struct State {
     SDL_Window* window = nullptr;
 
     // GL objects
     GLuint program = 0;          // main program (game shader)
+    GLuint programPlain = 0;     // the same, without the overlay multiply (NO_OVERLAY)
+    GLuint programEdge = 0;      // the same, with the shader's edge mask for the overlay (EDGE_MASK)
     GLuint vbo = 0;              // fullscreen triangle VBO
     GLuint texGame = 0;          // game frame (sampler unit 0)
     GLuint texOverlay = 0;       // overlay (sampler unit 1)
     GLuint texWhite  = 0;        // 1x1 white (neutral overlay)
+    GLuint texMask = 0;          // shadow mask tile (sampler unit 3)
     bool   overlayReady = false;
+    bool   edgeReady    = false; // the edge mask is drawn in place of the overlay texture
+    float  edgeVal[4][4] = {};   // edgeSize, edgeCurve, edgeCorner, edgeCentre (see kEdgeMaskFS)
+    std::string mainVS, mainFS;  // main program sources, for the edge mask variant
 
-    // Optional offscreen
+    // Optional offscreen: the main program draws into texPass, which upscaleProgram then
+    // scales to the window
     GLuint fbo = 0;
     GLuint texPass = 0;
+    GLuint upscaleProgram = 0;
+    GLuint upscalePlain = 0;     // without the overlay multiply
+    GLuint upscaleEdge = 0;      // with the edge mask multiply
     int fboW = 0, fboH = 0;
 
     // Backbuffer / logical sizes
@@ -230,9 +362,11 @@ struct State {
     bool useDstRect = false; int dstX=0,dstY=0,dstW=0,dstH=0;
     bool useOverlayDstRect = false; int ovDstX=0,ovDstY=0,ovDstW=0,ovDstH=0;
 
-    // Simple uniform cache
-    std::unordered_map<std::string, GLint> ucache;
-    GLuint ucache_program = 0;
+    // Main program uniforms: locations and those not yet sent, for program, programPlain and
+    // programEdge, and the values set
+    GLint uniformLoc[3][U_COUNT]   = {};
+    float uniformVal[U_COUNT][2]   = {};
+    bool  uniformDirty[3][U_COUNT] = {};
 
     // Resolved attribute locations
     GLint locPos = -1;        // main program
@@ -247,13 +381,148 @@ struct State {
     std::vector<uint8_t> scratch; // temp row buffer for CPU swizzles
     bool hasABGR = false;         // GL_EXT_abgr present
 
+    // Program binary cache (GL_OES_get_program_binary), see makeProgram()
+    std::string programCachePath;  // file name prefix; empty = disabled
+    bool programBinaryChecked = false;
+    void (GL_APIENTRYP getProgramBinary)(GLuint, GLsizei, GLsizei*, GLenum*, void*) = nullptr;
+    void (GL_APIENTRYP programBinary)(GLuint, GLenum, const void*, GLint) = nullptr;
+
     // We target GLES2 everywhere
     bool isGLES = true;
+
+    // Pixel unpack buffer ring for the game image (GLES3 contexts only)
+    static const int GAME_BUFFERS = 3;
+    GLuint gameBuf[GAME_BUFFERS] = {0, 0, 0};
+    void*  gameBufMap[GAME_BUFFERS] = {nullptr, nullptr, nullptr};
+    size_t gameBufBytes = 0;
+    int    gameBufPitch = 0;
+    void*  (GL_APIENTRYP mapBufferRange)(GLenum, GLintptr, GLsizeiptr, GLbitfield) = nullptr;
+    GLboolean (GL_APIENTRYP unmapBuffer)(GLenum) = nullptr;
+
+    // Palette index pass (see init_ntsc, init_palette_lookup): indices in, game image out
+    GLint  gameFilter = GL_NEAREST; // sampling filter of the game texture
+    GLuint indexProgram = 0;
+    GLuint indexFbo = 0;
+    GLuint texIndexed = 0;       // pass output, drawn in place of texGame
+    GLuint texIndex = 0;         // S16 palette indices (sampler unit 0)
+    GLuint texPalette = 0;       // RGBA palette (sampler unit 2)
+    int indexOutW = 0, indexOutH = 0;
+    int indexW = 0, indexH = 0;
+    int paletteRows = 0;
+    GLint ntscLocPhase = -1;
+    bool indexActive = false;
 };
 
 //static State G; // internal linkage in each TU using this header
 inline State G{};
 
+// -------- Program binary cache --------
+// Linking the CRT shaders takes hundreds of milliseconds on some drivers, on every video
+// restart. Where the driver supports GL_OES_get_program_binary, linked programs are saved, one
+// file per program, named from a hash of the driver strings and the shader sources, so that a
+// driver update or shader edit simply misses the cache.
+
+#ifndef GL_PROGRAM_BINARY_LENGTH_OES
+#define GL_PROGRAM_BINARY_LENGTH_OES 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS_OES
+#define GL_NUM_PROGRAM_BINARY_FORMATS_OES 0x87FE
+#endif
+
+// Cache files are pathPrefix + hash + ".bin"; an empty prefix disables the cache
+inline void set_program_cache(const std::string& pathPrefix) { G.programCachePath = pathPrefix; }
+
+static bool program_binary_supported() {
+    if (!G.programBinaryChecked) {
+        G.programBinaryChecked = true;
+        G.getProgramBinary = nullptr;
+        G.programBinary    = nullptr;
+        GLint formats = 0;
+        if (hasExtensionStr("GL_OES_get_program_binary"))
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+        if (formats > 0) {
+            G.getProgramBinary = reinterpret_cast<decltype(G.getProgramBinary)>(SDL_GL_GetProcAddress("glGetProgramBinaryOES"));
+            G.programBinary    = reinterpret_cast<decltype(G.programBinary)>(SDL_GL_GetProcAddress("glProgramBinaryOES"));
+        }
+    }
+    return G.getProgramBinary && G.programBinary;
+}
+
+static std::string program_cache_file(const char* vs, const char* fs) {
+    // FNV-1a over the driver identity and both sources
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto mix = [&](const char* s) {
+        for (; s && *s; s++) { h ^= uint8_t(*s); h *= 0x100000001b3ull; }
+        h ^= 0xff; h *= 0x100000001b3ull; // separator
+    };
+    mix(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    mix(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    mix(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    mix(vs);
+    mix(fs);
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)h);
+    return G.programCachePath + hex + ".bin";
+}
+
+// Header of a cache file, followed by the binary
+struct ProgramCacheHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint32_t length;
+};
+static const uint32_t kProgramCacheMagic = 0x50474243; // "CBGP"
+
+static GLuint load_program_binary(const std::string& file) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return 0;
+    ProgramCacheHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != kProgramCacheMagic)
+        return 0;
+    std::vector<char> binary(header.length);
+    if (!in.read(binary.data(), binary.size()))
+        return 0;
+
+    GLuint p = glCreateProgram();
+    G.programBinary(p, GLenum(header.format), binary.data(), GLint(binary.size()));
+    GLint ok = 0; glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) { glDeleteProgram(p); return 0; } // rejected by the driver; rebuilt below
+    return p;
+}
+
+static void save_program_binary(GLuint p, const std::string& file) {
+    GLint length = 0;
+    glGetProgramiv(p, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) return;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    G.getProgramBinary(p, length, &written, &format, binary.data());
+    if (written <= 0) return;
+
+    ProgramCacheHeader header = { kProgramCacheMagic, uint32_t(format), uint32_t(written) };
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(binary.data(), written);
+    if (!out) {
+        std::cerr << "Unable to write shader cache " << file << "\n";
+        out.close();
+        std::remove(file.c_str());
+    }
+}
+
+static GLuint makeProgram(const char* vs, const char* fs) {
+    if (G.programCachePath.empty() || !program_binary_supported())
+        return compileProgram(vs, fs);
+
+    const std::string file = program_cache_file(vs, fs);
+    if (GLuint p = load_program_binary(file))
+        return p;
+    GLuint p = compileProgram(vs, fs);
+    if (p) save_program_binary(p, file);
+    return p;
+}
+
 // Fullscreen triangle vertices: x,y,u,v
 static const float kFSVerts[12] = {
     -1.f, -1.f, 0.f, 1.f,
@@ -303,33 +572,90 @@ static GLuint makeVBO(const float* verts, size_t bytes);
 // ---------------- Default program creation ----------------
 static void resolveAttribs(GLuint prog, GLint& locPos, GLint& locUV);
 
-inline void loadShaders(const char* vertexSrc, const char* fragmentSrc)
+// Sampler units and uniform locations of main program variant v (0 = program, 1 = programPlain,
+// 2 = programEdge)
+inline void setup_main_program(GLuint p, int v)
 {
-    // -- D: defensive reset before creating the new program
-    if (G.program) { glDeleteProgram(G.program); G.program = 0; }
-    G.locPos = G.locUV = -1;
-    G.ucache.clear();
-    G.ucache_program = 0;
-
-    // Compile/link the (possibly new) program
-    G.program = makeProgram(vertexSrc ? vertexSrc : kDefaultVS,
-                            fragmentSrc ? fragmentSrc : kDefaultFS);
-    glUseProgram(G.program);
+    glUseProgram(p);
 
     // Bind common sampler names to unit 0
-    if (GLint s0 = glGetUniformLocation(G.program, "uTex0");    s0 >= 0) glUniform1i(s0, 0);
-    if (GLint t  = glGetUniformLocation(G.program, "Texture");  t  >= 0) glUniform1i(t,  0);
+    if (GLint s0 = glGetUniformLocation(p, "uTex0");    s0 >= 0) glUniform1i(s0, 0);
+    if (GLint t  = glGetUniformLocation(p, "Texture");  t  >= 0) glUniform1i(t,  0);
 
     // Bind optional overlay samplers to unit 1 (single-pass overlay)
-    if (GLint s1 = glGetUniformLocation(G.program, "uTex1");    s1 >= 0) glUniform1i(s1, 1);
-    if (GLint o  = glGetUniformLocation(G.program, "Overlay");  o  >= 0) glUniform1i(o,  1);
+    if (GLint s1 = glGetUniformLocation(p, "uTex1");    s1 >= 0) glUniform1i(s1, 1);
+    if (GLint o  = glGetUniformLocation(p, "Overlay");  o  >= 0) glUniform1i(o,  1);
+
+    // and the shadow mask tile to unit 3
+    if (GLint m  = glGetUniformLocation(p, "ShadowMask"); m >= 0) glUniform1i(m,  3);
+
+    // The new program starts with its uniforms at zero, so send every value again
+    for (int u = 0; u < U_COUNT; u++) {
+        G.uniformLoc[v][u]   = glGetUniformLocation(p, kUniforms[u].name);
+        G.uniformDirty[v][u] = true;
+    }
+}
+
+// Send the edge mask to program p (which needn't use it)
+inline void send_edge_mask(GLuint p)
+{
+    static const char* kEdgeUniforms[4] = { "edgeSize", "edgeCurve", "edgeCorner", "edgeCentre" };
+    if (!p) return;
+    glUseProgram(p);
+    for (int i = 0; i < 4; i++)
+        if (GLint l = glGetUniformLocation(p, kEdgeUniforms[i]); l >= 0) glUniform4fv(l, 1, G.edgeVal[i]);
+}
+
+// The main program, and the upscale if there's an offscreen pass, built with EDGE_MASK, if not
+// already. False if either won't build.
+inline bool build_edge_programs()
+{
+    if (!G.programEdge && !G.mainFS.empty()) {
+        G.programEdge = makeProgram(G.mainVS.c_str(), with_edge_mask(G.mainFS.c_str()).c_str());
+        if (G.programEdge) setup_main_program(G.programEdge, 2);
+    }
+    if (G.fbo && !G.upscaleEdge) {
+        G.upscaleEdge = makeProgram(kDefaultVS, with_edge_mask(kUpscaleFS).c_str());
+        if (G.upscaleEdge) {
+            glUseProgram(G.upscaleEdge);
+            glUniform1i(glGetUniformLocation(G.upscaleEdge, "uTex0"), 0);
+        }
+    }
+    if (!G.programEdge || (G.fbo && !G.upscaleEdge)) return false;
+    send_edge_mask(G.programEdge);
+    send_edge_mask(G.upscaleEdge);
+    return true;
+}
+
+inline void loadShaders(const char* vertexSrc, const char* fragmentSrc)
+{
+    // -- D: defensive reset before creating the new program
+    if (G.program)      { glDeleteProgram(G.program);      G.program = 0; }
+    if (G.programPlain) { glDeleteProgram(G.programPlain); G.programPlain = 0; }
+    if (G.programEdge)  { glDeleteProgram(G.programEdge);  G.programEdge = 0; }
+    G.locPos = G.locUV = -1;
+
+    // Compile/link the (possibly new) program, and its variant for frames without the overlay.
+    // Should the variant fail (a shader that doesn't build with NO_OVERLAY), the program is
+    // drawn with the white overlay as before.
+    const char* vs = vertexSrc ? vertexSrc : kDefaultVS;
+    const char* fs = fragmentSrc ? fragmentSrc : kDefaultFS;
+    G.program = makeProgram(vs, fs);
+    if (G.program) {
+        G.programPlain = makeProgram(vs, without_overlay(fs).c_str());
+        if (G.programPlain) setup_main_program(G.programPlain, 1);
+    }
+    setup_main_program(G.program, 0);
+    G.mainVS = vs;
+    G.mainFS = fs;
 
     // Only discover locations here; set pointers later in draw(), guarded by >= 0
     resolveAttribs(G.program, G.locPos, G.locUV);
-}
 
-// Forward-declare uniform cache helper
-inline GLint uget(const char* name);
+    // A new shader with the edge mask in use: its edge variant too
+    if (G.edgeReady && !build_edge_programs())
+        G.edgeReady = false;
+}
 
 // ---------------- Public API ----------------
 inline bool init(SDL_Window* window,
@@ -361,15 +687,11 @@ inline bool init(SDL_Window* window,
     GLenum game_fmt  = (G.gameFmt == State::PixFmt::RGB555) ? GL_RGBA    : GL_RGBA;
     GLenum game_type = (G.gameFmt == State::PixFmt::RGB555) ? GL_UNSIGNED_SHORT_5_5_5_1 : GL_UNSIGNED_BYTE;
 
-    if (vertexSrc && fragmentSrc) {
-        // use GL_Linear as user shader will likely curve etc
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    } else {
-        // use cheaper GL_NEAREST which will be fine for texture expansion
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    }
+    // use GL_Linear as user shader will likely curve etc, otherwise
+    // use cheaper GL_NEAREST which will be fine for texture expansion
+    G.gameFilter = (vertexSrc && fragmentSrc) ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, G.gameFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, G.gameFilter);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexImage2D(GL_TEXTURE_2D, 0, game_ifmt, gameW, gameH, 0, game_fmt, game_type, nullptr);
@@ -413,7 +735,25 @@ inline bool init(SDL_Window* window,
         glGenFramebuffers(1, &G.fbo);
         glBindFramebuffer(GL_FRAMEBUFFER, G.fbo);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, G.texPass, 0);
+        const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        G.upscaleProgram = complete ? makeProgram(kDefaultVS, kUpscaleFS) : 0;
+        if (G.upscaleProgram) {
+            glUseProgram(G.upscaleProgram);
+            glUniform1i(glGetUniformLocation(G.upscaleProgram, "uTex0"), 0);
+            glUniform1i(glGetUniformLocation(G.upscaleProgram, "uTex1"), 1);
+            G.upscalePlain = makeProgram(kDefaultVS, without_overlay(kUpscaleFS).c_str());
+            if (G.upscalePlain) {
+                glUseProgram(G.upscalePlain);
+                glUniform1i(glGetUniformLocation(G.upscalePlain, "uTex0"), 0);
+            }
+        } else {
+            // draw() then renders straight to the window
+            std::cerr << "Offscreen pass unavailable.\n";
+            glDeleteFramebuffers(1, &G.fbo);    G.fbo = 0;
+            glDeleteTextures(1, &G.texPass);    G.texPass = 0;
+        }
     }
 
     // Main program (game shader)
@@ -500,11 +840,13 @@ inline void reallocate_overlay_storage() {
 }
 
 // -------- Uploads --------
-inline void update_game_texture(const void* pixels, int pitchBytes, int w, int h) {
+// y0 is the first texture row written, so a frame can be uploaded in horizontal slices;
+// pixels points at the first row of the slice.
+inline void update_game_texture(const void* pixels, int pitchBytes, int w, int h, int y0 = 0) {
     glActiveTexture(GL_TEXTURE0);
 
      if (G.gameFmt == State::PixFmt::RGB555) {
-        upload_rgb555_16(G.texGame, pixels, pitchBytes, w, h);
+        upload_rgb555_16(G.texGame, pixels, pitchBytes, w, h, y0);
         return;
     }
 
@@ -530,7 +872,7 @@ inline void update_game_texture(const void* pixels, int pitchBytes, int w, int h
         }
     }
     if (!needConvert) {
-        upload_rgba8(G.texGame, fmt, pixels, pitchBytes, w, h);
+        upload_rgba8(G.texGame, fmt, pixels, pitchBytes, w, h, y0);
     } else {
         G.scratch.resize((size_t)w * h * 4);
         const uint8_t* srow = static_cast<const uint8_t*>(pixels);
@@ -543,12 +885,397 @@ inline void update_game_texture(const void* pixels, int pitchBytes, int w, int h
                 row += 4;
             }
         }
-        upload_rgba8(G.texGame, GL_RGBA, G.scratch.data(), w*4, w, h);
+        upload_rgba8(G.texGame, GL_RGBA, G.scratch.data(), w*4, w, h, y0);
     }
 }
 
 
+// -------- Game image pixel unpack buffers --------
+// On GLES3 contexts the game image can be written straight into a mapped pixel unpack buffer.
+// The texture upload is then sourced from the buffer, which the driver can copy without the
+// calling thread stalling on a client memory copy. A ring of buffers lets one be written while
+// an earlier one is still being copied.
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+#ifndef GL_UNPACK_ROW_LENGTH
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+
+inline void shutdown_game_buffers();
+
+// Create the buffer ring for a game image of h rows of pitchBytes. Returns false (and the
+// caller should upload from client memory as before) if the context can't support it.
+inline bool init_game_buffers(int pitchBytes, int h) {
+    shutdown_game_buffers();
+
+    // Game formats uploaded without a CPU swizzle only
+    if (G.gameFmt != State::PixFmt::RGB555 && G.gameFmt != State::PixFmt::RGBA)
+        return false;
+
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    if (!version || std::strncmp(version, "OpenGL ES ", 10) != 0 || version[10] < '3')
+        return false;
+
+    G.mapBufferRange = reinterpret_cast<decltype(G.mapBufferRange)>(SDL_GL_GetProcAddress("glMapBufferRange"));
+    G.unmapBuffer    = reinterpret_cast<decltype(G.unmapBuffer)>(SDL_GL_GetProcAddress("glUnmapBuffer"));
+    if (!G.mapBufferRange || !G.unmapBuffer)
+        return false;
+
+    G.gameBufPitch = pitchBytes;
+    G.gameBufBytes = size_t(pitchBytes) * h;
+    glGenBuffers(State::GAME_BUFFERS, G.gameBuf);
+    for (int i = 0; i < State::GAME_BUFFERS; i++) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, G.gameBuf[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)G.gameBufBytes, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return glGetError() == GL_NO_ERROR;
+}
+
+inline bool has_game_buffers() { return G.gameBuf[0] != 0; }
+
+// Map buffer i for writing a new frame. The returned memory stays valid, and may be written
+// from any thread, until unmap_game_buffer(i). Returns nullptr on failure.
+inline void* map_game_buffer(int i) {
+    if (!G.gameBuf[i]) return nullptr;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, G.gameBuf[i]);
+    G.gameBufMap[i] = G.mapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)G.gameBufBytes,
+                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return G.gameBufMap[i];
+}
+
+inline void unmap_game_buffer(int i) {
+    if (!G.gameBufMap[i]) return;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, G.gameBuf[i]);
+    G.unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    G.gameBufMap[i] = nullptr;
+}
+
+// Upload the game texture from (unmapped) buffer i
+inline void update_game_texture_from_buffer(int i, int w, int h) {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, G.texGame);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, G.gameBuf[i]);
+
+    const int bytes_pp = (G.gameFmt == State::PixFmt::RGB555) ? 2 : 4;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, bytes_pp);
+    if (G.gameBufPitch != w * bytes_pp)
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, G.gameBufPitch / bytes_pp);
+
+    if (G.gameFmt == State::PixFmt::RGB555)
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, nullptr);
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    if (G.gameBufPitch != w * bytes_pp)
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+inline void shutdown_game_buffers() {
+    for (int i = 0; i < State::GAME_BUFFERS; i++)
+        unmap_game_buffer(i);
+    if (G.gameBuf[0]) {
+        glDeleteBuffers(State::GAME_BUFFERS, G.gameBuf);
+        for (int i = 0; i < State::GAME_BUFFERS; i++)
+            G.gameBuf[i] = 0;
+    }
+    G.gameBufBytes = 0;
+}
+
+
+// -------- Palette index passes --------
+// The game image can be uploaded as raw S16 palette indices (lo byte in luminance, hi byte in
+// alpha), leaving the colour lookup to an offscreen pass using a palette texture. The output
+// replaces the game texture for the CRT shader. The palette is only uploaded when it changes.
+//
+// The plain pass just looks up the colour (and dims the scanlines).
+//
+// The NTSC pass is an alternative to the CPU Blargg filter. After the lookup, it encodes the
+// image as an NTSC signal and decodes it again, giving the usual artefacts: colour fringing on
+// luma edges, dot crawl, colour bleed. The filter samples the signal four times per colour cycle
+// over 13 taps; the tap weights come from the same setup values as the CPU filter (see
+// set_ntsc_params).
+
+static const char* kIndexVS =
+    "attribute vec2 VertexCoord;\n"
+    "void main(){\n"
+    "    gl_Position = vec4(VertexCoord, 0.0, 1.0);\n"
+    "}\n";
+
+static const char* kPaletteFS =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D uIndex;\n"
+    "uniform sampler2D uPalette;\n"
+    "uniform vec2  uSrcSize;\n"
+    "uniform vec4  uPalMap;\n"
+    "uniform float uScanline;\n"
+    "void main(){\n"
+    "    vec4 t = texture2D(uIndex, gl_FragCoord.xy / uSrcSize);\n"
+    "    vec3 rgb = texture2D(uPalette, vec2(t.r, t.a) * uPalMap.xy + uPalMap.zw).rgb;\n"
+    "    if (mod(floor(gl_FragCoord.y), 2.0) >= 1.0) rgb *= uScanline;\n"
+    "    gl_FragColor = vec4(rgb, 1.0);\n"
+    "}\n";
+
+static const int kNtscTaps = 13;
+
+static const char* kNtscFS =
+    "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+    "precision highp float;\n"
+    "#else\n"
+    "precision mediump float;\n"
+    "#endif\n"
+    "uniform sampler2D uIndex;\n"
+    "uniform sampler2D uPalette;\n"
+    "uniform vec2  uSrcSize;\n"       // index texture size
+    "uniform vec4  uPalMap;\n"        // index bytes -> palette texture coordinates
+    "uniform float uInScale;\n"       // input pixels per output pixel
+    "uniform float uStep;\n"          // input pixels per signal sample (quarter colour cycle)
+    "uniform float uPhase;\n"         // burst phase of the frame (0-2)
+    "uniform float uArtifacts;\n"     // luma read as chroma
+    "uniform float uFringing;\n"      // chroma left in luma
+    "uniform float uLumaW[13];\n"
+    "uniform float uChromaW[13];\n"
+    "uniform vec2  uHue;\n"           // hue rotation, scaled by saturation
+    "uniform vec3  uLevels;\n"        // gamma, contrast, brightness
+    "uniform float uScanline;\n"      // odd row level
+    "const mat3 toYIQ = mat3(0.299, 0.596, 0.211, 0.587, -0.274, -0.523, 0.114, -0.322, 0.312);\n"
+    "const mat3 toRGB = mat3(1.0, 1.0, 1.0, 0.956, -0.272, -1.106, 0.621, -0.647, 1.703);\n"
+    "vec3 fetch(float x, float v){\n"
+    "    vec4 t = texture2D(uIndex, vec2((floor(x) + 0.5) / uSrcSize.x, v));\n"
+    "    vec3 rgb = texture2D(uPalette, vec2(t.r, t.a) * uPalMap.xy + uPalMap.zw).rgb;\n"
+    "    return pow(rgb, vec3(uLevels.x)) * uLevels.y + uLevels.z;\n"
+    "}\n"
+    "void main(){\n"
+    "    float row = floor(gl_FragCoord.y);\n"
+    "    float v   = (row + 0.5) / uSrcSize.y;\n"
+    "    float x0  = (floor(gl_FragCoord.x) + 0.5) * uInScale;\n"
+    "    float theta = mod(x0 / uStep, 4.0) * 1.5707963 + 2.0943951 * mod(row + uPhase, 3.0);\n"
+    // first tap is six quarter cycles back, i.e. in antiphase
+    "    vec2 carrier = -vec2(cos(theta), sin(theta));\n"
+    "    float y = 0.0;\n"
+    "    vec2 iq = vec2(0.0);\n"
+    "    for (int k = 0; k < 13; k++) {\n"
+    "        vec3 yiq = toYIQ * fetch(x0 + float(k - 6) * uStep, v);\n"
+    "        float chroma = dot(yiq.yz, carrier);\n"
+    "        y  += uLumaW[k] * (yiq.x + uFringing * chroma);\n"
+    "        iq += uChromaW[k] * (chroma + uArtifacts * yiq.x) * carrier;\n"
+    "        carrier = vec2(-carrier.y, carrier.x);\n"
+    "    }\n"
+    "    iq = 2.0 * vec2(iq.x * uHue.x - iq.y * uHue.y, iq.x * uHue.y + iq.y * uHue.x);\n"
+    "    vec3 rgb = toRGB * vec3(y, iq);\n"
+    "    if (mod(row, 2.0) >= 1.0) rgb *= uScanline;\n"
+    "    gl_FragColor = vec4(clamp(rgb, 0.0, 1.0), 1.0);\n"
+    "}\n";
+
+// Filter controls. These follow snes_ntsc_setup_t: hue to bleed are -1 to +1, 0 being neutral.
+struct NtscParams {
+    float hue = 0, saturation = 0, contrast = 0, brightness = 0;
+    float sharpness = 0, gamma = 0, resolution = 0;
+    float artifacts = 0, fringing = 0, bleed = 0;
+    float scanline = 1;          // level of odd rows (1 = no scanlines)
+};
+
+inline void shutdown_index_pass();
+
+inline void set_texture_params(GLint filter) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+// Set up a pass with fragment shader fs, for srcW x srcH palette indices drawn to outW x srcH,
+// with a palette of paletteEntries (a multiple of 256).
+inline bool init_index_pass(const char* fs, int srcW, int srcH, int outW, int paletteEntries) {
+    shutdown_index_pass();
+
+    G.indexProgram = makeProgram(kIndexVS, fs);
+    if (!G.indexProgram) return false;
+
+    G.indexW = srcW; G.indexH = srcH;
+    G.indexOutW  = outW; G.indexOutH  = srcH;
+    G.paletteRows = paletteEntries / 256;
+
+    glGenTextures(1, &G.texIndex);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, G.texIndex);
+    set_texture_params(GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, srcW, srcH, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, nullptr);
+
+    glGenTextures(1, &G.texPalette);
+    glBindTexture(GL_TEXTURE_2D, G.texPalette);
+    set_texture_params(GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, G.paletteRows, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    glGenTextures(1, &G.texIndexed);
+    glBindTexture(GL_TEXTURE_2D, G.texIndexed);
+    set_texture_params(G.gameFilter);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, outW, srcH, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    glGenFramebuffers(1, &G.indexFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, G.indexFbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, G.texIndexed, 0);
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, G.texGame);
+    if (!complete) { shutdown_index_pass(); return false; }
+
+    glUseProgram(G.indexProgram);
+    glUniform1i(glGetUniformLocation(G.indexProgram, "uIndex"),   0);
+    glUniform1i(glGetUniformLocation(G.indexProgram, "uPalette"), 2);
+    glUniform2f(glGetUniformLocation(G.indexProgram, "uSrcSize"), float(srcW), float(srcH));
+    // byte b of the index, sampled as b/255, to the centre of texel column/row b
+    glUniform4f(glGetUniformLocation(G.indexProgram, "uPalMap"),
+                255.0f / 256.0f, 255.0f / float(G.paletteRows), 0.5f / 256.0f, 0.5f / float(G.paletteRows));
+    glUniform1f(glGetUniformLocation(G.indexProgram, "uScanline"), 1.0f);
+    G.ntscLocPhase = glGetUniformLocation(G.indexProgram, "uPhase");
+    glUseProgram(G.program);
+
+    G.indexActive = (glGetError() == GL_NO_ERROR);
+    if (!G.indexActive) shutdown_index_pass();
+    return G.indexActive;
+}
+
+// The NTSC pass, filtering to outW wide. hires doubles the input pixels per colour cycle.
+// Returns false (and the CPU filter should be used) if the pass can't be created.
+inline bool init_ntsc(int srcW, int srcH, int outW, int paletteEntries, bool hires) {
+    if (!init_index_pass(kNtscFS, srcW, srcH, outW, paletteEntries)) return false;
+    glUseProgram(G.indexProgram);
+    glUniform1f(glGetUniformLocation(G.indexProgram, "uInScale"), float(srcW) / float(outW));
+    // four signal samples per colour cycle; a cycle is 1.5 low resolution pixels
+    glUniform1f(glGetUniformLocation(G.indexProgram, "uStep"), (hires ? 3.0f : 1.5f) / 4.0f);
+    glUseProgram(G.program);
+    return true;
+}
+
+// The plain colour lookup pass. Returns false (and the game image should be uploaded as RGB) if
+// the pass can't be created.
+inline bool init_palette_lookup(int srcW, int srcH, int paletteEntries) {
+    return init_index_pass(kPaletteFS, srcW, srcH, srcW, paletteEntries);
+}
+
+inline bool has_index_pass() { return G.indexActive; }
+
+inline void set_ntsc_params(const NtscParams& p) {
+    if (!G.indexProgram) return;
+
+    // Gaussian tap weights, in signal samples. Resolution and sharpness narrow the luma filter;
+    // bleed widens the chroma filter. Where luma is read as chroma, the chroma filter must span
+    // enough of a cycle that flat areas stay free of colour.
+    float luma_sigma   = std::max(0.3f, 1.2f * (1.0f - 0.5f * p.resolution) * (1.0f - 0.3f * p.sharpness));
+    float chroma_sigma = 2.5f * (1.0f + 0.5f * p.bleed);
+    // crosstalk as the CPU filter's artifacts/fringing scaling, at half strength for 13 taps
+    float artifacts    = 0.5f * ((p.artifacts > 0 ? p.artifacts * 0.5f : p.artifacts) + 1.0f);
+    float fringing     = 0.5f * (p.fringing + 1.0f);
+    if (artifacts > 0) chroma_sigma = std::max(chroma_sigma, 2.0f);
+    chroma_sigma = std::max(chroma_sigma, 0.3f);
+
+    float lw[kNtscTaps], cw[kNtscTaps], lsum = 0, csum = 0;
+    for (int k = 0; k < kNtscTaps; k++) {
+        const float d = float(k - kNtscTaps / 2);
+        lw[k] = std::exp(-0.5f * d * d / (luma_sigma * luma_sigma));
+        cw[k] = std::exp(-0.5f * d * d / (chroma_sigma * chroma_sigma));
+        lsum += lw[k]; csum += cw[k];
+    }
+    for (int k = 0; k < kNtscTaps; k++) { lw[k] /= lsum; cw[k] /= csum; }
+
+    const float sat   = 1.0f + p.saturation;
+    const float angle = p.hue * 3.14159265f;
+
+    glUseProgram(G.indexProgram);
+    glUniform1fv(glGetUniformLocation(G.indexProgram, "uLumaW"),   kNtscTaps, lw);
+    glUniform1fv(glGetUniformLocation(G.indexProgram, "uChromaW"), kNtscTaps, cw);
+    glUniform1f(glGetUniformLocation(G.indexProgram, "uArtifacts"), artifacts);
+    glUniform1f(glGetUniformLocation(G.indexProgram, "uFringing"),  fringing);
+    glUniform2f(glGetUniformLocation(G.indexProgram, "uHue"), sat * std::cos(angle), sat * std::sin(angle));
+    // the same level mapping as the CPU filter's gamma table
+    glUniform3f(glGetUniformLocation(G.indexProgram, "uLevels"),
+                1.1333f - p.gamma * 0.5f, 1.0f + p.contrast * 0.5f, p.brightness * 0.5f);
+    glUniform1f(glGetUniformLocation(G.indexProgram, "uScanline"), p.scanline);
+    glUseProgram(G.program);
+}
+
+// Level of the odd rows, for scanlines (1 = no scanlines). Also set by set_ntsc_params().
+inline void set_scanline_level(float level) {
+    if (!G.indexProgram) return;
+    glUseProgram(G.indexProgram);
+    glUniform1f(glGetUniformLocation(G.indexProgram, "uScanline"), level);
+    glUseProgram(G.program);
+}
+
+inline void set_ntsc_phase(int phase) {
+    if (!G.indexProgram) return;
+    glUseProgram(G.indexProgram);
+    glUniform1f(G.ntscLocPhase, float(phase));
+    glUseProgram(G.program);
+}
+
+// y0 is the first row written, as update_game_texture()
+inline void update_index_texture(const void* indices, int pitchBytes, int w, int h, int y0 = 0) {
+    glActiveTexture(GL_TEXTURE0);
+    upload_16bpp(G.texIndex, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, indices, pitchBytes, w, h, y0);
+}
+
+// rgba: 4 bytes (R, G, B, A) per palette entry, for the whole palette. Rows (of 256 entries)
+// first_row to first_row+rows-1 are uploaded; rows < 0 uploads the rest of the palette.
+inline void update_palette_texture(const uint8_t* rgba, int first_row = 0, int rows = -1) {
+    if (!G.texPalette) return;
+    first_row = std::clamp(first_row, 0, G.paletteRows);
+    if (rows < 0 || first_row + rows > G.paletteRows) rows = G.paletteRows - first_row;
+    if (rows == 0) return;
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, G.texPalette);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, first_row, 256, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+                    rgba + size_t(first_row) * 256 * 4);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Run the pass, from the index texture into texIndexed
+inline void draw_index_pass() {
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, G.indexFbo);
+    glViewport(0, 0, G.indexOutW, G.indexOutH);
+    glUseProgram(G.indexProgram);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, G.texPalette);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, G.texIndex);
+    glBindBuffer(GL_ARRAY_BUFFER, G.vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (const void*)0);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+inline void shutdown_index_pass() {
+    G.indexActive = false;
+    if (G.indexFbo)     { glDeleteFramebuffers(1, &G.indexFbo);  G.indexFbo = 0; }
+    if (G.texIndexed)   { glDeleteTextures(1, &G.texIndexed);    G.texIndexed = 0; }
+    if (G.texIndex)     { glDeleteTextures(1, &G.texIndex);      G.texIndex = 0; }
+    if (G.texPalette)   { glDeleteTextures(1, &G.texPalette);    G.texPalette = 0; }
+    if (G.indexProgram) { glDeleteProgram(G.indexProgram);       G.indexProgram = 0; }
+}
+
+
 inline void update_overlay_texture(const void* pixels, int pitchBytes, int w, int h) {
+    G.edgeReady = false;
     glActiveTexture(GL_TEXTURE1);
     if (G.overlayFmt == State::PixFmt::A8) {
         // Alpha-only overlays are uploaded as GL_LUMINANCE (replicated to RGB, A=1) for correct multiply in GLES2
@@ -601,26 +1328,85 @@ inline void update_overlay_texture(const void* pixels, int pitchBytes, int w, in
 // After calling this, draws will multiply against white (no overlay effect).
 inline void clear_overlay_texture(){
     G.overlayReady = false;
+    G.edgeReady    = false;
     // Bind the neutral 1x1 white texture on unit 1 for immediate correctness.
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, G.texWhite);
     glActiveTexture(GL_TEXTURE0);
 }
 
+// Whether the fragment shader has full precision floats, which the edge mask needs
+inline bool edge_mask_supported() {
+    GLint range[2] = {0, 0}, precision = 0;
+    glGetShaderPrecisionFormat(GL_FRAGMENT_SHADER, GL_HIGH_FLOAT, range, &precision);
+    return precision >= 23;
+}
+
+// Draw the CRT edge mask in the shader, from the values of kEdgeMaskFS, in place of the overlay
+// texture, whose storage is given up (reallocate_overlay_storage() takes it back). Changing the
+// settings then only sends the uniforms again. False if the GPU can't, in which case the overlay
+// is left as it was.
+inline bool set_edge_mask(const float values[4][4]) {
+    if (!edge_mask_supported()) return false;
+    std::memcpy(G.edgeVal, values, sizeof(G.edgeVal));
+    if (!build_edge_programs()) return false;
 
-// Uniform helpers (main program)
-inline GLint uget(const char* name){
-    if (G.ucache_program != G.program) { G.ucache.clear(); G.ucache_program = G.program; }
-    auto it = G.ucache.find(name);
-    if (it != G.ucache.end()) return it->second;
-    GLint l = glGetUniformLocation(G.program, name);
-    G.ucache[name] = l;
-    return l;
+    if (!G.edgeReady) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, G.texOverlay);
+        const GLubyte kWhitePixel[4] = {255,255,255,255};
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, kWhitePixel);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    G.overlayReady = false;
+    G.edgeReady    = true;
+    return true;
+}
+
+
+// Uniform helpers (main program). y is ignored for float uniforms.
+inline void set_uniform(Uniform u, float x, float y = 0.0f) {
+    float* v = G.uniformVal[u];
+    if (v[0] != x || v[1] != y) {
+        v[0] = x; v[1] = y;
+        G.uniformDirty[0][u] = G.uniformDirty[1][u] = G.uniformDirty[2][u] = true;
+    }
+}
+
+// Send the uniforms changed since the last draw of main program variant var (called by draw())
+inline void flush_uniforms(int var) {
+    const GLuint p = (var == 2) ? G.programEdge : var ? G.programPlain : G.program;
+    bool bound = false;
+    for (int u = 0; u < U_COUNT; u++) {
+        if (!G.uniformDirty[var][u]) continue;
+        G.uniformDirty[var][u] = false;
+        if (G.uniformLoc[var][u] < 0) continue;
+        if (!bound) { glUseProgram(p); bound = true; }
+        const float* v = G.uniformVal[u];
+        if (kUniforms[u].size == 2) glUniform2f(G.uniformLoc[var][u], v[0], v[1]);
+        else                        glUniform1f(G.uniformLoc[var][u], v[0]);
+    }
+}
+
+// The shadow mask, as a w x h tile of levels (each level / 2 as a byte, so up to 2.0) that the
+// CRT shader repeats across the output. Set again only when the mask settings change.
+inline void set_shadow_mask(const uint8_t* levels, int w, int h) {
+    glActiveTexture(GL_TEXTURE3);
+    if (!G.texMask) {
+        glGenTextures(1, &G.texMask);
+        glBindTexture(GL_TEXTURE_2D, G.texMask);
+        set_texture_params(GL_NEAREST); // not a power of two, so the shader wraps it
+    } else {
+        glBindTexture(GL_TEXTURE_2D, G.texMask);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w, h, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, levels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glActiveTexture(GL_TEXTURE0);
+    set_uniform(U_MASK_TILE, 1.0f / float(w), 1.0f / float(h));
 }
-inline void set_uniform(const char* name, float v)              { glUseProgram(G.program); GLint l=uget(name); if (l>=0) glUniform1f(l, v); }
-inline void set_uniform2(const char* name, float x,float y)     { glUseProgram(G.program); GLint l=uget(name); if (l>=0) glUniform2f(l, x,y); }
-inline void set_uniform3(const char* name, float x,float y,float z){ glUseProgram(G.program); GLint l=uget(name); if (l>=0) glUniform3f(l, x,y,z); }
-inline void set_uniform4(const char* name, float x,float y,float z,float w){ glUseProgram(G.program); GLint l=uget(name); if (l>=0) glUniform4f(l, x,y,z,w); }
+
+inline bool has_offscreen() { return G.fbo != 0; }
 
 // -------- Destination rect controls (bottom-left origin) --------
 inline void set_present_rect_pixels(int x, int y, int w, int h){
@@ -634,17 +1420,34 @@ inline void set_overlay_rect_pixels(int x, int y, int w, int h){
 inline void clear_overlay_rect(){ G.useOverlayDstRect = false; }
 
 inline void draw(bool useOffscreen, bool drawOverlay) {
+    // Without an overlay, the variants that don't read it. Offscreen, the overlay is multiplied
+    // in by the upscale, so the main program never needs it. With the edge mask, the variants
+    // that work it out in place of reading the overlay texture.
+    const bool edge      = drawOverlay && G.edgeReady;
+    drawOverlay = drawOverlay && (G.overlayReady || G.edgeReady);
+    const bool offscreen = useOffscreen && G.fbo;
+    const int  var       = (offscreen || !drawOverlay) ? (G.programPlain ? 1 : 0) : edge ? 2 : 0;
+    const GLuint program = (var == 2) ? G.programEdge : var ? G.programPlain : G.program;
+    const GLuint upscale = (!drawOverlay && G.upscalePlain) ? G.upscalePlain :
+                           edge ? G.upscaleEdge : G.upscaleProgram;
+    const GLuint texOver = (drawOverlay && !edge) ? G.texOverlay : G.texWhite;
+    flush_uniforms(var);
+
+    // --- Index pass: palette indices -> game image ---
+    if (G.indexActive) draw_index_pass();
+    const GLuint texGame = G.indexActive ? G.texIndexed : G.texGame;
+
     // --- Pass A: draw game texture ---
-    if (useOffscreen && G.fbo) {
+    if (offscreen) {
         // 1) game -> offscreen
         glDisable(GL_BLEND);
         glBlendEquation(GL_FUNC_ADD);
         glBlendFunc(GL_ONE, GL_ZERO);
         glBindFramebuffer(GL_FRAMEBUFFER, G.fbo);
         glViewport(0, 0, G.fboW, G.fboH);
-        glUseProgram(G.program);
+        glUseProgram(program);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, G.texGame);
+        glBindTexture(GL_TEXTURE_2D, texGame);
         // Neutralize overlay during offscreen subpass
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, G.texWhite);
@@ -660,29 +1463,26 @@ inline void draw(bool useOffscreen, bool drawOverlay) {
         }
         glDrawArrays(GL_TRIANGLES, 0, 3);
 
-        // 2) offscreen -> backbuffer, with optional overlay multiply
+        // 2) offscreen -> backbuffer: bilinear upscale, with optional overlay multiply
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         int vx = 0, vy = 0, vw = G.fbW, vh = G.fbH;
         if (G.useDstRect) {
             vx = G.dstX; vw = G.dstW; vh = G.dstH; vy = 0 + G.dstY; // bottom-left origin
         }
         glViewport(vx, vy, vw, vh);
-        glUseProgram(G.program);
+        glUseProgram(upscale);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, G.texPass);
         // Bind overlay (or white) for single-pass multiply
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, (drawOverlay && G.overlayReady) ? G.texOverlay : G.texWhite);
+        glBindTexture(GL_TEXTURE_2D, texOver);
         glActiveTexture(GL_TEXTURE0);
         glBindBuffer(GL_ARRAY_BUFFER, G.vbo);
-        if (G.locPos >= 0) {
-            glEnableVertexAttribArray(G.locPos);
-            glVertexAttribPointer(G.locPos, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (const void*)0);
-        }
-        if (G.locUV >= 0) {
-            glEnableVertexAttribArray(G.locUV);
-            glVertexAttribPointer(G.locUV,  2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (const void*)(2*sizeof(float)));
-        }
+        // attribute locations are bound by makeProgram()
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (const void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (const void*)(2*sizeof(float)));
         glDrawArrays(GL_TRIANGLES, 0, 3);
     } else {
         // Single pass directly to backbuffer
@@ -692,12 +1492,12 @@ inline void draw(bool useOffscreen, bool drawOverlay) {
             vx = G.dstX; vw = G.dstW; vh = G.dstH; vy = 0 + G.dstY; // bottom-left origin
         }
         glViewport(vx, vy, vw, vh);
-        glUseProgram(G.program);
+        glUseProgram(program);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, G.texGame);
+        glBindTexture(GL_TEXTURE_2D, texGame);
         // Bind overlay (or white) for single-pass multiply
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, (drawOverlay && G.overlayReady) ? G.texOverlay : G.texWhite);
+        glBindTexture(GL_TEXTURE_2D, texOver);
         glActiveTexture(GL_TEXTURE0);
         glBindBuffer(GL_ARRAY_BUFFER, G.vbo);
         if (G.locPos >= 0) {
@@ -719,12 +1519,23 @@ inline void clear(float r, float g, float b, float a){
 }
 
 inline void shutdown() {
+    shutdown_game_buffers();
+    shutdown_index_pass();
     if (G.vbo)        { glDeleteBuffers(1, &G.vbo); G.vbo = 0; }
     if (G.texWhite)   { glDeleteTextures(1, &G.texWhite);   G.texWhite = 0; }
+    if (G.texMask)    { glDeleteTextures(1, &G.texMask);    G.texMask = 0; }
     if (G.texGame)    { glDeleteTextures(1, &G.texGame); G.texGame = 0; }
     if (G.texOverlay) { glDeleteTextures(1, &G.texOverlay); G.texOverlay = 0; }
     if (G.texPass)    { glDeleteTextures(1, &G.texPass); G.texPass = 0; }
+    if (G.fbo)        { glDeleteFramebuffers(1, &G.fbo); G.fbo = 0; }
+    if (G.upscaleProgram) { glDeleteProgram(G.upscaleProgram); G.upscaleProgram = 0; }
+    if (G.upscalePlain)   { glDeleteProgram(G.upscalePlain);   G.upscalePlain = 0; }
+    if (G.upscaleEdge)    { glDeleteProgram(G.upscaleEdge);    G.upscaleEdge = 0; }
     if (G.program)    { glDeleteProgram(G.program); G.program = 0; }
+    if (G.programPlain) { glDeleteProgram(G.programPlain); G.programPlain = 0; }
+    if (G.programEdge)  { glDeleteProgram(G.programEdge);  G.programEdge = 0; }
+    G.overlayReady = G.edgeReady = false;
+    G.programBinaryChecked = false; // the next context may differ
 }
 
 
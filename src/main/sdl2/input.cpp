@@ -12,6 +12,8 @@
 #include <cstring>
 #include <cstdlib> // abs
 #include "sdl2/input.hpp"
+#include "sdl2/evdev.hpp"
+#include "haptics.hpp"
 
 #if defined(__has_include)
 #  if __has_include("directx/ffeedback.hpp")
@@ -35,6 +37,8 @@
 #endif
 
 #include "frontend/config.hpp"
+#include "frametrace.hpp"
+#include "video.hpp"
 
 Input input;
 
@@ -68,6 +72,7 @@ void Input::init(int pad_id, int* key_config, int* pad_config, int analog, int*
 
 void Input::open_joy()
 {
+    std::lock_guard<std::mutex> lock(haptics::devices());
     gamepad = SDL_NumJoysticks() > pad_id;
     if (gamepad)
     {
@@ -241,6 +246,7 @@ void Input::bind_button(SDL_GameControllerButton button, int offset)
 
 void Input::close_joy()
 {
+    std::lock_guard<std::mutex> lock(haptics::devices());
     if (controller != NULL)
     {
         SDL_GameControllerClose(controller);
@@ -338,6 +344,22 @@ void Input::handle_key(const int key, const bool is_pressed)
             keys[MENU] = is_pressed;
             break;
 
+        case SDLK_F4:
+            // writes the frame timeline, if kept (video.trace_events)
+            if (is_pressed) frametrace::request_dump();
+            break;
+
+        case SDLK_F10:
+            // saves the video hardware state of this frame (see Video::save_snapshot)
+            if (is_pressed) video.request_snapshot();
+            break;
+
+        case SDLK_F6:
+            // toggles the performance HUD
+            if (!is_pressed) break;
+            config.video.fps_count = (config.video.fps_count == 2) ? 0 : 2;
+            break;
+
         case SDLK_F7:
             // JJP - switches between sprite rendering (original/hi-res)
             if (!is_pressed) break;
@@ -423,15 +445,44 @@ void Input::handle_key(const int key, const bool is_pressed)
 
 void Input::handle_joy_axis(SDL_JoyAxisEvent* evt)
 {
-    if (controller != NULL) return;
+    if (controller != NULL || evdev::active()) return;
     handle_axis(evt->axis, evt->value);
 }
 
 void Input::handle_controller_axis(SDL_ControllerAxisEvent* evt)
 {
+    if (evdev::active()) return;
     handle_axis(evt->axis, evt->value);
 }
 
+// Axes and buttons read straight from the device (see evdev.hpp), in place of SDL's events
+void Input::read_evdev()
+{
+    if (!evdev::active()) return;
+
+    int16_t value;
+    for (int ax = 0; ax < evdev::AXES; ax++)
+        if (evdev::axis(ax, &value))
+            handle_axis(ax, value);
+
+    // a button released and pressed again since the last call is left down
+    uint64_t pressed, released, down;
+    evdev::buttons(&pressed, &released, &down);
+    for (int button = 0; button < evdev::BUTTONS; button++)
+    {
+        const uint64_t bit = uint64_t(1) << button;
+        if (pressed & bit)
+        {
+            joy_button = button;
+            handle_joy(button, true);
+        }
+        if (released & bit)
+            handle_joy(button, false);
+        if (released & down & bit)
+            handle_joy(button, true);
+    }
+}
+
 void Input::handle_axis(const uint8_t ax, const int16_t value)
 {
     // Analog Controls
@@ -503,7 +554,7 @@ void Input::handle_axis(const uint8_t ax, const int16_t value)
 
 int Input::scale_trigger(const int value)
 {
-    if (controller != NULL)
+    if (controller != NULL && !evdev::active())
         return value / 0x80;
     else
         return (value + 0x8000) / 0x100;
@@ -552,7 +603,7 @@ void Input::reset_axis_config()
 
 void Input::handle_joy_down(SDL_JoyButtonEvent* evt)
 {
-    if (controller != NULL) return;
+    if (controller != NULL || evdev::active()) return;
     // Latch joystick button presses for redefines
     joy_button = evt->button;
 //    std::cout << "Joystick button pressed event: Button " << joy_button << std::endl;
@@ -561,12 +612,13 @@ void Input::handle_joy_down(SDL_JoyButtonEvent* evt)
 
 void Input::handle_joy_up(SDL_JoyButtonEvent* evt)
 {
-    if (controller != NULL) return;
+    if (controller != NULL || evdev::active()) return;
     handle_joy(evt->button, false);
 }
 
 void Input::handle_controller_down(SDL_ControllerButtonEvent* evt)
 {
+    if (evdev::active()) return;
     joy_button = evt->button;
 //    std::cout << "SDL Controller button pressed event: Button " << joy_button << std::endl;
     handle_joy(evt->button, true);
@@ -574,6 +626,7 @@ void Input::handle_controller_down(SDL_ControllerButtonEvent* evt)
 
 void Input::handle_controller_up(SDL_ControllerButtonEvent* evt)
 {
+    if (evdev::active()) return;
     handle_joy(evt->button, false);
 }
 
@@ -600,7 +653,7 @@ void Input::handle_joy(const uint8_t button, const bool is_pressed)
 
 void Input::handle_joy_hat(SDL_JoyHatEvent* evt)
 {
-    if (controller != NULL) return;
+    if (controller != NULL || evdev::active()) return;
 
     keys[UP] = evt->value == SDL_HAT_UP;
     keys[DOWN] = evt->value == SDL_HAT_DOWN;
@@ -608,7 +661,13 @@ void Input::handle_joy_hat(SDL_JoyHatEvent* evt)
     keys[RIGHT] = evt->value == SDL_HAT_RIGHT;
 }
 
+// Posted to the haptics thread, which calls write_rumble() if the rumble has changed
 void Input::set_rumble(bool enable, float strength, int mode)
+{
+    haptics::rumble(enable, strength, mode);
+}
+
+void Input::write_rumble(bool enable, float strength, int mode)
 {
 #ifndef WIN32
     if (hidraw_device >= 0) {
@@ -84,6 +84,7 @@ public:
     void handle_controller_axis(SDL_ControllerAxisEvent*);
     void handle_controller_down(SDL_ControllerButtonEvent*);
     void handle_controller_up(SDL_ControllerButtonEvent*);
+    void read_evdev();
     void frame_done();
     bool is_pressed(presses p);
     bool is_pressed_clear(presses p);
@@ -91,6 +92,7 @@ public:
     void reset_axis_config();
     int get_axis_config();
     void set_rumble(bool, float strength = 1.0f, int mode = 0);
+    void write_rumble(bool, float strength, int mode);
 
 private:
     static const int CENTRE = 0x80;
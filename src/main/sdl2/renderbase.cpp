@@ -14,6 +14,17 @@
 
 #include "renderbase.hpp"
 #include <iostream>
+#include <algorithm>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define PALETTE_SIMD 1
+#elif defined(__SSSE3__)
+    #include <tmmintrin.h>
+    #define PALETTE_SIMD 1
+#else
+    #define PALETTE_SIMD 0
+#endif
 
 
 RenderBase::RenderBase()
@@ -27,6 +38,7 @@ RenderBase::RenderBase()
     // initial colour lookup tables
     memset(s16_rgb555, 0, S16_PALETTE_ENTRIES * 2 * sizeof(uint16_t));
     memset(rgb_blargg, 0, S16_PALETTE_ENTRIES * 2 * sizeof(uint16_t));
+    memset(s16_rgba8,  0, sizeof(s16_rgba8));
 }
 
 // Setup screen size
@@ -102,6 +114,10 @@ void RenderBase::convert_palette(uint32_t adr, uint32_t r1, uint32_t g1, uint32_
                       (S16_rgbVal_5bit[b1] << 1) |
                       RGB1555_ALPHA;
 	rgb_blargg[adr]  = CURRENT_RGB_BLARRG_STD();
+    s16_rgba8[adr][0] = S16_rgbVal[r1];
+    s16_rgba8[adr][1] = S16_rgbVal[g1];
+    s16_rgba8[adr][2] = S16_rgbVal[b1];
+    s16_rgba8[adr][3] = 0xFF;
 
     // Shadows
     s16_rgb555[adr + S16_PALETTE_ENTRIES] =
@@ -110,6 +126,169 @@ void RenderBase::convert_palette(uint32_t adr, uint32_t r1, uint32_t g1, uint32_
                      (S16_shadowVal_5bit[b1] << 11) |
                      RGB1555_ALPHA;
     rgb_blargg[adr + S16_PALETTE_ENTRIES] = CURRENT_RGB_BLARRG_SHADOW();
+    s16_rgba8[adr + S16_PALETTE_ENTRIES][0] = S16_shadowVal[r1];
+    s16_rgba8[adr + S16_PALETTE_ENTRIES][1] = S16_shadowVal[g1];
+    s16_rgba8[adr + S16_PALETTE_ENTRIES][2] = S16_shadowVal[b1];
+    s16_rgba8[adr + S16_PALETTE_ENTRIES][3] = 0xFF;
+
+    mark_palette_rows(adr, adr + 1);
+}
+
+void RenderBase::mark_palette_rows(int first, int end)
+{
+    const int row_first = first / PALETTE_ROW_ENTRIES;
+    const int row_end   = (end + PALETTE_ROW_ENTRIES - 1) / PALETTE_ROW_ENTRIES;
+    const uint32_t rows = ((1u << row_end) - 1) & ~((1u << row_first) - 1);
+    const int shadow_row = S16_PALETTE_ENTRIES / PALETTE_ROW_ENTRIES;
+    palette_dirty_rows.fetch_or(rows | (rows << shadow_row), std::memory_order_release);
+}
+
+
+// Batch conversion of palette RAM to all of the lookup tables above, as convert_palette().
+// The SIMD paths decode eight entries at a time and look the colour levels up with table
+// shuffles (the DAC tables having 32 entries, each fitting in a byte).
+
+#if PALETTE_SIMD
+static uint8_t lut_rgb[32], lut_rgb_5bit[32], lut_shadow[32], lut_shadow_5bit[32];
+
+static void init_palette_luts()
+{
+    for (int i = 0; i < 32; i++) {
+        lut_rgb[i]         = uint8_t(S16_rgbVal[i]);
+        lut_rgb_5bit[i]    = uint8_t(S16_rgbVal_5bit[i]);
+        lut_shadow[i]      = uint8_t(S16_shadowVal[i]);
+        lut_shadow_5bit[i] = uint8_t(S16_shadowVal_5bit[i]);
+    }
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline uint8x8x4_t load_lut(const uint8_t* lut)
+{
+    uint8x8x4_t t;
+    t.val[0] = vld1_u8(lut);      t.val[1] = vld1_u8(lut + 8);
+    t.val[2] = vld1_u8(lut + 16); t.val[3] = vld1_u8(lut + 24);
+    return t;
+}
+#elif PALETTE_SIMD
+// 32 entry byte lookup, for indices 0-31
+static inline __m128i lookup32(__m128i lo, __m128i hi, __m128i idx)
+{
+    const __m128i upper = _mm_cmpgt_epi8(idx, _mm_set1_epi8(15));
+    return _mm_or_si128(_mm_andnot_si128(upper, _mm_shuffle_epi8(lo, idx)),
+                        _mm_and_si128(upper, _mm_shuffle_epi8(hi, _mm_and_si128(idx, _mm_set1_epi8(15)))));
+}
+
+static inline void store_rgba8(uint8_t (*dst)[4], __m128i r, __m128i g, __m128i b)
+{
+    const __m128i rg = _mm_unpacklo_epi8(r, g);
+    const __m128i ba = _mm_unpacklo_epi8(b, _mm_set1_epi8(-1));
+    _mm_storeu_si128((__m128i*)dst[0], _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128((__m128i*)dst[4], _mm_unpackhi_epi16(rg, ba));
+}
+#endif
+
+void RenderBase::convert_palette_range(const uint8_t* palette, int first, int end)
+{
+    first = std::max(first, 0);
+    end   = std::min(end, int(S16_PALETTE_ENTRIES));
+    if (first >= end) return;
+
+    int i = first;
+
+#if PALETTE_SIMD
+    static bool luts_ready = (init_palette_luts(), true);
+    (void)luts_ready;
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x8x4_t t_rgb = load_lut(lut_rgb),       t_rgb5 = load_lut(lut_rgb_5bit);
+    const uint8x8x4_t t_sh  = load_lut(lut_shadow),    t_sh5  = load_lut(lut_shadow_5bit);
+    const uint16x8_t  v_f   = vdupq_n_u16(0xF);
+    const uint16x8_t  v_1   = vdupq_n_u16(1);
+
+    for (; i + 8 <= end; i += 8) {
+        // big-endian RRRR GGGG BBBB words, with the low bit of each component in bits 12-14
+        const uint16x8_t a = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(palette + i * 2)));
+        const uint8x8_t r = vmovn_u16(vorrq_u16(vshlq_n_u16(vandq_u16(a, v_f), 1), vandq_u16(vshrq_n_u16(a, 12), v_1)));
+        const uint8x8_t g = vmovn_u16(vorrq_u16(vshlq_n_u16(vandq_u16(vshrq_n_u16(a, 4), v_f), 1), vandq_u16(vshrq_n_u16(a, 13), v_1)));
+        const uint8x8_t b = vmovn_u16(vorrq_u16(vshlq_n_u16(vandq_u16(vshrq_n_u16(a, 8), v_f), 1), vandq_u16(vshrq_n_u16(a, 14), v_1)));
+        const uint16x8_t r16 = vmovl_u8(r), g16 = vmovl_u8(g), b16 = vmovl_u8(b);
+
+        // Blargg filter: raw components plus the shadow flag
+        const uint16x8_t blargg = vorrq_u16(vorrq_u16(vshlq_n_u16(r16, 10), vshlq_n_u16(g16, 5)), b16);
+        vst1q_u16(&rgb_blargg[i], blargg);
+        vst1q_u16(&rgb_blargg[i + S16_PALETTE_ENTRIES], vorrq_u16(blargg, vdupq_n_u16(0x8000)));
+
+        // RGB1555
+        const uint16x8_t sr = vmovl_u8(vtbl4_u8(t_rgb5, r)), sg = vmovl_u8(vtbl4_u8(t_rgb5, g)), sb = vmovl_u8(vtbl4_u8(t_rgb5, b));
+        vst1q_u16(&s16_rgb555[i], vorrq_u16(vorrq_u16(vshlq_n_u16(sr, 11), vshlq_n_u16(sg, 6)),
+                                            vorrq_u16(vshlq_n_u16(sb, 1), v_1)));
+        const uint16x8_t hr = vmovl_u8(vtbl4_u8(t_sh5, r)), hg = vmovl_u8(vtbl4_u8(t_sh5, g)), hb = vmovl_u8(vtbl4_u8(t_sh5, b));
+        vst1q_u16(&s16_rgb555[i + S16_PALETTE_ENTRIES], vorrq_u16(vorrq_u16(vshlq_n_u16(hr, 1), vshlq_n_u16(hg, 6)),
+                                                                  vorrq_u16(vshlq_n_u16(hb, 11), v_1)));
+
+        // DAC levels, for the GPU
+        uint8x8x4_t c;
+        c.val[3] = vdup_n_u8(0xFF);
+        c.val[0] = vtbl4_u8(t_rgb, r); c.val[1] = vtbl4_u8(t_rgb, g); c.val[2] = vtbl4_u8(t_rgb, b);
+        vst4_u8(s16_rgba8[i], c);
+        c.val[0] = vtbl4_u8(t_sh, r);  c.val[1] = vtbl4_u8(t_sh, g);  c.val[2] = vtbl4_u8(t_sh, b);
+        vst4_u8(s16_rgba8[i + S16_PALETTE_ENTRIES], c);
+    }
+#else
+    const __m128i t_rgb_lo = _mm_loadu_si128((const __m128i*)lut_rgb),         t_rgb_hi = _mm_loadu_si128((const __m128i*)(lut_rgb + 16));
+    const __m128i t_rgb5_lo = _mm_loadu_si128((const __m128i*)lut_rgb_5bit),   t_rgb5_hi = _mm_loadu_si128((const __m128i*)(lut_rgb_5bit + 16));
+    const __m128i t_sh_lo = _mm_loadu_si128((const __m128i*)lut_shadow),       t_sh_hi = _mm_loadu_si128((const __m128i*)(lut_shadow + 16));
+    const __m128i t_sh5_lo = _mm_loadu_si128((const __m128i*)lut_shadow_5bit), t_sh5_hi = _mm_loadu_si128((const __m128i*)(lut_shadow_5bit + 16));
+    const __m128i v_f    = _mm_set1_epi16(0xF);
+    const __m128i v_1    = _mm_set1_epi16(1);
+    const __m128i v_zero = _mm_setzero_si128();
+    const __m128i v_bswap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+
+    for (; i + 8 <= end; i += 8) {
+        // big-endian RRRR GGGG BBBB words, with the low bit of each component in bits 12-14
+        const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(palette + i * 2)), v_bswap);
+        const __m128i r16 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(a, v_f), 1), _mm_and_si128(_mm_srli_epi16(a, 12), v_1));
+        const __m128i g16 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(a, 4), v_f), 1), _mm_and_si128(_mm_srli_epi16(a, 13), v_1));
+        const __m128i b16 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(a, 8), v_f), 1), _mm_and_si128(_mm_srli_epi16(a, 14), v_1));
+        // component indices as bytes (lanes 0-7)
+        const __m128i r = _mm_packus_epi16(r16, v_zero), g = _mm_packus_epi16(g16, v_zero), b = _mm_packus_epi16(b16, v_zero);
+
+        // Blargg filter: raw components plus the shadow flag
+        const __m128i blargg = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r16, 10), _mm_slli_epi16(g16, 5)), b16);
+        _mm_storeu_si128((__m128i*)&rgb_blargg[i], blargg);
+        _mm_storeu_si128((__m128i*)&rgb_blargg[i + S16_PALETTE_ENTRIES], _mm_or_si128(blargg, _mm_set1_epi16(short(0x8000))));
+
+        // RGB1555
+        const __m128i sr = _mm_unpacklo_epi8(lookup32(t_rgb5_lo, t_rgb5_hi, r), v_zero);
+        const __m128i sg = _mm_unpacklo_epi8(lookup32(t_rgb5_lo, t_rgb5_hi, g), v_zero);
+        const __m128i sb = _mm_unpacklo_epi8(lookup32(t_rgb5_lo, t_rgb5_hi, b), v_zero);
+        _mm_storeu_si128((__m128i*)&s16_rgb555[i], _mm_or_si128(_mm_or_si128(_mm_slli_epi16(sr, 11), _mm_slli_epi16(sg, 6)),
+                                                                _mm_or_si128(_mm_slli_epi16(sb, 1), v_1)));
+        const __m128i hr = _mm_unpacklo_epi8(lookup32(t_sh5_lo, t_sh5_hi, r), v_zero);
+        const __m128i hg = _mm_unpacklo_epi8(lookup32(t_sh5_lo, t_sh5_hi, g), v_zero);
+        const __m128i hb = _mm_unpacklo_epi8(lookup32(t_sh5_lo, t_sh5_hi, b), v_zero);
+        _mm_storeu_si128((__m128i*)&s16_rgb555[i + S16_PALETTE_ENTRIES], _mm_or_si128(_mm_or_si128(_mm_slli_epi16(hr, 1), _mm_slli_epi16(hg, 6)),
+                                                                                      _mm_or_si128(_mm_slli_epi16(hb, 11), v_1)));
+
+        // DAC levels, for the GPU
+        store_rgba8(&s16_rgba8[i], lookup32(t_rgb_lo, t_rgb_hi, r), lookup32(t_rgb_lo, t_rgb_hi, g), lookup32(t_rgb_lo, t_rgb_hi, b));
+        store_rgba8(&s16_rgba8[i + S16_PALETTE_ENTRIES],
+                    lookup32(t_sh_lo, t_sh_hi, r), lookup32(t_sh_lo, t_sh_hi, g), lookup32(t_sh_lo, t_sh_hi, b));
+    }
+#endif
+#endif
+
+    // the remainder (or all, without SIMD) one at a time
+    for (; i < end; i++) {
+        const uint16_t a = uint16_t((palette[i * 2] << 8) | palette[i * 2 + 1]);
+        convert_palette(i << 1,
+                        ((a & 0xF) << 1)        | ((a >> 12) & 1),
+                        (((a >> 4) & 0xF) << 1) | ((a >> 13) & 1),
+                        (((a >> 8) & 0xF) << 1) | ((a >> 14) & 1));
+    }
+
+    mark_palette_rows(first, end);
 }
 
 
@@ -8,6 +8,7 @@
 
 #include <cstdint>
 #include <cstddef> // For std::size_t
+#include <atomic>
 constexpr std::size_t ALIGNMENT = 16; // 16 for SSE, 32 for AVX
 constexpr std::size_t LOOKUP_SIZE = (32 * 32 * 32 * 2); // 32 colours per channel plus shadow bit
 
@@ -16,6 +17,7 @@ class RenderBase
 {
 public:
     RenderBase();
+    virtual ~RenderBase() = default;
 
     virtual bool init(int src_width, int src_height,
                       int scale,
@@ -25,12 +27,27 @@ public:
     virtual void disable()                    = 0;
     virtual bool start_frame()                = 0;
     virtual bool finalize_frame()             = 0;
-    virtual void draw_frame(uint16_t* pixels, int fastpass) = 0;
+    virtual void draw_frame(uint16_t* pixels, int band, int bands) = 0;
     void convert_palette(uint32_t adr, uint32_t r1, uint32_t g1, uint32_t b1);
+    // Convert S16 palette entries first to end-1 from palette RAM (big-endian words)
+    void convert_palette_range(const uint8_t* palette, int first, int end);
     void set_shadow_intensity(float f);
     void init_palette(int red_curve, int green_curve, int blue_curve);
     virtual bool supports_window() { return true; }
     virtual bool supports_vsync() { return false; }
+    // Send one band of the frame just drawn by draw_frame() to the display ahead of
+    // finalize_frame(), which then shows that frame instead of the previous one.
+    virtual void upload_frame(int band, int bands) {}
+    // Frames are presented from a different thread to the one drawing them (see main_loop),
+    // so swap_buffers() must not touch the GPU.
+    virtual void set_threaded_present(bool on) {}
+    // High refresh displays: show the last frame again (or black) at a refresh between game
+    // frames, without uploading anything. False if the renderer can't.
+    virtual bool repeat_frame(bool black) { return false; }
+    // The next frame is the same as the last one drawn, so won't be drawn: keep showing the
+    // last, and take nothing new at the next swap_buffers(). False if the renderer can't (or its
+    // output settings have changed since), in which case the frame is drawn as usual.
+    virtual bool hold_frame() { return false; }
 
     // S16 video hardware ladder DAC values
     alignas(ALIGNMENT) uint32_t rgb_lookup[LOOKUP_SIZE];
@@ -43,6 +60,13 @@ protected:
     alignas(ALIGNMENT) uint16_t s16_rgb555[S16_PALETTE_ENTRIES * 2];
     // This palette avoids re-calculating for the Blargg filter for every pixel
     alignas(ALIGNMENT) uint16_t rgb_blargg[S16_PALETTE_ENTRIES * 2];
+    // S16 DAC output levels as R,G,B,A bytes, for palette lookup on the GPU
+    alignas(ALIGNMENT) uint8_t s16_rgba8[S16_PALETTE_ENTRIES * 2][4];
+    // Rows of 256 s16_rgba8 entries changed since they were last uploaded, one bit per row
+    // (bits 16-31 being the shadow colours)
+    static const int PALETTE_ROW_ENTRIES = 256;
+    std::atomic<uint32_t> palette_dirty_rows{~0u};
+    void mark_palette_rows(int first, int end);
 
     uint32_t *screen_pixels;
 
@@ -0,0 +1,227 @@
+/**********************************************************************************
+    Linux Framebuffer Rendering.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+
+***********************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "renderfb.hpp"
+#include "frontend/config.hpp"
+#include "frametrace.hpp"
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/fb.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#endif
+
+RenderFB::RenderFB()
+{
+}
+
+RenderFB::~RenderFB()
+{
+    disable();
+}
+
+#ifdef __linux__
+
+bool RenderFB::init(int source_width, int source_height,
+                    int source_scale, int video_mode_requested, int scanlines_requested)
+{
+    src_width  = source_width;
+    src_height = source_height;
+    video_mode = video_mode_requested;
+    scanlines  = scanlines_requested;
+
+    const std::string& device = config.video.fb_device;
+    fd = ::open(device.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Unable to open framebuffer " << device << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct fb_var_screeninfo var;
+    struct fb_fix_screeninfo fix;
+    if (ioctl(fd, FBIOGET_VSCREENINFO, &var) != 0 || ioctl(fd, FBIOGET_FSCREENINFO, &fix) != 0) {
+        std::cerr << "Unable to read framebuffer mode: " << std::strerror(errno) << std::endl;
+        disable();
+        return false;
+    }
+    if ((var.bits_per_pixel != 16 && var.bits_per_pixel != 32) || fix.type != FB_TYPE_PACKED_PIXELS) {
+        std::cerr << "Framebuffer format not supported (" << var.bits_per_pixel << " bpp); 16 or 32 bpp needed" << std::endl;
+        disable();
+        return false;
+    }
+
+    fb_bytes_pp = var.bits_per_pixel / 8;
+    fb_stride   = fix.line_length;
+    fb_size     = size_t(fix.line_length) * var.yres_virtual;
+    void* p = mmap(nullptr, fb_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        std::cerr << "Unable to map framebuffer: " << std::strerror(errno) << std::endl;
+        disable();
+        return false;
+    }
+    fb_map = static_cast<uint8_t*>(p);
+    fb     = fb_map + size_t(var.yoffset) * fb_stride + size_t(var.xoffset) * fb_bytes_pp;
+
+    // framebuffer channel layout, e.g. RGB565 or XRGB8888
+    r_shift = uint8_t(8 - std::min(8u, var.red.length));
+    g_shift = uint8_t(8 - std::min(8u, var.green.length));
+    b_shift = uint8_t(8 - std::min(8u, var.blue.length));
+    r_off   = uint8_t(var.red.offset);
+    g_off   = uint8_t(var.green.offset);
+    b_off   = uint8_t(var.blue.offset);
+    // each channel without its top bit, once shifted down by one
+    const uint32_t r_mask = ((1u << (8 - r_shift)) - 1) << r_off;
+    const uint32_t g_mask = ((1u << (8 - g_shift)) - 1) << g_off;
+    const uint32_t b_mask = ((1u << (8 - b_shift)) - 1) << b_off;
+    half_mask = ((r_mask >> 1) & r_mask) | ((g_mask >> 1) & g_mask) | ((b_mask >> 1) & b_mask);
+
+    // largest whole-number scale that fits, no larger than asked for in window mode
+    scn_width  = int(var.xres);
+    scn_height = int(var.yres);
+    out_scale  = std::max(1, std::min(scn_width / src_width, scn_height / src_height));
+    if (video_mode == video_settings_t::MODE_WINDOW)
+        out_scale = std::clamp(source_scale, 1, out_scale);
+    dst_width  = src_width * out_scale;
+    dst_height = src_height * out_scale;
+    out_x      = std::max(0, (scn_width - dst_width) / 2) + config.video.x_offset;
+    out_y      = std::max(0, (scn_height - dst_height) / 2) + config.video.y_offset;
+    out_x      = std::clamp(out_x, 0, std::max(0, scn_width - dst_width));
+    out_y      = std::clamp(out_y, 0, std::max(0, scn_height - dst_height));
+
+    for (auto& f : frames)
+        f.assign(size_t(src_width) * src_height, 0);
+    line.assign(size_t(dst_width) * fb_bytes_pp, 0);
+    draw_frame_index = 0;
+    show_frame_index = 1;
+    ready_frame.store(2, std::memory_order_relaxed);
+
+    // clear the borders
+    for (int y = 0; y < scn_height; y++)
+        std::memset(fb + size_t(y) * fb_stride, 0, size_t(scn_width) * fb_bytes_pp);
+
+    int arg = 0;
+    can_wait_vsync = ioctl(fd, FBIO_WAITFORVSYNC, &arg) == 0;
+
+    std::cout << "Framebuffer " << device << ": " << scn_width << "x" << scn_height << " at "
+              << var.bits_per_pixel << " bpp, game image x" << out_scale
+              << (can_wait_vsync ? ", vsync" : ", no vsync") << std::endl;
+    return true;
+}
+
+void RenderFB::disable()
+{
+    if (fb_map) {
+        munmap(fb_map, fb_size);
+        fb_map = nullptr;
+        fb     = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    for (auto& f : frames)
+        std::vector<uint32_t>().swap(f);
+}
+
+bool RenderFB::finalize_frame()
+{
+    if (!fb) return true;
+
+    // wait as a buffer swap would, even if there is nothing new to show
+    if (config.video.vsync && can_wait_vsync) {
+        int arg = 0;
+        ioctl(fd, FBIO_WAITFORVSYNC, &arg);
+    }
+
+    // only a frame not yet shown is copied
+    if (!(ready_frame.load(std::memory_order_acquire) & FRESH))
+        return true;
+    show_frame_index = ready_frame.exchange(show_frame_index, std::memory_order_acq_rel) & (FRESH - 1);
+
+    frametrace::Scope trace(frametrace::UPLOAD);
+    const uint32_t* src = frames[show_frame_index].data();
+    const bool dim = scanlines != 0 && out_scale >= 2;
+    for (int y = 0; y < src_height; y++)
+        write_line(src + size_t(y) * src_width, y, dim);
+    return true;
+}
+
+#else
+
+bool RenderFB::init(int, int, int, int, int)
+{
+    std::cerr << "The framebuffer renderer is only available on Linux" << std::endl;
+    return false;
+}
+
+void RenderFB::disable() {}
+bool RenderFB::finalize_frame() { return true; }
+
+#endif
+
+// One game line to out_scale framebuffer lines; the last of them dimmed for scanlines
+void RenderFB::write_line(const uint32_t* src, int y, bool dim)
+{
+    uint8_t* out = line.data();
+    if (fb_bytes_pp == 2) {
+        uint16_t* o = reinterpret_cast<uint16_t*>(out);
+        for (int x = 0; x < src_width; x++)
+            for (int s = 0; s < out_scale; s++)
+                *o++ = uint16_t(src[x]);
+    } else {
+        uint32_t* o = reinterpret_cast<uint32_t*>(out);
+        for (int x = 0; x < src_width; x++)
+            for (int s = 0; s < out_scale; s++)
+                *o++ = src[x];
+    }
+
+    const size_t bytes = size_t(dst_width) * fb_bytes_pp;
+    uint8_t* dst = fb + size_t(out_y + y * out_scale) * fb_stride + size_t(out_x) * fb_bytes_pp;
+    const int full = dim ? out_scale - 1 : out_scale;
+    for (int s = 0; s < full; s++, dst += fb_stride)
+        std::memcpy(dst, out, bytes);
+
+    if (dim) {
+        if (fb_bytes_pp == 2) {
+            uint16_t* o = reinterpret_cast<uint16_t*>(out);
+            for (int x = 0; x < dst_width; x++)
+                o[x] = uint16_t((o[x] >> 1) & half_mask);
+        } else {
+            uint32_t* o = reinterpret_cast<uint32_t*>(out);
+            for (int x = 0; x < dst_width; x++)
+                o[x] = (o[x] >> 1) & half_mask;
+        }
+        std::memcpy(dst, out, bytes);
+    }
+}
+
+void RenderFB::draw_frame(uint16_t* pixels, int band, int bands)
+{
+    if (!fb || config.videoRestartRequired) return;
+
+    bands = std::clamp(bands, 1, src_height);
+    band  = std::clamp(band, 0, bands - 1);
+    const size_t first = size_t(src_height * band / bands) * src_width;
+    const size_t end   = size_t(src_height * (band + 1) / bands) * src_width;
+
+    uint32_t* out = frames[draw_frame_index].data();
+    for (size_t i = first; i < end; i++)
+        out[i] = pack(s16_rgba8[pixels[i]]);
+}
+
+// The frame just drawn becomes the newest for finalize_frame()
+void RenderFB::swap_buffers()
+{
+    draw_frame_index = ready_frame.exchange(draw_frame_index | FRESH, std::memory_order_acq_rel) & (FRESH - 1);
+}
@@ -0,0 +1,84 @@
+/******************************************************************************
+    Linux Framebuffer Rendering.
+
+    A lean renderer for boards without a usable GPU, and for measuring what
+    the GL path costs: the game image is looked up through the palette,
+    scaled by a whole number and written straight to /dev/fb0 (or the
+    device in video.fb_device). There is no texture upload, shader or
+    overlay pass; the Blargg filter and CRT effects are not applied, though
+    scanlines are, at scale 2 and above.
+
+    Frames are drawn into one of three buffers at the game's resolution and
+    the newest is copied to the framebuffer by finalize_frame(), so drawing
+    and presenting can run on different threads. With vsync, each copy
+    waits for the display's vertical blank where the driver supports it.
+
+    Selected with video.renderer = 1 in config.xml. SDL is still used for
+    input, so give it a video driver that needs no display, e.g.
+    video.driver = offscreen.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+*******************************************************************************/
+
+#pragma once
+
+#include "renderbase.hpp"
+#include <atomic>
+#include <vector>
+
+class RenderFB : public RenderBase
+{
+public:
+    RenderFB();
+    ~RenderFB();
+
+    bool init(int src_width, int src_height,
+              int scale,
+              int video_mode,
+              int scanlines);
+    void swap_buffers();
+    void disable();
+    bool start_frame() { return fb != nullptr; }
+    bool finalize_frame();
+    void draw_frame(uint16_t* pixels, int band, int bands);
+    bool supports_window() { return false; }
+    bool supports_vsync()  { return can_wait_vsync; }
+
+private:
+    int       fd = -1;
+    uint8_t*  fb_map = nullptr;     // mapped framebuffer
+    uint8_t*  fb = nullptr;         // the visible part of it
+    size_t    fb_size = 0;
+    int       fb_bytes_pp = 0;      // 2 or 4
+    int       fb_stride = 0;        // bytes per framebuffer line
+
+    // Packing of S16 RGB bytes to the framebuffer's pixel format
+    uint8_t   r_shift, g_shift, b_shift;    // right shift of each 8-bit level
+    uint8_t   r_off, g_off, b_off;          // bit offset in the pixel
+    uint32_t  half_mask;                    // (p >> 1) & half_mask halves each channel
+
+    // Image position and size on the framebuffer
+    int       out_scale = 1;
+    int       out_x = 0, out_y = 0;
+
+    bool      can_wait_vsync = false;
+
+    // Three frames at the game's resolution, in the framebuffer's format
+    static const int FRAMES = 3;
+    static const int FRESH  = 4;    // ready_frame holds a frame not yet shown
+    std::vector<uint32_t> frames[FRAMES];
+    int                   draw_frame_index = 0;   // drawn by draw_frame()
+    int                   show_frame_index = 1;   // last copied by finalize_frame()
+    std::atomic<int>      ready_frame{2};         // newest complete frame (| FRESH)
+
+    std::vector<uint8_t>  line;     // one scaled line, assembled before copying
+
+    uint32_t pack(const uint8_t* rgba) const
+    {
+        return (uint32_t(rgba[0] >> r_shift) << r_off) |
+               (uint32_t(rgba[1] >> g_shift) << g_off) |
+               (uint32_t(rgba[2] >> b_shift) << b_off);
+    }
+    void write_line(const uint32_t* src, int y, bool dim);
+};
@@ -21,15 +21,20 @@
 #include <mutex>
 #include "rendersurface.hpp"
 #include "frontend/config.hpp"
+#include "frametrace.hpp"
+#include "jobsystem.hpp"
+#include "bootprof.hpp"
+#include "framearena.hpp"
 // Aligned Memory Allocation (standard C++17)
 #include <new>        // std::align_val_t, ::operator new/delete
 #include <cstddef>    // std::size_t
 #include <cstdint>
-#include <omp.h>
+#include <cstring>    // std::memcpy
 #include <math.h>
 #include <cmath>   // std::sqrtf, std::fabs, std::roundf, std::lroundf, etc.
 #include <SDL_opengles2.h>
 #include <array>   // for std::array
+#include <algorithm> // std::clamp
 
 #define VERTEX_SHADER        "res/Cannonball-Shader-Vertex.glsl"
 // light shader - curvature/noise/shadow-mask/vignette/brightness-boost
@@ -47,17 +52,22 @@ RenderSurface::RenderSurface()
 
 RenderSurface::~RenderSurface()
 {
+    if (blargg_build.valid())
+        free(blargg_build.get());
+    for (auto& k : blargg_kernels)
+        free(k.table);
 }
 
 bool RenderSurface::init(int source_width, int source_height,
                          int source_scale, int video_mode_requested, int scanlines_requested)
 {
-    ntsc = (snes_ntsc_t*) malloc( sizeof(snes_ntsc_t) );
     // Can only be called from the thread with the SDL context (usuablly the main thread)
     src_width  = source_width;
     src_height = source_height;
     scale      = source_scale;
     video_mode = video_mode_requested;
+    if (video_mode == video_settings_t::MODE_WINDOW && kmsdrm())
+        video_mode = video_settings_t::MODE_FULL;
 
     // Capture current settings
     blargg = config.video.blargg;
@@ -73,11 +83,21 @@ bool RenderSurface::init(int source_width, int source_height,
     std::lock_guard<std::mutex> gpulock(gpuMutex);
 
     // Initialise Blargg. Comes first as determins working image dimensions.
+    // The GPU pass, if selected, needs the same dimensions but not the CPU filter's tables.
+    gpu_ntsc    = blargg && config.video.gpu_ntsc;
+    gpu_palette = !blargg && config.video.gpu_palette;
+    blargg16    = blargg && config.video.blargg_16bit;
     last_blargg_config = get_blargg_config();
-    init_blargg_filter(); // NTSC filter (CPU based)
+    {
+        bootprof::Phase phase("blargg_tables");
+        init_blargg_filter(); // NTSC filter (CPU based)
+    }
 
     // Initialise SDL
-    if (!init_sdl(video_mode)) return false;
+    {
+        bootprof::Phase phase("window");
+        if (!init_sdl(video_mode)) return false;
+    }
 
     // Get SDL Pixel Format Information
     Rshift = GameSurface[0]->format->Ashift;
@@ -88,10 +108,17 @@ bool RenderSurface::init(int source_width, int source_height,
     Gmask = GameSurface[0]->format->Bmask;
     Bmask = GameSurface[0]->format->Gmask;
     Amask = GameSurface[0]->format->Rmask;
+    if (blargg16) {
+        // the filter still writes the RGBA8888 layout, packed to 16 bits afterwards
+        Rshift = 0;  Gshift = 8;  Bshift = 16; Ashift = 24;
+        Rmask = 0x000000FF; Gmask = 0x0000FF00; Bmask = 0x00FF0000; Amask = 0xFF000000;
+    }
 
     // call other initialisation routines
-    init_overlay();       // CRT curved edge mask (applied as a mask by GPU rendering)
-    create_buffers();     // used for working space processing image from [game output]->[blargg-filtered]->[renderer input]
+    {
+        bootprof::Phase phase("overlay");
+        init_overlay();   // CRT curved edge mask (applied as a mask by GPU rendering)
+    }
     FrameCounter = 0;
     last_config  = 0;
 
@@ -104,10 +131,135 @@ bool RenderSurface::init(int source_width, int source_height,
 
 void RenderSurface::swap_buffers()
 {
-    // swap the pixel buffers
-    std::lock_guard<std::mutex> lock(drawFrameMutex);
-    current_game_surface ^= 1;
-    GameSurfacePixels = (uint32_t*)GameSurface[current_game_surface]->pixels;
+    // swap the pixel buffers. GPU buffers are mapped and unmapped here, which needs no lock: this is
+    // the thread with the context, unless frames are presented from another thread, in which case
+    // they aren't used. The surface indices are traded with finalize_frame() by the exchange.
+    if (!begin_activity()) return;
+    if (frame_held) {
+        // nothing was drawn (see hold_frame): the last frame is still the newest, and the surface
+        // or buffer that would have been drawn is drawn next time
+        frame_held = false;
+    } else {
+        drawn_key = frame_settings;
+        current_game_surface = ready_game_surface.exchange(current_game_surface | FRAME_READY,
+                                                           std::memory_order_acq_rel) & (FRAME_READY - 1);
+
+        // The frame just drawn is the next to be uploaded. If it went to a GPU buffer, unmap that
+        // ready for the upload, and map the next one in the ring for the new frame. The CPU scanline
+        // pass reads the image back, which is slow from write-combined memory, and the low latency
+        // path uploads from GameSurface in slices, so both draw to GameSurface instead. Blargg row
+        // reuse copies rows from earlier frames, so needs those in GameSurface too.
+        buffer_ready = buffer_write;
+        buffer_shown = -1;
+        if (buffer_ready >= 0)
+            glb::unmap_game_buffer(buffer_ready);
+
+        buffer_write = -1;
+        const bool row_reuse = config.video.row_reuse && blargg && !gpu_indexed();
+        if (glb::has_game_buffers() && cpu_scanlines() == 0 && !config.video.low_latency && !threaded_present &&
+            !row_reuse) {
+            if (void* p = glb::map_game_buffer(buffer_next)) {
+                buffer_write = buffer_next;
+                buffer_next  = (buffer_next + 1) % glb::State::GAME_BUFFERS;
+                GameSurfacePixels.store(p, std::memory_order_release);
+            }
+        }
+        if (buffer_write < 0)
+            GameSurfacePixels.store(GameSurface[current_game_surface]->pixels, std::memory_order_release);
+    }
+
+    // No render bands are running now, so this is the safe point to update
+    // per-frame filter state that every band of the next frame will read
+    update_frame_controls();
+    frame_settings = output_key();
+
+    // Rows of the new frame can be copied from a surface filtered with the same settings and
+    // burst phase (see reuse_row). Whatever else the surface to be drawn held is forgotten.
+    frame_key = row_reuse_key();
+    if (row_key[current_game_surface] != frame_key) {
+        std::fill(row_hashes[current_game_surface].begin(), row_hashes[current_game_surface].end(), 0);
+        row_key[current_game_surface] = frame_key;
+    }
+    end_activity();
+}
+
+// What the CPU passes' output depends on, besides the S16 image and palette
+uint64_t RenderSurface::output_key() const
+{
+    return (uint64_t(ntsc_serial) << 32) ^ (uint64_t(uint32_t(last_blargg_config)) << 8) ^
+           (uint64_t(Alevel & 0xFF) << 40) ^ (uint64_t(cpu_scanlines() & 0xF) << 4) ^
+           (uint64_t(config.video.crt_bloom != 0) << 1) ^ uint64_t(blargg != 0);
+}
+
+// The next frame is the same as the last (see Video::hold_static_frame). It can be skipped
+// when the last frame was drawn with the settings the next would be. finalize_frame() then has
+// nothing new to upload, so shows the texture it has.
+bool RenderSurface::hold_frame()
+{
+    if (frame_settings != drawn_key || config.videoRestartRequired)
+        return false;
+    frame_held = true;
+    return true;
+}
+
+// Frame work (draw_frame, swap_buffers, finalize_frame...) runs between these, unless disable()
+// has begun. The count is raised before shutting_down is read, and disable() sets shutting_down
+// before reading the count, so either the work sees it and backs out or disable() waits for it.
+bool RenderSurface::begin_activity()
+{
+    activity_counter.fetch_add(1);
+    if (!shutting_down.load())
+        return true;
+    end_activity();
+    return false;
+}
+
+void RenderSurface::end_activity()
+{
+    // only disable() waits on the count
+    if (activity_counter.fetch_sub(1) == 1 && shutting_down.load())
+        activity_counter.notify_all();
+}
+
+// The GL context is only shared when frames are presented from another thread to the game's
+std::unique_lock<std::mutex> RenderSurface::gpu_lock()
+{
+    return threaded_present ? std::unique_lock<std::mutex>(gpuMutex)
+                            : std::unique_lock<std::mutex>(gpuMutex, std::defer_lock);
+}
+
+
+void RenderSurface::update_frame_controls()
+{
+    if (blargg) {
+        // advance the NTSC burst phase for the next frame
+        if (config.fps == 60) phase = (phase + 1) % 3; // cycle through 0/1/2
+        else                  phase = (phase + 2) % 3; // cycle through 0/1/2, but at twice the rate
+    }
+
+    if (config.videoRestartRequired) return;
+
+    // Check for any changes to the configured video settings (that don't require full SDL restart)
+    // Blargg filter settings. Changing these requires Blargg filter re-initialisation.
+    int this_blargg_config = get_blargg_config();
+    if (this_blargg_config != last_blargg_config) {
+        // Settings have been changed; capture new setting & re-initiatise the Blargg filter library
+        // The filter uses doubles internally, so we need to convert the config values to doubles.
+        last_blargg_config =  this_blargg_config;
+        blargg             =  config.video.blargg;
+        setup.saturation   =  double(config.video.saturation) / 100;
+        setup.contrast     =  double(config.video.contrast) / 100;
+        setup.brightness   =  double(config.video.brightness) / 100;
+        setup.sharpness    =  double(config.video.sharpness) / 100;
+        setup.resolution   =  double(config.video.resolution) / 100;
+        setup.gamma        =  double(config.video.gamma) / 10;
+        setup.hue          =  double(config.video.hue) / 100;
+        init_blargg_filter(false);
+    }
+
+    // switch to a filter table finished in the background
+    if (blargg_kernel_pending)
+        blargg_kernel_pending = !select_blargg_kernel(false);
 }
 
 
@@ -115,10 +267,10 @@ void RenderSurface::disable()
 {
     // Can only be called from the thread with the SDL context (usuablly the main thread)
     // awaiting threads
-    shutting_down.store(true, std::memory_order_release);
-    std::lock_guard<std::mutex> guard(drawFrameMutex);
-    std::unique_lock<std::mutex> lock(mtx);
-    cv.wait(lock, [&] { return activity_counter.load(std::memory_order_acquire) == 0; });
+    // to finish the frame work under way, and start no more (see begin_activity)
+    shutting_down.store(true);
+    for (int n; (n = activity_counter.load()) != 0; )
+        activity_counter.wait(n);
 
     // ensure we have exclusive access to the SDL context
     std::lock_guard<std::mutex> gpulock(gpuMutex);
@@ -132,47 +284,21 @@ void RenderSurface::disable()
     if (window) { SDL_DestroyWindow(window); window = nullptr; }
 
     // Free the CPU surfaces.
-    if (GameSurface[0]) { SDL_FreeSurface(GameSurface[0]); GameSurface[0] = nullptr; }
-    if (GameSurface[1]) { SDL_FreeSurface(GameSurface[1]); GameSurface[1] = nullptr; }
+    for (auto& surface : GameSurface)
+        if (surface) { SDL_FreeSurface(surface); surface = nullptr; }
 
-    // Release any additional buffers.
-    destroy_buffers();
-    free(ntsc);
+    save_overlay_cache();
 
     initialised = false;
 }
 
 
-void RenderSurface::create_buffers() {
-    uint32_t pixels;
-	uint16_t* t32p;
-
-    // keep 64-byte alignment for SIMD/cache friendliness
-    constexpr std::size_t alignment = CB_PIXEL_ALIGNMENT;
-
-    // allocates pixel buffers
-    pixels = src_width * src_height;
-    std::size_t size = pixels *sizeof(uint16_t);
-
-    rgb_pixels = static_cast<uint16_t*>(::operator new(size, std::align_val_t(alignment)));
-    t32p = rgb_pixels;
-
-	while (pixels--) *(t32p++) = 0x0000; // fill with black
-}
-
-void RenderSurface::destroy_buffers() {
-    // deallocates the pixel buffers
-    if (rgb_pixels) {
-        ::operator delete(rgb_pixels, std::align_val_t(CB_PIXEL_ALIGNMENT));
-    }
-    rgb_pixels = nullptr;
-}
-
-void RenderSurface::init_blargg_filter()
+void RenderSurface::init_blargg_filter(bool wait)
 {
     // Initialises the Blargg NTSC filter effects. This configures the output (s-video/rgb etc) and
     // also pre-calculates the pixel mapping (which is slow), so the shader then runs on a lookup basis
-    // in the game (fast).
+    // in the game (fast). Unless wait is set, a mapping not already cached is calculated in the
+    // background, the current one being used meanwhile.
     if (blargg) {
         // first calculate the resultant image size.
         if (config.video.hires) {
@@ -216,7 +342,8 @@ void RenderSurface::init_blargg_filter()
         setup.gamma = double(config.video.gamma) / 10;
         setup.resolution = double(config.video.resolution) / 100;
 
-        snes_ntsc_init(ntsc, &setup); // configure the library
+        if (!gpu_ntsc)
+            blargg_kernel_pending = !select_blargg_kernel(wait); // configure the library
     }
     else snes_src_width = src_width; // provides constraint to buffer allocation
 }
@@ -297,6 +424,19 @@ void RenderSurface::set_scaling()
 // SDL Initialisation
 // ----------------------------------------------------------------------------------
 
+// SDL is drawing straight to the display through DRM/KMS (see video.driver in config.xml)
+bool RenderSurface::kmsdrm()
+{
+    const char* driver = SDL_GetCurrentVideoDriver();
+    return driver && SDL_strcasecmp(driver, "kmsdrm") == 0;
+}
+
+// Under KMSDRM there is no desktop to show a window on
+bool RenderSurface::supports_window()
+{
+    return !kmsdrm();
+}
+
 bool RenderSurface::init_sdl(int video_mode)
 {
     // First, determine our source and destination dimensions.
@@ -317,11 +457,12 @@ bool RenderSurface::init_sdl(int video_mode)
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER,            1);
 
     // Create a window manually so that it can be closed on video restart (e.g. Blargg on/off)
-    // Now create our window (with an OpenGL flag)
+    // Now create our window (with an OpenGL flag). On KMSDRM the window is the display plane,
+    // so it is created full-screen at the current mode, rather than switched afterwards.
 
     window = SDL_CreateWindow("Cannonball",
         SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        scn_width, scn_height, SDL_WINDOW_OPENGL);
+        scn_width, scn_height, SDL_WINDOW_OPENGL | (kmsdrm() ? SDL_WINDOW_FULLSCREEN : 0));
 
     if (!window) {
         std::cerr << "Window creation failed: " << SDL_GetError() << std::endl;
@@ -336,7 +477,8 @@ bool RenderSurface::init_sdl(int video_mode)
     }
 
     // go true fullscreen (desktop resolution)
-    SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN_DESKTOP);
+    if (!kmsdrm())
+        SDL_SetWindowFullscreen(window, SDL_WINDOW_FULLSCREEN_DESKTOP);
     // then fix the GL viewport to the new backbuffer size
     glb::on_drawable_resized();
 
@@ -359,18 +501,39 @@ bool RenderSurface::init_sdl(int video_mode)
             return false;
         }
     }
+    // Linked shaders are cached next to the config file, where the driver allows
+    if (config.video.shader_cache) {
+        const std::string& cfg_file = config.data.cfg_file;
+        const size_t slash = cfg_file.find_last_of("/\\");
+        glb::set_program_cache((slash == std::string::npos ? std::string() : cfg_file.substr(0, slash + 1)) +
+                               "shader_cache_");
+    } else {
+        glb::set_program_cache(std::string());
+    }
+
+    // The CRT shader can run at a fraction of the output size, then be upscaled (for weak GPUs)
+    const int shader_scale = std::clamp(config.video.shader_scale, 25, 100);
+    int offscreen_w = 0, offscreen_h = 0;
+    if (config.video.shader_mode != 0 && shader_scale < 100) {
+        offscreen_w = std::max(1, (dst_rect.w * shader_scale) / 100);
+        offscreen_h = std::max(1, (dst_rect.h * shader_scale) / 100);
+    }
+
     // Initialize GL backend
-    if (blargg)
+    if (blargg && !blargg16)
         glb::set_game_pixel_format(glb::State::PixFmt::RGBA);
     else
         glb::set_game_pixel_format(glb::State::PixFmt::RGB555);
 
-    if (!glb::init(window,
+    bootprof::Phase shaders_phase("gl_and_shaders");
+    const bool gl_ok = glb::init(window,
                    /*gameW*/    src_rect.w, /*gameH*/    src_rect.h,
                    /*overlayW*/ dst_rect.w, /*overlayH*/ dst_rect.h,
                    vs.empty() ? nullptr : vs.c_str(),
                    fs.empty() ? nullptr : fs.c_str(),
-                   /*createOffscreen=*/false)) {
+                   /*createOffscreen=*/offscreen_w > 0, offscreen_w, offscreen_h);
+    shaders_phase.end();
+    if (!gl_ok) {
         std::cerr << "gl_backend init failed.\n";
         return false;
     }
@@ -378,32 +541,75 @@ bool RenderSurface::init_sdl(int video_mode)
     Uint32 window_format = SDL_GetWindowPixelFormat(window);
     printf("Window Pixel Format: %s (0x%08X)\n", SDL_GetPixelFormatName(window_format), window_format);
 
+    // GPU NTSC filter pass, if selected. Falls back to the CPU filter.
+    if (gpu_ntsc) {
+        gpu_ntsc = glb::init_ntsc(src_width, src_height, src_rect.w, S16_PALETTE_ENTRIES * 2, config.video.hires != 0);
+        if (gpu_ntsc) {
+            std::cout << "INFO: Using GPU NTSC filter.\n";
+        } else {
+            std::cerr << "GPU NTSC filter unavailable; using CPU filter.\n";
+            blargg_kernel_pending = !select_blargg_kernel(true);
+        }
+    }
+    if (!gpu_ntsc && config.video.blargg)
+        std::cout << "INFO: CPU NTSC filter using " << snes_ntsc_simd_path() << " kernel.\n";
+
+    // GPU palette lookup, if selected. Falls back to the CPU lookup.
+    if (gpu_palette) {
+        gpu_palette = glb::init_palette_lookup(src_width, src_height, S16_PALETTE_ENTRIES * 2);
+        if (gpu_palette)
+            std::cout << "INFO: Using GPU palette lookup.\n";
+        else
+            std::cerr << "GPU palette lookup unavailable; using CPU lookup.\n";
+    }
+    palette_dirty_rows.store(~0u, std::memory_order_release);
+    last_index_config = -1;
+    last_mask_config  = -1;
+
     //--------------------------------------------------------
     // Create CPU surfaces for the game image.
     //--------------------------------------------------------
 
-    // Double-buffered game surfaces
-    auto pix_format = (blargg) ? SDL_PIXELFORMAT_RGBA8888 : SDL_PIXELFORMAT_RGB555;
-    int  bpp        = (blargg) ? 32 : 16;
-    GameSurface[0] = SDL_CreateRGBSurfaceWithFormat(0, src_rect.w, src_rect.h, bpp, pix_format);
-    GameSurface[1] = SDL_CreateRGBSurfaceWithFormat(0, src_rect.w, src_rect.h, bpp, pix_format);
-    if (!GameSurface[0] || !GameSurface[1]) {
-        std::cerr << "SDL Surface creation failed: " << SDL_GetError() << std::endl;
-        return false;
+    // Triple-buffered game surfaces. For the GPU passes these hold the S16 palette indices.
+    // Their pixels are in the frame buffer arena (freed with it, by Video::disable), with SDL's
+    // own row pitch.
+    auto pix_format = (blargg && !gpu_ntsc && !blargg16) ? SDL_PIXELFORMAT_RGBA8888 : SDL_PIXELFORMAT_RGB555;
+    int  bpp        = (blargg && !gpu_ntsc && !blargg16) ? 32 : 16;
+    int  surface_w  = gpu_indexed() ? src_width : src_rect.w;
+    int  pitch      = (surface_w * (bpp / 8) + 3) & ~3;
+    for (auto& surface : GameSurface) {
+        void* pixels = framearena::alloc(size_t(pitch) * src_rect.h);
+        surface = SDL_CreateRGBSurfaceWithFormatFrom(pixels, surface_w, src_rect.h, bpp, pitch, pix_format);
+        if (!surface) {
+            std::cerr << "SDL Surface creation failed: " << SDL_GetError() << std::endl;
+            return false;
+        }
     }
-    current_game_surface = 0;
-    if (blargg) {
-        GameSurfacePixels = static_cast<uint32_t*>(GameSurface[current_game_surface]->pixels);
-    } else {
-        GameSurfacePixels = static_cast<uint16_t*>(GameSurface[current_game_surface]->pixels);
+    for (int i = 0; i < GAME_SURFACES; i++) {
+        row_hashes[i].assign(src_rect.h, 0);
+        row_key[i] = 0;
     }
+    frame_key = 0;
+    current_game_surface = 0;
+    ready_game_surface.store(1, std::memory_order_relaxed);
+    shown_game_surface   = 2;
+    GameSurfacePixels.store(GameSurface[current_game_surface]->pixels, std::memory_order_release);
 
-    glb::set_swap_interval(config.video.vsync);
+    // VRR: the display follows the frames, so each is presented as soon as it is drawn
+    glb::set_swap_interval(config.video.vrr ? 0 : config.video.vsync);
     //glb::auto_configure_pixel_formats_from_surfaces(GameSurface[0], overlaySurface);
 
+    // GPU pixel buffers for the game image, where the context supports them (see swap_buffers)
+    buffer_write = buffer_ready = buffer_shown = -1;
+    buffer_next  = 0;
+    texture_loaded = frame_held = false;
+    drawn_key    = ~uint64_t(0);
+    if (!gpu_indexed() && glb::init_game_buffers(GameSurface[0]->pitch, src_rect.h))
+        std::cout << "INFO: Using GPU pixel buffers for game image upload.\n";
+
     Uint32 black_color = SDL_MapRGBA(GameSurface[0]->format, 0, 0, 0, 0);
-    SDL_FillRect(GameSurface[0], NULL, black_color);
-    SDL_FillRect(GameSurface[1], NULL, black_color);
+    for (auto surface : GameSurface)
+        SDL_FillRect(surface, NULL, black_color);
 
     // screen_pixels = static_cast<uint32_t*>(surface->pixels);
     return true;
@@ -531,7 +737,7 @@ void RenderSurface::init_overlay()
     // This function builds out the mask as an ALPHA8 blend mask (FF=transparent, 0=black).
     // This is called by init(), all also by draw_frame() if the user has changed a setting.
     // Texture dimensions must be previously defined (by init_textures)
-    // This function is computationally expensive.
+    // This function is computationally expensive, unless the shader draws the mask (overlay_gpu).
 
     // Check if overlay is disabled. This sets the overlay in the shader to a 1:1 white
     // which reduces RAM bandwidth required e.g. for Pi2.
@@ -545,49 +751,73 @@ void RenderSurface::init_overlay()
                            config.video.warpX +
                            config.video.warpY;
 
-    // create buffer. Fill is 0xFF (clear)
+    // vignette and shape
+    const uint32_t vignette_target = int((float(config.video.vignette) * 255.0 / 100.0));
+    const float midx = float(dst_rect.w >> 1);
+    const float midy = float(dst_rect.h >> 1);
+    const float dia = sqrt(((midx * midx) + (midy * midy)));
+    const float outer = dia * 1.00;
+    const float outer2 = outer * outer;
+    const float inner = dia * 0.30;
+    const float inner2 = inner * inner;
+    const float outer_less_inner2 = ((outer - inner) * (outer - inner));
+    const float total_black = 0.0;
+
+    // Blacked-out corners and top/bottom fade and curved edges
+    const float corner_radius = 0.02 * dia;    // this is the radius of the rounded corner
+    const float edge_radius = 0.01 * dia;      // this amount will be faded to black, creating a smooth edge to the curve
+    const float edge_radius2 = edge_radius * edge_radius;
+    const float crt_curve_radius_x = dia * 12.0 * float(16-config.video.warpX) / 16.0;
+    const float crt_curve_radius_x2 = crt_curve_radius_x * crt_curve_radius_x;
+    const float crt_curve_radius_y = dia * 18.0 * float(18-config.video.warpY) / 18.0;
+    const float crt_curve_radius_y2 = crt_curve_radius_y * crt_curve_radius_y;
+    float corner_x = 0;
+    float corner_y = 0;
+
+    // calculate intersection of CRT curves at top left
+    float x_intersection, y_intersection;
+    find_circle_intersection(crt_curve_radius_x, midy, crt_curve_radius_x,
+        midx, crt_curve_radius_y, crt_curve_radius_y, &x_intersection, &y_intersection);
+
+    // calculate intersetion of curves at top left less edge and corner radius,
+    // this will be the centre of the corner curve if configured
+    find_circle_intersection(crt_curve_radius_x, midy, (crt_curve_radius_x - edge_radius - corner_radius),
+        midx, crt_curve_radius_y, (crt_curve_radius_y - edge_radius - corner_radius), &corner_x, &corner_y);
+
+    int x_intersect = int(x_intersection);
+    int y_intersect = int(y_intersection);
+
+    // Worked out per pixel in the shader, where the GPU can: a setting change is then only new
+    // uniforms, and there's no overlay texture to build, hold or read
+    if (config.video.overlay_gpu) {
+        const float values[4][4] = {
+            { float(dst_rect.w), float(dst_rect.h), edge_radius, corner_radius },
+            { crt_curve_radius_x, crt_curve_radius_y, x_intersect + edge_radius, y_intersect + edge_radius },
+            { corner_x, corner_y, ((corner_x > 1.0) && (corner_y > 1.0)) ? 1.0f : 0.0f,
+              (config.video.shader_mode < 2) ? float(config.video.vignette) / 100.0f : 0.0f },
+            { inner, outer, midx, midy },
+        };
+        if (glb::set_edge_mask(values)) {
+            last_vignette         = config.video.vignette;
+            last_crt_shape_config = crt_shape_config;
+            overlay_shown         = OverlayKey{};   // nothing for the disk cache
+            return;
+        }
+        static bool warned = false;
+        if (!warned)
+            std::cerr << "CRT overlay: the GPU can't work the mask out in the shader; building it on the CPU.\n";
+        warned = true;
+    }
+
+    // reuse the mask if it has been built before; otherwise create buffer. Fill is 0xFF (clear)
 	int pixels = dst_rect.w * dst_rect.h;
-    std::vector<uint8_t> a8(pixels, 0xFF);
-
-    if (1) {
-        // vignette and shape
-        const uint32_t vignette_target = int((float(config.video.vignette) * 255.0 / 100.0));
-        const float midx = float(dst_rect.w >> 1);
-        const float midy = float(dst_rect.h >> 1);
-        const float dia = sqrt(((midx * midx) + (midy * midy)));
-        const float outer = dia * 1.00;
-        const float outer2 = outer * outer;
-        const float inner = dia * 0.30;
-        const float inner2 = inner * inner;
-        const float outer_less_inner2 = ((outer - inner) * (outer - inner));
-        const float total_black = 0.0;
-
-        // Blacked-out corners and top/bottom fade and curved edges
-        const float corner_radius = 0.02 * dia;    // this is the radius of the rounded corner
-        const float edge_radius = 0.01 * dia;      // this amount will be faded to black, creating a smooth edge to the curve
-        const float edge_radius2 = edge_radius * edge_radius;
-        const float crt_curve_radius_x = dia * 12.0 * float(16-config.video.warpX) / 16.0;
-        const float crt_curve_radius_x2 = crt_curve_radius_x * crt_curve_radius_x;
-        const float crt_curve_radius_y = dia * 18.0 * float(18-config.video.warpY) / 18.0;
-        const float crt_curve_radius_y2 = crt_curve_radius_y * crt_curve_radius_y;
-        float corner_x = 0;
-        float corner_y = 0;
-
-        // calculate intersection of CRT curves at top left
-        float x_intersection, y_intersection;
-        find_circle_intersection(crt_curve_radius_x, midy, crt_curve_radius_x,
-            midx, crt_curve_radius_y, crt_curve_radius_y, &x_intersection, &y_intersection);
-
-        // calculate intersetion of curves at top left less edge and corner radius,
-        // this will be the centre of the corner curve if configured
-        find_circle_intersection(crt_curve_radius_x, midy, (crt_curve_radius_x - edge_radius - corner_radius),
-            midx, crt_curve_radius_y, (crt_curve_radius_y - edge_radius - corner_radius), &corner_x, &corner_y);
-
-        int x_intersect = int(x_intersection);
-        int y_intersect = int(y_intersection);
-
-        if (!initialised || (last_crt_shape_config != crt_shape_config)) {
-            // build LUTs
+    std::vector<uint8_t> a8;
+
+    if (!find_overlay(a8)) {
+        a8.assign(pixels, 0xFF);
+
+        {
+            // build LUTs (cheap compared to the mask itself)
             int span_w = (dst_rect.w >> 1) + 1;
             int span_h = (dst_rect.h >> 1) + 1;
             dx1.resize(span_w+1); dx2.resize(span_w+1); dx3.resize(span_w+1); dx4.resize(span_w+1); dx5.resize(span_w+1);
@@ -609,138 +839,140 @@ void RenderSurface::init_overlay()
         }
 
         // calculate the mask values
-#pragma omp parallel for
-        for (int y = 0; y <= (dst_rect.h >> 1); y++) {
-            uint8_t* scnlp1 = a8.data() + (y * dst_rect.w);
-            uint8_t* scnlp2 = scnlp1 + dst_rect.w - 1;
-            uint8_t* scnlp3 = a8.data() + ((dst_rect.h - y - 1) * dst_rect.w);
-            uint8_t* scnlp4 = scnlp3 + dst_rect.w - 1;
-            int y_pos = (y < midy) ? y : dst_rect.h - y;
-            uint32_t shadeval, maskval;
-
-            for (int x = 0; x <= (dst_rect.w >> 1); x++) {
-                // mask is symetrical so we only need to calculate half
-
-                shadeval = 0xff; // clear
-                int x_pos = (x < midx) ? x : dst_rect.w - x;
-                int value_set = 0;
-
-                // Calculate the location of the current pixel relative to:
-                // d1 - the screen centre (midx, midy)
-                // d2 - the center of the CRT curve on x axis (crt_curve_radius_x, midy)
-                // d3 - the center of the CRT curve on y axis (midx, crt_curve_radius_y)
-                // d4 - the intersection of the CRT curves at the top left (x_intersect, y_intersect)
-                // d5 - the corner radius centre (corner_x, corner_y)
-
-                // These are calculated as:
-                // float d1 = sqrt(((midx - float(x_pos)) * (midx - float(x_pos))) + ((midy - float(y_pos)) * (midy - float(y_pos))));
-                // float d2 = sqrt(((crt_curve_radius_x - float(x_pos)) * (crt_curve_radius_x - float(x_pos))) + ((midy - float(y_pos)) * (midy - float(y_pos))));
-                // float d3 = sqrt(((midx - float(x_pos)) * (midx - float(x_pos))) + ((crt_curve_radius_y - float(y_pos)) * (crt_curve_radius_y - float(y_pos))));
-                // float d4 = sqrt((((x_intersect + edge_radius) - float(x_pos)) * ((x_intersect + edge_radius) - float(x_pos))) + (((y_intersect + edge_radius) - float(y_pos)) * (y_intersect + edge_radius - float(y_pos))));
-                // float d5 = sqrt(((corner_x - float(x_pos)) * (corner_x - float(x_pos))) + ((corner_y - float(y_pos)) * (corner_y - float(y_pos))));
-                //
-                // sqrt is very expensive on ARMv6/v7 hence we minimise the number of calls we need to made.
-
-                // first apply overall vignette effect based on distance from centre (d1)
-                float d1sq = dx1[x_pos] + dy1[y_pos];
-                if (d1sq >= outer2) {
-                    // black out beyond this region
-                    shadeval = int(total_black);
-                    continue; // early-out
-                }
-                else if ((d1sq >= inner2) && (config.video.shader_mode < 2)) {
-                    // vignette handled in GPU shader for all masks except 0 (off) and 1 (overlay based, code below)
-                    // intermediate value; increase intensity with square of distance to avoid visible edge
-                    float d1 = std::sqrt(d1sq);
-                    shadeval = 255 - uint32_t(round(((vignette_target) * ((d1 - inner) * (d1 - inner)) /
-                        outer_less_inner2)));
-                }
-                else shadeval = 0xff; // no dimming
-
-                // create rounded corners about the intersection point adjusted for the corner radius
-                // if that point could be determined
-                if ((corner_x > 1.0) && (corner_y > 1.0)) {
-                    if ((x_pos <= corner_x) &&
-                        (y_pos <= corner_y)) {
-                        // apply curve over existing vignette
-                        float d5 = std::sqrt(dx5[x_pos] + dy5[y_pos]);
-                        shadeval = (shadeval *
-                            (d5 >= (edge_radius + corner_radius) ? int(total_black) :
-                                (d5 > corner_radius ?
-                                        (uint32_t(round((255 * fabs(edge_radius - (d5 - corner_radius))) / edge_radius)))
-                                        : 255))) >> 8;
-                        value_set = 1;
+        jobsystem.parallel_for(0, (dst_rect.h >> 1) + 1, [&](int first, int last) {
+            for (int y = first; y < last; y++) {
+                uint8_t* scnlp1 = a8.data() + (y * dst_rect.w);
+                uint8_t* scnlp2 = scnlp1 + dst_rect.w - 1;
+                uint8_t* scnlp3 = a8.data() + ((dst_rect.h - y - 1) * dst_rect.w);
+                uint8_t* scnlp4 = scnlp3 + dst_rect.w - 1;
+                int y_pos = (y < midy) ? y : dst_rect.h - y;
+                uint32_t shadeval, maskval;
+
+                for (int x = 0; x <= (dst_rect.w >> 1); x++) {
+                    // mask is symetrical so we only need to calculate half
+
+                    shadeval = 0xff; // clear
+                    int x_pos = (x < midx) ? x : dst_rect.w - x;
+                    int value_set = 0;
+
+                    // Calculate the location of the current pixel relative to:
+                    // d1 - the screen centre (midx, midy)
+                    // d2 - the center of the CRT curve on x axis (crt_curve_radius_x, midy)
+                    // d3 - the center of the CRT curve on y axis (midx, crt_curve_radius_y)
+                    // d4 - the intersection of the CRT curves at the top left (x_intersect, y_intersect)
+                    // d5 - the corner radius centre (corner_x, corner_y)
+
+                    // These are calculated as:
+                    // float d1 = sqrt(((midx - float(x_pos)) * (midx - float(x_pos))) + ((midy - float(y_pos)) * (midy - float(y_pos))));
+                    // float d2 = sqrt(((crt_curve_radius_x - float(x_pos)) * (crt_curve_radius_x - float(x_pos))) + ((midy - float(y_pos)) * (midy - float(y_pos))));
+                    // float d3 = sqrt(((midx - float(x_pos)) * (midx - float(x_pos))) + ((crt_curve_radius_y - float(y_pos)) * (crt_curve_radius_y - float(y_pos))));
+                    // float d4 = sqrt((((x_intersect + edge_radius) - float(x_pos)) * ((x_intersect + edge_radius) - float(x_pos))) + (((y_intersect + edge_radius) - float(y_pos)) * (y_intersect + edge_radius - float(y_pos))));
+                    // float d5 = sqrt(((corner_x - float(x_pos)) * (corner_x - float(x_pos))) + ((corner_y - float(y_pos)) * (corner_y - float(y_pos))));
+                    //
+                    // sqrt is very expensive on ARMv6/v7 hence we minimise the number of calls we need to made.
+
+                    // first apply overall vignette effect based on distance from centre (d1)
+                    float d1sq = dx1[x_pos] + dy1[y_pos];
+                    if (d1sq >= outer2) {
+                        // black out beyond this region
+                        shadeval = int(total_black);
+                        continue; // early-out
                     }
-                }
-                else {
-                    // follow the edge contour around the corners as the specified corner_radius
-                    // did not intersect with both curves (i.e. was too small)
-                    if ((x_pos <= (int(x_intersect + edge_radius))) &&
-                        (y_pos <= (int(y_intersect + edge_radius)))) {
-                        float d4sq = dx4[x_pos] + dy4[y_pos];
-                        if (d4sq < edge_radius2) {
-                            float d4 = std::sqrt(d4sq);
+                    else if ((d1sq >= inner2) && (config.video.shader_mode < 2)) {
+                        // vignette handled in GPU shader for all masks except 0 (off) and 1 (overlay based, code below)
+                        // intermediate value; increase intensity with square of distance to avoid visible edge
+                        float d1 = std::sqrt(d1sq);
+                        shadeval = 255 - uint32_t(round(((vignette_target) * ((d1 - inner) * (d1 - inner)) /
+                            outer_less_inner2)));
+                    }
+                    else shadeval = 0xff; // no dimming
+
+                    // create rounded corners about the intersection point adjusted for the corner radius
+                    // if that point could be determined
+                    if ((corner_x > 1.0) && (corner_y > 1.0)) {
+                        if ((x_pos <= corner_x) &&
+                            (y_pos <= corner_y)) {
+                            // apply curve over existing vignette
+                            float d5 = std::sqrt(dx5[x_pos] + dy5[y_pos]);
                             shadeval = (shadeval *
-                                (uint32_t(round((255 * fabs(edge_radius - d4)) / edge_radius)))
-                                ) >> 8; // apply curve over existing vignette
+                                (d5 >= (edge_radius + corner_radius) ? int(total_black) :
+                                    (d5 > corner_radius ?
+                                            (uint32_t(round((255 * fabs(edge_radius - (d5 - corner_radius))) / edge_radius)))
+                                            : 255))) >> 8;
                             value_set = 1;
                         }
                     }
-                }
-
-                if (value_set == 0) {
-                    // remove horizontal 'ears' at each corner
-                    if ((y_pos <= int(y_intersect + edge_radius)) &&
-                        (x_pos <= int(x_intersect + edge_radius))) shadeval = int(total_black);
-
-                    // next apply the curved edge effect based on distance from the CRT curve (d2 and d3)
-                    // first use d2 (x axis) as this will be larger
-                    if (x_pos <= (x_intersect + edge_radius)) {
-                        // somewhere on curve on left edge
-                        //float d2 = sqrt(dx2[x_pos] + dy1[y_pos]);
-                        float d2sq = dx2[x_pos] + dy1[y_pos];
-                        if (d2sq >= crt_curve_radius_x2) {
-                            // black out beyond this region
-                            shadeval = int(total_black);
-                        }
-                        else {
-                            float d2 = std::sqrt(d2sq);
-                            if ((crt_curve_radius_x - d2) < edge_radius) {
-                                // apply the curve, x255 then >> 8 saves on floating-point division
+                    else {
+                        // follow the edge contour around the corners as the specified corner_radius
+                        // did not intersect with both curves (i.e. was too small)
+                        if ((x_pos <= (int(x_intersect + edge_radius))) &&
+                            (y_pos <= (int(y_intersect + edge_radius)))) {
+                            float d4sq = dx4[x_pos] + dy4[y_pos];
+                            if (d4sq < edge_radius2) {
+                                float d4 = std::sqrt(d4sq);
                                 shadeval = (shadeval *
-                                    (uint32_t(round((255 * fabs(crt_curve_radius_x - d2)) / edge_radius)))
+                                    (uint32_t(round((255 * fabs(edge_radius - d4)) / edge_radius)))
                                     ) >> 8; // apply curve over existing vignette
+                                value_set = 1;
                             }
-                        } // else unaffected
+                        }
                     }
-                    else {
-                        // next use d3 (y-axis curve)
-                        if (y_pos <= (y_intersect + edge_radius)) {
-                            // somewhere on curve on top edge
-                            float d3sq = dx1[x_pos] + dy2[y_pos];
-                            if ((d3sq >= crt_curve_radius_y2)) {
+
+                    if (value_set == 0) {
+                        // remove horizontal 'ears' at each corner
+                        if ((y_pos <= int(y_intersect + edge_radius)) &&
+                            (x_pos <= int(x_intersect + edge_radius))) shadeval = int(total_black);
+
+                        // next apply the curved edge effect based on distance from the CRT curve (d2 and d3)
+                        // first use d2 (x axis) as this will be larger
+                        if (x_pos <= (x_intersect + edge_radius)) {
+                            // somewhere on curve on left edge
+                            //float d2 = sqrt(dx2[x_pos] + dy1[y_pos]);
+                            float d2sq = dx2[x_pos] + dy1[y_pos];
+                            if (d2sq >= crt_curve_radius_x2) {
                                 // black out beyond this region
                                 shadeval = int(total_black);
                             }
                             else {
-                                float d3 = std::sqrt(d3sq);
-                                if ((crt_curve_radius_y - d3) < edge_radius) {
-                                // apply the curve
-                                shadeval = (shadeval *
-                                    (uint32_t(round((255 * fabs(crt_curve_radius_y - d3)) / edge_radius)))
-                                    ) >> 8; // apply curve over existing vignette
+                                float d2 = std::sqrt(d2sq);
+                                if ((crt_curve_radius_x - d2) < edge_radius) {
+                                    // apply the curve, x255 then >> 8 saves on floating-point division
+                                    shadeval = (shadeval *
+                                        (uint32_t(round((255 * fabs(crt_curve_radius_x - d2)) / edge_radius)))
+                                        ) >> 8; // apply curve over existing vignette
+                                }
+                            } // else unaffected
+                        }
+                        else {
+                            // next use d3 (y-axis curve)
+                            if (y_pos <= (y_intersect + edge_radius)) {
+                                // somewhere on curve on top edge
+                                float d3sq = dx1[x_pos] + dy2[y_pos];
+                                if ((d3sq >= crt_curve_radius_y2)) {
+                                    // black out beyond this region
+                                    shadeval = int(total_black);
+                                }
+                                else {
+                                    float d3 = std::sqrt(d3sq);
+                                    if ((crt_curve_radius_y - d3) < edge_radius) {
+                                    // apply the curve
+                                    shadeval = (shadeval *
+                                        (uint32_t(round((255 * fabs(crt_curve_radius_y - d3)) / edge_radius)))
+                                        ) >> 8; // apply curve over existing vignette
+                                    }
                                 }
                             }
                         }
                     }
+                    // store the calculated mask value in the texture
+                    *(scnlp1++) = shadeval; // top-left
+                    *(scnlp2--) = shadeval; // top-right
+                    *(scnlp3++) = shadeval; // bottom-left
+                    *(scnlp4--) = shadeval; // bottom-right
                 }
-                // store the calculated mask value in the texture
-                *(scnlp1++) = shadeval; // top-left
-                *(scnlp2--) = shadeval; // top-right
-                *(scnlp3++) = shadeval; // bottom-left
-                *(scnlp4--) = shadeval; // bottom-right
             }
-        }
+        });
+        store_overlay(a8);
     }
 
 /*  Mask is now handled on the shader
@@ -793,6 +1025,104 @@ void RenderSurface::init_overlay()
     // save current settings
     last_vignette         = config.video.vignette;
     last_crt_shape_config = crt_shape_config;
+    overlay_shown         = overlay_key();
+}
+
+
+// The overlay mask depends on the output size, the shape settings and, when it carries the
+// vignette (shader modes 0 and 1), the vignette setting.
+RenderSurface::OverlayKey RenderSurface::overlay_key() const
+{
+    return { dst_rect.w, dst_rect.h, config.video.crt_shape, config.video.warpX, config.video.warpY,
+             (config.video.shader_mode < 2) ? config.video.vignette : -1 };
+}
+
+std::string RenderSurface::overlay_cache_file() const
+{
+    return config.data.save_path + "overlay_cache.bin";
+}
+
+// Header of the disk cache, followed by the A8 mask
+struct OverlayCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t  key[6];
+};
+static const uint32_t OVERLAY_CACHE_MAGIC   = 0x564F4243; // "CBOV"
+static const uint32_t OVERLAY_CACHE_VERSION = 1;
+
+// Fetch the mask for the current settings from the cache in memory, or else from disk.
+bool RenderSurface::find_overlay(std::vector<uint8_t>& a8)
+{
+    const OverlayKey key = overlay_key();
+    for (auto& mask : overlay_masks) {
+        if (mask.key == key) {
+            mask.last_used = ++overlay_clock;
+            a8 = mask.a8;
+            return true;
+        }
+    }
+
+    std::ifstream in(overlay_cache_file(), std::ios::binary);
+    if (!in) return false;
+    OverlayCacheHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != OVERLAY_CACHE_MAGIC || header.version != OVERLAY_CACHE_VERSION ||
+        !std::equal(key.begin(), key.end(), header.key))
+        return false;
+
+    a8.resize(size_t(dst_rect.w) * dst_rect.h);
+    if (!in.read(reinterpret_cast<char*>(a8.data()), a8.size()))
+        return false;
+    overlay_file = key;
+    store_overlay(a8);
+    return true;
+}
+
+// Keep a newly built mask, replacing the least recently used one when the cache is full.
+void RenderSurface::store_overlay(const std::vector<uint8_t>& a8)
+{
+    if (overlay_masks.size() >= size_t(OVERLAY_MASKS)) {
+        auto lru = std::min_element(overlay_masks.begin(), overlay_masks.end(),
+            [](const OverlayMask& a, const OverlayMask& b) { return a.last_used < b.last_used; });
+        overlay_masks.erase(lru);
+    }
+    overlay_masks.push_back({ overlay_key(), a8, ++overlay_clock });
+}
+
+// Write the mask in use to disk, if it isn't there already, so that the next start needn't
+// build it. Written to a temporary file then renamed, as the sprite cache.
+void RenderSurface::save_overlay_cache()
+{
+    if (!config.video.overlay_cache || overlay_shown == overlay_file) return;
+
+    auto mask = std::find_if(overlay_masks.begin(), overlay_masks.end(),
+                             [&](const OverlayMask& m) { return m.key == overlay_shown; });
+    if (mask == overlay_masks.end()) return;
+
+    OverlayCacheHeader header;
+    header.magic   = OVERLAY_CACHE_MAGIC;
+    header.version = OVERLAY_CACHE_VERSION;
+    std::copy(mask->key.begin(), mask->key.end(), header.key);
+
+    const std::string filename = overlay_cache_file();
+    const std::string tmp = filename + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(mask->a8.data()), mask->a8.size());
+        if (!out) {
+            std::cerr << "Unable to write overlay cache " << tmp << std::endl;
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    std::remove(filename.c_str());
+    if (std::rename(tmp.c_str(), filename.c_str()) != 0) {
+        std::cerr << "Unable to write overlay cache " << filename << std::endl;
+        return;
+    }
+    overlay_file = overlay_shown;
 }
 
 
@@ -827,92 +1157,122 @@ bool RenderSurface::finalize_frame()
 
     if (config.videoRestartRequired) return true;
 
-    // check is disable() is waiting
-    if (shutting_down.load(std::memory_order_acquire)) return true;
-    activity_counter.fetch_add(1, std::memory_order_acq_rel);
+    // not while disable() is waiting
+    if (!begin_activity()) return true;
 
     // ensure we have exclusive access to the SDL context
-    std::lock_guard<std::mutex> gpulock(gpuMutex);
+    std::unique_lock<std::mutex> gpulock = gpu_lock();
 
     int game_width = src_rect.w;
     int game_height = src_rect.h;
 
-    // Whether to use off-screen target
-    int offscreen_rendering = 0;
+    // Whether to use off-screen target (the reduced resolution shader pass)
+    int offscreen_rendering = glb::has_offscreen() ? 1 : 0;
 
     if (FrameCounter++ == 60) FrameCounter = 0;
 
     // *** SHADER DRAW ***
 
-    SDL_Surface* localGameSurface;
+    uint64_t trace = frametrace::now();
+    if (gpu_indexed())
+        update_index_controls();
+
+    if (!texture_current && buffer_ready >= 0)
     {
-        std::lock_guard<std::mutex> lock(drawFrameMutex);
-        const int idx = current_game_surface ^ 1;
-        localGameSurface = GameSurface[idx]; // Latch the SDL_Surface*
+        // last frame was drawn straight into a GPU buffer; the texture may hold it already
+        if (buffer_ready != buffer_shown)
+            glb::update_game_texture_from_buffer(buffer_ready, game_width, game_height);
+        buffer_shown   = buffer_ready;
+        texture_loaded = true;
     }
-
-    // Upload this frame’s CPU pixels to the GPU
-    glb::update_game_texture(
-        localGameSurface->pixels,
-        localGameSurface->pitch,
-        game_width,
-        game_height
-    );
+    else if (!texture_current)
+    {
+        // take the newest complete frame, if there is one; otherwise show the last again, which
+        // the texture holds already once anything has been uploaded
+        bool upload = !texture_loaded;
+        if (ready_game_surface.load(std::memory_order_acquire) & FRAME_READY) {
+            shown_game_surface = ready_game_surface.exchange(shown_game_surface, std::memory_order_acq_rel)
+                                 & (FRAME_READY - 1);
+            upload = true;
+        }
+        SDL_Surface* localGameSurface = GameSurface[shown_game_surface]; // Latch the SDL_Surface*
+        texture_loaded = true;
+
+        // Upload this frame’s CPU pixels to the GPU
+        if (upload && gpu_indexed())
+            glb::update_index_texture(localGameSurface->pixels, localGameSurface->pitch, src_width, game_height);
+        else if (upload)
+            glb::update_game_texture(
+                localGameSurface->pixels,
+                localGameSurface->pitch,
+                game_width,
+                game_height
+            );
+    }
+    texture_current = false;
+    trace = frametrace::record(frametrace::UPLOAD, trace);
 
     /* == Configure shader options ('uniforms') == */
 
+    // Values are only sent to the GPU when changed (see glb::flush_uniforms)
     static long last_config = 0;
-    static int  ticks = 3;
-    // check for any settings changes
-    if (1)
+    static int  clear_frames = 0;
     {
-        long this_config = get_video_config();
-        if ((this_config!=last_config) && ticks) {
-            // Send updated config to the shader
-            glb::set_uniform("warpX",           float(config.video.warpX) / 200.0f);
-            glb::set_uniform("warpY",           float(config.video.warpY) / 100.0f);
+        glb::set_uniform(glb::U_WARP_X,          float(config.video.warpX) / 200.0f);
+        glb::set_uniform(glb::U_WARP_Y,          float(config.video.warpY) / 100.0f);
 
-            float invExpandX;
-            if (config.video.hires==0) {
+        float invExpandX;
+        if (config.video.hires==0) {
+            // add 3% width to the source as the non-SIMD blargg filter leaves a black bar on the right
+            invExpandX = 1 / 1.03;
+        } else {
+            #if SNES_NTSC_HAVE_SIMD
+                invExpandX = 1 / 1.01;
+            #else
                 // add 3% width to the source as the non-SIMD blargg filter leaves a black bar on the right
                 invExpandX = 1 / 1.03;
-            } else {
-                #if SNES_NTSC_HAVE_SIMD
-                    invExpandX = 1 / 1.01;
-                #else
-                    // add 3% width to the source as the non-SIMD blargg filter leaves a black bar on the right
-                    invExpandX = 1 / 1.03;
-                #endif
-            }
-            float invExpandY = 1.0;
-            glb::set_uniform2("invExpand",      invExpandX, invExpandY);
+            #endif
+        }
+        float invExpandY = 1.0;
+        glb::set_uniform(glb::U_INV_EXPAND,      invExpandX, invExpandY);
+
+        glb::set_uniform(glb::U_BRIGHTBOOST,     1 + (float(config.video.brightboost) / 100.0f));
+        glb::set_uniform(glb::U_NOISE_INTENSITY, float(config.video.noise) / 100.0f);
+
+        float vignette = (config.video.shadow_mask < 2) ? 0.0f : float(config.video.vignette) / 100.0f;
+        glb::set_uniform(glb::U_VIGNETTE,        vignette);
 
-            glb::set_uniform("brightboost",     1 + (float(config.video.brightboost) / 100.0f));
-            glb::set_uniform("noiseIntensity",  float(config.video.noise) / 100.0f);
+        float desat_val = (config.video.desaturate) / 100.0f;
+        glb::set_uniform(glb::U_DESAT_INV0,      (1.0f / (1.0f + desat_val)));
+        desat_val += (config.video.desaturate_edges) / 100.0f;
+        glb::set_uniform(glb::U_DESAT_INV1,      (1.0f / (1.0f + desat_val)));
 
-            float vignette = (config.video.shadow_mask < 2) ? 0.0f : float(config.video.vignette) / 100.0f;
-            glb::set_uniform("vignette",        vignette);
+        set_shadow_mask();
 
-            float desat_val = (config.video.desaturate) / 100.0f;
-            glb::set_uniform("desat_inv0",      (1.0f / (1.0f + desat_val)));
-            desat_val += (config.video.desaturate_edges) / 100.0f;
-            glb::set_uniform("desat_inv1",      (1.0f / (1.0f + desat_val)));
+        // the shader's output: the offscreen target, when drawn at reduced resolution
+        glb::set_uniform(glb::U_OUTPUT_SIZE,     float(offscreen_rendering ? glb::G.fboW : dst_rect.w),
+                                                 float(offscreen_rendering ? glb::G.fboH : dst_rect.h));
 
-            glb::set_uniform("baseOff",         (config.video.shadow_mask==2 ? (config.video.maskDim/100.0f)   : 1.0f));
-            glb::set_uniform("baseOn",          (config.video.shadow_mask==2 ? (config.video.maskBoost/100.0f) : 1.0f));
-            int this_mask_size = std::max(3, config.video.mask_size);
-            glb::set_uniform("invMaskPitch",    (1.0f /    float(this_mask_size)) );
-            glb::set_uniform("inv2MaskPitch",   (1.0f / (2*float(this_mask_size))) );
-            glb::set_uniform("inv2Height",      (1.0f / (2*float((this_mask_size-2)))) );
+        // scanlines drawn by the shader, as the CPU pass would have (see cpu_scanlines)
+        const bool shader_scanlines = config.video.scanlines != 0 && cpu_scanlines() == 0 && !gpu_indexed();
+        glb::set_uniform(glb::U_SCANLINE, shader_scanlines ? 1.0f / float(1 << std::min(config.video.scanlines, 3)) : 1.0f,
+                         float(src_rect.h));
 
-            glb::set_uniform2("OutputSize",     float(dst_rect.w), float(dst_rect.h));
+        // only the noise effect uses the time
+        if (config.video.noise)
+            glb::set_uniform(glb::U_TIME,        (float(FrameCounter) / 60.0), 0.0f );
+
+        // The image may have moved or changed size, so clear each of the (up to three) swap chain
+        // buffers to remove what was drawn around it
+        long this_config = get_video_config();
+        if (this_config != last_config) {
+            last_config  = this_config;
+            clear_frames = 3;
+        }
+        if (clear_frames > 0) {
             glb::clear(/*rgba*/ 0.f, 0.f, 0.f, 1.f);
-            if (--ticks==0) {
-                last_config = this_config;
-                ticks = 3;
-            }
+            clear_frames--;
         }
-        glb::set_uniform2("u_Time",         (float(FrameCounter) / 60.0), 0.0f );
     }
 
     int this_crt_shape_config = config.video.crt_shape +
@@ -939,62 +1299,109 @@ bool RenderSurface::finalize_frame()
     glb::draw( /*useOffscreen=*/(offscreen_rendering==1),
                /*drawOverlay=*/((config.video.crt_shape != 0)||(config.video.shadow_mask==1)) );
 
+    trace = frametrace::record(frametrace::DRAW, trace);
+
     // ultimately calls SDL_GL_SwapWindow
     glb::present();
+    frametrace::record(frametrace::PRESENT, trace);
 
-    // notify disable() that we're done
-    activity_counter.fetch_sub(1, std::memory_order_acq_rel);
-    std::unique_lock<std::mutex> lock(mtx);
-    cv.notify_all();  // In case disable() is waiting
+    end_activity();
 
     return true;
 }
 
 
-void RenderSurface::blargg_filter(uint16_t* gamePixels, uint32_t* outputPixels, int section)
+// High refresh displays: a refresh between game frames. The texture uploaded by finalize_frame()
+// is drawn again with the same settings, the noise moved on half a frame, or the screen is
+// cleared for black frame insertion. Nothing is uploaded, so the only cost is GPU time.
+bool RenderSurface::repeat_frame(bool black)
 {
-    // Processes either half of the image:
-    //   top half when section = 0
-    //   bottom half when section = 1
-    //   entire image when section = -1
-
-    long src_pixel_count = src_width * src_height;
-    long dst_pixel_count = snes_src_width * src_height;
-    long block_height    = src_height;
-
-    int this_section = section;
-    if (this_section >= 0) {
-        src_pixel_count = src_pixel_count >> 1;
-        dst_pixel_count = dst_pixel_count >> 1;
-        block_height = block_height >> 1;
-    } else {
-        this_section = 0;
+    if (config.videoRestartRequired) return true;
+    // not while disable() is waiting
+    if (!begin_activity()) return true;
+
+    {
+        std::unique_lock<std::mutex> gpulock = gpu_lock();
+        uint64_t trace = frametrace::now();
+        if (black) {
+            glb::clear(/*rgba*/ 0.f, 0.f, 0.f, 1.f);
+        } else {
+            if (config.video.noise)
+                glb::set_uniform(glb::U_TIME, (float(FrameCounter) + 0.5f) / 60.0f, 0.0f);
+            glb::draw( /*useOffscreen=*/glb::has_offscreen(),
+                       /*drawOverlay=*/((config.video.crt_shape != 0)||(config.video.shadow_mask==1)) );
+        }
+        glb::present();
+        frametrace::record(frametrace::REPEAT, trace);
     }
 
-    uint16_t* spix = gamePixels + (this_section * src_pixel_count); // S16 Output
-    uint16_t* bpix = rgb_pixels + (this_section * src_pixel_count); // converted colour buffer
+    end_activity();
+    return true;
+}
 
-    if (blargg) {
-        // convert pixel data to format used by Blarrg filtering code
-
-        // translate game image to lookup format that Blargg filter will use
-        long pixel_count = (src_pixel_count) >> 2; // unroll 4:1
-		while (pixel_count--) {
-            // translate game image to lookup format that Blargg filter will use to
-            // convert to RGB output levels in one step based on pre-defined S16-correct DAC output values
-            *(bpix+0) = rgb_blargg[*(spix+0)];
-            *(bpix+1) = rgb_blargg[*(spix+1)];
-            *(bpix+2) = rgb_blargg[*(spix+2)];
-            *(bpix+3) = rgb_blargg[*(spix+3)];
-            bpix += 4;
-            spix += 4;
-        }
+// Low latency path: upload one band of the surface draw_frame() is writing this frame, as soon as
+// that band is complete, so the next finalize_frame() shows it without a further frame of delay.
+// Must be called from the thread owning the GL context, in band order.
+void RenderSurface::upload_frame(int band, int bands)
+{
+    if (config.videoRestartRequired) return;
+    // not while disable() is waiting
+    if (!begin_activity()) return;
+
+    {
+        std::unique_lock<std::mutex> gpulock = gpu_lock();
+
+        // same thread as swap_buffers() in low latency mode
+        SDL_Surface* localGameSurface = GameSurface[current_game_surface];
+
+        // same band boundaries as draw_frame()
+        bands = std::clamp(bands, 1, src_height);
+        band  = std::clamp(band, 0, bands - 1);
+        const int first_row = (src_height * band) / bands;
+        const int end_row   = (src_height * (band + 1)) / bands;
+
+        const uint8_t* band_pixels = static_cast<uint8_t*>(localGameSurface->pixels) +
+                                     (size_t(first_row) * localGameSurface->pitch);
+        if (gpu_indexed())
+            glb::update_index_texture(band_pixels, localGameSurface->pitch, src_width, end_row - first_row, first_row);
+        else
+            glb::update_game_texture(
+                band_pixels,
+                localGameSurface->pitch,
+                src_rect.w,
+                end_row - first_row,
+                first_row
+            );
+        texture_current = true;
+    }
+
+    end_activity();
+}
+
+
+bool RenderSurface::blargg_filter(uint16_t* gamePixels, uint32_t* outputRows, int first_row, int rows,
+                                  int scanlines)
+{
+    // Processes 'rows' rows of the image starting at 'first_row', writing them from outputRows.
+    // The filter advances the burst phase by one per row, so each band starts at the phase the
+    // row would have had if the whole image were processed in one pass; the bands therefore
+    // join seamlessly. Returns true if the scanlines were applied as the rows were written.
+    frametrace::Scope trace(frametrace::BLARGG);
+
+    const long src_offset = long(first_row) * src_width;
+
+    uint16_t* spix = gamePixels + src_offset; // S16 Output
 
+    if (blargg) {
+        // The blitters translate the game image to the lookup format the Blargg filter uses as they
+        // read it (rgb_blargg, the pre-defined S16-correct DAC output values), so it's passed as is
         long output_pitch = (snes_src_width << 2); // 4 bytes-per-pixel (8/8/8/8)
 
         // Set pointers
-        bpix = rgb_pixels + (this_section * src_pixel_count);
-        uint32_t* tpix = outputPixels + (this_section * dst_pixel_count);
+        uint32_t* tpix = outputRows;
+
+        // Burst phase of this band's first row
+        const int band_phase = (phase + first_row) % snes_ntsc_burst_count;
 
         // Calculated alpha mask
         uint32_t Ashifted = uint32_t(Alevel);// << Ashift;
@@ -1004,19 +1411,83 @@ void RenderSurface::blargg_filter(uint16_t* gamePixels, uint32_t* outputPixels,
             // hi-res
             #if SNES_NTSC_HAVE_SIMD
                 // Only compiled when the fast function exists
-                snes_ntsc_blit_hires_fast(ntsc, bpix, long(src_width), phase, src_width,
-                                          block_height, tpix, output_pitch, Ashifted);
+                snes_ntsc_blit_hires_fast(ntsc, spix, rgb_blargg, long(src_width), band_phase, src_width,
+                                          rows, tpix, output_pitch, Ashifted, scanlines, first_row);
+                return true;
             #else
-                snes_ntsc_blit_hires(ntsc, bpix, long(src_width), phase, src_width,
-                                     block_height, tpix, output_pitch, Ashifted);
+                snes_ntsc_blit_hires(ntsc, spix, rgb_blargg, long(src_width), band_phase, src_width,
+                                     rows, tpix, output_pitch, Ashifted);
             #endif
         }
         else {
             // standard res processing
-            snes_ntsc_blit(ntsc, bpix, long(src_width), phase,
-                src_width, block_height, tpix, output_pitch, Ashifted);
+            snes_ntsc_blit(ntsc, spix, rgb_blargg, long(src_width), band_phase,
+                src_width, rows, tpix, output_pitch, Ashifted);
+        }
+    }
+    return false;
+}
+
+
+// Hash of one row of the S16 image for row reuse, in eight multiply-xor lanes the compiler
+// can vectorise. Never 0, which marks a row as not known.
+static uint64_t hash_row(const uint16_t* row, int width)
+{
+    uint32_t h[8] = { 0x243F6A88u, 0x85A308D3u, 0x13198A2Eu, 0x03707344u,
+                      0xA4093822u, 0x299F31D0u, 0x082EFA98u, 0xEC4E6C89u };
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint32_t w[8];
+        std::memcpy(w, row + x, sizeof(w));
+        for (int i = 0; i < 8; i++) {
+            h[i] = (h[i] ^ w[i]) * 0x9E3779B1u;
+            h[i] ^= h[i] >> 15;
+        }
+    }
+    for (; x < width; x++)
+        h[x & 7] = (h[x & 7] ^ row[x]) * 0x9E3779B1u;
+
+    uint64_t r = 0;
+    for (int i = 0; i < 8; i++)
+        r = (r ^ h[i]) * 0x9E3779B97F4A7C15ull;
+    return (r ^ (r >> 32)) | 1;
+}
+
+// The Blargg output of a row depends only on that row of the S16 image, the filter table and
+// options, and the burst phase. This is those last, for rows drawn this frame, or 0 if rows
+// can't be reused: with bloom a row also depends on its neighbours, and earlier frames are
+// only kept in GameSurface.
+uint64_t RenderSurface::row_reuse_key() const
+{
+    if (!config.video.row_reuse || !blargg || gpu_indexed() || buffer_write >= 0 ||
+        (config.video.scanlines && config.video.crt_bloom))
+        return 0;
+    return (uint64_t(ntsc_serial) << 32) | (uint64_t(Alevel & 0xFF) << 24) |
+           (uint64_t(config.video.scanlines & 0xFF) << 16) | (uint64_t(blargg & 0xFF) << 8) |
+           (uint64_t(config.video.hires != 0) << 4) | uint64_t(phase + 1);
+}
+
+// Row reuse: returns true if 'row' of the frame being drawn is already in place, either
+// because the surface being drawn holds it from the same input, or because it was copied from
+// another surface that does. The row's hash is recorded either way, so otherwise the caller
+// must filter it. Only called when frame_key is set, so outputPixels is GameSurface.
+bool RenderSurface::reuse_row(const uint16_t* gamePixels, void* outputPixels, int row)
+{
+    const uint64_t h = hash_row(gamePixels + long(row) * src_width, src_width);
+    uint64_t& held = row_hashes[current_game_surface][row];
+    if (held == h) return true;
+    held = h;
+
+    // other surfaces are only read whilst drawing, so are safe to copy from
+    for (int s = 0; s < GAME_SURFACES; s++) {
+        if (s != current_game_surface && row_key[s] == frame_key && row_hashes[s][row] == h) {
+            const size_t bytes = size_t(snes_src_width) * (blargg16 ? sizeof(uint16_t) : sizeof(uint32_t));
+            std::memcpy(static_cast<uint8_t*>(outputPixels) + row * bytes,
+                        static_cast<const uint8_t*>(GameSurface[s]->pixels) + row * bytes, bytes);
+            return true;
         }
     }
+    return false;
 }
 
 
@@ -1063,186 +1534,227 @@ static inline void apply_scanlines_(uint32_t *pixels,
 }
 
 
-// CPU-side scanlines. These are applied to (and so align with) the game image, which generally looks better
-// Processes either half of the image:
-//   top half when section = 0
-//   bottom half when section = 1
-//   entire image when section = -1
+#include "sdl2/scanlines.hpp"
 
-// shift masks
-static const uint32_t masks[4] = { 0xFFFFFFFFu, 0xFEFEFEFEu, 0xFCFCFCFCu, 0xF8F8F8F8u };
 
-static inline void apply_scanlines(uint32_t *pixels,
-                                     size_t width, size_t height,
-                                     uint8_t shift,
-                                     uint8_t Rshift, uint8_t Gshift, uint8_t Bshift, uint8_t Ashift,
-                                     int     section)
+// Soften the rows between the scanlines: each even row becomes the average of itself and the
+// (scanline) rows either side. Only even rows are written and they read only odd rows and
+// themselves, so this works in place. Rows outside starty..endy-1 belong to other bands, which
+// may still be being drawn, so a row at the edge of the band uses itself in their place.
+static void apply_crt_bloom(uint32_t *pixels,
+                            size_t   width,
+                            size_t   height,
+                            uint8_t  Rshift,
+                            uint8_t  Gshift,
+                            uint8_t  Bshift,
+                            uint8_t  Ashift,
+                            size_t   starty,
+                            size_t   endy)
 {
-    uint32_t mask   = masks[shift & 3];
-    uint32_t AMask  = 0xFFu << Ashift;   // preserve alpha bits
-
-    const size_t block_height = (section >= 0 ? (height >> 1) : height);
-    const size_t starty = (section == 1 ? block_height : 0);
-    const size_t endy   = starty + block_height;
-
-    for (size_t y = (starty+1); y < endy; y += 2) {
-        uint32_t *row = pixels + y * width;
-        for (size_t x = 0; x < width; x++, row++) {
-            uint32_t p = *row;
+    if (endy > height) endy = height;
+
+#if SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_X86_LEVEL)
+    // per byte: sum of three rows in 16-bit lanes, then (sum * 21846) >> 16, which is sum / 3
+    // exactly for sums up to 765
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i third = _mm_set1_epi16(21846);
+    const __m128i amask = _mm_set1_epi32(int(0xFFu << Ashift));
+#elif SNES_NTSC_HAVE_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+    const uint8x16_t amask = vreinterpretq_u8_u32(vdupq_n_u32(0xFFu << Ashift));
+    auto third = [](uint16x8_t s) {
+        return vmovn_u16(vcombine_u16(vshrn_n_u32(vmull_n_u16(vget_low_u16(s),  21846), 16),
+                                      vshrn_n_u32(vmull_n_u16(vget_high_u16(s), 21846), 16)));
+    };
+#endif
 
-            // 1) unpack each channel using its shift
-            uint8_t r = (p >> Rshift) & 0xFF;
-            uint8_t g = (p >> Gshift) & 0xFF;
-            uint8_t b = (p >> Bshift) & 0xFF;
-            uint8_t a = (p >> Ashift) & 0xFF;
-
-            // 2) compute perceptual luminance (0–255)
-            uint8_t lum = ( ( 77 * r
-                            +150 * g
-                            + 29 * b ) >> 8 );
-
-            // 3) apply the scanline “dim” to each channel
-            uint8_t rd = r >> shift;
-            uint8_t gd = g >> shift;
-            uint8_t bd = b >> shift;
-
-            // 4) blend original+dimmed by (255−lum)/255
-            uint8_t out_r = ( rd * (255 - lum) + r * lum ) >> 8;
-            uint8_t out_g = ( gd * (255 - lum) + g * lum ) >> 8;
-            uint8_t out_b = ( bd * (255 - lum) + b * lum ) >> 8;
-
-            // 5) repack into the pixel
-            *row = (out_r << Rshift)
-                 | (out_g << Gshift)
-                 | (out_b << Bshift)
-                 | (a     << Ashift);
+    for (size_t y = (starty + 1) & ~size_t(1); y < endy; y += 2) {
+        // only do blur on the rows above/below scanlines:
+        // those are the even indices when scanlines are at odd y
+        size_t y0 = (y == starty)   ? y : y - 1;
+        size_t y1 = (y + 1 < endy)  ? y + 1 : y;
+
+        uint32_t *dst = pixels + y*width;
+        const uint32_t *row0 = pixels + y0*width;
+        const uint32_t *row1 = pixels + y1*width;
+        const uint32_t *orig = dst;
+
+        size_t x = 0;
+#if SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_X86_LEVEL)
+        for (; x + 4 <= width; x += 4) {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(row0 + x));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(row1 + x));
+            const __m128i o = _mm_loadu_si128((const __m128i*)(orig + x));
+            const __m128i lo = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                   _mm_unpacklo_epi8(b, zero)), _mm_unpacklo_epi8(o, zero)), third);
+            const __m128i hi = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                   _mm_unpackhi_epi8(b, zero)), _mm_unpackhi_epi8(o, zero)), third);
+            const __m128i out = _mm_or_si128(_mm_andnot_si128(amask, _mm_packus_epi16(lo, hi)),
+                                             _mm_and_si128(o, amask));
+            _mm_storeu_si128((__m128i*)(dst + x), out);
+        }
+#elif SNES_NTSC_HAVE_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+        for (; x + 4 <= width; x += 4) {
+            const uint8x16_t a = vld1q_u8((const uint8_t*)(row0 + x));
+            const uint8x16_t b = vld1q_u8((const uint8_t*)(row1 + x));
+            const uint8x16_t o = vld1q_u8((const uint8_t*)(orig + x));
+            const uint8x8_t lo = third(vaddw_u8(vaddl_u8(vget_low_u8(a),  vget_low_u8(b)),  vget_low_u8(o)));
+            const uint8x8_t hi = third(vaddw_u8(vaddl_u8(vget_high_u8(a), vget_high_u8(b)), vget_high_u8(o)));
+            vst1q_u8((uint8_t*)(dst + x), vbslq_u8(amask, o, vcombine_u8(lo, hi)));
+        }
+#elif SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_HAVE_RVV)
+        // per byte, strip-mined over the whole row
+        const size_t bytes = width * sizeof(uint32_t);
+        for (size_t i = 0, vl; i < bytes; i += vl) {
+            vl = __riscv_vsetvl_e8m1(bytes - i);
+            const vuint8m1_t a = __riscv_vle8_v_u8m1((const uint8_t*)row0 + i, vl);
+            const vuint8m1_t b = __riscv_vle8_v_u8m1((const uint8_t*)row1 + i, vl);
+            const vuint8m1_t o = __riscv_vle8_v_u8m1((const uint8_t*)orig + i, vl);
+            vuint16m2_t s = __riscv_vwaddu_wv_u16m2(__riscv_vwaddu_vv_u16m2(a, b, vl), o, vl);
+            s = __riscv_vmulhu_vx_u16m2(s, 21846, vl);
+            const vbool8_t alpha = __riscv_vmseq_vx_u8m1_b8(
+                __riscv_vand_vx_u8m1(__riscv_vid_v_u8m1(vl), 3, vl), Ashift / 8, vl);
+            const vuint8m1_t out = __riscv_vmerge_vvm_u8m1(__riscv_vnsrl_wx_u8m1(s, 0, vl), o, alpha, vl);
+            __riscv_vse8_v_u8m1((uint8_t*)dst + i, out, vl);
+        }
+        x = width;
+#endif
+        for (; x < width; ++x) {
+            // unpack the three source pixels
+            uint8_t r0 = (row0[x] >> Rshift) & 0xFF;
+            uint8_t g0 = (row0[x] >> Gshift) & 0xFF;
+            uint8_t b0 = (row0[x] >> Bshift) & 0xFF;
+
+            uint8_t r1 = (row1[x] >> Rshift) & 0xFF;
+            uint8_t g1 = (row1[x] >> Gshift) & 0xFF;
+            uint8_t b1 = (row1[x] >> Bshift) & 0xFF;
+
+            uint8_t ro = (orig[x] >> Rshift) & 0xFF;
+            uint8_t go = (orig[x] >> Gshift) & 0xFF;
+            uint8_t bo = (orig[x] >> Bshift) & 0xFF;
+            uint8_t ao = (orig[x] >> Ashift) & 0xFF;
+
+            // average them (1/3 each)
+            uint8_t nr = (uint16_t(r0) + r1 + ro) / 3;
+            uint8_t ng = (uint16_t(g0) + g1 + go) / 3;
+            uint8_t nb = (uint16_t(b0) + b1 + bo) / 3;
+
+            dst[x] = (nr << Rshift)
+                   | (ng << Gshift)
+                   | (nb << Bshift)
+                   | (ao << Ashift);
         }
     }
 }
 
 
-// == 16-bit ARGB1555 ==
-static inline void apply_scanlines(uint16_t *pixels,
-                                   size_t width, size_t height,
-                                   uint8_t shift,
-                                   uint8_t Rshift, uint8_t Gshift, uint8_t Bshift, uint8_t Ashift,
-                                   int     section)
+// Send the changed rows of the palette to the GPU pass, along with any changed filter or
+// scanline settings and, for the NTSC pass, this frame's burst phase
+void RenderSurface::update_index_controls()
 {
-    // Helper lambdas to scale between 5-bit and 8-bit without branches
-    auto expand5  = [](uint32_t v5) -> uint32_t { return (v5 << 3) | (v5 >> 2); };                 // 0..31 -> 0..255
-    auto quantize5 = [](uint32_t v8) -> uint32_t { return (v8 >> 3); };             // 0..255 -> 0..31
-
-    const size_t block_height = (section >= 0 ? (height >> 1) : height);
-    const size_t starty = (section == 1 ? block_height : 0);
-    const size_t endy   = starty + block_height;
-
-    const uint16_t Amask = (Ashift < 16) ? (uint16_t(1u) << Ashift) : 0; // A is 1 bit in 1555; 0 if no alpha in format
-
-    for (size_t y = starty + 1; y < endy; y += 2) {
-        uint16_t *row = pixels + y * width;
-        for (size_t x = 0; x < width; ++x, ++row) {
-            uint16_t p = *row;
-
-            // Extract 5-bit channels
-            const uint32_t r5 = (p >> Rshift) & 0x1Fu;
-            const uint32_t g5 = (p >> Gshift) & 0x1Fu;
-            const uint32_t b5 = (p >> Bshift) & 0x1Fu;
-            const uint16_t a1 = (Ashift < 16) ? (p & Amask) : 0;
-
-            // Upscale to 0..255
-            const uint32_t r8 = expand5(r5);
-            const uint32_t g8 = expand5(g5);
-            const uint32_t b8 = expand5(b5);
-
-            // Perceptual luminance (0..255)
-            const uint32_t lum = (77u*r8 + 150u*g8 + 29u*b8) >> 8;
-
-            // Dimmed versions (by 1 >> shift)
-            const uint32_t rd8 = r8 >> shift;
-            const uint32_t gd8 = g8 >> shift;
-            const uint32_t bd8 = b8 >> shift;
-
-            // Blend: darker where lum is low; preserve hue in bright areas
-            const uint32_t out_r8 = ( rd8 * (255u - lum) + r8 * lum ) >> 8;
-            const uint32_t out_g8 = ( gd8 * (255u - lum) + g8 * lum ) >> 8;
-            const uint32_t out_b8 = ( bd8 * (255u - lum) + b8 * lum ) >> 8;
-
-            // Quantize back to 5 bits
-            const uint16_t out_r5 = (uint16_t)quantize5(out_r8);
-            const uint16_t out_g5 = (uint16_t)quantize5(out_g8);
-            const uint16_t out_b5 = (uint16_t)quantize5(out_b8);
-
-            // Repack to ARGB1555 (R,G,B at their shifts; keep incoming A bit if present)
-            *row = uint16_t((out_r5 << Rshift)
-                          | (out_g5 << Gshift)
-                          | (out_b5 << Bshift)
-                          | a1);
+    uint32_t rows = palette_dirty_rows.exchange(0, std::memory_order_acq_rel);
+    while (rows) {
+        // one upload per run of changed rows
+        const int first = std::countr_zero(rows);
+        const int count = std::countr_one(rows >> first);
+        glb::update_palette_texture(&s16_rgba8[0][0], first, count);
+        rows = (first + count < 32) ? rows & ~((1u << (first + count)) - 1) : 0;
+    }
+
+    // as the CPU scanlines: odd rows at 1/2, 1/4 or 1/8
+    const float scanline = (config.video.scanlines > 0) ? 1.0f / float(1 << std::min(config.video.scanlines, 3)) : 1.0f;
+    long this_config = last_blargg_config + (1000 * config.video.scanlines);
+
+    if (!gpu_ntsc) {
+        if (this_config != last_index_config) {
+            glb::set_scanline_level(scanline);
+            last_index_config = this_config;
         }
+        return;
+    }
+
+    if (this_config != last_index_config) {
+        glb::NtscParams p;
+        p.hue        = float(setup.hue);
+        p.saturation = float(setup.saturation);
+        p.contrast   = float(setup.contrast);
+        p.brightness = float(setup.brightness);
+        p.sharpness  = float(setup.sharpness);
+        p.gamma      = float(setup.gamma);
+        p.resolution = float(setup.resolution);
+        p.artifacts  = float(setup.artifacts);
+        p.fringing   = float(setup.fringing);
+        p.bleed      = float(setup.bleed);
+        p.scanline   = scanline;
+        glb::set_ntsc_params(p);
+        last_index_config = this_config;
     }
+    glb::set_ntsc_phase(phase);
 }
 
 
-static void apply_crt_bloom(uint32_t *pixels,
-                            size_t   width,
-                            size_t   height,
-                            uint8_t  Rshift,
-                            uint8_t  Gshift,
-                            uint8_t  Bshift,
-                            uint8_t  Ashift,
-                            int      section)
+RenderSurface::BlarggKey RenderSurface::blargg_key() const {
+    return { config.video.blargg, config.video.saturation, config.video.contrast,
+             config.video.brightness, config.video.sharpness, config.video.resolution,
+             config.video.gamma, config.video.hue };
+}
+
+
+// Point ntsc at the filter table for the current settings, from the cache, or else once built.
+// A build is started if needed; wait blocks until it completes. Returns false if the table
+// isn't ready yet (ntsc is left as it was).
+bool RenderSurface::select_blargg_kernel(bool wait)
 {
-    const size_t block_height = (section >= 0 ? (height >> 1) : height);
-          size_t starty = (section == 1 ? block_height : 0);
-    const size_t endy   = starty + block_height;
-
-    // copy source so we don't pollute our reads
-    int copy_rows   = (section >= 0 ? block_height+1 : block_height);
-    int copy_start  = (section == 1 ? starty-1 : starty);
-    size_t   n      = width * height;
-    uint32_t *copy  = (uint32_t*)malloc(n * sizeof *copy);
-    if (!copy) return;
-    memcpy((copy + copy_start*width), (pixels + copy_start*width), width*copy_rows*sizeof *copy);
-
-    for (size_t y = starty; y < endy; ++y) {
-        // only do blur on the rows above/below scanlines:
-        // those are the even indices when scanlines are at odd y
-        if ((y % 2) == 0) {
-            size_t y0 = (y == 0)        ? y : y - 1;
-            size_t y1 = (y + 1 < height)? y + 1 : y;
-
-            uint32_t *dst = pixels + y*width;
-            uint32_t *row0 = copy + y0*width;
-            uint32_t *row1 = copy + y1*width;
-            uint32_t *orig = copy + y*width;
-
-            for (size_t x = 0; x < width; ++x) {
-                // unpack the three source pixels
-                uint8_t r0 = (row0[x] >> Rshift) & 0xFF;
-                uint8_t g0 = (row0[x] >> Gshift) & 0xFF;
-                uint8_t b0 = (row0[x] >> Bshift) & 0xFF;
-
-                uint8_t r1 = (row1[x] >> Rshift) & 0xFF;
-                uint8_t g1 = (row1[x] >> Gshift) & 0xFF;
-                uint8_t b1 = (row1[x] >> Bshift) & 0xFF;
-
-                uint8_t ro = (orig[x] >> Rshift) & 0xFF;
-                uint8_t go = (orig[x] >> Gshift) & 0xFF;
-                uint8_t bo = (orig[x] >> Bshift) & 0xFF;
-                uint8_t ao = (orig[x] >> Ashift) & 0xFF;
-
-                // average them (1/3 each)
-                uint8_t nr = (uint16_t(r0) + r1 + ro) / 3;
-                uint8_t ng = (uint16_t(g0) + g1 + go) / 3;
-                uint8_t nb = (uint16_t(b0) + b1 + bo) / 3;
-
-                dst[x] = (nr << Rshift)
-                       | (ng << Gshift)
-                       | (nb << Bshift)
-                       | (ao << Ashift);
+    const BlarggKey key = blargg_key();
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        // collect a finished build
+        if (blargg_build.valid() &&
+            (wait || blargg_build.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+            add_blargg_kernel(blargg_build.get());
+        }
+
+        for (auto& k : blargg_kernels) {
+            if (k.key == key) {
+                k.last_used = ++blargg_kernel_clock;
+                ntsc = k.table;
+                ntsc_serial++;
+                return true;
             }
         }
+
+        if (!blargg_build.valid()) {
+            // the build works on its own copy of the settings
+            blargg_build_key = key;
+            blargg_build = std::async(std::launch::async, [s = setup] {
+                snes_ntsc_t* table = (snes_ntsc_t*) malloc(sizeof(snes_ntsc_t));
+                if (table) snes_ntsc_init(table, &s);
+                return table;
+            });
+        }
+        if (!wait) return false;
+    }
+    std::cerr << "Blargg filter table allocation failed.\n";
+    return false;
+}
+
+
+// Add a newly built table to the cache, replacing the least recently used one other than the
+// table in use when the cache is full. Only called whilst no render bands are running.
+void RenderSurface::add_blargg_kernel(snes_ntsc_t* table)
+{
+    if (!table) return;
+
+    const size_t capacity = size_t(std::max(config.video.blargg_tables, 2));
+    while (blargg_kernels.size() >= capacity) {
+        auto lru = blargg_kernels.end();
+        for (auto it = blargg_kernels.begin(); it != blargg_kernels.end(); ++it)
+            if (it->table != ntsc && (lru == blargg_kernels.end() || it->last_used < lru->last_used))
+                lru = it;
+        if (lru == blargg_kernels.end()) break;
+        free(lru->table);
+        blargg_kernels.erase(lru);
     }
-    free(copy);
+    blargg_kernels.push_back({ blargg_build_key, table, ++blargg_kernel_clock });
 }
 
 
@@ -1258,100 +1770,166 @@ int RenderSurface::get_blargg_config() {
 }
 
 
-void RenderSurface::draw_frame(uint16_t* pixels, int fastpass)
+// RGBA8888 (R in the low byte) to the RGB5551 the 16-bit game texture takes
+static void pack_rgb5551(uint16_t* dst, const uint32_t* src, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t p = src[i];
+        dst[i] = uint16_t(((p & 0xF8) << 8) | ((p >> 5) & 0x07C0) | ((p >> 18) & 0x003E) | 1);
+    }
+}
+
+// With video.gpu_scanlines the CRT shader (or the pass-through shader) dims the scanlines as it
+// draws the game image, and the CPU passes are skipped. The palette index passes dim them
+// themselves, from config.video.scanlines.
+// Bake one tile of the shadow mask for the CRT shader, when its settings have changed: columns
+// of maskPitch pixels, the first of each dimmed, with every other column offset by half the tile
+// height, and a dimmed row at the top of each.
+void RenderSurface::set_shadow_mask()
+{
+    const int  pitch       = std::clamp(config.video.mask_size, 3, 6);
+    const bool on          = config.video.shadow_mask == 2;
+    const long this_config = pitch + 10 * on + 100 * config.video.maskDim + 100000 * config.video.maskBoost;
+    if (this_config == last_mask_config)
+        return;
+    last_mask_config = this_config;
+
+    auto level = [](int percent) { return uint8_t(std::clamp(percent * 255 / 200, 0, 255)); };
+    const uint8_t off_level = on ? level(config.video.maskDim)   : level(100);
+    const uint8_t on_level  = on ? level(config.video.maskBoost) : level(100);
+
+    const int w = 2 * pitch, h = 2 * (pitch - 2);
+    uint8_t tile[12 * 8];
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            const bool second = x >= pitch;
+            const bool row    = y == (second ? h / 2 : 0);
+            tile[y * w + x]   = (x % pitch != 0 && !row) ? on_level : off_level;
+        }
+    glb::set_shadow_mask(tile, w, h);
+}
+
+int RenderSurface::cpu_scanlines() const
+{
+    return (config.video.gpu_scanlines && !gpu_indexed()) ? 0 : config.video.scanlines;
+}
+
+// Filter rows [first_row, end_row), then apply the scanlines and bloom. With blargg16 the
+// rows are filtered a few at a time into a buffer that stays in cache, then packed to 16 bits
+// in the surface, so half as much is written to it and uploaded from it.
+void RenderSurface::blargg_rows(uint16_t* pixels, uint32_t* outputPixels, int first_row, int end_row,
+                                int scanlines)
+{
+    auto bloom = [&](uint32_t* image, int height, int row, int end) {
+        if (config.video.scanlines!=0 && config.video.crt_bloom)
+            apply_crt_bloom(image, snes_src_width, height, Rshift, Gshift, Bshift, Ashift, row, end);
+    };
+
+    if (!blargg16) {
+        const bool scanlines_done = blargg_filter(pixels, outputPixels + long(first_row) * snes_src_width,
+                                                  first_row, end_row - first_row, scanlines);
+        // apply scanlines, if enabled and not already applied by the filter, then the bloom
+        if (scanlines!=0 && !scanlines_done)
+            apply_scanlines(outputPixels, snes_src_width, src_height, scanlines,
+                            Rshift, Gshift, Bshift, Ashift, first_row, end_row);
+        bloom(outputPixels, src_height, first_row, end_row);
+        return;
+    }
+
+    // Bloom reads the rows either side, so then a whole run is filtered at once. The buffer
+    // starts on an even row of the image, keeping the scanlines on odd rows.
+    static const int CHUNK_ROWS = 16;
+    static thread_local std::vector<uint32_t> chunk;
+    const int chunk_rows = config.video.crt_bloom ? end_row - first_row : CHUNK_ROWS;
+    chunk.resize(size_t(chunk_rows + 1) * snes_src_width + 16);
+    // 64-byte aligned, as the hi-res blitter needs
+    uint32_t* image = reinterpret_cast<uint32_t*>((reinterpret_cast<uintptr_t>(chunk.data()) + 63) & ~uintptr_t(63));
+
+    uint16_t* out16 = reinterpret_cast<uint16_t*>(outputPixels);
+    for (int row = first_row; row < end_row; row += chunk_rows) {
+        const int end  = std::min(row + chunk_rows, end_row);
+        const int base = row & ~1;
+        const int rows = end - base;
+        if (!blargg_filter(pixels, image + long(row - base) * snes_src_width, row, end - row, scanlines) && scanlines!=0)
+            apply_scanlines(image, snes_src_width, rows, scanlines,
+                            Rshift, Gshift, Bshift, Ashift, row - base, rows);
+        bloom(image, rows, row - base, rows);
+        pack_rgb5551(out16 + long(row) * snes_src_width, image + long(row - base) * snes_src_width,
+                     size_t(end - row) * snes_src_width);
+    }
+}
+
+void RenderSurface::draw_frame(uint16_t* pixels, int band, int bands)
 {
     // grabs the S16 frame buffer ('pixels') and stores it, either
-	// as straight SDL RGB or SNES RGB, then applies Blargg filter, if enabled, and colour mapping
-    // fastpass (ignored if Blargg filter is not enabled):
-    //   -1 = disabled; the whole frame is processed as well as the control values
-    //    0 = enabled;  process the top half of the image with Blargg filter (if enabled) and control values
-	//    1 = enabled;  only process the lower half of the image with Blargg filter (if enabled) then return
+	// as straight SDL RGB or SNES RGB, then applies Blargg filter, if enabled, and colour mapping.
+    // The image is split into 'bands' horizontal bands of near-equal height, which can be
+    // processed concurrently; this call processes band number 'band' (0 to bands-1).
+    // bands = 1 processes the whole frame.
+    // Per-frame control values (burst phase, filter settings) are updated in swap_buffers().
 
     if (config.videoRestartRequired) return;
 
-    // check is disable() is waiting
-    if (shutting_down.load(std::memory_order_acquire)) return;
-    activity_counter.fetch_add(1, std::memory_order_acq_rel);
+    // not while disable() is waiting
+    if (!begin_activity()) return;
 
-    // Snapshot the current write pointer under the lock (race-proof target for this call)
-    void* current_writePixels;
-    {
-        std::lock_guard<std::mutex> lock(drawFrameMutex);
-        current_writePixels = GameSurfacePixels;
-    }
+    // Snapshot the current write pointer (race-proof target for this call)
+    void* current_writePixels = GameSurfacePixels.load(std::memory_order_acquire);
 
-    if (blargg) {
+    // rows covered by this band
+    bands = std::clamp(bands, 1, src_height);
+    band  = std::clamp(band, 0, bands - 1);
+    const int first_row = (src_height * band) / bands;
+    const int end_row   = (src_height * (band + 1)) / bands;
+
+    if (gpu_indexed()) {
+        // palette indices as they are; lookup, filter and scanlines are applied by the GPU
+        std::memcpy(static_cast<uint16_t*>(current_writePixels) + (size_t(first_row) * src_width),
+                    pixels + (size_t(first_row) * src_width),
+                    size_t(end_row - first_row) * src_width * sizeof(uint16_t));
+    } else if (blargg) {
         pixels = (uint16_t*)__builtin_assume_aligned(pixels, 4);
         uint32_t* writePixels = (uint32_t*)__builtin_assume_aligned(current_writePixels, 4);
-        if (fastpass!=1) {
-            if (config.fps == 60) phase = (phase + 1) % 3; // cycle through 0/1/2
-            else                  phase = (phase + 2) % 3; // cycle through 0/1/2, but at twice the rate
-        }
-        blargg_filter(pixels, writePixels, fastpass);
-        // apply scanlines, if enabled.
-        if (config.video.scanlines!=0) {
-            apply_scanlines(writePixels, snes_src_width, src_height, config.video.scanlines,
-                            Rshift, Gshift, Bshift, Ashift, fastpass);
-//            apply_crt_bloom(writePixels, snes_src_width, src_height,
-//                            Rshift, Gshift, Bshift, Ashift, fastpass);
+        const int scanlines = cpu_scanlines();
+        auto filter_rows = [&](int row, int end) { blargg_rows(pixels, writePixels, row, end, scanlines); };
+
+        if (frame_key == 0) {
+            filter_rows(first_row, end_row);
+        } else {
+            // filter just the runs of rows that no surface holds for this input and phase
+            for (int row = first_row; row < end_row; ) {
+                if (reuse_row(pixels, writePixels, row)) { row++; continue; }
+                int end = row + 1;
+                while (end < end_row && !reuse_row(pixels, writePixels, end)) end++;
+                filter_rows(row, end);
+                row = end + 1;  // row 'end', if in this band, was reused
+            }
         }
-    } else if (fastpass!=1) {
+    } else {
         // Standard image processing; direct RGB value lookup from rgb array for backbuffer
-        // Single-threaded only for standard path
-        size_t pixel_count = src_width * src_height;
-        uint32_t Ashifted = uint32_t(Alevel) << Ashift;
+        size_t first_pixel = size_t(first_row) * src_width;
+        size_t end_pixel   = size_t(end_row) * src_width;
 
         // translate game image to S16-correct RGB output levels
         pixels = (uint16_t*)__builtin_assume_aligned(pixels, 4);
         uint16_t* writePixels = (uint16_t*)__builtin_assume_aligned(current_writePixels, 4);
         uint16_t* spix = pixels;
         uint16_t* tpix = writePixels;
-        for (size_t i = 0; i < pixel_count; i+=4) {
+        for (size_t i = first_pixel; i < end_pixel; i+=4) {
             tpix[i+0] = s16_rgb555[spix[i+0]];
             tpix[i+1] = s16_rgb555[spix[i+1]];
             tpix[i+2] = s16_rgb555[spix[i+2]];
             tpix[i+3] = s16_rgb555[spix[i+3]];
         }
 
-        // apply scanlines, if enabled (full frame single-thread)
-        if (config.video.scanlines!=0) {
-            writePixels = tpix; // reset
-            apply_scanlines(writePixels, src_width, src_height, config.video.scanlines,
-                            1,6,11,0,-1);
-//                            Rshift, Gshift, Bshift, Ashift, -1);
-//            apply_crt_bloom(writePixels, src_width, src_height,
-//                            Rshift, Gshift, Bshift, Ashift, -1);
-        }
-    }
-
-    if ((fastpass!=1) && (!config.videoRestartRequired)) {
-        // Check for any changes to the configured video settings (that don't require full SDL restart)
-        // Blargg filter settings. Changing these requires Blargg filter re-initialisation.
-        int this_blargg_config = get_blargg_config();
-        if (this_blargg_config != last_blargg_config) {
-            // Settings have been changed; capture new setting & re-initiatise the Blargg filter library
-            // The filter uses doubles internally, so we need to convert the config values to doubles.
-            last_blargg_config =  this_blargg_config;
-            blargg             =  config.video.blargg;
-            setup.saturation   =  double(config.video.saturation) / 100;
-            setup.contrast     =  double(config.video.contrast) / 100;
-            setup.brightness   =  double(config.video.brightness) / 100;
-            setup.sharpness    =  double(config.video.sharpness) / 100;
-            setup.resolution   =  double(config.video.resolution) / 100;
-            setup.gamma        =  double(config.video.gamma) / 10;
-            setup.hue          =  double(config.video.hue) / 100;
-
-            // pause video whilst this is re-calculated
-            drawFrameMutex.lock();
-            //destroy_buffers();
-            init_blargg_filter();
-            //create_buffers();
-            drawFrameMutex.unlock();
+        // apply scanlines, if enabled
+        if (cpu_scanlines()!=0) {
+            apply_scanlines(writePixels, src_width, src_height, cpu_scanlines(),
+                            1,6,11,0, first_row, end_row);
+//                            Rshift, Gshift, Bshift, Ashift, first_row, end_row);
         }
     }
 
-    // notify disable() that we're done
-    activity_counter.fetch_sub(1, std::memory_order_acq_rel);
-    std::unique_lock<std::mutex> lock(mtx);
-    cv.notify_all();  // In case disable() is waiting
+    end_activity();
 }
@@ -16,7 +16,9 @@
 #include <SDL.h>
 #include <mutex>
 #include <atomic>
-#include <condition_variable>
+#include <future>
+#include <array>
+#include <vector>
 #include "gl_backend.hpp"   // tiny ES2 backend
 
 class RenderSurface : public RenderBase
@@ -36,19 +38,48 @@ public:
     void disable();
     bool start_frame() {return true;};
     bool finalize_frame();
-    void draw_frame(uint16_t* pixels, int fastpass);
+    void draw_frame(uint16_t* pixels, int band, int bands);
+    void upload_frame(int band, int bands);
+    void set_threaded_present(bool on) { threaded_present = on; }
+    bool supports_window();
+    bool repeat_frame(bool black);
+    bool hold_frame();
 
 private:
     // SDL2 window
     SDL_Window* window = 0;
 
     SDL_Surface* overlaySurface;
-    SDL_Surface* GameSurface[2];
-
-    int current_game_surface = 0;
-    void* GameSurfacePixels = nullptr;
+    // Triple-buffered game surfaces: one being drawn, the newest complete frame, and the one
+    // being shown. swap_buffers() and finalize_frame() each own one index and trade it for the
+    // ready one with an atomic exchange, so neither waits on the other.
+    static const int GAME_SURFACES = 3;
+    static const int FRAME_READY   = 4;  // flag in ready_game_surface: holds a frame not yet shown
+    SDL_Surface* GameSurface[GAME_SURFACES] = {};
+
+    int current_game_surface = 0;             // being drawn (swap_buffers() side)
+    std::atomic<int> ready_game_surface{1};   // newest complete frame, plus FRAME_READY
+    int shown_game_surface   = 2;             // last uploaded (finalize_frame() side)
+    bool threaded_present    = false;         // finalize_frame() runs on another thread to swap_buffers()
+    std::atomic<void*> GameSurfacePixels{nullptr}; // draw_frame() target for this frame
     uint32_t* overlaySurfacePixels = nullptr;
     uint32_t FrameCounter = 0; // enough space for over 2 years of continuous operation at 60fps
+    bool texture_current = false; // game texture already holds the frame being drawn (upload_frame)
+    bool texture_loaded  = false; // game texture holds the last frame uploaded (nothing since init)
+
+    // Static frames (see hold_frame): the frame to be drawn isn't, and the last stays the newest.
+    // The settings the next frame will be drawn with, and those the newest was.
+    bool     frame_held     = false;
+    uint64_t frame_settings = 0;
+    uint64_t drawn_key      = ~uint64_t(0);
+    uint64_t output_key() const;
+
+    // GPU pixel buffer ring (see glb::init_game_buffers). When in use, draw_frame() writes the
+    // frame into a mapped buffer rather than GameSurface; -1 means the frame is in GameSurface.
+    int buffer_write = -1;        // buffer being drawn into this frame
+    int buffer_ready = -1;        // buffer holding the last complete frame
+    int buffer_next  = 0;         // next buffer of the ring to map
+    int buffer_shown = -1;        // buffer last uploaded to the game texture
 
     // SDL2 texture
     SDL_Texture *game_tx = 0;        // game image
@@ -65,22 +96,56 @@ private:
     int anchor_y = 0;
 
     // internal functions
-    void create_buffers();
-    void destroy_buffers();
-    void init_blargg_filter();
+    void init_blargg_filter(bool wait = true);
     void set_scaling();
     bool init_sdl(int video_mode);
+    static bool kmsdrm();
     void init_overlay();
+    bool find_overlay(std::vector<uint8_t>& a8);
+    void store_overlay(const std::vector<uint8_t>& a8);
+    void save_overlay_cache();
+    std::string overlay_cache_file() const;
     long get_video_config();
     int  get_blargg_config();
-    void blargg_filter(uint16_t* pixels, uint32_t* outputPixels, int section);
+    bool blargg_filter(uint16_t* pixels, uint32_t* outputRows, int first_row, int rows, int scanlines);
+    void blargg_rows(uint16_t* pixels, uint32_t* outputRows, int first_row, int end_row, int scanlines);
+    bool reuse_row(const uint16_t* pixels, void* outputPixels, int row);
+    uint64_t row_reuse_key() const;
+    void update_frame_controls();
+    void update_index_controls();
+    bool select_blargg_kernel(bool wait);
+    void add_blargg_kernel(snes_ntsc_t* table);
 
     // constants
     const int BPP = 32;
 
     // Blargg filter related
     snes_ntsc_setup_t setup;
-    snes_ntsc_t* ntsc = 0;
+    snes_ntsc_t* ntsc = 0;                  // table in use, from blargg_kernels
+
+    // Blargg filter table cache, keyed on the filter settings. A table is 32MB and slow to build,
+    // so one not in the cache is built on a background thread whilst the current one stays in
+    // use, and swapped in when ready (see select_blargg_kernel).
+    using BlarggKey = std::array<int, 8>;
+    struct BlarggKernel {
+        BlarggKey key;
+        snes_ntsc_t* table;
+        uint64_t last_used;
+    };
+    std::vector<BlarggKernel> blargg_kernels;
+    std::future<snes_ntsc_t*> blargg_build;  // table being built, if valid()
+    BlarggKey blargg_build_key{};
+    uint64_t  blargg_kernel_clock   = 0;
+    bool      blargg_kernel_pending = false; // ntsc doesn't match the settings yet
+    BlarggKey blargg_key() const;
+    uint32_t  ntsc_serial = 0;              // changes whenever ntsc does
+
+    // Blargg row reuse (see reuse_row). For each game surface, a hash per row of the S16 image
+    // that row was filtered from (0 = not known), and the filter settings and burst phase the
+    // rows were filtered with, as row_reuse_key() (0 = none usable).
+    std::vector<uint64_t> row_hashes[GAME_SURFACES];
+    uint64_t row_key[GAME_SURFACES] = {};
+    uint64_t frame_key = 0;                 // the frame being drawn; 0 = rows aren't reused
     int snes_src_width;
     int phase;
     int phaseframe;
@@ -89,6 +154,14 @@ private:
     int scale           = 0;
     int flags           = 0;  // SDL flags
     int blargg          = 0;  // current Blargg filter value
+    bool gpu_ntsc       = false; // Blargg filter replaced by the GPU NTSC pass (glb::init_ntsc)
+    bool blargg16       = false; // Blargg filter output packed to RGB5551 (video.blargg_16bit)
+    bool gpu_palette    = false; // palette lookup by the GPU (glb::init_palette_lookup)
+    long last_index_config = -1; // filter/scanline settings last sent to the GPU pass
+    long last_mask_config  = -1; // shadow mask settings last baked (set_shadow_mask)
+    bool gpu_indexed() const { return gpu_ntsc || gpu_palette; } // surfaces hold palette indices
+    int  cpu_scanlines() const;  // scanline level for the CPU passes (0 where a shader dims them)
+    void set_shadow_mask();      // bake the shader's shadow mask tile, when its settings change
 
     // GLSL shader related settings
     std::string vs;
@@ -99,22 +172,16 @@ private:
 
     // working buffers for video processing
     uint32_t* game_pixels = 0;
-    uint16_t* rgb_pixels = 0;            // used by Blargg filter
 
-	// Locks due to threaded activity
-	std::mutex drawFrameMutex, finalizeFrameMutex, gpuMutex;
+	// The GL context, when frames are presented from another thread (see gpu_lock)
+	std::mutex gpuMutex;
+    std::unique_lock<std::mutex> gpu_lock();
 
-    // Locks to enable safe disable() call
-    std::atomic<int> activity_counter{0}; // track ongoing iterations
-    std::mutex mtx;
-    std::condition_variable cv;
+    // Frame work under way, so that disable() can wait for it (see begin_activity)
+    std::atomic<int> activity_counter{0};
     std::atomic<bool> shutting_down{false};
-
-    // Synchronize fastpass (top/bottom) halves per frame
-    std::mutex                fastpassMutex;
-    std::condition_variable   fastpassCV;
-    int                       fastpassArrivals = 0;   // 0 → 1 → 2 then reset
-    bool                      fastpassPostFxDone = false; // lets the first waiter proceed
+    bool begin_activity();
+    void end_activity();
 
     // keep track of UI settings changes
     int  last_blargg_config    = 0;
@@ -128,4 +195,20 @@ private:
     // LUTs for init_overlay()
     std::vector<float> dx1, dx2, dx3, dx4, dx5;
     std::vector<float> dy1, dy2, dy3, dy4, dy5;
+
+    // Overlay masks already built, keyed on the size and settings they were built for, so that
+    // returning to a setting is instant. The mask in use is also kept on disk for the next start
+    // (see save_overlay_cache).
+    static const int OVERLAY_MASKS = 4;
+    using OverlayKey = std::array<int, 6>;
+    struct OverlayMask {
+        OverlayKey key;
+        std::vector<uint8_t> a8;
+        uint64_t last_used;
+    };
+    std::vector<OverlayMask> overlay_masks;
+    uint64_t   overlay_clock = 0;
+    OverlayKey overlay_shown{};     // mask last uploaded
+    OverlayKey overlay_file{};      // mask held in the disk cache
+    OverlayKey overlay_key() const;
 };
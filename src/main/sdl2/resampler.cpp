@@ -0,0 +1,121 @@
+/*****************************************************************************
+  resampler.cpp, Copyright (c) 2025 James Pearce
+
+  Polyphase windowed-sinc resampler for the sound chip output. See
+  resampler.hpp.
+*****************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "sdl2/resampler.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+void Resampler::init(uint32_t in, uint32_t out)
+{
+    frames_in  = in;
+    frames_out = out;
+    if (in == 0 || out == 0) {
+        frames_in = frames_out = 0;
+        return;
+    }
+
+    // Cut-off a little below the lower of the two Nyquist rates, in input frames
+    const double cutoff = 0.45 * std::min(1.0, double(out) / double(in));
+
+    // Kaiser window, beta 7 (about 70dB stop band)
+    const double beta = 7.0;
+    auto bessel_i0 = [](double x) {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; k++) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum  += term;
+        }
+        return sum;
+    };
+
+    coeffs.assign(size_t(PHASES) * TAPS, 0);
+    for (int p = 0; p < PHASES; p++) {
+        // the output lies p/PHASES of a frame after tap TAPS/2 - 1
+        double h[TAPS], sum = 0.0;
+        for (int t = 0; t < TAPS; t++) {
+            const double x = double(t - (TAPS / 2 - 1)) - double(p) / PHASES;
+            const double w = x / (TAPS / 2);
+            const double window = std::fabs(w) >= 1.0 ? 0.0
+                                : bessel_i0(beta * std::sqrt(1.0 - w * w)) / bessel_i0(beta);
+            const double sinc = x == 0.0 ? 1.0 : std::sin(M_PI * 2.0 * cutoff * x) / (M_PI * 2.0 * cutoff * x);
+            h[t] = window * sinc;
+            sum += h[t];
+        }
+        // unity gain at DC for every phase
+        for (int t = 0; t < TAPS; t++)
+            coeffs[size_t(p) * TAPS + t] = int16_t(std::lround(h[t] / sum * 32767.0));
+    }
+
+    hist_l.assign(TAPS - 1 + in, 0);
+    hist_r.assign(TAPS - 1 + in, 0);
+}
+
+
+// Sum of TAPS products of Q15 coefficients and samples
+static inline int32_t dot(const int16_t* h, const int16_t* x)
+{
+#if defined(__SSE2__)
+    __m128i acc = _mm_add_epi32(
+        _mm_madd_epi16(_mm_loadu_si128((const __m128i*) h),       _mm_loadu_si128((const __m128i*) x)),
+        _mm_madd_epi16(_mm_loadu_si128((const __m128i*) (h + 8)), _mm_loadu_si128((const __m128i*) (x + 8))));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON)
+    int32x4_t acc = vmull_s16(vld1_s16(h), vld1_s16(x));
+    acc = vmlal_s16(acc, vld1_s16(h + 4),  vld1_s16(x + 4));
+    acc = vmlal_s16(acc, vld1_s16(h + 8),  vld1_s16(x + 8));
+    acc = vmlal_s16(acc, vld1_s16(h + 12), vld1_s16(x + 12));
+    const int32x2_t s = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    return vget_lane_s32(vpadd_s32(s, s), 0);
+#else
+    int32_t acc = 0;
+    for (int t = 0; t < Resampler::TAPS; t++)
+        acc += int32_t(h[t]) * x[t];
+    return acc;
+#endif
+}
+
+
+void Resampler::process(const int16_t* in, int16_t* out)
+{
+    if (!active()) return;
+
+    // de-interleave after the frames kept from the last call
+    int16_t* l = hist_l.data();
+    int16_t* r = hist_r.data();
+    for (uint32_t i = 0; i < frames_in; i++) {
+        l[TAPS - 1 + i] = in[2 * i];
+        r[TAPS - 1 + i] = in[2 * i + 1];
+    }
+
+    // output k is at input frame k * frames_in / frames_out, found exactly in integers
+    for (uint32_t k = 0; k < frames_out; k++) {
+        const uint32_t pos   = k * frames_in;
+        const uint32_t frame = pos / frames_out;
+        const uint32_t phase = uint32_t(uint64_t(pos % frames_out) * PHASES / frames_out);
+        const int16_t* h = &coeffs[size_t(phase) * TAPS];
+
+        // frame sits at tap TAPS/2 - 1, so the filter reaches TAPS/2 frames into the future
+        const int32_t sl = (dot(h, l + frame) + (1 << 14)) >> 15;
+        const int32_t sr = (dot(h, r + frame) + (1 << 14)) >> 15;
+        out[2 * k]     = int16_t(std::clamp(sl, -32768, 32767));
+        out[2 * k + 1] = int16_t(std::clamp(sr, -32768, 32767));
+    }
+
+    // keep the last TAPS - 1 frames for the next call
+    std::memmove(l, l + frames_in, (TAPS - 1) * sizeof(int16_t));
+    std::memmove(r, r + frames_in, (TAPS - 1) * sizeof(int16_t));
+}
@@ -0,0 +1,44 @@
+/*****************************************************************************
+  resampler.hpp, Copyright (c) 2025 James Pearce
+
+  Polyphase windowed-sinc resampler for the sound chip output, so that the
+  SegaPCM and YM2151 can run at a lower internal rate (or, for the PCM, its
+  native 31.25kHz) than the audio device.
+
+  Each call converts one audio tick: a fixed number of stereo frames in to a
+  fixed number out, so the ratio is exact and there is no drift. Filter
+  taps are 16-bit fixed point, so the dot products use SSE2 or NEON where
+  available.
+*****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Resampler
+{
+public:
+    static const int TAPS   = 16;   // taps per phase (8 zero crossings either side)
+    static const int PHASES = 128;  // filter phases between two input frames
+
+    // Set up for frames_in stereo frames in, frames_out out, per call
+    void init(uint32_t frames_in, uint32_t frames_out);
+    bool active() const { return frames_in != 0; }
+
+    // in: frames_in interleaved stereo frames; out: frames_out interleaved stereo frames
+    void process(const int16_t* in, int16_t* out);
+
+    uint32_t get_frames_in()  const { return frames_in; }
+    uint32_t get_frames_out() const { return frames_out; }
+
+private:
+    uint32_t frames_in  = 0;
+    uint32_t frames_out = 0;
+
+    // Q15 coefficients, TAPS per phase
+    std::vector<int16_t> coeffs;
+
+    // planar input, led by the last TAPS - 1 frames of the previous call
+    std::vector<int16_t> hist_l, hist_r;
+};
@@ -0,0 +1,227 @@
+/***************************************************************************
+    CPU Scanline Effect.
+
+    Dims the odd rows of a band of the game image, blended by luminance so
+    that bright areas keep their colour. Used by the SDL2 renderer, and
+    kept in a header so that the kernel benchmarks (src/bench) can time
+    the same code.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "snes_ntsc.h"   // SIMD selection and the scanline vector macros
+
+// CPU-side scanlines. These are applied to (and so align with) the game image, which generally looks better
+// Processes rows starty to endy-1 of the image. Scanlines always fall on odd rows of the whole
+// image, so any band of rows can be processed independently.
+// The Blargg hi-res blitter applies the same dimming as it writes each row (see
+// snes_ntsc_blit_hires_fast), so these passes are used by the other output paths.
+
+// shift masks
+static const uint32_t masks[4] = { 0xFFFFFFFFu, 0xFEFEFEFEu, 0xFCFCFCFCu, 0xF8F8F8F8u };
+
+static inline void apply_scanlines(uint32_t *pixels,
+                                     size_t width, size_t height,
+                                     uint8_t shift,
+                                     uint8_t Rshift, uint8_t Gshift, uint8_t Bshift, uint8_t Ashift,
+                                     size_t  starty, size_t endy)
+{
+    uint32_t mask   = masks[shift & 3];
+    uint32_t AMask  = 0xFFu << Ashift;   // preserve alpha bits
+
+    if (endy > height) endy = height;
+
+#ifdef SNES_NTSC_SCANLINE
+    // four pixels at a time for the RGBA layout the Blargg blitters output (R in the low byte)
+    const bool simd = (Rshift == 0) && (Gshift == 8) && (Bshift == 16) && (Ashift == 24);
+    SET_SNES_SCANLINE_VECTORS(shift);
+#endif
+
+    for (size_t y = (starty | 1); y < endy; y += 2) {
+        uint32_t *row = pixels + y * width;
+        size_t x = 0;
+#ifdef SNES_NTSC_SCANLINE
+        if (simd) {
+            for (; x + 4 <= width; x += 4, row += 4) {
+                auto v = SNES_NTSC_RGB_LOAD_U(row);
+                SNES_NTSC_SCANLINE(v);
+                SNES_NTSC_RGB_STORE_U(row, v);
+            }
+        }
+#endif
+        for (; x < width; x++, row++) {
+            uint32_t p = *row;
+
+            // 1) unpack each channel using its shift
+            uint8_t r = (p >> Rshift) & 0xFF;
+            uint8_t g = (p >> Gshift) & 0xFF;
+            uint8_t b = (p >> Bshift) & 0xFF;
+            uint8_t a = (p >> Ashift) & 0xFF;
+
+            // 2) compute perceptual luminance (0–255)
+            uint8_t lum = ( ( 77 * r
+                            +150 * g
+                            + 29 * b ) >> 8 );
+
+            // 3) apply the scanline “dim” to each channel
+            uint8_t rd = r >> shift;
+            uint8_t gd = g >> shift;
+            uint8_t bd = b >> shift;
+
+            // 4) blend original+dimmed by (255−lum)/255
+            uint8_t out_r = ( rd * (255 - lum) + r * lum ) >> 8;
+            uint8_t out_g = ( gd * (255 - lum) + g * lum ) >> 8;
+            uint8_t out_b = ( bd * (255 - lum) + b * lum ) >> 8;
+
+            // 5) repack into the pixel
+            *row = (out_r << Rshift)
+                 | (out_g << Gshift)
+                 | (out_b << Bshift)
+                 | (a     << Ashift);
+        }
+    }
+}
+
+
+// == 16-bit ARGB1555 ==
+static inline void apply_scanlines(uint16_t *pixels,
+                                   size_t width, size_t height,
+                                   uint8_t shift,
+                                   uint8_t Rshift, uint8_t Gshift, uint8_t Bshift, uint8_t Ashift,
+                                   size_t  starty, size_t endy)
+{
+    // Helper lambdas to scale between 5-bit and 8-bit without branches
+    auto expand5  = [](uint32_t v5) -> uint32_t { return (v5 << 3) | (v5 >> 2); };                 // 0..31 -> 0..255
+    auto quantize5 = [](uint32_t v8) -> uint32_t { return (v8 >> 3); };             // 0..255 -> 0..31
+
+    if (endy > height) endy = height;
+
+    const uint16_t Amask = (Ashift < 16) ? (uint16_t(1u) << Ashift) : 0; // A is 1 bit in 1555; 0 if no alpha in format
+
+#if SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_X86_LEVEL)
+    // eight pixels at a time in 16-bit lanes; the sums fit as 77+150+29 = 256
+    const __m128i c31  = _mm_set1_epi16(0x1F);
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i amask = _mm_set1_epi16(short(Amask));
+    const __m128i sr = _mm_cvtsi32_si128(Rshift), sg = _mm_cvtsi32_si128(Gshift);
+    const __m128i sb = _mm_cvtsi32_si128(Bshift), sd = _mm_cvtsi32_si128(shift);
+    auto expand  = [&](__m128i v, __m128i s) {
+        const __m128i c = _mm_and_si128(_mm_srl_epi16(v, s), c31);
+        return _mm_or_si128(_mm_slli_epi16(c, 3), _mm_srli_epi16(c, 2));
+    };
+    auto blend = [&](__m128i c, __m128i lum, __m128i inv, __m128i s) {
+        const __m128i d = _mm_mullo_epi16(_mm_srl_epi16(c, sd), inv);
+        const __m128i o = _mm_srli_epi16(_mm_add_epi16(d, _mm_mullo_epi16(c, lum)), 8 + 3);
+        return _mm_sll_epi16(o, s);
+    };
+#elif SNES_NTSC_HAVE_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+    const uint16x8_t c31  = vdupq_n_u16(0x1F);
+    const uint16x8_t c255 = vdupq_n_u16(255);
+    const uint16x8_t amask = vdupq_n_u16(Amask);
+    const int16x8_t  sd = vdupq_n_s16(-int16_t(shift));
+    auto expand = [&](uint16x8_t v, int s) {
+        const uint16x8_t c = vandq_u16(vshlq_u16(v, vdupq_n_s16(-int16_t(s))), c31);
+        return vorrq_u16(vshlq_n_u16(c, 3), vshrq_n_u16(c, 2));
+    };
+    auto blend = [&](uint16x8_t c, uint16x8_t lum, uint16x8_t inv, int s) {
+        const uint16x8_t o = vmlaq_u16(vmulq_u16(vshlq_u16(c, sd), inv), c, lum);
+        return vshlq_u16(vshrq_n_u16(o, 8 + 3), vdupq_n_s16(int16_t(s)));
+    };
+#endif
+
+    for (size_t y = (starty | 1); y < endy; y += 2) {
+        uint16_t *row = pixels + y * width;
+        size_t x = 0;
+#if SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_X86_LEVEL)
+        for (; x + 8 <= width; x += 8, row += 8) {
+            const __m128i p  = _mm_loadu_si128((const __m128i*)row);
+            const __m128i r8 = expand(p, sr), g8 = expand(p, sg), b8 = expand(p, sb);
+            const __m128i lum = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(
+                                    _mm_mullo_epi16(r8, _mm_set1_epi16(77)), _mm_mullo_epi16(g8, _mm_set1_epi16(150))),
+                                    _mm_mullo_epi16(b8, _mm_set1_epi16(29))), 8);
+            const __m128i inv = _mm_sub_epi16(c255, lum);
+            const __m128i out = _mm_or_si128(_mm_or_si128(blend(r8, lum, inv, sr), blend(g8, lum, inv, sg)),
+                                             _mm_or_si128(blend(b8, lum, inv, sb), _mm_and_si128(p, amask)));
+            _mm_storeu_si128((__m128i*)row, out);
+        }
+#elif SNES_NTSC_HAVE_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+        for (; x + 8 <= width; x += 8, row += 8) {
+            const uint16x8_t p  = vld1q_u16(row);
+            const uint16x8_t r8 = expand(p, Rshift), g8 = expand(p, Gshift), b8 = expand(p, Bshift);
+            const uint16x8_t lum = vshrq_n_u16(vmlaq_n_u16(vmlaq_n_u16(vmulq_n_u16(r8, 77), g8, 150), b8, 29), 8);
+            const uint16x8_t inv = vsubq_u16(c255, lum);
+            const uint16x8_t out = vorrq_u16(vorrq_u16(blend(r8, lum, inv, Rshift), blend(g8, lum, inv, Gshift)),
+                                             vorrq_u16(blend(b8, lum, inv, Bshift), vandq_u16(p, amask)));
+            vst1q_u16(row, out);
+        }
+#elif SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_HAVE_RVV)
+        // strip-mined over the whole row, so no remainder
+        for (size_t vl; x < width; x += vl, row += vl) {
+            vl = __riscv_vsetvl_e16m1(width - x);
+            const vuint16m1_t p = __riscv_vle16_v_u16m1(row, vl);
+            // (vector types can't be captured, so they're passed in)
+            auto expand = [vl](vuint16m1_t p, int s) {
+                const vuint16m1_t c = __riscv_vand_vx_u16m1(__riscv_vsrl_vx_u16m1(p, s, vl), 0x1F, vl);
+                return __riscv_vor_vv_u16m1(__riscv_vsll_vx_u16m1(c, 3, vl), __riscv_vsrl_vx_u16m1(c, 2, vl), vl);
+            };
+            const vuint16m1_t r8 = expand(p, Rshift), g8 = expand(p, Gshift), b8 = expand(p, Bshift);
+            vuint16m1_t lum = __riscv_vmul_vx_u16m1(r8, 77, vl);
+            lum = __riscv_vmacc_vx_u16m1(lum, 150, g8, vl);
+            lum = __riscv_vsrl_vx_u16m1(__riscv_vmacc_vx_u16m1(lum, 29, b8, vl), 8, vl);
+            const vuint16m1_t inv = __riscv_vrsub_vx_u16m1(lum, 255, vl);
+            auto blend = [vl, shift](vuint16m1_t c, vuint16m1_t lum, vuint16m1_t inv, int s) {
+                vuint16m1_t o = __riscv_vmul_vv_u16m1(__riscv_vsrl_vx_u16m1(c, shift, vl), inv, vl);
+                o = __riscv_vsrl_vx_u16m1(__riscv_vmacc_vv_u16m1(o, c, lum, vl), 8 + 3, vl);
+                return __riscv_vsll_vx_u16m1(o, s, vl);
+            };
+            vuint16m1_t out = __riscv_vor_vv_u16m1(blend(r8, lum, inv, Rshift), blend(g8, lum, inv, Gshift), vl);
+            out = __riscv_vor_vv_u16m1(out, blend(b8, lum, inv, Bshift), vl);
+            out = __riscv_vor_vv_u16m1(out, __riscv_vand_vx_u16m1(p, Amask, vl), vl);
+            __riscv_vse16_v_u16m1(row, out, vl);
+        }
+#endif
+        for (; x < width; ++x, ++row) {
+            uint16_t p = *row;
+
+            // Extract 5-bit channels
+            const uint32_t r5 = (p >> Rshift) & 0x1Fu;
+            const uint32_t g5 = (p >> Gshift) & 0x1Fu;
+            const uint32_t b5 = (p >> Bshift) & 0x1Fu;
+            const uint16_t a1 = (Ashift < 16) ? (p & Amask) : 0;
+
+            // Upscale to 0..255
+            const uint32_t r8 = expand5(r5);
+            const uint32_t g8 = expand5(g5);
+            const uint32_t b8 = expand5(b5);
+
+            // Perceptual luminance (0..255)
+            const uint32_t lum = (77u*r8 + 150u*g8 + 29u*b8) >> 8;
+
+            // Dimmed versions (by 1 >> shift)
+            const uint32_t rd8 = r8 >> shift;
+            const uint32_t gd8 = g8 >> shift;
+            const uint32_t bd8 = b8 >> shift;
+
+            // Blend: darker where lum is low; preserve hue in bright areas
+            const uint32_t out_r8 = ( rd8 * (255u - lum) + r8 * lum ) >> 8;
+            const uint32_t out_g8 = ( gd8 * (255u - lum) + g8 * lum ) >> 8;
+            const uint32_t out_b8 = ( bd8 * (255u - lum) + b8 * lum ) >> 8;
+
+            // Quantize back to 5 bits
+            const uint16_t out_r5 = (uint16_t)quantize5(out_r8);
+            const uint16_t out_g5 = (uint16_t)quantize5(out_g8);
+            const uint16_t out_b5 = (uint16_t)quantize5(out_b8);
+
+            // Repack to ARGB1555 (R,G,B at their shifts; keep incoming A bit if present)
+            *row = uint16_t((out_r5 << Rshift)
+                          | (out_g5 << Gshift)
+                          | (out_b5 << Bshift)
+                          | a1);
+        }
+    }
+}
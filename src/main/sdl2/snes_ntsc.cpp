@@ -14,9 +14,7 @@ Updates Feb-26:  added SSE2 fall-back; SSE4.1 now selected at compile time via _
 #include <stdio.h>
 
 #include "snes_ntsc.h"
-#ifdef _OPENMP
-#include <omp.h>    // JJP - OpenMP support for multi-threading initialization
-#endif
+#include "jobsystem.hpp" // JJP - the kernel tables are built across the job system
 #include <stdint.h> // uint32_t etc
 
 
@@ -115,62 +113,33 @@ void snes_ntsc_init(snes_ntsc_t* ntsc, snes_ntsc_setup_t const* setup)
     if (setup->artifacts <= -1 && setup->fringing <= -1)
         merge_fields = 1;
 
-#ifdef _OPENMP
-#pragma omp parallel
-    {
-        init_t impl_local = impl; // or use firstprivate(impl)
-        int merge_fields_local = merge_fields;
-        int entry;
-
-#pragma omp for schedule(static)
-        for (entry = 0; entry < snes_ntsc_palette_size; ++entry) {
-            unsigned int red_index = (entry >> 10 & 0x1F) + ((entry >> 15) * 32);
-            unsigned int green_index = (entry >> 5 & 0x1F) + ((entry >> 15) * 32);
-            unsigned int blue_index = (entry >> 0 & 0x1F) + ((entry >> 15) * 32);
-
+    // the entries are independent; split across the job system, each range with its own init_t
+    jobsystem.parallel_for(0, snes_ntsc_palette_size, [&](int first, int last) {
+        init_t impl_local = impl;
+        for (int entry = first; entry < last; ++entry) {
+            unsigned int red_index   = (entry >> 10 & 0x1F) + ((entry >> 15) * 32);
+            unsigned int green_index = (entry >> 5  & 0x1F) + ((entry >> 15) * 32);
+            unsigned int blue_index  = (entry >> 0  & 0x1F) + ((entry >> 15) * 32);
             unsigned int ir = S16_rgbVals[red_index];
             unsigned int ig = S16_rgbVals[green_index];
             unsigned int ib = S16_rgbVals[blue_index];
-
             float rr = impl_local.to_float[ir];
             float gg = impl_local.to_float[ig];
             float bb = impl_local.to_float[ib];
-
             float y, i, q = RGB_TO_YIQ(rr, gg, bb, y, i);
             int r, g, b = YIQ_TO_RGB(y, i, q, impl_local.to_rgb, int, r, g);
             snes_ntsc_rgb_t rgb = PACK_RGB(r, g, b);
-
             snes_ntsc_rgb_t* out = ntsc->table[entry];
             gen_kernel(&impl_local, y, i, q, out);
-            if (merge_fields_local) merge_kernel_fields(out);
-            correct_errors(rgb, out);
-        }
-    }
-    #else
-        for (unsigned int entry = 0; entry < snes_ntsc_palette_size; entry++) {
-            unsigned int red_index   = (entry >> 10 & 0x1F) + ((entry >> 15) * 32);
-            unsigned int green_index = (entry >> 5  & 0x1F) + ((entry >> 15) * 32);
-            unsigned int blue_index  = (entry >> 0  & 0x1F) + ((entry >> 15) * 32);
-            unsigned int ir = S16_rgbVals[red_index];
-            unsigned int ig = S16_rgbVals[green_index];
-            unsigned int ib = S16_rgbVals[blue_index];
-            float rr = impl.to_float[ir];
-            float gg = impl.to_float[ig];
-            float bb = impl.to_float[ib];
-            float y, i, q = RGB_TO_YIQ(rr, gg, bb, y, i);
-            int r, g, b = YIQ_TO_RGB(y, i, q, impl.to_rgb, int, r, g);
-            snes_ntsc_rgb_t rgb = PACK_RGB(r, g, b);
-            snes_ntsc_rgb_t* out = ntsc->table[entry];
-            gen_kernel(&impl, y, i, q, out);
             if (merge_fields) merge_kernel_fields(out);
             correct_errors(rgb, out);
         }
-    #endif
+    });
 }
 
 #ifndef SNES_NTSC_NO_BLITTERS
 
-void snes_ntsc_blit(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, long in_row_width,
+void snes_ntsc_blit(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, SNES_NTSC_IN_T const* palette, long in_row_width,
     int burst_phase, int in_width, int in_height, void* rgb_out, long out_pitch, long Alevel)
 {
     int chunk_count = (in_width - 1) / snes_ntsc_in_chunk;
@@ -226,7 +195,7 @@ void snes_ntsc_blit(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, long i
 
 
 
-void snes_ntsc_blit_hires(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, long in_row_width,
+void snes_ntsc_blit_hires(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, SNES_NTSC_IN_T const* palette, long in_row_width,
     int burst_phase, int in_width, int in_height, void* rgb_out, long out_pitch, long Alevel)
 {
     int chunk_count = (in_width - 2) / (snes_ntsc_in_chunk * 2);
@@ -397,288 +366,87 @@ void snes_ntsc_blit_hires(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input,
 } while(0)
 
 
-#if SNES_NTSC_HAVE_SIMD
-void snes_ntsc_blit_hires_fast(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* restrict input, long in_row_width,
-    int burst_phase, int in_width, int in_height, void* restrict rgb_out, long out_pitch, long Alevel)
-    // This version utilises SIMD registers streamline:
-    // 1. Loading of pixels, as six 128-bit loads (providing 24 pixels in 6 registers)
-    // 2. Clamp and RGB conversion, as the SIMD registers can be used to perform the calculations
-    // 3. Output to memory, as the SIMD registers can be used to store the output values as seven 128-bit stores
-    // The Blargg algorithm itself is implemented in full, except for a small change in end-of-line processing
-    // to keep output line width divisable by 4 and hence 128-bit aligned.
-{
-    int chunk_count = in_width / (snes_ntsc_in_chunk * 2); // should be 640 / (3 * 2) = 106
-
-    // Prepare SIMD vectors
-    SET_SNES_MASK_VECTORS;
-    //for (int y = 0; y<in_height; y++)
-    for (; in_height; --in_height)
-    {
-        int x = 0;
-        // SIMD Input Registers (uint16_t x4)
-        SIMD_INPUT_REGISTER_t xmm0, xmm1, xmm2, xmm3, xmm4, xmm5, xmm6; // inputs
-
-        // Outputs - xmm10..16 (uint32_t x4)
-        SIMD_REGISTER_t xmm10 = SIMD_ZERO;
-        SIMD_REGISTER_t xmm11 = SIMD_ZERO;
-        SIMD_REGISTER_t xmm12 = SIMD_ZERO;
-        SIMD_REGISTER_t xmm13 = SIMD_ZERO;
-        SIMD_REGISTER_t xmm14 = SIMD_ZERO;
-        SIMD_REGISTER_t xmm15 = SIMD_ZERO;
-        SIMD_REGISTER_t xmm16 = SIMD_ZERO;
-
-        // setup the first block, which will affect the second block.
-
-        // load the first four pixels from memory
-        SNES_NTSC_IN_T const* restrict line_in = input;
-        xmm0 = LOAD_SIMD_REGISTER(&line_in[0]);
-
-        // and use the first two pixels for this initial block
-        SNES_NTSC_HIRES_ROW(ntsc, burst_phase,
-            snes_ntsc_black, snes_ntsc_black, snes_ntsc_black,
-            SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm0, 0)),
-            SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm0, 1)));
-        snes_ntsc_out_t* restrict line_out = (snes_ntsc_out_t*)rgb_out;
-
-        // set up SIMD registers and flags
-        int iterations = 0;
-        uint16_t last_colour = 0;
-        uint16_t this_colour = 0;
-
-        for (int n = (chunk_count>>2); n; --n)
-        {
-            // Load the next 6x4 = 24 pixels
-            xmm1 = LOAD_SIMD_REGISTER(&line_in[4]);
-            xmm2 = LOAD_SIMD_REGISTER(&line_in[8]);
-            xmm3 = LOAD_SIMD_REGISTER(&line_in[12]);
-            xmm4 = LOAD_SIMD_REGISTER(&line_in[16]);
-            xmm5 = LOAD_SIMD_REGISTER(&line_in[20]);
-            xmm6 = LOAD_SIMD_REGISTER(&line_in[24]); // need 0/1 for this pass; 2/3 for next
-            line_in += 24;
-
-            // 1st six. Loop is unrolled to four iterations permitting full use
-            // of 4-wide SIMD registers
-
-            CHECK_ALL_EQUAL; // stores result in this_colour, 0 if not equal or the colour if equal
-
-            // identify if this block is a repeat. this_colour must be non-zero to identify a repeat block.
-            uint32_t repeat_block = (this_colour == last_colour) & (this_colour != 0); // 0 or 1
-            last_colour = this_colour;
-
-            // check if we need to go through the calculation process
-            if (!repeat_block) {
-                // we need to do the full calculation
-                // This block processes 6x4(=24) input pixels to produce 7x4(=28) output pixels
-
-                /* process first six input pixels to produce seven outputs */
-                SNES_NTSC_COLOR_IN(0, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm0, 2)));
-                xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(0), 0);
-
-                SNES_NTSC_COLOR_IN(1, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm0, 3)));
-                xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(1), 1);
-
-                SNES_NTSC_COLOR_IN(2, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm1, 0)));
-                xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(2), 2);
-
-                SNES_NTSC_COLOR_IN(3, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm1, 1)));
-                xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(3), 3);
-
-                SNES_NTSC_COLOR_IN(4, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm1, 2)));
-                xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(4), 0);
-
-                SNES_NTSC_COLOR_IN(5, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm1, 3)));
-                xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(5), 1);
-
-                xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(6), 2);
-
-                /* process second six input pixels to produce seven outputs */
-                SNES_NTSC_COLOR_IN(0, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm2, 0)));
-                xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(0), 3);
-
-                SNES_NTSC_COLOR_IN(1, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm2, 1)));
-                xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(1), 0);
-
-                SNES_NTSC_COLOR_IN(2, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm2, 2)));
-                xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(2), 1);
-
-                SNES_NTSC_COLOR_IN(3, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm2, 3)));
-                xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(3), 2);
-
-                SNES_NTSC_COLOR_IN(4, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm3, 0)));
-                xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(4), 3);
-
-                SNES_NTSC_COLOR_IN(5, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm3, 1)));
-                xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(5), 0);
-
-                xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(6), 1);
-
-                /* process third six input pixels to produce seven outputs */
-                SNES_NTSC_COLOR_IN(0, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm3, 2)));
-                xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(0), 2);
-
-                SNES_NTSC_COLOR_IN(1, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm3, 3)));
-                xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(1), 3);
-
-                SNES_NTSC_COLOR_IN(2, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm4, 0)));
-                xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(2), 0);
-
-                SNES_NTSC_COLOR_IN(3, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm4, 1)));
-                xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(3), 1);
-
-                SNES_NTSC_COLOR_IN(4, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm4, 2)));
-                xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(4), 2);
-
-                SNES_NTSC_COLOR_IN(5, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm4, 3)));
-                xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(5), 3);
-
-                xmm15 = INSERT_SIMD_REGISTER_VALUE(xmm15, SNES_NTSC_HIRES_OUT_SIMD(6), 0);
-
-                /* process fourth set of six input pixels to produce seven outputs */
-                SNES_NTSC_COLOR_IN(0, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm5, 0)));
-                xmm15 = INSERT_SIMD_REGISTER_VALUE(xmm15, SNES_NTSC_HIRES_OUT_SIMD(0), 1);
-
-                SNES_NTSC_COLOR_IN(1, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm5, 1)));
-                xmm15 = INSERT_SIMD_REGISTER_VALUE(xmm15, SNES_NTSC_HIRES_OUT_SIMD(1), 2);
-
-                SNES_NTSC_COLOR_IN(2, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm5, 2)));
-                xmm15 = INSERT_SIMD_REGISTER_VALUE(xmm15, SNES_NTSC_HIRES_OUT_SIMD(2), 3);
-
-                SNES_NTSC_COLOR_IN(3, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm5, 3)));
-                xmm16 = INSERT_SIMD_REGISTER_VALUE(xmm16, SNES_NTSC_HIRES_OUT_SIMD(3), 0);
-
-                SNES_NTSC_COLOR_IN(4, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm6, 0)));
-                xmm16 = INSERT_SIMD_REGISTER_VALUE(xmm16, SNES_NTSC_HIRES_OUT_SIMD(4), 1);
-
-                SNES_NTSC_COLOR_IN(5, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm6, 1)));
-                xmm16 = INSERT_SIMD_REGISTER_VALUE(xmm16, SNES_NTSC_HIRES_OUT_SIMD(5), 2);
-
-                xmm16 = INSERT_SIMD_REGISTER_VALUE(xmm16, SNES_NTSC_HIRES_OUT_SIMD(6), 3);
-
-                // Outputs are in xmm10..xmm16 - perform clamp
-                SNES_NTSC_CLAMP_AND_CONVERT(xmm10);
-                SNES_NTSC_CLAMP_AND_CONVERT(xmm11);
-                SNES_NTSC_CLAMP_AND_CONVERT(xmm12);
-                SNES_NTSC_CLAMP_AND_CONVERT(xmm13);
-                SNES_NTSC_CLAMP_AND_CONVERT(xmm14);
-                SNES_NTSC_CLAMP_AND_CONVERT(xmm15);
-                SNES_NTSC_CLAMP_AND_CONVERT(xmm16);
-
-            }
-
-            #ifndef _WIN32
-                __builtin_prefetch(line_in  + 32, 0, 0);   // prefect next input: read, streaming
-            #endif
-            SNES_NTSC_RGB_STORE(&line_out[0], xmm10);
-            SNES_NTSC_RGB_STORE(&line_out[4], xmm11);
-            SNES_NTSC_RGB_STORE(&line_out[8], xmm12);
-            SNES_NTSC_RGB_STORE(&line_out[12], xmm13);
-            SNES_NTSC_RGB_STORE(&line_out[16], xmm14);
-            SNES_NTSC_RGB_STORE(&line_out[20], xmm15);
-            SNES_NTSC_RGB_STORE(&line_out[24], xmm16);
-
-            // replace xmm0 with next block (we're 2 input pixels out of sync due to the start of line)
-            xmm0 = xmm6;
-
-            xmm10 = xmm11 = xmm12 = xmm13 = xmm14 = xmm15 = xmm16; // in case we can use them next loop
-
-            line_out += 28; // advance pointer (4x7)
-            x += 28;
-        }
-
-        // At this point with have 6x2 + 2 = 14 input pixels left to process, plus we write out
-        // the remaining pixels based on black input pixels to allow the end of line.
-        {
-            // Load the final 2x6 = 12 pixels
-            xmm1 = LOAD_SIMD_REGISTER(&line_in[4]);
-            xmm2 = LOAD_SIMD_REGISTER(&line_in[8]);
-            xmm3 = LOAD_SIMD_REGISTER(&line_in[12]);
-
-            /* process first six input pixels to produce seven outputs */
-            SNES_NTSC_COLOR_IN(0, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm0, 2)));
-            xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(0), 0);
-
-            SNES_NTSC_COLOR_IN(1, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm0, 3)));
-            xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(1), 1);
-
-            SNES_NTSC_COLOR_IN(2, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm1, 0)));
-            xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(2), 2);
-
-            SNES_NTSC_COLOR_IN(3, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm1, 1)));
-            xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(3), 3);
-
-            SNES_NTSC_COLOR_IN(4, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm1, 2)));
-            xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(4), 0);
-
-            SNES_NTSC_COLOR_IN(5, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm1, 3)));
-            xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(5), 1);
-
-            xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(6), 2);
-
-            /* process last six input pixels for this row to produce seven outputs */
-            SNES_NTSC_COLOR_IN(0, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm2, 0)));
-            xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(0), 3);
-
-            SNES_NTSC_COLOR_IN(1, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm2, 1)));
-            xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(1), 0);
-
-            SNES_NTSC_COLOR_IN(2, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm2, 2)));
-            xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(2), 1);
-
-            SNES_NTSC_COLOR_IN(3, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm2, 3)));
-            xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(3), 2);
-
-            SNES_NTSC_COLOR_IN(4, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm3, 0)));
-            xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(4), 3);
-
-            SNES_NTSC_COLOR_IN(5, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm3, 1)));
-            xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(5), 0);
-
-            xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(6), 1);
-
-            /* process third six input pixels to produce seven outputs */
-            SNES_NTSC_COLOR_IN(0, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm3, 2)));
-            xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(0), 2);
-
-            SNES_NTSC_COLOR_IN(1, SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm3, 3)));
-            xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(1), 3);
-
-            SNES_NTSC_COLOR_IN(2, SNES_NTSC_ADJ_IN(snes_ntsc_black));
-            xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(2), 0);
-
-            SNES_NTSC_COLOR_IN(3, SNES_NTSC_ADJ_IN(snes_ntsc_black));
-            xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(3), 1);
+// Input pixel j of register xmm<k>, looked up in the palette. The registers hold pixels
+// block[0] onwards, four to a register. On ARM, moving a NEON lane to a core register costs
+// more than re-reading the pixel from L1 (and stalls the pipeline on older cores), so the
+// registers are only used for the run comparison there and the pixel is loaded directly.
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define SNES_NTSC_FAST_IN(k, j) SNES_NTSC_ADJ_IN(block[4 * (k) + (j)])
+#else
+    #define SNES_NTSC_FAST_IN(k, j) SNES_NTSC_ADJ_IN(EXTRACT_SIMD_REGISTER_VALUE(xmm##k, j))
+#endif
 
-            SNES_NTSC_COLOR_IN(4, SNES_NTSC_ADJ_IN(snes_ntsc_black));
-            xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(4), 2);
+#if SNES_NTSC_HAVE_SIMD
+#if defined(SNES_NTSC_X86_DISPATCH)
+// x86: the blitter as built (SSE2 unless -msse4.1 or -march says more), an SSE4.1 copy, where
+// only the lane insert differs, and the AVX2 version; chosen on the first call by the CPU.
+#define SNES_NTSC_FAST_NAME   snes_ntsc_blit_hires_base
+#define SNES_NTSC_FAST_DECL   static
+#include "snes_ntsc_fast.h"
+
+#if SNES_NTSC_X86_LEVEL < 4
+#undef  INSERT_SIMD_REGISTER_VALUE
+#define INSERT_SIMD_REGISTER_VALUE INSERT_SIMD_REGISTER_VALUE_SSE4
+#define SNES_NTSC_FAST_NAME   snes_ntsc_blit_hires_sse41
+#define SNES_NTSC_FAST_DECL   static __attribute__((target("sse4.1")))
+#include "snes_ntsc_fast.h"
+#else
+#define snes_ntsc_blit_hires_sse41 snes_ntsc_blit_hires_base
+#endif
 
-            SNES_NTSC_COLOR_IN(5, SNES_NTSC_ADJ_IN(snes_ntsc_black));
-            xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(5), 3);
+#include "snes_ntsc_avx2.h"
 
-            xmm15 = ZERO_SIMD_REGISTER; // 7th output of this block is black, and 3 pixels padding to retain alignment
+typedef void (*snes_ntsc_fast_fn)(snes_ntsc_t const*, SNES_NTSC_IN_T const*, SNES_NTSC_IN_T const*, long,
+    int, int, int, void*, long, long, int, int);
 
-            // Clamp the outputs
-            SNES_NTSC_CLAMP(xmm10);
-            SNES_NTSC_CLAMP(xmm11);
-            SNES_NTSC_CLAMP(xmm12);
-            SNES_NTSC_CLAMP(xmm13);
-            SNES_NTSC_CLAMP(xmm14);
-            SNES_NTSC_CLAMP(xmm15);
+enum { SNES_NTSC_PATH_SSE2, SNES_NTSC_PATH_SSE41, SNES_NTSC_PATH_AVX2 };
 
-            // adjust to RGBA and store
-            SNES_NTSC_RGB_OUT_STORE(&line_out[0], xmm10, alevel_vec);
-            SNES_NTSC_RGB_OUT_STORE(&line_out[4], xmm11, alevel_vec);
-            SNES_NTSC_RGB_OUT_STORE(&line_out[8], xmm12, alevel_vec);
-            SNES_NTSC_RGB_OUT_STORE(&line_out[12], xmm13, alevel_vec);
-            SNES_NTSC_RGB_OUT_STORE(&line_out[16], xmm14, alevel_vec);
-            SNES_NTSC_RGB_OUT_STORE(&line_out[20], xmm15, alevel_vec);
-        }
+static int snes_ntsc_fast_path(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SNES_NTSC_PATH_AVX2;
+    if (SNES_NTSC_X86_LEVEL >= 4 || __builtin_cpu_supports("sse4.1"))
+        return SNES_NTSC_PATH_SSE41;
+    return SNES_NTSC_PATH_SSE2;
+}
 
-        burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
-        input += in_row_width;
-        rgb_out = (char*)rgb_out + out_pitch;
-    }
+void snes_ntsc_blit_hires_fast(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* restrict input,
+    SNES_NTSC_IN_T const* restrict palette, long in_row_width,
+    int burst_phase, int in_width, int in_height, void* restrict rgb_out, long out_pitch, long Alevel,
+    int scanlines, int first_row)
+{
+    static const snes_ntsc_fast_fn fns[] = {
+        snes_ntsc_blit_hires_base, snes_ntsc_blit_hires_sse41, snes_ntsc_blit_hires_avx2
+    };
+    static const snes_ntsc_fast_fn fn = fns[snes_ntsc_fast_path()];
+    fn(ntsc, input, palette, in_row_width, burst_phase, in_width, in_height, rgb_out, out_pitch, Alevel,
+       scanlines, first_row);
 }
+#else
+#define SNES_NTSC_FAST_NAME   snes_ntsc_blit_hires_fast
+#define SNES_NTSC_FAST_DECL
+#include "snes_ntsc_fast.h"
+#endif
 
+const char* snes_ntsc_simd_path(void)
+{
+#if defined(SNES_NTSC_X86_DISPATCH)
+    static const char* names[] = { "SSE2", "SSE4.1", "AVX2" };
+    return names[snes_ntsc_fast_path()];
+#elif defined(SNES_NTSC_X86_LEVEL)
+    return SNES_NTSC_X86_LEVEL >= 4 ? "SSE4.1" : "SSE2";
+#elif defined(SNES_NTSC_HAVE_RVV)
+    return "RVV";
+#else
+    return "NEON";
+#endif
+}
+#else
+const char* snes_ntsc_simd_path(void)
+{
+    return "scalar";
+}
 #endif
 
 /*
@@ -69,6 +69,11 @@ extern "C" {
     #define SNES_NTSC_HAVE_SIMD 0
 #endif
 
+#if SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_X86_LEVEL) && (defined(__GNUC__) || defined(__clang__))
+    /* the hires blitter is built for SSE4.1 and AVX2 too, and chosen at run time */
+    #define SNES_NTSC_X86_DISPATCH 1
+#endif
+
 
 // Portable 'restrict' for C and C++. Note - moved from snes_ntsc_impl.h so that the blitters
 // can be defined with 'restrict' parameters
@@ -130,20 +135,27 @@ extern "C" {
 	and output RGB depth is set by SNES_NTSC_OUT_DEPTH. Both default to 16-bit RGB.
 	In_row_width is the number of pixels to get to the next input row. Out_pitch
 	is the number of *bytes* to get to the next output row. */
-	void snes_ntsc_blit(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input,
+	/* JJP - input is palette indices; each is looked up in 'palette' (see SNES_NTSC_ADJ_IN) */
+	void snes_ntsc_blit(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, SNES_NTSC_IN_T const* palette,
 		long in_row_width, int burst_phase, int in_width, int in_height,
 		void* rgb_out, long out_pitch, long Alevel);
 
-	void snes_ntsc_blit_hires(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input,
+	void snes_ntsc_blit_hires(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, SNES_NTSC_IN_T const* palette,
 		long in_row_width, int burst_phase, int in_width, int in_height,
 		void* rgb_out, long out_pitch, long Alevel);
 
 #if SNES_NTSC_HAVE_SIMD
-    // SIMD version of hires (SSE/NEON)
-	void snes_ntsc_blit_hires_fast(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* restrict input, long in_row_width,
-		int burst_phase, int in_width, int in_height, void* restrict rgb_out, long out_pitch, long Alevel);
+    // SIMD version of hires (SSE/NEON). Scanlines (dim shift 1-3, 0 = none) are applied as
+    // the rows are written, to odd rows of the image; first_row is the image row of 'input'.
+	void snes_ntsc_blit_hires_fast(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* restrict input,
+		SNES_NTSC_IN_T const* restrict palette, long in_row_width,
+		int burst_phase, int in_width, int in_height, void* restrict rgb_out, long out_pitch, long Alevel,
+		int scanlines, int first_row);
 #endif
 
+    // The SIMD path the blitters use on this machine, for the log
+	const char* snes_ntsc_simd_path(void);
+
 	/* Number of output pixels written by low-res blitter for given input width. Width
 	might be rounded down slightly; use SNES_NTSC_IN_WIDTH() on result to find rounded
 	value. Guaranteed not to round 256 down at all. */
@@ -362,6 +374,7 @@ extern "C" {
 #define SNES_NTSC_CLAMP_AND_CONVERT SNES_NTSC_CLAMP_AND_CONVERT_NEON
 #define SNES_NTSC_RGB_OUT_STORE SNES_NTSC_RGB_OUT_STORE_NEON
 #define SNES_NTSC_RGB_STORE SNES_NTSC_RGB_STORE_NEON
+#define CONCAT_SIMD_REGISTER CONCAT_SIMD_REGISTER_NEON
 #elif SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_X86_LEVEL)
 	/* x86 Architecture – SSE2 minimum; SSE4.1 insert used when SNES_NTSC_X86_LEVEL >= 4. */
 #define SIMD_REGISTER_t __m128i
@@ -382,6 +395,7 @@ extern "C" {
 #define SNES_NTSC_CLAMP_AND_CONVERT SNES_NTSC_CLAMP_AND_CONVERT_SSE4
 #define SNES_NTSC_RGB_OUT_STORE     SNES_NTSC_RGB_OUT_STORE_SSE4
 #define SNES_NTSC_RGB_STORE         SNES_NTSC_RGB_STORE_SSE4
+#define CONCAT_SIMD_REGISTER CONCAT_SIMD_REGISTER_SSE4
 #elif SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_HAVE_RVV)
     /* RISC-V Vector (RVV 1.0) — vl=4 x uint32, vl=4 x uint16 */
 #define SIMD_REGISTER_t              vuint32m1_t
@@ -398,6 +412,7 @@ extern "C" {
 #define SNES_NTSC_CLAMP_AND_CONVERT  SNES_NTSC_CLAMP_AND_CONVERT_RVV
 #define SNES_NTSC_RGB_OUT_STORE      SNES_NTSC_RGB_OUT_STORE_RVV
 #define SNES_NTSC_RGB_STORE          SNES_NTSC_RGB_STORE_RVV
+#define CONCAT_SIMD_REGISTER CONCAT_SIMD_REGISTER_RVV
 #endif
 
 #define SIMD_ZERO_SSE4 _mm_setzero_si128()
@@ -464,6 +479,14 @@ extern "C" {
 #define ROTATE_OUT_NEON(A, B, elements) \
 	vext_u16((A), (B), (elements))
 
+/* Lanes N-3 of A followed by lanes 0..N-1 of B (32-bit lanes), for the output registers.
+   N must be a compile-time constant (1 ... 3). */
+#define CONCAT_SIMD_REGISTER_SSE4(A, B, N) \
+	_mm_or_si128(_mm_srli_si128((A), (N) * 4), _mm_slli_si128((B), 16 - (N) * 4))
+
+#define CONCAT_SIMD_REGISTER_NEON(A, B, N) \
+	vextq_u32((A), (B), (N))
+
 /* JJP - SIMD versions of clamp macros for S16, where shift = 0 */
 
 // SSE4 (Intel/AMD) Macro...
@@ -682,6 +705,12 @@ extern "C" {
     vst1q_u32((uint32_t*)line_out, raw_vec); \
 } while(0)
 
+// load/store four RGBA values with no alignment requirement (post-processing passes)
+#define SNES_NTSC_RGB_LOAD_U_SSE4(ptr)          _mm_loadu_si128((const __m128i*)(ptr))
+#define SNES_NTSC_RGB_STORE_U_SSE4(ptr, v)      _mm_storeu_si128((__m128i*)(ptr), (v))
+#define SNES_NTSC_RGB_LOAD_U_NEON(ptr)          vld1q_u32((const uint32_t*)(ptr))
+#define SNES_NTSC_RGB_STORE_U_NEON(ptr, v)      vst1q_u32((uint32_t*)(ptr), (v))
+
 /* ---- RISC-V Vector (RVV 1.0) macros ---- */
 
 #define SIMD_ZERO_RVV                   __riscv_vmv_v_x_u32m1(0, 4)
@@ -715,6 +744,10 @@ extern "C" {
         __riscv_vslidedown_vx_u16m1(__riscv_vmv_v_v_u16m1((A), 4), (pos), 4), \
         __riscv_vmv_v_v_u16m1((B), 4), (unsigned)(4-(pos)), 4)
 
+/* Lanes N-3 of A followed by lanes 0..N-1 of B */
+#define CONCAT_SIMD_REGISTER_RVV(A, B, N) \
+    __riscv_vslideup_vx_u32m1(__riscv_vslidedown_vx_u32m1((A), (N), 4), (B), 4 - (N), 4)
+
 /* Clamp only (no colour conversion) */
 #define SNES_NTSC_CLAMP_RVV(io) do { \
     vuint32m1_t _sub   = __riscv_vand_vv_u32m1( \
@@ -750,6 +783,10 @@ extern "C" {
 #define SNES_NTSC_RGB_STORE_RVV(line_out, raw_vec) \
     __riscv_vse32_v_u32m1((uint32_t*)(line_out), (raw_vec), 4)
 
+/* Unaligned load/store of four RGBA values (RVV has no alignment requirement) */
+#define SNES_NTSC_RGB_LOAD_U_RVV(ptr)     __riscv_vle32_v_u32m1((const uint32_t*)(ptr), 4)
+#define SNES_NTSC_RGB_STORE_U_RVV(ptr, v) __riscv_vse32_v_u32m1((uint32_t*)(ptr), (v), 4)
+
 /* Convert raw_vec to RGBA and store (end-of-line path with explicit alevel_vec) */
 #define SNES_NTSC_RGB_OUT_STORE_RVV(line_out, raw_vec, alevel_vec) do { \
     vuint32m1_t _r = __riscv_vand_vv_u32m1(__riscv_vsll_vx_u32m1((raw_vec), 3, 4), RED_MASK,   4); \
@@ -765,6 +802,102 @@ extern "C" {
 } while(0)
 
 
+/* ---- Scanlines, fused into the blitter's output stage ----
+   Dims four RGBA (R in the low byte) pixels as the CPU scanline routine in rendersurface.cpp:
+   each channel is blended between itself and itself >> shift by the pixel's luminance, so
+   bright areas keep their colour. Alpha is unchanged. SET_SNES_SCANLINE_VECTORS(shift) sets
+   up the constants once per blit. */
+#if SNES_NTSC_HAVE_SIMD && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define SET_SNES_SCANLINE_VECTORS    SET_SNES_SCANLINE_VECTORS_NEON
+#define SNES_NTSC_SCANLINE           SNES_NTSC_SCANLINE_NEON
+#define SNES_NTSC_RGB_LOAD_U         SNES_NTSC_RGB_LOAD_U_NEON
+#define SNES_NTSC_RGB_STORE_U        SNES_NTSC_RGB_STORE_U_NEON
+#elif SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_X86_LEVEL)
+#define SET_SNES_SCANLINE_VECTORS    SET_SNES_SCANLINE_VECTORS_SSE4
+#define SNES_NTSC_SCANLINE           SNES_NTSC_SCANLINE_SSE4
+#define SNES_NTSC_RGB_LOAD_U         SNES_NTSC_RGB_LOAD_U_SSE4
+#define SNES_NTSC_RGB_STORE_U        SNES_NTSC_RGB_STORE_U_SSE4
+#elif SNES_NTSC_HAVE_SIMD && defined(SNES_NTSC_HAVE_RVV)
+#define SET_SNES_SCANLINE_VECTORS    SET_SNES_SCANLINE_VECTORS_RVV
+#define SNES_NTSC_SCANLINE           SNES_NTSC_SCANLINE_RVV
+#define SNES_NTSC_RGB_LOAD_U         SNES_NTSC_RGB_LOAD_U_RVV
+#define SNES_NTSC_RGB_STORE_U        SNES_NTSC_RGB_STORE_U_RVV
+#endif
+
+/* SSE2 (no SSE4.1 needed): 16-bit lanes, two pixels per half register */
+#define SET_SNES_SCANLINE_VECTORS_SSE4(shift) \
+    const __m128i sl_zero    = _mm_setzero_si128(); \
+    const __m128i sl_shift   = _mm_cvtsi32_si128(shift); \
+    const __m128i sl_weights = _mm_set_epi16(0, 29, 150, 77, 0, 29, 150, 77); \
+    const __m128i sl_255     = _mm_set1_epi16(255); \
+    const __m128i sl_alpha   = _mm_set1_epi32((int)0xFF000000)
+
+#define SNES_NTSC_SCANLINE_SSE4_HALF(c) do { \
+    /* luminance: madd gives 77r+150g and 29b per pixel; sum the pair, then broadcast */ \
+    __m128i _l = _mm_madd_epi16((c), sl_weights); \
+    _l = _mm_srli_epi32(_mm_add_epi32(_l, _mm_srli_epi64(_l, 32)), 8); \
+    _l = _mm_shufflehi_epi16(_mm_shufflelo_epi16(_l, 0), 0); \
+    /* (dimmed * (255 - lum) + c * lum) >> 8 */ \
+    __m128i _d = _mm_mullo_epi16(_mm_srl_epi16((c), sl_shift), _mm_sub_epi16(sl_255, _l)); \
+    (c) = _mm_srli_epi16(_mm_add_epi16(_d, _mm_mullo_epi16((c), _l)), 8); \
+} while(0)
+
+#define SNES_NTSC_SCANLINE_SSE4(io) do { \
+    __m128i _lo = _mm_unpacklo_epi8((io), sl_zero); \
+    __m128i _hi = _mm_unpackhi_epi8((io), sl_zero); \
+    SNES_NTSC_SCANLINE_SSE4_HALF(_lo); \
+    SNES_NTSC_SCANLINE_SSE4_HALF(_hi); \
+    (io) = _mm_or_si128(_mm_andnot_si128(sl_alpha, _mm_packus_epi16(_lo, _hi)), \
+                        _mm_and_si128((io), sl_alpha)); \
+} while(0)
+
+/* NEON: 32-bit lanes, one pixel per lane (ARMv7 compatible) */
+#define SET_SNES_SCANLINE_VECTORS_NEON(shift) \
+    const uint32x4_t sl_ff    = vdupq_n_u32(0xFF); \
+    const int32x4_t  sl_shift = vdupq_n_s32(-(int)(shift)); \
+    const uint32x4_t sl_alpha = vdupq_n_u32(0xFF000000u)
+
+#define SNES_NTSC_SCANLINE_NEON_CH(c, inv, lum) \
+    vshrq_n_u32(vmlaq_u32(vmulq_u32(vshlq_u32((c), sl_shift), (inv)), (c), (lum)), 8)
+
+#define SNES_NTSC_SCANLINE_NEON(io) do { \
+    uint32x4_t _r = vandq_u32((io), sl_ff); \
+    uint32x4_t _g = vandq_u32(vshrq_n_u32((io), 8), sl_ff); \
+    uint32x4_t _b = vandq_u32(vshrq_n_u32((io), 16), sl_ff); \
+    uint32x4_t _l = vshrq_n_u32(vmlaq_n_u32(vmlaq_n_u32(vmulq_n_u32(_r, 77), _g, 150), _b, 29), 8); \
+    uint32x4_t _i = vsubq_u32(sl_ff, _l); \
+    _r = SNES_NTSC_SCANLINE_NEON_CH(_r, _i, _l); \
+    _g = SNES_NTSC_SCANLINE_NEON_CH(_g, _i, _l); \
+    _b = SNES_NTSC_SCANLINE_NEON_CH(_b, _i, _l); \
+    (io) = vorrq_u32(vandq_u32((io), sl_alpha), \
+                     vorrq_u32(_r, vorrq_u32(vshlq_n_u32(_g, 8), vshlq_n_u32(_b, 16)))); \
+} while(0)
+
+/* RVV: as NEON, vl = 4 */
+#define SET_SNES_SCANLINE_VECTORS_RVV(shift) \
+    const size_t sl_shift = (size_t)(shift)
+
+#define SNES_NTSC_SCANLINE_RVV_CH(c, inv, lum) \
+    __riscv_vsrl_vx_u32m1(__riscv_vmacc_vv_u32m1( \
+        __riscv_vmul_vv_u32m1(__riscv_vsrl_vx_u32m1((c), sl_shift, 4), (inv), 4), (c), (lum), 4), 8, 4)
+
+#define SNES_NTSC_SCANLINE_RVV(io) do { \
+    vuint32m1_t _r = __riscv_vand_vx_u32m1((io), 0xFFu, 4); \
+    vuint32m1_t _g = __riscv_vand_vx_u32m1(__riscv_vsrl_vx_u32m1((io), 8, 4), 0xFFu, 4); \
+    vuint32m1_t _b = __riscv_vand_vx_u32m1(__riscv_vsrl_vx_u32m1((io), 16, 4), 0xFFu, 4); \
+    vuint32m1_t _l = __riscv_vmul_vx_u32m1(_r, 77u, 4); \
+    _l = __riscv_vmacc_vx_u32m1(_l, 150u, _g, 4); \
+    _l = __riscv_vsrl_vx_u32m1(__riscv_vmacc_vx_u32m1(_l, 29u, _b, 4), 8, 4); \
+    vuint32m1_t _i = __riscv_vrsub_vx_u32m1(_l, 255u, 4); \
+    _r = SNES_NTSC_SCANLINE_RVV_CH(_r, _i, _l); \
+    _g = SNES_NTSC_SCANLINE_RVV_CH(_g, _i, _l); \
+    _b = SNES_NTSC_SCANLINE_RVV_CH(_b, _i, _l); \
+    (io) = __riscv_vor_vv_u32m1(__riscv_vand_vx_u32m1((io), 0xFF000000u, 4), \
+               __riscv_vor_vv_u32m1(_r, __riscv_vor_vv_u32m1(__riscv_vsll_vx_u32m1(_g, 8, 4), \
+                                                             __riscv_vsll_vx_u32m1(_b, 16, 4), 4), 4), 4); \
+} while(0)
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,219 @@
+/* JJP - AVX2 snes_ntsc_blit_hires_fast, included by snes_ntsc.cpp on x86 and chosen at run time.
+
+   The SSE and NEON versions sum each output's twelve kernel terms in core registers and use the
+   vector unit to clamp, convert and store. Here the sums are vectorised too: the seven outputs
+   of a chunk (six input pixels) are one eight-lane register. Kernel slot i of a chunk reads the
+   same seven consecutive entries of its kernel for every output, rotated by a fixed amount, and
+   outputs before i still see the previous chunk's kernel in that slot. So each slot is two
+   loads blended by a constant mask, then a constant permute, and a chunk is 24 loads:
+
+     slot i   kernel entries           rotate   outputs taking this chunk's kernel
+       0      x           (+7 for x)     0      0-6
+       1      (x+6)%7                    6      1-6
+       2      (x+5)%7+14                 5      2-6
+       3      (x+4)%7+14                 4      3-6
+       4      (x+3)%7+28                 3      4-6
+       5      (x+2)%7+28                 2      5-6
+
+   Lane 7 is spare; a chunk's store puts it where the next chunk's first output goes. The sums
+   are the same additions in another order, so the output is that of the SSE version, with
+   the same 24-pixel run detection, scanlines and end of line. */
+
+#define SNES_NTSC_AVX2 __attribute__((target("avx2")))
+
+// Six pointers per chunk: this chunk's kernels, the chunk before's and the one before that
+struct snes_ntsc_avx2_state
+{
+    snes_ntsc_rgb_t const* cur[6];
+    snes_ntsc_rgb_t const* prev[6];
+    snes_ntsc_rgb_t const* prev2[6];
+};
+
+#define SNES_NTSC_AVX2_LOAD(k, at) _mm256_loadu_si256((__m256i const*)((k) + (at)))
+
+// Kernel slot i (base entry, blend mask of the source entries for this chunk's kernel, rotation)
+#define SNES_NTSC_AVX2_SLOT(i, base, mask, rot) do { \
+    __m256i _k  = _mm256_blend_epi32(SNES_NTSC_AVX2_LOAD(s.prev[i], (base)), \
+                                     SNES_NTSC_AVX2_LOAD(s.cur[i], (base)), (mask)); \
+    __m256i _kx = _mm256_blend_epi32(SNES_NTSC_AVX2_LOAD(s.prev2[i], (base) + 7), \
+                                     SNES_NTSC_AVX2_LOAD(s.prev[i], (base) + 7), (mask)); \
+    sum = _mm256_add_epi32(sum, _mm256_permutevar8x32_epi32(_mm256_add_epi32(_k, _kx), rot)); \
+} while (0)
+
+SNES_NTSC_AVX2 static inline __m256i snes_ntsc_avx2_chunk(snes_ntsc_avx2_state const& s,
+    __m256i const (&rot)[6])
+{
+    __m256i sum = _mm256_setzero_si256();
+    SNES_NTSC_AVX2_SLOT(0,  0, 0x7F, rot[0]);
+    SNES_NTSC_AVX2_SLOT(1,  0, 0x3F, rot[1]);
+    SNES_NTSC_AVX2_SLOT(2, 14, 0x1F, rot[2]);
+    SNES_NTSC_AVX2_SLOT(3, 14, 0x0F, rot[3]);
+    SNES_NTSC_AVX2_SLOT(4, 28, 0x07, rot[4]);
+    SNES_NTSC_AVX2_SLOT(5, 28, 0x03, rot[5]);
+    return sum;
+}
+
+// The next chunk's kernels, from six palette-mapped input pixels (or black)
+SNES_NTSC_AVX2 static inline void snes_ntsc_avx2_next(snes_ntsc_avx2_state& s, char const* ktable,
+    unsigned const (&colour)[6])
+{
+    for (int i = 0; i < 6; i++) {
+        s.prev2[i] = s.prev[i];
+        s.prev[i]  = s.cur[i];
+        s.cur[i]   = SNES_NTSC_IN_FORMAT(ktable, colour[i]);
+    }
+}
+
+SNES_NTSC_AVX2 static inline __m256i snes_ntsc_avx2_convert(__m256i io)
+{
+    // as SNES_NTSC_CLAMP_AND_CONVERT_SSE4
+    const __m256i clamp_mask_vec = _mm256_set1_epi32(snes_ntsc_clamp_mask);
+    const __m256i clamp_add_vec  = _mm256_set1_epi32(snes_ntsc_clamp_add);
+    __m256i sub   = _mm256_and_si256(_mm256_srli_epi32(io, 9), clamp_mask_vec);
+    __m256i clamp = _mm256_sub_epi32(clamp_add_vec, sub);
+    io    = _mm256_or_si256(io, clamp);
+    clamp = _mm256_sub_epi32(clamp, sub);
+    io    = _mm256_and_si256(io, clamp);
+
+    __m256i r = _mm256_and_si256(_mm256_slli_epi32(io, 3), _mm256_set1_epi32((int)0xFF000000));
+    __m256i g = _mm256_and_si256(_mm256_slli_epi32(io, 5), _mm256_set1_epi32(0x00FF0000));
+    __m256i b = _mm256_and_si256(_mm256_slli_epi32(io, 7), _mm256_set1_epi32(0x0000FF00));
+    return _mm256_or_si256(_mm256_or_si256(_mm256_set1_epi32((int)0xFF000000), _mm256_slli_epi32(b, 8)),
+                           _mm256_or_si256(_mm256_srli_epi32(g, 8), _mm256_srli_epi32(r, 24)));
+}
+
+SNES_NTSC_AVX2 static inline __m256i snes_ntsc_avx2_scanline_half(__m256i c, __m128i shift)
+{
+    // as SNES_NTSC_SCANLINE_SSE4_HALF; every step stays within its 128-bit lane
+    const __m256i weights = _mm256_set_epi16(0, 29, 150, 77, 0, 29, 150, 77, 0, 29, 150, 77, 0, 29, 150, 77);
+    __m256i l = _mm256_madd_epi16(c, weights);
+    l = _mm256_srli_epi32(_mm256_add_epi32(l, _mm256_srli_epi64(l, 32)), 8);
+    l = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(l, 0), 0);
+    __m256i d = _mm256_mullo_epi16(_mm256_srl_epi16(c, shift), _mm256_sub_epi16(_mm256_set1_epi16(255), l));
+    return _mm256_srli_epi16(_mm256_add_epi16(d, _mm256_mullo_epi16(c, l)), 8);
+}
+
+SNES_NTSC_AVX2 static inline __m256i snes_ntsc_avx2_scanline(__m256i io, __m128i shift)
+{
+    const __m256i zero  = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+    __m256i lo = snes_ntsc_avx2_scanline_half(_mm256_unpacklo_epi8(io, zero), shift);
+    __m256i hi = snes_ntsc_avx2_scanline_half(_mm256_unpackhi_epi8(io, zero), shift);
+    return _mm256_or_si256(_mm256_andnot_si256(alpha, _mm256_packus_epi16(lo, hi)), _mm256_and_si256(io, alpha));
+}
+
+SNES_NTSC_AVX2 static void snes_ntsc_blit_hires_avx2(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* restrict input,
+    SNES_NTSC_IN_T const* restrict palette, long in_row_width,
+    int burst_phase, int in_width, int in_height, void* restrict rgb_out, long out_pitch, long Alevel,
+    int scanlines, int first_row)
+{
+    (void)Alevel; // opaque, as the SSE version
+    const int chunk_count = in_width / (snes_ntsc_in_chunk * 2);
+    const __m256i rot[6] = {
+        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+        _mm256_setr_epi32(6, 0, 1, 2, 3, 4, 5, 7),
+        _mm256_setr_epi32(5, 6, 0, 1, 2, 3, 4, 7),
+        _mm256_setr_epi32(4, 5, 6, 0, 1, 2, 3, 7),
+        _mm256_setr_epi32(3, 4, 5, 6, 0, 1, 2, 7),
+        _mm256_setr_epi32(2, 3, 4, 5, 6, 0, 1, 7)
+    };
+    const __m128i shift = _mm_cvtsi32_si128(scanlines);
+
+    int row = first_row;
+    for (; in_height; --in_height, ++row)
+    {
+        const bool dim = scanlines && (row & 1); // scanlines fall on odd rows of the image
+        char const* ktable = (char const*) ntsc->table + burst_phase * (snes_ntsc_burst_size * sizeof (snes_ntsc_rgb_t));
+        snes_ntsc_rgb_t const* black = SNES_NTSC_IN_FORMAT(ktable, snes_ntsc_black);
+
+        // as SNES_NTSC_HIRES_ROW(black, black, black, in[0], in[1]): kernel0-5 (cur), kernelx0-5 (prev)
+        SNES_NTSC_IN_T const* restrict line_in = input;
+        snes_ntsc_avx2_state s;
+        for (int i = 0; i < 6; i++)
+            s.cur[i] = s.prev[i] = s.prev2[i] = black;
+        s.cur[4] = SNES_NTSC_IN_FORMAT(ktable, SNES_NTSC_ADJ_IN(line_in[0]));
+        s.cur[5] = SNES_NTSC_IN_FORMAT(ktable, SNES_NTSC_ADJ_IN(line_in[1]));
+
+        snes_ntsc_rgb_t* restrict line_out = (snes_ntsc_rgb_t*)rgb_out;
+        __m256i out[4] = {};
+        uint16_t last_colour = 0;
+        int run = 0;    // blocks of last_colour in a row, after the first
+
+        // blocks of four chunks: input pixels 2-25 from line_in, 28 outputs
+        for (int n = (chunk_count>>2); n; --n)
+        {
+            // the run detection of CHECK_ALL_EQUAL: the block's 24 pixels are all one colour (not 0)
+            const __m128i ref = _mm_set1_epi16((short)line_in[2]);
+            const __m256i lo  = _mm256_cmpeq_epi16(_mm256_loadu_si256((__m256i const*)&line_in[2]),
+                                                   _mm256_broadcastsi128_si256(ref));
+            const __m128i hi  = _mm_cmpeq_epi16(_mm_loadu_si128((__m128i const*)&line_in[18]), ref);
+            const bool all_equal = _mm256_movemask_epi8(lo) == -1 && _mm_movemask_epi8(hi) == 0xFFFF;
+            const uint16_t this_colour = all_equal ? line_in[2] : 0;
+
+            run = ((this_colour == last_colour) & (this_colour != 0)) ? run + 1 : 0;
+            last_colour = this_colour;
+
+            if (run == 1) {
+                // the last two chunks are in steady state, as the rest of the run would be
+                out[0] = out[2];
+                out[1] = out[3];
+            }
+            else if (run == 0) {
+                for (int c = 0; c < 4; c++) {
+                    SNES_NTSC_IN_T const* px = line_in + 2 + c * 6;
+                    const unsigned colour[6] = {
+                        SNES_NTSC_ADJ_IN(px[0]), SNES_NTSC_ADJ_IN(px[1]), SNES_NTSC_ADJ_IN(px[2]),
+                        SNES_NTSC_ADJ_IN(px[3]), SNES_NTSC_ADJ_IN(px[4]), SNES_NTSC_ADJ_IN(px[5])
+                    };
+                    snes_ntsc_avx2_next(s, ktable, colour);
+                    out[c] = snes_ntsc_avx2_convert(snes_ntsc_avx2_chunk(s, rot));
+                    if (dim)
+                        out[c] = snes_ntsc_avx2_scanline(out[c], shift);
+                }
+            }
+
+            #ifndef _WIN32
+                __builtin_prefetch(line_in + 32, 0, 0);   // prefect next input: read, streaming
+            #endif
+            for (int c = 0; c < 4; c++)
+                _mm256_storeu_si256((__m256i*)&line_out[c * 7], out[c]);
+
+            line_in  += 24;
+            line_out += 28;
+        }
+
+        // End of line, as the SSE version: pixels 2-15 from line_in then black, 24 outputs, the
+        // last four black
+        {
+            const unsigned k = snes_ntsc_black;
+            SNES_NTSC_IN_T const* px = line_in + 2;
+            const unsigned colour[3][6] = {
+                { SNES_NTSC_ADJ_IN(px[0]), SNES_NTSC_ADJ_IN(px[1]),  SNES_NTSC_ADJ_IN(px[2]),
+                  SNES_NTSC_ADJ_IN(px[3]), SNES_NTSC_ADJ_IN(px[4]),  SNES_NTSC_ADJ_IN(px[5]) },
+                { SNES_NTSC_ADJ_IN(px[6]), SNES_NTSC_ADJ_IN(px[7]),  SNES_NTSC_ADJ_IN(px[8]),
+                  SNES_NTSC_ADJ_IN(px[9]), SNES_NTSC_ADJ_IN(px[10]), SNES_NTSC_ADJ_IN(px[11]) },
+                { SNES_NTSC_ADJ_IN(px[12]), SNES_NTSC_ADJ_IN(px[13]), k, k, k, k }
+            };
+            for (int c = 0; c < 3; c++) {
+                snes_ntsc_avx2_next(s, ktable, colour[c]);
+                __m256i v = snes_ntsc_avx2_chunk(s, rot);
+                if (c == 2)
+                    v = _mm256_blend_epi32(v, _mm256_setzero_si256(), 0xC0); // 7th output, and padding
+                v = snes_ntsc_avx2_convert(v);
+                if (dim)
+                    v = snes_ntsc_avx2_scanline(v, shift);
+                _mm256_storeu_si256((__m256i*)&line_out[c * 7], v);
+                if (c == 2)
+                    _mm_storel_epi64((__m128i*)&line_out[22], _mm_srli_si128(_mm256_extracti128_si256(v, 1), 8));
+            }
+        }
+
+        burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
+        input += in_row_width;
+        rgb_out = (char*)rgb_out + out_pitch;
+    }
+}
+
+#undef SNES_NTSC_AVX2_SLOT
+#undef SNES_NTSC_AVX2_LOAD
+#undef SNES_NTSC_AVX2
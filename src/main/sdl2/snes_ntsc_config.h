@@ -22,8 +22,11 @@ handle things however it wants. */
 
 /* Each raw pixel input value is passed through this. You might want to mask
 the pixel index if you use the high bits as flags, etc. */
-#define SNES_NTSC_ADJ_IN( in ) in
+//#define SNES_NTSC_ADJ_IN( in ) in
 //#define SNES_NTSC_ADJ_IN( in ) ((in & 0x7FFF) * (in >> 16))
+/* JJP - input pixels are S16 palette indices, translated by the blitter's 'palette' argument
+(RenderBase::rgb_blargg) as they are read, so the frame isn't converted in a separate pass */
+#define SNES_NTSC_ADJ_IN( in ) (palette[in])
 
 /* For each pixel, this is the basic operation:
 output_color = SNES_NTSC_ADJ_IN( SNES_NTSC_IN_T ) */
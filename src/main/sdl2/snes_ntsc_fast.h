@@ -0,0 +1,331 @@
+/* JJP - snes_ntsc_blit_hires_fast, included by snes_ntsc.cpp once for each SIMD level it is
+   built at. Define SNES_NTSC_FAST_NAME and SNES_NTSC_FAST_DECL (storage class and target
+   attribute, or empty) first; the register macros in snes_ntsc.h are used as they stand at the point of inclusion. */
+
+SNES_NTSC_FAST_DECL void SNES_NTSC_FAST_NAME(snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* restrict input,
+    SNES_NTSC_IN_T const* restrict palette, long in_row_width,
+    int burst_phase, int in_width, int in_height, void* restrict rgb_out, long out_pitch, long Alevel,
+    int scanlines, int first_row)
+    // This version utilises SIMD registers streamline:
+    // 1. Loading of pixels, as six 128-bit loads (providing 24 pixels in 6 registers), looked up in
+    //    the palette as each is extracted
+    // 2. Clamp and RGB conversion, as the SIMD registers can be used to perform the calculations
+    // 3. Output to memory, as the SIMD registers can be used to store the output values as seven 128-bit stores
+    // 4. Scanlines, applied to the registers before they are stored so each row is written once
+    // The Blargg algorithm itself is implemented in full, except for a small change in end-of-line processing
+    // to keep output line width divisable by 4 and hence 128-bit aligned.
+{
+    int chunk_count = in_width / (snes_ntsc_in_chunk * 2); // should be 640 / (3 * 2) = 106
+
+    // Prepare SIMD vectors
+    SET_SNES_MASK_VECTORS;
+    SET_SNES_SCANLINE_VECTORS(scanlines);
+    int row = first_row;
+    //for (int y = 0; y<in_height; y++)
+    for (; in_height; --in_height, ++row)
+    {
+        int x = 0;
+        const bool dim = scanlines && (row & 1); // scanlines fall on odd rows of the image
+        // SIMD Input Registers (uint16_t x4)
+        SIMD_INPUT_REGISTER_t xmm0, xmm1, xmm2, xmm3, xmm4, xmm5, xmm6; // inputs
+
+        // Outputs - xmm10..16 (uint32_t x4)
+        SIMD_REGISTER_t xmm10 = SIMD_ZERO;
+        SIMD_REGISTER_t xmm11 = SIMD_ZERO;
+        SIMD_REGISTER_t xmm12 = SIMD_ZERO;
+        SIMD_REGISTER_t xmm13 = SIMD_ZERO;
+        SIMD_REGISTER_t xmm14 = SIMD_ZERO;
+        SIMD_REGISTER_t xmm15 = SIMD_ZERO;
+        SIMD_REGISTER_t xmm16 = SIMD_ZERO;
+
+        // setup the first block, which will affect the second block.
+
+        // load the first four pixels from memory
+        SNES_NTSC_IN_T const* restrict line_in = input;
+        SNES_NTSC_IN_T const* block = line_in; // first pixel in xmm0 (see SNES_NTSC_FAST_IN)
+        (void)block;                           // only read on ARM
+        xmm0 = LOAD_SIMD_REGISTER(&line_in[0]);
+
+        // and use the first two pixels for this initial block
+        SNES_NTSC_HIRES_ROW(ntsc, burst_phase,
+            snes_ntsc_black, snes_ntsc_black, snes_ntsc_black,
+            SNES_NTSC_FAST_IN(0, 0),
+            SNES_NTSC_FAST_IN(0, 1));
+        snes_ntsc_out_t* restrict line_out = (snes_ntsc_out_t*)rgb_out;
+
+        // set up SIMD registers and flags
+        int iterations = 0;
+        uint16_t last_colour = 0;
+        uint16_t this_colour = 0;
+        int run = 0;    // blocks of last_colour in a row, after the first
+
+        for (int n = (chunk_count>>2); n; --n)
+        {
+            // Load the next 6x4 = 24 pixels
+            xmm1 = LOAD_SIMD_REGISTER(&line_in[4]);
+            xmm2 = LOAD_SIMD_REGISTER(&line_in[8]);
+            xmm3 = LOAD_SIMD_REGISTER(&line_in[12]);
+            xmm4 = LOAD_SIMD_REGISTER(&line_in[16]);
+            xmm5 = LOAD_SIMD_REGISTER(&line_in[20]);
+            xmm6 = LOAD_SIMD_REGISTER(&line_in[24]); // need 0/1 for this pass; 2/3 for next
+            block = line_in;
+            line_in += 24;
+
+            // 1st six. Loop is unrolled to four iterations permitting full use
+            // of 4-wide SIMD registers
+
+            // stores result in this_colour, 0 if not equal or the colour if equal. This compares
+            // palette indices, so equal colours from different indices just take the full path.
+            CHECK_ALL_EQUAL;
+
+            // Runs of one colour. An output depends on the pixels of its own chunk and of up to two
+            // chunks before, so once a block of the run has been calculated, its last two chunks
+            // are in steady state: every kernel is this colour's. The pattern repeats every chunk
+            // (seven outputs), so the first two chunks of the next block take the values of the
+            // last two, and every later block of the run stores the same 28 outputs again. The
+            // kernel state skipped meanwhile would be unchanged. this_colour must be non-zero.
+            run = ((this_colour == last_colour) & (this_colour != 0)) ? run + 1 : 0;
+            last_colour = this_colour;
+
+            if (run == 1) {
+                // outputs 0-13 become those of 14-27
+                xmm10 = CONCAT_SIMD_REGISTER(xmm13, xmm14, 2);
+                xmm11 = CONCAT_SIMD_REGISTER(xmm14, xmm15, 2);
+                xmm12 = CONCAT_SIMD_REGISTER(xmm15, xmm16, 2);
+                xmm13 = CONCAT_SIMD_REGISTER(xmm16, xmm10, 2);  // outputs 26, 27 then 14, 15
+            }
+
+            // check if we need to go through the calculation process
+            if (run == 0) {
+                // we need to do the full calculation
+                // This block processes 6x4(=24) input pixels to produce 7x4(=28) output pixels
+
+                /* process first six input pixels to produce seven outputs */
+                SNES_NTSC_COLOR_IN(0, SNES_NTSC_FAST_IN(0, 2));
+                xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(0), 0);
+
+                SNES_NTSC_COLOR_IN(1, SNES_NTSC_FAST_IN(0, 3));
+                xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(1), 1);
+
+                SNES_NTSC_COLOR_IN(2, SNES_NTSC_FAST_IN(1, 0));
+                xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(2), 2);
+
+                SNES_NTSC_COLOR_IN(3, SNES_NTSC_FAST_IN(1, 1));
+                xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(3), 3);
+
+                SNES_NTSC_COLOR_IN(4, SNES_NTSC_FAST_IN(1, 2));
+                xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(4), 0);
+
+                SNES_NTSC_COLOR_IN(5, SNES_NTSC_FAST_IN(1, 3));
+                xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(5), 1);
+
+                xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(6), 2);
+
+                /* process second six input pixels to produce seven outputs */
+                SNES_NTSC_COLOR_IN(0, SNES_NTSC_FAST_IN(2, 0));
+                xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(0), 3);
+
+                SNES_NTSC_COLOR_IN(1, SNES_NTSC_FAST_IN(2, 1));
+                xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(1), 0);
+
+                SNES_NTSC_COLOR_IN(2, SNES_NTSC_FAST_IN(2, 2));
+                xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(2), 1);
+
+                SNES_NTSC_COLOR_IN(3, SNES_NTSC_FAST_IN(2, 3));
+                xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(3), 2);
+
+                SNES_NTSC_COLOR_IN(4, SNES_NTSC_FAST_IN(3, 0));
+                xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(4), 3);
+
+                SNES_NTSC_COLOR_IN(5, SNES_NTSC_FAST_IN(3, 1));
+                xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(5), 0);
+
+                xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(6), 1);
+
+                /* process third six input pixels to produce seven outputs */
+                SNES_NTSC_COLOR_IN(0, SNES_NTSC_FAST_IN(3, 2));
+                xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(0), 2);
+
+                SNES_NTSC_COLOR_IN(1, SNES_NTSC_FAST_IN(3, 3));
+                xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(1), 3);
+
+                SNES_NTSC_COLOR_IN(2, SNES_NTSC_FAST_IN(4, 0));
+                xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(2), 0);
+
+                SNES_NTSC_COLOR_IN(3, SNES_NTSC_FAST_IN(4, 1));
+                xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(3), 1);
+
+                SNES_NTSC_COLOR_IN(4, SNES_NTSC_FAST_IN(4, 2));
+                xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(4), 2);
+
+                SNES_NTSC_COLOR_IN(5, SNES_NTSC_FAST_IN(4, 3));
+                xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(5), 3);
+
+                xmm15 = INSERT_SIMD_REGISTER_VALUE(xmm15, SNES_NTSC_HIRES_OUT_SIMD(6), 0);
+
+                /* process fourth set of six input pixels to produce seven outputs */
+                SNES_NTSC_COLOR_IN(0, SNES_NTSC_FAST_IN(5, 0));
+                xmm15 = INSERT_SIMD_REGISTER_VALUE(xmm15, SNES_NTSC_HIRES_OUT_SIMD(0), 1);
+
+                SNES_NTSC_COLOR_IN(1, SNES_NTSC_FAST_IN(5, 1));
+                xmm15 = INSERT_SIMD_REGISTER_VALUE(xmm15, SNES_NTSC_HIRES_OUT_SIMD(1), 2);
+
+                SNES_NTSC_COLOR_IN(2, SNES_NTSC_FAST_IN(5, 2));
+                xmm15 = INSERT_SIMD_REGISTER_VALUE(xmm15, SNES_NTSC_HIRES_OUT_SIMD(2), 3);
+
+                SNES_NTSC_COLOR_IN(3, SNES_NTSC_FAST_IN(5, 3));
+                xmm16 = INSERT_SIMD_REGISTER_VALUE(xmm16, SNES_NTSC_HIRES_OUT_SIMD(3), 0);
+
+                SNES_NTSC_COLOR_IN(4, SNES_NTSC_FAST_IN(6, 0));
+                xmm16 = INSERT_SIMD_REGISTER_VALUE(xmm16, SNES_NTSC_HIRES_OUT_SIMD(4), 1);
+
+                SNES_NTSC_COLOR_IN(5, SNES_NTSC_FAST_IN(6, 1));
+                xmm16 = INSERT_SIMD_REGISTER_VALUE(xmm16, SNES_NTSC_HIRES_OUT_SIMD(5), 2);
+
+                xmm16 = INSERT_SIMD_REGISTER_VALUE(xmm16, SNES_NTSC_HIRES_OUT_SIMD(6), 3);
+
+                // Outputs are in xmm10..xmm16 - perform clamp
+                SNES_NTSC_CLAMP_AND_CONVERT(xmm10);
+                SNES_NTSC_CLAMP_AND_CONVERT(xmm11);
+                SNES_NTSC_CLAMP_AND_CONVERT(xmm12);
+                SNES_NTSC_CLAMP_AND_CONVERT(xmm13);
+                SNES_NTSC_CLAMP_AND_CONVERT(xmm14);
+                SNES_NTSC_CLAMP_AND_CONVERT(xmm15);
+                SNES_NTSC_CLAMP_AND_CONVERT(xmm16);
+
+                // dimmed once here; the rest of a run stores these registers as they are
+                if (dim) {
+                    SNES_NTSC_SCANLINE(xmm10);
+                    SNES_NTSC_SCANLINE(xmm11);
+                    SNES_NTSC_SCANLINE(xmm12);
+                    SNES_NTSC_SCANLINE(xmm13);
+                    SNES_NTSC_SCANLINE(xmm14);
+                    SNES_NTSC_SCANLINE(xmm15);
+                    SNES_NTSC_SCANLINE(xmm16);
+                }
+            }
+
+            #ifndef _WIN32
+                __builtin_prefetch(line_in  + 32, 0, 0);   // prefect next input: read, streaming
+            #endif
+            SNES_NTSC_RGB_STORE(&line_out[0], xmm10);
+            SNES_NTSC_RGB_STORE(&line_out[4], xmm11);
+            SNES_NTSC_RGB_STORE(&line_out[8], xmm12);
+            SNES_NTSC_RGB_STORE(&line_out[12], xmm13);
+            SNES_NTSC_RGB_STORE(&line_out[16], xmm14);
+            SNES_NTSC_RGB_STORE(&line_out[20], xmm15);
+            SNES_NTSC_RGB_STORE(&line_out[24], xmm16);
+
+            // replace xmm0 with next block (we're 2 input pixels out of sync due to the start of line)
+            xmm0 = xmm6;
+
+            line_out += 28; // advance pointer (4x7)
+            x += 28;
+        }
+
+        // At this point with have 6x2 + 2 = 14 input pixels left to process, plus we write out
+        // the remaining pixels based on black input pixels to allow the end of line.
+        {
+            // Load the final 2x6 = 12 pixels
+            xmm1 = LOAD_SIMD_REGISTER(&line_in[4]);
+            xmm2 = LOAD_SIMD_REGISTER(&line_in[8]);
+            xmm3 = LOAD_SIMD_REGISTER(&line_in[12]);
+            block = line_in;
+
+            /* process first six input pixels to produce seven outputs */
+            SNES_NTSC_COLOR_IN(0, SNES_NTSC_FAST_IN(0, 2));
+            xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(0), 0);
+
+            SNES_NTSC_COLOR_IN(1, SNES_NTSC_FAST_IN(0, 3));
+            xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(1), 1);
+
+            SNES_NTSC_COLOR_IN(2, SNES_NTSC_FAST_IN(1, 0));
+            xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(2), 2);
+
+            SNES_NTSC_COLOR_IN(3, SNES_NTSC_FAST_IN(1, 1));
+            xmm10 = INSERT_SIMD_REGISTER_VALUE(xmm10, SNES_NTSC_HIRES_OUT_SIMD(3), 3);
+
+            SNES_NTSC_COLOR_IN(4, SNES_NTSC_FAST_IN(1, 2));
+            xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(4), 0);
+
+            SNES_NTSC_COLOR_IN(5, SNES_NTSC_FAST_IN(1, 3));
+            xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(5), 1);
+
+            xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(6), 2);
+
+            /* process last six input pixels for this row to produce seven outputs */
+            SNES_NTSC_COLOR_IN(0, SNES_NTSC_FAST_IN(2, 0));
+            xmm11 = INSERT_SIMD_REGISTER_VALUE(xmm11, SNES_NTSC_HIRES_OUT_SIMD(0), 3);
+
+            SNES_NTSC_COLOR_IN(1, SNES_NTSC_FAST_IN(2, 1));
+            xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(1), 0);
+
+            SNES_NTSC_COLOR_IN(2, SNES_NTSC_FAST_IN(2, 2));
+            xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(2), 1);
+
+            SNES_NTSC_COLOR_IN(3, SNES_NTSC_FAST_IN(2, 3));
+            xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(3), 2);
+
+            SNES_NTSC_COLOR_IN(4, SNES_NTSC_FAST_IN(3, 0));
+            xmm12 = INSERT_SIMD_REGISTER_VALUE(xmm12, SNES_NTSC_HIRES_OUT_SIMD(4), 3);
+
+            SNES_NTSC_COLOR_IN(5, SNES_NTSC_FAST_IN(3, 1));
+            xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(5), 0);
+
+            xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(6), 1);
+
+            /* process third six input pixels to produce seven outputs */
+            SNES_NTSC_COLOR_IN(0, SNES_NTSC_FAST_IN(3, 2));
+            xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(0), 2);
+
+            SNES_NTSC_COLOR_IN(1, SNES_NTSC_FAST_IN(3, 3));
+            xmm13 = INSERT_SIMD_REGISTER_VALUE(xmm13, SNES_NTSC_HIRES_OUT_SIMD(1), 3);
+
+            SNES_NTSC_COLOR_IN(2, snes_ntsc_black);
+            xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(2), 0);
+
+            SNES_NTSC_COLOR_IN(3, snes_ntsc_black);
+            xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(3), 1);
+
+            SNES_NTSC_COLOR_IN(4, snes_ntsc_black);
+            xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(4), 2);
+
+            SNES_NTSC_COLOR_IN(5, snes_ntsc_black);
+            xmm14 = INSERT_SIMD_REGISTER_VALUE(xmm14, SNES_NTSC_HIRES_OUT_SIMD(5), 3);
+
+            xmm15 = ZERO_SIMD_REGISTER; // 7th output of this block is black, and 3 pixels padding to retain alignment
+
+            // Clamp the outputs and adjust to RGBA
+            SNES_NTSC_CLAMP_AND_CONVERT(xmm10);
+            SNES_NTSC_CLAMP_AND_CONVERT(xmm11);
+            SNES_NTSC_CLAMP_AND_CONVERT(xmm12);
+            SNES_NTSC_CLAMP_AND_CONVERT(xmm13);
+            SNES_NTSC_CLAMP_AND_CONVERT(xmm14);
+            SNES_NTSC_CLAMP_AND_CONVERT(xmm15);
+
+            if (dim) {
+                SNES_NTSC_SCANLINE(xmm10);
+                SNES_NTSC_SCANLINE(xmm11);
+                SNES_NTSC_SCANLINE(xmm12);
+                SNES_NTSC_SCANLINE(xmm13);
+                SNES_NTSC_SCANLINE(xmm14);
+                SNES_NTSC_SCANLINE(xmm15);
+            }
+
+            // and store
+            SNES_NTSC_RGB_STORE(&line_out[0], xmm10);
+            SNES_NTSC_RGB_STORE(&line_out[4], xmm11);
+            SNES_NTSC_RGB_STORE(&line_out[8], xmm12);
+            SNES_NTSC_RGB_STORE(&line_out[12], xmm13);
+            SNES_NTSC_RGB_STORE(&line_out[16], xmm14);
+            SNES_NTSC_RGB_STORE(&line_out[20], xmm15);
+        }
+
+        burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
+        input += in_row_width;
+        rgb_out = (char*)rgb_out + out_pitch;
+    }
+}
+
+#undef SNES_NTSC_FAST_NAME
+#undef SNES_NTSC_FAST_DECL
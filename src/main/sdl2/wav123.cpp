@@ -16,8 +16,17 @@
 #include <vector>
 #include <memory>
 #include <cmath>
+#include <algorithm>
 #include <limits>
 
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 struct wav123_handle
 {
     // File
@@ -59,6 +68,13 @@ struct wav123_handle
 
     // Small raw read buffer (untranslated bytes)
     std::vector<unsigned char> raw;   // multiple of block_align
+
+    // File mapping (wav123_map)
+    void*    map_base        = nullptr;
+    size_t   map_bytes       = 0;
+#ifdef _WIN32
+    HANDLE   map_handle      = nullptr;
+#endif
 };
 
 // ---------- helpers ----------
@@ -419,9 +435,70 @@ int wav123_read(wav123_handle* h, unsigned char* out, size_t out_size, size_t* d
     return (h->data_left >= h->src_block_align) ? WAV123_OK : WAV123_DONE;
 }
 
+const int16_t* wav123_map(wav123_handle* h, size_t* samples)
+{
+    if (samples) *samples = 0;
+    if (!h || !h->opened || !h->formatted || !h->fp) return nullptr;
+
+    // only when wav123_read would be a straight copy
+    if (h->src_format != 1 || h->src_bits != 16 || !h->rates_equal ||
+        h->src_channels != h->out_channels || h->out_enc != WAV123_ENC_SIGNED_16)
+        return nullptr;
+    if (h->data_offset & 1) return nullptr; // samples must be aligned
+
+    if (!h->map_base)
+    {
+#ifdef _WIN32
+        HANDLE fh = (HANDLE)_get_osfhandle(_fileno(h->fp));
+        LARGE_INTEGER size;
+        if (fh == INVALID_HANDLE_VALUE || !GetFileSizeEx(fh, &size)) return nullptr;
+        HANDLE mh = CreateFileMappingA(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mh) return nullptr;
+        void* base = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+        if (!base)
+        {
+            CloseHandle(mh);
+            return nullptr;
+        }
+        h->map_handle = mh;
+        h->map_bytes  = (size_t)size.QuadPart;
+#else
+        const int fd = fileno(h->fp);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0 || st.st_size <= 0) return nullptr;
+        void* base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) return nullptr;
+        // played front to back
+        madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+        h->map_bytes = (size_t)st.st_size;
+#endif
+        h->map_base = base;
+    }
+
+    // a truncated file holds less than the data chunk claims
+    if (h->data_offset >= h->map_bytes) return nullptr;
+    uint64_t bytes = std::min<uint64_t>(h->data_bytes, h->map_bytes - h->data_offset);
+    bytes -= bytes % h->src_block_align;
+
+    if (samples) *samples = (size_t)(bytes / sizeof(int16_t));
+    return (const int16_t*)((const unsigned char*)h->map_base + h->data_offset);
+}
+
 int wav123_close(wav123_handle* h)
 {
     if (!h) return WAV123_ERR;
+    if (h->map_base)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(h->map_base);
+        CloseHandle(h->map_handle);
+        h->map_handle = nullptr;
+#else
+        munmap(h->map_base, h->map_bytes);
+#endif
+        h->map_base  = nullptr;
+        h->map_bytes = 0;
+    }
     if (h->fp)
     {
         std::fclose(h->fp);
@@ -58,6 +58,13 @@ off_t        wav123_length(wav123_handle* h);
 // Returns: WAV123_OK (more data may follow), WAV123_DONE (finished), WAV123_ERR (error)
 int          wav123_read(wav123_handle* h, unsigned char* out, size_t out_size, size_t* done);
 
+// Zero-copy access to the samples, for files already in the output format (16-bit PCM at
+// the rate and channel count given to wav123_format). Maps the file and returns the data
+// chunk as interleaved S16, with its length in samples (all channels) in *samples, or
+// nullptr if the file needs converting or can't be mapped. The mapping stays valid until
+// wav123_close.
+const int16_t* wav123_map(wav123_handle* h, size_t* samples);
+
 // Close and free
 int          wav123_close(wav123_handle* h);
 void         wav123_delete(wav123_handle* h);
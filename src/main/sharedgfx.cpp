@@ -0,0 +1,138 @@
+/***************************************************************************
+    Shared Graphics Tables (Linux).
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include "sharedgfx.hpp"
+
+#ifdef __linux__
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Ahead of the tables, in a cache line of its own. The creator holds an exclusive flock on
+// the segment from before sizing it until the tables are ready, so an instance that can take
+// the lock and finds a sized segment not READY knows that its creator died building it.
+struct Header
+{
+    uint32_t              magic;
+    std::atomic<uint32_t> state;
+};
+static const uint32_t MAGIC      = 0x58464743; // "CGFX"
+static const uint32_t READY      = 1;
+static const size_t   HEADER_LEN = 64;
+
+static void* map(int fd, size_t total)
+{
+    void* p = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+void* sharedgfx::attach(const std::string& name, size_t bytes,
+                        const std::function<void(void*)>& build, bool* created)
+{
+    const std::string path  = "/" + name;
+    const size_t      total = HEADER_LEN + bytes;
+    if (created) *created = false;
+
+    for (int attempt = 0; attempt < 20; attempt++)
+    {
+        int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd >= 0)
+        {
+            flock(fd, LOCK_EX);
+            uint8_t* base = nullptr;
+            if (ftruncate(fd, off_t(total)) == 0)
+                base = static_cast<uint8_t*>(map(fd, total));
+            if (!base)
+            {
+                std::cerr << "sharedgfx: unable to create " << path << ": " << std::strerror(errno) << std::endl;
+                shm_unlink(path.c_str());
+                close(fd);
+                return nullptr;
+            }
+            build(base + HEADER_LEN);
+            Header* header = reinterpret_cast<Header*>(base);
+            header->magic = MAGIC;
+            header->state.store(READY, std::memory_order_release);
+            flock(fd, LOCK_UN);
+            close(fd);
+            if (created) *created = true;
+            std::cout << "sharedgfx: built " << path << " (" << (bytes + 1023) / 1024 << "KB) for other instances" << std::endl;
+            return base + HEADER_LEN;
+        }
+        if (errno != EEXIST)
+        {
+            std::cerr << "sharedgfx: unable to create " << path << ": " << std::strerror(errno) << std::endl;
+            return nullptr;
+        }
+
+        fd = shm_open(path.c_str(), O_RDWR | O_CLOEXEC, 0600);
+        if (fd < 0)
+            continue; // removed since; try creating it again
+
+        // waits here while another instance builds the tables
+        flock(fd, LOCK_SH);
+        struct stat st;
+        const size_t size = fstat(fd, &st) == 0 ? size_t(st.st_size) : 0;
+        uint8_t* base = size == total ? static_cast<uint8_t*>(map(fd, total)) : nullptr;
+        const bool ready = base && reinterpret_cast<Header*>(base)->magic == MAGIC &&
+                           reinterpret_cast<Header*>(base)->state.load(std::memory_order_acquire) == READY;
+        flock(fd, LOCK_UN);
+        close(fd);
+
+        if (ready)
+            return base + HEADER_LEN;
+        if (base)
+        {
+            munmap(base, total);
+            std::cerr << "sharedgfx: " << path << " was left incomplete; rebuilding it" << std::endl;
+            shm_unlink(path.c_str());
+        }
+        else if (size != 0)
+        {
+            std::cerr << "sharedgfx: " << path << " is not the expected size; using tables of our own" << std::endl;
+            return nullptr;
+        }
+        else
+        {
+            // just created, and not yet locked by its creator
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            if (attempt == 19)
+                shm_unlink(path.c_str());
+        }
+    }
+    std::cerr << "sharedgfx: unable to attach " << path << "; using tables of our own" << std::endl;
+    return nullptr;
+}
+
+void sharedgfx::detach(void* data, size_t bytes)
+{
+    if (data)
+        munmap(static_cast<uint8_t*>(data) - HEADER_LEN, HEADER_LEN + bytes);
+}
+
+#else
+
+void* sharedgfx::attach(const std::string&, size_t, const std::function<void(void*)>&, bool* created)
+{
+    if (created) *created = false;
+    std::cerr << "sharedgfx: shared graphics tables are only available on Linux" << std::endl;
+    return nullptr;
+}
+
+void sharedgfx::detach(void*, size_t) {}
+
+#endif
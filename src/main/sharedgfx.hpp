@@ -0,0 +1,37 @@
+/***************************************************************************
+    Shared Graphics Tables (Linux).
+
+    For hosts running several instances: large tables built from the ROMs
+    are placed in a named POSIX shared memory segment (/dev/shm), so they
+    are built once, by the first instance to start, and mapped by every
+    other. The segment outlives the instances, so later starts attach to it
+    at once; it is named after the ROM CRC and table version, so a
+    different ROM set or build uses a segment of its own.
+
+    Where shared memory can't be used (not Linux, no /dev/shm, or an
+    instance that died building the segment), attach() returns nullptr and
+    the caller keeps tables of its own, as without data.shared_gfx.
+
+    See data.shared_gfx in config.xml.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+namespace sharedgfx
+{
+    // Map the segment called name, of bytes, creating it if no instance has. build() fills
+    // a new segment, and is run by the one instance that creates it; an instance attaching
+    // while it runs waits for it. created is set to whether build() ran here.
+    void* attach(const std::string& name, size_t bytes,
+                 const std::function<void(void*)>& build, bool* created = nullptr);
+
+    // Unmap a segment from attach(). The segment itself is kept for other instances.
+    void detach(void* data, size_t bytes);
+}
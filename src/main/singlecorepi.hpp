@@ -1,14 +1,14 @@
 // singleCorePi.hpp
 #pragma once
-#include <omp.h>
+#include <thread>
 #include <fstream>
 #include <string>
 #include <algorithm>
 
 /// @brief Returns true if the program is running on a single‑core Raspberry Pi.
 /// @details
-///   1. `omp_get_max_threads()` must be **1** – the OpenMP runtime reports only one
-///      thread, which is a strong hint that the CPU is single‑core.
+///   1. `std::thread::hardware_concurrency()` must be **1** – the runtime reports only
+///      one hardware thread, which is a strong hint that the CPU is single‑core.
 ///   2. The device tree must contain a model string that starts with `"Raspberry Pi"`.
 ///      The function looks for either
 ///        /sys/firmware/devicetree/base/model
@@ -16,17 +16,17 @@
 ///        /proc/device-tree/model
 ///   If **both** checks pass, the function returns `true`.
 ///
-///   The function does *not* throw exceptions – any I/O or OpenMP error
+///   The function does *not* throw exceptions – any I/O error
 ///   simply causes a `false` result.
 ///
 /// @return true if the conditions are satisfied; otherwise false.
 inline bool singleCorePi()
 {
     /* -------------------------------------------------
-       1️⃣  OpenMP thread count
+       1️⃣  Hardware thread count
        ------------------------------------------------- */
-    const int ompThreads = omp_get_max_threads();
-    if (ompThreads != 1) return false;           // not a single‑core OMP machine
+    const unsigned hwThreads = std::thread::hardware_concurrency();
+    if (hwThreads != 1) return false;            // not a single‑core machine
 
     /* -------------------------------------------------
        2️⃣  Check device‑tree model string
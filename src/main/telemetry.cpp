@@ -0,0 +1,77 @@
+/***************************************************************************
+    Telemetry Export.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <cstdio>
+#include <iostream>
+#include "telemetry.hpp"
+#include "attractgov.hpp"
+#include "fpsauto.hpp"
+#include "frametrace.hpp"
+#include "main.hpp"
+#include "frontend/config.hpp"
+
+// The window of each point since the last write
+static frametrace::Window windows[frametrace::POINTS];
+
+static void metric(FILE* f, const char* name, const char* type, const char* help, double value)
+{
+    fprintf(f, "# HELP cannonball_%s %s\n# TYPE cannonball_%s %s\ncannonball_%s %g\n",
+            name, help, name, type, name, value);
+}
+
+bool telemetry::write(const std::string& path)
+{
+    const std::string temp = path + ".tmp";
+    FILE* f = std::fopen(temp.c_str(), "w");
+    if (!f) {
+        std::cerr << "telemetry: unable to write " << temp << std::endl;
+        return false;
+    }
+
+    metric(f, "fps", "gauge", "Frames shown per second, over the last 2 seconds.", cannonball::fps_counter);
+    metric(f, "dropped_frames_percent", "gauge", "Frames dropped, percent, over the last 2 seconds.",
+           cannonball::dropped_percent);
+    metric(f, "frame_rate", "gauge", "Frame rate the game is running at (30 or 60).", config.fps);
+    metric(f, "frame_rate_locked", "gauge", "1 if the frame rate is locked, 0 if chosen automatically.",
+           cannonball::fps_lock != 0);
+    metric(f, "auto_30fps_stages", "gauge", "Mask of the route stages (bit 15 the menus) auto mode runs at 30fps.",
+           fpsauto::get_stages());
+
+    fprintf(f, "# HELP cannonball_frame_stage_ms Time of a stage of the frame since the last write.\n"
+               "# TYPE cannonball_frame_stage_ms summary\n");
+    for (int point = 0; point < frametrace::POINTS; point++) {
+        double p50, p99;
+        const uint64_t samples = frametrace::window(point, windows[point], &p50, &p99);
+        if (!samples)
+            continue;
+        const char* stage = frametrace::name(point);
+        fprintf(f, "cannonball_frame_stage_ms{stage=\"%s\",quantile=\"0.5\"} %.3f\n", stage, p50);
+        fprintf(f, "cannonball_frame_stage_ms{stage=\"%s\",quantile=\"0.99\"} %.3f\n", stage, p99);
+        fprintf(f, "cannonball_frame_stage_ms_count{stage=\"%s\"} %llu\n", stage, (unsigned long long) samples);
+    }
+
+    const Audio::ring_stats_t ring = cannonball::audio.get_ring_stats();
+    metric(f, "audio_underruns_total", "counter", "Audio callbacks that found nothing mixed.", ring.underruns);
+    metric(f, "audio_lead_ms", "gauge", "Least audio mixed ahead of playback, over the last window.", ring.lead_ms);
+    metric(f, "audio_ring_buffers", "gauge", "Audio buffers the mixer may fill ahead of playback.", ring.depth);
+
+    const int temperature = attractgov::soc_temperature();
+    if (temperature > -273)
+        metric(f, "soc_temperature_celsius", "gauge", "SoC temperature.", temperature);
+    metric(f, "soc_throttle_flags", "gauge", "Raspberry Pi firmware throttle flags (get_throttled).",
+           attractgov::throttle_flags());
+
+    metric(f, "plays_total", "counter", "Games played on this machine.", config.stats.playcount);
+    metric(f, "runtime_minutes_total", "counter", "Minutes this machine has run the game.", config.stats.runtime);
+
+    const bool ok = std::fclose(f) == 0;
+    if (!ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::cerr << "telemetry: unable to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
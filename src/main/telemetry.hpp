@@ -0,0 +1,30 @@
+/***************************************************************************
+    Telemetry Export.
+
+    For a fleet of cabinets: every 10 seconds, the stats thread writes the
+    machine's state to data.telemetry in the Prometheus text format, for
+    node_exporter's textfile collector (or anything else that reads it) to
+    pass on. It holds the frame rate, frames dropped, the 30/60fps mode and
+    the stages auto mode has dropped to 30fps on, the p50 and p99 time of
+    each stage of the frame over the period, audio underruns and latency,
+    the SoC temperature and throttle flags, and the play count and run time.
+
+    The file is written alongside and renamed into place, so it is never
+    read half written.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <string>
+
+namespace telemetry
+{
+    // How often the stats thread should call write()
+    const int PERIOD_MS = 10000;
+
+    // Write the metrics to path
+    bool write(const std::string& path);
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+    Thread Scheduling Policy.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include "threadpolicy.hpp"
+#include "frametrace.hpp"
+#include "frontend/config.hpp"
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <pthread.h>
+  #include <sched.h>
+  #include <sys/resource.h>
+  #include <unistd.h>
+  #ifdef __linux__
+    #include <sys/syscall.h>   // for SYS_gettid
+  #endif
+#endif
+
+static const char* ROLE_NAMES[threads_settings_t::ROLES] = { "mixer", "render", "game", "stats" };
+
+void threadpolicy::apply(int role)
+{
+    if (role < 0 || role >= threads_settings_t::ROLES) return;
+    frametrace::name_thread(ROLE_NAMES[role]);
+    const int priority  = config.threads.priority[role];
+    const unsigned cores = unsigned(config.threads.cores[role]);
+    if (priority <= 0 && cores == 0) return;
+
+    std::string applied;
+
+#ifdef _WIN32
+    if (cores) {
+        if (SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(cores)))
+            applied += "cores mask " + std::to_string(cores);
+        else
+            applied += "affinity failed";
+    }
+    if (priority > 0) {
+        // Windows has no real-time levels for a thread alone; map to its top two priorities
+        const int level = priority >= 50 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+        if (!applied.empty()) applied += ", ";
+        applied += SetThreadPriority(GetCurrentThread(), level) ? (priority >= 50 ? "time critical" : "highest priority")
+                                                                : "priority failed";
+    }
+#else
+    if (cores) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int core = 0; core < 32; core++)
+            if (cores & (1u << core)) CPU_SET(core, &set);
+        const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        applied += err ? std::string("affinity failed (") + std::strerror(err) + ")"
+                       : "cores mask " + std::to_string(cores);
+#else
+        applied += "affinity not supported";
+#endif
+    }
+
+    if (priority > 0) {
+        if (!applied.empty()) applied += ", ";
+        const int policy = config.threads.rr ? SCHED_RR : SCHED_FIFO;
+        sched_param param{};
+        param.sched_priority = std::clamp(priority, sched_get_priority_min(policy), sched_get_priority_max(policy));
+        const int err = pthread_setschedparam(pthread_self(), policy, &param);
+        if (err == 0) {
+            applied += std::string(config.threads.rr ? "SCHED_RR" : "SCHED_FIFO") +
+                       " priority " + std::to_string(param.sched_priority);
+        } else {
+            // real-time scheduling needs CAP_SYS_NICE or an rtprio limit; raise the niceness instead
+            const int nice = -std::clamp(priority / 5, 1, 20);
+#ifdef __linux__
+            const int ok = setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), nice) == 0;
+#else
+            const int ok = 0;
+#endif
+            applied += std::string(config.threads.rr ? "SCHED_RR" : "SCHED_FIFO") + " not permitted (" +
+                       std::strerror(err) + "), " +
+                       (ok ? "nice " + std::to_string(nice) : std::string("priority unchanged"));
+        }
+    }
+#endif
+
+    static std::mutex report_mutex;
+    std::lock_guard<std::mutex> lock(report_mutex);
+    std::cout << "INFO: " << ROLE_NAMES[role] << " thread: " << applied << std::endl;
+}
@@ -0,0 +1,19 @@
+/***************************************************************************
+    Thread Scheduling Policy.
+
+    Applies the real-time priority and CPU affinity configured under
+    <threads> in config.xml to the audio mixer, render, game and stats
+    threads. Each thread calls apply() for itself as it starts, and what was
+    applied is reported on the console.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+namespace threadpolicy
+{
+    // Apply the configured policy for role (threads_settings_t::MIXER etc.) to the calling thread
+    void apply(int role);
+}
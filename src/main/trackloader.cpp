@@ -50,6 +50,22 @@ static uint8_t STAGE_MAPPING_JAP[] =
 
 TrackLoader trackloader;
 
+// Move a level's decoded tables to another, leaving its palettes and raw data alone
+static void take_tables(Level& dst, Level&& src)
+{
+    dst.path_words      = std::move(src.path_words);
+    dst.curve_pos       = std::move(src.curve_pos);
+    dst.curve_value     = std::move(src.curve_value);
+    dst.curve_type      = std::move(src.curve_type);
+    dst.wh_pos          = std::move(src.wh_pos);
+    dst.wh_is_width     = std::move(src.wh_is_width);
+    dst.wh_value        = std::move(src.wh_value);
+    dst.wh_change       = std::move(src.wh_change);
+    dst.scenery_pos     = std::move(src.scenery_pos);
+    dst.scenery_total   = std::move(src.scenery_total);
+    dst.scenery_pattern = std::move(src.scenery_pattern);
+}
+
 TrackLoader::TrackLoader()
 {
     layout        = NULL;
@@ -57,6 +73,7 @@ TrackLoader::TrackLoader()
     levels_end    = new Level[5];
     level_split   = new Level();
     current_level = &levels[0];
+    path_level    = &levels[0];
 
     mode       = MODE_ORIGINAL;
 }
@@ -73,6 +90,8 @@ TrackLoader::~TrackLoader()
 
 void TrackLoader::init(bool jap)
 {
+    cancel_decoding();
+
     if (mode == MODE_ORIGINAL)
         init_original_tracks(jap);
     else
@@ -81,7 +100,8 @@ void TrackLoader::init(bool jap)
 
 bool TrackLoader::set_layout_track(const char* filename)
 {
-    if (layout == NULL)
+    cancel_decoding();
+    if (layout != NULL)
         delete layout;
 
     layout = new RomLoader();
@@ -139,7 +159,7 @@ void TrackLoader::init_original_tracks(bool jap)
 
         // CPU 1 Data
         const uint32_t PATH_ADR = roms.rom1p->read32(ROAD_DATA_LOOKUP + STAGE_OFFSET);
-        levels[i].path = &roms.rom1p->rom[PATH_ADR];        
+        setup_path(&levels[i], roms.rom1p, PATH_ADR);
     }
 
     // --------------------------------------------------------------------------------------------
@@ -148,14 +168,14 @@ void TrackLoader::init_original_tracks(bool jap)
 
     // Split stages don't contain palette information
     setup_section(level_split, roms.rom0p, outrun.adr.road_seg_split);
-    level_split->path         = &roms.rom1p->rom[ROAD_DATA_SPLIT];
+    setup_path(level_split, roms.rom1p, ROAD_DATA_SPLIT);
 
     for (int i = 0; i < 5; i++)
     {
         const uint32_t STAGE_ADR = roms.rom0p->read32(outrun.adr.road_seg_end + (i << 2));
         setup_section(&levels_end[i], roms.rom0p, STAGE_ADR);
-        levels_end[i].path  = &roms.rom1p->rom[ROAD_DATA_BONUS];
     }
+    setup_path(&levels_end[0], roms.rom1p, ROAD_DATA_BONUS); // Path is shared for end sections
 }
 
 void TrackLoader::init_layout_tracks(bool jap)
@@ -194,18 +214,32 @@ void TrackLoader::init_layout_tracks(bool jap)
     pal_gnd_data      = &layout->rom[0];
 
     // --------------------------------------------------------------------------------------------
-    // Iterate and setup 15 stages
+    // Iterate and setup 15 stages: palettes now, tables as the route reaches them (use_stage)
     // --------------------------------------------------------------------------------------------
     for (int i = 0; i < STAGES; i++)
     {
         // CPU 0 Data
         const uint32_t STAGE_ADR = layout->read32(LayOut::LEVELS + (i * sizeof(uint32_t)));
-        setup_level(&levels[i], layout, STAGE_ADR);
+        setup_palettes(&levels[i], layout, STAGE_ADR);
+
+        StageDecode& s = stage_decode[i];
+        s.curve_adr    = layout->read32(STAGE_ADR + 24);
+        s.wh_adr       = layout->read32(STAGE_ADR + 28);
+        s.scenery_adr  = layout->read32(STAGE_ADR + 32);
 
         // CPU 1 Data
         const uint32_t PATH_ADR = layout->read32(LayOut::PATH);
-        levels[i].path = &layout->rom[ PATH_ADR + ((ROAD_END_CPU1 * sizeof(uint32_t)) * i) ];
+        s.path_adr     = PATH_ADR + ((ROAD_END_CPU1 * sizeof(uint32_t)) * i);
+
+        // Read from the file until decoded
+        Level& l       = levels[i];
+        l.curve        = &layout->rom[s.curve_adr];
+        l.width_height = &layout->rom[s.wh_adr];
+        l.scenery      = &layout->rom[s.scenery_adr];
+        l.path         = &layout->rom[s.path_adr];
+        take_tables(l, Level());
     }
+    lazy_stages = true;
 
     // --------------------------------------------------------------------------------------------
     // Setup End Sections & Split Stages
@@ -213,20 +247,27 @@ void TrackLoader::init_layout_tracks(bool jap)
 
     // Split stages don't contain palette information
     setup_section(level_split, layout, layout->read32(LayOut::SPLIT_LEVEL));
-    level_split->path = &layout->rom[ layout->read32(LayOut::SPLIT_PATH) ];
+    setup_path(level_split, layout, layout->read32(LayOut::SPLIT_PATH));
 
     // End sections don't contain palette information. Shared path.
-    uint8_t* end_path = &layout->rom[ layout->read32(LayOut::END_PATH) ];
     for (int i = 0; i < 5; i++)
     {
         const uint32_t STAGE_ADR = layout->read32(LayOut::END_LEVELS + (i * sizeof(uint32_t)));
         setup_section(&levels_end[i], layout, STAGE_ADR);
-        levels_end[i].path = end_path;
     }
+    setup_path(&levels_end[0], layout, layout->read32(LayOut::END_PATH));
 }
 
 // Setup a normal level
 void TrackLoader::setup_level(Level* l, RomLoader* data, const int STAGE_ADR)
+{
+    setup_palettes(l, data, STAGE_ADR);
+
+    // Curve Data, Width / Height Lookup, Sprite Information
+    setup_tables(l, data, data->read32(STAGE_ADR + 24), data->read32(STAGE_ADR + 28), data->read32(STAGE_ADR + 32));
+}
+
+void TrackLoader::setup_palettes(Level* l, RomLoader* data, const int STAGE_ADR)
 {
     // Sky Palette
     uint32_t adr = data->read32(STAGE_ADR + 0);
@@ -252,35 +293,146 @@ void TrackLoader::setup_level(Level* l, RomLoader* data, const int STAGE_ADR)
     // Ground Palette
     adr = data->read32(STAGE_ADR + 20);
     l->pal_gnd = data->read16(adr);
-
-    // Curve Data
-    curve_offset = data->read32(STAGE_ADR + 24);
-    l->curve = &data->rom[curve_offset];
-
-    // Width / Height Lookup
-    wh_offset = data->read32(STAGE_ADR + 28);
-    l->width_height = &data->rom[wh_offset];
-
-    // Sprite Information
-    scenery_offset = data->read32(STAGE_ADR + 32);
-    l->scenery = &data->rom[scenery_offset];
 }
 
 // Setup a special section of track (end section or level split)
 // Special sections do not contain palette information
 void TrackLoader::setup_section(Level* l, RomLoader* data, const int STAGE_ADR)
 {
-    // Curve Data
-    curve_offset = data->read32(STAGE_ADR + 0);
-    l->curve = &data->rom[curve_offset];
+    // Curve Data, Width / Height Lookup, Sprite Information
+    setup_tables(l, data, data->read32(STAGE_ADR + 0), data->read32(STAGE_ADR + 4), data->read32(STAGE_ADR + 8));
+}
+
+// Longest table decoded, in segments
+static const uint32_t SEGMENTS_MAX = 0x400;
+
+// Decode the curve, width/height and scenery tables of a level. The tables have no stated
+// length, so each is decoded until a segment the engine never moves past: the -1 that ends the
+// curve data, or a position beyond the end of the road.
+void TrackLoader::setup_tables(Level* l, RomLoader* data, uint32_t curve_adr, uint32_t wh_adr, uint32_t scenery_adr)
+{
+    l->curve        = &data->rom[curve_adr];
+    l->width_height = &data->rom[wh_adr];
+    l->scenery      = &data->rom[scenery_adr];
+
+    l->curve_pos.clear();   l->curve_value.clear(); l->curve_type.clear();
+    l->wh_pos.clear();      l->wh_is_width.clear(); l->wh_value.clear(); l->wh_change.clear();
+    l->scenery_pos.clear(); l->scenery_total.clear(); l->scenery_pattern.clear();
+
+    for (uint32_t adr = curve_adr; adr + 6 <= data->length && l->curve_pos.size() < SEGMENTS_MAX; adr += 6)
+    {
+        l->curve_pos.push_back(read16(data->rom, adr + 0));
+        l->curve_value.push_back(read16(data->rom, adr + 2));
+        l->curve_type.push_back(read16(data->rom, adr + 4));
+        if (l->curve_pos.back() == -1)
+            break;
+    }
+
+    for (uint32_t adr = wh_adr; adr + 8 <= data->length && l->wh_pos.size() < SEGMENTS_MAX; adr += 8)
+    {
+        l->wh_pos.push_back(read16(data->rom, adr + 0));
+        l->wh_is_width.push_back(read16(data->rom, adr + 2));
+        l->wh_value.push_back(read16(data->rom, adr + 4));
+        l->wh_change.push_back(read16(data->rom, adr + 6));
+        if (uint16_t(l->wh_pos.back()) > ROAD_END_CPU1)
+            break;
+    }
+
+    for (uint32_t adr = scenery_adr; adr + 4 <= data->length && l->scenery_pos.size() < SEGMENTS_MAX; adr += 4)
+    {
+        l->scenery_pos.push_back(RomLoader::be16(data->rom + adr));
+        l->scenery_total.push_back(data->rom[adr + 2]);
+        l->scenery_pattern.push_back(data->rom[adr + 3]);
+        if (l->scenery_pos.back() > ROAD_END_CPU1)
+            break;
+    }
+}
+
+// Decode the CPU 1 path of a level: the points of the road, and a little beyond for the look
+// ahead at the end of it.
+void TrackLoader::setup_path(Level* l, RomLoader* data, uint32_t path_adr)
+{
+    static const uint32_t PATH_WORDS = (ROAD_END_CPU1 + 0x100) * 2;
 
-    // Width / Height Lookup
-    wh_offset = data->read32(STAGE_ADR + 4);
-    l->width_height = &data->rom[wh_offset];
+    l->path = &data->rom[path_adr];
+    l->path_words.clear();
 
-    // Sprite Information
-    scenery_offset = data->read32(STAGE_ADR + 8);
-    l->scenery = &data->rom[scenery_offset];
+    for (uint32_t adr = path_adr; adr + 2 <= data->length && l->path_words.size() < PATH_WORDS; adr += 2)
+        l->path_words.push_back(read16(data->rom, adr));
+}
+
+// ------------------------------------------------------------------------------------------------
+//                                 LayOut: Stages Decoded As They're Reached
+// ------------------------------------------------------------------------------------------------
+
+// Stages are numbered across the rows of the route map: row r has r + 1 stages, and from stage
+// c of a row the route goes on to stage c or c + 1 of the next.
+static const uint8_t ROW_START[] = {0, 1, 3, 6, 10};
+
+static int stage_row(int stage)
+{
+    int row = 4;
+    while (ROW_START[row] > stage)
+        row--;
+    return row;
+}
+
+// Decode a stage's tables. On a decoding thread: reads only the LayOut data, which is not
+// changed while a decode is under way (cancel_decoding).
+Level TrackLoader::decode_stage(int stage)
+{
+    const StageDecode& s = stage_decode[stage];
+    Level l;
+    setup_tables(&l, layout, s.curve_adr, s.wh_adr, s.scenery_adr);
+    setup_path(&l, layout, s.path_adr);
+    return l;
+}
+
+// A stage is about to be driven (or its path followed): make sure it's decoded, start on the
+// stages that can follow it, and let go of those the route can no longer reach.
+void TrackLoader::use_stage(Level* l)
+{
+    if (!lazy_stages || l < levels || l >= levels + STAGES)
+        return;
+
+    const int stage = int(l - levels);
+    StageDecode& s  = stage_decode[stage];
+    if (!s.decoded)
+    {
+        take_tables(*l, s.decoding.valid() ? s.decoding.get() : decode_stage(stage));
+        s.decoded = true;
+    }
+
+    const int row = stage_row(stage);
+    const int col = stage - ROW_START[row];
+    for (int i = 0; i < STAGES; i++)
+    {
+        const int r = stage_row(i);
+        const int c = i - ROW_START[r];
+        const bool reachable = (r == row) ? (i == stage) : (r > row && c >= col && c <= col + (r - row));
+        StageDecode& next = stage_decode[i];
+
+        if (reachable && r == row + 1 && !next.decoded && !next.decoding.valid())
+            next.decoding = std::async(std::launch::async, [this, i] { return decode_stage(i); });
+        else if (!reachable && next.decoded && &levels[i] != current_level && &levels[i] != path_level)
+        {
+            take_tables(levels[i], Level());
+            next.decoded = false;
+        }
+    }
+}
+
+// Wait for any decoding under way, and forget every decoded stage
+void TrackLoader::cancel_decoding()
+{
+    for (int i = 0; i < STAGES; i++)
+    {
+        if (stage_decode[i].decoding.valid())
+            stage_decode[i].decoding.wait();
+        stage_decode[i].decoding = std::future<Level>();
+        stage_decode[i].decoded  = false;
+    }
+    lazy_stages = false;
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -289,10 +441,11 @@ void TrackLoader::setup_section(Level* l, RomLoader* data, const int STAGE_ADR)
 
 void TrackLoader::init_track(const uint32_t offset)
 {
-    curve_offset   = 0;
-    wh_offset      = 0;
-    scenery_offset = 0;
+    curve_index   = 0;
+    wh_index      = 0;
+    scenery_index = 0;
     current_level  = &levels[stage_offset_to_level(offset)];
+    use_stage(current_level);
 }
 
 int8_t TrackLoader::stage_offset_to_level(uint32_t id)
@@ -304,17 +457,17 @@ int8_t TrackLoader::stage_offset_to_level(uint32_t id)
 
 void TrackLoader::init_track_split()
 {
-    curve_offset   = 0;
-    wh_offset      = 0;
-    scenery_offset = 0;
+    curve_index   = 0;
+    wh_index      = 0;
+    scenery_index = 0;
     current_level  = level_split;
 }
 
 void TrackLoader::init_track_bonus(const uint32_t id)
 {
-    curve_offset   = 0;
-    wh_offset      = 0;
-    scenery_offset = 0;
+    curve_index   = 0;
+    wh_index      = 0;
+    scenery_index = 0;
     current_level  = &levels_end[id];
 }
 
@@ -324,62 +477,24 @@ void TrackLoader::init_track_bonus(const uint32_t id)
 
 void TrackLoader::init_path(const uint32_t offset)
 {
-    current_path = levels[stage_offset_to_level(offset)].path;
+    path_level = &levels[stage_offset_to_level(offset)];
+    use_stage(path_level);
 }
 
 void TrackLoader::init_path_split()
 {
-    current_path = level_split->path;
+    path_level = level_split;
 }
 
 void TrackLoader::init_path_end()
 {
-    current_path = levels_end[0].path; // Path is shared for end sections
+    path_level = &levels_end[0]; // Path is shared for end sections
 }
 
 // ------------------------------------------------------------------------------------------------
 //                                        HELPER FUNCTIONS TO READ DATA
 // ------------------------------------------------------------------------------------------------
 
-int16_t TrackLoader::readPath(uint32_t addr)
-{
-    return (current_path[addr] << 8) | current_path[addr+1];
-}
-
-int16_t TrackLoader::readPath(uint32_t* addr)
-{
-    int16_t value = (current_path[*addr] << 8) | (current_path[*addr+1]);
-    *addr += 2;
-    return value;
-}
-
-int16_t TrackLoader::read_width_height(uint32_t* addr)
-{
-    int16_t value = (current_level->width_height[*addr + wh_offset] << 8) | (current_level->width_height[*addr+1 + wh_offset]);
-    *addr += 2;
-    return value;
-}
-
-int16_t TrackLoader::read_curve(uint32_t addr)
-{
-    return (current_level->curve[addr + curve_offset] << 8) | current_level->curve[addr+1 + curve_offset];
-}
-
-uint16_t TrackLoader::read_scenery_pos()
-{
-    return (current_level->scenery[scenery_offset] << 8) | current_level->scenery[scenery_offset + 1];
-}
-
-uint8_t TrackLoader::read_total_sprites()
-{
-    return current_level->scenery[scenery_offset + 2];
-}
-
-uint8_t TrackLoader::read_sprite_pattern_index()
-{
-    return current_level->scenery[scenery_offset + 3];
-}
-
 Level* TrackLoader::get_level(uint32_t id)
 {
     return &levels[stage_offset_to_level(id)];
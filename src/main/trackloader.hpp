@@ -14,7 +14,10 @@
 
 #pragma once
 
+#include <future>
+#include <vector>
 #include "globals.hpp"
+#include "romloader.hpp"
 
 // Road Generator Palette Representation
 struct RoadPalette
@@ -33,6 +36,23 @@ struct Level
     uint8_t* width_height;    // Track Width & Height Lookups
     uint8_t* scenery;         // Track Scenery Lookups
 
+    // The above, decoded to native values when the level is set up. Each table is decoded up to
+    // an entry the road position can't reach; anything read beyond comes from the data above.
+    std::vector<int16_t>  path_words;       // Path: x and y change of each point in turn
+
+    std::vector<int16_t>  curve_pos;        // Curve segment: position (-1 ends the track)
+    std::vector<int16_t>  curve_value;      //                road curve
+    std::vector<int16_t>  curve_type;       //                1 = Straight, 2 = Right Bend, 3 = Left Bend
+
+    std::vector<int16_t>  wh_pos;           // Width/height segment: position
+    std::vector<int16_t>  wh_is_width;      //                       set = road width, 0 = road height
+    std::vector<int16_t>  wh_value;         //                       road width / height lookup index
+    std::vector<int16_t>  wh_change;        //                       width adjustment speed (signed)
+
+    std::vector<uint16_t> scenery_pos;      // Scenery segment: position
+    std::vector<uint8_t>  scenery_total;    //                  number of sprites
+    std::vector<uint8_t>  scenery_pattern;  //                  block of sprites
+
     uint16_t pal_sky;         // Index into Sky Palettes
     uint16_t pal_gnd;         // Index into Ground Palettes
 
@@ -58,8 +78,6 @@ struct LayOut
     static const uint32_t HEIGHT_MAPS = SPRITE_MAPS + sizeof(uint32_t);
 };
 
-class RomLoader;
-
 class TrackLoader
 {
 
@@ -75,9 +93,10 @@ public:
     // Display start line on Stage 1
     uint8_t display_start_line;
 
-    uint32_t curve_offset;
-    uint32_t wh_offset;
-    uint32_t scenery_offset;
+    // Current segment of each table in current_level
+    uint32_t curve_index;
+    uint32_t wh_index;
+    uint32_t scenery_index;
 
     // Shared Structures
     uint8_t* pal_sky_data;
@@ -110,27 +129,45 @@ public:
     uint32_t read_heightmap_table(uint16_t entry);
     uint32_t read_scenerymap_table(uint16_t entry);
 
-    int16_t readPath(uint32_t addr);
-    int16_t readPath(uint32_t* addr);
-    int16_t read_width_height(uint32_t* addr);
-    int16_t read_curve(uint32_t addr);
-    uint16_t read_scenery_pos();
-    uint8_t read_total_sprites();
-    uint8_t read_sprite_pattern_index();
+    // Path word at byte offset addr (x, then y, for each point)
+    inline int16_t readPath(uint32_t addr)
+    {
+        const uint32_t i = addr >> 1;
+        return (i < path_level->path_words.size()) ? path_level->path_words[i] : read16(path_level->path, addr);
+    }
+
+    inline int16_t readPath(uint32_t* addr)
+    {
+        const int16_t value = readPath(*addr);
+        *addr += 2;
+        return value;
+    }
+
+    // Fields of the current segments
+    inline int16_t  curve_pos()       { return entry(current_level->curve_pos,       curve_index,   current_level->curve,        6, 0); }
+    inline int16_t  curve_value()     { return entry(current_level->curve_value,     curve_index,   current_level->curve,        6, 2); }
+    inline int16_t  curve_type()      { return entry(current_level->curve_type,      curve_index,   current_level->curve,        6, 4); }
+    inline int16_t  wh_pos()          { return entry(current_level->wh_pos,          wh_index,      current_level->width_height, 8, 0); }
+    inline int16_t  wh_is_width()     { return entry(current_level->wh_is_width,     wh_index,      current_level->width_height, 8, 2); }
+    inline int16_t  wh_value()        { return entry(current_level->wh_value,        wh_index,      current_level->width_height, 8, 4); }
+    inline int16_t  wh_change()       { return entry(current_level->wh_change,       wh_index,      current_level->width_height, 8, 6); }
+    inline uint16_t scenery_pos()     { return entry(current_level->scenery_pos,     scenery_index, current_level->scenery,      4, 0); }
+    inline uint8_t  scenery_total()   { return entry(current_level->scenery_total,   scenery_index, current_level->scenery,      4, 2); }
+    inline uint8_t  scenery_pattern() { return entry(current_level->scenery_pattern, scenery_index, current_level->scenery,      4, 3); }
 
     int8_t stage_offset_to_level(uint32_t);
     Level* get_level(uint32_t);
 
     inline int32_t read32(uint8_t* data, uint32_t* addr)
     {    
-        int32_t value = (data[*addr] << 24) | (data[*addr+1] << 16) | (data[*addr+2] << 8) | (data[*addr+3]);
+        int32_t value = RomLoader::be32(data + *addr);
         *addr += 4;
         return value;
     }
 
     inline int16_t read16(uint8_t* data, uint32_t* addr)
     {
-        int16_t value = (data[*addr] << 8) | (data[*addr+1]);
+        int16_t value = RomLoader::be16(data + *addr);
         *addr += 2;
         return value;
     }
@@ -142,12 +179,12 @@ public:
 
     inline int32_t read32(uint8_t* data, uint32_t addr)
     {    
-        return (data[addr] << 24) | (data[addr+1] << 16) | (data[addr+2] << 8) | data[addr+3];
+        return RomLoader::be32(data + addr);
     }
 
     inline int16_t read16(uint8_t* data, uint32_t addr)
     {
-        return (data[addr] << 8) | data[addr+1];
+        return RomLoader::be16(data + addr);
     }
 
     inline int8_t read8(uint8_t* data, uint32_t addr)
@@ -165,10 +202,39 @@ private:
     Level* level_split;    // Split Section
     Level* levels_end;     // End Section
 
-    uint8_t* current_path; // CPU 1 Road Path
-    
+    Level* path_level;     // CPU 1 Road Path
+
+    // LayOut stages are decoded as the route reaches them, rather than all at once: the stages
+    // that can follow the one being driven are decoded in the background, and the tables of
+    // stages the route can no longer reach are let go. Until decoded, a stage reads from the file.
+    struct StageDecode
+    {
+        uint32_t curve_adr, wh_adr, scenery_adr, path_adr;
+        std::future<Level> decoding;    // valid() while decoding, or decoded and not yet used
+        bool decoded = false;
+    };
+    bool        lazy_stages = false;
+    StageDecode stage_decode[STAGES];
+
+    void  use_stage(Level* l);
+    Level decode_stage(int stage);
+    void  cancel_decoding();
+
     void setup_level(Level* l, RomLoader* data, const int STAGE_ADR);
+    void setup_palettes(Level* l, RomLoader* data, const int STAGE_ADR);
     void setup_section(Level* l, RomLoader* data, const int STAGE_ADR);
+    void setup_tables(Level* l, RomLoader* data, uint32_t curve_adr, uint32_t wh_adr, uint32_t scenery_adr);
+    void setup_path(Level* l, RomLoader* data, uint32_t path_adr);
+
+    // Field of segment 'index' of a table: decoded, or else read from the raw table
+    template <typename T>
+    static inline T entry(const std::vector<T>& decoded, uint32_t index, const uint8_t* raw, uint32_t size, uint32_t field)
+    {
+        if (index < decoded.size())
+            return decoded[index];
+        const uint8_t* p = raw + (index * size) + field;
+        return (sizeof(T) == 1) ? T(*p) : T(RomLoader::be16(p));
+    }
 };
 
 extern TrackLoader trackloader;
\ No newline at end of file
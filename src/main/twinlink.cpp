@@ -0,0 +1,318 @@
+/***************************************************************************
+    Linked Twin Cabinets (Linux).
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include "twinlink.hpp"
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "ghost.hpp"
+#include "roms.hpp"
+#include "threadpolicy.hpp"
+#include "frontend/config.hpp"
+#include "engine/oferrari.hpp"
+#include "engine/oinitengine.hpp"
+#include "engine/oroad.hpp"
+#include "engine/osprites.hpp"
+#include "engine/outrun.hpp"
+
+static const uint32_t RING        = 32;     // packets held for the game thread
+static const uint32_t MAX_PREDICT = 30;     // ticks the other car is shown for, unheard
+static const int      BLEND_SHIFT = 2;      // a correction is blended out by 1/4 a tick
+static const uint8_t  MAX_PAL     = 4;      // palette offsets send() produces
+
+// Single producer (the receiver), single consumer (tick(), on the game thread)
+static twinlink::Packet      ring[RING];
+static std::atomic<uint32_t> head{0};
+static std::atomic<uint32_t> tail{0};
+static std::atomic<bool>     running{false};
+static std::thread           receiver;
+static int                   sock = -1;
+static sockaddr_storage      remote_addr{};  // the other cabinet: nothing else is listened to
+
+// Game thread
+static uint32_t         now = 0;                    // ticks since start()
+static bool             heard = false;
+static twinlink::Packet peer{};                     // latest from the other cabinet
+static uint32_t         peer_arrived = 0;           // our tick it arrived on
+static uint32_t         rtt = 0;                    // round trip, in ticks
+static int32_t          prev_road_pos = 0;
+static int16_t          prev_x = 0;
+static int32_t          error_pos = 0;              // shown less predicted, being blended out
+static int32_t          error_x = 0;
+static int32_t          shown_pos = 0;
+static int16_t          shown_x = 0;
+static bool             shown = false;
+
+// The socket is connected, but anything queued before connect() would still be read
+static bool from_peer(const sockaddr_storage& from)
+{
+    if (from.ss_family != remote_addr.ss_family)
+        return false;
+    if (from.ss_family == AF_INET)
+    {
+        const sockaddr_in& a = reinterpret_cast<const sockaddr_in&>(from);
+        const sockaddr_in& b = reinterpret_cast<const sockaddr_in&>(remote_addr);
+        return a.sin_port == b.sin_port && a.sin_addr.s_addr == b.sin_addr.s_addr;
+    }
+    if (from.ss_family == AF_INET6)
+    {
+        const sockaddr_in6& a = reinterpret_cast<const sockaddr_in6&>(from);
+        const sockaddr_in6& b = reinterpret_cast<const sockaddr_in6&>(remote_addr);
+        return a.sin6_port == b.sin6_port && std::memcmp(&a.sin6_addr, &b.sin6_addr, sizeof(a.sin6_addr)) == 0;
+    }
+    return false;
+}
+
+static void run()
+{
+    threadpolicy::apply(threads_settings_t::STATS);
+
+    twinlink::Packet p;
+    while (running.load(std::memory_order_acquire))
+    {
+        sockaddr_storage from{};
+        socklen_t from_len = sizeof(from);
+        const ssize_t n = ::recvfrom(sock, &p, sizeof(p), 0, reinterpret_cast<sockaddr*>(&from), &from_len);
+        if (n != ssize_t(sizeof(p)) || p.magic != twinlink::MAGIC || !from_peer(from))
+            continue; // timed out, or not ours
+
+        const uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= RING)
+            continue; // tick() is behind: only the latest matters, and more will come
+        ring[h % RING] = p;
+        head.store(h + 1, std::memory_order_release);
+    }
+}
+
+bool twinlink::start(const std::string& peer_address)
+{
+    if (sock >= 0)
+        return true;
+
+    const size_t colon = peer_address.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == peer_address.size())
+    {
+        std::cerr << "twinlink: give the other cabinet as host:port, not " << peer_address << std::endl;
+        return false;
+    }
+    const std::string host = peer_address.substr(0, colon);
+    const std::string port = peer_address.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* remote  = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &remote) != 0 || !remote)
+    {
+        std::cerr << "twinlink: unable to find " << host << std::endl;
+        return false;
+    }
+
+    hints.ai_family = remote->ai_family;
+    hints.ai_flags  = AI_PASSIVE;
+    addrinfo* local = nullptr;
+    bool ok = getaddrinfo(nullptr, port.c_str(), &hints, &local) == 0 && local;
+
+    if (ok)
+        sock = ::socket(remote->ai_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock >= 0)
+    {
+        std::memcpy(&remote_addr, remote->ai_addr, std::min<size_t>(remote->ai_addrlen, sizeof(remote_addr)));
+        const timeval timeout{0, 200000}; // so the receiver sees stop()
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ok = ::bind(sock, local->ai_addr, local->ai_addrlen) == 0 &&
+             ::connect(sock, remote->ai_addr, remote->ai_addrlen) == 0;
+    }
+    if (!ok || sock < 0)
+    {
+        std::cerr << "twinlink: unable to link to " << peer_address << ": " << std::strerror(errno) << std::endl;
+        if (sock >= 0)
+            ::close(sock);
+        sock = -1;
+    }
+    if (local)
+        freeaddrinfo(local);
+    freeaddrinfo(remote);
+    if (sock < 0)
+        return false;
+
+    std::cout << "twinlink: linked to " << peer_address << std::endl;
+    running  = true;
+    receiver = std::thread(run);
+    return true;
+}
+
+void twinlink::stop()
+{
+    if (sock < 0)
+        return;
+    running = false;
+    receiver.join();
+    ::close(sock);
+    sock = -1;
+}
+
+// Where the other car is predicted to be now, from its last packet
+static void predict(int32_t& road_pos, int16_t& x)
+{
+    const int32_t ahead = int32_t(std::min(now - peer_arrived + rtt / 2, MAX_PREDICT));
+    road_pos = peer.road_pos + peer.road_step * ahead;
+    x        = int16_t(peer.x + peer.x_step * ahead);
+}
+
+// The frames send() can show the car in: the Ferrari's driving and skid frames
+static bool known_frame(uint32_t addr)
+{
+    for (uint32_t turn = 0; turn <= 0x30; turn += 0x18)
+        for (uint32_t incline = 0; incline <= 0x10; incline += 8)
+            if (roms.rom0p->read32(outrun.adr.sprite_ferrari_frames + turn + incline) == addr)
+                return true;
+    for (uint32_t frame = 0; frame <= 0x18; frame += 8)
+        for (uint32_t incline = 0; incline <= 0x40; incline += 0x20)
+            if (roms.rom0p->read32(outrun.adr.sprite_skid_frames + frame + incline) == addr)
+                return true;
+    return false;
+}
+
+static void receive()
+{
+    const uint32_t h = head.load(std::memory_order_acquire);
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    for (; t != h; t++)
+    {
+        twinlink::Packet& p = ring[t % RING];
+        if (heard && int32_t(p.tick - peer.tick) <= 0)
+            continue; // late, or repeated: a newer one is already in use
+
+        // The frame and palette are looked up in the ROMs unchecked: a car to be drawn in any
+        // frame the game doesn't send isn't from a cabinet
+        if ((p.flags & twinlink::VISIBLE) && !known_frame(p.addr))
+            continue;
+        p.pal = std::min(p.pal, MAX_PAL);
+
+        // Round trip: our tick it echoes, less the time it was held at the other end
+        if (p.echo && int32_t(now - p.echo) >= p.echo_age)
+            rtt = std::min<uint32_t>(now - p.echo - p.echo_age, MAX_PREDICT);
+
+        // Roll the prediction back to this packet, keeping what's shown for blending out
+        int32_t old_pos = 0;
+        int16_t old_x   = 0;
+        if (shown)
+            predict(old_pos, old_x);
+        peer         = p;
+        peer_arrived = now;
+        heard        = true;
+        if (shown && (p.flags & twinlink::IN_RACE))
+        {
+            int32_t pos;
+            int16_t x;
+            predict(pos, x);
+            error_pos += old_pos - pos;
+            error_x   += old_x - x;
+        }
+    }
+    tail.store(t, std::memory_order_release);
+}
+
+static void send()
+{
+    const oentry& car = osprites.jump_table[OSprites::SPRITE_FERRARI];
+    const bool in_race = outrun.game_state == GS_INGAME;
+    const bool visible = oferrari.state == OFerrari::FERRARI_LOGIC && (car.control() & OSprites::ENABLE) &&
+                         known_frame(car.addr); // as receive() checks it
+
+    twinlink::Packet p{};
+    p.magic     = twinlink::MAGIC;
+    p.tick      = now;
+    p.echo      = heard ? peer.tick : 0;
+    p.echo_age  = uint16_t(std::min<uint32_t>(now - peer_arrived, 0xFFFF));
+    p.flags     = (in_race ? twinlink::IN_RACE : 0) |
+                  (visible ? twinlink::VISIBLE : 0) |
+                  ((car.control() & OSprites::HFLIP) ? twinlink::HFLIP : 0);
+    p.stage     = uint8_t(oroad.stage_lookup_off);
+    p.road_pos  = oroad.road_pos;
+    p.road_step = oroad.road_pos - prev_road_pos;
+    p.x         = oinitengine.car_x_pos;
+    p.x_step    = int16_t(oinitengine.car_x_pos - prev_x);
+    p.addr      = car.addr;
+    p.pal       = uint8_t(std::clamp(int(car.pal_src) - int(oferrari.ferrari_pal), 0, int(MAX_PAL)));
+
+    prev_road_pos = oroad.road_pos;
+    prev_x        = oinitengine.car_x_pos;
+
+    // Never waits: if the socket can't take it, the next tick's will do
+    ::send(sock, &p, sizeof(p), MSG_DONTWAIT);
+}
+
+void twinlink::tick()
+{
+    if (sock < 0)
+        return;
+
+    if (outrun.tick_frame)
+    {
+        now++;
+        receive();
+        send();
+    }
+
+    // The ghost's sprite: with a ghost on the road, that's drawn instead
+    if (config.ttrial.ghost && outrun.cannonball_mode == Outrun::MODE_TTRIAL)
+        return;
+
+    const bool show = heard && outrun.game_state == GS_INGAME && (peer.flags & IN_RACE) && (peer.flags & VISIBLE) &&
+                      peer.stage == uint8_t(oroad.stage_lookup_off) && now - peer_arrived <= MAX_PREDICT;
+    if (!show)
+    {
+        shown     = false;
+        error_pos = error_x = 0;
+        return;
+    }
+
+    if (outrun.tick_frame)
+    {
+        predict(shown_pos, shown_x);
+        shown_pos += error_pos;
+        shown_x    = int16_t(shown_x + error_x);
+        error_pos -= error_pos >> BLEND_SHIFT;
+        error_x   -= error_x >> BLEND_SHIFT;
+        if (error_pos > -(1 << BLEND_SHIFT) && error_pos < (1 << BLEND_SHIFT)) error_pos = 0;
+        if (error_x > -(1 << BLEND_SHIFT) && error_x < (1 << BLEND_SHIFT)) error_x = 0;
+        shown = true;
+        ghost::draw_car(shown_pos, shown_x, peer.addr, peer.pal, peer.flags & HFLIP);
+    }
+    else if (shown)
+    {
+        // Frame by frame at 60 fps, half way to the next tick
+        ghost::draw_car(shown_pos + peer.road_step / 2, int16_t(shown_x + peer.x_step / 2),
+                        peer.addr, peer.pal, peer.flags & HFLIP);
+    }
+}
+
+#else
+
+bool twinlink::start(const std::string&)
+{
+    std::cerr << "twinlink: linked cabinets are only available on Linux" << std::endl;
+    return false;
+}
+
+void twinlink::stop() {}
+void twinlink::tick() {}
+
+#endif
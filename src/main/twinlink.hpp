@@ -0,0 +1,66 @@
+/***************************************************************************
+    Linked Twin Cabinets (Linux).
+
+    OutRun was sold as twin cabinets. With -twin host:port, two cabinets
+    on a network each show the other's Ferrari on the road as they race:
+    every tick, each sends where its car is over UDP (port, on both), and
+    draws the other's car as the time trial ghost is drawn, placed against
+    the road like a traffic car, in another colour.
+
+    The engine simulates one Ferrari, with the road, traffic and timers
+    all driven by it, so each cabinet runs its own game and the cars don't
+    collide; the other car is shown wherever it is on the same stage.
+
+    A packet takes a few ticks to arrive, so the other car is predicted
+    forward by the time since its last packet was sent, half the measured
+    round trip and the ticks since it arrived, at the speed it was then
+    going. When a packet arrives, the prediction is rolled back to it and
+    run forward again, and the difference to what was shown is blended
+    out over a few ticks rather than the car jumping. A car not heard from
+    for a second is no longer shown.
+
+    Packets are in host byte order, as outlink's are: link cabinets of
+    the same kind.
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace twinlink
+{
+    const uint32_t MAGIC = 0x31544243; // "CBT1", in host byte order
+
+    #pragma pack(push, 1)
+    struct Packet
+    {
+        uint32_t magic;
+        uint32_t tick;          // sender's tick count
+        uint32_t echo;          // the last tick it had from us,
+        uint16_t echo_age;      // and how many ticks ago that arrived (for the round trip)
+        uint8_t  flags;         // IN_RACE, VISIBLE, HFLIP
+        uint8_t  stage;         // oroad.stage_lookup_off
+        int32_t  road_pos;
+        int32_t  road_step;     // road_pos change over the last tick
+        int16_t  x;             // oinitengine.car_x_pos
+        int16_t  x_step;
+        uint32_t addr;          // sprite frame
+        uint8_t  pal;           // brake lights, wheels and incline
+    };
+    #pragma pack(pop)
+
+    enum { IN_RACE = 1, VISIBLE = 2, HFLIP = 4 };
+
+    // Link to the cabinet at peer ("host:port"), listening on the same port.
+    // False, with a message, if the address or socket can't be set up.
+    bool start(const std::string& peer);
+
+    void stop();
+
+    // In the jump table, after the Ferrari: send this tick's car, and draw the other cabinet's
+    void tick();
+}
@@ -5,9 +5,14 @@
     See license.txt for more details.
 ***************************************************************************/
 
+#include <cstring>
 #include <sstream>
 #include "utils.hpp"
 
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
 // Convert value to string
 std::string Utils::to_string(int i)
 {
@@ -42,4 +47,56 @@ uint32_t Utils::from_hex_string(std::string s)
     ss >> x;
     // output it as a signed type
     return static_cast<unsigned int>(x);
-}
\ No newline at end of file
+}
+
+// CRC32 tables for slicing-by-8: t[0] is the usual byte table, and t[k] advances a byte's CRC
+// past k more zero bytes, so eight bytes are folded in with eight independent lookups.
+struct Crc32Tables
+{
+    uint32_t t[8][256];
+};
+
+static constexpr Crc32Tables make_crc32_tables()
+{
+    Crc32Tables tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+        tables.t[0][i] = c;
+    }
+    for (int k = 1; k < 8; ++k)
+        for (uint32_t i = 0; i < 256; ++i)
+            tables.t[k][i] = (tables.t[k - 1][i] >> 8) ^ tables.t[0][tables.t[k - 1][i] & 0xFFu];
+    return tables;
+}
+
+static constexpr Crc32Tables CRC32 = make_crc32_tables();
+
+// CRC32 (IEEE 802.3). ARMv8 has instructions for this polynomial (SSE4.2's are for CRC32C, a
+// different one), used where the target has them; otherwise slicing-by-8.
+uint32_t Utils::crc32(const void* data, size_t n)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint32_t c = 0xFFFFFFFFu;
+
+#if defined(__ARM_FEATURE_CRC32)
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        c = __crc32d(c, v);
+    }
+#else
+    const auto& t = CRC32.t;
+    for (; n >= 8; p += 8, n -= 8) {
+        const uint32_t lo = c ^ (uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24));
+        const uint32_t hi = uint32_t(p[4]) | (uint32_t(p[5]) << 8) | (uint32_t(p[6]) << 16) | (uint32_t(p[7]) << 24);
+        c = t[7][lo & 0xFFu] ^ t[6][(lo >> 8) & 0xFFu] ^ t[5][(lo >> 16) & 0xFFu] ^ t[4][lo >> 24] ^
+            t[3][hi & 0xFFu] ^ t[2][(hi >> 8) & 0xFFu] ^ t[1][(hi >> 16) & 0xFFu] ^ t[0][hi >> 24];
+    }
+#endif
+
+    for (; n; ++p, --n)
+        c = CRC32.t[0][(c ^ *p) & 0xFFu] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
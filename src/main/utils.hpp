@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 #include "stdint.hpp"
 
@@ -17,6 +18,7 @@ public:
     static std::string to_string(char c);
     static std::string to_hex_string(int i);
     static uint32_t from_hex_string(std::string s);
+    static uint32_t crc32(const void* data, size_t n);    // CRC32 (IEEE 802.3)
 
 private:
 };
\ No newline at end of file
@@ -16,20 +16,31 @@
 ***************************************************************************/
 
 // Aligned Memory Allocation (std, not Boost)
-#include <new>          // std::align_val_t, ::operator new/delete
 #include <cstddef>      // std::size_t
 #include <cstdint>
+#include <cstdio>
 #include <cstring>      // std::memset
 #include <iostream>
+#include <algorithm>    // std::min
 #include <bit>          // std::byteswap (C++20/23)
 #include <cstring>      // std::memcpy
+#include <filesystem>
+#include <fstream>
+#include <future>
 
 #include "video.hpp"
 #include "globals.hpp"
 #include "frontend/config.hpp"
+#include "frametrace.hpp"
+#include "bootprof.hpp"
+#include "framearena.hpp"
+#include "framerec.hpp"
+#include "batchrender.hpp"
+#include "jobsystem.hpp"
 #include "engine/oroad.hpp"
 
 #include "sdl2/rendersurface.hpp"
+#include "sdl2/renderfb.hpp"
 
 Video video;
 
@@ -57,30 +68,59 @@ Video::~Video(void)
 
 int Video::init(Roms* roms, video_settings_t* settings)
 {
-    if (!set_video_mode(settings))
-        return false;
+    {
+        bootprof::Phase phase("video_mode");
+        if (!set_video_mode(settings))
+            return false;
+    }
 
     // Internal pixel arrays.
     // JJP - add 128 bytes to each video buffer so that we can then avoid testing for x>0 in the sprite rendering loop
 //    std::size_t size = ((config.s16_width * config.s16_height) + alignment) * sizeof(uint16_t);
     std::size_t size = ((config.s16_width * (config.s16_height+2)) + alignment) * sizeof(uint16_t);
-    // Initialise two buffers. This is used to allow the renderer to read from one buffer while the main thread writes to the other.
-    pixel_buffers[0] = static_cast<uint16_t*>(::operator new(size, std::align_val_t(alignment)));
-    pixel_buffers[1] = static_cast<uint16_t*>(::operator new(size, std::align_val_t(alignment)));
+    // Initialise the buffer ring. This is used to allow the renderer to read from one buffer while the main thread writes to another.
+    // The buffers come from the frame buffer arena, with the renderer's surfaces.
+    for (auto& buffer : pixel_buffers) {
+        buffer = static_cast<uint16_t*>(framearena::alloc(size));
+        // Initialize each buffer to all zeros using std::memset
+        std::memset(buffer, 0, size);
+    }
     current_pixel_buffer = 0;
+    ready_pixel_buffer   = render_pixel_buffer = PIXEL_BUFFERS - 1;
     pixels = pixel_buffers[current_pixel_buffer] + alignment;
-    // Initialize both buffers to all zeros using std::memset
-    std::memset(pixel_buffers[0], 0, size);
-    std::memset(pixel_buffers[1], 0, size);
 
-    // Convert S16 tiles to a more useable format
-    if (!roms->tiles.rom || !roms->sprites.rom || !roms->road.rom) {
+    // Convert S16 tiles to a more useable format. This happens once: what's converted, and the
+    // flipped sprites built as they are drawn, are the same in every video mode, so a restart
+    // (hires, widescreen, fps etc.) only sets up the drawing for the new mode.
+    const bool convert = !graphics_converted;
+    if (convert && (!roms->tiles.rom || !roms->sprites.rom || !roms->road.rom)) {
         std::cerr << "ROM buffers missing at Video::init() — cannot build graphics subsystem.\n";
         return false;
     }
-    tile_layer->init(roms->tiles.rom, config.video.hires != 0);
-    sprite_layer->init(roms->sprites.rom);
-    hwroad.init(roms->road.rom, config.video.hires != 0);
+    const bool hires = config.video.hires != 0;
+    bootprof::Phase graphics_phase("graphics");
+    if (convert) {
+        // Each converts its own ROM into its own tables, so the three run side by side
+        auto tiles = std::async(std::launch::async, [&] { tile_layer->init(roms->tiles.rom, hires); });
+        auto road  = std::async(std::launch::async, [&] { hwroad.init(roms->road.rom, hires); });
+        sprite_layer->init(roms->sprites.rom, sprite_cache_file());
+        tiles.get();
+        road.get();
+    } else {
+        tile_layer->init(nullptr, hires);
+        sprite_layer->init(nullptr);
+        hwroad.init(nullptr, hires);
+    }
+    graphics_phase.end();
+    sprite_layer->start_prewarm(); // converts any rows the cache didn't have
+    graphics_converted = true;
+
+    // Nothing reads the graphics ROMs once they are converted
+    if (config.data.lean_memory && convert) {
+        roms->tiles.unload();
+        roms->sprites.unload();
+        roms->road.unload();
+    }
 
     clear_tile_ram();
     clear_text_ram();
@@ -91,24 +131,172 @@ int Video::init(Roms* roms, video_settings_t* settings)
     return true;
 }
 
+size_t Video::graphics_bytes() const
+{
+    return sizeof(*tile_layer) + sizeof(*sprite_layer) + sprite_layer->table_bytes() + sizeof(hwroad);
+}
+
 void Video::swap_buffers()
 {
-//std::cout << std::hex << "Video::swap_buffers: pixel_buffers[0/1]: " << pixel_buffers[0] << "/" << pixel_buffers[1] << std::dec << "\n";
-    current_pixel_buffer ^= 1;
+    swap_prepare_buffers();
+    swap_render_buffers();
+}
+
+// The frame just prepared becomes the newest complete frame, and preparation moves on to the
+// next buffer of the ring. Any filter pass still running keeps its own buffer.
+void Video::swap_prepare_buffers()
+{
+    if (framerec::recording())
+        framerec::capture(pixels, config.s16_width, config.s16_height, config.fps, frame_palette);
+    if (batchrender::rendering())
+        batchrender::capture(pixels, config.s16_width, config.s16_height, config.fps, frame_palette);
+    ready_pixel_buffer   = current_pixel_buffer;
+    current_pixel_buffer = (current_pixel_buffer + 1) % PIXEL_BUFFERS;
     pixels = pixel_buffers[current_pixel_buffer] + alignment;
+}
+
+// Once the filter pass is complete: hand its output on for presentation, and point the next
+// pass at the newest complete frame.
+void Video::swap_render_buffers()
+{
+    render_pixel_buffer = ready_pixel_buffer;
     renderer->swap_buffers();
+    flush_palette();
+    hold_static_frame();
+}
+
+// Hash of a frame and its palette for hold_static_frame(), in four multiply-xor lanes the
+// compiler can vectorise
+static uint64_t hash_frame(const uint16_t* pixels, size_t count, const uint8_t* palette, size_t palette_bytes)
+{
+    uint64_t h[4] = { 0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull };
+    auto add = [&](const uint8_t* p, size_t bytes)
+    {
+        size_t i = 0;
+        for (; i + 32 <= bytes; i += 32)
+        {
+            uint64_t w[4];
+            std::memcpy(w, p + i, sizeof(w));
+            for (int l = 0; l < 4; l++)
+            {
+                h[l] = (h[l] ^ w[l]) * 0x9E3779B97F4A7C15ull;
+                h[l] ^= h[l] >> 29;
+            }
+        }
+        for (; i < bytes; i++)
+            h[i & 3] = (h[i & 3] ^ p[i]) * 0x9E3779B97F4A7C15ull;
+    };
+    add(reinterpret_cast<const uint8_t*>(pixels), count * sizeof(uint16_t));
+    add(palette, palette_bytes);
+    return ((h[0] ^ h[1] * 3) * 0x9E3779B97F4A7C15ull) ^ (h[2] * 5 + h[3]);
+}
+
+// Menus, the course map and attract screens often show the same frame for many frames in a row.
+// When the frame render_frame() is to draw is the same as the last one, palette and all, the
+// renderer may keep showing its last output, and the filter pass and texture upload are skipped
+// (video.static_frames). The display is still refreshed each frame.
+void Video::hold_static_frame()
+{
+    frame_held = false;
+    if (!config.video.static_frames || config.video.low_latency)
+    {
+        frame_hash = 0;
+        return;
+    }
+    const uint64_t h = hash_frame(pixel_buffers[render_pixel_buffer] + alignment,
+                                  size_t(config.s16_width) * config.s16_height, frame_palette, sizeof(frame_palette));
+    frame_held = h == frame_hash && renderer->hold_frame();
+    frame_hash = h;
 }
 
 void Video::disable()
 {
+    if (enabled)
+        sprite_layer->save_cache(sprite_cache_file());
     renderer->disable();
-    if (pixels)
+    // nothing draws into the frame buffers now: the next mode has the arena
+    for (auto& buffer : pixel_buffers)
+        buffer = nullptr;
+    pixels = nullptr;
+    framearena::reset();
+    enabled = false;
+}
+
+// Pre-flipped sprite data is cached separately for each resolution
+std::string Video::sprite_cache_file() const
+{
+    return config.data.save_path + (config.video.hires ? "sprites_cache_hires.bin" : "sprites_cache.bin");
+}
+
+bool Video::save_snapshot(const std::string& filename)
+{
+    static_assert(sizeof(palette) == SNAPSHOT_PALETTE, "snapshot palette size");
+
+    SnapshotHeader header;
+    header.magic      = SNAPSHOT_MAGIC;
+    header.version    = SNAPSHOT_VERSION;
+    header.hires      = uint32_t(config.video.hires != 0);
+    header.widescreen = uint32_t(config.video.widescreen != 0);
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out || !save_state(out))
     {
-        if (pixel_buffers[0]) { ::operator delete(pixel_buffers[0], std::align_val_t(alignment)); pixel_buffers[0] = nullptr; }
-        if (pixel_buffers[1]) { ::operator delete(pixel_buffers[1], std::align_val_t(alignment)); pixel_buffers[1] = nullptr; }
-        pixels = nullptr;
+        std::cerr << "Unable to write video snapshot " << filename << std::endl;
+        return false;
     }
-    enabled = false;
+    return true;
+}
+
+bool Video::load_snapshot(const std::string& filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    SnapshotHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION)
+    {
+        std::cerr << filename << " is not a version " << SNAPSHOT_VERSION << " video snapshot" << std::endl;
+        return false;
+    }
+    if (!load_state(in))
+    {
+        std::cerr << "Video snapshot " << filename << " is truncated" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Video::save_state(std::ostream& out) const
+{
+    out.write(reinterpret_cast<const char*>(palette), sizeof(palette));
+    return out && tile_layer->save_state(out) && sprite_layer->save_state(out) && hwroad.save_state(out);
+}
+
+bool Video::load_state(std::istream& in)
+{
+    wait_prepared();
+    in.read(reinterpret_cast<char*>(palette), sizeof(palette));
+    palette_dirty_blocks = ~uint64_t(0);
+    return in && tile_layer->load_state(in) && sprite_layer->load_state(in) && hwroad.load_state(in);
+}
+
+void Video::check_snapshot()
+{
+    if (!snapshot_requested.exchange(false))
+        return;
+
+    // next unused name, so that a series of frames can be captured
+    char name[32];
+    std::string filename;
+    for (int n = 0; n < 1000; n++)
+    {
+        snprintf(name, sizeof(name), "snapshot_%03d.bin", n);
+        filename = config.data.save_path + name;
+        if (!std::filesystem::exists(filename))
+            break;
+    }
+    if (save_snapshot(filename))
+        std::cout << "Video snapshot written to " << filename << std::endl;
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -143,6 +331,16 @@ int Video::set_video_mode(video_settings_t* settings)
     if (settings->scale < 1)
         settings->scale = 1;
 
+    // The renderer is chosen by config.xml, and can change at a video restart (after disable()).
+    // The old one goes through its own destructor (RenderBase's is virtual), freeing its buffers.
+    const bool want_fb = settings->renderer == 1;
+    if (want_fb != (dynamic_cast<RenderFB*>(renderer) != nullptr))
+    {
+        delete renderer;
+        if (want_fb) renderer = new RenderFB();
+        else         renderer = new RenderSurface();
+    }
+
     set_shadow_intensity(settings->shadow == 0 ? shadow::ORIGINAL : shadow::MAME);
     //renderer->init_palette(config.video.red_curve, config.video.green_curve, config.video.blue_curve);
     renderer->init_palette(100, 100, 100);
@@ -175,39 +373,241 @@ void Video::set_shadow_intensity(float f)
 
 void Video::prepare_frame()
 {
-    // Renderer Specific Frame Setup
-    if (!renderer->start_frame())
+    for (int stage = PREPARE_BEGIN; stage < PREPARE_STAGES; stage++)
+        prepare_stage(stage);
+}
+
+static_assert(frametrace::BLARGG - frametrace::PREPARE == Video::PREPARE_STAGES,
+              "frametrace has a point per prepare stage");
+
+// The sprite and road RAM, tile values and palette of the frame the game has just ticked. The
+// sprite and road RAM stays put until the frame is drawn, even if the game swaps it; the rest is
+// copied, so the game can write the next frame meanwhile.
+void Video::publish_frame(bool overlap)
+{
+    sprite_layer->hold_frame();
+    hwroad.hold_frame();
+    tile_layer->update_tile_values();
+    road_foreground = !config.engine.fix_bugs || oroad.horizon_base != ORoad::HORIZON_OFF;
+
+    uint64_t blocks = palette_dirty_blocks;
+    palette_dirty_blocks = 0;
+    frame_palette_dirty |= blocks;
+    while (blocks)
+    {
+        const int first = std::countr_zero(blocks);
+        const int end   = first + std::countr_one(blocks >> first);
+        std::memcpy(frame_palette + first * PALETTE_BLOCK_ENTRIES * 2, palette + first * PALETTE_BLOCK_ENTRIES * 2,
+                    size_t(end - first) * PALETTE_BLOCK_ENTRIES * 2);
+        blocks = (end < 64) ? blocks & ~((uint64_t(1) << end) - 1) : 0;
+    }
+
+    published = true;
+    if (overlap)
+        preparing.store(true, std::memory_order_release);
+}
+
+void Video::wait_prepared()
+{
+    while (preparing.load(std::memory_order_acquire))
+        preparing.wait(true, std::memory_order_acquire);
+}
+
+void Video::prepare_stage(int stage)
+{
+    frametrace::Scope trace(frametrace::PREPARE + stage);
+
+    // the text layer is all that's left, which draws from its own copy of text RAM
+    if (stage == PREPARE_TEXT)
+    {
+        sprite_layer->release_frame();
+        hwroad.release_frame();
+        if (preparing.exchange(false, std::memory_order_acq_rel))
+            preparing.notify_all();
+    }
+
+    if (stage == PREPARE_BEGIN)
+    {
+        if (!published)
+            publish_frame();
+        published = false;
+
+        // Renderer Specific Frame Setup
+        frame_started = renderer->start_frame();
+        if (!frame_started)
+            return;
+
+        if (!enabled)
+        {
+            // Fill with black pixels
+            int i = config.s16_width * config.s16_height; // JJP optimisation
+            while (i--)
+                pixels[i] = 0;
+        }
+        return;
+    }
+
+    if (!frame_started || !enabled)
         return;
 
-    if (!enabled)
+    // when compositing by strip or by band, the whole frame is drawn in the first layer stage
+    if (config.video.strip_lines > 0 || config.video.prepare_bands > 1)
     {
-        // Fill with black pixels
-        int i = config.s16_width * config.s16_height; // JJP optimisation
-        while (i--)
-            pixels[i] = 0;
+        if (stage == PREPARE_ROAD_BG)
+            prepare_strips();
+        return;
     }
-    else
+
+    switch (stage)
+    {
+        case PREPARE_ROAD_BG:
+            // drawn with the background tile layer instead, when the layers are fused
+            if (!config.video.fused_layers)
+                (hwroad.*hwroad.render_background)(pixels, 0, config.s16_height);
+            break;
+
+        case PREPARE_TILES_BG:
+            if (config.video.fused_layers)
+            {
+                // sky fill and background layer in one pass, writing each pixel once
+                int32_t sky[S16_HEIGHT];
+                hwroad.background_colors(sky);
+                tile_layer->render_tile_layer(pixels, 1, 0, sky);
+            }
+            else
+                tile_layer->render_tile_layer(pixels, 1, 0);  // background layer
+            break;
+
+        case PREPARE_TILES_FG:
+            tile_layer->render_tile_layer(pixels, 0, 0);      // foreground layer
+            break;
+
+        case PREPARE_ROAD_FG:
+            if (road_foreground)
+                (hwroad.*hwroad.render_foreground)(pixels, 0, config.s16_height);
+            break;
+
+        case PREPARE_SPRITES:
+            sprite_layer->render(pixels, 8);
+            break;
+
+        case PREPARE_TEXT:
+            tile_layer->render_text_layer(pixels, 1);
+            break;
+    }
+}
+
+// Draw every layer, in the same order as the stages above, one strip of lines at a time, so that
+// each strip of the frame buffer stays in cache while all of the layers are drawn over it.
+//
+// With video.prepare_bands, the frame is split into that many bands of lines, drawn at once by
+// the job system; each band draws all of its layers in order, so no band waits on another.
+void Video::prepare_strips()
+{
+    const int bands = std::min(config.video.prepare_bands, int(hwsprites::MAX_BANDS));
+    const bool banded = bands > 1 && jobsystem.running();
+    prepare_layers(banded);
+
+    if (!banded)
+    {
+        prepare_lines(0, config.s16_height);
+        return;
+    }
+
+    // hi-res bands start on even lines, as strips do
+    const int align = config.video.hires ? ~1 : ~0;
+    JobCounter counter;
+    for (int band = 0; band < bands; band++)
     {
-        // OutRun Hardware Video Emulation
-        tile_layer->update_tile_values();
+        const int y0 = ((config.s16_height * band) / bands) & align;
+        const int y1 = band == bands - 1 ? config.s16_height : ((config.s16_height * (band + 1)) / bands) & align;
+        jobsystem.submit(counter, [this, y0, y1, band] { prepare_lines(y0, y1, band); });
+    }
+    jobsystem.wait(counter);
+}
+
+// Per-frame layer setup for prepare_lines(), before any lines are drawn. banded: the lines are
+// then drawn in bands, at once.
+void Video::prepare_layers(bool banded)
+{
+    sprite_layer->settle_rows(banded);
+    tile_layer->prepare_tile_layer(1, 0);
+    tile_layer->prepare_tile_layer(0, 0);
+    tile_layer->prepare_text_layer(1);
 
-        (hwroad.*hwroad.render_background)(pixels);
-        tile_layer->render_tile_layer(pixels, 1, 0);      // background layer
-        tile_layer->render_tile_layer(pixels, 0, 0);      // foreground layer
+    if (config.video.fused_layers)
+        hwroad.background_colors(sky_colors);
+}
 
-        if (!config.engine.fix_bugs || oroad.horizon_base != ORoad::HORIZON_OFF)
-            (hwroad.*hwroad.render_foreground)(pixels);
+// Draw all layers over output lines [y_begin, y_end), in strips of config.video.strip_lines
+// (or in one go if strip compositing is off). In hi-res mode y_begin must be even. Lines drawn
+// at the same time as others need a band of their own (see hwsprites::render).
+void Video::prepare_lines(int y_begin, int y_end, int band)
+{
+    // hi-res lines are drawn in pairs, so strips must start on an even line
+    int lines = config.video.strip_lines > 0 ? config.video.strip_lines : y_end - y_begin;
+    if (config.video.hires)
+        lines = (lines + 1) & ~1;
 
-        sprite_layer->render(pixels, 8);
-        tile_layer->render_text_layer(pixels, 1);
+    for (int y0 = y_begin; y0 < y_end; y0 += lines)
+    {
+        const int y1 = std::min(y0 + lines, y_end);
+
+        if (config.video.fused_layers)
+            tile_layer->blit_tile_layer(pixels, 1, 0, y0, y1, sky_colors);
+        else
+        {
+            (hwroad.*hwroad.render_background)(pixels, y0, y1);
+            tile_layer->blit_tile_layer(pixels, 1, 0, y0, y1);
+        }
+        tile_layer->blit_tile_layer(pixels, 0, 0, y0, y1);
+        if (road_foreground)
+            (hwroad.*hwroad.render_foreground)(pixels, y0, y1);
+        sprite_layer->render(pixels, 8, y0, y1, band);
+        tile_layer->blit_text_layer(pixels, 1, y0, y1);
+    }
+}
+
+// Low latency path: prepare one band of this frame and filter it straight away, rather than
+// filtering it during the next frame. Bands must be prepared in order, from band 0. The band
+// can then be passed to upload_slice() while the next band is being prepared.
+//
+// bands should divide S16_HEIGHT so that hi-res bands start on even lines.
+void Video::prepare_slice(int band, int bands)
+{
+    if (band == 0)
+    {
+        prepare_stage(PREPARE_BEGIN);
+        flush_palette();
+        if (frame_started && enabled)
+            prepare_layers();
+    }
+
+    if (frame_started && enabled)
+        prepare_lines((config.s16_height * band) / bands, (config.s16_height * (band + 1)) / bands);
+
+    if (band == bands - 1)
+    {
+        sprite_layer->release_frame();
+        hwroad.release_frame();
     }
+
+    renderer->draw_frame(pixels, band, bands);
 }
 
-void Video::render_frame(int fastpass)
+void Video::upload_slice(int band, int bands)
 {
-    // draw the frame from the pixel buffer not in use for writing
-    uint16_t* renderer_pixels = pixel_buffers[current_pixel_buffer ^ 1] + alignment;
-    renderer->draw_frame(renderer_pixels, fastpass);
+    renderer->upload_frame(band, bands);
+}
+
+void Video::render_frame(int band, int bands)
+{
+    // draw the frame (or one horizontal band of it) from the last complete pixel buffer
+    if (frame_held)
+        return; // the renderer is showing it already
+    frametrace::Scope trace(frametrace::RENDER);
+    uint16_t* renderer_pixels = pixel_buffers[render_pixel_buffer] + alignment;
+    renderer->draw_frame(renderer_pixels, band, bands);
 }
 
 void Video::present_frame()
@@ -215,6 +615,16 @@ void Video::present_frame()
 	renderer->finalize_frame();
 }
 
+bool Video::repeat_frame(bool black)
+{
+    return renderer->repeat_frame(black);
+}
+
+void Video::set_threaded_present(bool on)
+{
+    renderer->set_threaded_present(on);
+}
+
 bool Video::supports_window()
 {
     return renderer->supports_window();
@@ -233,19 +643,29 @@ void Video::clear_text_ram()
 {
     for (uint32_t i = 0; i <= 0xFFF; i++)
         tile_layer->text_ram[i] = 0;
+    tile_layer->invalidate_text_layer();
 }
 
+// Text RAM writes of what's already there (the HUD redraws its digits every tick) aren't
+// marked dirty, so an unchanged text layer isn't redrawn.
 void Video::write_text8(uint32_t addr, const uint8_t data)
 {
-    tile_layer->text_ram[addr & 0xFFF] = data;
+    const uint32_t index = addr & 0xFFF;
+    if (tile_layer->text_ram[index] == data)
+        return;
+    tile_layer->text_ram[index] = data;
+    tile_layer->mark_text_dirty(index, 1);
 }
 
 void Video::write_text16(uint32_t* addr, const uint16_t data)
 {
     const uint32_t base = (*addr) & 0x0FFFu;      // 4 KiB text RAM
     const uint16_t le = std::byteswap(data);
-    std::memcpy(&tile_layer->text_ram[base], &le, sizeof(le));
     *addr += 2;
+    if (std::memcmp(&tile_layer->text_ram[base], &le, sizeof(le)) == 0)
+        return;
+    std::memcpy(&tile_layer->text_ram[base], &le, sizeof(le));
+    tile_layer->mark_text_dirty(base, sizeof(le));
 }
 
 /*
@@ -262,7 +682,10 @@ void Video::write_text16(uint32_t addr, const uint16_t data)
 {
     const uint32_t base = addr & 0x0FFFu;      // 4 KiB text RAM
     const uint16_t le = std::byteswap(data);
+    if (std::memcmp(&tile_layer->text_ram[base], &le, sizeof(le)) == 0)
+        return;
     std::memcpy(&tile_layer->text_ram[base], &le, sizeof(le));
+    tile_layer->mark_text_dirty(base, sizeof(le));
 }
 
 /*
@@ -277,8 +700,11 @@ void Video::write_text32(uint32_t* addr, const uint32_t data)
 {
     const uint32_t base = (*addr) & 0x0FFFu;      // 4 KiB text RAM
     const uint32_t le = std::byteswap(data);
-    std::memcpy(&tile_layer->text_ram[base], &le, sizeof(le));
     *addr += 4;
+    if (std::memcmp(&tile_layer->text_ram[base], &le, sizeof(le)) == 0)
+        return;
+    std::memcpy(&tile_layer->text_ram[base], &le, sizeof(le));
+    tile_layer->mark_text_dirty(base, sizeof(le));
 }
 
 
@@ -298,7 +724,10 @@ void Video::write_text32(uint32_t addr, const uint32_t data)
 {
     const uint32_t base = addr & 0x0FFFu;      // 4 KiB text RAM
     const uint32_t le = std::byteswap(data);
+    if (std::memcmp(&tile_layer->text_ram[base], &le, sizeof(le)) == 0)
+        return;
     std::memcpy(&tile_layer->text_ram[base], &le, sizeof(le));
+    tile_layer->mark_text_dirty(base, sizeof(le));
 }
 
 /*
@@ -324,11 +753,14 @@ void Video::clear_tile_ram()
 {
     for (uint32_t i = 0; i <= 0xFFFF; i++)
         tile_layer->tile_ram[i] = 0;
+    tile_layer->invalidate_layers();
 }
 
 void Video::write_tile8(uint32_t addr, const uint8_t data)
 {
-    tile_layer->tile_ram[addr & 0xFFFF] = data;
+    const uint32_t index = addr & 0xFFFF;
+    tile_layer->tile_ram[index] = data;
+    tile_layer->mark_dirty(index, 1);
 }
 
 void Video::write_tile16(uint32_t* addr, const uint16_t data)
@@ -337,6 +769,7 @@ void Video::write_tile16(uint32_t* addr, const uint16_t data)
     const uint32_t index = (*addr) & 0xFFFFU;
     const uint16_t le = std::byteswap(data);   // big‑endian → little‑endian
     std::memcpy(&tile_layer->tile_ram[index], &le, sizeof(le));
+    tile_layer->mark_dirty(index, sizeof(le));
     *addr += 2;
 }
 
@@ -356,6 +789,7 @@ void Video::write_tile16(uint32_t addr, const uint16_t data)
     const uint32_t index = addr & 0xFFFFU;
     const uint16_t le = std::byteswap(data);   // big‑endian → little‑endian
     std::memcpy(&tile_layer->tile_ram[index], &le, sizeof(le));
+    tile_layer->mark_dirty(index, sizeof(le));
 }
 
 /*
@@ -372,6 +806,7 @@ void Video::write_tile32(uint32_t* addr, const uint32_t data)
     const uint32_t index = (*addr) & 0xFFFFU;
     const uint32_t le = std::byteswap(data);  // big‑endian → little‑endian
     std::memcpy(&tile_layer->tile_ram[index], &le, sizeof(le));
+    tile_layer->mark_dirty(index, sizeof(le));
     *addr += 4;
 }
 
@@ -393,6 +828,7 @@ void Video::write_tile32(uint32_t addr, const uint32_t data)
     const uint32_t index = addr & 0xFFFFU;
     const uint32_t le = std::byteswap(data);   // big‑endian → little‑endian
     std::memcpy(&tile_layer->tile_ram[index], &le, sizeof(le));
+    tile_layer->mark_dirty(index, sizeof(le));
 }
 
 /*
@@ -513,6 +949,28 @@ void Video::write_pal32(uint32_t adr, const uint32_t data)
 }
 */
 
+void Video::write_pal16(uint32_t adr, const uint16_t* data, int count)
+{
+    adr &= (0x1fffu - 1u);
+    for (int i = 0; i < count; i++)
+    {
+        const uint16_t word = std::byteswap(data[i]);
+        std::memcpy(&palette[(adr + i * 2) & (0x1fffu - 1u)], &word, sizeof(word));
+    }
+    refresh_palette_range(adr, uint32_t(count) * 2);
+}
+
+void Video::write_pal32(uint32_t adr, const uint32_t* data, int count)
+{
+    adr &= (0x1fffu - 3u);
+    for (int i = 0; i < count; i++)
+    {
+        const uint32_t word = std::byteswap(data[i]);
+        std::memcpy(&palette[(adr + i * 4) & (0x1fffu - 3u)], &word, sizeof(word));
+    }
+    refresh_palette_range(adr, uint32_t(count) * 4);
+}
+
 uint8_t Video::read_pal8(uint32_t palAddr)
 {
     return palette[palAddr & 0x1fff];
@@ -581,26 +1039,39 @@ uint32_t Video::read_pal32(uint32_t* palAddr)
 }
 */
 
-// Convert internal System 16 RRRR GGGG BBBB format palette to renderer output format
+// Note a palette write. The entry is converted to the renderer output format by flush_palette(),
+// with everything else written during the frame, rather than by the game logic.
 void Video::refresh_palette(uint32_t palAddr)
 {
-    // Ensure we address an even index – the palette is 16‑bit entries.
-    palAddr &= ~1u;
-
-    /*  Read the 16‑bit value once.
-        The palette stores a big‑endian word:  high byte first.  */
-    uint16_t a;
-    std::memcpy(&a, &palette[palAddr], sizeof a);   // one 16‑bit copy
-    a = std::byteswap(a);
+    palette_dirty_blocks |= uint64_t(1) << ((palAddr & 0x1fff) / (2 * PALETTE_BLOCK_ENTRIES));
+}
 
-    /*  Extract the 5‑bit RGB components in a single operation each.
-        The logic is equivalent to the original code but needs only
-        one shift, one mask and one OR per component.  */
-    uint8_t r = (((a >> 0) & 0x000Fu) << 1) | ((a >> 12) & 1u);   // bits 0‑3, flag bit 12
-    uint8_t g = (((a >> 4) & 0x000Fu) << 1) | ((a >> 13) & 1u); // bits 4‑7, flag bit 13
-    uint8_t b = (((a >> 8) & 0x000Fu) << 1) | ((a >> 14) & 1u); // bits 8‑11, flag bit 14
+// As refresh_palette(), for bytes of entries from palAddr
+void Video::refresh_palette_range(uint32_t palAddr, uint32_t bytes)
+{
+    if (!bytes)
+        return;
+    palAddr &= 0x1fff;
+    const uint32_t first = palAddr / (2 * PALETTE_BLOCK_ENTRIES);
+    const uint32_t last  = (palAddr + bytes - 1) / (2 * PALETTE_BLOCK_ENTRIES);
+    for (uint32_t b = first; b <= last; b++)
+        palette_dirty_blocks |= uint64_t(1) << (b & 63);
+}
 
-    renderer->convert_palette(palAddr, r, g, b);
+// Convert the internal System 16 RRRR GGGG BBBB format palette entries published since the last
+// call to the renderer output format, a run of blocks at a time. Called at the frame boundary,
+// whilst no filter pass is reading the renderer's palette.
+void Video::flush_palette()
+{
+    uint64_t blocks = frame_palette_dirty;
+    frame_palette_dirty = 0;
+    while (blocks)
+    {
+        const int first = std::countr_zero(blocks);
+        const int end   = first + std::countr_one(blocks >> first);
+        renderer->convert_palette_range(frame_palette, first * PALETTE_BLOCK_ENTRIES, end * PALETTE_BLOCK_ENTRIES);
+        blocks = (end < 64) ? blocks & ~((uint64_t(1) << end) - 1) : 0;
+    }
 }
 /*
 void Video::refresh_palette(uint32_t palAddr)
@@ -11,6 +11,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <string>
 #include "stdint.hpp"
 #include "globals.hpp"
 #include "roms.hpp"
@@ -33,23 +35,58 @@ class Video
 public:
 	hwsprites* sprite_layer;
     hwtiles* tile_layer;
-    uint16_t* pixel_buffers[2];
+    // Ring of pixel buffers, so that the frame being prepared, the frame being filtered and the
+    // newest complete frame are all in different buffers. The filter pass can then overrun into
+    // the next frame without the prepare stages having to wait for it.
+    static const int PIXEL_BUFFERS = 3;
+    uint16_t* pixel_buffers[PIXEL_BUFFERS] = {};
     uint16_t* pixels;
-    int current_pixel_buffer;
+    int current_pixel_buffer;       // being prepared
+    int ready_pixel_buffer  = 0;    // newest complete frame
+    int render_pixel_buffer = 0;    // being filtered by render_frame()
 
     bool enabled;
 
+    // prepare_frame() is split into the S16 hardware layers, in draw order, so that
+    // the layers can be scheduled as dependent jobs.
+    enum
+    {
+        PREPARE_BEGIN,      // frame setup (tile values, or blank frame if disabled)
+        PREPARE_ROAD_BG,
+        PREPARE_TILES_BG,
+        PREPARE_TILES_FG,
+        PREPARE_ROAD_FG,
+        PREPARE_SPRITES,
+        PREPARE_TEXT,
+        PREPARE_STAGES
+    };
+
 	Video();
     ~Video();
     
 	int init(Roms* roms, video_settings_t* settings);
     void swap_buffers();
+    void swap_prepare_buffers();
+    void swap_render_buffers();
+    void flush_palette();
     void disable();
     int set_video_mode(video_settings_t* settings);
     void set_shadow_intensity(float);
     void prepare_frame();
-    void render_frame(int fastpass);
+    void prepare_stage(int stage);
+    // Latch what the game has left in the video hardware for the next PREPARE_BEGIN to draw (it
+    // does so itself otherwise). With overlap the game's next tick may run alongside the prepare
+    // stages, drawing from what was latched.
+    void publish_frame(bool overlap = false);
+    // From the game, before replacing what the prepare stages draw from (a state load, clearing
+    // sprite RAM): wait for any stages drawing a frame published with overlap to be done with it
+    void wait_prepared();
+    void render_frame(int band = 0, int bands = 1);
+    void prepare_slice(int band, int bands);
+    void upload_slice(int band, int bands);
     void present_frame();
+    bool repeat_frame(bool black);
+    void set_threaded_present(bool on);
     bool supports_window();
     bool supports_vsync();
 
@@ -75,18 +112,77 @@ public:
 	void write_pal16(uint32_t*, const uint16_t);
 	void write_pal32(uint32_t*, const uint32_t);
 	void write_pal32(uint32_t, const uint32_t);
+	// A run of count entries from adr, noted for conversion once per block the run covers
+	void write_pal16(uint32_t, const uint16_t*, int);
+	void write_pal32(uint32_t, const uint32_t*, int);
 	uint8_t read_pal8(uint32_t);
 	uint16_t read_pal16(uint32_t*);
 	uint16_t read_pal16(uint32_t);
     uint32_t read_pal32(uint32_t*);
 
+    // Snapshot of the video hardware state for the last frame, so that it can be redrawn
+    // away from the game (the kernel benchmarks in src/bench load these). The file holds
+    // a SnapshotHeader, palette RAM, then the tile, sprite and road layer states. The tile
+    // page and scroll registers live in tile RAM, so are included.
+    struct SnapshotHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t hires;
+        uint32_t widescreen;
+    };
+    static const uint32_t SNAPSHOT_MAGIC   = 0x50534243; // "CBSP"
+    static const uint32_t SNAPSHOT_VERSION = 1;
+    static const int      SNAPSHOT_PALETTE = S16_PALETTE_ENTRIES * 2;
+    bool save_snapshot(const std::string& filename);
+    // Restore a snapshot into the layers, which then redraw that frame until the engine next
+    // writes to them
+    bool load_snapshot(const std::string& filename);
+    // The palette and layer states alone, as held in a snapshot after its header (enginestate
+    // keeps these alongside the engine). Only between frames: no layer may be being prepared.
+    bool save_state(std::ostream& out) const;
+    bool load_state(std::istream& in);
+    // Save a snapshot at the end of the current frame (F10), to save_path/snapshot_nnn.bin
+    void request_snapshot() { snapshot_requested = true; }
+    void check_snapshot();
+
+    // Bytes held by the converted graphics, for the memory report (the frame buffers are in
+    // the frame buffer arena)
+    size_t graphics_bytes() const;
+
 private:
     // SDL Renderer
     RenderBase* renderer;
 
     const int alignment = 64;
+    bool frame_started = false; // set by PREPARE_BEGIN; later stages are skipped if false
+    bool graphics_converted = false; // tile, sprite and road ROMs converted (kept across restarts)
 	alignas(64) uint8_t palette[S16_PALETTE_ENTRIES * 2]; // 2 Bytes Per Palette Entry
+    // Blocks of palette entries written since the last flush_palette(), one bit per block
+    static const int PALETTE_BLOCK_ENTRIES = S16_PALETTE_ENTRIES / 64;
+    uint64_t palette_dirty_blocks = ~uint64_t(0);
+    // The palette as published with the frame, and its blocks flush_palette() is yet to convert
+    alignas(64) uint8_t frame_palette[S16_PALETTE_ENTRIES * 2];
+    uint64_t frame_palette_dirty = ~uint64_t(0);
+    bool published = false;
+    std::atomic<bool> preparing{false};
+    // The frame for render_frame() is the same as the last drawn, and the renderer is showing
+    // that instead (see hold_static_frame)
+    bool     frame_held = false;
+    uint64_t frame_hash = 0;
+    void hold_static_frame();
     void refresh_palette(uint32_t);
+    void refresh_palette_range(uint32_t, uint32_t);
+    void prepare_strips();
+    void prepare_layers(bool banded = false);
+    void prepare_lines(int y_begin, int y_end, int band = 0);
+
+    // set by prepare_layers() and publish_frame() for the frame being drawn
+    int32_t sky_colors[S16_HEIGHT];
+    bool    road_foreground = true;
+    std::string sprite_cache_file() const;
+
+    std::atomic<bool> snapshot_requested{false};
 
 };
 
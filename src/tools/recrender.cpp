@@ -0,0 +1,225 @@
+/***************************************************************************
+    CannonBall-SE Recording Renderer.
+
+    Turns a recording made with "cannonball-se -capture file" into raw
+    RGB24 frames at 60 frames a second, for a video encoder:
+
+        cannonball-recrender capture.cbfr - | ffmpeg -f rawvideo
+            -pix_fmt rgb24 -s 320x224 -r 60 -i - capture.mp4
+
+    The size to give the encoder is printed on start. Frames recorded at
+    30 fps are written twice, and frames dropped during recording are
+    filled with the frame before. The colours are those of the SDL2
+    renderer without filters. Frames of another size to the first (after
+    a change of video mode) are shown as the frame before them.
+
+        cannonball-recrender [-frames first:last] capture out.rgb
+
+    Copyright (c) 2025 James Pearce.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "globals.hpp"
+#include "framerec.hpp"
+#include "sdl2/renderbase.hpp"
+
+// Palette conversion, as the SDL2 renderer does it, without a display
+class RecRenderer : public RenderBase
+{
+public:
+    bool init(int, int, int, int, int) { return true; }
+    void swap_buffers()                 {}
+    void disable()                      {}
+    bool start_frame()                  { return true; }
+    bool finalize_frame()               { return true; }
+    void draw_frame(uint16_t*, int, int) {}
+
+    const uint8_t (*rgba8_palette() const)[4] { return s16_rgba8; }
+};
+
+static bool get_varint(const std::vector<uint8_t>& in, size_t& pos, uint32_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 35 && pos < in.size(); shift += 7)
+    {
+        const uint8_t b = in[pos++];
+        v |= uint32_t(b & 0x7F) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// Apply one frame's operations (framerec.hpp) to the frame before
+static bool decode(const std::vector<uint8_t>& ops, std::vector<uint16_t>& pixels)
+{
+    size_t pos = 0, at = 0;
+    while (pos < ops.size())
+    {
+        uint32_t token;
+        if (!get_varint(ops, pos, token))
+            return false;
+        const size_t n = token >> 2;
+        if (at + n > pixels.size())
+            return false;
+        switch (token & 3)
+        {
+            case framerec::SKIP:
+                break;
+            case framerec::RUN:
+                if (pos + 2 > ops.size())
+                    return false;
+                std::fill_n(pixels.begin() + at, n, uint16_t(ops[pos] | (ops[pos + 1] << 8)));
+                pos += 2;
+                break;
+            case framerec::LITERAL:
+                if (pos + n * 2 > ops.size())
+                    return false;
+                for (size_t i = 0; i < n; i++, pos += 2)
+                    pixels[at + i] = uint16_t(ops[pos] | (ops[pos + 1] << 8));
+                break;
+            default:
+                return false;
+        }
+        at += n;
+    }
+    return at == pixels.size();
+}
+
+static void usage()
+{
+    std::cerr << "Usage: cannonball-recrender [-frames first:last] capture out.rgb" << std::endl
+              << "       (out.rgb as - writes to stdout)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    long first_frame = 0, last_frame = -1;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if (arg == "-frames" && i + 1 < argc)
+        {
+            char* end = nullptr;
+            first_frame = std::strtol(argv[++i], &end, 10);
+            last_frame  = (end && *end == ':') ? std::strtol(end + 1, nullptr, 10) : -1;
+        }
+        else if (arg == "-help" || arg == "--help")
+        {
+            usage();
+            return 0;
+        }
+        else
+            files.push_back(arg);
+    }
+    if (files.size() != 2)
+    {
+        usage();
+        return 1;
+    }
+
+    std::ifstream in(files[0], std::ios::binary);
+    framerec::FileHeader file_header;
+    if (!in || !in.read(reinterpret_cast<char*>(&file_header), sizeof(file_header)))
+    {
+        std::cerr << "Unable to read " << files[0] << std::endl;
+        return 1;
+    }
+    if (file_header.magic != framerec::MAGIC || file_header.version != framerec::VERSION)
+    {
+        std::cerr << files[0] << " is not a recording from this version of CannonBall-SE" << std::endl;
+        return 1;
+    }
+
+    FILE* out = files[1] == "-" ? stdout : std::fopen(files[1].c_str(), "wb");
+    if (!out)
+    {
+        std::cerr << "Unable to write " << files[1] << std::endl;
+        return 1;
+    }
+
+    RecRenderer renderer;
+    renderer.init_palette(100, 100, 100);
+    uint8_t palette[S16_PALETTE_ENTRIES * 2] = {};
+
+    std::vector<uint16_t> pixels;
+    std::vector<uint8_t>  ops, rgb;
+    int      width = 0, height = 0, out_width = 0, out_height = 0;
+    long     next_frame = 0, written = 0, skipped = 0;
+    framerec::FrameHeader header;
+
+    while (in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        for (int b = 0; b < framerec::PALETTE_BLOCKS; b++)
+            if (header.palette_blocks & (uint64_t(1) << b))
+                in.read(reinterpret_cast<char*>(palette) + b * framerec::PALETTE_BLOCK_BYTES, framerec::PALETTE_BLOCK_BYTES);
+        ops.resize(header.pixel_bytes);
+        if (!in.read(reinterpret_cast<char*>(ops.data()), std::streamsize(ops.size())))
+            break;
+
+        if (header.width != width || header.height != height)
+        {
+            width  = header.width;
+            height = header.height;
+            pixels.assign(size_t(width) * height, 0);
+        }
+        if (!decode(ops, pixels))
+        {
+            std::cerr << "Frame " << header.frame << " is damaged; stopping there" << std::endl;
+            break;
+        }
+        if (!out_width)
+        {
+            out_width  = width;
+            out_height = height;
+            rgb.resize(size_t(width) * height * 3);
+            std::cerr << "Writing " << width << "x" << height << " RGB24 at 60 fps" << std::endl;
+        }
+        if (width != out_width || height != out_height)
+        {
+            skipped++;
+            continue;
+        }
+
+        // 60 fps out; the frame before fills any gap
+        const int repeat = header.fps == 30 ? 2 : 1;
+        auto emit = [&](long frames)
+        {
+            for (long f = 0; f < frames; f++, written++)
+                if (written >= first_frame && (last_frame < 0 || written <= last_frame))
+                    std::fwrite(rgb.data(), 1, rgb.size(), out);
+        };
+        if (written)
+            emit((long(header.frame) - next_frame) * repeat);
+        next_frame = long(header.frame) + 1;
+
+        renderer.convert_palette_range(palette, 0, S16_PALETTE_ENTRIES);
+        const uint8_t (*rgba)[4] = renderer.rgba8_palette();
+        for (size_t i = 0; i < pixels.size(); i++)
+        {
+            const uint8_t* c = rgba[pixels[i] & (S16_PALETTE_ENTRIES * 2 - 1)];
+            rgb[i * 3 + 0] = c[0];
+            rgb[i * 3 + 1] = c[1];
+            rgb[i * 3 + 2] = c[2];
+        }
+        emit(repeat);
+    }
+
+    if (out != stdout)
+        std::fclose(out);
+    std::cerr << written << " frames";
+    if (skipped)
+        std::cerr << " (" << skipped << " of another size shown as the frame before)";
+    std::cerr << std::endl;
+    return 0;
+}